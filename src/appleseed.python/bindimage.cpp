@@ -27,6 +27,9 @@
 // THE SOFTWARE.
 //
 
+// appleseed.python headers.
+#include "bufferprotocol.h"
+
 // appleseed.renderer headers.
 #include "renderer/kernel/aov/imagestack.h"
 #include "renderer/kernel/aov/tilestack.h"
@@ -41,8 +44,6 @@
 
 // Standard headers.
 #include <cstddef>
-#include <cstring>
-#include <memory>
 #include <string>
 
 namespace bpy = boost::python;
@@ -126,11 +127,59 @@ namespace
 
     bpy::object tile_get_storage(const Tile* tile)
     {
-        // Allocate our own temp buffer and copy the pixels.
-        std::unique_ptr<char[]> data (new char[tile->get_size()]);
-        std::memcpy(data.get(), tile->get_storage(), tile->get_size());
+        return
+            c_array_to_py_array(
+                reinterpret_cast<const char*>(tile->get_storage()),
+                tile->get_pixel_format(),
+                tile->get_size());
+    }
+
+    const char* python_buffer_format(PixelFormat format)
+    {
+#if PY_MAJOR_VERSION >= 3
+        // Half floats are only understood by the struct module of Python 3.
+        if (format == PixelFormatHalf)
+            return "e";
+#endif
+
+        return python_array_code(format);
+    }
+
+    bpy::object make_tile_storage_view(const bpy::object& owner, Tile& tile)
+    {
+        const char* format = python_buffer_format(tile.get_pixel_format());
+
+        return
+            make_memoryview(
+                owner,
+                tile.get_storage(),
+                tile.get_size(),
+                format,
+                format[0] == 'B' ? 1 : Pixel::size(tile.get_pixel_format()),
+                false);
+    }
+
+    // Return a flat, writable memoryview over the pixels of a tile, without copying them.
+    // The view keeps the Python tile object alive.
+    bpy::object tile_get_storage_view(const bpy::object& py_tile)
+    {
+        Tile& tile = bpy::extract<Tile&>(py_tile);
+        return make_tile_storage_view(py_tile, tile);
+    }
+
+    // Same as above, for one of the tiles of an image. The view keeps the image alive.
+    bpy::object image_get_tile_storage_view(const bpy::object& py_image, const size_t tile_x, const size_t tile_y)
+    {
+        Image& image = bpy::extract<Image&>(py_image);
+        const CanvasProperties& props = image.properties();
+
+        if (tile_x >= props.m_tile_count_x || tile_y >= props.m_tile_count_y)
+        {
+            PyErr_SetString(PyExc_IndexError, "Invalid tile coordinates");
+            bpy::throw_error_already_set();
+        }
 
-        return c_array_to_py_array(data.get(), tile->get_pixel_format(), tile->get_size());
+        return make_tile_storage_view(py_image, image.tile(tile_x, tile_y));
     }
 
     std::string image_stack_get_name(const ImageStack* image_stack, const size_t index)
@@ -177,7 +226,8 @@ void bind_image()
         .def("get_channel_count", &Tile::get_channel_count)
         .def("get_pixel_count", &Tile::get_pixel_count)
         .def("get_size", &Tile::get_size)
-        .def("get_storage", tile_get_storage);
+        .def("get_storage", tile_get_storage)
+        .def("get_storage_view", tile_get_storage_view);
 
     const Tile& (Image::*image_get_tile)(const size_t, const size_t) const = &Image::tile;
 
@@ -185,7 +235,8 @@ void bind_image()
         .def("__copy__", copy_image, bpy::return_value_policy<bpy::manage_new_object>())
         .def("__deepcopy__", copy_image, bpy::return_value_policy<bpy::manage_new_object>())
         .def("properties", &Image::properties, bpy::return_value_policy<bpy::reference_existing_object>())
-        .def("tile", image_get_tile, bpy::return_value_policy<bpy::reference_existing_object>());
+        .def("tile", image_get_tile, bpy::return_value_policy<bpy::reference_existing_object>())
+        .def("get_tile_storage_view", image_get_tile_storage_view);
 
     const Image& (ImageStack::*image_stack_get_image)(const size_t) const = &ImageStack::get_image;
 
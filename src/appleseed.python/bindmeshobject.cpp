@@ -29,19 +29,23 @@
 
 // appleseed.python headers.
 #include "bindentitycontainers.h"
+#include "bufferprotocol.h"
 #include "dict2dict.h"
+#include "gillocks.h"
 
 // appleseed.renderer headers.
 #include "renderer/api/object.h"
 
 // appleseed.foundation headers.
 #include "foundation/platform/python.h"
+#include "foundation/platform/types.h"
 #include "foundation/utility/murmurhash.h"
 #include "foundation/utility/searchpaths.h"
 
 // Standard headers.
 #include <cstddef>
 #include <string>
+#include <vector>
 
 namespace bpy = boost::python;
 using namespace foundation;
@@ -77,6 +81,328 @@ namespace
         object->get_triangle(index) = triangle;
     }
 
+    //
+    // Bulk transfer of geometry through the buffer protocol.
+    //
+    // Setters accept any object exporting a contiguous buffer of numbers (numpy
+    // arrays, array.array...) and getters return array.array objects. Values are
+    // converted and copied with the GIL released.
+    //
+
+    const char* get_scalar_typecode()
+    {
+        return sizeof(GScalar) == sizeof(float) ? "f" : "d";
+    }
+
+    const char* get_uint32_typecode()
+    {
+        return sizeof(unsigned int) == sizeof(uint32) ? "I" : "L";
+    }
+
+    size_t get_row_count(const ScopedPyBuffer& view, const size_t width)
+    {
+        if (view.get_item_count() % width != 0)
+        {
+            raise_python_exception(
+                PyExc_ValueError,
+                "The number of values in the buffer is not a multiple of the number of components.");
+        }
+
+        return view.get_item_count() / width;
+    }
+
+    void push_vertex_array(MeshObject* object, const bpy::object& buffer)
+    {
+        const ScopedPyBuffer view(buffer.ptr());
+        const size_t count = get_row_count(view, 3);
+
+        ScopedGILUnlock unlock;
+        vector<GScalar> scratch;
+        const GScalar* values = view.get_items(scratch);
+
+        object->reserve_vertices(object->get_vertex_count() + count);
+
+        for (size_t i = 0; i < count; ++i, values += 3)
+            object->push_vertex(GVector3(values[0], values[1], values[2]));
+    }
+
+    void push_vertex_normal_array(MeshObject* object, const bpy::object& buffer)
+    {
+        const ScopedPyBuffer view(buffer.ptr());
+        const size_t count = get_row_count(view, 3);
+
+        ScopedGILUnlock unlock;
+        vector<GScalar> scratch;
+        const GScalar* values = view.get_items(scratch);
+
+        object->reserve_vertex_normals(object->get_vertex_normal_count() + count);
+
+        for (size_t i = 0; i < count; ++i, values += 3)
+            object->push_vertex_normal(GVector3(values[0], values[1], values[2]));
+    }
+
+    void push_tex_coords_array(MeshObject* object, const bpy::object& buffer)
+    {
+        const ScopedPyBuffer view(buffer.ptr());
+        const size_t count = get_row_count(view, 2);
+
+        ScopedGILUnlock unlock;
+        vector<GScalar> scratch;
+        const GScalar* values = view.get_items(scratch);
+
+        object->reserve_tex_coords(object->get_tex_coords_count() + count);
+
+        for (size_t i = 0; i < count; ++i, values += 2)
+            object->push_tex_coords(GVector2(values[0], values[1]));
+    }
+
+    // Return true if the vertex, vertex normal and texture coordinates indices of a
+    // set of triangles refer to existing elements of a mesh. Vertex normal and texture
+    // coordinates indices may be Triangle::None.
+    bool are_valid_triangles(
+        const MeshObject*   object,
+        const uint32*       values,
+        const size_t        count,
+        const size_t        width)
+    {
+        const size_t vertex_count = object->get_vertex_count();
+        const size_t vertex_normal_count = object->get_vertex_normal_count();
+        const size_t tex_coords_count = object->get_tex_coords_count();
+
+        for (size_t i = 0; i < count; ++i, values += width)
+        {
+            for (size_t j = 0; j < 3; ++j)
+            {
+                if (values[j] >= vertex_count)
+                    return false;
+            }
+
+            if (width == 10)
+            {
+                for (size_t j = 3; j < 6; ++j)
+                {
+                    if (values[j] != Triangle::None && values[j] >= vertex_normal_count)
+                        return false;
+                }
+
+                for (size_t j = 6; j < 9; ++j)
+                {
+                    if (values[j] != Triangle::None && values[j] >= tex_coords_count)
+                        return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // Triangles are rows of 3 (vertex indices), 4 (vertex indices and primitive attribute
+    // index) or 10 (all Triangle fields) integers. The row width is the last extent of
+    // two-dimensional buffers, and 3 for flat buffers. Vertices, vertex normals and
+    // texture coordinates must be pushed before the triangles referring to them.
+    void push_triangle_array(MeshObject* object, const bpy::object& buffer)
+    {
+        const ScopedPyBuffer view(buffer.ptr());
+
+        const size_t width = view.get_dimension_count() == 2 ? view.get_extent(1) : 3;
+        if (width != 3 && width != 4 && width != 10)
+            raise_python_exception(PyExc_ValueError, "Triangles must have 3, 4 or 10 components.");
+
+        const size_t count = get_row_count(view, width);
+
+        bool valid;
+
+        {
+            ScopedGILUnlock unlock;
+            vector<uint32> scratch;
+            const uint32* values = view.get_items(scratch);
+
+            // Check all triangles before inserting any of them.
+            valid = are_valid_triangles(object, values, count, width);
+
+            if (valid)
+            {
+                object->reserve_triangles(object->get_triangle_count() + count);
+
+                for (size_t i = 0; i < count; ++i, values += width)
+                {
+                    switch (width)
+                    {
+                      case 3:
+                        object->push_triangle(Triangle(values[0], values[1], values[2]));
+                        break;
+
+                      case 4:
+                        object->push_triangle(Triangle(values[0], values[1], values[2], values[3]));
+                        break;
+
+                      case 10:
+                        object->push_triangle(
+                            Triangle(
+                                values[0], values[1], values[2],
+                                values[3], values[4], values[5],
+                                values[6], values[7], values[8],
+                                values[9]));
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (!valid)
+        {
+            raise_python_exception(
+                PyExc_IndexError,
+                "Invalid vertex, vertex normal or texture coordinates index in triangle.");
+        }
+    }
+
+    void check_motion_segment_index(const MeshObject* object, const size_t motion_segment_index)
+    {
+        if (motion_segment_index >= object->get_motion_segment_count())
+            raise_python_exception(PyExc_IndexError, "Invalid motion segment index.");
+    }
+
+    void set_vertex_pose_array(
+        MeshObject*         object,
+        const size_t        motion_segment_index,
+        const bpy::object&  buffer)
+    {
+        check_motion_segment_index(object, motion_segment_index);
+
+        const ScopedPyBuffer view(buffer.ptr());
+        const size_t count = object->get_vertex_count();
+
+        if (view.get_item_count() != 3 * count)
+            raise_python_exception(PyExc_ValueError, "The buffer must contain one pose per vertex.");
+
+        ScopedGILUnlock unlock;
+        vector<GScalar> scratch;
+        const GScalar* values = view.get_items(scratch);
+
+        for (size_t i = 0; i < count; ++i, values += 3)
+            object->set_vertex_pose(i, motion_segment_index, GVector3(values[0], values[1], values[2]));
+    }
+
+    bpy::object get_vertex_array(const MeshObject* object)
+    {
+        const size_t count = object->get_vertex_count();
+        bpy::object array = make_zero_array(get_scalar_typecode(), 3 * count);
+
+        {
+            ScopedPyBuffer view(array.ptr(), true);
+            ScopedGILUnlock unlock;
+            GScalar* values = static_cast<GScalar*>(view.get_data());
+
+            for (size_t i = 0; i < count; ++i, values += 3)
+            {
+                const GVector3& v = object->get_vertex(i);
+                values[0] = v[0];
+                values[1] = v[1];
+                values[2] = v[2];
+            }
+        }
+
+        return array;
+    }
+
+    bpy::object get_vertex_normal_array(const MeshObject* object)
+    {
+        const size_t count = object->get_vertex_normal_count();
+        bpy::object array = make_zero_array(get_scalar_typecode(), 3 * count);
+
+        {
+            ScopedPyBuffer view(array.ptr(), true);
+            ScopedGILUnlock unlock;
+            GScalar* values = static_cast<GScalar*>(view.get_data());
+
+            for (size_t i = 0; i < count; ++i, values += 3)
+            {
+                const GVector3& n = object->get_vertex_normal(i);
+                values[0] = n[0];
+                values[1] = n[1];
+                values[2] = n[2];
+            }
+        }
+
+        return array;
+    }
+
+    bpy::object get_tex_coords_array(const MeshObject* object)
+    {
+        const size_t count = object->get_tex_coords_count();
+        bpy::object array = make_zero_array(get_scalar_typecode(), 2 * count);
+
+        {
+            ScopedPyBuffer view(array.ptr(), true);
+            ScopedGILUnlock unlock;
+            GScalar* values = static_cast<GScalar*>(view.get_data());
+
+            for (size_t i = 0; i < count; ++i, values += 2)
+            {
+                const GVector2 uv = object->get_tex_coords(i);
+                values[0] = uv[0];
+                values[1] = uv[1];
+            }
+        }
+
+        return array;
+    }
+
+    // Triangles are returned as rows of 10 integers, in the order of the Triangle fields.
+    bpy::object get_triangle_array(const MeshObject* object)
+    {
+        const size_t count = object->get_triangle_count();
+        bpy::object array = make_zero_array(get_uint32_typecode(), 10 * count);
+
+        {
+            ScopedPyBuffer view(array.ptr(), true);
+            ScopedGILUnlock unlock;
+            uint32* values = static_cast<uint32*>(view.get_data());
+
+            for (size_t i = 0; i < count; ++i, values += 10)
+            {
+                const Triangle& t = object->get_triangle(i);
+                values[0] = t.m_v0;
+                values[1] = t.m_v1;
+                values[2] = t.m_v2;
+                values[3] = t.m_n0;
+                values[4] = t.m_n1;
+                values[5] = t.m_n2;
+                values[6] = t.m_a0;
+                values[7] = t.m_a1;
+                values[8] = t.m_a2;
+                values[9] = t.m_pa;
+            }
+        }
+
+        return array;
+    }
+
+    bpy::object get_vertex_pose_array(const MeshObject* object, const size_t motion_segment_index)
+    {
+        check_motion_segment_index(object, motion_segment_index);
+
+        const size_t count = object->get_vertex_count();
+        bpy::object array = make_zero_array(get_scalar_typecode(), 3 * count);
+
+        {
+            ScopedPyBuffer view(array.ptr(), true);
+            ScopedGILUnlock unlock;
+            GScalar* values = static_cast<GScalar*>(view.get_data());
+
+            for (size_t i = 0; i < count; ++i, values += 3)
+            {
+                const GVector3 v = object->get_vertex_pose(i, motion_segment_index);
+                values[0] = v[0];
+                values[1] = v[1];
+                values[2] = v[2];
+            }
+        }
+
+        return array;
+    }
+
     bpy::list read_mesh_objects(
         const bpy::list&    search_paths,
         const string&       base_object_name,
@@ -166,11 +492,15 @@ void bind_mesh_object()
         .def("push_vertex", &MeshObject::push_vertex)
         .def("get_vertex_count", &MeshObject::get_vertex_count)
         .def("get_vertex", &MeshObject::get_vertex, bpy::return_value_policy<bpy::reference_existing_object>())
+        .def("push_vertex_array", push_vertex_array)
+        .def("get_vertex_array", get_vertex_array)
 
         .def("reserve_vertex_normals", &MeshObject::reserve_vertex_normals)
         .def("push_vertex_normal", &MeshObject::push_vertex_normal)
         .def("get_vertex_normal_count", &MeshObject::get_vertex_normal_count)
         .def("get_vertex_normal", &MeshObject::get_vertex_normal, bpy::return_value_policy<bpy::reference_existing_object>())
+        .def("push_vertex_normal_array", push_vertex_normal_array)
+        .def("get_vertex_normal_array", get_vertex_normal_array)
 
         .def("reserve_vertex_tangents", &MeshObject::reserve_vertex_tangents)
         .def("push_vertex_tangent", &MeshObject::push_vertex_tangent)
@@ -181,18 +511,24 @@ void bind_mesh_object()
         .def("push_tex_coords", &MeshObject::push_tex_coords)
         .def("get_tex_coords_count", &MeshObject::get_tex_coords_count)
         .def("get_tex_coords", &MeshObject::get_tex_coords)
+        .def("push_tex_coords_array", push_tex_coords_array)
+        .def("get_tex_coords_array", get_tex_coords_array)
 
         .def("reserve_triangles", &MeshObject::reserve_triangles)
         .def("push_triangle", &MeshObject::push_triangle)
         .def("get_triangle_count", &MeshObject::get_triangle_count)
         .def("get_triangle", get_triangle, bpy::return_value_policy<bpy::reference_existing_object>())
         .def("set_triangle", set_triangle)
+        .def("push_triangle_array", push_triangle_array)
+        .def("get_triangle_array", get_triangle_array)
 
         .def("set_motion_segment_count", &MeshObject::set_motion_segment_count)
         .def("get_motion_segment_count", &MeshObject::get_motion_segment_count)
 
         .def("set_vertex_pose", &MeshObject::set_vertex_pose)
         .def("get_vertex_pose", &MeshObject::get_vertex_pose)
+        .def("set_vertex_pose_array", set_vertex_pose_array)
+        .def("get_vertex_pose_array", get_vertex_pose_array)
         .def("clear_vertex_poses", &MeshObject::clear_vertex_poses)
 
         .def("set_vertex_normal_pose", &MeshObject::set_vertex_normal_pose)
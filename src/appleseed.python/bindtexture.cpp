@@ -149,7 +149,8 @@ void bind_texture()
         .value("Bilinear", TextureFilteringBilinear)
         .value("Bicubic", TextureFilteringBicubic)
         .value("Feline", TextureFilteringFeline)
-        .value("EWA", TextureFilteringEWA);
+        .value("EWA", TextureFilteringEWA)
+        .value("Trilinear", TextureFilteringTrilinear);
 
     bpy::enum_<TextureAlphaMode>("TextureAlphaMode")
         .value("AlphaChannel", TextureAlphaModeAlphaChannel)
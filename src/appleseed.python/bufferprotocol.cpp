@@ -0,0 +1,225 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "bufferprotocol.h"
+
+// Standard headers.
+#include <cstring>
+
+namespace bpy = boost::python;
+using namespace foundation;
+
+namespace
+{
+    bool is_native_byte_order(const char c)
+    {
+        const uint16 one = 1;
+        const bool little_endian = *reinterpret_cast<const uint8*>(&one) == 1;
+
+        switch (c)
+        {
+          case '@':
+          case '=':
+            return true;
+
+          case '<':
+            return little_endian;
+
+          case '>':
+          case '!':
+            return !little_endian;
+
+          default:
+            return false;
+        }
+    }
+
+    // Parse a struct module format string describing a single native-endian number.
+    bool parse_format(
+        const char*                 format,
+        const size_t                item_size,
+        ScopedPyBuffer::ScalarKind& kind)
+    {
+        // A missing format means unsigned bytes.
+        if (format == nullptr)
+            format = "B";
+
+        if (*format != '\0' && std::strchr("@=<>!", *format) != nullptr)
+        {
+            if (!is_native_byte_order(*format))
+                return false;
+
+            ++format;
+        }
+
+        if (format[0] == '\0' || format[1] != '\0')
+            return false;
+
+        if (std::strchr("bhilq", format[0]) != nullptr)
+            kind = ScopedPyBuffer::SignedInt;
+        else if (std::strchr("BHILQ", format[0]) != nullptr)
+            kind = ScopedPyBuffer::UnsignedInt;
+        else if (std::strchr("fd", format[0]) != nullptr)
+            kind = ScopedPyBuffer::Float;
+        else return false;
+
+        return
+            kind == ScopedPyBuffer::Float
+                ? item_size == 4 || item_size == 8
+                : item_size == 1 || item_size == 2 || item_size == 4 || item_size == 8;
+    }
+
+#if PY_MAJOR_VERSION < 3
+    // Python 2 arrays only implement the old buffer interface.
+    bool get_py2_array_buffer(PyObject* obj, Py_buffer& view)
+    {
+        bpy::object array(bpy::handle<>(bpy::borrowed(obj)));
+
+        if (!PyObject_HasAttrString(obj, "buffer_info") || !PyObject_HasAttrString(obj, "typecode"))
+            return false;
+
+        const bpy::object info = array.attr("buffer_info")();
+        const size_t item_size = bpy::extract<size_t>(array.attr("itemsize"));
+        const size_t address = bpy::extract<size_t>(info[0]);
+        const size_t count = bpy::extract<size_t>(info[1]);
+
+        // Single-character strings are cached by the interpreter and outlive the view.
+        const bpy::object typecode = array.attr("typecode");
+
+        std::memset(&view, 0, sizeof(view));
+        view.buf = reinterpret_cast<void*>(address);
+        view.obj = bpy::incref(obj);
+        view.len = static_cast<Py_ssize_t>(count * item_size);
+        view.itemsize = static_cast<Py_ssize_t>(item_size);
+        view.format = PyString_AsString(typecode.ptr());
+        view.ndim = 1;
+
+        return true;
+    }
+#endif
+}
+
+
+//
+// ScopedPyBuffer class implementation.
+//
+
+ScopedPyBuffer::ScopedPyBuffer(PyObject* obj, const bool writable)
+{
+    const int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+
+    if (PyObject_GetBuffer(obj, &m_view, flags) != 0)
+    {
+#if PY_MAJOR_VERSION < 3
+        PyErr_Clear();
+
+        if (!get_py2_array_buffer(obj, m_view))
+            raise_python_exception(PyExc_TypeError, "Object does not support the buffer protocol.");
+#else
+        bpy::throw_error_already_set();
+#endif
+    }
+
+    if (!parse_format(m_view.format, static_cast<size_t>(m_view.itemsize), m_kind))
+    {
+        PyBuffer_Release(&m_view);
+        raise_python_exception(
+            PyExc_TypeError,
+            "Incompatible buffer type. Only native-endian integers and floating-point numbers.");
+    }
+}
+
+ScopedPyBuffer::~ScopedPyBuffer()
+{
+    PyBuffer_Release(&m_view);
+}
+
+
+//
+// Free functions implementation.
+//
+
+void raise_python_exception(PyObject* type, const char* message)
+{
+    PyErr_SetString(type, message);
+    bpy::throw_error_already_set();
+}
+
+bpy::object make_memoryview(
+    const bpy::object&  owner,
+    void*               data,
+    const size_t        size,
+    const char*         format,
+    const size_t        item_size,
+    const bool          readonly)
+{
+    Py_buffer view;
+    PyBuffer_FillInfo(
+        &view,
+        nullptr,
+        data,
+        static_cast<Py_ssize_t>(size),
+        readonly ? 1 : 0,
+        PyBUF_CONTIG);
+
+    Py_ssize_t shape = static_cast<Py_ssize_t>(size / item_size);
+    view.format = const_cast<char*>(format);
+    view.itemsize = static_cast<Py_ssize_t>(item_size);
+    view.ndim = 1;
+    view.shape = &shape;
+    view.strides = nullptr;
+
+#if PY_MAJOR_VERSION < 3
+    // The memoryview releases (and decrefs) the exporting object of the buffer.
+    view.obj = bpy::incref(owner.ptr());
+#endif
+
+    bpy::object memoryview(bpy::handle<>(PyMemoryView_FromBuffer(&view)));
+
+#if PY_MAJOR_VERSION >= 3
+    // Python 3 memoryviews created from a raw buffer don't reference any object.
+    if (bpy::objects::make_nurse_and_patient(memoryview.ptr(), owner.ptr()) == nullptr)
+        bpy::throw_error_already_set();
+#endif
+
+    return memoryview;
+}
+
+bpy::object make_zero_array(
+    const char*         typecode,
+    const size_t        count)
+{
+    const bpy::object array_module(bpy::handle<>(PyImport_ImportModule("array")));
+
+    bpy::list zero;
+    zero.append(0);
+
+    // Repeating a one-item array is done with a single allocation.
+    return array_module.attr("array")(typecode, zero) * count;
+}
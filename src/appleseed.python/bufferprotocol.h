@@ -0,0 +1,220 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/python.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+//
+// Helpers to exchange bulk data with Python through the buffer protocol.
+//
+// Any object exporting C-contiguous native-endian numbers (numpy arrays,
+// array.array, memoryview, bytearray...) can be read without intermediate
+// Python objects, and data owned by appleseed can be exposed as memoryviews.
+//
+
+// A scoped request for the contiguous buffer of a Python object.
+// Raises a Python TypeError if the object doesn't export a buffer of numbers.
+class ScopedPyBuffer
+  : public foundation::NonCopyable
+{
+  public:
+    enum ScalarKind
+    {
+        SignedInt,
+        UnsignedInt,
+        Float
+    };
+
+    // Constructor. Must be called with the GIL held.
+    explicit ScopedPyBuffer(PyObject* obj, const bool writable = false);
+
+    // Destructor. Must be called with the GIL held.
+    ~ScopedPyBuffer();
+
+    // Return the number of dimensions and the extent of a given dimension.
+    size_t get_dimension_count() const;
+    size_t get_extent(const size_t dim) const;
+
+    // Return the number of scalars in the buffer.
+    size_t get_item_count() const;
+
+    ScalarKind get_scalar_kind() const;
+    size_t get_item_size() const;
+
+    const void* get_data() const;
+    void* get_data();
+
+    // Return a pointer to the scalars of the buffer converted to T. If the buffer
+    // already holds values of type T, no copy is made and scratch is left untouched.
+    // The GIL does not need to be held.
+    template <typename T>
+    const T* get_items(std::vector<T>& scratch) const;
+
+  private:
+    Py_buffer   m_view;
+    ScalarKind  m_kind;
+
+    template <typename T>
+    bool has_type() const;
+
+    template <typename T, typename U>
+    static void convert(const void* src, const size_t count, T* dest);
+};
+
+// Raise a Python exception of a given type and throw boost::python::error_already_set.
+void raise_python_exception(PyObject* type, const char* message);
+
+// Create a one-dimensional memoryview over memory owned by a C++ object.
+// format is a struct module format string and must have static storage.
+// The owner object is kept alive as long as the memoryview exists.
+boost::python::object make_memoryview(
+    const boost::python::object&    owner,
+    void*                           data,
+    const size_t                    size,
+    const char*                     format,
+    const size_t                    item_size,
+    const bool                      readonly);
+
+// Create an array.array of a given type code, initialized with count zeros.
+boost::python::object make_zero_array(
+    const char*                     typecode,
+    const size_t                    count);
+
+
+//
+// ScopedPyBuffer class implementation.
+//
+
+inline size_t ScopedPyBuffer::get_dimension_count() const
+{
+    return static_cast<size_t>(m_view.ndim);
+}
+
+inline size_t ScopedPyBuffer::get_extent(const size_t dim) const
+{
+    return
+        m_view.shape != nullptr && dim < get_dimension_count()
+            ? static_cast<size_t>(m_view.shape[dim])
+            : get_item_count();
+}
+
+inline size_t ScopedPyBuffer::get_item_count() const
+{
+    return static_cast<size_t>(m_view.len / m_view.itemsize);
+}
+
+inline ScopedPyBuffer::ScalarKind ScopedPyBuffer::get_scalar_kind() const
+{
+    return m_kind;
+}
+
+inline size_t ScopedPyBuffer::get_item_size() const
+{
+    return static_cast<size_t>(m_view.itemsize);
+}
+
+inline const void* ScopedPyBuffer::get_data() const
+{
+    return m_view.buf;
+}
+
+inline void* ScopedPyBuffer::get_data()
+{
+    return m_view.buf;
+}
+
+template <typename T>
+const T* ScopedPyBuffer::get_items(std::vector<T>& scratch) const
+{
+    if (has_type<T>())
+        return static_cast<const T*>(m_view.buf);
+
+    const size_t count = get_item_count();
+    scratch.resize(count);
+
+    switch (m_kind)
+    {
+      case SignedInt:
+        switch (m_view.itemsize)
+        {
+          case 1: convert<T, foundation::int8>(m_view.buf, count, scratch.data()); break;
+          case 2: convert<T, foundation::int16>(m_view.buf, count, scratch.data()); break;
+          case 4: convert<T, foundation::int32>(m_view.buf, count, scratch.data()); break;
+          case 8: convert<T, foundation::int64>(m_view.buf, count, scratch.data()); break;
+        }
+        break;
+
+      case UnsignedInt:
+        switch (m_view.itemsize)
+        {
+          case 1: convert<T, foundation::uint8>(m_view.buf, count, scratch.data()); break;
+          case 2: convert<T, foundation::uint16>(m_view.buf, count, scratch.data()); break;
+          case 4: convert<T, foundation::uint32>(m_view.buf, count, scratch.data()); break;
+          case 8: convert<T, foundation::uint64>(m_view.buf, count, scratch.data()); break;
+        }
+        break;
+
+      case Float:
+        switch (m_view.itemsize)
+        {
+          case 4: convert<T, float>(m_view.buf, count, scratch.data()); break;
+          case 8: convert<T, double>(m_view.buf, count, scratch.data()); break;
+        }
+        break;
+    }
+
+    return scratch.data();
+}
+
+template <typename T>
+inline bool ScopedPyBuffer::has_type() const
+{
+    const ScalarKind kind =
+        T(0.5) != T(0) ? Float :
+        T(-1) < T(0) ? SignedInt :
+        UnsignedInt;
+
+    return kind == m_kind && sizeof(T) == get_item_size();
+}
+
+template <typename T, typename U>
+void ScopedPyBuffer::convert(const void* src, const size_t count, T* dest)
+{
+    const U* typed_src = static_cast<const U*>(src);
+
+    for (size_t i = 0; i < count; ++i)
+        dest[i] = static_cast<T>(typed_src[i]);
+}
@@ -0,0 +1,137 @@
+
+#
+# This source file is part of appleseed.
+# Visit https://appleseedhq.net/ for additional information and resources.
+#
+# This software is released under the MIT license.
+#
+# Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+
+
+import array
+import unittest
+import appleseed as asr
+
+
+class TestMeshObject(unittest.TestCase):
+    """
+    Test bulk transfer of mesh geometry through the buffer protocol.
+    """
+
+    def setUp(self):
+        self.mesh = asr.MeshObject("mesh", {})
+
+    def test_vertex_array_roundtrip(self):
+        vertices = array.array('f', [0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0])
+        self.mesh.push_vertex_array(vertices)
+
+        self.assertEqual(self.mesh.get_vertex_count(), 3)
+        self.assertEqual(self.mesh.get_vertex_array(), vertices)
+
+    def test_vertex_array_conversion(self):
+        self.mesh.push_vertex_array(array.array('d', [1.0, 2.0, 3.0]))
+        self.mesh.push_vertex_array(array.array('i', [4, 5, 6]))
+
+        self.assertEqual(self.mesh.get_vertex_array(), array.array('f', [1.0, 2.0, 3.0, 4.0, 5.0, 6.0]))
+
+    def test_tex_coords_array_roundtrip(self):
+        tex_coords = array.array('f', [0.0, 0.0, 1.0, 0.0, 0.0, 1.0])
+        self.mesh.push_tex_coords_array(tex_coords)
+
+        self.assertEqual(self.mesh.get_tex_coords_count(), 3)
+        self.assertEqual(self.mesh.get_tex_coords_array(), tex_coords)
+
+    def test_triangle_array_roundtrip(self):
+        self.mesh.push_vertex_array(array.array('f', [0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0]))
+        self.mesh.push_triangle_array(array.array('I', [0, 1, 2, 2, 1, 0]))
+
+        triangles = self.mesh.get_triangle_array()
+
+        self.assertEqual(self.mesh.get_triangle_count(), 2)
+        self.assertEqual(len(triangles), 20)
+        self.assertEqual(list(triangles[0:3]), [0, 1, 2])
+        self.assertEqual(list(triangles[10:13]), [2, 1, 0])
+        self.assertEqual(triangles[3], self.mesh.get_triangle(0).m_n0)
+
+    def test_triangle_array_with_invalid_vertex_index_raises(self):
+        self.mesh.push_vertex_array(array.array('f', [0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0]))
+
+        with self.assertRaises(IndexError):
+            self.mesh.push_triangle_array(array.array('I', [0, 1, 2, 0, 1, 3]))
+
+        self.assertEqual(self.mesh.get_triangle_count(), 0)
+
+    def test_vertex_pose_array_roundtrip(self):
+        self.mesh.push_vertex_array(array.array('f', [0.0, 0.0, 0.0, 1.0, 1.0, 1.0]))
+        self.mesh.set_motion_segment_count(1)
+
+        poses = array.array('f', [0.5, 0.5, 0.5, 1.5, 1.5, 1.5])
+        self.mesh.set_vertex_pose_array(0, poses)
+
+        self.assertEqual(self.mesh.get_vertex_pose_array(0), poses)
+
+    def test_incomplete_vertex_array_raises(self):
+        with self.assertRaises(ValueError):
+            self.mesh.push_vertex_array(array.array('f', [0.0, 0.0]))
+
+    def test_non_numeric_buffer_raises(self):
+        with self.assertRaises(TypeError):
+            self.mesh.push_vertex_array([0.0, 0.0, 0.0])
+
+    def tearDown(self):
+        pass
+
+
+class TestImageStorageView(unittest.TestCase):
+    """
+    Test direct access to tile and image pixels through memoryview objects.
+    """
+
+    def test_tile_storage_view_writes_to_tile(self):
+        tile = asr.Tile(2, 2, 4, asr.PixelFormat.Float)
+        view = tile.get_storage_view()
+
+        self.assertEqual(len(view), 16)
+
+        view[5] = 1.5
+
+        self.assertEqual(tile.get_storage()[5], 1.5)
+
+    def test_image_tile_storage_view_writes_to_image_tile(self):
+        frame = asr.Frame("beauty", {"resolution": "4 4", "tile_size": "2 2"})
+        image = frame.image()
+        view = image.get_tile_storage_view(1, 1)
+
+        self.assertEqual(len(view), 2 * 2 * image.properties().m_channel_count)
+
+        view[0] = 0.25
+
+        self.assertEqual(image.tile(1, 1).get_storage()[0], 0.25)
+
+    def test_image_tile_storage_view_with_invalid_tile_coordinates_raises(self):
+        frame = asr.Frame("beauty", {"resolution": "4 4", "tile_size": "2 2"})
+
+        with self.assertRaises(IndexError):
+            frame.image().get_tile_storage_view(2, 0)
+
+if __name__ == "__main__":
+    unittest.main()
@@ -130,6 +130,7 @@ void ApplicationSettingsWindow::load_settings()
     m_ui->combobox_sampling_mode->setCurrentIndex(
         sampling_mode == "rng" ? 0 :
         sampling_mode == "qmc" ? 1 :
+        sampling_mode == "sobol" ? 2 :
         1);     // qmc if an unknown value was found
 
     // Rendering threads.
@@ -180,8 +181,11 @@ void ApplicationSettingsWindow::save_settings()
                                    "fatal");
 
     // Sampling mode.
+    const auto sampler_index = m_ui->combobox_sampling_mode->currentIndex();
     m_settings.insert_path(SETTINGS_SAMPLING_MODE,
-        m_ui->combobox_sampling_mode->currentIndex() == 0 ? "rng" : "qmc");
+        sampler_index == 0 ? "rng" :
+        sampler_index == 2 ? "sobol" :
+                             "qmc");
 
     // Rendering threads.
     string rendering_threads_str;
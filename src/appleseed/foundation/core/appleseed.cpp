@@ -113,6 +113,10 @@ namespace
             sstr << "AVX ";
 #endif
 
+#ifdef APPLESEED_USE_AVX2
+            sstr << "AVX2 ";
+#endif
+
 #ifdef APPLESEED_USE_F16C
             sstr << "F16C ";
 #endif
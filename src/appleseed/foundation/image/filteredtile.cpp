@@ -36,9 +36,20 @@
 #include "foundation/math/vector.h"
 #include "foundation/platform/atomic.h"
 
+// Standard headers.
+#include <algorithm>
+
+using namespace std;
+
 namespace foundation
 {
 
+namespace
+{
+    // Maximum number of pixels whose filter weights are evaluated at once.
+    const int MaxSplatSpan = 16;
+}
+
 //
 // We use the discrete-to-continuous mapping described in:
 //
@@ -60,6 +71,7 @@ FilteredTile::FilteredTile(
   : Tile(width, height, channel_count + 1, PixelFormatFloat)
   , m_crop_window(Vector2u(0, 0), Vector2u(width - 1, height - 1))
   , m_filter(filter)
+  , m_splat_row(get_splat_row_func())
 {
 }
 
@@ -72,6 +84,7 @@ FilteredTile::FilteredTile(
   : Tile(width, height, channel_count + 1, PixelFormatFloat)
   , m_crop_window(crop_window)
   , m_filter(filter)
+  , m_splat_row(get_splat_row_func())
 {
 }
 
@@ -109,15 +122,19 @@ void FilteredTile::add(
 
     for (int ry = footprint.min.y; ry <= footprint.max.y; ++ry)
     {
-        float* APPLESEED_RESTRICT ptr = reinterpret_cast<float*>(pixel(footprint.min.x, ry));
+        float* ptr = reinterpret_cast<float*>(pixel(footprint.min.x, ry));
 
-        for (int rx = footprint.min.x; rx <= footprint.max.x; ++rx)
+        for (int rx = footprint.min.x; rx <= footprint.max.x; )
         {
-            const float weight = m_filter.evaluate(rx - dx, ry - dy);
-            *ptr++ += weight;
-
-            for (size_t i = 0, e = m_channel_count - 1; i < e; ++i)
-                *ptr++ += values[i] * weight;
+            // Evaluate the filter over a span of pixels, then splat the sample into them.
+            float weights[MaxSplatSpan];
+            const int span_end = min(rx + MaxSplatSpan - 1, footprint.max.x);
+            size_t span_width = 0;
+            for (; rx <= span_end; ++rx)
+                weights[span_width++] = m_filter.evaluate(rx - dx, ry - dy);
+
+            m_splat_row(ptr, weights, span_width, values, m_channel_count - 1);
+            ptr += span_width * m_channel_count;
         }
     }
 }
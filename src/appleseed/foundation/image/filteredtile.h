@@ -30,6 +30,7 @@
 #pragma once
 
 // appleseed.foundation headers.
+#include "foundation/image/filteredtilekernels.h"
 #include "foundation/image/tile.h"
 #include "foundation/math/aabb.h"
 #include "foundation/math/filter.h"
@@ -134,6 +135,7 @@ class FilteredTile
   protected:
     const AABB2u            m_crop_window;
     const Filter2f&         m_filter;
+    const SplatRowFunc      m_splat_row;
 };
 
 
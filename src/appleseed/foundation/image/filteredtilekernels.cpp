@@ -0,0 +1,89 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "filteredtilekernels.h"
+
+// appleseed.foundation headers.
+#include "foundation/platform/compiler.h"
+#include "foundation/utility/otherwise.h"
+
+namespace foundation
+{
+
+// Defined in filteredtilekernels_avx2.cpp.
+SplatRowFunc get_splat_row_func_avx2();
+
+namespace
+{
+    void splat_row_generic(
+        float*                  pixels,
+        const float*            weights,
+        const size_t            pixel_count,
+        const float*            values,
+        const size_t            value_count)
+    {
+        float* APPLESEED_RESTRICT ptr = pixels;
+
+        for (size_t i = 0; i < pixel_count; ++i)
+        {
+            const float weight = weights[i];
+            *ptr++ += weight;
+
+            for (size_t c = 0; c < value_count; ++c)
+                *ptr++ += values[c] * weight;
+        }
+    }
+
+    SplatRowFunc select_splat_row_func()
+    {
+        const SplatRowFunc func = get_splat_row_func(get_host_instruction_set());
+        return func != nullptr ? func : splat_row_generic;
+    }
+}
+
+SplatRowFunc get_splat_row_func(const InstructionSet isa)
+{
+    switch (isa)
+    {
+      case InstructionSet::Generic: return splat_row_generic;
+      case InstructionSet::AVX2:    return get_splat_row_func_avx2();
+      assert_otherwise;
+    }
+
+    // Keep the compiler happy.
+    return nullptr;
+}
+
+SplatRowFunc get_splat_row_func()
+{
+    static const SplatRowFunc func = select_splat_row_func();
+    return func;
+}
+
+}   // namespace foundation
@@ -0,0 +1,70 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/platform/cpudispatch.h"
+
+// appleseed.main headers.
+#include "main/dllsymbol.h"
+
+// Standard headers.
+#include <cstddef>
+
+namespace foundation
+{
+
+//
+// Kernels used by foundation::FilteredTile to splat samples into a row of pixels.
+//
+// Pixels are made of a weight channel followed by value_count value channels.
+// For each pixel i in [0, pixel_count), the kernel performs:
+//
+//   pixels[i * (value_count + 1)]         += weights[i]
+//   pixels[i * (value_count + 1) + 1 + c] += weights[i] * values[c]
+//
+// These kernels are compiled for several instruction sets and selected at run time
+// (see foundation/platform/cpudispatch.h).
+//
+
+typedef void (*SplatRowFunc)(
+    float*                  pixels,
+    const float*            weights,
+    const size_t            pixel_count,
+    const float*            values,
+    const size_t            value_count);
+
+// Return the kernel for a given instruction set, or nullptr if this kernel
+// was not compiled for this instruction set.
+APPLESEED_DLLSYMBOL SplatRowFunc get_splat_row_func(const InstructionSet isa);
+
+// Return the best kernel supported by the host CPU.
+APPLESEED_DLLSYMBOL SplatRowFunc get_splat_row_func();
+
+}   // namespace foundation
@@ -0,0 +1,116 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//
+// This file is compiled with AVX2 code generation enabled regardless of the instruction
+// sets enabled for the rest of the library (see src/appleseed/CMakeLists.txt). The code
+// in this file is only executed if the host CPU supports this instruction set.
+//
+// Fused multiply-adds are deliberately avoided: multiplications and additions are rounded
+// separately, exactly like in the generic kernel, so that every host produces the same
+// pixels regardless of the kernel it selects.
+//
+// It must not include headers defining inline functions or templates that are also used
+// elsewhere in the library: the linker could pick the copy compiled here for all callers,
+// which would crash on CPUs lacking AVX2.
+//
+
+// Interface header.
+#include "filteredtilekernels.h"
+
+// x86 intrinsics headers.
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace foundation
+{
+
+#ifdef __AVX2__
+
+namespace
+{
+    void splat_row_avx2(
+        float*                  pixels,
+        const float*            weights,
+        const size_t            pixel_count,
+        const float*            values,
+        const size_t            value_count)
+    {
+        float* ptr = pixels;
+
+        for (size_t i = 0; i < pixel_count; ++i)
+        {
+            const float weight = weights[i];
+            *ptr++ += weight;
+
+            const __m256 mweight8 = _mm256_set1_ps(weight);
+            size_t c = 0;
+
+            for (; c + 8 <= value_count; c += 8)
+            {
+                _mm256_storeu_ps(
+                    ptr + c,
+                    _mm256_add_ps(
+                        _mm256_loadu_ps(ptr + c),
+                        _mm256_mul_ps(_mm256_loadu_ps(values + c), mweight8)));
+            }
+
+            if (c + 4 <= value_count)
+            {
+                _mm_storeu_ps(
+                    ptr + c,
+                    _mm_add_ps(
+                        _mm_loadu_ps(ptr + c),
+                        _mm_mul_ps(_mm_loadu_ps(values + c), _mm256_castps256_ps128(mweight8))));
+                c += 4;
+            }
+
+            for (; c < value_count; ++c)
+                ptr[c] += values[c] * weight;
+
+            ptr += value_count;
+        }
+    }
+}
+
+SplatRowFunc get_splat_row_func_avx2()
+{
+    return splat_row_avx2;
+}
+
+#else
+
+SplatRowFunc get_splat_row_func_avx2()
+{
+    return nullptr;
+}
+
+#endif
+
+}   // namespace foundation
@@ -0,0 +1,156 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "mipmap.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/tile.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+namespace foundation
+{
+
+namespace
+{
+    CanvasProperties get_next_mipmap_level_properties(const CanvasProperties& props)
+    {
+        return
+            CanvasProperties(
+                (props.m_canvas_width + 1) / 2,
+                (props.m_canvas_height + 1) / 2,
+                props.m_tile_width,
+                props.m_tile_height,
+                props.m_channel_count,
+                props.m_pixel_format);
+    }
+}
+
+size_t get_mipmap_level_count(const CanvasProperties& props)
+{
+    size_t width = props.m_canvas_width;
+    size_t height = props.m_canvas_height;
+    size_t level_count = 1;
+
+    while (width > 1 || height > 1)
+    {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        ++level_count;
+    }
+
+    return level_count;
+}
+
+CanvasProperties get_mipmap_level_properties(
+    const CanvasProperties& props,
+    const size_t            level)
+{
+    CanvasProperties level_props = props;
+
+    for (size_t i = 0; i < level; ++i)
+        level_props = get_next_mipmap_level_properties(level_props);
+
+    return level_props;
+}
+
+Tile* create_mipmap_tile(
+    const CanvasProperties& parent_props,
+    const size_t            tile_x,
+    const size_t            tile_y,
+    const Tile* const       parent_tiles[4])
+{
+    const CanvasProperties props = get_next_mipmap_level_properties(parent_props);
+    assert(tile_x < props.m_tile_count_x);
+    assert(tile_y < props.m_tile_count_y);
+
+    const size_t tile_width = props.get_tile_width(tile_x);
+    const size_t tile_height = props.get_tile_height(tile_y);
+    const size_t channel_count = parent_props.m_channel_count;
+
+    // Pixel coordinates of the origin of the 2x2 parent tiles.
+    const size_t parent_origin_x = 2 * tile_x * parent_props.m_tile_width;
+    const size_t parent_origin_y = 2 * tile_y * parent_props.m_tile_height;
+
+    Tile* tile =
+        new Tile(
+            tile_width,
+            tile_height,
+            channel_count,
+            parent_props.m_pixel_format);
+
+    for (size_t y = 0; y < tile_height; ++y)
+    {
+        // Coordinates of the two rows of parent pixels, relative to the parent tiles.
+        const size_t parent_y0 = 2 * (tile_y * props.m_tile_height + y) - parent_origin_y;
+        const size_t parent_y1 = min(parent_origin_y + parent_y0 + 1, parent_props.m_canvas_height - 1) - parent_origin_y;
+
+        for (size_t x = 0; x < tile_width; ++x)
+        {
+            // Coordinates of the two columns of parent pixels, relative to the parent tiles.
+            const size_t parent_x0 = 2 * (tile_x * props.m_tile_width + x) - parent_origin_x;
+            const size_t parent_x1 = min(parent_origin_x + parent_x0 + 1, parent_props.m_canvas_width - 1) - parent_origin_x;
+
+            const size_t xs[2] = { parent_x0, parent_x1 };
+            const size_t ys[2] = { parent_y0, parent_y1 };
+
+            for (size_t c = 0; c < channel_count; ++c)
+            {
+                float sum = 0.0f;
+
+                for (size_t j = 0; j < 2; ++j)
+                {
+                    const size_t ty = ys[j] / parent_props.m_tile_height;
+                    const size_t py = ys[j] - ty * parent_props.m_tile_height;
+
+                    for (size_t i = 0; i < 2; ++i)
+                    {
+                        const size_t tx = xs[i] / parent_props.m_tile_width;
+                        const size_t px = xs[i] - tx * parent_props.m_tile_width;
+
+                        const Tile* parent_tile = parent_tiles[ty * 2 + tx];
+                        assert(parent_tile);
+
+                        sum += parent_tile->get_component<float>(px, py, c);
+                    }
+                }
+
+                tile->set_component(x, y, c, 0.25f * sum);
+            }
+        }
+    }
+
+    return tile;
+}
+
+}   // namespace foundation
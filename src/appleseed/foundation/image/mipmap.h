@@ -0,0 +1,73 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/image/canvasproperties.h"
+
+// appleseed.main headers.
+#include "main/dllsymbol.h"
+
+// Standard headers.
+#include <cstddef>
+
+// Forward declarations.
+namespace foundation    { class Tile; }
+
+namespace foundation
+{
+
+//
+// Mipmap pyramids.
+//
+// Level 0 is the canvas itself. Each subsequent level is half the size of the
+// previous one, rounded up, until the level is a single pixel. All levels share
+// the tile size of the canvas, so that each tile of a level covers at most 2x2
+// tiles of the previous, finer level.
+//
+
+// Return the number of levels of the mipmap pyramid of a canvas, including the canvas itself.
+APPLESEED_DLLSYMBOL size_t get_mipmap_level_count(const CanvasProperties& props);
+
+// Return the properties of a given level of the mipmap pyramid of a canvas.
+APPLESEED_DLLSYMBOL CanvasProperties get_mipmap_level_properties(
+    const CanvasProperties& props,
+    const size_t            level);
+
+// Create a tile of a mipmap level by box-filtering the finer level. `parent_props` are
+// the properties of the finer level and `parent_tiles` the 2x2 tiles of the finer level
+// covered by the new tile, in the order (0, 0), (1, 0), (0, 1), (1, 1). Parent tiles
+// lying outside of the finer level are not accessed and may be null.
+APPLESEED_DLLSYMBOL Tile* create_mipmap_tile(
+    const CanvasProperties& parent_props,
+    const size_t            tile_x,
+    const size_t            tile_y,
+    const Tile* const       parent_tiles[4]);
+
+}   // namespace foundation
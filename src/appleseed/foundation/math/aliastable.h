@@ -0,0 +1,360 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/fp.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace foundation
+{
+
+//
+// Discrete distribution sampled in constant time using Walker's alias method.
+//
+// AliasTable exposes the same interface as foundation::CDF and can be used
+// as a drop-in replacement wherever sampling cost matters more than the
+// monotonicity of the mapping from sample to item: unlike CDF::sample(),
+// nearby values of x do not map to nearby items.
+//
+// The table is built with Vose's O(n) algorithm.
+//
+// References:
+//
+//   A. J. Walker, An Efficient Method for Generating Discrete Random Variables
+//   with General Distributions, ACM TOMS 3(3), 1977.
+//
+//   M. D. Vose, A Linear Algorithm for Generating Random Numbers with a Given
+//   Distribution, IEEE TSE 17(9), 1991.
+//
+
+template <typename Item, typename Weight>
+class AliasTable
+  : public NonCopyable
+{
+  public:
+    typedef std::pair<Item, Weight> ItemWeightPair;
+
+    // Constructor.
+    AliasTable();
+
+    // Return true if the table is empty.
+    bool empty() const;
+
+    // Return true if the table has at least one item with a positive weight.
+    bool valid() const;
+
+    // Return the number of items in the table.
+    size_t size() const;
+
+    // Return the sum of the weight of all inserted items.
+    Weight weight() const;
+
+    // Remove all items from the table.
+    void clear();
+
+    // Allocate memory for a given number of items.
+    void reserve(const size_t count);
+
+    // Insert an item with a given non-negative weight.
+    void insert(const Item& item, const Weight weight);
+
+    // Access the i'th item. Weights are normalized once prepare() has been called.
+    const ItemWeightPair& operator[](const size_t i) const;
+
+    // Prepare the table for sampling.
+    // This method must be called once and only once before sample() is called.
+    void prepare();
+
+    // Sample the table. x is in [0,1).
+    // The choice between a bin's item and its alias is made with the bits of x
+    // left over after selecting the bin: with single precision weights and large
+    // tables, use the two-sample variant below instead.
+    const ItemWeightPair& sample(const Weight x) const;
+
+    // Sample the table. x is in [0,1) and selects a bin, y is in [0,1) and chooses
+    // between the bin's item and its alias. On return, y is remapped to a uniform
+    // sample in [0,1) that can be reused by the caller.
+    const ItemWeightPair& sample(const Weight x, Weight& y) const;
+
+    // Sample the table. x is in [0,1). On return, y is a uniform sample in [0,1) made
+    // of the bits of x left over after selecting the item, independent of that choice.
+    const ItemWeightPair& sample_and_remap(const Weight x, Weight& y) const;
+
+  private:
+    struct Bin
+    {
+        Weight          m_threshold;    // probability of keeping this bin's own item
+        uint32          m_alias;        // index of the item chosen otherwise
+    };
+
+    typedef std::vector<ItemWeightPair> ItemVector;
+    typedef std::vector<Bin> BinVector;
+
+    ItemVector          m_items;
+    Weight              m_weight_sum;
+    BinVector           m_bins;
+
+    size_t select_bin(const double scaled) const;
+};
+
+
+//
+// AliasTable class implementation.
+//
+
+template <typename Item, typename Weight>
+inline AliasTable<Item, Weight>::AliasTable()
+  : m_weight_sum(0.0)
+{
+}
+
+template <typename Item, typename Weight>
+inline bool AliasTable<Item, Weight>::empty() const
+{
+    return m_items.empty();
+}
+
+template <typename Item, typename Weight>
+inline bool AliasTable<Item, Weight>::valid() const
+{
+    return m_weight_sum > Weight(0.0);
+}
+
+template <typename Item, typename Weight>
+inline size_t AliasTable<Item, Weight>::size() const
+{
+    return m_items.size();
+}
+
+template <typename Item, typename Weight>
+inline Weight AliasTable<Item, Weight>::weight() const
+{
+    return m_weight_sum;
+}
+
+template <typename Item, typename Weight>
+inline void AliasTable<Item, Weight>::clear()
+{
+    m_items.clear();
+    m_bins.clear();
+    m_weight_sum = Weight(0.0);
+}
+
+template <typename Item, typename Weight>
+inline void AliasTable<Item, Weight>::reserve(const size_t count)
+{
+    m_items.reserve(count);
+}
+
+template <typename Item, typename Weight>
+inline void AliasTable<Item, Weight>::insert(const Item& item, const Weight weight)
+{
+    assert(weight >= Weight(0.0));
+    m_items.push_back(std::make_pair(item, weight));
+    m_weight_sum += weight;
+}
+
+template <typename Item, typename Weight>
+inline const std::pair<Item, Weight>& AliasTable<Item, Weight>::operator[](const size_t i) const
+{
+    assert(i < m_items.size());
+    return m_items[i];
+}
+
+template <typename Item, typename Weight>
+void AliasTable<Item, Weight>::prepare()
+{
+    assert(valid());
+
+    const size_t item_count = m_items.size();
+    assert(item_count <= 0xFFFFFFFFu);
+
+    // Normalize weights so that they add up to 1.0.
+    const Weight rcp_weight_sum = Weight(1.0) / m_weight_sum;
+    for (size_t i = 0; i < item_count; ++i)
+        m_items[i].second *= rcp_weight_sum;
+
+    // Scale probabilities so that the average bin holds exactly 1.0.
+    // Work in double precision to limit the accumulation of rounding errors.
+    std::vector<double> thresholds(item_count);
+    std::vector<size_t> small, large;
+    small.reserve(item_count);
+    large.reserve(item_count);
+    m_bins.resize(item_count);
+    for (size_t i = 0; i < item_count; ++i)
+    {
+        thresholds[i] = static_cast<double>(m_items[i].second) * item_count;
+        m_bins[i].m_alias = static_cast<uint32>(i);
+        (thresholds[i] < 1.0 ? small : large).push_back(i);
+    }
+
+    // Pair each underfull bin with an overfull one.
+    while (!small.empty() && !large.empty())
+    {
+        const size_t s = small.back();
+        small.pop_back();
+        const size_t l = large.back();
+
+        m_bins[s].m_alias = static_cast<uint32>(l);
+        thresholds[l] -= 1.0 - thresholds[s];
+
+        if (thresholds[l] < 1.0)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // Remaining bins are full up to numerical errors.
+    for (size_t i = 0, e = large.size(); i < e; ++i)
+        thresholds[large[i]] = 1.0;
+    for (size_t i = 0, e = small.size(); i < e; ++i)
+        thresholds[small[i]] = 1.0;
+
+    for (size_t i = 0; i < item_count; ++i)
+        m_bins[i].m_threshold = static_cast<Weight>(thresholds[i]);
+
+    // Rounding errors may leave bins of zero-weight items in the small list;
+    // make sure they always defer to an item that can actually be chosen.
+    size_t fallback = item_count;
+    for (size_t i = 0; i < item_count; ++i)
+    {
+        if (m_items[i].second == Weight(0.0) && m_bins[i].m_alias == i)
+        {
+            if (fallback == item_count)
+            {
+                fallback = 0;
+                while (m_items[fallback].second == Weight(0.0))
+                    ++fallback;
+            }
+
+            m_bins[i].m_threshold = Weight(0.0);
+            m_bins[i].m_alias = static_cast<uint32>(fallback);
+        }
+    }
+}
+
+template <typename Item, typename Weight>
+inline const std::pair<Item, Weight>& AliasTable<Item, Weight>::sample(const Weight x) const
+{
+    assert(!m_bins.empty());
+    assert(x >= Weight(0.0));
+    assert(x < Weight(1.0));
+
+    // Use the integer part of x * n to select a bin and the fractional part
+    // to choose between the bin's own item and its alias.
+    const double scaled = static_cast<double>(x) * m_items.size();
+    const size_t i = select_bin(scaled);
+
+    const Bin& bin = m_bins[i];
+    return m_items[scaled - i < bin.m_threshold ? i : static_cast<size_t>(bin.m_alias)];
+}
+
+template <typename Item, typename Weight>
+inline const std::pair<Item, Weight>& AliasTable<Item, Weight>::sample(const Weight x, Weight& y) const
+{
+    assert(!m_bins.empty());
+    assert(x >= Weight(0.0));
+    assert(x < Weight(1.0));
+    assert(y >= Weight(0.0));
+    assert(y < Weight(1.0));
+
+    const size_t i = select_bin(static_cast<double>(x) * m_items.size());
+    const Bin& bin = m_bins[i];
+
+    // Choose between the bin's own item and its alias, then stretch the part
+    // of [0,1) that led to this choice back to the whole unit interval.
+    size_t item_index;
+    if (y < bin.m_threshold)
+    {
+        item_index = i;
+        y /= bin.m_threshold;
+    }
+    else
+    {
+        item_index = static_cast<size_t>(bin.m_alias);
+        y = (y - bin.m_threshold) / (Weight(1.0) - bin.m_threshold);
+    }
+    if (y >= Weight(1.0))
+        y = shift(Weight(1.0), -1);
+
+    return m_items[item_index];
+}
+
+template <typename Item, typename Weight>
+inline const std::pair<Item, Weight>& AliasTable<Item, Weight>::sample_and_remap(const Weight x, Weight& y) const
+{
+    assert(!m_bins.empty());
+    assert(x >= Weight(0.0));
+    assert(x < Weight(1.0));
+
+    const double scaled = static_cast<double>(x) * m_items.size();
+    const size_t i = select_bin(scaled);
+    const Bin& bin = m_bins[i];
+
+    // Same as above, with the fractional part of x * n in place of y.
+    const double threshold = static_cast<double>(bin.m_threshold);
+    const double f = scaled - i;
+    size_t item_index;
+    double r;
+    if (f < threshold)
+    {
+        item_index = i;
+        r = f / threshold;
+    }
+    else
+    {
+        item_index = static_cast<size_t>(bin.m_alias);
+        r = (f - threshold) / (1.0 - threshold);
+    }
+
+    y = static_cast<Weight>(r);
+    if (y >= Weight(1.0))
+        y = shift(Weight(1.0), -1);
+
+    return m_items[item_index];
+}
+
+template <typename Item, typename Weight>
+inline size_t AliasTable<Item, Weight>::select_bin(const double scaled) const
+{
+    const size_t item_count = m_items.size();
+    const size_t i = static_cast<size_t>(scaled);
+    return i < item_count ? i : item_count - 1;
+}
+
+}   // namespace foundation
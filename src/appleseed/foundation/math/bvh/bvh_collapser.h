@@ -0,0 +1,237 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/utility/stopwatch.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Build the wide representation of a binary BVH (see foundation::bvh::WideTree).
+//
+// Each wide node is obtained by repeatedly replacing the interior child with the
+// largest surface area by its own two children until the node is full or only
+// leaves remain.
+//
+// Reference:
+//
+//   Shallow Bounding Volume Hierarchies for Fast SIMD Ray Tracing of Incoherent Rays
+//   Holger Dammertz, Johannes Hanika, Alexander Keller
+//   Eurographics Symposium on Rendering 2008
+//
+
+template <typename Tree>
+class Collapser
+  : public NonCopyable
+{
+  public:
+    // Constructor.
+    Collapser();
+
+    // Build the wide representation of a tree. The binary tree must be final.
+    template <typename Timer>
+    void collapse(Tree& tree);
+
+    // Return the collapsing time.
+    double get_collapse_time() const;
+
+  private:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename Tree::WideNodeType WideNodeType;
+    typedef typename NodeType::AABBType AABBType;
+    typedef typename AABBType::ValueType ValueType;
+
+    static const size_t Arity = WideNodeType::MaxChildCount;
+
+    struct Child
+    {
+        size_t      m_node_index;
+        AABBType    m_bbox;
+    };
+
+    double m_collapse_time;
+
+    // Recursively collapse the subtree rooted at a given interior node.
+    void collapse_recurse(
+        Tree&           tree,
+        const size_t    wide_node_index,
+        const size_t    node_index);
+
+    // Return the surface area of a bounding box, up to a constant factor, in any dimension.
+    static ValueType half_area(const AABBType& bbox);
+};
+
+
+//
+// Collapser class implementation.
+//
+
+template <typename Tree>
+Collapser<Tree>::Collapser()
+  : m_collapse_time(0.0)
+{
+}
+
+template <typename Tree>
+template <typename Timer>
+void Collapser<Tree>::collapse(Tree& tree)
+{
+    // Start stopwatch.
+    Stopwatch<Timer> stopwatch;
+    stopwatch.start();
+
+    tree.m_wide_nodes.clear();
+
+    // Trees made of a single leaf (or empty trees) have no wide representation.
+    if (!tree.m_nodes.empty() && tree.m_nodes[0].is_interior())
+    {
+        // Each wide node replaces at least Arity / 2 interior binary nodes.
+        tree.m_wide_nodes.reserve(tree.m_nodes.size() / Arity + 1);
+
+        // Create the root node of the wide tree.
+        tree.m_wide_nodes.push_back(WideNodeType());
+
+        collapse_recurse(tree, 0, 0);
+    }
+
+    // Measure and save collapsing time.
+    stopwatch.measure();
+    m_collapse_time = stopwatch.get_seconds();
+}
+
+template <typename Tree>
+inline double Collapser<Tree>::get_collapse_time() const
+{
+    return m_collapse_time;
+}
+
+template <typename Tree>
+void Collapser<Tree>::collapse_recurse(
+    Tree&               tree,
+    const size_t        wide_node_index,
+    const size_t        node_index)
+{
+    assert(wide_node_index < tree.m_wide_nodes.size());
+    assert(tree.m_nodes[node_index].is_interior());
+
+    // Start with the two children of the binary node.
+    Child children[Arity];
+    const NodeType& node = tree.m_nodes[node_index];
+    children[0].m_node_index = node.get_child_node_index() + 0;
+    children[0].m_bbox = node.get_left_bbox();
+    children[1].m_node_index = node.get_child_node_index() + 1;
+    children[1].m_bbox = node.get_right_bbox();
+    size_t child_count = 2;
+
+    // Pull grandchildren up until the wide node is full.
+    while (child_count < Arity)
+    {
+        // Find the interior child with the largest surface area.
+        size_t best_child = Arity;
+        ValueType best_area = ValueType(-1.0);
+        for (size_t i = 0; i < child_count; ++i)
+        {
+            if (tree.m_nodes[children[i].m_node_index].is_interior())
+            {
+                const ValueType area = half_area(children[i].m_bbox);
+                if (best_area < area)
+                {
+                    best_area = area;
+                    best_child = i;
+                }
+            }
+        }
+
+        // Stop if all children are leaves.
+        if (best_child == Arity)
+            break;
+
+        // Replace this child by its own children.
+        const NodeType& child_node = tree.m_nodes[children[best_child].m_node_index];
+        children[child_count].m_node_index = child_node.get_child_node_index() + 1;
+        children[child_count].m_bbox = child_node.get_right_bbox();
+        children[best_child].m_node_index = child_node.get_child_node_index() + 0;
+        children[best_child].m_bbox = child_node.get_left_bbox();
+        ++child_count;
+    }
+
+    // Allocate the interior children so that siblings are contiguous in memory.
+    WideNodeType wide_node;
+    size_t wide_child_indices[Arity];
+    for (size_t i = 0; i < child_count; ++i)
+    {
+        if (tree.m_nodes[children[i].m_node_index].is_leaf())
+            wide_node.add_leaf_child(children[i].m_node_index, children[i].m_bbox);
+        else
+        {
+            wide_child_indices[i] = tree.m_wide_nodes.size();
+            tree.m_wide_nodes.push_back(WideNodeType());
+            wide_node.add_wide_child(wide_child_indices[i], children[i].m_bbox);
+        }
+    }
+    tree.m_wide_nodes[wide_node_index] = wide_node;
+
+    // Recurse into the interior children.
+    for (size_t i = 0; i < child_count; ++i)
+    {
+        if (tree.m_nodes[children[i].m_node_index].is_interior())
+        {
+            collapse_recurse(
+                tree,
+                wide_child_indices[i],
+                children[i].m_node_index);
+        }
+    }
+}
+
+template <typename Tree>
+typename Collapser<Tree>::ValueType Collapser<Tree>::half_area(const AABBType& bbox)
+{
+    const typename AABBType::VectorType e = bbox.extent();
+
+    ValueType area(0.0);
+
+    for (size_t i = 0; i < AABBType::Dimension; ++i)
+    {
+        for (size_t j = i + 1; j < AABBType::Dimension; ++j)
+            area += e[i] * e[j];
+    }
+
+    return area;
+}
+
+}   // namespace bvh
+}   // namespace foundation
@@ -0,0 +1,377 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/stopwatch.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Multithreaded BVH builder.
+//
+// The top levels of the tree are built on the calling thread until the item sets become
+// small enough, then the remaining subtrees are built in parallel by jobs scheduled into
+// a job queue. Nodes of the top levels are split with the binned variant of partition(),
+// which evaluates the candidate splits of a node in parallel; subtrees are split exactly
+// like bvh::Builder does. The resulting tree does not depend on the number of threads
+// servicing the job queue.
+//
+// The Partitioner class must conform to the prototype described in bvh_builder.h.
+// In addition, it must provide the binned partition() overload of bvh::SAHPartitioner,
+// and partition() must support being called concurrently on disjoint sets of items,
+// each containing at most half of the items (bvh::SAHPartitioner qualifies).
+//
+
+template <typename Tree, typename Partitioner>
+class ParallelBuilder
+  : public NonCopyable
+{
+  public:
+    // Minimum number of items in a subtree built by a separate job.
+    static const size_t MinSubtreeSize = 4096;
+
+    // Constructor.
+    ParallelBuilder();
+
+    // Build a tree. The job queue must be serviced by a job manager and must not
+    // contain other jobs. The tree is split into approximately subtree_count_hint
+    // independent subtrees.
+    template <typename Timer>
+    void build(
+        Tree&           tree,
+        Partitioner&    partitioner,
+        const size_t    size,
+        const size_t    items_per_leaf_hint,
+        JobQueue&       job_queue,
+        const size_t    subtree_count_hint);
+
+    // Return the construction time.
+    double get_build_time() const;
+
+  private:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename Tree::NodeVectorType NodeVectorType;
+    typedef typename NodeType::AABBType AABBType;
+
+    struct Subtree
+    {
+        size_t          m_node_index;       // index of the subtree root in the tree
+        size_t          m_begin;
+        size_t          m_end;
+        AABBType        m_bbox;
+        NodeVectorType  m_nodes;            // subtree nodes, root first
+
+        Subtree(
+            const size_t                                    node_index,
+            const size_t                                    begin,
+            const size_t                                    end,
+            const AABBType&                                 bbox,
+            const typename NodeVectorType::allocator_type&  allocator)
+          : m_node_index(node_index)
+          , m_begin(begin)
+          , m_end(end)
+          , m_bbox(bbox)
+          , m_nodes(allocator)
+        {
+        }
+    };
+
+    class SubtreeJob
+      : public IJob
+    {
+      public:
+        SubtreeJob(
+            Partitioner&    partitioner,
+            Subtree&        subtree)
+          : m_partitioner(partitioner)
+          , m_subtree(subtree)
+        {
+        }
+
+        void execute(const size_t thread_index) override
+        {
+            m_subtree.m_nodes.push_back(NodeType());
+
+            subdivide_recurse(
+                m_subtree.m_nodes,
+                m_partitioner,
+                0,
+                m_subtree.m_begin,
+                m_subtree.m_end,
+                m_subtree.m_bbox,
+                nullptr,
+                0,
+                nullptr,
+                0);
+        }
+
+      private:
+        Partitioner&    m_partitioner;
+        Subtree&        m_subtree;
+    };
+
+    double m_build_time;
+
+    // Recursively subdivide a tree. If 'subtrees' is not null, sets of at most
+    // max_subtree_size items are not subdivided but recorded as subtrees, and
+    // larger sets are partitioned by up to max_job_count jobs of 'job_queue'.
+    static void subdivide_recurse(
+        NodeVectorType&         nodes,
+        Partitioner&            partitioner,
+        const size_t            node_index,
+        const size_t            begin,
+        const size_t            end,
+        const AABBType&         bbox,
+        std::vector<Subtree>*   subtrees,
+        const size_t            max_subtree_size,
+        JobQueue*               job_queue,
+        const size_t            max_job_count);
+
+    // Append the nodes of a subtree to the tree.
+    static void insert_subtree(
+        Tree&                   tree,
+        const Subtree&          subtree);
+};
+
+
+//
+// ParallelBuilder class implementation.
+//
+
+template <typename Tree, typename Partitioner>
+const size_t ParallelBuilder<Tree, Partitioner>::MinSubtreeSize;
+
+template <typename Tree, typename Partitioner>
+ParallelBuilder<Tree, Partitioner>::ParallelBuilder()
+  : m_build_time(0.0)
+{
+}
+
+template <typename Tree, typename Partitioner>
+template <typename Timer>
+void ParallelBuilder<Tree, Partitioner>::build(
+    Tree&               tree,
+    Partitioner&        partitioner,
+    const size_t        size,
+    const size_t        items_per_leaf_hint,
+    JobQueue&           job_queue,
+    const size_t        subtree_count_hint)
+{
+    // Start stopwatch.
+    Stopwatch<Timer> stopwatch;
+    stopwatch.start();
+
+    // Clear the tree.
+    tree.m_nodes.clear();
+
+    // Reserve memory for the nodes.
+    const size_t leaf_count_guess = size / items_per_leaf_hint;
+    const size_t node_count_guess = leaf_count_guess > 0 ? 2 * leaf_count_guess - 1 : 0;
+    tree.m_nodes.reserve(node_count_guess);
+
+    // Create the root node of the tree.
+    tree.m_nodes.push_back(NodeType());
+
+    // Compute the bounding box of the tree.
+    const AABBType root_bbox(partitioner.compute_bbox(0, size));
+
+    // Subtrees never contain more than half of the items, see class comment.
+    const bool parallel = subtree_count_hint > 1 && size >= 2 * MinSubtreeSize;
+    const size_t max_subtree_size =
+        parallel ? std::min(size / 2, std::max(size / subtree_count_hint, MinSubtreeSize)) : 0;
+
+    // Build the top levels of the tree.
+    std::vector<Subtree> subtrees;
+    subdivide_recurse(
+        tree.m_nodes,
+        partitioner,
+        0,              // node index
+        0,              // begin
+        size,           // end
+        root_bbox,
+        parallel ? &subtrees : nullptr,
+        max_subtree_size,
+        &job_queue,
+        subtree_count_hint);
+
+    if (!subtrees.empty())
+    {
+        // Build the subtrees in parallel.
+        for (size_t i = 0, e = subtrees.size(); i < e; ++i)
+            job_queue.schedule(new SubtreeJob(partitioner, subtrees[i]));
+        job_queue.wait_until_completion();
+
+        // Assemble the tree.
+        for (size_t i = 0, e = subtrees.size(); i < e; ++i)
+            insert_subtree(tree, subtrees[i]);
+    }
+
+    // Measure and save construction time.
+    stopwatch.measure();
+    m_build_time = stopwatch.get_seconds();
+}
+
+template <typename Tree, typename Partitioner>
+inline double ParallelBuilder<Tree, Partitioner>::get_build_time() const
+{
+    return m_build_time;
+}
+
+template <typename Tree, typename Partitioner>
+void ParallelBuilder<Tree, Partitioner>::subdivide_recurse(
+    NodeVectorType&         nodes,
+    Partitioner&            partitioner,
+    const size_t            node_index,
+    const size_t            begin,
+    const size_t            end,
+    const AABBType&         bbox,
+    std::vector<Subtree>*   subtrees,
+    const size_t            max_subtree_size,
+    JobQueue*               job_queue,
+    const size_t            max_job_count)
+{
+    assert(node_index < nodes.size());
+
+    // Defer the construction of small enough subtrees.
+    if (subtrees && end - begin <= max_subtree_size)
+    {
+        subtrees->emplace_back(node_index, begin, end, bbox, nodes.get_allocator());
+        return;
+    }
+
+    // Try to partition the set of items. Sets of the top levels are large enough
+    // to evaluate their candidate splits in parallel.
+    size_t pivot = end;
+    if (subtrees)
+    {
+        const size_t job_count = std::min(max_job_count, (end - begin) / MinSubtreeSize);
+        pivot = partitioner.partition(begin, end, typename Partitioner::AABBType(bbox), *job_queue, job_count);
+        assert(pivot > begin);
+        assert(pivot <= end);
+    }
+    else if (end - begin > 1)
+    {
+        pivot = partitioner.partition(begin, end, typename Partitioner::AABBType(bbox));
+        assert(pivot > begin);
+        assert(pivot <= end);
+    }
+
+    if (pivot == end)
+    {
+        // Turn the current node into a leaf node.
+        NodeType& node = nodes[node_index];
+        node.make_leaf();
+        node.set_item_index(begin);
+        node.set_item_count(end - begin);
+    }
+    else
+    {
+        // Compute the bounding box of the child nodes.
+        const AABBType left_bbox(partitioner.compute_bbox(begin, pivot));
+        const AABBType right_bbox(partitioner.compute_bbox(pivot, end));
+
+        // Compute the indices of the child nodes.
+        const size_t left_node_index = nodes.size();
+        const size_t right_node_index = left_node_index + 1;
+
+        // Turn the current node into an interior node.
+        NodeType& node = nodes[node_index];
+        node.make_interior();
+        node.set_left_bbox(left_bbox);
+        node.set_right_bbox(right_bbox);
+        node.set_child_node_index(left_node_index);
+
+        // Create the child nodes.
+        nodes.push_back(NodeType());
+        nodes.push_back(NodeType());
+
+        // Recurse into the left subtree.
+        subdivide_recurse(
+            nodes,
+            partitioner,
+            left_node_index,
+            begin,
+            pivot,
+            left_bbox,
+            subtrees,
+            max_subtree_size,
+            job_queue,
+            max_job_count);
+
+        // Recurse into the right subtree.
+        subdivide_recurse(
+            nodes,
+            partitioner,
+            right_node_index,
+            pivot,
+            end,
+            right_bbox,
+            subtrees,
+            max_subtree_size,
+            job_queue,
+            max_job_count);
+    }
+}
+
+template <typename Tree, typename Partitioner>
+void ParallelBuilder<Tree, Partitioner>::insert_subtree(
+    Tree&                   tree,
+    const Subtree&          subtree)
+{
+    assert(!subtree.m_nodes.empty());
+
+    // Node k > 0 of the subtree goes to index base + k in the tree.
+    const size_t base = tree.m_nodes.size() - 1;
+
+    for (size_t k = 0, e = subtree.m_nodes.size(); k < e; ++k)
+    {
+        NodeType node = subtree.m_nodes[k];
+
+        if (node.is_interior())
+            node.set_child_node_index(base + node.get_child_node_index());
+
+        if (k == 0)
+            tree.m_nodes[subtree.m_node_index] = node;
+        else tree.m_nodes.push_back(node);
+    }
+}
+
+}   // namespace bvh
+}   // namespace foundation
@@ -0,0 +1,212 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/utility/stopwatch.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Recompute the bounding boxes of the nodes of a BVH, bottom-up, without changing its
+// topology. This is much faster than rebuilding the tree when items move but the set
+// of items is unchanged, at the expense of tree quality: refit() returns the SAH cost
+// of the refitted tree so that the caller may decide to rebuild it instead.
+//
+// Only trees without motion bounding boxes can be refitted. Wide trees must be
+// collapsed again after being refitted.
+//
+// The ItemBBoxes class must provide an operator[] returning the bounding box of the
+// item at a given position, in the order of the items referenced by the leaves.
+//
+
+template <typename Tree>
+class Refitter
+  : public NonCopyable
+{
+  public:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename NodeType::AABBType AABBType;
+    typedef typename AABBType::ValueType ValueType;
+
+    // Constructor.
+    Refitter();
+
+    // Refit a tree to a new set of item bounding boxes.
+    // Return the SAH cost of the refitted tree.
+    template <typename Timer, typename ItemBBoxes>
+    ValueType refit(
+        Tree&               tree,
+        const ItemBBoxes&   item_bboxes,
+        const ValueType     interior_node_traversal_cost,
+        const ValueType     item_intersection_cost);
+
+    // Return the refitting time.
+    double get_refit_time() const;
+
+  private:
+    double m_refit_time;
+
+    // Recursively refit the subtree rooted at a given node, return its bounding box.
+    // The cost of the subtree, scaled by the surface area of the root, is accumulated into 'cost'.
+    template <typename ItemBBoxes>
+    AABBType refit_recurse(
+        Tree&               tree,
+        const size_t        node_index,
+        const ItemBBoxes&   item_bboxes,
+        const ValueType     interior_node_traversal_cost,
+        const ValueType     item_intersection_cost,
+        ValueType&          cost) const;
+};
+
+
+//
+// Refitter class implementation.
+//
+
+template <typename Tree>
+Refitter<Tree>::Refitter()
+  : m_refit_time(0.0)
+{
+}
+
+template <typename Tree>
+template <typename Timer, typename ItemBBoxes>
+typename Refitter<Tree>::ValueType Refitter<Tree>::refit(
+    Tree&                   tree,
+    const ItemBBoxes&       item_bboxes,
+    const ValueType         interior_node_traversal_cost,
+    const ValueType         item_intersection_cost)
+{
+    // Start stopwatch.
+    Stopwatch<Timer> stopwatch;
+    stopwatch.start();
+
+    ValueType cost(0.0);
+
+    if (!tree.m_nodes.empty())
+    {
+        const AABBType root_bbox =
+            refit_recurse(
+                tree,
+                0,
+                item_bboxes,
+                interior_node_traversal_cost,
+                item_intersection_cost,
+                cost);
+
+        const ValueType root_area = half_surface_area(root_bbox);
+        cost = root_area > ValueType(0.0) ? cost / root_area : ValueType(0.0);
+    }
+
+    // Measure and save refitting time.
+    stopwatch.measure();
+    m_refit_time = stopwatch.get_seconds();
+
+    return cost;
+}
+
+template <typename Tree>
+inline double Refitter<Tree>::get_refit_time() const
+{
+    return m_refit_time;
+}
+
+template <typename Tree>
+template <typename ItemBBoxes>
+typename Refitter<Tree>::AABBType Refitter<Tree>::refit_recurse(
+    Tree&                   tree,
+    const size_t            node_index,
+    const ItemBBoxes&       item_bboxes,
+    const ValueType         interior_node_traversal_cost,
+    const ValueType         item_intersection_cost,
+    ValueType&              cost) const
+{
+    assert(node_index < tree.m_nodes.size());
+
+    AABBType bbox;
+    bbox.invalidate();
+
+    NodeType& node = tree.m_nodes[node_index];
+
+    if (node.is_leaf())
+    {
+        const size_t item_begin = node.get_item_index();
+        const size_t item_count = node.get_item_count();
+
+        for (size_t i = 0; i < item_count; ++i)
+            bbox.insert(AABBType(item_bboxes[item_begin + i]));
+
+        if (bbox.is_valid())
+            cost += half_surface_area(bbox) * static_cast<ValueType>(item_count) * item_intersection_cost;
+    }
+    else
+    {
+        const size_t child_node_index = node.get_child_node_index();
+
+        const AABBType left_bbox =
+            refit_recurse(
+                tree,
+                child_node_index,
+                item_bboxes,
+                interior_node_traversal_cost,
+                item_intersection_cost,
+                cost);
+
+        const AABBType right_bbox =
+            refit_recurse(
+                tree,
+                child_node_index + 1,
+                item_bboxes,
+                interior_node_traversal_cost,
+                item_intersection_cost,
+                cost);
+
+        node.set_left_bbox(left_bbox);
+        node.set_right_bbox(right_bbox);
+
+        bbox.insert(left_bbox);
+        bbox.insert(right_bbox);
+
+        if (bbox.is_valid())
+            cost += half_surface_area(bbox) * interior_node_traversal_cost;
+    }
+
+    return bbox;
+}
+
+}   // namespace bvh
+}   // namespace foundation
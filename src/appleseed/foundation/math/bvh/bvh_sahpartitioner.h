@@ -31,8 +31,11 @@
 
 // appleseed.foundation headers.
 #include "foundation/math/bvh/bvh_partitionerbase.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobqueue.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <limits>
@@ -61,19 +64,88 @@ class SAHPartitioner
         const ValueType         interior_node_traversal_cost = ValueType(1.0),
         const ValueType         item_intersection_cost = ValueType(1.0));
 
+    // Number of bins per dimension used by the binned variant of partition().
+    static const size_t BinCount = 32;
+
     // Partition a set of items into two distinct sets.
     size_t partition(
         const size_t            begin,
         const size_t            end,
         const AABBType&         bbox);
 
+    // Partition a large set of items into two distinct sets. Only the boundaries of
+    // BinCount bins per dimension are considered as split positions. The bins are filled
+    // by job_count jobs scheduled into a job queue serviced by a job manager. The result
+    // does not depend on the number of threads servicing the job queue.
+    size_t partition(
+        const size_t            begin,
+        const size_t            end,
+        const AABBType&         bbox,
+        JobQueue&               job_queue,
+        const size_t            job_count);
+
   private:
     static const size_t Dimension = AABBType::Dimension;
 
+    struct Bin
+    {
+        AABBType                m_bbox;
+        size_t                  m_count;
+    };
+
+    class BinningJob
+      : public IJob
+    {
+      public:
+        BinningJob(
+            const SAHPartitioner&   partitioner,
+            const size_t            begin,
+            const size_t            end,
+            const ValueType         centroid_min[],
+            const ValueType         bin_scale[],
+            Bin                     bins[])
+          : m_partitioner(partitioner)
+          , m_begin(begin)
+          , m_end(end)
+          , m_centroid_min(centroid_min)
+          , m_bin_scale(bin_scale)
+          , m_bins(bins)
+        {
+        }
+
+        void execute(const size_t thread_index) override
+        {
+            m_partitioner.fill_bins(m_begin, m_end, m_centroid_min, m_bin_scale, m_bins);
+        }
+
+      private:
+        const SAHPartitioner&   m_partitioner;
+        const size_t            m_begin;
+        const size_t            m_end;
+        const ValueType*        m_centroid_min;
+        const ValueType*        m_bin_scale;
+        Bin*                    m_bins;
+    };
+
     const size_t                m_max_leaf_size;
     const ValueType             m_interior_node_traversal_cost;
     const ValueType             m_item_intersection_cost;
     std::vector<ValueType>      m_left_areas;
+    std::vector<Bin>            m_bins;
+
+    // Return true if it's cheaper to make a leaf than to split a set of items with a given cost.
+    bool is_leaf_cheaper(
+        const size_t            count,
+        const AABBType&         bbox,
+        const ValueType         split_cost) const;
+
+    // Insert the items of a given range into Dimension * BinCount bins.
+    void fill_bins(
+        const size_t            begin,
+        const size_t            end,
+        const ValueType         centroid_min[],
+        const ValueType         bin_scale[],
+        Bin                     bins[]) const;
 };
 
 
@@ -81,6 +153,9 @@ class SAHPartitioner
 // SAHPartitioner class implementation.
 //
 
+template <typename AABBVector>
+const size_t SAHPartitioner<AABBVector>::BinCount;
+
 template <typename AABBVector>
 inline SAHPartitioner<AABBVector>::SAHPartitioner(
     const AABBVectorType&       bboxes,
@@ -124,11 +199,14 @@ size_t SAHPartitioner<AABBVector>::partition(
         AABBType bbox_accumulator;
 
         // Left-to-right sweep to accumulate bounding boxes and compute their surface area.
+        // Areas are stored at the position of the items so that disjoint sets of items
+        // can be partitioned concurrently.
+        ValueType* left_areas = &m_left_areas[begin];
         bbox_accumulator.invalidate();
         for (size_t i = 0; i < count - 1; ++i)
         {
             bbox_accumulator.insert(bboxes[indices[begin + i]]);
-            m_left_areas[i] = half_surface_area(bbox_accumulator);
+            left_areas[i] = half_surface_area(bbox_accumulator);
         }
 
         // Right-to-left sweep to accumulate bounding boxes, compute their surface area find the best partition.
@@ -139,7 +217,7 @@ size_t SAHPartitioner<AABBVector>::partition(
             bbox_accumulator.insert(bboxes[indices[begin + i]]);
 
             // Compute the cost of this partition.
-            const ValueType left_cost = m_left_areas[i - 1] * i;
+            const ValueType left_cost = left_areas[i - 1] * i;
             const ValueType right_cost = half_surface_area(bbox_accumulator) * (count - i);
             const ValueType split_cost = left_cost + right_cost;
 
@@ -154,11 +232,135 @@ size_t SAHPartitioner<AABBVector>::partition(
     }
 
     // Don't split if it's cheaper to make a leaf.
-    const ValueType split_cost =
-        m_interior_node_traversal_cost +
-        best_split_cost / half_surface_area(bbox) * m_item_intersection_cost;
-    const ValueType leaf_cost = count * m_item_intersection_cost;
-    if (leaf_cost <= split_cost)
+    if (is_leaf_cheaper(count, bbox, best_split_cost))
+        return end;
+
+    const size_t pivot = begin + best_split_pivot;
+    assert(pivot < end);
+
+    PartitionerBase<AABBVector>::sort_indices(best_split_dim, begin, end, pivot);
+
+    return pivot;
+}
+
+template <typename AABBVector>
+size_t SAHPartitioner<AABBVector>::partition(
+    const size_t                begin,
+    const size_t                end,
+    const AABBType&             bbox,
+    JobQueue&                   job_queue,
+    const size_t                job_count)
+{
+    // Don't split leaves containing only degenerate triangles.
+    if (bbox.rank() < Dimension - 1)
+        return end;
+
+    const size_t count = end - begin;
+    assert(count > 1);
+
+    // Don't split leaves containing less than a predefined number of items.
+    if (count <= m_max_leaf_size)
+        return end;
+
+    const AABBVectorType& bboxes = PartitionerBase<AABBVector>::m_bboxes;
+
+    // Items are sorted by centroid along each dimension, so the bins along a dimension
+    // hold consecutive items, and the boundary between two bins is a valid pivot.
+    ValueType centroid_min[Dimension];
+    ValueType bin_scale[Dimension];
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        const std::vector<size_t>& indices = PartitionerBase<AABBVector>::m_indices[d];
+        const AABBType& first = bboxes[indices[begin]];
+        const AABBType& last = bboxes[indices[end - 1]];
+
+        // Use the same centroid definition as the sort predicate.
+        centroid_min[d] = first.min[d] + first.max[d];
+        const ValueType extent = last.min[d] + last.max[d] - centroid_min[d];
+        bin_scale[d] = extent > ValueType(0.0) ? BinCount / extent : ValueType(0.0);
+    }
+
+    // Fill one set of bins per job, then merge them in a fixed order.
+    const size_t actual_job_count = std::max<size_t>(std::min(job_count, count), 1);
+    const size_t bins_per_job = Dimension * BinCount;
+    m_bins.resize(actual_job_count * bins_per_job);
+
+    for (size_t i = 0; i < actual_job_count; ++i)
+    {
+        job_queue.schedule(
+            new BinningJob(
+                *this,
+                begin + count * i / actual_job_count,
+                begin + count * (i + 1) / actual_job_count,
+                centroid_min,
+                bin_scale,
+                &m_bins[i * bins_per_job]));
+    }
+
+    job_queue.wait_until_completion();
+
+    for (size_t i = 1; i < actual_job_count; ++i)
+    {
+        for (size_t j = 0; j < bins_per_job; ++j)
+        {
+            m_bins[j].m_bbox.insert(m_bins[i * bins_per_job + j].m_bbox);
+            m_bins[j].m_count += m_bins[i * bins_per_job + j].m_count;
+        }
+    }
+
+    ValueType best_split_cost = std::numeric_limits<ValueType>::max();
+    size_t best_split_dim = 0;
+    size_t best_split_pivot = 0;
+
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        if (bin_scale[d] == ValueType(0.0))
+            continue;
+
+        const Bin* bins = &m_bins[d * BinCount];
+
+        // Left-to-right sweep to accumulate bounding boxes and compute their surface area.
+        ValueType left_areas[BinCount - 1];
+        AABBType bbox_accumulator;
+        bbox_accumulator.invalidate();
+        for (size_t i = 0; i < BinCount - 1; ++i)
+        {
+            bbox_accumulator.insert(bins[i].m_bbox);
+            left_areas[i] = half_surface_area(bbox_accumulator);
+        }
+
+        // Right-to-left sweep to accumulate bounding boxes and find the best partition.
+        bbox_accumulator.invalidate();
+        size_t right_count = 0;
+        for (size_t i = BinCount - 1; i > 0; --i)
+        {
+            bbox_accumulator.insert(bins[i].m_bbox);
+            right_count += bins[i].m_count;
+
+            // Skip partitions leaving one side empty.
+            if (right_count == 0 || right_count == count)
+                continue;
+
+            const size_t left_count = count - right_count;
+            const ValueType left_cost = left_areas[i - 1] * left_count;
+            const ValueType right_cost = half_surface_area(bbox_accumulator) * right_count;
+            const ValueType split_cost = left_cost + right_cost;
+
+            if (best_split_cost > split_cost)
+            {
+                best_split_cost = split_cost;
+                best_split_dim = d;
+                best_split_pivot = left_count;
+            }
+        }
+    }
+
+    // Fall back to the exact sweep if all centroids coincide.
+    if (best_split_pivot == 0)
+        return partition(begin, end, bbox);
+
+    // Don't split if it's cheaper to make a leaf.
+    if (is_leaf_cheaper(count, bbox, best_split_cost))
         return end;
 
     const size_t pivot = begin + best_split_pivot;
@@ -169,5 +371,56 @@ size_t SAHPartitioner<AABBVector>::partition(
     return pivot;
 }
 
+template <typename AABBVector>
+inline bool SAHPartitioner<AABBVector>::is_leaf_cheaper(
+    const size_t                count,
+    const AABBType&             bbox,
+    const ValueType             split_cost) const
+{
+    const ValueType normalized_split_cost =
+        m_interior_node_traversal_cost +
+        split_cost / half_surface_area(bbox) * m_item_intersection_cost;
+    const ValueType leaf_cost = count * m_item_intersection_cost;
+    return leaf_cost <= normalized_split_cost;
+}
+
+template <typename AABBVector>
+void SAHPartitioner<AABBVector>::fill_bins(
+    const size_t                begin,
+    const size_t                end,
+    const ValueType             centroid_min[],
+    const ValueType             bin_scale[],
+    Bin                         bins[]) const
+{
+    const AABBVectorType& bboxes = PartitionerBase<AABBVector>::m_bboxes;
+    const std::vector<size_t>& indices = PartitionerBase<AABBVector>::m_indices[0];
+
+    for (size_t i = 0; i < Dimension * BinCount; ++i)
+    {
+        bins[i].m_bbox.invalidate();
+        bins[i].m_count = 0;
+    }
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        const AABBType& item_bbox = bboxes[indices[i]];
+
+        for (size_t d = 0; d < Dimension; ++d)
+        {
+            // The bin index is a nondecreasing function of the centroid, as required
+            // for bin boundaries to match the sorted order of the items.
+            const ValueType centroid = item_bbox.min[d] + item_bbox.max[d];
+            const size_t bin_index =
+                std::min(
+                    static_cast<size_t>((centroid - centroid_min[d]) * bin_scale[d]),
+                    BinCount - 1);
+
+            Bin& bin = bins[d * BinCount + bin_index];
+            bin.m_bbox.insert(item_bbox);
+            ++bin.m_count;
+        }
+    }
+}
+
 }   // namespace bvh
 }   // namespace foundation
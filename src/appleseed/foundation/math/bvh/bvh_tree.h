@@ -66,9 +66,15 @@ class Tree
     template <typename Tree, typename Partitioner>
     friend class Builder;
 
+    template <typename Tree, typename Partitioner>
+    friend class ParallelBuilder;
+
     template <typename Tree, typename Partitioner>
     friend class SpatialBuilder;
 
+    template <typename Tree>
+    friend class Refitter;
+
     template <typename Tree>
     friend class TreeStatistics;
 
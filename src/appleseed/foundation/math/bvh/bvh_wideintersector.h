@@ -0,0 +1,560 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/bvh/bvh_intersector.h"
+#include "foundation/math/bvh/bvh_statistics.h"
+#include "foundation/math/minmax.h"
+#include "foundation/math/ray.h"
+#include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
+#ifdef APPLESEED_USE_SSE
+#include "foundation/platform/sse.h"
+#endif
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Ray-wide node intersection kernels.
+//
+// intersect() tests the ray against all child bounding boxes of a wide node,
+// stores the entry distances in 'tmin' and returns a bitmask of the children
+// that are hit. Empty child slots have invalid bounding boxes and never hit.
+//
+
+namespace impl
+{
+    // Generic implementation.
+    template <typename T, size_t N, size_t Arity>
+    class WideNodeKernel
+    {
+      public:
+        template <typename RayType, typename RayInfoType>
+        WideNodeKernel(
+            const RayType&          ray,
+            const RayInfoType&      ray_info)
+          : m_ray_tmin(ray.m_tmin)
+        {
+            for (size_t d = 0; d < N; ++d)
+            {
+                m_org[d] = ray.m_org[d];
+                m_rcp_dir[d] = ray_info.m_rcp_dir[d];
+                m_near_offset[d] = (d * 2 + 1 - ray_info.m_sgn_dir[d]) * Arity;
+                m_far_offset[d] = (d * 2 + ray_info.m_sgn_dir[d]) * Arity;
+            }
+        }
+
+        size_t intersect(
+            const T*                bbox_data,
+            const T                 ray_tmax,
+            T*                      tmin) const
+        {
+            size_t hits = 0;
+
+            for (size_t i = 0; i < Arity; ++i)
+            {
+                T child_tmin = m_ray_tmin;
+                T child_tmax = ray_tmax;
+
+                for (size_t d = 0; d < N; ++d)
+                {
+                    const T l1 = m_rcp_dir[d] * (bbox_data[m_near_offset[d] + i] - m_org[d]);
+                    const T l2 = m_rcp_dir[d] * (bbox_data[m_far_offset[d] + i] - m_org[d]);
+                    child_tmin = ssemax(l1, child_tmin);
+                    child_tmax = ssemin(l2, child_tmax);
+                }
+
+                tmin[i] = child_tmin;
+
+                if (child_tmin <= child_tmax && child_tmax >= m_ray_tmin && child_tmin < ray_tmax)
+                    hits |= size_t(1) << i;
+            }
+
+            return hits;
+        }
+
+      private:
+        T       m_org[N];
+        T       m_rcp_dir[N];
+        size_t  m_near_offset[N];
+        size_t  m_far_offset[N];
+        T       m_ray_tmin;
+    };
+
+#ifdef APPLESEED_USE_SSE
+
+    // Double precision, 3D: SSE2 (two children at a time) or AVX (four children at a time).
+    template <size_t Arity>
+    class WideNodeKernel<double, 3, Arity>
+    {
+      public:
+        template <typename RayType, typename RayInfoType>
+        WideNodeKernel(
+            const RayType&          ray,
+            const RayInfoType&      ray_info)
+        {
+            for (size_t d = 0; d < 3; ++d)
+            {
+                m_near_offset[d] = (d * 2 + 1 - ray_info.m_sgn_dir[d]) * Arity;
+                m_far_offset[d] = (d * 2 + ray_info.m_sgn_dir[d]) * Arity;
+            }
+
+#ifdef APPLESEED_USE_AVX
+            m_org_x = _mm256_set1_pd(ray.m_org[0]);
+            m_org_y = _mm256_set1_pd(ray.m_org[1]);
+            m_org_z = _mm256_set1_pd(ray.m_org[2]);
+            m_rcp_dir_x = _mm256_set1_pd(ray_info.m_rcp_dir[0]);
+            m_rcp_dir_y = _mm256_set1_pd(ray_info.m_rcp_dir[1]);
+            m_rcp_dir_z = _mm256_set1_pd(ray_info.m_rcp_dir[2]);
+            m_ray_tmin = _mm256_set1_pd(ray.m_tmin);
+#else
+            m_org_x = _mm_set1_pd(ray.m_org[0]);
+            m_org_y = _mm_set1_pd(ray.m_org[1]);
+            m_org_z = _mm_set1_pd(ray.m_org[2]);
+            m_rcp_dir_x = _mm_set1_pd(ray_info.m_rcp_dir[0]);
+            m_rcp_dir_y = _mm_set1_pd(ray_info.m_rcp_dir[1]);
+            m_rcp_dir_z = _mm_set1_pd(ray_info.m_rcp_dir[2]);
+            m_ray_tmin = _mm_set1_pd(ray.m_tmin);
+#endif
+        }
+
+        size_t intersect(
+            const double*           bbox_data,
+            const double            ray_tmax,
+            double*                 tmin) const
+        {
+            size_t hits = 0;
+
+#ifdef APPLESEED_USE_AVX
+
+            const __m256d mray_tmax = _mm256_set1_pd(ray_tmax);
+
+            for (size_t i = 0; i < Arity; i += 4)
+            {
+                const __m256d xl1 = _mm256_mul_pd(m_rcp_dir_x, _mm256_sub_pd(_mm256_load_pd(bbox_data + m_near_offset[0] + i), m_org_x));
+                const __m256d xl2 = _mm256_mul_pd(m_rcp_dir_x, _mm256_sub_pd(_mm256_load_pd(bbox_data + m_far_offset[0] + i), m_org_x));
+                const __m256d yl1 = _mm256_mul_pd(m_rcp_dir_y, _mm256_sub_pd(_mm256_load_pd(bbox_data + m_near_offset[1] + i), m_org_y));
+                const __m256d yl2 = _mm256_mul_pd(m_rcp_dir_y, _mm256_sub_pd(_mm256_load_pd(bbox_data + m_far_offset[1] + i), m_org_y));
+                const __m256d zl1 = _mm256_mul_pd(m_rcp_dir_z, _mm256_sub_pd(_mm256_load_pd(bbox_data + m_near_offset[2] + i), m_org_z));
+                const __m256d zl2 = _mm256_mul_pd(m_rcp_dir_z, _mm256_sub_pd(_mm256_load_pd(bbox_data + m_far_offset[2] + i), m_org_z));
+
+                const __m256d child_tmin = _mm256_max_pd(zl1, _mm256_max_pd(yl1, _mm256_max_pd(xl1, m_ray_tmin)));
+                const __m256d child_tmax = _mm256_min_pd(zl2, _mm256_min_pd(yl2, _mm256_min_pd(xl2, mray_tmax)));
+
+                _mm256_store_pd(tmin + i, child_tmin);
+
+                const int misses =
+                    _mm256_movemask_pd(
+                        _mm256_or_pd(
+                            _mm256_cmp_pd(child_tmin, child_tmax, _CMP_GT_OQ),
+                            _mm256_or_pd(
+                                _mm256_cmp_pd(child_tmax, m_ray_tmin, _CMP_LT_OQ),
+                                _mm256_cmp_pd(child_tmin, mray_tmax, _CMP_GE_OQ))));
+
+                hits |= static_cast<size_t>(misses ^ 15) << i;
+            }
+
+#else
+
+            const __m128d mray_tmax = _mm_set1_pd(ray_tmax);
+
+            for (size_t i = 0; i < Arity; i += 2)
+            {
+                const __m128d xl1 = _mm_mul_pd(m_rcp_dir_x, _mm_sub_pd(_mm_load_pd(bbox_data + m_near_offset[0] + i), m_org_x));
+                const __m128d xl2 = _mm_mul_pd(m_rcp_dir_x, _mm_sub_pd(_mm_load_pd(bbox_data + m_far_offset[0] + i), m_org_x));
+                const __m128d yl1 = _mm_mul_pd(m_rcp_dir_y, _mm_sub_pd(_mm_load_pd(bbox_data + m_near_offset[1] + i), m_org_y));
+                const __m128d yl2 = _mm_mul_pd(m_rcp_dir_y, _mm_sub_pd(_mm_load_pd(bbox_data + m_far_offset[1] + i), m_org_y));
+                const __m128d zl1 = _mm_mul_pd(m_rcp_dir_z, _mm_sub_pd(_mm_load_pd(bbox_data + m_near_offset[2] + i), m_org_z));
+                const __m128d zl2 = _mm_mul_pd(m_rcp_dir_z, _mm_sub_pd(_mm_load_pd(bbox_data + m_far_offset[2] + i), m_org_z));
+
+                const __m128d child_tmin = _mm_max_pd(zl1, _mm_max_pd(yl1, _mm_max_pd(xl1, m_ray_tmin)));
+                const __m128d child_tmax = _mm_min_pd(zl2, _mm_min_pd(yl2, _mm_min_pd(xl2, mray_tmax)));
+
+                _mm_store_pd(tmin + i, child_tmin);
+
+                const int misses =
+                    _mm_movemask_pd(
+                        _mm_or_pd(
+                            _mm_cmpgt_pd(child_tmin, child_tmax),
+                            _mm_or_pd(
+                                _mm_cmplt_pd(child_tmax, m_ray_tmin),
+                                _mm_cmpge_pd(child_tmin, mray_tmax))));
+
+                hits |= static_cast<size_t>(misses ^ 3) << i;
+            }
+
+#endif
+
+            return hits;
+        }
+
+      private:
+#ifdef APPLESEED_USE_AVX
+        __m256d m_org_x, m_org_y, m_org_z;
+        __m256d m_rcp_dir_x, m_rcp_dir_y, m_rcp_dir_z;
+        __m256d m_ray_tmin;
+#else
+        __m128d m_org_x, m_org_y, m_org_z;
+        __m128d m_rcp_dir_x, m_rcp_dir_y, m_rcp_dir_z;
+        __m128d m_ray_tmin;
+#endif
+        size_t  m_near_offset[3];
+        size_t  m_far_offset[3];
+    };
+
+    // Single precision, 3D: SSE (four children at a time).
+    template <size_t Arity>
+    class WideNodeKernel<float, 3, Arity>
+    {
+      public:
+        template <typename RayType, typename RayInfoType>
+        WideNodeKernel(
+            const RayType&          ray,
+            const RayInfoType&      ray_info)
+          : m_org_x(_mm_set1_ps(ray.m_org[0]))
+          , m_org_y(_mm_set1_ps(ray.m_org[1]))
+          , m_org_z(_mm_set1_ps(ray.m_org[2]))
+          , m_rcp_dir_x(_mm_set1_ps(ray_info.m_rcp_dir[0]))
+          , m_rcp_dir_y(_mm_set1_ps(ray_info.m_rcp_dir[1]))
+          , m_rcp_dir_z(_mm_set1_ps(ray_info.m_rcp_dir[2]))
+          , m_ray_tmin(_mm_set1_ps(ray.m_tmin))
+        {
+            for (size_t d = 0; d < 3; ++d)
+            {
+                m_near_offset[d] = (d * 2 + 1 - ray_info.m_sgn_dir[d]) * Arity;
+                m_far_offset[d] = (d * 2 + ray_info.m_sgn_dir[d]) * Arity;
+            }
+        }
+
+        size_t intersect(
+            const float*            bbox_data,
+            const float             ray_tmax,
+            float*                  tmin) const
+        {
+            const __m128 mray_tmax = _mm_set1_ps(ray_tmax);
+
+            size_t hits = 0;
+
+            for (size_t i = 0; i < Arity; i += 4)
+            {
+                const __m128 xl1 = _mm_mul_ps(m_rcp_dir_x, _mm_sub_ps(_mm_load_ps(bbox_data + m_near_offset[0] + i), m_org_x));
+                const __m128 xl2 = _mm_mul_ps(m_rcp_dir_x, _mm_sub_ps(_mm_load_ps(bbox_data + m_far_offset[0] + i), m_org_x));
+                const __m128 yl1 = _mm_mul_ps(m_rcp_dir_y, _mm_sub_ps(_mm_load_ps(bbox_data + m_near_offset[1] + i), m_org_y));
+                const __m128 yl2 = _mm_mul_ps(m_rcp_dir_y, _mm_sub_ps(_mm_load_ps(bbox_data + m_far_offset[1] + i), m_org_y));
+                const __m128 zl1 = _mm_mul_ps(m_rcp_dir_z, _mm_sub_ps(_mm_load_ps(bbox_data + m_near_offset[2] + i), m_org_z));
+                const __m128 zl2 = _mm_mul_ps(m_rcp_dir_z, _mm_sub_ps(_mm_load_ps(bbox_data + m_far_offset[2] + i), m_org_z));
+
+                const __m128 child_tmin = _mm_max_ps(zl1, _mm_max_ps(yl1, _mm_max_ps(xl1, m_ray_tmin)));
+                const __m128 child_tmax = _mm_min_ps(zl2, _mm_min_ps(yl2, _mm_min_ps(xl2, mray_tmax)));
+
+                _mm_store_ps(tmin + i, child_tmin);
+
+                const int misses =
+                    _mm_movemask_ps(
+                        _mm_or_ps(
+                            _mm_cmpgt_ps(child_tmin, child_tmax),
+                            _mm_or_ps(
+                                _mm_cmplt_ps(child_tmax, m_ray_tmin),
+                                _mm_cmpge_ps(child_tmin, mray_tmax))));
+
+                hits |= static_cast<size_t>(misses ^ 15) << i;
+            }
+
+            return hits;
+        }
+
+      private:
+        __m128  m_org_x, m_org_y, m_org_z;
+        __m128  m_rcp_dir_x, m_rcp_dir_y, m_rcp_dir_z;
+        __m128  m_ray_tmin;
+        size_t  m_near_offset[3];
+        size_t  m_far_offset[3];
+    };
+
+#endif  // APPLESEED_USE_SSE
+}
+
+
+//
+// Wide BVH intersector.
+//
+// Traverses the wide representation of a foundation::bvh::WideTree and visits
+// the leaf nodes of the underlying binary tree. The Visitor class must conform
+// to the prototype documented in foundation/math/bvh/bvh_intersector.h.
+//
+// Trees that were not collapsed, as well as motion blur traversals, are handled
+// by the binary foundation::bvh::Intersector.
+//
+// StackSize is the maximum depth of the binary tree.
+//
+
+template <
+    typename Tree,
+    typename Visitor,
+    typename Ray,
+    size_t StackSize = 64
+>
+class WideIntersector
+  : public NonCopyable
+{
+  public:
+    typedef typename Tree::NodeType NodeType;
+    typedef typename Tree::WideNodeType WideNodeType;
+    typedef typename NodeType::AABBType AABBType;
+    typedef typename AABBType::ValueType ValueType;
+    typedef Ray RayType;
+    typedef RayInfo<ValueType, AABBType::Dimension> RayInfoType;
+
+    // Intersect a ray with a given BVH without motion.
+    void intersect_no_motion(
+        const Tree&             tree,
+        const RayType&          ray,
+        const RayInfoType&      ray_info,
+        Visitor&                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , TraversalStatistics&  stats
+#endif
+        ) const;
+
+    // Intersect a ray with a given BVH with motion.
+    void intersect_motion(
+        const Tree&             tree,
+        const RayType&          ray,
+        const RayInfoType&      ray_info,
+        const ValueType         ray_time,
+        Visitor&                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , TraversalStatistics&  stats
+#endif
+        ) const;
+
+  private:
+    static const size_t Arity = WideNodeType::MaxChildCount;
+
+    typedef Intersector<Tree, Visitor, Ray, StackSize> BinaryIntersectorType;
+    typedef impl::WideNodeKernel<ValueType, AABBType::Dimension, Arity> KernelType;
+};
+
+
+//
+// WideIntersector class implementation.
+//
+
+template <
+    typename Tree,
+    typename Visitor,
+    typename Ray,
+    size_t StackSize
+>
+void WideIntersector<Tree, Visitor, Ray, StackSize>::intersect_no_motion(
+    const Tree&                 tree,
+    const RayType&              ray,
+    const RayInfoType&          ray_info,
+    Visitor&                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , TraversalStatistics&      stats
+#endif
+    ) const
+{
+    // Make sure the tree was built.
+    assert(!tree.m_nodes.empty());
+
+    // Use binary traversal if the tree has no wide representation.
+    if (!tree.is_collapsed())
+    {
+        BinaryIntersectorType intersector;
+        intersector.intersect_no_motion(
+            tree,
+            ray,
+            ray_info,
+            visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , stats
+#endif
+            );
+        return;
+    }
+
+    // Precompute the ray data used by the node intersection kernel.
+    const KernelType kernel(ray, ray_info);
+
+    // Node stack. A wide node pushes at most Arity - 1 children and replaces at
+    // least one level of the binary tree.
+    uint32 stack[StackSize * (Arity - 1)];
+    uint32* stack_ptr = stack;
+
+    // Current node, initially the root of the wide tree.
+    uint32 node_ref = 0;
+
+    // Initialize traversal statistics.
+    FOUNDATION_BVH_TRAVERSAL_STATS(++stats.m_traversal_count);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t visited_nodes = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t visited_leaves = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t intersected_bboxes = 0);
+    FOUNDATION_BVH_TRAVERSAL_STATS(size_t discarded_nodes = 0);
+
+    // Traverse the tree and intersect leaf nodes.
+    ValueType ray_tmax = ray.m_tmax;
+    while (true)
+    {
+        // Fetch the node.
+        FOUNDATION_BVH_TRAVERSAL_STATS(++visited_nodes);
+
+        if (!WideNodeType::is_leaf_ref(node_ref))
+        {
+            const WideNodeType& node = tree.m_wide_nodes[node_ref];
+
+            FOUNDATION_BVH_TRAVERSAL_STATS(intersected_bboxes += node.get_child_count());
+
+            // Intersect the bounding boxes of all children at once.
+            APPLESEED_SIMD8_ALIGN ValueType tmin[Arity];
+            size_t hits = kernel.intersect(node.get_bbox_data(), ray_tmax, tmin);
+
+            // Sort the children that were hit by decreasing distance.
+            uint32 hit_refs[Arity];
+            ValueType hit_tmin[Arity];
+            size_t hit_count = 0;
+            for (size_t i = 0; hits != 0; ++i, hits >>= 1)
+            {
+                if (hits & 1)
+                {
+                    size_t j = hit_count++;
+                    for (; j > 0 && hit_tmin[j - 1] < tmin[i]; --j)
+                    {
+                        hit_refs[j] = hit_refs[j - 1];
+                        hit_tmin[j] = hit_tmin[j - 1];
+                    }
+                    hit_refs[j] = node.get_child_ref(i);
+                    hit_tmin[j] = tmin[i];
+                }
+            }
+
+            FOUNDATION_BVH_TRAVERSAL_STATS(discarded_nodes += node.get_child_count() - hit_count);
+
+            if (hit_count > 0)
+            {
+                // Push the far child nodes to the stack, continue with the nearest child node.
+                for (size_t i = 0; i < hit_count - 1; ++i)
+                    *stack_ptr++ = hit_refs[i];
+                assert(stack_ptr <= stack + StackSize * (Arity - 1));
+                node_ref = hit_refs[hit_count - 1];
+                continue;
+            }
+
+            // Terminate traversal if the node stack is empty.
+            if (stack_ptr == stack)
+                break;
+
+            // Pop the top node from the stack.
+            node_ref = *--stack_ptr;
+        }
+        else
+        {
+            // Visit the leaf.
+            FOUNDATION_BVH_TRAVERSAL_STATS(++visited_leaves);
+            ValueType distance;
+#ifndef NDEBUG
+            distance = ValueType(-1.0);
+#endif
+            const bool proceed =
+                visitor.visit(
+                    tree.m_nodes[WideNodeType::get_ref_index(node_ref)],
+                    ray,
+                    ray_info,
+                    distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , stats
+#endif
+                    );
+            assert(!proceed || distance >= ValueType(0.0));
+
+            // Terminate traversal if the visitor decided so.
+            if (!proceed)
+                break;
+
+            // Keep track of the distance to the closest intersection.
+            if (ray_tmax > distance)
+                ray_tmax = distance;
+
+            // Terminate traversal if the node stack is empty.
+            if (stack_ptr == stack)
+                break;
+
+            // Pop the top node from the stack.
+            node_ref = *--stack_ptr;
+        }
+    }
+
+    // Store traversal statistics.
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_visited_nodes.insert(visited_nodes));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_visited_leaves.insert(visited_leaves));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_bboxes.insert(intersected_bboxes));
+    FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_discarded_nodes.insert(discarded_nodes));
+}
+
+template <
+    typename Tree,
+    typename Visitor,
+    typename Ray,
+    size_t StackSize
+>
+inline void WideIntersector<Tree, Visitor, Ray, StackSize>::intersect_motion(
+    const Tree&                 tree,
+    const RayType&              ray,
+    const RayInfoType&          ray_info,
+    const ValueType             ray_time,
+    Visitor&                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , TraversalStatistics&      stats
+#endif
+    ) const
+{
+    // Wide nodes only store static bounding boxes.
+    BinaryIntersectorType intersector;
+    intersector.intersect_motion(
+        tree,
+        ray,
+        ray_info,
+        ray_time,
+        visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , stats
+#endif
+        );
+}
+
+}   // namespace bvh
+}   // namespace foundation
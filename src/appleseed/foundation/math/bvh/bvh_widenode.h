@@ -0,0 +1,218 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// Interior node of a wide (4-ary or 8-ary) BVH, obtained by collapsing a binary BVH.
+//
+// Bounding boxes of the child nodes are stored in SoA form so that a ray can be
+// intersected against all of them at once using SIMD instructions:
+//
+//   min.x[0..Arity)  max.x[0..Arity)  min.y[0..Arity)  max.y[0..Arity)  ...
+//
+// A child of a wide node is either another wide node or a leaf node of the
+// binary BVH the wide node was built from. Unused child slots have invalid
+// bounding boxes and are never hit.
+//
+
+template <typename AABB, size_t Arity>
+class APPLESEED_ALIGN(64) WideNode
+{
+  public:
+    typedef AABB AABBType;
+    typedef typename AABBType::ValueType ValueType;
+
+    static_assert(Arity == 4 || Arity == 8, "Wide BVH nodes must have 4 or 8 children");
+
+    static const size_t Dimension = AABBType::Dimension;
+    static const size_t MaxChildCount = Arity;
+
+    // Constructor, creates a node without any child.
+    WideNode();
+
+    // Return the number of children.
+    size_t get_child_count() const;
+
+    // Append a child node.
+    void add_wide_child(const size_t wide_node_index, const AABBType& bbox);
+    void add_leaf_child(const size_t leaf_node_index, const AABBType& bbox);
+
+    // Return the bounding box of a given child.
+    AABBType get_child_bbox(const size_t i) const;
+
+    // Return true if a given child is a leaf node of the binary BVH.
+    bool is_leaf_child(const size_t i) const;
+
+    // Return the index of a given child, either in the vector of wide nodes
+    // or in the vector of binary nodes depending on the type of the child.
+    size_t get_child_index(const size_t i) const;
+
+    // Child references, as used during traversal.
+    static const uint32 LeafFlag = 0x80000000u;
+    uint32 get_child_ref(const size_t i) const;
+    static bool is_leaf_ref(const uint32 ref);
+    static size_t get_ref_index(const uint32 ref);
+
+    // Return a pointer to the SoA bounding box data.
+    const ValueType* get_bbox_data() const;
+
+  private:
+    APPLESEED_SIMD8_ALIGN ValueType m_bbox_data[2 * Dimension * Arity];
+    uint32                          m_child_refs[Arity];
+    uint32                          m_child_count;
+
+    void add_child(const uint32 ref, const AABBType& bbox);
+};
+
+
+//
+// WideNode class implementation.
+//
+
+template <typename AABB, size_t Arity>
+inline WideNode<AABB, Arity>::WideNode()
+  : m_child_count(0)
+{
+    const AABBType invalid_bbox = AABBType::invalid();
+
+    for (size_t i = 0; i < Arity; ++i)
+    {
+        for (size_t d = 0; d < Dimension; ++d)
+        {
+            m_bbox_data[(d * 2 + 0) * Arity + i] = invalid_bbox.min[d];
+            m_bbox_data[(d * 2 + 1) * Arity + i] = invalid_bbox.max[d];
+        }
+
+        m_child_refs[i] = 0;
+    }
+}
+
+template <typename AABB, size_t Arity>
+inline size_t WideNode<AABB, Arity>::get_child_count() const
+{
+    return static_cast<size_t>(m_child_count);
+}
+
+template <typename AABB, size_t Arity>
+inline void WideNode<AABB, Arity>::add_wide_child(const size_t wide_node_index, const AABBType& bbox)
+{
+    assert(wide_node_index < LeafFlag);
+    add_child(static_cast<uint32>(wide_node_index), bbox);
+}
+
+template <typename AABB, size_t Arity>
+inline void WideNode<AABB, Arity>::add_leaf_child(const size_t leaf_node_index, const AABBType& bbox)
+{
+    assert(leaf_node_index < LeafFlag);
+    add_child(static_cast<uint32>(leaf_node_index) | LeafFlag, bbox);
+}
+
+template <typename AABB, size_t Arity>
+inline AABB WideNode<AABB, Arity>::get_child_bbox(const size_t i) const
+{
+    assert(i < m_child_count);
+
+    AABBType bbox;
+
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        bbox.min[d] = m_bbox_data[(d * 2 + 0) * Arity + i];
+        bbox.max[d] = m_bbox_data[(d * 2 + 1) * Arity + i];
+    }
+
+    return bbox;
+}
+
+template <typename AABB, size_t Arity>
+inline bool WideNode<AABB, Arity>::is_leaf_child(const size_t i) const
+{
+    assert(i < m_child_count);
+    return is_leaf_ref(m_child_refs[i]);
+}
+
+template <typename AABB, size_t Arity>
+inline size_t WideNode<AABB, Arity>::get_child_index(const size_t i) const
+{
+    assert(i < m_child_count);
+    return get_ref_index(m_child_refs[i]);
+}
+
+template <typename AABB, size_t Arity>
+inline uint32 WideNode<AABB, Arity>::get_child_ref(const size_t i) const
+{
+    return m_child_refs[i];
+}
+
+template <typename AABB, size_t Arity>
+inline bool WideNode<AABB, Arity>::is_leaf_ref(const uint32 ref)
+{
+    return (ref & LeafFlag) != 0;
+}
+
+template <typename AABB, size_t Arity>
+inline size_t WideNode<AABB, Arity>::get_ref_index(const uint32 ref)
+{
+    return static_cast<size_t>(ref & ~LeafFlag);
+}
+
+template <typename AABB, size_t Arity>
+inline const typename AABB::ValueType* WideNode<AABB, Arity>::get_bbox_data() const
+{
+    return m_bbox_data;
+}
+
+template <typename AABB, size_t Arity>
+inline void WideNode<AABB, Arity>::add_child(const uint32 ref, const AABBType& bbox)
+{
+    assert(m_child_count < Arity);
+
+    const size_t i = m_child_count++;
+
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        m_bbox_data[(d * 2 + 0) * Arity + i] = bbox.min[d];
+        m_bbox_data[(d * 2 + 1) * Arity + i] = bbox.max[d];
+    }
+
+    m_child_refs[i] = ref;
+}
+
+}   // namespace bvh
+}   // namespace foundation
@@ -0,0 +1,126 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/math/bvh/bvh_tree.h"
+#include "foundation/math/bvh/bvh_widenode.h"
+#include "foundation/platform/compiler.h"
+#include "foundation/utility/alignedallocator.h"
+#include "foundation/utility/alignedvector.h"
+
+// Standard headers.
+#include <cstddef>
+
+namespace foundation {
+namespace bvh {
+
+//
+// A binary BVH augmented with a collapsed, wide representation used for traversal.
+//
+// The binary nodes are kept: leaves of the wide BVH are the leaf nodes of the
+// binary BVH, and interior binary nodes remain necessary for motion blur traversal.
+// The wide representation is built by bvh::Collapser once the binary BVH is final.
+//
+
+template <typename NodeVector, size_t Arity>
+class WideTree
+  : public Tree<NodeVector>
+{
+  public:
+    typedef Tree<NodeVector> BinaryTreeType;
+    typedef WideTree<NodeVector, Arity> TreeType;
+    typedef typename BinaryTreeType::NodeType NodeType;
+    typedef typename BinaryTreeType::AllocatorType AllocatorType;
+    typedef WideNode<typename NodeType::AABBType, Arity> WideNodeType;
+    typedef AlignedVector<WideNodeType> WideNodeVectorType;
+
+    static const size_t BranchingFactor = Arity;
+
+    // Constructor.
+    explicit WideTree(const AllocatorType& allocator = AllocatorType());
+
+    // Clear the tree.
+    void clear();
+
+    // Return true if the wide representation of the tree has been built.
+    bool is_collapsed() const;
+
+    // Return the size (in bytes) of this object in memory.
+    size_t get_memory_size() const;
+
+  protected:
+    template <typename Tree>
+    friend class Collapser;
+
+    template <typename Tree, typename Visitor, typename Ray, size_t StackSize>
+    friend class WideIntersector;
+
+    WideNodeVectorType  m_wide_nodes;
+};
+
+
+//
+// WideTree class implementation.
+//
+
+template <typename NodeVector, size_t Arity>
+WideTree<NodeVector, Arity>::WideTree(const AllocatorType& allocator)
+  : BinaryTreeType(allocator)
+  , m_wide_nodes(
+        typename WideNodeVectorType::allocator_type(
+            APPLESEED_ALIGNOF(WideNodeType)))
+{
+}
+
+template <typename NodeVector, size_t Arity>
+void WideTree<NodeVector, Arity>::clear()
+{
+    BinaryTreeType::clear();
+    m_wide_nodes.clear();
+}
+
+template <typename NodeVector, size_t Arity>
+inline bool WideTree<NodeVector, Arity>::is_collapsed() const
+{
+    return !m_wide_nodes.empty();
+}
+
+template <typename NodeVector, size_t Arity>
+size_t WideTree<NodeVector, Arity>::get_memory_size() const
+{
+    return
+          BinaryTreeType::get_memory_size()
+        - sizeof(BinaryTreeType)
+        + sizeof(*this)
+        + m_wide_nodes.capacity() * sizeof(WideNodeType);
+}
+
+}   // namespace bvh
+}   // namespace foundation
@@ -32,6 +32,7 @@
 // Interface headers.
 #include "foundation/math/knn/knn_answer.h"
 #include "foundation/math/knn/knn_builder.h"
+#include "foundation/math/knn/knn_parallelbuilder.h"
 #include "foundation/math/knn/knn_query.h"
 #include "foundation/math/knn/knn_statistics.h"
 #include "foundation/math/knn/knn_tree.h"
@@ -0,0 +1,662 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/knn/knn_node.h"
+#include "foundation/math/knn/knn_tree.h"
+#include "foundation/math/split.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobqueue.h"
+#include "foundation/utility/otherwise.h"
+#include "foundation/utility/stopwatch.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace foundation {
+namespace knn {
+
+//
+// Multithreaded k-d tree builder.
+//
+// The top levels of the tree are built breadth-first on the calling thread, the points of
+// each large node being partitioned by jobs working on disjoint chunks of the node. The
+// remaining subtrees are then built in parallel, one job per subtree.
+//
+// The resulting tree uses the same splitting strategy as knn::Builder and answers queries
+// identically, but its nodes are laid out differently: the top levels, visited by every
+// query, are stored contiguously in breadth-first order, and each subtree occupies its own
+// contiguous block of nodes, which keeps the nodes fetched by a query close in memory.
+//
+
+template <typename T, size_t N>
+class ParallelBuilder
+  : public NonCopyable
+{
+  public:
+    typedef T ValueType;
+    static const size_t Dimension = N;
+
+    typedef Vector<T, N> VectorType;
+    typedef Tree<T, N> TreeType;
+
+    // Minimum number of points in a subtree built by a separate job.
+    static const size_t MinSubtreeSize = 4096;
+
+    // Minimum number of points in a chunk partitioned by a separate job.
+    static const size_t MinChunkSize = 16384;
+
+    // Constructor.
+    explicit ParallelBuilder(TreeType& tree);
+
+    // Build a tree for a given set of points, which will be moved into the tree. The job
+    // queue must be serviced by a job manager and must not contain other jobs. Work is
+    // split into approximately job_count_hint jobs at each step of the construction.
+    template <typename Timer>
+    void build_move_points(
+        std::vector<VectorType>&    points,
+        JobQueue&                   job_queue,
+        const size_t                job_count_hint);
+
+    // Return the construction time.
+    double get_build_time() const;
+
+  private:
+    typedef typename TreeType::NodeType NodeType;
+    typedef AABB<T, N> BboxType;
+    typedef Split<T> SplitType;
+
+    struct Range
+    {
+        size_t                      m_node_index;
+        size_t                      m_begin;
+        size_t                      m_end;
+    };
+
+    struct Subtree
+    {
+        Range                       m_range;
+        std::vector<NodeType>       m_nodes;        // subtree nodes, root first
+    };
+
+    // State shared by the jobs partitioning a node.
+    struct Partitioning
+    {
+        enum Step
+        {
+            ComputeBbox,                            // compute the bounding box of each chunk
+            PartitionChunks,                        // partition each chunk in place
+            ScatterChunks,                          // move the two halves of each chunk to the temporary buffer
+            CopyChunks                              // copy the temporary buffer back into the tree
+        };
+
+        const std::vector<VectorType>&  m_points;
+        std::vector<size_t>&            m_indices;
+        std::vector<size_t>&            m_temp;
+        size_t                          m_begin;
+        size_t                          m_end;
+        size_t                          m_chunk_count;
+        std::vector<BboxType>           m_chunk_bboxes;
+        std::vector<size_t>             m_chunk_left_counts;
+        std::vector<size_t>             m_chunk_left_offsets;
+        std::vector<size_t>             m_chunk_right_offsets;
+        SplitType                       m_split;
+
+        Partitioning(
+            const std::vector<VectorType>&  points,
+            std::vector<size_t>&            indices,
+            std::vector<size_t>&            temp);
+
+        size_t get_chunk_begin(const size_t chunk) const;
+        size_t get_chunk_end(const size_t chunk) const;
+
+        void execute(const Step step, const size_t chunk);
+    };
+
+    class PartitioningJob
+      : public IJob
+    {
+      public:
+        PartitioningJob(
+            Partitioning&                   partitioning,
+            const typename Partitioning::Step step,
+            const size_t                    chunk)
+          : m_partitioning(partitioning)
+          , m_step(step)
+          , m_chunk(chunk)
+        {
+        }
+
+        void execute(const size_t thread_index) override
+        {
+            m_partitioning.execute(m_step, m_chunk);
+        }
+
+      private:
+        Partitioning&                       m_partitioning;
+        const typename Partitioning::Step   m_step;
+        const size_t                        m_chunk;
+    };
+
+    class SubtreeJob
+      : public IJob
+    {
+      public:
+        SubtreeJob(
+            TreeType&                       tree,
+            Subtree&                        subtree)
+          : m_tree(tree)
+          , m_subtree(subtree)
+        {
+        }
+
+        void execute(const size_t thread_index) override
+        {
+            m_subtree.m_nodes.push_back(NodeType());
+
+            partition_recurse(
+                m_tree.m_points,
+                m_tree.m_indices,
+                m_subtree.m_nodes,
+                0,
+                m_subtree.m_range.m_begin,
+                m_subtree.m_range.m_end);
+        }
+
+      private:
+        TreeType&                           m_tree;
+        Subtree&                            m_subtree;
+    };
+
+    class GatherJob
+      : public IJob
+    {
+      public:
+        GatherJob(
+            const TreeType&                 tree,
+            std::vector<VectorType>&        points,
+            const size_t                    begin,
+            const size_t                    end)
+          : m_tree(tree)
+          , m_points(points)
+          , m_begin(begin)
+          , m_end(end)
+        {
+        }
+
+        void execute(const size_t thread_index) override
+        {
+            for (size_t i = m_begin; i < m_end; ++i)
+                m_points[i] = m_tree.m_points[m_tree.m_indices[i]];
+        }
+
+      private:
+        const TreeType&                     m_tree;
+        std::vector<VectorType>&            m_points;
+        const size_t                        m_begin;
+        const size_t                        m_end;
+    };
+
+    TreeType&   m_tree;
+    double      m_build_time;
+
+    // Partition a node whose points are split among several jobs, return the pivot.
+    static size_t partition_node(
+        Partitioning&                   partitioning,
+        NodeType&                       node,
+        const size_t                    child_node_index,
+        const size_t                    begin,
+        const size_t                    end,
+        JobQueue&                       job_queue,
+        const size_t                    job_count_hint);
+
+    // Run one step of the partitioning of a node.
+    static void run_partitioning_step(
+        Partitioning&                   partitioning,
+        const typename Partitioning::Step step,
+        JobQueue&                       job_queue);
+
+    // Recursively build a subtree on the calling thread.
+    static void partition_recurse(
+        const std::vector<VectorType>&  points,
+        std::vector<size_t>&            indices,
+        std::vector<NodeType>&          nodes,
+        const size_t                    node_index,
+        const size_t                    begin,
+        const size_t                    end);
+
+    // Turn a node into an interior node and return the pivot actually used.
+    static size_t make_interior(
+        NodeType&                       node,
+        const SplitType&                split,
+        const size_t                    child_node_index,
+        const size_t                    begin,
+        const size_t                    pivot,
+        const size_t                    end);
+
+    // Append the nodes of a subtree to the tree.
+    static void insert_subtree(
+        TreeType&                       tree,
+        const Subtree&                  subtree);
+};
+
+typedef ParallelBuilder<float, 2>  ParallelBuilder2f;
+typedef ParallelBuilder<double, 2> ParallelBuilder2d;
+typedef ParallelBuilder<float, 3>  ParallelBuilder3f;
+typedef ParallelBuilder<double, 3> ParallelBuilder3d;
+
+
+//
+// Implementation.
+//
+
+template <typename T, size_t N>
+const size_t ParallelBuilder<T, N>::MinSubtreeSize;
+
+template <typename T, size_t N>
+const size_t ParallelBuilder<T, N>::MinChunkSize;
+
+template <typename T, size_t N>
+inline ParallelBuilder<T, N>::ParallelBuilder(TreeType& tree)
+  : m_tree(tree)
+  , m_build_time(0.0)
+{
+}
+
+template <typename T, size_t N>
+template <typename Timer>
+void ParallelBuilder<T, N>::build_move_points(
+    std::vector<VectorType>&    points,
+    JobQueue&                   job_queue,
+    const size_t                job_count_hint)
+{
+    Stopwatch<Timer> stopwatch;
+    stopwatch.start();
+
+    const size_t count = points.size();
+
+    m_tree.m_points.swap(points);
+    m_tree.m_indices.resize(count);
+    for (size_t i = 0; i < count; ++i)
+        m_tree.m_indices[i] = i;
+
+    m_tree.m_nodes.clear();
+    m_tree.m_nodes.reserve(count * 2 + 1);
+    m_tree.m_nodes.push_back(NodeType());
+
+    // Nodes with at most max_subtree_size points are the roots of subtrees built by jobs.
+    const bool parallel = job_count_hint > 1 && count >= 2 * MinSubtreeSize;
+    const size_t max_subtree_size =
+        parallel ? std::max(count / job_count_hint, MinSubtreeSize) : count;
+
+    // Build the top levels of the tree in breadth-first order.
+    std::vector<size_t> temp;
+    Partitioning partitioning(m_tree.m_points, m_tree.m_indices, temp);
+    std::vector<Range> ranges;
+    std::vector<Subtree> subtrees;
+    ranges.push_back(Range{ 0, 0, count });
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        const Range range = ranges[i];
+
+        if (range.m_end - range.m_begin <= max_subtree_size)
+        {
+            subtrees.push_back(Subtree{ range, std::vector<NodeType>() });
+            continue;
+        }
+
+        const size_t left_node_index = m_tree.m_nodes.size();
+        m_tree.m_nodes.push_back(NodeType());
+        m_tree.m_nodes.push_back(NodeType());
+
+        const size_t pivot =
+            partition_node(
+                partitioning,
+                m_tree.m_nodes[range.m_node_index],
+                left_node_index,
+                range.m_begin,
+                range.m_end,
+                job_queue,
+                job_count_hint);
+
+        ranges.push_back(Range{ left_node_index + 0, range.m_begin, pivot });
+        ranges.push_back(Range{ left_node_index + 1, pivot, range.m_end });
+    }
+
+    // Build the subtrees in parallel.
+    if (subtrees.size() > 1)
+    {
+        for (size_t i = 0, e = subtrees.size(); i < e; ++i)
+            job_queue.schedule(new SubtreeJob(m_tree, subtrees[i]));
+        job_queue.wait_until_completion();
+    }
+    else SubtreeJob(m_tree, subtrees[0]).execute(0);
+
+    // Assemble the tree.
+    for (size_t i = 0, e = subtrees.size(); i < e; ++i)
+        insert_subtree(m_tree, subtrees[i]);
+
+    // Store the points in the order of the leaves.
+    if (count > 0)
+    {
+        std::vector<VectorType> sorted_points(count);
+
+        if (parallel)
+        {
+            const size_t chunk_count = std::min(job_count_hint, count / MinSubtreeSize);
+            for (size_t i = 0; i < chunk_count; ++i)
+            {
+                job_queue.schedule(
+                    new GatherJob(
+                        m_tree,
+                        sorted_points,
+                        count * i / chunk_count,
+                        count * (i + 1) / chunk_count));
+            }
+            job_queue.wait_until_completion();
+        }
+        else GatherJob(m_tree, sorted_points, 0, count).execute(0);
+
+        m_tree.m_points.swap(sorted_points);
+    }
+
+    stopwatch.measure();
+    m_build_time = stopwatch.get_seconds();
+}
+
+template <typename T, size_t N>
+inline double ParallelBuilder<T, N>::get_build_time() const
+{
+    return m_build_time;
+}
+
+template <typename T, size_t N>
+size_t ParallelBuilder<T, N>::partition_node(
+    Partitioning&                   partitioning,
+    NodeType&                       node,
+    const size_t                    child_node_index,
+    const size_t                    begin,
+    const size_t                    end,
+    JobQueue&                       job_queue,
+    const size_t                    job_count_hint)
+{
+    const size_t count = end - begin;
+
+    partitioning.m_begin = begin;
+    partitioning.m_end = end;
+    partitioning.m_chunk_count = std::max<size_t>(std::min(job_count_hint, count / MinChunkSize), 1);
+    partitioning.m_chunk_bboxes.resize(partitioning.m_chunk_count);
+    partitioning.m_chunk_left_counts.resize(partitioning.m_chunk_count);
+    partitioning.m_chunk_left_offsets.resize(partitioning.m_chunk_count);
+    partitioning.m_chunk_right_offsets.resize(partitioning.m_chunk_count);
+
+    // Compute the bounding box of the node.
+    run_partitioning_step(partitioning, Partitioning::ComputeBbox, job_queue);
+    BboxType bbox;
+    bbox.invalidate();
+    for (size_t i = 0; i < partitioning.m_chunk_count; ++i)
+        bbox.insert(partitioning.m_chunk_bboxes[i]);
+
+    // Partition each chunk.
+    partitioning.m_split = SplitType::middle(bbox);
+    run_partitioning_step(partitioning, Partitioning::PartitionChunks, job_queue);
+
+    // Compute where the two halves of each chunk go.
+    size_t left_count = 0;
+    for (size_t i = 0; i < partitioning.m_chunk_count; ++i)
+        left_count += partitioning.m_chunk_left_counts[i];
+    size_t left_offset = begin;
+    size_t right_offset = begin + left_count;
+    for (size_t i = 0; i < partitioning.m_chunk_count; ++i)
+    {
+        const size_t chunk_count = partitioning.get_chunk_end(i) - partitioning.get_chunk_begin(i);
+        partitioning.m_chunk_left_offsets[i] = left_offset;
+        partitioning.m_chunk_right_offsets[i] = right_offset;
+        left_offset += partitioning.m_chunk_left_counts[i];
+        right_offset += chunk_count - partitioning.m_chunk_left_counts[i];
+    }
+
+    // Gather the two halves of the node.
+    if (partitioning.m_chunk_count > 1)
+    {
+        partitioning.m_temp.resize(partitioning.m_indices.size());
+        run_partitioning_step(partitioning, Partitioning::ScatterChunks, job_queue);
+        run_partitioning_step(partitioning, Partitioning::CopyChunks, job_queue);
+    }
+
+    return
+        make_interior(
+            node,
+            partitioning.m_split,
+            child_node_index,
+            begin,
+            begin + left_count,
+            end);
+}
+
+template <typename T, size_t N>
+void ParallelBuilder<T, N>::run_partitioning_step(
+    Partitioning&                   partitioning,
+    const typename Partitioning::Step step,
+    JobQueue&                       job_queue)
+{
+    if (partitioning.m_chunk_count > 1)
+    {
+        for (size_t i = 0; i < partitioning.m_chunk_count; ++i)
+            job_queue.schedule(new PartitioningJob(partitioning, step, i));
+        job_queue.wait_until_completion();
+    }
+    else partitioning.execute(step, 0);
+}
+
+template <typename T, size_t N>
+void ParallelBuilder<T, N>::partition_recurse(
+    const std::vector<VectorType>&  points,
+    std::vector<size_t>&            indices,
+    std::vector<NodeType>&          nodes,
+    const size_t                    node_index,
+    const size_t                    begin,
+    const size_t                    end)
+{
+    const size_t count = end - begin;
+
+    if (count <= 1)
+    {
+        NodeType& node = nodes[node_index];
+        node.make_leaf();
+        node.set_point_index(begin);
+        node.set_point_count(count);
+        return;
+    }
+
+    BboxType bbox;
+    bbox.invalidate();
+    for (size_t i = begin; i < end; ++i)
+        bbox.insert(points[indices[i]]);
+
+    const SplitType split = SplitType::middle(bbox);
+
+    const size_t* bound =
+        std::partition(
+            &indices[0] + begin,
+            &indices[0] + end,
+            [&points, &split](const size_t index)
+            {
+                return points[index][split.m_dimension] < split.m_abscissa;
+            });
+
+    const size_t left_node_index = nodes.size();
+    nodes.push_back(NodeType());
+    nodes.push_back(NodeType());
+
+    const size_t pivot =
+        make_interior(
+            nodes[node_index],
+            split,
+            left_node_index,
+            begin,
+            bound - &indices[0],
+            end);
+
+    partition_recurse(points, indices, nodes, left_node_index + 0, begin, pivot);
+    partition_recurse(points, indices, nodes, left_node_index + 1, pivot, end);
+}
+
+template <typename T, size_t N>
+size_t ParallelBuilder<T, N>::make_interior(
+    NodeType&                       node,
+    const SplitType&                split,
+    const size_t                    child_node_index,
+    const size_t                    begin,
+    const size_t                    pivot,
+    const size_t                    end)
+{
+    assert(pivot >= begin);
+    assert(pivot <= end);
+
+    node.make_interior();
+    node.set_split_dim(split.m_dimension);
+    node.set_split_abs(split.m_abscissa);
+    node.set_child_node_index(child_node_index);
+    node.set_point_index(begin);
+    node.set_point_count(end - begin);
+
+    // Given a split-the-longest-axis-in-the-middle strategy, the only case where
+    // the left or right leaf may be empty is when all the points are coincident.
+    // In that degenerate case, we simply split the point set in two.
+    return pivot == begin || pivot == end ? (begin + end) / 2 : pivot;
+}
+
+template <typename T, size_t N>
+void ParallelBuilder<T, N>::insert_subtree(
+    TreeType&                       tree,
+    const Subtree&                  subtree)
+{
+    assert(!subtree.m_nodes.empty());
+
+    // Node k > 0 of the subtree goes to index base + k in the tree.
+    const size_t base = tree.m_nodes.size() - 1;
+
+    for (size_t k = 0, e = subtree.m_nodes.size(); k < e; ++k)
+    {
+        NodeType node = subtree.m_nodes[k];
+
+        if (node.is_interior())
+            node.set_child_node_index(base + node.get_child_node_index());
+
+        if (k == 0)
+            tree.m_nodes[subtree.m_range.m_node_index] = node;
+        else tree.m_nodes.push_back(node);
+    }
+}
+
+template <typename T, size_t N>
+ParallelBuilder<T, N>::Partitioning::Partitioning(
+    const std::vector<VectorType>&  points,
+    std::vector<size_t>&            indices,
+    std::vector<size_t>&            temp)
+  : m_points(points)
+  , m_indices(indices)
+  , m_temp(temp)
+  , m_begin(0)
+  , m_end(0)
+  , m_chunk_count(0)
+{
+}
+
+template <typename T, size_t N>
+inline size_t ParallelBuilder<T, N>::Partitioning::get_chunk_begin(const size_t chunk) const
+{
+    return m_begin + (m_end - m_begin) * chunk / m_chunk_count;
+}
+
+template <typename T, size_t N>
+inline size_t ParallelBuilder<T, N>::Partitioning::get_chunk_end(const size_t chunk) const
+{
+    return m_begin + (m_end - m_begin) * (chunk + 1) / m_chunk_count;
+}
+
+template <typename T, size_t N>
+void ParallelBuilder<T, N>::Partitioning::execute(const Step step, const size_t chunk)
+{
+    const size_t begin = get_chunk_begin(chunk);
+    const size_t end = get_chunk_end(chunk);
+
+    switch (step)
+    {
+      case ComputeBbox:
+        {
+            BboxType& bbox = m_chunk_bboxes[chunk];
+            bbox.invalidate();
+            for (size_t i = begin; i < end; ++i)
+                bbox.insert(m_points[m_indices[i]]);
+        }
+        break;
+
+      case PartitionChunks:
+        {
+            const std::vector<VectorType>& points = m_points;
+            const SplitType& split = m_split;
+            const size_t* bound =
+                std::partition(
+                    &m_indices[0] + begin,
+                    &m_indices[0] + end,
+                    [&points, &split](const size_t index)
+                    {
+                        return points[index][split.m_dimension] < split.m_abscissa;
+                    });
+            m_chunk_left_counts[chunk] = bound - (&m_indices[0] + begin);
+        }
+        break;
+
+      case ScatterChunks:
+        {
+            const size_t pivot = begin + m_chunk_left_counts[chunk];
+            std::copy(&m_indices[0] + begin, &m_indices[0] + pivot, &m_temp[0] + m_chunk_left_offsets[chunk]);
+            std::copy(&m_indices[0] + pivot, &m_indices[0] + end, &m_temp[0] + m_chunk_right_offsets[chunk]);
+        }
+        break;
+
+      case CopyChunks:
+        std::copy(&m_temp[0] + begin, &m_temp[0] + end, &m_indices[0] + begin);
+        break;
+
+      assert_otherwise;
+    }
+}
+
+}   // namespace knn
+}   // namespace foundation
@@ -43,6 +43,8 @@
 DECLARE_TEST_CASE(Foundation_Math_Knn_Builder, Build_GivenZeroPoint_BuildsEmptyTree);
 DECLARE_TEST_CASE(Foundation_Math_Knn_Builder, Build_GivenTwoPoints_BuildsCorrectTree);
 DECLARE_TEST_CASE(Foundation_Math_Knn_Builder, Build_GivenEightPoints_GeneratesFifteenNodes);
+DECLARE_TEST_CASE(Foundation_Math_Knn_ParallelBuilder, BuildMovePoints_GivenZeroPoint_BuildsEmptyTree);
+DECLARE_TEST_CASE(Foundation_Math_Knn_ParallelBuilder, BuildMovePoints_AnswersQueriesLikeSingleThreadedBuilder);
 
 namespace foundation {
 namespace knn {
@@ -72,12 +74,15 @@ class Tree
 
   private:
     template <typename, size_t> friend class Builder;
+    template <typename, size_t> friend class ParallelBuilder;
     template <typename, size_t> friend class Query;
     template <typename> friend class TreeStatistics;
 
     GRANT_ACCESS_TO_TEST_CASE(Foundation_Math_Knn_Builder, Build_GivenZeroPoint_BuildsEmptyTree);
     GRANT_ACCESS_TO_TEST_CASE(Foundation_Math_Knn_Builder, Build_GivenTwoPoints_BuildsCorrectTree);
     GRANT_ACCESS_TO_TEST_CASE(Foundation_Math_Knn_Builder, Build_GivenEightPoints_GeneratesFifteenNodes);
+    GRANT_ACCESS_TO_TEST_CASE(Foundation_Math_Knn_ParallelBuilder, BuildMovePoints_GivenZeroPoint_BuildsEmptyTree);
+    GRANT_ACCESS_TO_TEST_CASE(Foundation_Math_Knn_ParallelBuilder, BuildMovePoints_AnswersQueriesLikeSingleThreadedBuilder);
 
     std::vector<VectorType> m_points;
     std::vector<size_t>     m_indices;
@@ -297,4 +297,378 @@ const double PrecomputedHaltonSequence[4 * PrecomputedHaltonSequenceSize] =
     0.9960937500000000, 0.1495198902606310, 0.0432000000000000, 0.4635568513119533
 };
 
+
+//
+// Generator matrices of the first dimensions of the Sobol sequence.
+//
+// The first dimension is the van der Corput sequence; the other ones are derived from
+// the primitive polynomials and initial direction numbers of the new-joe-kuo-6.21201
+// table.
+//
+
+const uint32 SobolMatrices[SobolDimensionCount][32] =
+{
+    {   // dimension 0
+        0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u, 0x08000000u, 0x04000000u, 0x02000000u, 0x01000000u,
+        0x00800000u, 0x00400000u, 0x00200000u, 0x00100000u, 0x00080000u, 0x00040000u, 0x00020000u, 0x00010000u,
+        0x00008000u, 0x00004000u, 0x00002000u, 0x00001000u, 0x00000800u, 0x00000400u, 0x00000200u, 0x00000100u,
+        0x00000080u, 0x00000040u, 0x00000020u, 0x00000010u, 0x00000008u, 0x00000004u, 0x00000002u, 0x00000001u
+    },
+    {   // dimension 1
+        0x80000000u, 0xC0000000u, 0xA0000000u, 0xF0000000u, 0x88000000u, 0xCC000000u, 0xAA000000u, 0xFF000000u,
+        0x80800000u, 0xC0C00000u, 0xA0A00000u, 0xF0F00000u, 0x88880000u, 0xCCCC0000u, 0xAAAA0000u, 0xFFFF0000u,
+        0x80008000u, 0xC000C000u, 0xA000A000u, 0xF000F000u, 0x88008800u, 0xCC00CC00u, 0xAA00AA00u, 0xFF00FF00u,
+        0x80808080u, 0xC0C0C0C0u, 0xA0A0A0A0u, 0xF0F0F0F0u, 0x88888888u, 0xCCCCCCCCu, 0xAAAAAAAAu, 0xFFFFFFFFu
+    },
+    {   // dimension 2
+        0x80000000u, 0xC0000000u, 0x60000000u, 0x90000000u, 0xE8000000u, 0x5C000000u, 0x8E000000u, 0xC5000000u,
+        0x68800000u, 0x9CC00000u, 0xEE600000u, 0x55900000u, 0x80680000u, 0xC09C0000u, 0x60EE0000u, 0x90550000u,
+        0xE8808000u, 0x5CC0C000u, 0x8E606000u, 0xC5909000u, 0x6868E800u, 0x9C9C5C00u, 0xEEEE8E00u, 0x5555C500u,
+        0x8000E880u, 0xC0005CC0u, 0x60008E60u, 0x9000C590u, 0xE8006868u, 0x5C009C9Cu, 0x8E00EEEEu, 0xC5005555u
+    },
+    {   // dimension 3
+        0x80000000u, 0xC0000000u, 0x20000000u, 0x50000000u, 0xF8000000u, 0x74000000u, 0xA2000000u, 0x93000000u,
+        0xD8800000u, 0x25400000u, 0x59E00000u, 0xE6D00000u, 0x78080000u, 0xB40C0000u, 0x82020000u, 0xC3050000u,
+        0x208F8000u, 0x51474000u, 0xFBEA2000u, 0x75D93000u, 0xA0858800u, 0x914E5400u, 0xDBE79E00u, 0x25DB6D00u,
+        0x58800080u, 0xE54000C0u, 0x79E00020u, 0xB6D00050u, 0x800800F8u, 0xC00C0074u, 0x200200A2u, 0x50050093u
+    },
+    {   // dimension 4
+        0x80000000u, 0x40000000u, 0x20000000u, 0xB0000000u, 0xF8000000u, 0xDC000000u, 0x7A000000u, 0x9D000000u,
+        0x5A800000u, 0x2FC00000u, 0xA1600000u, 0xF0B00000u, 0xDA880000u, 0x6FC40000u, 0x81620000u, 0x40BB0000u,
+        0x22878000u, 0xB3C9C000u, 0xFB65A000u, 0xDDB2D000u, 0x78022800u, 0x9C0B3C00u, 0x5A0FB600u, 0x2D0DDB00u,
+        0xA2878080u, 0xF3C9C040u, 0xDB65A020u, 0x6DB2D0B0u, 0x800228F8u, 0x400B3CDCu, 0x200FB67Au, 0xB00DDB9Du
+    },
+    {   // dimension 5
+        0x80000000u, 0x40000000u, 0x60000000u, 0x30000000u, 0xC8000000u, 0x24000000u, 0x56000000u, 0xFB000000u,
+        0xE0800000u, 0x70400000u, 0xA8600000u, 0x14300000u, 0x9EC80000u, 0xDF240000u, 0xB6D60000u, 0x8BBB0000u,
+        0x48008000u, 0x64004000u, 0x36006000u, 0xCB003000u, 0x2880C800u, 0x54402400u, 0xFE605600u, 0xEF30FB00u,
+        0x7E48E080u, 0xAF647040u, 0x1EB6A860u, 0x9F8B1430u, 0xD6C81EC8u, 0xBB249F24u, 0x80D6D6D6u, 0x40BBBBBBu
+    },
+    {   // dimension 6
+        0x80000000u, 0xC0000000u, 0xA0000000u, 0xD0000000u, 0x58000000u, 0x94000000u, 0x3E000000u, 0xE3000000u,
+        0xBE800000u, 0x23C00000u, 0x1E200000u, 0xF3100000u, 0x46780000u, 0x67840000u, 0x78460000u, 0x84670000u,
+        0xC6788000u, 0xA784C000u, 0xD846A000u, 0x5467D000u, 0x9E78D800u, 0x33845400u, 0xE6469E00u, 0xB7673300u,
+        0x20F86680u, 0x104477C0u, 0xF8668020u, 0x4477C010u, 0x668020F8u, 0x77C01044u, 0x8020F866u, 0xC0104477u
+    },
+    {   // dimension 7
+        0x80000000u, 0x40000000u, 0xA0000000u, 0x50000000u, 0x88000000u, 0x24000000u, 0x12000000u, 0x2D000000u,
+        0x76800000u, 0x9E400000u, 0x08200000u, 0x64100000u, 0xB2280000u, 0x7D140000u, 0xFEA20000u, 0xBA490000u,
+        0x1A248000u, 0x491B4000u, 0xC4B5A000u, 0xE3739000u, 0xF6800800u, 0xDE400400u, 0xA8200A00u, 0x34100500u,
+        0x3A280880u, 0x59140240u, 0xECA20120u, 0x974902D0u, 0x6CA48768u, 0xD75B49E4u, 0xCC95A082u, 0x87639641u
+    },
+    {   // dimension 8
+        0x80000000u, 0x40000000u, 0xA0000000u, 0x50000000u, 0x28000000u, 0xD4000000u, 0x6A000000u, 0x71000000u,
+        0x38800000u, 0x58400000u, 0xEA200000u, 0x31100000u, 0x98A80000u, 0x08540000u, 0xC22A0000u, 0xE5250000u,
+        0xF2B28000u, 0x79484000u, 0xFAA42000u, 0xBD731000u, 0x18A80800u, 0x48540400u, 0x622A0A00u, 0xB5250500u,
+        0xDAB28280u, 0xAD484D40u, 0x90A426A0u, 0xCC731710u, 0x20280B88u, 0x10140184u, 0x880A04A2u, 0x84350611u
+    },
+    {   // dimension 9
+        0x80000000u, 0x40000000u, 0xE0000000u, 0xB0000000u, 0x98000000u, 0x94000000u, 0x8A000000u, 0x5B000000u,
+        0x33800000u, 0xD9C00000u, 0x72200000u, 0x3F100000u, 0xC1B80000u, 0xA6EC0000u, 0x53860000u, 0x29F50000u,
+        0x0A3A8000u, 0x1B2AC000u, 0xD392E000u, 0x69FF7000u, 0xEA380800u, 0xAB2C0400u, 0x4BA60E00u, 0xFDE50B00u,
+        0x60028980u, 0xF006C940u, 0x7834E8A0u, 0x241A75B0u, 0x123A8B38u, 0xCF2AC99Cu, 0xB992E922u, 0x82FF78F1u
+    },
+    {   // dimension 10
+        0x80000000u, 0x40000000u, 0xA0000000u, 0x10000000u, 0x08000000u, 0x6C000000u, 0x9E000000u, 0x23000000u,
+        0x57800000u, 0xADC00000u, 0x7FA00000u, 0x91D00000u, 0x49880000u, 0xCED40000u, 0x880A0000u, 0x2C0F0000u,
+        0x3E0D8000u, 0x3317C000u, 0x5FB06000u, 0xC1F8B000u, 0xE18D8800u, 0xB2D7C400u, 0x1E106A00u, 0x6328B100u,
+        0xF7858880u, 0xBDC3C2C0u, 0x77BA63E0u, 0xFDF7B330u, 0xD7800DF8u, 0xEDC0081Cu, 0xDFA0041Au, 0x81D00A2Du
+    },
+    {   // dimension 11
+        0x80000000u, 0x40000000u, 0x20000000u, 0x30000000u, 0x58000000u, 0xAC000000u, 0x96000000u, 0x2B000000u,
+        0xD4800000u, 0x09400000u, 0xE2A00000u, 0x52500000u, 0x4E280000u, 0xC71C0000u, 0x629E0000u, 0x12670000u,
+        0x6E138000u, 0xF731C000u, 0x3A98A000u, 0xBE449000u, 0xF83B8800u, 0xDC2DC400u, 0xEE06A200u, 0xB7239300u,
+        0x1AA80D80u, 0x8E5C0EC0u, 0xA03E0B60u, 0x703701B0u, 0x783B88C8u, 0x9C2DCA54u, 0xCE06A74Au, 0x87239795u
+    },
+    {   // dimension 12
+        0x80000000u, 0xC0000000u, 0xA0000000u, 0x50000000u, 0xF8000000u, 0x8C000000u, 0xE2000000u, 0x33000000u,
+        0x0F800000u, 0x21400000u, 0x95A00000u, 0x5E700000u, 0xD8080000u, 0x1C240000u, 0xBA160000u, 0xEF370000u,
+        0x15868000u, 0x9E6FC000u, 0x781B6000u, 0x4C349000u, 0x420E8800u, 0x630BCC00u, 0xF7AD6A00u, 0xAD739500u,
+        0x77800780u, 0x6D4004C0u, 0xD7A00420u, 0x3D700630u, 0x2F880F78u, 0xB1640AD4u, 0xCDB6077Au, 0x824706D7u
+    },
+    {   // dimension 13
+        0x80000000u, 0xC0000000u, 0x60000000u, 0x90000000u, 0x38000000u, 0xC4000000u, 0x42000000u, 0xA3000000u,
+        0xF1800000u, 0xAA400000u, 0xFCE00000u, 0x85100000u, 0xE0080000u, 0x500C0000u, 0x58060000u, 0x54090000u,
+        0x7A038000u, 0x670C4000u, 0xB3842000u, 0x094A3000u, 0x0D6F1800u, 0x2F5AA400u, 0x1CE7CE00u, 0xD5145100u,
+        0xB8000080u, 0x040000C0u, 0x22000060u, 0x33000090u, 0xC9800038u, 0x6E4000C4u, 0xBEE00042u, 0x261000A3u
+    },
+    {   // dimension 14
+        0x80000000u, 0x40000000u, 0x20000000u, 0xF0000000u, 0xA8000000u, 0x54000000u, 0x9A000000u, 0x9D000000u,
+        0x1E800000u, 0x5CC00000u, 0x7D200000u, 0x8D100000u, 0x24880000u, 0x71C40000u, 0xEBA20000u, 0x75DF0000u,
+        0x6BA28000u, 0x35D14000u, 0x4BA3A000u, 0xC5D2D000u, 0xE3A16800u, 0x91DB8C00u, 0x79AEF200u, 0x0CDF4100u,
+        0x672A8080u, 0x50154040u, 0x1A01A020u, 0xDD0DD0F0u, 0x3E83E8A8u, 0xACCACC54u, 0xD52D529Au, 0xD91D919Du
+    },
+    {   // dimension 15
+        0x80000000u, 0xC0000000u, 0x20000000u, 0xD0000000u, 0xD8000000u, 0xC4000000u, 0x46000000u, 0x85000000u,
+        0xA5800000u, 0x76C00000u, 0xADA00000u, 0x6AB00000u, 0x2DA80000u, 0xAABC0000u, 0x0DAA0000u, 0x7AB10000u,
+        0xD5A78000u, 0xBEBD4000u, 0x93A3E000u, 0x3BB51000u, 0x3629B800u, 0x4D727C00u, 0x9B836200u, 0x27C4D700u,
+        0xB629B880u, 0x8D727CC0u, 0xBB836220u, 0xF7C4D7D0u, 0x6E29B858u, 0x49727C04u, 0xFD836266u, 0x72C4D755u
+    }
+};
+
+
+//
+// A 64x64 blue noise mask.
+//
+
+const uint16 BlueNoiseMask[BlueNoiseMaskSize * BlueNoiseMaskSize] =
+{
+    1205,  722, 3243, 3936, 1166, 3105, 3623,  742,  247, 1852, 3007, 1148, 1975, 3832,  269, 1503,
+    3035, 1667, 2876,  165, 2230, 3088, 1737,  191, 3558, 1350,  431, 3355, 3051, 1938,  913, 3239,
+    1295, 2245,  757, 3167, 2613, 3568, 1806, 2115, 3258, 1081, 3535,  599,   38, 3934, 2359,  774,
+    2869, 1336,  897, 2560,    7, 3857, 2083, 3203,  149,  857, 3747, 1268, 3307, 2240,  368, 3534,
+    2019, 2743, 3478,  498, 2654,    6, 2227, 3825, 2595, 3366, 1603,  640, 3466, 2695, 2226,  693,
+    3311, 1912, 3867, 1377, 3731, 2485,  699, 3877, 2999, 1000, 3953,  775, 1693, 2678, 4074, 2487,
+     128, 3696, 1704, 1169,  347, 2308, 3834,  447,  783, 2862, 1775, 2018, 3697, 3015,  384, 3382,
+     169, 3759, 1981, 1125, 3286, 1379, 1699, 2755, 3921, 2322, 3504, 2679,  753,  998, 1589, 3084,
+    1392,  282, 1662, 2104,  852, 1529, 3218,  443, 1408,  917, 4007, 2479,  403, 1777,  938, 4060,
+      87, 2447,  814,  323, 2721, 3261, 1141, 1564, 2093, 2605, 2261,   35, 1409,  499, 3437,  339,
+    2777, 1899, 3901, 2934,   40, 3377, 1031, 3060, 1420, 2397,  296, 2664,  869, 1639, 1098, 1840,
+    3156, 1550, 2727, 3564,  398, 2935,  981,  465, 1884, 1104, 1492,   56, 2052, 3689, 2427,  556,
+    3847, 1044, 2365, 3766, 2929, 3543, 1062, 1982, 2837, 2305,  140, 1302, 3259, 2942, 3677, 1367,
+    2809, 1195, 3618, 2116, 1822,  921,  408, 3448,  252, 1767, 3216, 2817, 3547, 2076, 1127, 1560,
+     825, 3345,  597, 2468, 1534, 2740, 1953, 3682,  118, 4069, 3426, 1263, 3248, 2512, 2217, 3972,
+     577, 2410,  266, 1778, 2194, 2475,  750, 3606, 3059, 2158,  596, 3139, 4078, 1818, 2856, 3280,
+    2589, 1883, 3162, 1274,  225, 1783, 2469, 3954,  613, 3071, 3607, 2096,  764, 1558,  224, 2027,
+    2319, 3159,  559, 3420, 1484, 4002, 2873, 2377, 3688, 1227,  568, 3800,  960, 2402, 3852, 2951,
+    2204, 1354,  977, 2082, 4025, 1272,  553, 1691, 2260, 2973, 1593,  666, 3870,  133, 1390, 3517,
+     991, 2949,  816, 4015, 1486, 3376, 3820, 1300,  211, 2824, 3404, 2504,  414, 1153,  181,  824,
+    3576,   59, 3985,  539, 2726,  754, 3284,  298, 1657, 1158, 1823, 2719, 3912, 1105, 2546, 3402,
+     416, 1012, 1688, 2933,   14, 2219,  656, 1937, 3065,  842, 1504, 1972,  310, 3104, 1812,   78,
+    3595, 2625, 3161,  402, 3556,  799, 3285, 2602,  894, 1146,  495, 2169, 1931, 2851,  444, 2633,
+    2034, 3694, 1231, 3174,  564,  107, 2044, 2632, 1749, 3967,  731, 1627, 1353, 3482, 2292, 1553,
+     668, 2985,  957, 2253, 1463, 3649, 2137, 1332, 3785, 3473,  487,   36, 2267, 3114,  594, 1842,
+    3964, 2680, 3743, 1232, 2519, 3822, 1345, 2706,  178, 4059, 2473, 3339, 2666, 1289,  735,  525,
+    3996, 1641,  204, 2313, 1832, 3002,  222, 2043, 3892, 2791, 3645, 3140,  959, 3782,  733, 3068,
+    1707,   71, 2301, 1921, 2752, 1056, 3115, 1545,  352, 2345,  988, 1993, 2978, 2710, 3919, 2127,
+    1380, 1718, 2508, 3441, 1929, 3010,  111, 2609,  813, 2417, 2925,  970, 3711, 1647, 3506,  872,
+    1459,  146, 1973,  744, 3315,  994,  458, 1623, 3474, 1084, 2903,  101, 1652, 3685, 2298, 3237,
+    1997, 1164, 2870, 3722, 1060, 1479, 2433, 3520,  357, 1385,   11, 2456, 1753, 3453, 1522, 1114,
+    3325,  365, 1424, 3842, 3492, 2401,  851, 3672, 1213, 3220, 3548, 3791,  280,  882,  494, 3317,
+    2823,  354, 3733, 1168,  424, 4094, 1038, 3179, 1863, 1490, 3318, 2053, 1376,  309, 2774, 2998,
+    2164, 3251, 2387,  281, 3017, 1831, 3634, 3143, 2266, 1867,  691, 2157, 3916,  898, 2807, 1489,
+    2495,  849, 3375,  563, 2725, 3810,  688, 3108, 1874, 1629, 3374, 2674, 1282,  202, 2352, 2119,
+    4079, 2522, 2861,  711,  420, 1793, 3915, 2952,  547, 2135,   30, 2593, 1802, 3151, 1115, 1945,
+    4026, 2175, 3145,  782, 1573, 2818,  615, 2271, 3835,  362, 2660,  698, 4056, 2381, 1181, 3860,
+     501, 1299, 3565, 4050, 1537, 2126, 2620,  810,  337, 3751, 1441,  492, 3439, 1132,  381, 3525,
+     152, 3882, 1372, 2139, 1744,   68, 1237, 2235, 1006, 3969,  779, 2073,  394, 3924, 2750,  576,
+    3561,  940, 3197, 1646, 1184, 2200,  141, 2543, 1905, 2804, 1467,  649, 1276, 2431, 3610,   96,
+     933, 1326,  230, 2681, 3356, 2407, 1721, 1267,  220, 3445, 1110, 3147, 1746,  180, 1928,  770,
+    2608, 1726,  975, 2756,  604, 1171,  131, 3977, 1280, 2409, 3219, 2994, 2540, 1773, 2101, 3029,
+     680, 1895, 3086,  327, 2575, 4093, 3412, 2812,  489, 2385, 3202, 1135, 3708, 3013,  863, 1836,
+     313, 1316, 1986, 3774, 2690, 3435, 1381,  743, 3299, 1071, 4045, 3438, 2255, 3858, 1544, 2617,
+    3489, 2373, 1803, 3778, 2061,   21, 3906, 3579, 2891, 1959, 2213,  548, 3570, 2534, 3334, 3661,
+      75, 3125, 2280,  399, 3458, 2444, 2900, 3329, 1720, 2760,  952, 1955,  262, 1360, 4048, 2652,
+    1600, 2378, 3669,  965, 3250, 1585,  828, 2007, 3633,  119, 2893,  605, 1903, 1405, 3288, 1613,
+    2943, 2428,   23,  624, 2997,  277, 3992, 1594, 3638,  401, 1715, 3014,  826,  251,  566, 2909,
+     700, 3192, 1074,  521, 1410,  912, 3073,  727, 1547,  935, 3946, 1319, 2816, 1521, 1043, 2074,
+    2880, 1572, 3749, 1948,  877, 3846, 1453, 2033,  621,   86, 3929, 3581,  740, 3291,    1, 3617,
+     886,  442, 2825, 1177, 2287,  232, 3016, 1363, 1762, 2601, 1536, 3447, 2207, 2553,  127, 3639,
+    2160, 3982, 3397, 1020, 2071, 2346, 3107,  903, 2459, 2161,  113, 2717, 1882, 3332, 2102, 1672,
+     145, 1976, 3960, 2983, 3532, 2555, 1850,  419, 2711, 2441,   64, 3038,  344,  820, 4000,  578,
+    1217,  286, 3300, 1358, 3005, 1785,  324, 1028, 3505, 2183, 1215, 1615, 2341, 2854, 1079, 2239,
+    1293, 3358, 3975, 1801,  626, 3574, 2466,  383, 3786, 1185, 4038,  931,  427, 3841, 1058,  714,
+    1196, 2648, 1483, 3718, 1740, 1161,  509, 1939, 2889, 1249, 3764,  982, 1406, 3106, 1198, 3667,
+    2516, 1487, 2734,  265, 2233, 1220, 3230, 2140, 3674, 3305, 1701, 3767, 2294, 1844, 3204, 2467,
+    2201, 3884,  695, 2532,   26, 2257, 3223, 3701, 2501, 2970,  452, 2663, 3830, 1857,  593, 3178,
+    2022,  187, 2547, 1465, 2110, 3914, 1068, 3352,  705, 2078,  246, 3098, 2374, 1789, 2762, 3177,
+     241, 1881,  455,  784, 2826, 3252, 3848,  182, 3529, 3196,  544, 2558, 3940,  367, 2279, 3880,
+     476, 3396,  870, 1716,  671, 4049,  142, 1022, 1366,  642, 2046, 1167, 3436, 2684,  134, 1407,
+    3541, 1731, 2733, 1121, 4037,  529, 2704, 1626,  707, 1394, 3168,  874,  329, 1428, 3671, 2941,
+    1683, 3803,  793, 3150,   45, 2919, 1880, 2782, 2307, 3194, 2698, 1664,  665, 3516, 1383, 3905,
+    2276, 3025, 3337, 2482,  307, 1348, 2577, 1679,  706, 1485, 2336, 1978, 3471,  745, 2770, 1019,
+    3036, 1308, 3642, 2403, 2914, 1523, 3418, 2759, 3845,  273, 2592,  896,  496, 1608, 3706, 2928,
+     433,  926, 3066, 2064, 3524,  836, 1243, 3826,  173, 1920, 4084, 3388, 2112, 2488,  964,  275,
+    2361,  518, 2736, 3528, 1320,  451, 1570,  881,  104, 1451, 3654, 1264, 2926,   41, 2040,  500,
+    1624, 3614,  984, 2108, 4016, 3472, 2243, 1011, 2783, 4086,  233, 1730, 2969,    8, 1578, 1858,
+    2197,  102, 2028,  355, 3770, 1914,  534, 2335, 1751, 2981, 1497, 4077, 3152, 2122,  726, 1085,
+    1941, 3354,  255, 1554, 2425, 1847, 3040, 2095, 2815, 2326, 1113, 1719,   65, 2776, 3444, 4004,
+    1512, 1156, 1907,  951, 2225, 3844, 2566, 3512, 4006,  540, 1962,  974, 3780, 3331, 2453,  873,
+    2867, 1298,  110, 1826, 1538,  580,   43, 3755, 2058, 1172, 3349,  856, 1304, 2434, 3580, 3240,
+    3797, 1122, 2697, 3195,  955, 2582, 1183, 3137,  798, 2176, 3557,   92, 2820, 1307, 3868, 2339,
+    2610, 3994,  639, 3691, 1365,  114, 3440,  971,  364, 3636,  600, 3056, 3758, 1260, 1838,  702,
+    3233, 3009, 3745, 2474, 3321,  664, 3078, 1754, 1118, 3276, 2218, 2561,  388, 1833, 1136, 4076,
+    2624,  660, 3792, 3135, 2714,  835, 2959, 1807, 3100,  425, 2662, 3702, 2136, 3997,  573,  792,
+    2843, 1653, 3952,  730, 1396, 3533,   34, 3986,  438, 3351, 1070, 1889, 2399,  322, 1743, 3241,
+      51, 1256, 2236, 2842, 3191,  485, 2515, 3966, 1466, 3249, 2607,  829, 1552,  483, 2229, 2639,
+      95, 2087,  366, 1669,  166, 1238, 2042,  274, 2411, 2848,  184, 3945,  762, 1514, 3199, 2154,
+     330, 3464, 2395, 1094, 2272, 3406, 1252, 3631, 2429,  646, 1598, 3164, 1040,  312, 2587, 1450,
+     415, 2311,  193, 1814, 2956, 2212, 1610, 1989, 2868, 1349, 2533,  662, 3658,  945, 3465,  569,
+    2984, 1645,  958, 1911, 3812,  786, 1702, 2224, 1206, 1819,  208, 2416, 2912, 3310, 3878,  997,
+    3571, 1388,  781, 4075, 2767, 1507, 3679, 2967,  804, 1346, 1622, 3538, 2763, 3030,  157, 3686,
+    1728, 1949, 1429,  194, 3959, 2011,  258, 1470,  932, 3920, 2290,  156, 2897, 1747, 1985, 3415,
+     950, 3566, 2520, 3293,  506, 3727, 2448,  908, 3806,  179, 1685, 3935, 3069, 2701, 2013, 1439,
+    3829, 2486, 3611,  219, 1151, 2644, 3367, 2948,  682, 3575, 2059, 4011, 1144, 1963,  245, 1689,
+    2511, 2888, 3411, 2344, 3165,  526,  990, 3908, 2148, 3414,  628, 1902, 1049, 2254, 1368,  583,
+    2922,  807, 3295, 3018,  517, 1677, 2853, 2591,  389, 3460, 1933, 1391, 3336, 3843, 1193, 3081,
+    4058,  654, 1286, 2072, 1073,  303, 3394,  601, 2668, 3247, 2147,  467, 1528, 1178,  223, 2177,
+     830,  436, 3129, 2758, 2085, 1516,  332, 3874,   17, 2715,  937, 3413,  370, 1423, 3144, 3714,
+     541, 1225, 1824, 1064, 2167, 3519, 1893, 2594,  376, 3087, 3720, 2450,  453, 3817, 3383, 2549,
+    1201, 3898, 2650, 1017, 3596,  721, 3205, 3783, 2123, 1202, 2792,  765,  531, 2398,   54, 2174,
+    1848, 2687, 1574, 3837, 3061, 2781, 1258, 1499, 1875, 1102, 2947,  855, 2299, 3373, 4017, 2904,
+    3542, 1809, 1386,  659, 4073, 2379, 1027, 1950, 1347, 3046, 1582, 2288,  708, 2830, 2389,  854,
+    2057, 3923,  143,  435, 2670,  759,    9, 1568, 1099, 1763,  106, 1269, 2702, 1992,  915, 1642,
+      20, 2114,  341, 1531, 2445, 2215, 1076, 1817,   61, 3077, 4036, 1686, 3659, 2618,  840, 1435,
+     405, 2879, 3496,  153,  834, 1748, 4035, 2337, 3467,  250, 3772, 3567,   13, 1827,  687, 2581,
+    1066, 2334, 3338,   70, 3500, 2892,  551, 3172, 3729, 2484,  513, 3787, 1766, 3536,   82, 2720,
+    1511, 3266, 2989, 3693, 1436, 3981, 2932, 2300, 3324, 2772, 3965,  843, 3224,  299, 4005, 3062,
+    2350, 3666, 2814, 1896, 4067,  162, 1359, 3372,  638, 2505,  985,  248, 2048, 2939, 3234, 3725,
+    2371, 1045,  591, 2265, 1971, 2559,   79, 3131,  723, 2056, 1401, 2454, 2723, 3110, 1310, 1628,
+     343, 3879, 2010, 1208, 1604,  880, 3621, 1733, 2150,  284, 1112, 3238, 2031, 1291, 4054, 1052,
+    2237,  669, 2528, 1680, 2020, 3198, 1288, 3765,  679, 2012, 1412, 2362, 3544, 1808, 1462,  704,
+    3462,  486, 1281,  861, 3316, 2905, 2619, 3887, 1559, 3546, 2314, 1342, 3451, 1117, 1611,  212,
+    3384, 3099, 3943, 1413, 3277, 3681,  490, 1018, 3881, 2849, 1709,  567,  956, 2005, 3801,  168,
+    3244,  801, 2692, 3053, 2231, 2588,  150, 1191, 2768,  787, 3918, 2640,  229, 2996,  482, 3369,
+    1853,  321, 3494,  868, 1108,  221, 2471,  457,  953, 3599,  264, 2991,  592, 2216, 2878, 1134,
+    2026, 3184, 1757, 3763,  618,  301, 2017,  889,  462, 2992, 1855, 2766,  429,  651, 3890, 1927,
+    1253, 2596, 1722,  257, 1175, 2887, 1617, 2205, 2629,  338, 1165, 4090, 3328,  441, 3594, 2394,
+    2840, 1750,  514, 3676,  361, 1879, 3958, 3306, 1434, 3461, 1908, 1518,  879, 2470, 1661, 3735,
+    2857, 1364, 3900, 2368,  546, 2796, 3428, 1723, 2196, 3121, 2567, 1607, 1059,  115, 3779, 2655,
+     234,  989, 2521, 1477, 2286, 3117, 1666, 3643, 1251, 2131,  185, 3976, 3173, 2525, 2211,  892,
+      46, 2099,  712, 3762, 2414,  878, 3554, 1311, 1843, 3664, 3175, 2251, 1555, 2975, 1128, 2165,
+    1442, 4032, 1026, 1334, 3221,  713, 2419, 2961,  581, 2320,   57, 3102, 3613, 2185, 1189,  760,
+    2583,   39, 3113, 2124, 3662, 1864, 4071, 1498,   63, 3855, 1222, 1932, 4043, 3294, 2421, 1344,
+    3588, 3001, 3989,   88, 3510, 1106, 2430, 2789, 3222,  772, 3724,  947, 1496, 1759, 3573, 2822,
+    4080, 1548, 3469, 2682,  349, 2066, 3082,  612, 3417,  167,  802, 2536,  279, 1868,  859,  607,
+    3475,   84, 2506, 2106, 3821, 1526, 1003,  328, 1690, 4014, 1067, 2805,  606, 3839,  302, 3215,
+    1990,  968, 1602, 1203, 2958,  748, 2635, 1054, 2850,  511, 3379,  719, 2745,  417, 1687,  670,
+    1873,  446, 2098, 2737,  747, 1935,  390, 4028,    3, 1625, 2646, 2392, 1176,  291, 3008,  520,
+    2317, 3171, 1023, 2971, 1799, 4010,   27, 2370, 1502, 2950, 2041, 1284, 3712, 2794, 3930, 2622,
+    3091, 1946, 3353, 2920,  249, 2729, 3493, 2029, 3660, 2541, 1333, 2063, 3408, 1752, 1411, 2347,
+    3948, 3604,  463, 3357,  171, 1356,  314, 3274, 2388, 1787, 2129, 3683,  943, 3138, 2152, 3932,
+    3391,  853, 1618, 1246, 3270, 3836, 1431, 1005, 2192, 3348,  549, 3502, 2039, 3862,  812, 1378,
+    3652,  215, 1987,  468, 1440, 3268, 1140, 3808, 2753,  996, 3978,  643, 3386,  190, 1711, 1200,
+     407, 1595,  645,  871, 1792, 2295, 1265, 3134,  811,  183, 3256,  430,  941, 2656,  160, 2937,
+     637, 2730, 1820, 2517, 3926, 2284, 2023, 3748,  831, 2995, 1292,  290, 2496, 1505, 1157,   31,
+    2366, 2859, 3740, 2263,  535, 2988, 1779, 2526, 2923, 1322, 1830, 3072,   99, 2716, 3303, 1849,
+     630, 2801, 1241, 3872,  684, 2571,  827, 1961,  396, 1668, 2435, 3055, 1416, 2321, 2089, 3602,
+    3854, 2426, 1290, 3646, 3913,    0,  545, 2863, 1845, 3853, 2270, 1609, 3042, 4089, 1892, 3486,
+    1111, 1472, 2149,  791, 3067, 1644, 3551,  582, 1471, 3956,   97, 3457, 1967, 2940, 3628, 2673,
+    1403, 3201, 1042,  151, 2627, 3597,  243,  678, 3760,  306, 3933,  734, 1458, 2248, 1095, 2551,
+     936, 3421, 2463, 2191, 3487, 1692, 2871, 2264, 3605, 3340,   93, 1890,  911,  523, 3236, 1004,
+     148, 2784, 2186, 3039, 1041, 2576, 3555, 1565, 1130, 2696,  697, 3750, 2461, 1239,  815, 2252,
+     340, 3265,  100, 3769, 1016,  404, 2786, 1162, 3193, 2612, 2277, 1637, 3828,  359,  818,  588,
+    1804,  319, 1996, 4063, 1520, 2117,  904, 3430, 1984, 2303, 1047, 2802, 3585, 1655,  374, 3805,
+    1769,   60, 1566, 3122,  334, 3728,  196, 1338,  555, 1179, 2689, 3883, 3498, 2578, 2910, 1509,
+     768, 3450, 1703,  308, 1452, 3231, 2054, 4047,  378, 3449, 1426, 1977,   48,  530, 3663, 3094,
+    1678, 3974, 2860, 1296, 3470, 1964, 2464,  217, 1764,  920,  471, 2775, 1069, 3263, 2198, 3885,
+    3485, 2974, 2489,  696, 3301, 1160, 3097, 2693, 1597, 1226, 3187, 2446,  510, 3987, 3012, 2130,
+    1373, 2908, 4019,  844, 1093, 1900, 3048, 4051, 3200, 2075,  736, 1549,  297, 1229, 4066, 1951,
+    3149,  505, 2645, 3984, 1913,  631, 2462,  905, 2182,  206, 2896,  993, 3342, 2747, 1374, 2564,
+    2003,  916, 2340, 2653,  655, 1532, 3037, 4023, 2170, 3409, 3699,  689, 1397, 1861, 2572, 1212,
+    1579,  927, 3650, 1314, 1741, 2372,   49, 3998,  464, 3703,  201,  875, 2002, 1278,  174, 3257,
+    3716, 2384,  536, 2070, 2713, 1475, 2483,  942, 1631, 2400, 2960, 3680, 2222, 1770,   83, 2386,
+    3734, 2113, 1182,  847, 3341,  122, 1321, 3021, 1739, 3183, 2354, 3619, 1633, 2132, 3861,  226,
+     617, 3583,  456, 1772, 3279,   28, 3640,  752, 1343, 1915, 2986, 2424, 4095,  261, 3130,   76,
+    2316,  484, 2764,  216, 3831,  561, 2890, 1872, 1382, 2573, 3371, 1781, 2858, 3454, 2647,  758,
+    1891,  259, 1210, 3350, 3612,  124,  674, 2797,  342, 3807, 1063,  472, 3290, 2836,  644, 1050,
+    1402,  236, 3592, 2894, 2293, 3815, 2769, 3648,  481, 3875, 1216,  672,  300, 2987, 1072, 3308,
+    1581, 1221, 3132, 2084, 3903, 1133, 2302, 2865,  350, 1083,  112, 1567, 3326,  966, 2845, 2077,
+    3971, 3347, 1917, 3153, 2153, 3477, 1029, 3609,  725, 3028, 2166, 3795,  623, 1541, 2297, 1039,
+    3103, 2510, 3888, 1670, 2241, 3226, 3907, 2006, 3333,   42, 1418, 1924,  858, 2538, 3833, 3390,
+    3034, 1841, 2502, 1542,  426, 1676, 1097,  756, 2565, 1513, 1930, 2659, 4021, 1788,  776, 2283,
+    2874, 4057, 2477,  311, 1415,  846, 2631, 1682, 3254, 3886, 2705, 2030, 3569,  602, 1706, 3695,
+     739, 1425, 1090, 2600,  838, 1563, 2478, 2065,  278, 1632,  980,   66, 1197, 4064,  393, 3553,
+     608, 1433, 2831,  795,  400, 1025, 1297, 1729, 3522, 2190, 2671, 3142, 3590, 1287, 1606,  345,
+    2724, 3922,  954,  677, 3163, 1957, 3395, 2142,   33, 3480,  930,  409, 3253, 2465,   72, 3726,
+    1904,  195, 1002, 2795, 3452, 3756,  449, 1970, 3598,  657, 2289, 1234,  386, 2376, 1329, 2658,
+     292, 3033, 1675,  353, 4039,  147, 1324, 3271, 2785, 3957, 2406, 3207, 2552, 2982, 2049, 1638,
+    3278, 3752,   12, 1952, 3022, 2641, 2369,  508,  833, 1194, 4031, 1694,  177, 2330, 2008,  806,
+    2209,   58, 1271, 3491, 4082,  192, 2443, 1341, 3973, 2821, 3133, 2060, 1422, 3539, 1245, 2700,
+    1474, 3360,  718, 1821, 2246, 1601, 3109, 2440,  214, 1482,  909, 3119, 3804, 2927, 1877, 1035,
+    3508, 2420, 3789, 2206, 3370, 2677,  610, 3678, 1149,  439, 1923, 1399, 3615,  809,  155, 2761,
+     891, 2178, 1147, 3431, 4092, 1494, 3777, 2846, 3063, 2458,  686,  406, 2977, 3938,  570, 3188,
+    3656, 1732, 2963, 2067, 2672, 1010, 3090,  554, 1765, 2318, 1138, 3768,  598, 2193,  901, 3096,
+     543, 2105, 3816, 3031,  138,  611, 1262, 1033, 4042, 2881, 1810, 3399,    5,  796, 3955, 3182,
+     125, 2004,  653, 1250, 2921, 1755, 1969, 3057, 2269,  862, 3433,  560, 1760, 2259, 3859, 1303,
+    2628,  473, 1735, 2327,  667,  186, 1846,  356, 3655, 1539, 2047, 3427,  999, 2787, 1204, 2472,
+    1481, 3320,  533, 2349,  294, 1430, 3732, 2902,  839,  382, 1612,  139, 2954, 1742, 3970,  348,
+    3624, 1100, 2524, 1340, 3925, 2667, 3272, 2144, 3501, 2556,  477, 2068, 1614, 2507, 2180,  542,
+    1588, 2811,  893, 3632,  428, 1013, 3895,   16, 1583, 3775, 2913, 2683,  317, 1096, 3378, 1870,
+    3995, 2955, 3627, 2554, 3169,  919, 2120, 3313, 1055,  105, 3873, 2568, 1445, 1829, 3753,  369,
+     910, 2615, 1109, 3823, 1636,  701, 1885, 3527, 2530, 3866, 3304, 2732,  771, 3419, 2579, 1561,
+    2331, 2901, 1671,  411, 3476,  922, 1894,   67,  749, 1357, 3849, 1124, 2800, 3741, 1419, 1192,
+    3330, 4013, 2531, 1444, 3126, 2393,  766, 1370, 2574,  253, 2111, 4024, 1527, 3154, 2383,  267,
+    1449, 1008,  116, 1584, 1228, 3540, 1400, 2699, 2306, 1734, 3185,  800, 2250,   37, 3363, 2134,
+    4020,  129, 1925, 3563, 2808, 3260, 2220, 1180,  260, 2090, 1309, 1862, 2380, 1088,  240, 1966,
+    3312,   15,  780, 2000, 2291, 2829, 3687, 1648, 3027, 2273,  285, 3245,  694,  197, 3526, 3000,
+     326, 2268, 1713,   98, 3429, 2138, 2771, 3511, 3189, 1795, 1244,  972,  627, 3709, 2841,  732,
+    3422, 3058, 1988,  558, 3909, 2899,  263, 4022,  584, 1209, 2885,  478, 3559, 3064,  648, 1571,
+    2866, 3148,  741, 1301,  422, 3962,   52, 1535, 3176,  983, 3593, 4072,  502, 3080, 3819, 1317,
+     963, 3730, 3190, 4065, 1163,  270, 1438,  532, 3961, 2739, 1727, 3644, 2348,  969, 1991, 1798,
+    2694, 1065,  587, 3802, 1851,  318, 4081, 1092,  512, 2449, 3393, 3019, 1954,   55, 1665, 2121,
+     418, 2418, 3742, 2748, 2249, 1897,  769, 2481, 3490, 1994, 3776, 1375, 1906, 1046, 2669, 1247,
+    1790, 2258, 3400, 2537, 2051,  902, 2709, 2357, 2972,  661, 2603,   77, 1454, 2155, 3503,  622,
+    2685, 1811, 1469, 2597,  663, 3401, 2404, 3170, 1077,  866, 1943, 1273, 3047, 2599,  493, 3869,
+     819, 3600, 3264, 2855, 1188, 1530,  675, 1940, 3739,  158,  785, 2214, 3549, 2542, 1187, 3840,
+    1337, 1725,  823, 1103,  379, 3283, 1673, 3024,  929,  161, 2731,  333, 3988, 2497, 3692,  283,
+    3856,  976,  199, 1491, 3052, 1782, 3784,  527, 3380, 1697, 2009, 2898,  895, 1654, 2803, 2405,
+     170, 3049,  454, 2162, 2962, 1774, 3761, 2021, 2611,  395, 3443,  109, 3979, 1457, 3381, 2223,
+     272, 1362, 2035, 2351,  883, 3074, 2642, 2275, 2916, 1643, 3896, 1331,  377, 2793,  923, 3211,
+     130, 2616, 3481, 3112, 1493,   29, 3707, 1313, 2172, 1556, 3387, 2353, 1651,  822, 2050, 2979,
+     528, 2437, 3620, 4040,  603, 1129, 3499, 1398,  315, 3897, 1199, 3719, 3186,  392, 3993, 1170,
+    2055, 3894, 3513, 1048,   85, 1328,  805,  205, 3550, 1515, 2877, 2163,  658, 1684, 1143, 2895,
+    3111, 1616, 2584,  209, 3939, 3364,   53, 3641, 1432,  986, 2688, 3289, 1784, 3983,  552, 2262,
+    2931, 4055,  650, 2079, 3850, 2363, 2665,  474, 3949, 3118, 1086,  625, 3267,  189, 3483, 1448,
+    3209, 1186, 1695, 2143, 2872,  136, 2590, 1919, 2187,  773, 2455,  200, 2281, 1856,  720, 3385,
+    1404,  848, 1659, 2514, 3273, 3991, 2819, 2228, 1233, 3811, 2415, 3213,  413, 3723, 2476,   47,
+    4030,  716, 3738,  497, 1916, 1681, 1240,  450, 2094, 3127,  614,  218, 2367, 1508, 3635, 1909,
+    1437,  239, 1230, 1816,  906, 3405, 1159, 1869,  724, 2545, 3668, 2092, 1277, 2778, 1839, 2304,
+     703, 2718,  325, 3302,  821, 2342, 3180,  962, 3578, 2765, 1525, 3322, 1034, 3647, 2544,  316,
+    2883, 2309,  595, 3626, 1942,  358, 1591, 3128,  565, 1796,  778, 1051, 1922, 2779,  890, 2086,
+    1835, 1255, 3235, 1021, 2976, 3586, 2422,  841, 3999, 2498, 3521, 1998, 1101, 3075,  763, 3346,
+    2141, 3572, 2833, 2529,  524, 2957,  237, 3584, 2806,   81, 1758,  445, 2945, 4083,  899,   10,
+    3911, 3537, 1898, 1325, 3757, 1586, 3931, 1259,   44, 3101, 4046,  437, 1351, 3004, 1590, 1980,
+    3232, 3794,  242, 1154, 2746, 2343,  948, 3902, 2563,   18, 3362, 4070, 1371, 3141, 3616,  371,
+    3416, 2735, 2396, 2173, 1393,  685, 2780, 3262, 1768,  304, 1279, 3781, 2864,    2, 2586, 1032,
+    2432, 1658,  346, 3910, 2195, 1621, 3227, 2032, 1460, 1001, 3865, 2460, 1506, 3622, 1142, 2570,
+    1619, 3041,  973, 2513,  228, 2024,  469, 2968, 1708,  635, 1837, 2107, 2722,  579, 3942,   32,
+     979, 2621, 1776, 3157, 1387,  683, 3468, 2037, 1119, 2993, 2133, 2626,  244, 1587, 2324, 1123,
+     590, 1533,  164, 3509,  351, 3917, 1960,  120, 1014, 2966, 1569,  710, 2188, 1714, 3715,  480,
+     850, 3292, 3045, 1061, 3721, 1330,  797, 4033, 2312, 3344, 3044,  790, 2210,  288, 3181, 2015,
+     397, 2199,  562, 2834, 3591,  717, 3425, 2634, 2364, 3673, 1137, 2499,  864, 3495, 2247, 1266,
+    3562, 1510, 2171, 4087,   91, 3698, 2907,  440, 1473, 3754, 1705,  507, 3456,  729, 3871, 2557,
+    3076, 3968,  924, 2911, 1620, 2604, 1145, 3809, 2296, 3423, 2649, 4061,  380, 3158, 1323, 3947,
+     154, 1888, 1488,  673,   50, 2744, 2492,  335,  586, 1235,  172, 1934, 3432,  609, 2741, 1312,
+    3798, 3282, 1455, 4053, 1756, 1150, 2159, 1417,  900,  271, 3389, 3799,  144, 3089, 1815, 2799,
+     728,  488, 2990,  884, 2490, 1878, 1650, 3327,  213, 2382,  885, 1270, 2944, 2181,   89, 1805,
+    1335, 2045, 3684, 1860, 3275,  572, 2145, 3054, 1443,  519, 1910,  918, 2413, 3459, 2038, 2738,
+    3630, 2325, 2614, 3488, 1979, 3123, 1745, 3530, 2886, 1630, 2569, 3818, 1037, 1674, 2356, 3560,
+     767, 1078,   74, 2333, 3116, 2742,  132, 3990, 3212, 1983, 2813, 1395, 1635,  385, 1024, 2423,
+    3319, 3891, 1965,  305, 3269, 1211, 2285,  808, 2703, 3582, 3093, 3950, 1956, 2707,  939, 3577,
+    2844,  276,  761, 2480,   22, 1294, 3603,  794,  198, 3670, 2827, 1219,  103, 1524,  641, 1126,
+    3206,  516, 4085, 1224, 2274,  887, 3927, 1089, 2156, 3717, 3208, 1361, 2832, 4008,  117, 1828,
+    2906, 2598, 1995, 3392,  860,  375, 3700, 1576, 2936,  475,  709, 2323, 3246, 4029, 2069, 3690,
+     123, 1327, 2691, 1057, 3793,  538, 2838, 4012, 1369,  620, 1825,  176, 1080, 3713, 3214, 1640,
+     466, 3359, 2203, 1075, 4088, 2754, 1791, 3343, 2527, 1649, 2118, 3281, 3032, 3736, 1794, 2924,
+    1421,  987, 1696,  289, 3314,  460, 1476,  108, 1886,  751,  491,  254, 2091,  876, 3092,  504,
+    1519, 3899,  293, 1663, 1318, 2494, 1901, 1009, 2234, 1275, 3904, 1854, 2657, 1174,  616, 1557,
+    2938, 1717, 2256, 3070, 1540, 3531,  268, 2025, 1036, 3242, 2221, 2503,  387, 1464,  636, 2390,
+    1236, 2637, 3790, 1468, 3003, 2332,  961,  391, 3980, 1091,  690, 3863,  459, 2518, 2238,  235,
+    2708, 3827, 2103, 2980, 3705, 2810, 2442, 3434, 3079, 2676, 2328, 1577, 3335, 2535, 3710, 1218,
+    2151, 3497,  652, 3023, 3944, 3518,  537, 3296, 2548,    4, 3601,  888,  207, 3020, 3523, 2580,
+     925,  360, 3463,  692, 2109, 2550, 1780, 3851,   73, 2643, 1575, 3773, 3368, 2884, 2088, 4001,
+     867, 3095, 1736,  227,  550, 3228, 1580, 1999, 2917, 2315,  256, 1865, 1305,  949, 4003,  738,
+    3298, 2457,   80,  788, 1834, 1306,  647, 3814,  914, 1223, 3941, 3608, 1082, 1918,  320, 2408,
+    3229,  978, 2728, 2278, 1120, 2100,  755, 3838, 3050, 1700, 2749, 3407, 1478, 2208,  423, 1947,
+    3746, 2360, 4044,   19, 1285,  865, 3160, 1456, 2930, 3484,  479,  832, 1173, 1786,   62, 3507,
+     363, 1944, 3629,  715, 2097, 3552,   90, 3796, 1355, 3155, 2606, 3514, 2790, 1634, 3446, 1968,
+    1261, 1551, 3120, 1131, 2630, 2242, 1596, 2016,  331, 2875, 1800,   69,  634, 2965, 1461,  777,
+    3788, 1738,  231, 1414,  412, 2847, 1813, 1446,  336, 1152, 2036,  557, 2451, 3876, 1315,  746,
+    3124, 1155, 1859, 3297, 2712, 3704,  421, 2329,  737, 1242, 2062, 4052, 2686, 3043, 2282, 1389,
+    2500, 2773, 1139, 3928, 2452, 1254, 2651,  789,  515, 3637, 1517,  817, 2146,   24, 3006,  410,
+     589, 3744, 3410,  373, 3893, 3515,  137, 3287, 2493, 1495, 3217, 2189, 2636, 4027, 3398, 2788,
+      25, 1958, 3146, 3657, 2585, 3255,   94, 2355, 3675,  803, 4018, 3166, 1015, 1761, 3323, 2661,
+     159, 1500, 2835,  574, 1660, 2184, 1116, 3365, 1866, 3653, 2438, 1656,  238,  681, 3824,  995,
+    3210,  135, 1562, 2953,  934, 3361, 2852, 1797, 2202, 1053,  203, 3963, 3225, 1107, 3651, 2338,
+     907, 1724, 2168, 2839,  946,  571, 2946, 4068, 1030,  522, 3545,  837, 1339, 1712,  461, 2125,
+    1248, 3951, 2375,  845, 1592, 4091,  967, 3403, 2915, 2179, 1546,  121, 2828,  287, 3625, 2081,
+    3937,  992, 2436, 3813,  210, 3011, 4009, 2757,  126,  372, 3085,  944, 3309, 1936, 3589,  470,
+    1710, 3455, 2244,  434, 1871, 1480,  295, 4041, 3424, 3026, 1974, 2439,  632, 1427, 2638, 1887,
+    4034, 2491,  163, 1447, 1926, 2412, 1698, 1283, 2128, 2751, 3771,  175, 2391, 3136, 1007, 3587,
+    2562,  575, 1087, 3442,  503, 2014, 1257, 2675,  585, 1876, 2509, 3737, 1207, 2310,  619, 1599,
+    2964,  448, 3479, 2001, 1384,  928,  629, 1543, 2523, 3889, 1352, 2232, 2798, 1501, 1214, 2623,
+    2080, 4062,  633, 3083, 3665, 2358,  676, 1190, 2539, 1605,  432, 2882, 1771, 3864,  188, 2918
+};
+
 }   // namespace foundation
@@ -30,6 +30,7 @@
 #pragma once
 
 // appleseed.foundation headers.
+#include "foundation/math/hash.h"
 #include "foundation/math/vector.h"
 #include "foundation/platform/arch.h"
 #include "foundation/platform/types.h"
@@ -52,7 +53,6 @@ namespace foundation
 //   implement specializations of Halton and Hammersley sequences generators for bases (2,3).
 //   implement incremental radical inverse (for successive input values).
 //   implement vectorized radical inverse functions with SSE2.
-//   implement Sobol sequence generator.
 //
 
 
@@ -199,6 +199,83 @@ Vector<T, Dim> hammersley_zaremba_sequence(
     const size_t        i);             // sample number
 
 
+//
+// Base-2 digits manipulation functions.
+//
+
+// Reverse the order of the bits of a 32-bit integer.
+uint32 reverse_bits(uint32 value);
+
+// Convert 32 base-2 digits (most significant digit first) to a value in [0, 1).
+template <typename T>
+T digits_to_unit_interval(const uint32 digits);
+
+// Nested uniform scrambling (Owen scrambling) in base 2 of 32 digits (most significant
+// digit first), driven by a hash-based permutation. Each digit is flipped or not based
+// on the value of the seed and of all the more significant digits.
+uint32 owen_scramble(
+    const uint32        digits,         // input digits
+    const uint32        seed);          // scrambling seed, should be well mixed
+
+
+//
+// Sobol sequences of arbitrary dimensions (up to SobolDimensionCount).
+//
+// All return values are in the interval [0, 1)^Dim.
+//
+// References:
+//
+//   Constructing Sobol sequences with better two-dimensional projections
+//   https://web.maths.unsw.edu.au/~fkuo/sobol/joe-kuo-notes.pdf
+//
+//   Practical Hash-based Owen Scrambling
+//   http://www.jcgt.org/published/0009/04/01/
+//
+
+// Generator matrices of the first dimensions of the Sobol sequence, one column per input digit.
+const size_t SobolDimensionCount = 16;
+extern const uint32 SobolMatrices[SobolDimensionCount][32];
+
+// Return the digits of the i'th sample of the Sobol sequence in a given dimension.
+uint32 sobol_sample_digits(
+    const size_t        dimension,      // dimension, must be less than SobolDimensionCount
+    uint32              i);             // sample number
+
+// Return the i'th sample of the Sobol sequence in a given dimension.
+template <typename T>
+T sobol_sample(
+    const size_t        dimension,      // dimension, must be less than SobolDimensionCount
+    const uint32        i);             // sample number
+
+// Return the i'th sample of a Sobol sequence.
+template <typename T, size_t Dim>
+Vector<T, Dim> sobol_sequence(
+    const uint32        i);             // sample number
+
+// Return the i'th sample of an Owen-scrambled Sobol sequence. The order of the samples
+// is also shuffled (preserving the stratification of aligned blocks of 2^k samples) so
+// that sequences with different seeds are uncorrelated and can be used for padding.
+template <typename T, size_t Dim>
+Vector<T, Dim> owen_scrambled_sobol_sequence(
+    const uint32        seed,           // scrambling seed
+    const uint32        i);             // sample number
+
+
+//
+// A 64x64 blue noise mask generated with the void-and-cluster method. Each entry is
+// the rank of the pixel in [0, 4096): the pixels of rank less than any given value
+// are uniformly distributed and well separated. The mask tiles seamlessly.
+//
+// Reference:
+//
+//   The void-and-cluster method for dither array generation
+//   http://cv.ulichney.com/papers/1993-void-cluster.pdf
+//
+
+const size_t BlueNoiseMaskSize = 64;
+extern const uint16 BlueNoiseMask[BlueNoiseMaskSize * BlueNoiseMaskSize];
+
+
 //
 // Base-2 radical inverse functions implementation.
 //
@@ -2597,4 +2674,112 @@ inline Vector<T, Dim> hammersley_zaremba_sequence(
     return p;
 }
 
+
+//
+// Base-2 digits manipulation functions implementation.
+//
+
+inline uint32 reverse_bits(uint32 value)
+{
+    value = (value >> 16) | (value << 16);                                                      // 16-bit swap
+    value = ((value & 0xFF00FF00u) >> 8) | ((value & 0x00FF00FFu) << 8);                        // 8-bit swap
+    value = ((value & 0xF0F0F0F0u) >> 4) | ((value & 0x0F0F0F0Fu) << 4);                        // 4-bit swap
+    value = ((value & 0xCCCCCCCCu) >> 2) | ((value & 0x33333333u) << 2);                        // 2-bit swap
+    value = ((value & 0xAAAAAAAAu) >> 1) | ((value & 0x55555555u) << 1);                        // 1-bit swap
+    return value;
+}
+
+template <>
+inline float digits_to_unit_interval<float>(const uint32 digits)
+{
+    // Only keep 24 digits to make sure the result is never rounded up to 1.0.
+    return static_cast<float>(digits >> 8) * (1.0f / 16777216.0f);
+}
+
+template <>
+inline double digits_to_unit_interval<double>(const uint32 digits)
+{
+    return static_cast<double>(digits) * (1.0 / 4294967296.0);
+}
+
+inline uint32 owen_scramble(
+    const uint32        digits,
+    const uint32        seed)
+{
+    // Laine-Karras permutation applied to the reversed digits: the multiplications
+    // propagate the influence of each bit to the more significant bits only.
+    uint32 x = reverse_bits(digits);
+    x += seed;
+    x ^= x * 0x6C50B47Cu;
+    x ^= x * 0xB82F1E52u;
+    x ^= x * 0xC7AFE638u;
+    x ^= x * 0x8D22F6E6u;
+    return reverse_bits(x);
+}
+
+
+//
+// Sobol sequences implementation.
+//
+
+inline uint32 sobol_sample_digits(
+    const size_t        dimension,
+    uint32              i)
+{
+    assert(dimension < SobolDimensionCount);
+
+    const uint32* column = SobolMatrices[dimension];
+    uint32 digits = 0;
+
+    for (; i > 0; i >>= 1, ++column)
+    {
+        if (i & 1)
+            digits ^= *column;
+    }
+
+    return digits;
+}
+
+template <typename T>
+inline T sobol_sample(
+    const size_t        dimension,
+    const uint32        i)
+{
+    return digits_to_unit_interval<T>(sobol_sample_digits(dimension, i));
+}
+
+template <typename T, size_t Dim>
+inline Vector<T, Dim> sobol_sequence(
+    const uint32        i)
+{
+    static_assert(Dim <= SobolDimensionCount, "foundation::sobol_sequence() expects Dim <= SobolDimensionCount");
+
+    Vector<T, Dim> p;
+
+    for (size_t d = 0; d < Dim; ++d)
+        p[d] = sobol_sample<T>(d, i);
+
+    return p;
+}
+
+template <typename T, size_t Dim>
+inline Vector<T, Dim> owen_scrambled_sobol_sequence(
+    const uint32        seed,
+    const uint32        i)
+{
+    static_assert(Dim <= SobolDimensionCount, "foundation::owen_scrambled_sobol_sequence() expects Dim <= SobolDimensionCount");
+
+    const uint32 index = owen_scramble(i, hash_uint32(seed));
+
+    Vector<T, Dim> p;
+
+    for (size_t d = 0; d < Dim; ++d)
+    {
+        const uint32 digits = sobol_sample_digits(d, index);
+        p[d] = digits_to_unit_interval<T>(owen_scramble(digits, mix_uint32(seed, static_cast<uint32>(d))));
+    }
+
+    return p;
+}
+
 }   // namespace foundation
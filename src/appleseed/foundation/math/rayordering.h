@@ -0,0 +1,175 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace foundation
+{
+
+//
+// Generate an ordering of a stream of 3D rays such that consecutive rays are likely
+// to traverse the same parts of an acceleration structure: rays are first grouped by
+// direction octant, then sorted along a Morton curve spanning the bounding box of the
+// ray origins, and finally along a coarse Morton curve over their directions.
+//
+// keys is scratch storage owned by the caller so that its memory can be reused from
+// one stream to the next. Streams may contain at most 2^25 rays.
+//
+// Reference:
+//
+//   Fast Ray Sorting and Breadth-First Packet Traversal for GPU Ray Tracing
+//   Kirill Garanzha, Charles Loop
+//   Eurographics 2010
+//
+
+template <typename Ray>
+void coherent_ray_ordering(
+    std::vector<size_t>&    ordering,
+    std::vector<uint64>&    keys,
+    const Ray*              rays,
+    const size_t            count);
+
+
+//
+// Implementation.
+//
+
+namespace impl
+{
+    // Spread the lower 10 bits of x such that there are two zero bits between each of them.
+    inline uint32 spread_bits_3d(uint32 x)
+    {
+        x &= 0x000003FFu;
+        x = (x | (x << 16)) & 0x030000FFu;
+        x = (x | (x <<  8)) & 0x0300F00Fu;
+        x = (x | (x <<  4)) & 0x030C30C3u;
+        x = (x | (x <<  2)) & 0x09249249u;
+        return x;
+    }
+
+    // Layout of the sort keys, from the most to the least significant bits:
+    //   3 bits of direction octant,
+    //   27 bits of Morton code of the origin (9 bits per dimension),
+    //   9 bits of Morton code of the absolute direction (3 bits per dimension),
+    //   25 bits of ray index.
+    const size_t RayOrderingIndexBits = 25;
+}
+
+template <typename Ray>
+void coherent_ray_ordering(
+    std::vector<size_t>&    ordering,
+    std::vector<uint64>&    keys,
+    const Ray*              rays,
+    const size_t            count)
+{
+    typedef typename Ray::ValueType ValueType;
+    typedef AABB<ValueType, 3> AABBType;
+
+    assert(ordering.empty());
+    assert(count <= (size_t(1) << impl::RayOrderingIndexBits));
+
+    if (count == 0)
+        return;
+
+    // Compute the bounding box of the ray origins.
+    AABBType bbox;
+    bbox.invalidate();
+    for (size_t i = 0; i < count; ++i)
+        bbox.insert(rays[i].m_org);
+
+    // Compute the scale factors that map the bounding box to the 9-bit grid.
+    const ValueType GridSize(511.0);
+    ValueType scale[3];
+    for (size_t d = 0; d < 3; ++d)
+    {
+        const ValueType extent = bbox.max[d] - bbox.min[d];
+        scale[d] = extent > ValueType(0.0) ? GridSize / extent : ValueType(0.0);
+    }
+
+    // Compute the sort keys.
+    keys.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Ray& ray = rays[i];
+
+        const uint32 octant =
+              (ray.m_dir[0] < ValueType(0.0) ? 4 : 0)
+            | (ray.m_dir[1] < ValueType(0.0) ? 2 : 0)
+            | (ray.m_dir[2] < ValueType(0.0) ? 1 : 0);
+
+        uint32 org_morton = 0;
+        for (size_t d = 0; d < 3; ++d)
+        {
+            const uint32 cell = static_cast<uint32>((ray.m_org[d] - bbox.min[d]) * scale[d]);
+            org_morton |= impl::spread_bits_3d(std::min<uint32>(cell, 511)) << (2 - d);
+        }
+
+        // Quantize the absolute direction, relative to its largest component, to a 3-bit grid.
+        const ValueType abs_dir[3] =
+        {
+            std::abs(ray.m_dir[0]),
+            std::abs(ray.m_dir[1]),
+            std::abs(ray.m_dir[2])
+        };
+        const ValueType max_abs_dir = std::max(abs_dir[0], std::max(abs_dir[1], abs_dir[2]));
+        const ValueType dir_scale = max_abs_dir > ValueType(0.0) ? ValueType(8.0) / max_abs_dir : ValueType(0.0);
+        uint32 dir_morton = 0;
+        for (size_t d = 0; d < 3; ++d)
+        {
+            const uint32 cell = static_cast<uint32>(abs_dir[d] * dir_scale);
+            dir_morton |= impl::spread_bits_3d(std::min<uint32>(cell, 7)) << (2 - d);
+        }
+
+        const uint64 code =
+              (static_cast<uint64>(octant) << 36)
+            | (static_cast<uint64>(org_morton) << 9)
+            | static_cast<uint64>(dir_morton);
+
+        keys[i] = (code << impl::RayOrderingIndexBits) | static_cast<uint64>(i);
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    const uint64 IndexMask = (uint64(1) << impl::RayOrderingIndexBits) - 1;
+    ordering.resize(count);
+    for (size_t i = 0; i < count; ++i)
+        ordering[i] = static_cast<size_t>(keys[i] & IndexMask);
+}
+
+}   // namespace foundation
@@ -35,7 +35,7 @@
 #include "foundation/image/color.h"
 #include "foundation/image/colorspace.h"
 #include "foundation/image/image.h"
-#include "foundation/math/cdf.h"
+#include "foundation/math/aliastable.h"
 #include "foundation/math/scalar.h"
 #include "foundation/math/vector.h"
 #include "foundation/utility/job/iabortswitch.h"
@@ -100,14 +100,25 @@ class ImageImportanceSampler
         Payload&            payload,
         Importance&         probability) const;
 
+    // Same as above, and also return a uniform sample in [0,1)^2 within the chosen
+    // pixel, made of the bits of s left over after choosing the pixel.
+    void sample(
+        const Vector2Type&  s,
+        size_t&             x,
+        size_t&             y,
+        Payload&            payload,
+        Importance&         probability,
+        Vector2Type&        jitter) const;
+
     // Return the probability density of a given pixel.
     Importance get_pdf(
         const size_t        x,
         const size_t        y) const;
 
   private:
-    typedef CDF<size_t, Importance> RowCDF;
-    typedef CDF<Payload, Importance> ColCDF;
+    // Rows and columns are sampled in constant time using alias tables.
+    typedef AliasTable<size_t, Importance> RowCDF;
+    typedef AliasTable<Payload, Importance> ColCDF;
 
     const size_t            m_width;
     const size_t            m_height;
@@ -266,6 +277,45 @@ inline void ImageImportanceSampler<Payload, Importance>::sample(
     assert(probability > Importance(0.0));
 }
 
+template <typename Payload, typename Importance>
+inline void ImageImportanceSampler<Payload, Importance>::sample(
+    const Vector2Type&      s,
+    size_t&                 x,
+    size_t&                 y,
+    Payload&                payload,
+    Importance&             probability,
+    Vector2Type&            jitter) const
+{
+    if (m_rows_cdf.valid())
+    {
+        // Select a row.
+        const typename RowCDF::ItemWeightPair& row = m_rows_cdf.sample_and_remap(s[1], jitter[1]);
+        assert(row.second != Importance(0.0));
+        y = row.first;
+
+        // Select a column within this row.
+        const typename ColCDF::ItemWeightPair& col = m_cols_cdf[y].sample_and_remap(s[0], jitter[0]);
+        assert(col.second != Importance(0.0));
+        x = &col - &m_cols_cdf[y][0];
+
+        payload = col.first;
+        probability = row.second * col.second;
+    }
+    else
+    {
+        // Uniform random sampling.
+        x = truncate<size_t>(s[0] * m_width);
+        y = truncate<size_t>(s[1] * m_height);
+        jitter[0] = frac(s[0] * m_width);
+        jitter[1] = frac(s[1] * m_height);
+
+        payload = m_cols_cdf[y][x].first;
+        probability = m_rcp_pixel_count;
+    }
+
+    assert(probability > Importance(0.0));
+}
+
 template <typename Payload, typename Importance>
 inline Importance ImageImportanceSampler<Payload, Importance>::get_pdf(
     const size_t            x,
@@ -30,11 +30,13 @@
 #pragma once
 
 // appleseed.foundation headers.
+#include "foundation/math/hash.h"
 #include "foundation/math/permutation.h"
 #include "foundation/math/primes.h"
 #include "foundation/math/qmc.h"
 #include "foundation/math/rng/distribution.h"
 #include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
 #include "foundation/utility/test/helpers.h"
 
 // Standard headers.
@@ -59,11 +61,19 @@ namespace foundation
 //   - Cranley-Patterson rotation
 //   - Monte Carlo padding
 //
-// Reference:
+// or, in Sobol mode:
+//
+//   - deterministic sampling based on the first four dimensions of the Sobol sequence
+//   - hash-based Owen scrambling and shuffling, seeded by the dimension of each split
+//
+// References:
 //
 //   Kollig and Keller, Efficient Multidimensional Sampling
 //   www.uni-kl.de/AG-Heinrich/EMS.pdf
 //
+//   Burley, Practical Hash-based Owen Scrambling
+//   http://www.jcgt.org/published/0009/04/01/
+//
 
 template <typename RNG>
 class QMCSamplingContext
@@ -72,10 +82,12 @@ class QMCSamplingContext
     // Random number generator type.
     typedef RNG RNGType;
 
-    // This sampler can operate in two modes:
+    // This sampler can operate in three modes:
     //   1. In QMC mode, it uses possibly patent-encumbered techniques.
     //   2. In RNG mode, it works like `RNGSamplingContext` and sticks to random sampling.
-    enum Mode { QMCMode, RNGMode };
+    //   3. In Sobol mode, it uses Owen-scrambled Sobol sequences. All contexts draw from
+    //      the same sequences: decorrelation only comes from the instance numbers.
+    enum Mode { QMCMode, RNGMode, SobolMode };
 
     // Construct a sampling context of dimension 0.
     // The resulting sampling context cannot be used directly;
@@ -158,6 +170,9 @@ class QMCSamplingContext
 
     void compute_offset();
 
+    // Return the index of the next sample in the Sobol sequence of this split.
+    uint64 get_sobol_index() const;
+
     template <typename T> struct Tag {};
 
     template <typename T> T next2(Tag<T>);
@@ -338,6 +353,17 @@ inline void QMCSamplingContext<RNG>::compute_offset()
     }
 }
 
+template <typename RNG>
+inline uint64 QMCSamplingContext<RNG>::get_sobol_index() const
+{
+    // Splits with a known number of samples are padded: the samples of each instance
+    // of the parent context form a contiguous block of the sequence.
+    return
+        m_sample_count > 1
+            ? static_cast<uint64>(m_base_instance) * m_sample_count + m_instance
+            : static_cast<uint64>(m_base_instance) + m_instance;
+}
+
 template <typename RNG>
 template <typename T>
 inline T QMCSamplingContext<RNG>::next2(Tag<T>)
@@ -377,6 +403,17 @@ inline Vector<T, N> QMCSamplingContext<RNG>::next2(Tag<Vector<T, N>>)
             }
         }
     }
+    else if (m_mode == SobolMode)
+    {
+        // Each split draws from its own scrambled sequence, and so do indices beyond 2^32.
+        const uint64 index = get_sobol_index();
+        const uint32 seed =
+            mix_uint32(
+                static_cast<uint32>(m_base_dimension),
+                static_cast<uint32>(index >> 32));
+
+        v = owen_scrambled_sobol_sequence<T, N>(seed, static_cast<uint32>(index));
+    }
     else
     {
         for (size_t i = 0; i < N; ++i)
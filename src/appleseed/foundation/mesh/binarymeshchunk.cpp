@@ -0,0 +1,216 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "binarymeshchunk.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/exceptions/exceptionioerror.h"
+#include "foundation/math/vector.h"
+#include "foundation/mesh/imeshwalker.h"
+
+// Standard headers.
+#include <cstring>
+
+using namespace std;
+
+namespace foundation
+{
+
+namespace
+{
+    template <typename T>
+    void append_array(vector<uint8>& chunk, const T* values, const size_t count)
+    {
+        const size_t begin = align_binarymesh_offset(chunk.size());
+        const size_t size = count * sizeof(T);
+
+        chunk.resize(begin + size, 0);
+
+        if (size > 0)
+            memcpy(&chunk[begin], values, size);
+    }
+
+    template <typename T>
+    const T* view_array(
+        const uint8*    data,
+        const size_t    size,
+        size_t&         offset,
+        const size_t    count)
+    {
+        offset = align_binarymesh_offset(offset);
+
+        // Check the array bounds without overflowing.
+        if (offset > size || count > (size - offset) / sizeof(T))
+            throw ExceptionIOError("corrupted binarymesh chunk");
+
+        const T* values = reinterpret_cast<const T*>(data + offset);
+        offset += count * sizeof(T);
+
+        return values;
+    }
+}
+
+size_t align_binarymesh_offset(const size_t offset)
+{
+    return (offset + BinaryMeshChunkAlignment - 1) & ~(BinaryMeshChunkAlignment - 1);
+}
+
+void write_binarymesh_chunk(
+    const IMeshWalker&          walker,
+    vector<uint8>&              chunk)
+{
+    const size_t vertex_count = walker.get_vertex_count();
+    const size_t vertex_normal_count = walker.get_vertex_normal_count();
+    const size_t tex_coords_count = walker.get_tex_coords_count();
+    const size_t material_slot_count = walker.get_material_slot_count();
+    const size_t face_count = walker.get_face_count();
+
+    vector<float> vertices;
+    vertices.reserve(vertex_count * 3);
+    for (size_t i = 0; i < vertex_count; ++i)
+    {
+        const Vector3f v(walker.get_vertex(i));
+        vertices.insert(vertices.end(), &v[0], &v[0] + 3);
+    }
+
+    vector<float> vertex_normals;
+    vertex_normals.reserve(vertex_normal_count * 3);
+    for (size_t i = 0; i < vertex_normal_count; ++i)
+    {
+        const Vector3f n(walker.get_vertex_normal(i));
+        vertex_normals.insert(vertex_normals.end(), &n[0], &n[0] + 3);
+    }
+
+    vector<float> tex_coords;
+    tex_coords.reserve(tex_coords_count * 2);
+    for (size_t i = 0; i < tex_coords_count; ++i)
+    {
+        const Vector2f uv(walker.get_tex_coords(i));
+        tex_coords.insert(tex_coords.end(), &uv[0], &uv[0] + 2);
+    }
+
+    vector<uint32> face_sizes(face_count);
+    vector<uint32> face_materials(face_count);
+    vector<uint32> face_vertices;
+    for (size_t i = 0; i < face_count; ++i)
+    {
+        const size_t face_size = walker.get_face_vertex_count(i);
+        face_sizes[i] = static_cast<uint32>(face_size);
+        face_materials[i] = static_cast<uint32>(walker.get_face_material(i));
+
+        for (size_t j = 0; j < face_size; ++j)
+        {
+            face_vertices.push_back(static_cast<uint32>(walker.get_face_vertex(i, j)));
+            face_vertices.push_back(static_cast<uint32>(walker.get_face_vertex_normal(i, j)));
+            face_vertices.push_back(static_cast<uint32>(walker.get_face_tex_coords(i, j)));
+        }
+    }
+
+    BinaryMeshChunkHeader header;
+    memset(&header, 0, sizeof(header));
+    header.m_vertex_count = static_cast<uint32>(vertex_count);
+    header.m_vertex_normal_count = static_cast<uint32>(vertex_normal_count);
+    header.m_tex_coords_count = static_cast<uint32>(tex_coords_count);
+    header.m_material_slot_count = static_cast<uint32>(material_slot_count);
+    header.m_face_count = static_cast<uint32>(face_count);
+    header.m_face_vertex_count = static_cast<uint32>(face_vertices.size() / 3);
+
+    chunk.clear();
+    append_array(chunk, reinterpret_cast<const uint8*>(&header), sizeof(header));
+    append_array(chunk, vertices.data(), vertices.size());
+    append_array(chunk, vertex_normals.data(), vertex_normals.size());
+    append_array(chunk, tex_coords.data(), tex_coords.size());
+    append_array(chunk, face_sizes.data(), face_sizes.size());
+    append_array(chunk, face_materials.data(), face_materials.size());
+    append_array(chunk, face_vertices.data(), face_vertices.size());
+
+    for (size_t i = 0; i < material_slot_count; ++i)
+    {
+        const char* name = walker.get_material_slot(i);
+        const uint16 length = static_cast<uint16>(strlen(name));
+
+        const size_t begin = chunk.size();
+        chunk.resize(begin + sizeof(length) + length);
+        memcpy(&chunk[begin], &length, sizeof(length));
+        memcpy(&chunk[begin + sizeof(length)], name, length);
+    }
+}
+
+void parse_binarymesh_chunk(
+    const uint8*                data,
+    const size_t                size,
+    BinaryMeshChunk&            chunk)
+{
+    size_t offset = 0;
+
+    chunk.m_header = *view_array<BinaryMeshChunkHeader>(data, size, offset, 1);
+
+    const BinaryMeshChunkHeader& header = chunk.m_header;
+    chunk.m_vertices = view_array<float>(data, size, offset, header.m_vertex_count * size_t(3));
+    chunk.m_vertex_normals = view_array<float>(data, size, offset, header.m_vertex_normal_count * size_t(3));
+    chunk.m_tex_coords = view_array<float>(data, size, offset, header.m_tex_coords_count * size_t(2));
+    chunk.m_face_sizes = view_array<uint32>(data, size, offset, header.m_face_count);
+    chunk.m_face_materials = view_array<uint32>(data, size, offset, header.m_face_count);
+    chunk.m_face_vertices = view_array<uint32>(data, size, offset, header.m_face_vertex_count * size_t(3));
+
+    // Each material slot takes at least the size of its length prefix.
+    if (header.m_material_slot_count > (size - offset) / sizeof(uint16))
+        throw ExceptionIOError("corrupted binarymesh chunk");
+
+    chunk.m_material_slots.resize(header.m_material_slot_count);
+
+    for (uint32 i = 0; i < header.m_material_slot_count; ++i)
+    {
+        uint16 length;
+        if (size - offset < sizeof(length))
+            throw ExceptionIOError("corrupted binarymesh chunk");
+        memcpy(&length, data + offset, sizeof(length));
+        offset += sizeof(length);
+
+        if (size - offset < length)
+            throw ExceptionIOError("corrupted binarymesh chunk");
+        chunk.m_material_slots[i].assign(reinterpret_cast<const char*>(data + offset), length);
+        offset += length;
+    }
+
+    // Make sure faces have at least three vertices and that face sizes are consistent
+    // with the total number of face vertices.
+    size_t face_vertex_count = 0;
+    for (uint32 i = 0; i < header.m_face_count; ++i)
+    {
+        if (chunk.m_face_sizes[i] < 3)
+            throw ExceptionIOError("corrupted binarymesh chunk");
+        face_vertex_count += chunk.m_face_sizes[i];
+    }
+
+    if (face_vertex_count != header.m_face_vertex_count)
+        throw ExceptionIOError("corrupted binarymesh chunk");
+}
+
+}   // namespace foundation
@@ -0,0 +1,125 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Forward declarations.
+namespace foundation    { class IMeshWalker; }
+
+namespace foundation
+{
+
+//
+// Starting with version 5, binarymesh files have the following layout:
+//
+//   char    signature[10]                              "BINARYMESH"
+//   uint16  version
+//   uint32  mesh_count
+//   uint64  toc_offset
+//   chunks, one per mesh, each starting at a multiple of BinaryMeshChunkAlignment bytes
+//   table of contents, made of mesh_count entries:
+//     uint16  name length, followed by the characters of the name
+//     uint64  chunk offset
+//     uint64  chunk size, as stored in the file
+//     uint64  chunk size, once decompressed
+//     uint8   chunk compression (see BinaryMeshChunkCompression)
+//
+
+const uint16 BinaryMeshIndexedVersion = 5;
+
+enum BinaryMeshChunkCompression
+{
+    BinaryMeshChunkUncompressed = 0,
+    BinaryMeshChunkLZ4          = 1
+};
+
+//
+// Each mesh is stored in its own chunk.
+// A chunk starts with the following header, followed by raw arrays, each aligned to
+// BinaryMeshChunkAlignment bytes relative to the start of the chunk:
+//
+//   float   vertices[vertex_count * 3]
+//   float   vertex_normals[vertex_normal_count * 3]
+//   float   tex_coords[tex_coords_count * 2]
+//   uint32  face_sizes[face_count]
+//   uint32  face_materials[face_count]
+//   uint32  face_vertices[face_vertex_count * 3]       (vertex, normal, tex coords) triplets
+//
+// followed by material_slot_count strings, each made of a uint16 length and the characters.
+//
+
+const size_t BinaryMeshChunkAlignment = 16;
+
+struct BinaryMeshChunkHeader
+{
+    uint32  m_vertex_count;
+    uint32  m_vertex_normal_count;
+    uint32  m_tex_coords_count;
+    uint32  m_material_slot_count;
+    uint32  m_face_count;
+    uint32  m_face_vertex_count;                        // sum of the number of vertices of all faces
+    uint32  m_reserved[2];
+};
+
+// A view of a chunk. The arrays point into the chunk's memory.
+struct BinaryMeshChunk
+{
+    BinaryMeshChunkHeader       m_header;
+    const float*                m_vertices;
+    const float*                m_vertex_normals;
+    const float*                m_tex_coords;
+    const uint32*               m_face_sizes;
+    const uint32*               m_face_materials;
+    const uint32*               m_face_vertices;
+    std::vector<std::string>    m_material_slots;
+};
+
+// Round a chunk offset up to the next multiple of BinaryMeshChunkAlignment.
+size_t align_binarymesh_offset(const size_t offset);
+
+// Serialize a mesh into a chunk.
+void write_binarymesh_chunk(
+    const IMeshWalker&          walker,
+    std::vector<uint8>&         chunk);
+
+// Build a view of a chunk. The chunk must be aligned to BinaryMeshChunkAlignment bytes.
+// Throws foundation::ExceptionIOError if the chunk is corrupted.
+void parse_binarymesh_chunk(
+    const uint8*                data,
+    const size_t                size,
+    BinaryMeshChunk&            chunk);
+
+}   // namespace foundation
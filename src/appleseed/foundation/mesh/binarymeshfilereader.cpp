@@ -31,16 +31,30 @@
 #include "binarymeshfilereader.h"
 
 // appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/core/exceptions/exceptionioerror.h"
 #include "foundation/math/vector.h"
+#include "foundation/mesh/binarymeshchunk.h"
 #include "foundation/mesh/imeshbuilder.h"
+#include "foundation/mesh/mappedbinarymeshfile.h"
+#include "foundation/platform/system.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/bufferedfile.h"
+#include "foundation/utility/job.h"
+#include "foundation/utility/log.h"
 #include "foundation/utility/memory.h"
 
+// Boost headers.
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/mutex.hpp"
+
 // Standard headers.
+#include <algorithm>
 #include <cstring>
+#include <exception>
 #include <memory>
+#include <string>
+#include <vector>
 
 using namespace std;
 
@@ -103,12 +117,32 @@ void BinaryMeshFileReader::read(IMeshBuilder& builder)
         }
         break;
 
+      // Indexed, single-precision geometry with optionally LZ4-compressed chunks.
+      case BinaryMeshIndexedVersion:
+        file.close();
+        read_indexed_meshes(builder);
+        break;
+
       // Unknown format.
       default:
         throw ExceptionIOError("unknown binarymesh format version");
     }
 }
 
+void BinaryMeshFileReader::read_mesh(const char* name, IMeshBuilder& builder)
+{
+    const MappedBinaryMeshFile file(m_filename);
+
+    const size_t index = file.find_mesh(name);
+    if (index == ~size_t(0))
+        throw ExceptionIOError("mesh not found");
+
+    MappedBinaryMeshFile::Mesh mesh;
+    file.read_mesh(index, mesh);
+
+    build_mesh(file.get_mesh_name(index), mesh.m_chunk, builder);
+}
+
 void BinaryMeshFileReader::read_and_check_signature(BufferedFile& file)
 {
     static const char ExpectedSig[10] = { 'B', 'I', 'N', 'A', 'R', 'Y', 'M', 'E', 'S', 'H' };
@@ -266,4 +300,222 @@ void BinaryMeshFileReader::read_face(ReaderAdapter& reader, IMeshBuilder& builde
     builder.end_face();
 }
 
+namespace
+{
+    //
+    // Read the meshes of a file, in order, on the threads of a job manager.
+    //
+    // Meshes are decompressed ahead of the one being built, but at most slot_count
+    // meshes are kept in memory at any given time. A slot is handed back to the job
+    // queue as soon as its mesh has been built, so a single slow chunk does not keep
+    // the other threads idle.
+    //
+
+    class ParallelMeshReader
+      : public NonCopyable
+    {
+      public:
+        ParallelMeshReader(
+            const MappedBinaryMeshFile&     file,
+            const size_t                    thread_count,
+            const size_t                    slot_count)
+          : m_file(file)
+          , m_mesh_count(file.get_mesh_count())
+          , m_slots(slot_count)
+          , m_job_manager(m_logger, m_job_queue, thread_count, JobManager::KeepRunningOnEmptyQueue)
+        {
+            m_job_manager.start();
+
+            for (size_t i = 0, e = min(slot_count, m_mesh_count); i < e; ++i)
+                schedule(i);
+        }
+
+        // Wait until a given mesh is read and return it. Meshes must be acquired in order.
+        const MappedBinaryMeshFile::Mesh& acquire(const size_t mesh_index)
+        {
+            Slot& slot = m_slots[mesh_index % m_slots.size()];
+
+            boost::mutex::scoped_lock lock(m_mutex);
+
+            while (!slot.m_done)
+                m_done_event.wait(lock);
+
+            if (slot.m_failed)
+                throw ExceptionIOError(slot.m_error_message.c_str());
+
+            return slot.m_mesh;
+        }
+
+        // Free the memory of a mesh and start reading the next mesh into its slot.
+        void release(const size_t mesh_index)
+        {
+            Slot& slot = m_slots[mesh_index % m_slots.size()];
+            slot.m_mesh = MappedBinaryMeshFile::Mesh();
+
+            const size_t next_mesh_index = mesh_index + m_slots.size();
+            if (next_mesh_index < m_mesh_count)
+                schedule(next_mesh_index);
+        }
+
+      private:
+        struct Slot
+        {
+            MappedBinaryMeshFile::Mesh      m_mesh;
+            bool                            m_done;
+            bool                            m_failed;
+            string                          m_error_message;
+        };
+
+        class ReadMeshJob
+          : public IJob
+        {
+          public:
+            ReadMeshJob(
+                ParallelMeshReader&         reader,
+                const size_t                mesh_index)
+              : m_reader(reader)
+              , m_mesh_index(mesh_index)
+            {
+            }
+
+            void execute(const size_t thread_index) override
+            {
+                m_reader.read_mesh(m_mesh_index);
+            }
+
+          private:
+            ParallelMeshReader&             m_reader;
+            const size_t                    m_mesh_index;
+        };
+
+        // Members are destroyed in reverse order: the job manager waits for running jobs
+        // to complete and the job queue deletes the jobs that were not executed before
+        // the slots go away.
+        const MappedBinaryMeshFile&         m_file;
+        const size_t                        m_mesh_count;
+        vector<Slot>                        m_slots;
+        boost::mutex                        m_mutex;
+        boost::condition_variable           m_done_event;
+        Logger                              m_logger;
+        JobQueue                            m_job_queue;
+        JobManager                          m_job_manager;
+
+        void schedule(const size_t mesh_index)
+        {
+            Slot& slot = m_slots[mesh_index % m_slots.size()];
+            slot.m_done = false;
+            slot.m_failed = false;
+
+            m_job_queue.schedule(new ReadMeshJob(*this, mesh_index));
+        }
+
+        void read_mesh(const size_t mesh_index)
+        {
+            Slot& slot = m_slots[mesh_index % m_slots.size()];
+
+            bool failed = false;
+            string error_message;
+
+            try
+            {
+                m_file.read_mesh(mesh_index, slot.m_mesh);
+            }
+            catch (const exception& e)
+            {
+                failed = true;
+                error_message = e.what();
+            }
+
+            boost::mutex::scoped_lock lock(m_mutex);
+            slot.m_done = true;
+            slot.m_failed = failed;
+            slot.m_error_message = error_message;
+            m_done_event.notify_all();
+        }
+    };
+}
+
+void BinaryMeshFileReader::read_indexed_meshes(IMeshBuilder& builder)
+{
+    const MappedBinaryMeshFile file(m_filename);
+    const size_t mesh_count = file.get_mesh_count();
+
+    // Decompress chunks in parallel when there are several compressed chunks.
+    size_t compressed_mesh_count = 0;
+    for (size_t i = 0; i < mesh_count; ++i)
+    {
+        if (file.is_mesh_compressed(i))
+            ++compressed_mesh_count;
+    }
+
+    const size_t thread_count =
+        min(compressed_mesh_count, System::get_logical_cpu_core_count());
+
+    if (thread_count > 1)
+    {
+        // Keep enough meshes in flight for the threads to stay busy while meshes are built.
+        ParallelMeshReader reader(file, thread_count, 2 * thread_count);
+
+        for (size_t i = 0; i < mesh_count; ++i)
+        {
+            build_mesh(file.get_mesh_name(i), reader.acquire(i).m_chunk, builder);
+            reader.release(i);
+        }
+    }
+    else
+    {
+        MappedBinaryMeshFile::Mesh mesh;
+
+        for (size_t i = 0; i < mesh_count; ++i)
+        {
+            file.read_mesh(i, mesh);
+            build_mesh(file.get_mesh_name(i), mesh.m_chunk, builder);
+        }
+    }
+}
+
+void BinaryMeshFileReader::build_mesh(
+    const char*             name,
+    const BinaryMeshChunk&  chunk,
+    IMeshBuilder&           builder)
+{
+    const BinaryMeshChunkHeader& header = chunk.m_header;
+
+    builder.begin_mesh(name);
+
+    builder.push_vertex_array(chunk.m_vertices, header.m_vertex_count);
+    builder.push_vertex_normal_array(chunk.m_vertex_normals, header.m_vertex_normal_count);
+    builder.push_tex_coords_array(chunk.m_tex_coords, header.m_tex_coords_count);
+
+    for (const string& material_slot : chunk.m_material_slots)
+        builder.push_material_slot(material_slot.c_str());
+
+    const uint32* face_vertices = chunk.m_face_vertices;
+
+    for (uint32 i = 0; i < header.m_face_count; ++i)
+    {
+        const uint32 count = chunk.m_face_sizes[i];
+
+        ensure_minimum_size(m_vertices, count);
+        ensure_minimum_size(m_vertex_normals, count);
+        ensure_minimum_size(m_tex_coords, count);
+
+        for (uint32 j = 0; j < count; ++j, face_vertices += 3)
+        {
+            m_vertices[j] = face_vertices[0];
+            m_vertex_normals[j] = face_vertices[1];
+            m_tex_coords[j] = face_vertices[2];
+        }
+
+        builder.begin_face(count);
+        builder.set_face_vertices(&m_vertices[0]);
+        builder.set_face_vertex_normals(&m_vertex_normals[0]);
+        builder.set_face_vertex_tex_coords(&m_tex_coords[0]);
+        builder.set_face_material(chunk.m_face_materials[i]);
+        builder.end_face();
+    }
+
+    builder.end_mesh();
+}
+
 }   // namespace foundation
@@ -42,6 +42,7 @@
 namespace foundation    { class BufferedFile; }
 namespace foundation    { class IMeshBuilder; }
 namespace foundation    { class ReaderAdapter; }
+namespace foundation    { struct BinaryMeshChunk; }
 
 namespace foundation
 {
@@ -60,6 +61,11 @@ class BinaryMeshFileReader
     // Read a mesh.
     void read(IMeshBuilder& builder) override;
 
+    // Read a single mesh given its name. The mesh is looked up in the table of contents
+    // and the other meshes are not read. Throws foundation::ExceptionIOError if the file
+    // is not a binarymesh file of version 5 or above, or if it has no mesh with this name.
+    void read_mesh(const char* name, IMeshBuilder& builder);
+
   private:
     const std::string       m_filename;
     std::vector<size_t>     m_vertices;
@@ -77,6 +83,9 @@ class BinaryMeshFileReader
     void read_material_slots(ReaderAdapter& reader, IMeshBuilder& builder);
     void read_faces(ReaderAdapter& reader, IMeshBuilder& builder);
     void read_face(ReaderAdapter& reader, IMeshBuilder& builder);
+
+    void read_indexed_meshes(IMeshBuilder& builder);
+    void build_mesh(const char* name, const BinaryMeshChunk& chunk, IMeshBuilder& builder);
 };
 
 }   // namespace foundation
@@ -32,9 +32,11 @@
 
 // appleseed.foundation headers.
 #include "foundation/core/exceptions/exceptionioerror.h"
-#include "foundation/math/vector.h"
+#include "foundation/mesh/binarymeshchunk.h"
 #include "foundation/mesh/imeshwalker.h"
-#include "foundation/platform/types.h"
+
+// LZ4 headers.
+#include <lz4.h>
 
 // Standard headers.
 #include <cstring>
@@ -48,16 +50,24 @@ namespace foundation
 // BinaryMeshFileWriter class implementation.
 //
 
-namespace
+BinaryMeshFileWriter::BinaryMeshFileWriter(
+    const string&       filename,
+    const int           options)
+  : m_filename(filename)
+  , m_options(options)
 {
-    // Version of the BinaryMesh file format being written by this code.
-    const uint16 Version = 4;
 }
 
-BinaryMeshFileWriter::BinaryMeshFileWriter(const string& filename)
-  : m_filename(filename)
-  , m_writer(m_file, 256 * 1024)
+BinaryMeshFileWriter::~BinaryMeshFileWriter()
 {
+    try
+    {
+        close();
+    }
+    catch (const ExceptionIOError&)
+    {
+        // Destructors must not throw; call close() explicitly to handle errors.
+    }
 }
 
 void BinaryMeshFileWriter::write(const IMeshWalker& walker)
@@ -72,100 +82,105 @@ void BinaryMeshFileWriter::write(const IMeshWalker& walker)
         if (!m_file.is_open())
             throw ExceptionIOError();
 
-        write_signature();
-        write_version();
+        // The header is rewritten with the final values when the file is closed.
+        write_header(0, 0);
     }
 
     write_mesh(walker);
 }
 
-void BinaryMeshFileWriter::write_signature()
+void BinaryMeshFileWriter::close()
 {
-    static const char Signature[10] = { 'B', 'I', 'N', 'A', 'R', 'Y', 'M', 'E', 'S', 'H' };
-    checked_write(m_file, Signature, sizeof(Signature));
-}
+    if (!m_file.is_open())
+        return;
 
-void BinaryMeshFileWriter::write_version()
-{
-    checked_write(m_file, Version);
-}
+    const int64 toc_offset = m_file.tell();
+    write_toc();
 
-void BinaryMeshFileWriter::write_string(const char* s)
-{
-    const uint16 length = static_cast<uint16>(strlen(s));
+    if (!m_file.seek(0, BufferedFile::SeekFromBeginning))
+        throw ExceptionIOError();
+
+    write_header(static_cast<uint32>(m_toc.size()), static_cast<uint64>(toc_offset));
 
-    checked_write(m_writer, length);
-    checked_write(m_writer, s, length);
+    m_toc.clear();
+
+    if (!m_file.close())
+        throw ExceptionIOError();
 }
 
-void BinaryMeshFileWriter::write_mesh(const IMeshWalker& walker)
+void BinaryMeshFileWriter::write_header(const uint32 mesh_count, const uint64 toc_offset)
 {
-    write_string(walker.get_name());
-    write_vertices(walker);
-    write_vertex_normals(walker);
-    write_texture_coordinates(walker);
-    write_material_slots(walker);
-    write_faces(walker);
+    static const char Signature[10] = { 'B', 'I', 'N', 'A', 'R', 'Y', 'M', 'E', 'S', 'H' };
+    checked_write(m_file, Signature, sizeof(Signature));
+    checked_write(m_file, BinaryMeshIndexedVersion);
+    checked_write(m_file, mesh_count);
+    checked_write(m_file, toc_offset);
 }
 
-void BinaryMeshFileWriter::write_vertices(const IMeshWalker& walker)
+void BinaryMeshFileWriter::write_string(const string& s)
 {
-    const uint32 count = static_cast<uint32>(walker.get_vertex_count());
-    checked_write(m_writer, count);
+    const uint16 length = static_cast<uint16>(s.size());
 
-    for (uint32 i = 0; i < count; ++i)
-        checked_write(m_writer, Vector3f(walker.get_vertex(i)));
+    checked_write(m_file, length);
+    checked_write(m_file, s.c_str(), length);
 }
 
-void BinaryMeshFileWriter::write_vertex_normals(const IMeshWalker& walker)
+void BinaryMeshFileWriter::write_mesh(const IMeshWalker& walker)
 {
-    const uint32 count = static_cast<uint32>(walker.get_vertex_normal_count());
-    checked_write(m_writer, count);
+    write_binarymesh_chunk(walker, m_chunk);
 
-    for (uint32 i = 0; i < count; ++i)
-        checked_write(m_writer, Vector3f(walker.get_vertex_normal(i)));
-}
+    TOCEntry entry;
+    entry.m_name = walker.get_name();
+    entry.m_size = m_chunk.size();
+    entry.m_compression = BinaryMeshChunkUncompressed;
 
-void BinaryMeshFileWriter::write_texture_coordinates(const IMeshWalker& walker)
-{
-    const uint32 count = static_cast<uint32>(walker.get_tex_coords_count());
-    checked_write(m_writer, count);
+    const uint8* stored_chunk = m_chunk.data();
+    size_t stored_size = m_chunk.size();
 
-    for (uint32 i = 0; i < count; ++i)
-        checked_write(m_writer, Vector2f(walker.get_tex_coords(i)));
-}
+    // Only keep the compressed chunk if it is actually smaller.
+    if (!(m_options & Uncompressed) && m_chunk.size() <= static_cast<size_t>(LZ4_MAX_INPUT_SIZE))
+    {
+        m_compressed_chunk.resize(
+            static_cast<size_t>(LZ4_compressBound(static_cast<int>(m_chunk.size()))));
+
+        const int compressed_size =
+            LZ4_compress_default(
+                reinterpret_cast<const char*>(m_chunk.data()),
+                reinterpret_cast<char*>(m_compressed_chunk.data()),
+                static_cast<int>(m_chunk.size()),
+                static_cast<int>(m_compressed_chunk.size()));
+
+        if (compressed_size > 0 && static_cast<size_t>(compressed_size) < m_chunk.size())
+        {
+            entry.m_compression = BinaryMeshChunkLZ4;
+            stored_chunk = m_compressed_chunk.data();
+            stored_size = static_cast<size_t>(compressed_size);
+        }
+    }
 
-void BinaryMeshFileWriter::write_material_slots(const IMeshWalker& walker)
-{
-    const uint16 count = static_cast<uint16>(walker.get_material_slot_count());
-    checked_write(m_writer, count);
+    // Align the chunk in the file so that its arrays are aligned once the file is mapped.
+    static const uint8 Padding[BinaryMeshChunkAlignment] = { 0 };
+    const size_t offset = static_cast<size_t>(m_file.tell());
+    checked_write(m_file, Padding, align_binarymesh_offset(offset) - offset);
 
-    for (uint16 i = 0; i < count; ++i)
-        write_string(walker.get_material_slot(i));
-}
+    entry.m_offset = static_cast<uint64>(m_file.tell());
+    entry.m_stored_size = stored_size;
 
-void BinaryMeshFileWriter::write_faces(const IMeshWalker& walker)
-{
-    const uint32 count = static_cast<uint32>(walker.get_face_count());
-    checked_write(m_writer, count);
+    checked_write(m_file, stored_chunk, stored_size);
 
-    for (uint32 i = 0; i < count; ++i)
-        write_face(walker, i);
+    m_toc.push_back(entry);
 }
 
-void BinaryMeshFileWriter::write_face(const IMeshWalker& walker, const size_t face_index)
+void BinaryMeshFileWriter::write_toc()
 {
-    const uint16 count = static_cast<uint16>(walker.get_face_vertex_count(face_index));
-    checked_write(m_writer, count);
-
-    for (uint16 i = 0; i < count; ++i)
+    for (const TOCEntry& entry : m_toc)
     {
-        checked_write(m_writer, static_cast<uint32>(walker.get_face_vertex(face_index, i)));
-        checked_write(m_writer, static_cast<uint32>(walker.get_face_vertex_normal(face_index, i)));
-        checked_write(m_writer, static_cast<uint32>(walker.get_face_tex_coords(face_index, i)));
+        write_string(entry.m_name);
+        checked_write(m_file, entry.m_offset);
+        checked_write(m_file, entry.m_stored_size);
+        checked_write(m_file, entry.m_size);
+        checked_write(m_file, entry.m_compression);
     }
-
-    checked_write(m_writer, static_cast<uint16>(walker.get_face_material(face_index)));
 }
 
 }   // namespace foundation
@@ -32,11 +32,13 @@
 // appleseed.foundation headers.
 #include "foundation/mesh/imeshfilewriter.h"
 #include "foundation/platform/compiler.h"
+#include "foundation/platform/types.h"
 #include "foundation/utility/bufferedfile.h"
 
 // Standard headers.
 #include <cstddef>
 #include <string>
+#include <vector>
 
 // Forward declarations.
 namespace foundation    { class IMeshWalker; }
@@ -47,33 +49,56 @@ namespace foundation
 //
 // Writer for a simple binary mesh file format.
 //
+// Each mesh is stored in its own chunk, optionally LZ4-compressed, and the file ends with
+// a table of contents (see foundation/mesh/binarymeshchunk.h). The table of contents is
+// written when the writer is closed or destroyed.
+//
 
 class BinaryMeshFileWriter
   : public IMeshFileWriter
 {
   public:
+    enum Options
+    {
+        Default         = 0,            // none of the flags below
+        Uncompressed    = 1UL << 0      // store chunks uncompressed so that they can be used directly from mapped memory
+    };
+
     // Constructor.
-    explicit BinaryMeshFileWriter(const std::string& filename);
+    explicit BinaryMeshFileWriter(
+        const std::string&      filename,
+        const int               options = Default);
+
+    // Destructor. Closes the file if it is still open.
+    ~BinaryMeshFileWriter() override;
 
     // Write a mesh.
     void write(const IMeshWalker& walker) override;
 
+    // Write the table of contents and close the file.
+    void close();
+
   private:
+    struct TOCEntry
+    {
+        std::string             m_name;
+        uint64                  m_offset;
+        uint64                  m_stored_size;
+        uint64                  m_size;
+        uint8                   m_compression;
+    };
+
     const std::string           m_filename;
+    const int                   m_options;
     BufferedFile                m_file;
-    LZ4CompressedWriterAdapter  m_writer;
-
-    void write_signature();
-    void write_version();
+    std::vector<TOCEntry>       m_toc;
+    std::vector<uint8>          m_chunk;
+    std::vector<uint8>          m_compressed_chunk;
 
-    void write_string(const char* s);
+    void write_header(const uint32 mesh_count, const uint64 toc_offset);
+    void write_string(const std::string& s);
     void write_mesh(const IMeshWalker& walker);
-    void write_vertices(const IMeshWalker& walker);
-    void write_vertex_normals(const IMeshWalker& walker);
-    void write_texture_coordinates(const IMeshWalker& walker);
-    void write_material_slots(const IMeshWalker& walker);
-    void write_faces(const IMeshWalker& walker);
-    void write_face(const IMeshWalker& walker, const size_t face_index);
+    void write_toc();
 };
 
 }   // namespace foundation
@@ -50,8 +50,10 @@ class APPLESEED_DLLSYMBOL GenericMeshFileWriter
   : public IMeshFileWriter
 {
   public:
-    // Constructor.
-    explicit GenericMeshFileWriter(const char* filename);
+    // Constructor. binarymesh_options are forwarded to foundation::BinaryMeshFileWriter.
+    explicit GenericMeshFileWriter(
+        const char*     filename,
+        const int       binarymesh_options = 0);
 
     // Destructor.
     ~GenericMeshFileWriter() override;
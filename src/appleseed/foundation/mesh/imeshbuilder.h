@@ -68,6 +68,18 @@ class APPLESEED_DLLSYMBOL IMeshBuilder
     // Return the index of the vector within the mesh.
     virtual size_t push_tex_coords(const Vector2d& v) = 0;
 
+    // Append an array of vertices to the mesh, given as consecutive (x, y, z) triplets.
+    // The default implementation calls push_vertex() for each vertex.
+    virtual void push_vertex_array(const float* coords, const size_t count);
+
+    // Append an array of vertex normals to the mesh, given as consecutive (x, y, z) triplets.
+    // The default implementation calls push_vertex_normal() for each normal.
+    virtual void push_vertex_normal_array(const float* coords, const size_t count);
+
+    // Append an array of texture coordinates to the mesh, given as consecutive (u, v) pairs.
+    // The default implementation calls push_tex_coords() for each texture coordinate.
+    virtual void push_tex_coords_array(const float* coords, const size_t count);
+
     // Append a material slot to the mesh.
     virtual size_t push_material_slot(const char* name) = 0;
 
@@ -93,4 +105,27 @@ class APPLESEED_DLLSYMBOL IMeshBuilder
     virtual void end_mesh() = 0;
 };
 
+
+//
+// IMeshBuilder class implementation.
+//
+
+inline void IMeshBuilder::push_vertex_array(const float* coords, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i, coords += 3)
+        push_vertex(Vector3d(coords[0], coords[1], coords[2]));
+}
+
+inline void IMeshBuilder::push_vertex_normal_array(const float* coords, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i, coords += 3)
+        push_vertex_normal(Vector3d(coords[0], coords[1], coords[2]));
+}
+
+inline void IMeshBuilder::push_tex_coords_array(const float* coords, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i, coords += 2)
+        push_tex_coords(Vector2d(coords[0], coords[1]));
+}
+
 }   // namespace foundation
@@ -0,0 +1,264 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "mappedbinarymeshfile.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/exceptions/exceptionioerror.h"
+
+// LZ4 headers.
+#include <lz4.h>
+
+// Boost headers.
+#include "boost/interprocess/exceptions.hpp"
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+// Standard headers.
+#include <cassert>
+#include <cstring>
+#include <map>
+#include <memory>
+
+using namespace std;
+namespace bi = boost::interprocess;
+
+namespace foundation
+{
+
+//
+// MappedBinaryMeshFile class implementation.
+//
+
+namespace
+{
+    struct TOCEntry
+    {
+        string      m_name;
+        uint64      m_offset;
+        uint64      m_stored_size;
+        uint64      m_size;
+        uint8       m_compression;
+    };
+
+    class MemoryReader
+    {
+      public:
+        MemoryReader(const uint8* data, const size_t size, const size_t offset)
+          : m_data(data)
+          , m_size(size)
+          , m_offset(offset)
+        {
+        }
+
+        void read(void* outbuf, const size_t size)
+        {
+            if (m_offset > m_size || size > m_size - m_offset)
+                throw ExceptionIOError("corrupted binarymesh file");
+
+            memcpy(outbuf, m_data + m_offset, size);
+            m_offset += size;
+        }
+
+        template <typename T>
+        T read()
+        {
+            T value;
+            read(&value, sizeof(T));
+            return value;
+        }
+
+      private:
+        const uint8*    m_data;
+        const size_t    m_size;
+        size_t          m_offset;
+    };
+}
+
+struct MappedBinaryMeshFile::Impl
+{
+    bi::file_mapping        m_file_mapping;
+    bi::mapped_region       m_region;
+    const uint8*            m_data;
+    size_t                  m_size;
+    vector<TOCEntry>        m_toc;
+    map<string, size_t>     m_index;
+};
+
+MappedBinaryMeshFile::MappedBinaryMeshFile(const string& filename)
+  : impl(new Impl())
+{
+    try
+    {
+        impl->m_file_mapping = bi::file_mapping(filename.c_str(), bi::read_only);
+        impl->m_region = bi::mapped_region(impl->m_file_mapping, bi::read_only);
+    }
+    catch (const bi::interprocess_exception& e)
+    {
+        delete impl;
+        throw ExceptionIOError(e.what());
+    }
+
+    impl->m_data = static_cast<const uint8*>(impl->m_region.get_address());
+    impl->m_size = impl->m_region.get_size();
+
+    try
+    {
+        MemoryReader header(impl->m_data, impl->m_size, 0);
+
+        char signature[10];
+        header.read(signature, sizeof(signature));
+        if (memcmp(signature, "BINARYMESH", sizeof(signature)))
+            throw ExceptionIOError("invalid binarymesh format signature");
+
+        const uint16 version = header.read<uint16>();
+        if (version < BinaryMeshIndexedVersion)
+            throw ExceptionIOError("binarymesh file has no table of contents");
+        if (version > BinaryMeshIndexedVersion)
+            throw ExceptionIOError("unknown binarymesh format version");
+
+        const uint32 mesh_count = header.read<uint32>();
+        const uint64 toc_offset = header.read<uint64>();
+
+        if (toc_offset > impl->m_size)
+            throw ExceptionIOError("corrupted binarymesh file");
+
+        // Each table of contents entry takes at least this many bytes (for an empty name).
+        const size_t MinTOCEntrySize =
+            sizeof(uint16) + 3 * sizeof(uint64) + sizeof(uint8);
+        if (mesh_count > (impl->m_size - static_cast<size_t>(toc_offset)) / MinTOCEntrySize)
+            throw ExceptionIOError("corrupted binarymesh file");
+
+        MemoryReader toc(impl->m_data, impl->m_size, static_cast<size_t>(toc_offset));
+
+        impl->m_toc.resize(mesh_count);
+
+        for (uint32 i = 0; i < mesh_count; ++i)
+        {
+            TOCEntry& entry = impl->m_toc[i];
+
+            entry.m_name.resize(toc.read<uint16>());
+            if (!entry.m_name.empty())
+                toc.read(&entry.m_name[0], entry.m_name.size());
+
+            entry.m_offset = toc.read<uint64>();
+            entry.m_stored_size = toc.read<uint64>();
+            entry.m_size = toc.read<uint64>();
+            entry.m_compression = toc.read<uint8>();
+
+            if (entry.m_offset > impl->m_size ||
+                entry.m_stored_size > impl->m_size - entry.m_offset ||
+                entry.m_offset % BinaryMeshChunkAlignment != 0)
+                throw ExceptionIOError("corrupted binarymesh file");
+
+            // Only remember the first mesh with a given name.
+            impl->m_index.insert(make_pair(entry.m_name, static_cast<size_t>(i)));
+        }
+    }
+    catch (...)
+    {
+        delete impl;
+        throw;
+    }
+}
+
+MappedBinaryMeshFile::~MappedBinaryMeshFile()
+{
+    delete impl;
+}
+
+size_t MappedBinaryMeshFile::get_mesh_count() const
+{
+    return impl->m_toc.size();
+}
+
+const char* MappedBinaryMeshFile::get_mesh_name(const size_t index) const
+{
+    assert(index < impl->m_toc.size());
+    return impl->m_toc[index].m_name.c_str();
+}
+
+size_t MappedBinaryMeshFile::find_mesh(const char* name) const
+{
+    const map<string, size_t>::const_iterator i = impl->m_index.find(name);
+    return i == impl->m_index.end() ? ~size_t(0) : i->second;
+}
+
+bool MappedBinaryMeshFile::is_mesh_compressed(const size_t index) const
+{
+    assert(index < impl->m_toc.size());
+    return impl->m_toc[index].m_compression != BinaryMeshChunkUncompressed;
+}
+
+void MappedBinaryMeshFile::read_mesh(const size_t index, Mesh& mesh) const
+{
+    assert(index < impl->m_toc.size());
+
+    const TOCEntry& entry = impl->m_toc[index];
+    const uint8* stored_data = impl->m_data + entry.m_offset;
+    const size_t stored_size = static_cast<size_t>(entry.m_stored_size);
+
+    switch (entry.m_compression)
+    {
+      case BinaryMeshChunkUncompressed:
+        mesh.m_storage.clear();
+        parse_binarymesh_chunk(stored_data, stored_size, mesh.m_chunk);
+        break;
+
+      case BinaryMeshChunkLZ4:
+        {
+            // LZ4 cannot expand data by more than a factor of 255.
+            if (stored_size > static_cast<size_t>(LZ4_MAX_INPUT_SIZE) ||
+                entry.m_size > static_cast<uint64>(LZ4_MAX_INPUT_SIZE) ||
+                entry.m_size > 255 * static_cast<uint64>(stored_size))
+                throw ExceptionIOError("corrupted binarymesh file");
+
+            const size_t size = static_cast<size_t>(entry.m_size);
+            mesh.m_storage.resize(size);
+
+            const int decompressed_size =
+                LZ4_decompress_safe(
+                    reinterpret_cast<const char*>(stored_data),
+                    reinterpret_cast<char*>(mesh.m_storage.data()),
+                    static_cast<int>(stored_size),
+                    static_cast<int>(size));
+
+            if (decompressed_size < 0 || static_cast<size_t>(decompressed_size) != size)
+                throw ExceptionIOError("corrupted binarymesh file");
+
+            parse_binarymesh_chunk(mesh.m_storage.data(), size, mesh.m_chunk);
+        }
+        break;
+
+      default:
+        throw ExceptionIOError("unknown binarymesh chunk compression");
+    }
+}
+
+}   // namespace foundation
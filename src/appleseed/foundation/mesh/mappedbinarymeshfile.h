@@ -0,0 +1,91 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/mesh/binarymeshchunk.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace foundation
+{
+
+//
+// Random access to the meshes of a binarymesh file of version 5 or above.
+//
+// The file is memory-mapped. Its table of contents is read when the file is opened,
+// so individual meshes can be looked up by name without reading the whole file.
+// Uncompressed chunks are accessed directly in the mapped memory; compressed chunks
+// are decompressed on demand. read_mesh() may be called concurrently.
+//
+
+class MappedBinaryMeshFile
+  : public NonCopyable
+{
+  public:
+    // A mesh read from the file.
+    struct Mesh
+    {
+        BinaryMeshChunk         m_chunk;
+        std::vector<uint8>      m_storage;              // decompressed chunk, empty if the chunk is not compressed
+    };
+
+    // Open a file. Throws foundation::ExceptionIOError if the file cannot be opened
+    // or if it is not a valid binarymesh file of version 5 or above.
+    explicit MappedBinaryMeshFile(const std::string& filename);
+
+    // Destructor.
+    ~MappedBinaryMeshFile();
+
+    // Return the number of meshes in the file.
+    size_t get_mesh_count() const;
+
+    // Return the name of a given mesh.
+    const char* get_mesh_name(const size_t index) const;
+
+    // Return the index of a mesh given its name, or ~size_t(0) if there is no such mesh.
+    size_t find_mesh(const char* name) const;
+
+    // Return true if a given mesh is stored compressed.
+    bool is_mesh_compressed(const size_t index) const;
+
+    // Read a given mesh. Throws foundation::ExceptionIOError if the mesh is corrupted.
+    void read_mesh(const size_t index, Mesh& mesh) const;
+
+  private:
+    struct Impl;
+    Impl* impl;
+};
+
+}   // namespace foundation
@@ -48,7 +48,7 @@ BENCHMARK_SUITE(Foundation_Utility_Job)
         }
     };
 
-    template <size_t ThreadCount>
+    template <size_t ThreadCount, int Flags = 0>
     struct Fixture
     {
         Logger      m_logger;
@@ -56,7 +56,7 @@ BENCHMARK_SUITE(Foundation_Utility_Job)
         JobManager  m_job_manager;
 
         Fixture()
-          : m_job_manager(m_logger, m_job_queue, ThreadCount, JobManager::KeepRunningOnEmptyQueue)
+          : m_job_manager(m_logger, m_job_queue, ThreadCount, JobManager::KeepRunningOnEmptyQueue | Flags)
         {
             m_job_manager.start();
         }
@@ -73,6 +73,12 @@ BENCHMARK_SUITE(Foundation_Utility_Job)
         }
     };
 
+    template <size_t ThreadCount>
+    struct WorkStealingFixture
+      : public Fixture<ThreadCount, JobManager::WorkStealing>
+    {
+    };
+
     BENCHMARK_CASE_F(SingleThreadedJobExecution, Fixture<1>)
     {
         payload();
@@ -82,4 +88,104 @@ BENCHMARK_SUITE(Foundation_Utility_Job)
     {
         payload();
     }
+
+    BENCHMARK_CASE_F(QuadThreadedJobExecution, Fixture<4>)
+    {
+        payload();
+    }
+
+    BENCHMARK_CASE_F(OctoThreadedJobExecution, Fixture<8>)
+    {
+        payload();
+    }
+
+    BENCHMARK_CASE_F(SixteenThreadedJobExecution, Fixture<16>)
+    {
+        payload();
+    }
+
+    BENCHMARK_CASE_F(SingleThreadedJobExecution_WorkStealing, WorkStealingFixture<1>)
+    {
+        payload();
+    }
+
+    BENCHMARK_CASE_F(DoubleThreadedJobExecution_WorkStealing, WorkStealingFixture<2>)
+    {
+        payload();
+    }
+
+    BENCHMARK_CASE_F(QuadThreadedJobExecution_WorkStealing, WorkStealingFixture<4>)
+    {
+        payload();
+    }
+
+    BENCHMARK_CASE_F(OctoThreadedJobExecution_WorkStealing, WorkStealingFixture<8>)
+    {
+        payload();
+    }
+
+    BENCHMARK_CASE_F(SixteenThreadedJobExecution_WorkStealing, WorkStealingFixture<16>)
+    {
+        payload();
+    }
+
+    // Recursively spawn child jobs, as a parallel tree build would.
+    struct JobSpawningChildJobs
+      : public IJob
+    {
+        JobQueue&       m_job_queue;
+        const size_t    m_depth;
+
+        JobSpawningChildJobs(JobQueue& job_queue, const size_t depth)
+          : m_job_queue(job_queue)
+          , m_depth(depth)
+        {
+        }
+
+        void execute(const size_t thread_index) override
+        {
+            if (m_depth > 0)
+            {
+                m_job_queue.spawn(new JobSpawningChildJobs(m_job_queue, m_depth - 1), thread_index);
+                m_job_queue.spawn(new JobSpawningChildJobs(m_job_queue, m_depth - 1), thread_index);
+            }
+        }
+    };
+
+    template <size_t ThreadCount, int Flags = 0>
+    struct SpawningFixture
+      : public Fixture<ThreadCount, Flags>
+    {
+        void payload()
+        {
+            this->m_job_queue.schedule(new JobSpawningChildJobs(this->m_job_queue, 8));
+            this->m_job_queue.wait_until_completion();
+        }
+    };
+
+    template <size_t ThreadCount>
+    struct WorkStealingSpawningFixture
+      : public SpawningFixture<ThreadCount, JobManager::WorkStealing>
+    {
+    };
+
+    BENCHMARK_CASE_F(QuadThreadedChildJobExecution, SpawningFixture<4>)
+    {
+        payload();
+    }
+
+    BENCHMARK_CASE_F(QuadThreadedChildJobExecution_WorkStealing, WorkStealingSpawningFixture<4>)
+    {
+        payload();
+    }
+
+    BENCHMARK_CASE_F(SixteenThreadedChildJobExecution, SpawningFixture<16>)
+    {
+        payload();
+    }
+
+    BENCHMARK_CASE_F(SixteenThreadedChildJobExecution_WorkStealing, WorkStealingSpawningFixture<16>)
+    {
+        payload();
+    }
 }
@@ -32,6 +32,7 @@
 #include "foundation/math/primes.h"
 #include "foundation/math/qmc.h"
 #include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
 #include "foundation/utility/benchmark.h"
 
 // Standard headers.
@@ -256,6 +257,22 @@ BENCHMARK_SUITE(Foundation_Math_QMC)
             for (size_t i = 0; i < 64; ++i)
                 m_x += hammersley_sequence<T, 2>(Bases, 64, i);
         }
+
+        void sobol_payload()
+        {
+            m_x = Vector<T, 2>(0.0f);
+
+            for (uint32 i = 0; i < 64; ++i)
+                m_x += sobol_sequence<T, 2>(i);
+        }
+
+        void owen_scrambled_sobol_payload()
+        {
+            m_x = Vector<T, 2>(0.0f);
+
+            for (uint32 i = 0; i < 64; ++i)
+                m_x += owen_scrambled_sobol_sequence<T, 2>(i, i);
+        }
     };
 
     //
@@ -367,4 +384,28 @@ BENCHMARK_SUITE(Foundation_Math_QMC)
     {
         hammersley_payload();
     }
+
+    //
+    // Sobol sequence.
+    //
+
+    BENCHMARK_CASE_F(SobolSequence_SinglePrecision, Vector2Fixture<float>)
+    {
+        sobol_payload();
+    }
+
+    BENCHMARK_CASE_F(SobolSequence_DoublePrecision, Vector2Fixture<double>)
+    {
+        sobol_payload();
+    }
+
+    BENCHMARK_CASE_F(OwenScrambledSobolSequence_SinglePrecision, Vector2Fixture<float>)
+    {
+        owen_scrambled_sobol_payload();
+    }
+
+    BENCHMARK_CASE_F(OwenScrambledSobolSequence_DoublePrecision, Vector2Fixture<double>)
+    {
+        owen_scrambled_sobol_payload();
+    }
 }
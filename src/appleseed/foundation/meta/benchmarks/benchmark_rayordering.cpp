@@ -0,0 +1,198 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/bvh.h"
+#include "foundation/math/intersection/rayaabb.h"
+#include "foundation/math/ray.h"
+#include "foundation/math/rayordering.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/sampling/mappings.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/timers.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/alignedvector.h"
+#include "foundation/utility/benchmark.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace std;
+
+BENCHMARK_SUITE(Foundation_Math_RayOrdering)
+{
+    typedef bvh::WideTree<AlignedVector<bvh::Node<AABB3f>>, 4> TreeType;
+    typedef bvh::SAHPartitioner<vector<AABB3f>> PartitionerType;
+
+    // Find the closest bounding box hit by the ray.
+    struct Visitor
+    {
+        const vector<AABB3f>&   m_bboxes;
+        const vector<size_t>&   m_ordering;
+        size_t                  m_hit_item;
+        float                   m_hit_distance;
+
+        Visitor(
+            const vector<AABB3f>&   bboxes,
+            const vector<size_t>&   ordering,
+            const float             ray_tmax)
+          : m_bboxes(bboxes)
+          , m_ordering(ordering)
+          , m_hit_item(~size_t(0))
+          , m_hit_distance(ray_tmax)
+        {
+        }
+
+        bool visit(
+            const TreeType::NodeType&   node,
+            const Ray3f&                ray,
+            const RayInfo3f&            ray_info,
+            float&                      distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , bvh::TraversalStatistics& stats
+#endif
+            )
+        {
+            for (size_t i = 0; i < node.get_item_count(); ++i)
+            {
+                const size_t item = m_ordering[node.get_item_index() + i];
+
+                float tmin;
+                if (intersect(ray, ray_info, m_bboxes[item], tmin) && tmin < m_hit_distance)
+                {
+                    m_hit_item = item;
+                    m_hit_distance = tmin;
+                }
+            }
+
+            distance = m_hit_distance;
+            return true;
+        }
+    };
+
+    // A stream of secondary rays: origins are scattered over a few surface points
+    // in no particular order, directions are uniformly distributed.
+    struct Fixture
+    {
+        static const size_t ItemCount = 20000;
+        static const size_t RayCount = 256;
+        static const size_t OriginCount = 16;
+
+        vector<AABB3f>      m_bboxes;
+        TreeType            m_tree;
+        PartitionerType     m_partitioner;
+        vector<Ray3f>       m_rays;
+        vector<size_t>      m_ordering;
+        vector<uint64>      m_keys;
+        size_t              m_hit_count;
+
+        Fixture()
+          : m_bboxes(generate_bboxes())
+          , m_partitioner(m_bboxes)
+          , m_rays(generate_rays())
+          , m_hit_count(0)
+        {
+            bvh::Builder<TreeType, PartitionerType> builder;
+            builder.build<DefaultWallclockTimer>(m_tree, m_partitioner, m_bboxes.size(), 1);
+
+            bvh::Collapser<TreeType> collapser;
+            collapser.collapse<DefaultWallclockTimer>(m_tree);
+        }
+
+        static vector<AABB3f> generate_bboxes()
+        {
+            MersenneTwister rng;
+            vector<AABB3f> bboxes;
+
+            for (size_t i = 0; i < ItemCount; ++i)
+            {
+                const Vector3f center = 10.0f * rand_vector1<Vector3f>(rng);
+                const Vector3f half_extent = 0.1f * rand_vector1<Vector3f>(rng);
+                bboxes.emplace_back(center - half_extent, center + half_extent);
+            }
+
+            return bboxes;
+        }
+
+        static vector<Ray3f> generate_rays()
+        {
+            MersenneTwister rng;
+
+            Vector3f origins[OriginCount];
+            for (size_t i = 0; i < OriginCount; ++i)
+                origins[i] = 10.0f * rand_vector1<Vector3f>(rng);
+
+            vector<Ray3f> rays;
+            for (size_t i = 0; i < RayCount; ++i)
+            {
+                const Vector3f& org = origins[rand_int1(rng, 0, static_cast<int32>(OriginCount) - 1)];
+                const Vector3f dir = sample_sphere_uniform(rand_vector2<Vector2f>(rng));
+                rays.emplace_back(org, dir, 0.0f, 100.0f);
+            }
+
+            return rays;
+        }
+
+        void trace(const Ray3f& ray)
+        {
+            const RayInfo3f ray_info(ray);
+
+            Visitor visitor(m_bboxes, m_partitioner.get_item_ordering(), ray.m_tmax);
+            bvh::WideIntersector<TreeType, Visitor, Ray3f> intersector;
+            intersector.intersect_no_motion(m_tree, ray, ray_info, visitor);
+
+            if (visitor.m_hit_item != ~size_t(0))
+                ++m_hit_count;
+        }
+    };
+
+    BENCHMARK_CASE_F(TraceStream_InputOrder, Fixture)
+    {
+        for (size_t i = 0; i < RayCount; ++i)
+            trace(m_rays[i]);
+    }
+
+    BENCHMARK_CASE_F(TraceStream_CoherentOrder, Fixture)
+    {
+        m_ordering.clear();
+        coherent_ray_ordering(m_ordering, m_keys, &m_rays[0], RayCount);
+
+        for (size_t i = 0; i < RayCount; ++i)
+            trace(m_rays[m_ordering[i]]);
+    }
+
+    BENCHMARK_CASE_F(CoherentRayOrdering, Fixture)
+    {
+        m_ordering.clear();
+        coherent_ray_ordering(m_ordering, m_keys, &m_rays[0], RayCount);
+    }
+}
@@ -0,0 +1,257 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/math/aliastable.h"
+#include "foundation/math/fp.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/xorshift32.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace std;
+
+TEST_SUITE(Foundation_Math_AliasTable)
+{
+    typedef AliasTable<int, double> AliasTableType;
+
+    TEST_CASE(Empty_GivenTableInInitialState_ReturnsTrue)
+    {
+        AliasTableType table;
+
+        EXPECT_TRUE(table.empty());
+    }
+
+    TEST_CASE(Valid_GivenTableInInitialState_ReturnsFalse)
+    {
+        AliasTableType table;
+
+        EXPECT_FALSE(table.valid());
+    }
+
+    TEST_CASE(Valid_GivenTableWithOneItemWithZeroWeight_ReturnsFalse)
+    {
+        AliasTableType table;
+        table.insert(1, 0.0);
+
+        EXPECT_FALSE(table.valid());
+    }
+
+    TEST_CASE(Clear_GivenTableWithOneItem_MakesTableEmptyAndInvalid)
+    {
+        AliasTableType table;
+        table.insert(1, 0.5);
+        table.clear();
+
+        EXPECT_TRUE(table.empty());
+        EXPECT_FALSE(table.valid());
+    }
+
+    TEST_CASE(Sample_GivenTableWithOneItemWithPositiveWeight_ReturnsItem)
+    {
+        AliasTableType table;
+        table.insert(1, 0.5);
+        table.prepare();
+
+        const AliasTableType::ItemWeightPair result = table.sample(0.5);
+
+        EXPECT_EQ(1, result.first);
+        EXPECT_FEQ(1.0, result.second);
+    }
+
+    struct Fixture
+    {
+        AliasTableType m_table;
+
+        Fixture()
+        {
+            m_table.insert(1, 0.4);
+            m_table.insert(2, 1.6);
+            m_table.prepare();
+        }
+    };
+
+    TEST_CASE_F(OperatorBracket_AfterPrepare_ReturnsNormalizedWeights, Fixture)
+    {
+        EXPECT_FEQ(0.2, m_table[0].second);
+        EXPECT_FEQ(0.8, m_table[1].second);
+    }
+
+    TEST_CASE_F(Sample_GivenInputEqualToZero_ReturnsItem1, Fixture)
+    {
+        const AliasTableType::ItemWeightPair result = m_table.sample(0.0);
+
+        EXPECT_EQ(1, result.first);
+        EXPECT_FEQ(0.2, result.second);
+    }
+
+    TEST_CASE_F(Sample_GivenInputInAliasedPartOfFirstBin_ReturnsItem2, Fixture)
+    {
+        // The first bin keeps item 1 with probability 0.4 and defers to item 2 otherwise.
+        const AliasTableType::ItemWeightPair result = m_table.sample(0.3);
+
+        EXPECT_EQ(2, result.first);
+        EXPECT_FEQ(0.8, result.second);
+    }
+
+    TEST_CASE_F(Sample_GivenInputOneUlpBeforeOne_ReturnsItem2, Fixture)
+    {
+        const double almost_one = shift(1.0, -1);
+        const AliasTableType::ItemWeightPair result = m_table.sample(almost_one);
+
+        EXPECT_EQ(2, result.first);
+        EXPECT_FEQ(0.8, result.second);
+    }
+
+    TEST_CASE_F(Sample_GivenSecondInputInKeptPartOfFirstBin_ReturnsItem1AndRemapsSecondInput, Fixture)
+    {
+        double y = 0.2;
+        const AliasTableType::ItemWeightPair result = m_table.sample(0.0, y);
+
+        EXPECT_EQ(1, result.first);
+        EXPECT_FEQ(0.5, y);
+    }
+
+    TEST_CASE_F(Sample_GivenSecondInputInAliasedPartOfFirstBin_ReturnsItem2AndRemapsSecondInput, Fixture)
+    {
+        double y = 0.7;
+        const AliasTableType::ItemWeightPair result = m_table.sample(0.0, y);
+
+        EXPECT_EQ(2, result.first);
+        EXPECT_FEQ(0.5, y);
+    }
+
+    TEST_CASE_F(SampleAndRemap_GivenInputInKeptPartOfFirstBin_ReturnsItem1AndRemapsInput, Fixture)
+    {
+        double y;
+        const AliasTableType::ItemWeightPair result = m_table.sample_and_remap(0.1, y);
+
+        EXPECT_EQ(1, result.first);
+        EXPECT_FEQ(0.5, y);
+    }
+
+    TEST_CASE_F(SampleAndRemap_GivenInputInAliasedPartOfFirstBin_ReturnsItem2AndRemapsInput, Fixture)
+    {
+        double y;
+        const AliasTableType::ItemWeightPair result = m_table.sample_and_remap(0.35, y);
+
+        EXPECT_EQ(2, result.first);
+        EXPECT_FEQ(0.5, y);
+    }
+
+    TEST_CASE(Sample_GivenZeroWeightItems_NeverReturnsThem)
+    {
+        AliasTableType table;
+        table.insert(0, 0.0);
+        table.insert(1, 3.0);
+        table.insert(2, 0.0);
+        table.insert(3, 1.0);
+        table.insert(4, 0.0);
+        table.prepare();
+
+        const size_t SampleCount = 1000;
+
+        for (size_t i = 0; i < SampleCount; ++i)
+        {
+            const int item = table.sample(static_cast<double>(i) / SampleCount).first;
+            EXPECT_TRUE(item == 1 || item == 3);
+        }
+    }
+
+    TEST_CASE(Sample_GivenUniformInputs_MatchesDistribution)
+    {
+        const size_t ItemCount = 37;
+        const size_t SampleCount = 100000;
+
+        AliasTable<size_t, double> table;
+        Xorshift32 rng;
+
+        for (size_t i = 0; i < ItemCount; ++i)
+            table.insert(i, rand_double1(rng));
+
+        table.prepare();
+
+        // Stratified inputs cover every bin uniformly.
+        vector<size_t> histogram(ItemCount, 0);
+        for (size_t i = 0; i < SampleCount; ++i)
+            ++histogram[table.sample((i + 0.5) / SampleCount).first];
+
+        for (size_t i = 0; i < ItemCount; ++i)
+        {
+            const double frequency = static_cast<double>(histogram[i]) / SampleCount;
+            EXPECT_LT(1.0e-4, abs(table[i].second - frequency));
+        }
+    }
+
+    TEST_CASE(Sample_GivenLargeTableWithSinglePrecisionInputs_MatchesDistribution)
+    {
+        // With 2^20 items, a float input has only a few bits left for the alias
+        // choice once the bin is selected, so the alias choice must come from
+        // a second input.
+        const size_t ItemCount = 1 << 20;
+        const size_t ClassCount = 8;
+        const size_t SampleCount = 1 << 22;
+
+        AliasTable<size_t, float> table;
+        table.reserve(ItemCount);
+
+        for (size_t i = 0; i < ItemCount; ++i)
+            table.insert(i, 1.0f + 0.15f * (i % ClassCount));
+
+        table.prepare();
+
+        vector<double> expected(ClassCount, 0.0);
+        for (size_t i = 0; i < ItemCount; ++i)
+            expected[i % ClassCount] += table[i].second;
+
+        Xorshift32 rng;
+        vector<size_t> histogram(ClassCount, 0);
+        bool remapped_inputs_in_range = true;
+        for (size_t i = 0; i < SampleCount; ++i)
+        {
+            const float x = rand_float2(rng);
+            float y = rand_float2(rng);
+            const size_t item = table.sample(x, y).first;
+            ++histogram[item % ClassCount];
+            remapped_inputs_in_range = remapped_inputs_in_range && y >= 0.0f && y < 1.0f;
+        }
+
+        EXPECT_TRUE(remapped_inputs_in_range);
+
+        for (size_t i = 0; i < ClassCount; ++i)
+        {
+            const double frequency = static_cast<double>(histogram[i]) / SampleCount;
+            EXPECT_LT(2.0e-3, abs(expected[i] - frequency));
+        }
+    }
+}
@@ -0,0 +1,149 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/platform/types.h"
+#include "foundation/utility/arena.h"
+#include "foundation/utility/memory.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <memory>
+
+using namespace foundation;
+using namespace std;
+
+TEST_SUITE(Foundation_Utility_Arena)
+{
+    // Arenas are too large to be safely allocated on the stack.
+    struct Fixture
+    {
+        unique_ptr<Arena> m_arena;
+
+        Fixture()
+          : m_arena(new Arena())
+        {
+        }
+    };
+
+    TEST_CASE_F(Allocate_ReturnsAlignedMemoryFromInlineStorage, Fixture)
+    {
+        const uint8* ptr = static_cast<const uint8*>(m_arena->allocate(5));
+
+        EXPECT_TRUE(is_aligned(ptr, 16));
+        EXPECT_EQ(m_arena->get_storage(), ptr);
+        EXPECT_EQ(0, m_arena->get_overflow_count());
+    }
+
+    TEST_CASE_F(Allocate_GivenMoreMemoryThanInlineStorage_SpillsIntoOverflowBlock, Fixture)
+    {
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            void* ptr = m_arena->allocate(1024);
+            EXPECT_TRUE(is_aligned(ptr, 16));
+        }
+
+        EXPECT_EQ(3, m_arena->get_overflow_count());
+        EXPECT_EQ(3, m_arena->get_overflow_block_count());
+        EXPECT_EQ(1000 * 1024, m_arena->get_high_water_mark());
+    }
+
+    TEST_CASE_F(Allocate_GivenAllocationLargerThanOverflowBlocks_Succeeds, Fixture)
+    {
+        const size_t Size = 1024 * 1024;
+
+        uint8* ptr = static_cast<uint8*>(m_arena->allocate(Size));
+        ptr[0] = 1;
+        ptr[Size - 1] = 1;
+
+        EXPECT_EQ(1, m_arena->get_overflow_block_count());
+        EXPECT_EQ(Size, m_arena->get_overflow_block_size());
+    }
+
+    TEST_CASE_F(Clear_RetainsOverflowBlocksForReuse, Fixture)
+    {
+        for (size_t i = 0; i < 1000; ++i)
+            m_arena->allocate(1024);
+
+        m_arena->clear();
+
+        EXPECT_EQ(m_arena->get_storage(), m_arena->allocate(16));
+
+        for (size_t i = 0; i < 1000; ++i)
+            m_arena->allocate(1024);
+
+        EXPECT_EQ(3, m_arena->get_overflow_block_count());
+    }
+
+    struct Object
+    {
+        uint8   m_bytes[1000];
+    };
+
+    TEST_CASE_F(GetObject_GivenObjectsSpillingIntoOverflowBlocks_ReturnsEachObject, Fixture)
+    {
+        const size_t ObjectCount = 1000;
+
+        const Object* objects[ObjectCount];
+        for (size_t i = 0; i < ObjectCount; ++i)
+            objects[i] = m_arena->allocate_noinit<Object>();
+
+        ASSERT_EQ(3, m_arena->get_overflow_block_count());
+
+        for (size_t i = 0; i < ObjectCount; ++i)
+            EXPECT_EQ(objects[i], &m_arena->get_object<Object>(i));
+    }
+
+    TEST_CASE_F(GetObject_AfterClear_ReturnsObjectsFromInlineStorageAndReusedBlocks, Fixture)
+    {
+        for (size_t i = 0; i < 1000; ++i)
+            m_arena->allocate_noinit<Object>();
+
+        m_arena->clear();
+
+        const size_t ObjectCount = 500;
+
+        const Object* objects[ObjectCount];
+        for (size_t i = 0; i < ObjectCount; ++i)
+            objects[i] = m_arena->allocate_noinit<Object>();
+
+        for (size_t i = 0; i < ObjectCount; ++i)
+            EXPECT_EQ(objects[i], &m_arena->get_object<Object>(i));
+    }
+
+    TEST_CASE_F(GetHighWaterMark_ReturnsLargestUsageAcrossClears, Fixture)
+    {
+        m_arena->allocate(4096);
+        m_arena->clear();
+        m_arena->allocate(1024);
+        m_arena->clear();
+
+        EXPECT_EQ(4096, m_arena->get_high_water_mark());
+    }
+}
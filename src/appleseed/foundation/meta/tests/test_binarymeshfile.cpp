@@ -0,0 +1,428 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/math/vector.h"
+#include "foundation/mesh/binarymeshchunk.h"
+#include "foundation/mesh/binarymeshfilereader.h"
+#include "foundation/mesh/binarymeshfilewriter.h"
+#include "foundation/mesh/imeshwalker.h"
+#include "foundation/mesh/mappedbinarymeshfile.h"
+#include "foundation/mesh/meshbuilderbase.h"
+#include "foundation/core/exceptions/exceptionioerror.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/iostreamop.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace foundation;
+using namespace std;
+
+TEST_SUITE(Foundation_Mesh_BinaryMeshFile)
+{
+    struct Mesh
+    {
+        string              m_name;
+        vector<Vector3d>    m_vertices;
+        vector<Vector3d>    m_vertex_normals;
+        vector<Vector2d>    m_tex_coords;
+        vector<string>      m_material_slots;
+        vector<size_t>      m_face_vertices;        // triangles only
+        vector<size_t>      m_face_materials;
+    };
+
+    struct MeshBuilder
+      : public MeshBuilderBase
+    {
+        vector<Mesh> m_meshes;
+
+        void begin_mesh(const char* name) override
+        {
+            m_meshes.emplace_back();
+            m_meshes.back().m_name = name;
+        }
+
+        size_t push_vertex(const Vector3d& v) override
+        {
+            m_meshes.back().m_vertices.push_back(v);
+            return m_meshes.back().m_vertices.size() - 1;
+        }
+
+        size_t push_vertex_normal(const Vector3d& v) override
+        {
+            m_meshes.back().m_vertex_normals.push_back(v);
+            return m_meshes.back().m_vertex_normals.size() - 1;
+        }
+
+        size_t push_tex_coords(const Vector2d& v) override
+        {
+            m_meshes.back().m_tex_coords.push_back(v);
+            return m_meshes.back().m_tex_coords.size() - 1;
+        }
+
+        size_t push_material_slot(const char* name) override
+        {
+            m_meshes.back().m_material_slots.emplace_back(name);
+            return m_meshes.back().m_material_slots.size() - 1;
+        }
+
+        void set_face_vertices(const size_t vertices[]) override
+        {
+            for (size_t i = 0; i < 3; ++i)
+                m_meshes.back().m_face_vertices.push_back(vertices[i]);
+        }
+
+        void set_face_material(const size_t material) override
+        {
+            m_meshes.back().m_face_materials.push_back(material);
+        }
+    };
+
+    struct MeshWalker
+      : public IMeshWalker
+    {
+        const Mesh& m_mesh;
+
+        explicit MeshWalker(const Mesh& mesh)
+          : m_mesh(mesh)
+        {
+        }
+
+        const char* get_name() const override
+        {
+            return m_mesh.m_name.c_str();
+        }
+
+        size_t get_vertex_count() const override
+        {
+            return m_mesh.m_vertices.size();
+        }
+
+        Vector3d get_vertex(const size_t i) const override
+        {
+            return m_mesh.m_vertices[i];
+        }
+
+        size_t get_vertex_normal_count() const override
+        {
+            return m_mesh.m_vertex_normals.size();
+        }
+
+        Vector3d get_vertex_normal(const size_t i) const override
+        {
+            return m_mesh.m_vertex_normals[i];
+        }
+
+        size_t get_tex_coords_count() const override
+        {
+            return m_mesh.m_tex_coords.size();
+        }
+
+        Vector2d get_tex_coords(const size_t i) const override
+        {
+            return m_mesh.m_tex_coords[i];
+        }
+
+        size_t get_material_slot_count() const override
+        {
+            return m_mesh.m_material_slots.size();
+        }
+
+        const char* get_material_slot(const size_t i) const override
+        {
+            return m_mesh.m_material_slots[i].c_str();
+        }
+
+        size_t get_face_count() const override
+        {
+            return m_mesh.m_face_materials.size();
+        }
+
+        size_t get_face_vertex_count(const size_t face_index) const override
+        {
+            return 3;
+        }
+
+        size_t get_face_vertex(const size_t face_index, const size_t vertex_index) const override
+        {
+            return m_mesh.m_face_vertices[face_index * 3 + vertex_index];
+        }
+
+        size_t get_face_vertex_normal(const size_t face_index, const size_t vertex_index) const override
+        {
+            return m_mesh.m_face_vertices[face_index * 3 + vertex_index];
+        }
+
+        size_t get_face_tex_coords(const size_t face_index, const size_t vertex_index) const override
+        {
+            return m_mesh.m_face_vertices[face_index * 3 + vertex_index];
+        }
+
+        size_t get_face_material(const size_t face_index) const override
+        {
+            return m_mesh.m_face_materials[face_index];
+        }
+    };
+
+    // Create a grid mesh with repetitive data so that its chunk compresses well.
+    Mesh create_mesh(const string& name, const size_t size)
+    {
+        Mesh mesh;
+        mesh.m_name = name;
+        mesh.m_material_slots.emplace_back("default");
+
+        for (size_t y = 0; y <= size; ++y)
+        {
+            for (size_t x = 0; x <= size; ++x)
+            {
+                mesh.m_vertices.emplace_back(static_cast<double>(x), static_cast<double>(y), 0.0);
+                mesh.m_vertex_normals.emplace_back(0.0, 0.0, 1.0);
+                mesh.m_tex_coords.emplace_back(0.5, 0.25);
+            }
+        }
+
+        for (size_t y = 0; y < size; ++y)
+        {
+            for (size_t x = 0; x < size; ++x)
+            {
+                const size_t v0 = y * (size + 1) + x;
+                mesh.m_face_vertices.push_back(v0);
+                mesh.m_face_vertices.push_back(v0 + 1);
+                mesh.m_face_vertices.push_back(v0 + size + 1);
+                mesh.m_face_materials.push_back(0);
+            }
+        }
+
+        return mesh;
+    }
+
+    void write_meshes(const char* filename, const vector<Mesh>& meshes, const int options)
+    {
+        BinaryMeshFileWriter writer(filename, options);
+
+        for (const Mesh& mesh : meshes)
+            writer.write(MeshWalker(mesh));
+
+        writer.close();
+    }
+
+    bool operator==(const Mesh& lhs, const Mesh& rhs)
+    {
+        return
+            lhs.m_name == rhs.m_name &&
+            lhs.m_vertices == rhs.m_vertices &&
+            lhs.m_vertex_normals == rhs.m_vertex_normals &&
+            lhs.m_tex_coords == rhs.m_tex_coords &&
+            lhs.m_material_slots == rhs.m_material_slots &&
+            lhs.m_face_vertices == rhs.m_face_vertices &&
+            lhs.m_face_materials == rhs.m_face_materials;
+    }
+
+    vector<Mesh> create_meshes()
+    {
+        vector<Mesh> meshes;
+        meshes.push_back(create_mesh("first", 8));
+        meshes.push_back(create_mesh("second", 16));
+        meshes.push_back(create_mesh("third", 4));
+        return meshes;
+    }
+
+    vector<Mesh> read_meshes(const char* filename)
+    {
+        MeshBuilder builder;
+        BinaryMeshFileReader reader(filename);
+        reader.read(builder);
+        return builder.m_meshes;
+    }
+
+    TEST_CASE(RoundTrip_CompressedChunks)
+    {
+        const char* Filename = "unit tests/outputs/test_binarymeshfile_compressed.binarymesh";
+
+        const vector<Mesh> meshes = create_meshes();
+        write_meshes(Filename, meshes, BinaryMeshFileWriter::Default);
+
+        const vector<Mesh> result = read_meshes(Filename);
+
+        ASSERT_EQ(meshes.size(), result.size());
+        EXPECT_TRUE(meshes[0] == result[0]);
+        EXPECT_TRUE(meshes[1] == result[1]);
+        EXPECT_TRUE(meshes[2] == result[2]);
+    }
+
+    TEST_CASE(RoundTrip_UncompressedChunks)
+    {
+        const char* Filename = "unit tests/outputs/test_binarymeshfile_uncompressed.binarymesh";
+
+        const vector<Mesh> meshes = create_meshes();
+        write_meshes(Filename, meshes, BinaryMeshFileWriter::Uncompressed);
+
+        const vector<Mesh> result = read_meshes(Filename);
+
+        ASSERT_EQ(meshes.size(), result.size());
+        EXPECT_TRUE(meshes[0] == result[0]);
+        EXPECT_TRUE(meshes[1] == result[1]);
+        EXPECT_TRUE(meshes[2] == result[2]);
+    }
+
+    TEST_CASE(RoundTrip_ManyCompressedChunks)
+    {
+        const char* Filename = "unit tests/outputs/test_binarymeshfile_many_compressed.binarymesh";
+
+        vector<Mesh> meshes;
+        for (size_t i = 0; i < 64; ++i)
+            meshes.push_back(create_mesh("mesh" + to_string(i), 1 + i % 7));
+        write_meshes(Filename, meshes, BinaryMeshFileWriter::Default);
+
+        const vector<Mesh> result = read_meshes(Filename);
+
+        ASSERT_EQ(meshes.size(), result.size());
+        for (size_t i = 0; i < meshes.size(); ++i)
+            EXPECT_TRUE(meshes[i] == result[i]);
+    }
+
+    TEST_CASE(ReadMesh_GivenName_ReadsOnlyThisMesh)
+    {
+        const char* Filename = "unit tests/outputs/test_binarymeshfile_read_mesh.binarymesh";
+
+        const vector<Mesh> meshes = create_meshes();
+        write_meshes(Filename, meshes, BinaryMeshFileWriter::Default);
+
+        MeshBuilder builder;
+        BinaryMeshFileReader reader(Filename);
+        reader.read_mesh("second", builder);
+
+        ASSERT_EQ(1, builder.m_meshes.size());
+        EXPECT_TRUE(meshes[1] == builder.m_meshes[0]);
+    }
+
+    TEST_CASE(ReadMesh_GivenMissingName_ThrowsExceptionIOError)
+    {
+        const char* Filename = "unit tests/outputs/test_binarymeshfile_read_missing_mesh.binarymesh";
+
+        const vector<Mesh> meshes = create_meshes();
+        write_meshes(Filename, meshes, BinaryMeshFileWriter::Default);
+
+        MeshBuilder builder;
+        BinaryMeshFileReader reader(Filename);
+
+        EXPECT_EXCEPTION(ExceptionIOError,
+        {
+            reader.read_mesh("missing", builder);
+        });
+    }
+
+    TEST_CASE(ParseChunk_GivenFaceWithoutVertices_ThrowsExceptionIOError)
+    {
+        vector<uint8> data;
+        write_binarymesh_chunk(MeshWalker(create_mesh("mesh", 2)), data);
+
+        BinaryMeshChunk chunk;
+        parse_binarymesh_chunk(data.data(), data.size(), chunk);
+        ASSERT_EQ(4, chunk.m_header.m_face_count);
+
+        // Move all the vertices of the first face to the second face, keeping the total
+        // number of face vertices unchanged.
+        uint32* face_sizes = const_cast<uint32*>(chunk.m_face_sizes);
+        face_sizes[1] += face_sizes[0];
+        face_sizes[0] = 0;
+
+        EXPECT_EXCEPTION(ExceptionIOError,
+        {
+            parse_binarymesh_chunk(data.data(), data.size(), chunk);
+        });
+    }
+
+    TEST_CASE(MappedFile_FindsMeshesByName)
+    {
+        const char* Filename = "unit tests/outputs/test_binarymeshfile_mapped.binarymesh";
+
+        vector<Mesh> meshes;
+        meshes.push_back(create_mesh("first", 8));
+        meshes.push_back(create_mesh("second", 2));
+        write_meshes(Filename, meshes, BinaryMeshFileWriter::Default);
+
+        const MappedBinaryMeshFile file(Filename);
+
+        ASSERT_EQ(2, file.get_mesh_count());
+        EXPECT_EQ(string("second"), file.get_mesh_name(1));
+        EXPECT_EQ(1, file.find_mesh("second"));
+        EXPECT_EQ(~size_t(0), file.find_mesh("missing"));
+        EXPECT_TRUE(file.is_mesh_compressed(0));
+    }
+
+    TEST_CASE(MappedFile_UncompressedChunk_ExposesAlignedArraysInMappedMemory)
+    {
+        const char* Filename = "unit tests/outputs/test_binarymeshfile_mapped_uncompressed.binarymesh";
+
+        vector<Mesh> meshes;
+        meshes.push_back(create_mesh("first", 3));
+        meshes.push_back(create_mesh("second", 2));
+        write_meshes(Filename, meshes, BinaryMeshFileWriter::Uncompressed);
+
+        const MappedBinaryMeshFile file(Filename);
+        EXPECT_FALSE(file.is_mesh_compressed(1));
+
+        MappedBinaryMeshFile::Mesh mesh;
+        file.read_mesh(file.find_mesh("second"), mesh);
+
+        EXPECT_TRUE(mesh.m_storage.empty());
+        EXPECT_EQ(9, mesh.m_chunk.m_header.m_vertex_count);
+        EXPECT_EQ(4, mesh.m_chunk.m_header.m_face_count);
+        EXPECT_EQ(0, reinterpret_cast<size_t>(mesh.m_chunk.m_vertices) % 16);
+        EXPECT_EQ(2.0f, mesh.m_chunk.m_vertices[8 * 3 + 0]);
+        EXPECT_EQ(2.0f, mesh.m_chunk.m_vertices[8 * 3 + 1]);
+    }
+
+    TEST_CASE(MappedFile_GivenCorruptedMeshCount_ThrowsExceptionIOError)
+    {
+        const char* Filename = "unit tests/outputs/test_binarymeshfile_corrupted_mesh_count.binarymesh";
+
+        vector<Mesh> meshes;
+        meshes.push_back(create_mesh("first", 2));
+        write_meshes(Filename, meshes, BinaryMeshFileWriter::Default);
+
+        // Overwrite the mesh count that follows the signature and the format version.
+        {
+            fstream file(Filename, ios::in | ios::out | ios::binary);
+            const uint32 mesh_count = 0xFFFFFFFFu;
+            file.seekp(10 + sizeof(uint16));
+            file.write(reinterpret_cast<const char*>(&mesh_count), sizeof(mesh_count));
+        }
+
+        EXPECT_EXCEPTION(ExceptionIOError,
+        {
+            const MappedBinaryMeshFile file(Filename);
+        });
+    }
+}
@@ -30,14 +30,23 @@
 // appleseed.foundation headers.
 #include "foundation/math/aabb.h"
 #include "foundation/math/bvh.h"
+#include "foundation/math/intersection/rayaabb.h"
 #include "foundation/math/ray.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/sampling/mappings.h"
 #include "foundation/math/vector.h"
+#include "foundation/platform/timers.h"
 #include "foundation/utility/alignedvector.h"
 #include "foundation/utility/iostreamop.h"
+#include "foundation/utility/job.h"
+#include "foundation/utility/log.h"
 #include "foundation/utility/test.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cstddef>
+#include <utility>
 #include <vector>
 
 using namespace foundation;
@@ -76,6 +85,441 @@ TEST_SUITE(Foundation_Math_BVH_Node)
     }
 }
 
+TEST_SUITE(Foundation_Math_BVH_WideNode)
+{
+    TEST_CASE(TestStorageAndRetrievalOfChildren)
+    {
+        static const AABB3d LeafBBox(Vector3d(1.0, 2.0, 3.0), Vector3d(4.0, 5.0, 6.0));
+        static const AABB3d WideBBox(Vector3d(7.0, 8.0, 9.0), Vector3d(10.0, 11.0, 12.0));
+
+        bvh::WideNode<AABB3d, 4> node;
+        node.add_leaf_child(42, LeafBBox);
+        node.add_wide_child(7, WideBBox);
+
+        ASSERT_EQ(2, node.get_child_count());
+
+        EXPECT_TRUE(node.is_leaf_child(0));
+        EXPECT_EQ(42, node.get_child_index(0));
+        EXPECT_EQ(LeafBBox, node.get_child_bbox(0));
+
+        EXPECT_FALSE(node.is_leaf_child(1));
+        EXPECT_EQ(7, node.get_child_index(1));
+        EXPECT_EQ(WideBBox, node.get_child_bbox(1));
+    }
+}
+
+TEST_SUITE(Foundation_Math_BVH_WideIntersector)
+{
+    template <typename T, size_t Arity>
+    struct Fixture
+    {
+        typedef AABB<T, 3> AABBType;
+        typedef Ray<T, 3> RayType;
+        typedef RayInfo<T, 3> RayInfoType;
+        typedef bvh::WideTree<AlignedVector<bvh::Node<AABBType>>, Arity> TreeType;
+        typedef bvh::SAHPartitioner<vector<AABBType>> PartitionerType;
+
+        // Find the closest bounding box hit by the ray.
+        struct Visitor
+        {
+            const vector<AABBType>&     m_bboxes;
+            const vector<size_t>&       m_ordering;
+            size_t                      m_hit_item;
+            T                           m_hit_distance;
+
+            Visitor(
+                const vector<AABBType>& bboxes,
+                const vector<size_t>&   ordering,
+                const T                 ray_tmax)
+              : m_bboxes(bboxes)
+              , m_ordering(ordering)
+              , m_hit_item(~size_t(0))
+              , m_hit_distance(ray_tmax)
+            {
+            }
+
+            bool visit(
+                const typename TreeType::NodeType&  node,
+                const RayType&                      ray,
+                const RayInfoType&                  ray_info,
+                T&                                  distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , bvh::TraversalStatistics&         stats
+#endif
+                )
+            {
+                for (size_t i = 0; i < node.get_item_count(); ++i)
+                {
+                    const size_t item = m_ordering[node.get_item_index() + i];
+
+                    T tmin;
+                    if (intersect(ray, ray_info, m_bboxes[item], tmin) && tmin < m_hit_distance)
+                    {
+                        m_hit_item = item;
+                        m_hit_distance = tmin;
+                    }
+                }
+
+                distance = m_hit_distance;
+                return true;
+            }
+        };
+
+        vector<AABBType>    m_bboxes;
+        TreeType            m_tree;
+        PartitionerType     m_partitioner;
+
+        explicit Fixture(const size_t item_count)
+          : m_bboxes(generate_bboxes(item_count))
+          , m_partitioner(m_bboxes)
+        {
+            bvh::Builder<TreeType, PartitionerType> builder;
+            builder.template build<DefaultWallclockTimer>(m_tree, m_partitioner, m_bboxes.size(), 1);
+
+            bvh::Collapser<TreeType> collapser;
+            collapser.template collapse<DefaultWallclockTimer>(m_tree);
+        }
+
+        static vector<AABBType> generate_bboxes(const size_t count)
+        {
+            MersenneTwister rng;
+            vector<AABBType> bboxes;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Vector<T, 3> center = T(10.0) * rand_vector1<Vector<T, 3>>(rng);
+                const Vector<T, 3> half_extent = T(0.3) * rand_vector1<Vector<T, 3>>(rng);
+                bboxes.emplace_back(center - half_extent, center + half_extent);
+            }
+
+            return bboxes;
+        }
+
+        // Return the number of rays for which both intersectors found the same closest hit.
+        size_t count_matching_hits(const size_t ray_count, size_t& hit_count) const
+        {
+            MersenneTwister rng;
+            size_t matching_count = 0;
+            hit_count = 0;
+
+            for (size_t i = 0; i < ray_count; ++i)
+            {
+                const Vector<T, 3> org = T(10.0) * rand_vector1<Vector<T, 3>>(rng);
+                const Vector<T, 3> dir = sample_sphere_uniform(rand_vector2<Vector<T, 2>>(rng));
+                const RayType ray(org, dir, T(0.0), T(100.0));
+                const RayInfoType ray_info(ray);
+
+                Visitor binary_visitor(m_bboxes, m_partitioner.get_item_ordering(), ray.m_tmax);
+                bvh::Intersector<TreeType, Visitor, RayType> binary_intersector;
+                binary_intersector.intersect_no_motion(m_tree, ray, ray_info, binary_visitor);
+
+                Visitor wide_visitor(m_bboxes, m_partitioner.get_item_ordering(), ray.m_tmax);
+                bvh::WideIntersector<TreeType, Visitor, RayType> wide_intersector;
+                wide_intersector.intersect_no_motion(m_tree, ray, ray_info, wide_visitor);
+
+                if (binary_visitor.m_hit_item == wide_visitor.m_hit_item)
+                    ++matching_count;
+
+                if (binary_visitor.m_hit_item != ~size_t(0))
+                    ++hit_count;
+            }
+
+            return matching_count;
+        }
+    };
+
+    TEST_CASE(IntersectNoMotion_DoublePrecision4Wide_MatchesBinaryTraversal)
+    {
+        const Fixture<double, 4> fixture(500);
+        ASSERT_TRUE(fixture.m_tree.is_collapsed());
+
+        size_t hit_count;
+        EXPECT_EQ(1000, fixture.count_matching_hits(1000, hit_count));
+        EXPECT_GT(100, hit_count);
+    }
+
+    TEST_CASE(IntersectNoMotion_DoublePrecision8Wide_MatchesBinaryTraversal)
+    {
+        const Fixture<double, 8> fixture(500);
+        ASSERT_TRUE(fixture.m_tree.is_collapsed());
+
+        size_t hit_count;
+        EXPECT_EQ(1000, fixture.count_matching_hits(1000, hit_count));
+        EXPECT_GT(100, hit_count);
+    }
+
+    TEST_CASE(IntersectNoMotion_SinglePrecision4Wide_MatchesBinaryTraversal)
+    {
+        const Fixture<float, 4> fixture(500);
+        ASSERT_TRUE(fixture.m_tree.is_collapsed());
+
+        size_t hit_count;
+        EXPECT_EQ(1000, fixture.count_matching_hits(1000, hit_count));
+        EXPECT_GT(100, hit_count);
+    }
+
+    TEST_CASE(IntersectNoMotion_SinglePrecision8Wide_MatchesBinaryTraversal)
+    {
+        const Fixture<float, 8> fixture(500);
+        ASSERT_TRUE(fixture.m_tree.is_collapsed());
+
+        size_t hit_count;
+        EXPECT_EQ(1000, fixture.count_matching_hits(1000, hit_count));
+        EXPECT_GT(100, hit_count);
+    }
+
+    TEST_CASE(Collapse_GivenSingleItem_LeavesTreeUncollapsed)
+    {
+        const Fixture<double, 4> fixture(1);
+
+        EXPECT_FALSE(fixture.m_tree.is_collapsed());
+
+        size_t hit_count;
+        EXPECT_EQ(100, fixture.count_matching_hits(100, hit_count));
+    }
+}
+
+TEST_SUITE(Foundation_Math_BVH_ParallelBuilder)
+{
+    struct TestTree
+      : public bvh::Tree<AlignedVector<bvh::Node<AABB3d>>>
+    {
+        // Return the (item index, item count) pairs of all leaves, sorted.
+        vector<pair<size_t, size_t>> get_leaves() const
+        {
+            vector<pair<size_t, size_t>> leaves;
+
+            for (size_t i = 0, e = m_nodes.size(); i < e; ++i)
+            {
+                if (m_nodes[i].is_leaf())
+                    leaves.emplace_back(m_nodes[i].get_item_index(), m_nodes[i].get_item_count());
+            }
+
+            sort(leaves.begin(), leaves.end());
+
+            return leaves;
+        }
+
+        // Return true if the items of a subtree are contained in the subtree's bounding box.
+        bool contains_items(
+            const size_t            node_index,
+            const AABB3d&           bbox,
+            const vector<AABB3d>&   bboxes,
+            const vector<size_t>&   ordering) const
+        {
+            const NodeType& node = m_nodes[node_index];
+
+            if (node.is_leaf())
+            {
+                for (size_t i = node.get_item_index(), e = i + node.get_item_count(); i < e; ++i)
+                {
+                    const AABB3d& item_bbox = bboxes[ordering[i]];
+                    if (!bbox.contains(item_bbox.min) || !bbox.contains(item_bbox.max))
+                        return false;
+                }
+
+                return true;
+            }
+
+            const size_t child_index = node.get_child_node_index();
+
+            return
+                contains_items(child_index + 0, node.get_left_bbox(), bboxes, ordering) &&
+                contains_items(child_index + 1, node.get_right_bbox(), bboxes, ordering);
+        }
+    };
+
+    typedef bvh::SAHPartitioner<vector<AABB3d>> Partitioner;
+
+    vector<AABB3d> generate_bboxes(const size_t count)
+    {
+        MersenneTwister rng;
+        vector<AABB3d> bboxes;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Vector3d center = 100.0 * rand_vector1<Vector3d>(rng);
+            const Vector3d half_extent = rand_vector1<Vector3d>(rng);
+            bboxes.emplace_back(center - half_extent, center + half_extent);
+        }
+
+        return bboxes;
+    }
+
+    void build_tree(
+        const vector<AABB3d>&   bboxes,
+        const size_t            thread_count,
+        TestTree&               tree,
+        vector<size_t>&         ordering)
+    {
+        Logger logger;
+        JobQueue job_queue;
+        JobManager job_manager(logger, job_queue, thread_count);
+        job_manager.start();
+
+        Partitioner partitioner(bboxes);
+        bvh::ParallelBuilder<TestTree, Partitioner> builder;
+        builder.build<DefaultWallclockTimer>(tree, partitioner, bboxes.size(), 1, job_queue, 4);
+
+        ordering = partitioner.get_item_ordering();
+    }
+
+    TEST_CASE(Build_GivenDifferentThreadCounts_ProducesSameTree)
+    {
+        const vector<AABB3d> bboxes = generate_bboxes(20000);
+
+        TestTree reference_tree;
+        vector<size_t> reference_ordering;
+        build_tree(bboxes, 1, reference_tree, reference_ordering);
+
+        TestTree tree;
+        vector<size_t> ordering;
+        build_tree(bboxes, 4, tree, ordering);
+
+        EXPECT_TRUE(reference_ordering == ordering);
+        EXPECT_TRUE(reference_tree.get_leaves() == tree.get_leaves());
+    }
+
+    TEST_CASE(Build_ProducesLeavesCoveringAllItemsWithinTheirBoundingBoxes)
+    {
+        const vector<AABB3d> bboxes = generate_bboxes(20000);
+
+        TestTree tree;
+        vector<size_t> ordering;
+        build_tree(bboxes, 4, tree, ordering);
+
+        const vector<pair<size_t, size_t>> leaves = tree.get_leaves();
+        size_t item_index = 0;
+        for (const pair<size_t, size_t>& leaf : leaves)
+        {
+            EXPECT_EQ(item_index, leaf.first);
+            item_index += leaf.second;
+        }
+        EXPECT_EQ(bboxes.size(), item_index);
+
+        AABB3d root_bbox;
+        root_bbox.invalidate();
+        for (const AABB3d& bbox : bboxes)
+            root_bbox.insert(bbox);
+
+        EXPECT_TRUE(tree.contains_items(0, root_bbox, bboxes, ordering));
+    }
+
+    TEST_CASE(BinnedPartition_GivenItemsAlongX_SplitsAlongX)
+    {
+        vector<AABB3d> bboxes;
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            const double x = static_cast<double>(i);
+            bboxes.emplace_back(Vector3d(x, 0.0, 0.0), Vector3d(x + 0.5, 1.0, 1.0));
+        }
+
+        Logger logger;
+        JobQueue job_queue;
+        JobManager job_manager(logger, job_queue, 2);
+        job_manager.start();
+
+        Partitioner partitioner(bboxes);
+        const AABB3d bbox = partitioner.compute_bbox(0, bboxes.size());
+        const size_t pivot = partitioner.partition(0, bboxes.size(), bbox, job_queue, 3);
+
+        // Bin boundaries fall every 1000 / 32 = 31.25 items; the split nearest to the middle wins.
+        EXPECT_TRUE(pivot >= 468 && pivot <= 532);
+
+        const vector<size_t>& ordering = partitioner.get_item_ordering(0);
+        for (size_t i = 0; i < pivot; ++i)
+            EXPECT_TRUE(ordering[i] < pivot);
+    }
+}
+
+TEST_SUITE(Foundation_Math_BVH_Refitter)
+{
+    struct TestTree
+      : public bvh::Tree<AlignedVector<bvh::Node<AABB3d>>>
+    {
+        const NodeType& get_root() const
+        {
+            return m_nodes[0];
+        }
+    };
+
+    typedef bvh::SAHPartitioner<vector<AABB3d>> Partitioner;
+
+    struct Fixture
+    {
+        vector<AABB3d>  m_bboxes;
+        Partitioner     m_partitioner;
+        TestTree        m_tree;
+
+        Fixture()
+          : m_bboxes(generate_bboxes())
+          , m_partitioner(m_bboxes)
+        {
+            bvh::Builder<TestTree, Partitioner> builder;
+            builder.build<DefaultWallclockTimer>(m_tree, m_partitioner, m_bboxes.size(), 1);
+        }
+
+        static vector<AABB3d> generate_bboxes()
+        {
+            vector<AABB3d> bboxes;
+
+            for (size_t i = 0; i < 20; ++i)
+            {
+                const double x = static_cast<double>(i);
+                bboxes.emplace_back(Vector3d(x, 0.0, 0.0), Vector3d(x + 0.5, 1.0, 1.0));
+            }
+
+            return bboxes;
+        }
+
+        // Return the item bounding boxes in the order of the items referenced by the leaves.
+        vector<AABB3d> get_ordered_bboxes(const Vector3d& offset) const
+        {
+            const vector<size_t>& ordering = m_partitioner.get_item_ordering();
+
+            vector<AABB3d> ordered_bboxes;
+
+            for (size_t i = 0; i < ordering.size(); ++i)
+            {
+                const AABB3d& bbox = m_bboxes[ordering[i]];
+                ordered_bboxes.emplace_back(bbox.min + offset, bbox.max + offset);
+            }
+
+            return ordered_bboxes;
+        }
+    };
+
+    TEST_CASE_F(Refit_GivenUnchangedItems_PreservesBoundingBoxes, Fixture)
+    {
+        const AABB3d left_bbox = m_tree.get_root().get_left_bbox();
+        const AABB3d right_bbox = m_tree.get_root().get_right_bbox();
+
+        bvh::Refitter<TestTree> refitter;
+        const double cost = refitter.refit<DefaultWallclockTimer>(m_tree, get_ordered_bboxes(Vector3d(0.0)), 1.0, 1.0);
+
+        EXPECT_EQ(left_bbox, m_tree.get_root().get_left_bbox());
+        EXPECT_EQ(right_bbox, m_tree.get_root().get_right_bbox());
+        EXPECT_GT(0.0, cost);
+    }
+
+    TEST_CASE_F(Refit_GivenTranslatedItems_TranslatesBoundingBoxesAndPreservesCost, Fixture)
+    {
+        const Vector3d Offset(10.0, 20.0, 30.0);
+        const AABB3d left_bbox = m_tree.get_root().get_left_bbox();
+        const AABB3d right_bbox = m_tree.get_root().get_right_bbox();
+
+        bvh::Refitter<TestTree> refitter;
+        const double initial_cost = refitter.refit<DefaultWallclockTimer>(m_tree, get_ordered_bboxes(Vector3d(0.0)), 1.0, 1.0);
+        const double refitted_cost = refitter.refit<DefaultWallclockTimer>(m_tree, get_ordered_bboxes(Offset), 1.0, 1.0);
+
+        EXPECT_FEQ(left_bbox.min + Offset, m_tree.get_root().get_left_bbox().min);
+        EXPECT_FEQ(left_bbox.max + Offset, m_tree.get_root().get_left_bbox().max);
+        EXPECT_FEQ(right_bbox.min + Offset, m_tree.get_root().get_right_bbox().min);
+        EXPECT_FEQ(right_bbox.max + Offset, m_tree.get_root().get_right_bbox().max);
+        EXPECT_FEQ(initial_cost, refitted_cost);
+    }
+}
+
 TEST_SUITE(Foundation_Math_BVH_SpatialBuilder)
 {
     struct ItemHandler
@@ -29,12 +29,15 @@
 
 // appleseed.foundation headers.
 #include "foundation/image/filteredtile.h"
+#include "foundation/image/filteredtilekernels.h"
 #include "foundation/math/filter.h"
+#include "foundation/platform/cpudispatch.h"
 #include "foundation/utility/test.h"
 
 // Standard headers.
 #include <cstddef>
 #include <cstdio>
+#include <vector>
 
 using namespace foundation;
 using namespace std;
@@ -102,4 +105,40 @@ TEST_SUITE(Foundation_Image_FilteredTile)
         const BoxFilter2<float> filter(2.0f, 2.0f);
         test("unit tests/outputs/test_filteredtile_boxfilter_radius_2_0.txt", filter);
     }
+
+    void splat_row(
+        const SplatRowFunc      func,
+        const size_t            value_count,
+        vector<float>&          pixels)
+    {
+        const size_t PixelCount = 5;
+
+        vector<float> weights(PixelCount);
+        for (size_t i = 0; i < PixelCount; ++i)
+            weights[i] = 1.0f / (i + 3);
+
+        vector<float> values(value_count);
+        for (size_t c = 0; c < value_count; ++c)
+            values[c] = 1.0f / (c + 7);
+
+        pixels.assign(PixelCount * (value_count + 1), 0.1f);
+        func(&pixels[0], &weights[0], PixelCount, &values[0], value_count);
+    }
+
+    // Values and weights are not exactly representable so that a kernel using fused
+    // multiply-adds would round differently from the generic kernel.
+    TEST_CASE(SplatRow_HostKernel_MatchesGenericKernelExactly)
+    {
+        const SplatRowFunc generic_func = get_splat_row_func(InstructionSet::Generic);
+        const SplatRowFunc host_func = get_splat_row_func();
+
+        for (size_t value_count = 1; value_count <= 13; ++value_count)
+        {
+            vector<float> expected, actual;
+            splat_row(generic_func, value_count, expected);
+            splat_row(host_func, value_count, actual);
+
+            EXPECT_SEQUENCE_EQ(expected.size(), &expected[0], &actual[0]);
+        }
+    }
 }
@@ -376,6 +376,116 @@ TEST_SUITE(Foundation_Utility_Job_JobManager)
     }
 }
 
+TEST_SUITE(Foundation_Utility_Job_JobManager_WorkStealing)
+{
+    template <size_t ThreadCount>
+    struct Fixture
+    {
+        Logger      logger;
+        JobQueue    job_queue;
+        JobManager  job_manager;
+
+        Fixture()
+          : job_manager(logger, job_queue, ThreadCount, JobManager::WorkStealing)
+        {
+        }
+    };
+
+    class JobSpawningChildJobs
+      : public IJob
+    {
+      public:
+        JobSpawningChildJobs(
+            JobQueue&           job_queue,
+            const size_t        depth,
+            volatile uint32*    execution_count)
+          : m_job_queue(job_queue)
+          , m_depth(depth)
+          , m_execution_count(execution_count)
+        {
+        }
+
+        void execute(const size_t thread_index) override
+        {
+            atomic_inc(m_execution_count);
+
+            if (m_depth > 0)
+            {
+                for (size_t i = 0; i < 2; ++i)
+                {
+                    m_job_queue.spawn(
+                        new JobSpawningChildJobs(m_job_queue, m_depth - 1, m_execution_count),
+                        thread_index);
+                }
+            }
+        }
+
+      private:
+        JobQueue&           m_job_queue;
+        const size_t        m_depth;
+        volatile uint32*    m_execution_count;
+    };
+
+    TEST_CASE_F(JobManagerExecutesJobs, Fixture<4>)
+    {
+        volatile uint32 execution_count = 0;
+
+        for (size_t i = 0; i < 100; ++i)
+            job_queue.schedule(new JobNotifyingAboutExecution(&execution_count));
+
+        job_manager.start();
+        job_queue.wait_until_completion();
+
+        EXPECT_EQ(100, execution_count);
+        EXPECT_FALSE(job_queue.has_scheduled_or_running_jobs());
+    }
+
+    TEST_CASE_F(JobManagerExecutesJobsScheduledAfterStart, Fixture<4>)
+    {
+        volatile uint32 execution_count = 0;
+
+        job_manager.start();
+
+        for (size_t i = 0; i < 100; ++i)
+            job_queue.schedule(new JobNotifyingAboutExecution(&execution_count));
+
+        job_queue.wait_until_completion();
+
+        EXPECT_EQ(100, execution_count);
+        EXPECT_FALSE(job_queue.has_scheduled_or_running_jobs());
+    }
+
+    TEST_CASE_F(JobManagerExecutesChildJobs, Fixture<4>)
+    {
+        volatile uint32 execution_count = 0;
+
+        job_queue.schedule(new JobSpawningChildJobs(job_queue, 8, &execution_count));
+
+        job_manager.start();
+        job_queue.wait_until_completion();
+
+        EXPECT_EQ(511, execution_count);
+        EXPECT_FALSE(job_queue.has_scheduled_or_running_jobs());
+    }
+
+    TEST_CASE_F(WaitUntilCompletion_GivenChildJobsSpawnedByRetiringJobs_WaitsForChildJobs, Fixture<4>)
+    {
+        job_manager.start();
+
+        // Child jobs are spawned right before their parent is retired: the wait must not return in between.
+        bool all_jobs_executed = true;
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            volatile uint32 execution_count = 0;
+            job_queue.schedule(new JobSpawningChildJobs(job_queue, 3, &execution_count));
+            job_queue.wait_until_completion();
+            all_jobs_executed = all_jobs_executed && execution_count == 15;
+        }
+
+        EXPECT_TRUE(all_jobs_executed);
+    }
+}
+
 TEST_SUITE(Foundation_Utility_Job_WorkerThread)
 {
     class TimeoutChecker
@@ -37,6 +37,8 @@
 #include "foundation/math/vector.h"
 #include "foundation/platform/timers.h"
 #include "foundation/utility/iostreamop.h"
+#include "foundation/utility/job.h"
+#include "foundation/utility/log.h"
 #include "foundation/utility/test.h"
 
 // Standard headers.
@@ -143,6 +145,81 @@ TEST_SUITE(Foundation_Math_Knn_Builder)
     }
 }
 
+TEST_SUITE(Foundation_Math_Knn_ParallelBuilder)
+{
+    TEST_CASE(BuildMovePoints_GivenZeroPoint_BuildsEmptyTree)
+    {
+        Logger logger;
+        JobQueue job_queue;
+        JobManager job_manager(logger, job_queue, 4);
+        job_manager.start();
+
+        vector<Vector3d> points;
+        knn::Tree3d tree;
+        knn::ParallelBuilder3d builder(tree);
+        builder.build_move_points<DefaultWallclockTimer>(points, job_queue, 4);
+
+        EXPECT_TRUE(tree.empty());
+        ASSERT_EQ(1, tree.m_nodes.size());
+        EXPECT_TRUE(tree.m_nodes[0].is_leaf());
+        EXPECT_EQ(0, tree.m_nodes[0].get_point_count());
+    }
+
+    TEST_CASE(BuildMovePoints_AnswersQueriesLikeSingleThreadedBuilder)
+    {
+        const size_t PointCount = 100000;
+        const size_t QueryCount = 100;
+        const size_t AnswerSize = 20;
+
+        MersenneTwister rng;
+        vector<Vector3d> points;
+        for (size_t i = 0; i < PointCount; ++i)
+            points.push_back(rand_vector1<Vector3d>(rng));
+
+        knn::Tree3d reference_tree;
+        knn::Builder3d reference_builder(reference_tree);
+        reference_builder.build<DefaultWallclockTimer>(&points[0], PointCount);
+
+        Logger logger;
+        JobQueue job_queue;
+        JobManager job_manager(logger, job_queue, 4);
+        job_manager.start();
+
+        knn::Tree3d tree;
+        knn::ParallelBuilder3d builder(tree);
+        builder.build_move_points<DefaultWallclockTimer>(points, job_queue, 16);
+
+        ASSERT_EQ(reference_tree.m_nodes.size(), tree.m_nodes.size());
+
+        knn::Answer<double> reference_answer(AnswerSize);
+        knn::Query3d reference_query(reference_tree, reference_answer);
+
+        knn::Answer<double> answer(AnswerSize);
+        knn::Query3d query(tree, answer);
+
+        for (size_t i = 0; i < QueryCount; ++i)
+        {
+            const Vector3d q = rand_vector1<Vector3d>(rng);
+
+            reference_query.run(q);
+            reference_answer.sort();
+
+            query.run(q);
+            answer.sort();
+
+            ASSERT_EQ(reference_answer.size(), answer.size());
+
+            for (size_t j = 0; j < AnswerSize; ++j)
+            {
+                const size_t reference_index = reference_tree.remap(reference_answer.get(j).m_index);
+                const size_t index = tree.remap(answer.get(j).m_index);
+                EXPECT_EQ(reference_index, index);
+                EXPECT_EQ(reference_tree.get_point(reference_answer.get(j).m_index), tree.get_point(answer.get(j).m_index));
+            }
+        }
+    }
+}
+
 TEST_SUITE(Foundation_Math_Knn_Answer)
 {
     TEST_CASE(Size_AfterZeroInsertion_ReturnsZero)
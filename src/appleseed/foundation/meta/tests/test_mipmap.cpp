@@ -0,0 +1,117 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/image/canvasproperties.h"
+#include "foundation/image/color.h"
+#include "foundation/image/mipmap.h"
+#include "foundation/image/pixel.h"
+#include "foundation/image/tile.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <memory>
+
+using namespace foundation;
+using namespace std;
+
+TEST_SUITE(Foundation_Image_Mipmap)
+{
+    TEST_CASE(GetMipmapLevelCount_GivenSinglePixelCanvas_ReturnsOne)
+    {
+        const CanvasProperties props(1, 1, 32, 32, 3, PixelFormatFloat);
+
+        EXPECT_EQ(1, get_mipmap_level_count(props));
+    }
+
+    TEST_CASE(GetMipmapLevelCount_GivenNonSquareCanvas_ReturnsLevelCountOfLargestDimension)
+    {
+        const CanvasProperties props(100, 10, 32, 32, 3, PixelFormatFloat);
+
+        // 100, 50, 25, 13, 7, 4, 2, 1.
+        EXPECT_EQ(8, get_mipmap_level_count(props));
+    }
+
+    TEST_CASE(GetMipmapLevelProperties_RoundsLevelSizeUp)
+    {
+        const CanvasProperties props(100, 10, 32, 32, 3, PixelFormatFloat);
+
+        const CanvasProperties level_props = get_mipmap_level_properties(props, 3);
+
+        EXPECT_EQ(13, level_props.m_canvas_width);
+        EXPECT_EQ(2, level_props.m_canvas_height);
+        EXPECT_EQ(32, level_props.m_tile_width);
+        EXPECT_EQ(32, level_props.m_tile_height);
+        EXPECT_EQ(1, level_props.m_tile_count_x);
+        EXPECT_EQ(1, level_props.m_tile_count_y);
+    }
+
+    TEST_CASE(CreateMipmapTile_AveragesParentPixelsAcrossTiles)
+    {
+        // A 4x4 canvas made of four 2x2 tiles; each tile is filled with its own value.
+        const CanvasProperties parent_props(4, 4, 2, 2, 1, PixelFormatFloat);
+
+        Tile t00(2, 2, 1, PixelFormatFloat);
+        Tile t10(2, 2, 1, PixelFormatFloat);
+        Tile t01(2, 2, 1, PixelFormatFloat);
+        Tile t11(2, 2, 1, PixelFormatFloat);
+        t00.clear(Color<float, 1>(1.0f));
+        t10.clear(Color<float, 1>(2.0f));
+        t01.clear(Color<float, 1>(3.0f));
+        t11.clear(Color<float, 1>(4.0f));
+
+        const Tile* const parent_tiles[4] = { &t00, &t10, &t01, &t11 };
+        unique_ptr<Tile> tile(create_mipmap_tile(parent_props, 0, 0, parent_tiles));
+
+        EXPECT_EQ(2, tile->get_width());
+        EXPECT_EQ(2, tile->get_height());
+        EXPECT_EQ(1.0f, tile->get_component<float>(0, 0, 0));
+        EXPECT_EQ(2.0f, tile->get_component<float>(1, 0, 0));
+        EXPECT_EQ(3.0f, tile->get_component<float>(0, 1, 0));
+        EXPECT_EQ(4.0f, tile->get_component<float>(1, 1, 0));
+    }
+
+    TEST_CASE(CreateMipmapTile_GivenOddCanvasWidth_ReplicatesLastColumn)
+    {
+        const CanvasProperties parent_props(3, 1, 4, 4, 1, PixelFormatFloat);
+
+        Tile parent(3, 1, 1, PixelFormatFloat);
+        parent.set_component(0, 0, 0, 1.0f);
+        parent.set_component(1, 0, 0, 3.0f);
+        parent.set_component(2, 0, 0, 5.0f);
+
+        const Tile* const parent_tiles[4] = { &parent, nullptr, nullptr, nullptr };
+        unique_ptr<Tile> tile(create_mipmap_tile(parent_props, 0, 0, parent_tiles));
+
+        EXPECT_EQ(2, tile->get_width());
+        EXPECT_EQ(1, tile->get_height());
+        EXPECT_EQ(2.0f, tile->get_component<float>(0, 0, 0));
+        EXPECT_EQ(5.0f, tile->get_component<float>(1, 0, 0));
+    }
+}
@@ -0,0 +1,207 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/platform/thread.h"
+#include "foundation/utility/objectpool.h"
+#include "foundation/utility/test.h"
+
+// Boost headers.
+#include "boost/atomic/atomic.hpp"
+#include "boost/thread/thread.hpp"
+
+// Standard headers.
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+using namespace foundation;
+using namespace std;
+
+TEST_SUITE(Foundation_Utility_ObjectPool)
+{
+    struct Counter
+    {
+        size_t m_created_count;
+
+        Counter()
+          : m_created_count(0)
+        {
+        }
+
+        int* operator()()
+        {
+            return new int(static_cast<int>(m_created_count++));
+        }
+    };
+
+    TEST_CASE(Acquire_GivenIdleObject_ReturnsIdleObject)
+    {
+        ObjectPool<int> pool(4);
+        Counter counter;
+
+        ObjectPool<int>::ObjectPtr object(pool.acquire(std::ref(counter)));
+        pool.release(move(object));
+        object = pool.acquire(std::ref(counter));
+
+        EXPECT_EQ(1, counter.m_created_count);
+        EXPECT_EQ(1, pool.get_object_count());
+    }
+
+    TEST_CASE(Acquire_GivenThrowingCreate_DoesNotCountObject)
+    {
+        ObjectPool<int> pool(1);
+
+        try
+        {
+            pool.acquire([]() -> int* { throw runtime_error("cannot create object"); });
+        }
+        catch (const runtime_error&)
+        {
+        }
+
+        EXPECT_EQ(0, pool.get_object_count());
+
+        Counter counter;
+        const ObjectPool<int>::ObjectPtr object(pool.acquire(std::ref(counter)));
+
+        EXPECT_EQ(1, pool.get_object_count());
+    }
+
+    TEST_CASE(Clear_DestroysIdleObjects)
+    {
+        ObjectPool<int> pool(4);
+        Counter counter;
+
+        ObjectPool<int>::ObjectPtr object1(pool.acquire(std::ref(counter)));
+        ObjectPool<int>::ObjectPtr object2(pool.acquire(std::ref(counter)));
+        pool.release(move(object1));
+        pool.clear();
+
+        EXPECT_EQ(1, pool.get_object_count());
+    }
+
+    TEST_CASE(ScopedObject_GivenExceptionWhileInUse_DiscardsObject)
+    {
+        ObjectPool<int> pool(1);
+        Counter counter;
+
+        try
+        {
+            ObjectPool<int>::ScopedObject object(pool, std::ref(counter));
+            throw runtime_error("cannot use object");
+        }
+        catch (const runtime_error&)
+        {
+        }
+
+        EXPECT_EQ(0, pool.get_object_count());
+
+        // The pool has room for a new object, acquire() must not block.
+        ObjectPool<int>::ScopedObject object(pool, std::ref(counter));
+        object.release();
+
+        EXPECT_EQ(2, counter.m_created_count);
+        EXPECT_EQ(1, pool.get_object_count());
+    }
+
+    TEST_CASE(ScopedObject_GivenRelease_ReturnsObjectToPool)
+    {
+        ObjectPool<int> pool(1);
+        Counter counter;
+
+        {
+            ObjectPool<int>::ScopedObject object(pool, std::ref(counter));
+            object.release();
+        }
+
+        const ObjectPool<int>::ObjectPtr object(pool.acquire(std::ref(counter)));
+
+        EXPECT_EQ(1, counter.m_created_count);
+        EXPECT_EQ(1, pool.get_object_count());
+    }
+
+    struct ConcurrentUser
+    {
+        ObjectPool<int>&        m_pool;
+        boost::atomic<size_t>&  m_created_count;
+        boost::atomic<size_t>&  m_in_use_count;
+        boost::atomic<size_t>&  m_max_in_use_count;
+
+        void operator()()
+        {
+            for (size_t i = 0; i < 20; ++i)
+            {
+                ObjectPool<int>::ObjectPtr object(
+                    m_pool.acquire(
+                        [this]()
+                        {
+                            ++m_created_count;
+                            return new int(0);
+                        }));
+
+                const size_t in_use_count = ++m_in_use_count;
+                size_t max_in_use_count = m_max_in_use_count;
+                while (in_use_count > max_in_use_count)
+                {
+                    if (m_max_in_use_count.compare_exchange_weak(max_in_use_count, in_use_count))
+                        break;
+                }
+
+                yield();
+
+                --m_in_use_count;
+                m_pool.release(move(object));
+            }
+        }
+    };
+
+    TEST_CASE(Acquire_GivenMoreThreadsThanMaxObjectCount_NeverExceedsMaxObjectCount)
+    {
+        const size_t MaxObjectCount = 2;
+        const size_t ThreadCount = 8;
+
+        ObjectPool<int> pool(MaxObjectCount);
+        boost::atomic<size_t> created_count(0);
+        boost::atomic<size_t> in_use_count(0);
+        boost::atomic<size_t> max_in_use_count(0);
+
+        boost::thread_group threads;
+        for (size_t i = 0; i < ThreadCount; ++i)
+        {
+            threads.create_thread(
+                ConcurrentUser{ pool, created_count, in_use_count, max_in_use_count });
+        }
+        threads.join_all();
+
+        EXPECT_LT(MaxObjectCount + 1, created_count.load());
+        EXPECT_LT(MaxObjectCount + 1, max_in_use_count.load());
+        EXPECT_EQ(created_count.load(), pool.get_object_count());
+    }
+}
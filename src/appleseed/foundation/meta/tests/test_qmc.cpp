@@ -46,6 +46,7 @@
 #include "foundation/utility/testutils.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
@@ -172,6 +173,138 @@ TEST_SUITE(Foundation_Math_QMC)
         EXPECT_FEQ(7.0 / 9, permuted_radical_inverse<double>(3, Perm, 7));
     }
 
+    TEST_CASE(ReverseBits)
+    {
+        EXPECT_EQ(0x00000000u, reverse_bits(0x00000000u));
+        EXPECT_EQ(0x80000000u, reverse_bits(0x00000001u));
+        EXPECT_EQ(0x00000001u, reverse_bits(0x80000000u));
+        EXPECT_EQ(0x0000FFFFu, reverse_bits(0xFFFF0000u));
+        EXPECT_EQ(0x48000000u, reverse_bits(0x00000012u));
+    }
+
+    TEST_CASE(SobolSample_FirstDimension_MatchesRadicalInverseBase2)
+    {
+        for (uint32 i = 0; i < 1000; ++i)
+            EXPECT_FEQ(radical_inverse_base2<double>(i), sobol_sample<double>(0, i));
+    }
+
+    TEST_CASE(SobolSample_SecondDimension)
+    {
+        EXPECT_FEQ(0.0,     sobol_sample<double>(1, 0));
+        EXPECT_FEQ(0.5,     sobol_sample<double>(1, 1));
+        EXPECT_FEQ(0.75,    sobol_sample<double>(1, 2));
+        EXPECT_FEQ(0.25,    sobol_sample<double>(1, 3));
+        EXPECT_FEQ(0.625,   sobol_sample<double>(1, 4));
+        EXPECT_FEQ(0.125,   sobol_sample<double>(1, 5));
+        EXPECT_FEQ(0.375,   sobol_sample<double>(1, 6));
+        EXPECT_FEQ(0.875,   sobol_sample<double>(1, 7));
+    }
+
+    // Return true if each elementary interval of volume 1/count contains exactly one point.
+    bool is_02_net(const vector<Vector2d>& points)
+    {
+        const size_t count = points.size();
+        const size_t log_count = log2_int(count);
+        assert(count == size_t(1) << log_count);
+
+        for (size_t k = 0; k <= log_count; ++k)
+        {
+            const size_t cols = size_t(1) << k;
+            const size_t rows = count / cols;
+
+            vector<size_t> cells(count, 0);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const size_t x = truncate<size_t>(points[i].x * cols);
+                const size_t y = truncate<size_t>(points[i].y * rows);
+
+                if (++cells[y * cols + x] > 1)
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    TEST_CASE(SobolSequence_FirstTwoDimensions_Form02Nets)
+    {
+        for (size_t block = 0; block < 4; ++block)
+        {
+            vector<Vector2d> points;
+
+            for (uint32 i = 0; i < 256; ++i)
+                points.push_back(sobol_sequence<double, 2>(static_cast<uint32>(block * 256 + i)));
+
+            EXPECT_TRUE(is_02_net(points));
+        }
+    }
+
+    TEST_CASE(SobolSequence_EachDimensionIsStratified)
+    {
+        for (size_t d = 0; d < SobolDimensionCount; ++d)
+        {
+            vector<size_t> cells(256, 0);
+
+            for (uint32 i = 0; i < 256; ++i)
+                ++cells[truncate<size_t>(sobol_sample<double>(d, i) * 256)];
+
+            for (size_t i = 0; i < 256; ++i)
+                EXPECT_EQ(1, cells[i]);
+        }
+    }
+
+    TEST_CASE(OwenScramble_IsBijective)
+    {
+        vector<uint32> values;
+
+        for (uint32 i = 0; i < 4096; ++i)
+            values.push_back(owen_scramble(i << 20, 0x12345678u) >> 20);
+
+        sort(values.begin(), values.end());
+
+        for (uint32 i = 0; i < 4096; ++i)
+            EXPECT_EQ(i, values[i]);
+    }
+
+    TEST_CASE(OwenScrambledSobolSequence_FirstTwoDimensions_Form02Nets)
+    {
+        for (uint32 seed = 0; seed < 8; ++seed)
+        {
+            vector<Vector2d> points;
+
+            for (uint32 i = 0; i < 256; ++i)
+                points.push_back(owen_scrambled_sobol_sequence<double, 2>(seed, 256 + i));
+
+            EXPECT_TRUE(is_02_net(points));
+        }
+    }
+
+    TEST_CASE(OwenScrambledSobolSequence_FloatSamplesAreLessThanOne)
+    {
+        for (uint32 i = 0; i < 4096; ++i)
+        {
+            const Vector4f p = owen_scrambled_sobol_sequence<float, 4>(42, i);
+
+            for (size_t d = 0; d < 4; ++d)
+            {
+                EXPECT_TRUE(p[d] >= 0.0f);
+                EXPECT_TRUE(p[d] < 1.0f);
+            }
+        }
+    }
+
+    TEST_CASE(BlueNoiseMask_IsPermutationOfRanks)
+    {
+        const size_t PixelCount = BlueNoiseMaskSize * BlueNoiseMaskSize;
+
+        vector<uint16> ranks(BlueNoiseMask, BlueNoiseMask + PixelCount);
+        sort(ranks.begin(), ranks.end());
+
+        for (size_t i = 0; i < PixelCount; ++i)
+            EXPECT_EQ(i, ranks[i]);
+    }
+
     static const size_t PointCount = 256;
 
     TEST_CASE(Generate2DRandomSequenceImage)
@@ -259,6 +392,23 @@ TEST_SUITE(Foundation_Math_QMC)
         generate_halton_sequence_image(23, 29, "reverse");
     }
 
+    TEST_CASE(Generate2DSobolSequenceImages)
+    {
+        vector<Vector2d> points;
+
+        for (size_t i = 0; i < PointCount; ++i)
+            points.push_back(sobol_sequence<double, 2>(static_cast<uint32>(i)));
+
+        write_point_cloud_image("unit tests/outputs/test_qmc_sobol.png", points);
+
+        points.clear();
+
+        for (size_t i = 0; i < PointCount; ++i)
+            points.push_back(owen_scrambled_sobol_sequence<double, 2>(1, static_cast<uint32>(i)));
+
+        write_point_cloud_image("unit tests/outputs/test_qmc_sobol_owen_scrambled.png", points);
+    }
+
     void generate_hammersley_sequence_image(
         const size_t    b,
         const string&   permutation)
@@ -0,0 +1,130 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.foundation headers.
+#include "foundation/math/permutation.h"
+#include "foundation/math/ray.h"
+#include "foundation/math/rayordering.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace std;
+
+TEST_SUITE(Foundation_Math_RayOrdering)
+{
+    TEST_CASE(CoherentRayOrdering_GivenEmptyStream_ReturnsEmptyOrdering)
+    {
+        vector<size_t> ordering;
+        vector<uint64> keys;
+        coherent_ray_ordering(ordering, keys, static_cast<const Ray3d*>(nullptr), 0);
+
+        EXPECT_TRUE(ordering.empty());
+    }
+
+    TEST_CASE(CoherentRayOrdering_ReturnsPermutation)
+    {
+        vector<Ray3d> rays;
+        for (size_t i = 0; i < 100; ++i)
+        {
+            const double x = static_cast<double>((i * 37) % 100);
+            rays.emplace_back(
+                Vector3d(x, 100.0 - x, 0.5 * x),
+                Vector3d(i & 1 ? 1.0 : -1.0, i & 2 ? 1.0 : -1.0, i & 4 ? 1.0 : -1.0));
+        }
+
+        vector<size_t> ordering;
+        vector<uint64> keys;
+        coherent_ray_ordering(ordering, keys, &rays[0], rays.size());
+
+        ASSERT_EQ(rays.size(), ordering.size());
+        EXPECT_TRUE(is_permutation(ordering.size(), &ordering[0]));
+    }
+
+    TEST_CASE(CoherentRayOrdering_GroupsRaysByDirectionOctant)
+    {
+        const Ray3d rays[] =
+        {
+            Ray3d(Vector3d(0.0), Vector3d(-1.0, 0.0, 0.0)),
+            Ray3d(Vector3d(0.0), Vector3d(+1.0, 0.0, 0.0)),
+            Ray3d(Vector3d(1.0), Vector3d(-1.0, 0.0, 0.0)),
+            Ray3d(Vector3d(1.0), Vector3d(+1.0, 0.0, 0.0))
+        };
+
+        vector<size_t> ordering;
+        vector<uint64> keys;
+        coherent_ray_ordering(ordering, keys, rays, 4);
+
+        ASSERT_EQ(4, ordering.size());
+        EXPECT_EQ(1, ordering[0]);
+        EXPECT_EQ(3, ordering[1]);
+        EXPECT_EQ(0, ordering[2]);
+        EXPECT_EQ(2, ordering[3]);
+    }
+
+    TEST_CASE(CoherentRayOrdering_GivenRaysWithSameOrigin_GroupsRaysBySimilarDirection)
+    {
+        const Ray3d rays[] =
+        {
+            Ray3d(Vector3d(0.0), Vector3d(1.0, 0.0, 0.0)),
+            Ray3d(Vector3d(0.0), Vector3d(0.0, 0.0, 1.0)),
+            Ray3d(Vector3d(0.0), Vector3d(1.0, 0.05, 0.0)),
+            Ray3d(Vector3d(0.0), Vector3d(0.0, 0.05, 1.0))
+        };
+
+        vector<size_t> ordering;
+        vector<uint64> keys;
+        coherent_ray_ordering(ordering, keys, rays, 4);
+
+        ASSERT_EQ(4, ordering.size());
+        EXPECT_EQ(1, ordering[0]);
+        EXPECT_EQ(3, ordering[1]);
+        EXPECT_EQ(0, ordering[2]);
+        EXPECT_EQ(2, ordering[3]);
+    }
+
+    TEST_CASE(CoherentRayOrdering_GivenIdenticalRays_PreservesInputOrder)
+    {
+        const Ray3d ray(Vector3d(1.0, 2.0, 3.0), Vector3d(0.0, 0.0, 1.0));
+        const Ray3d rays[] = { ray, ray, ray };
+
+        vector<size_t> ordering;
+        vector<uint64> keys;
+        coherent_ray_ordering(ordering, keys, rays, 3);
+
+        ASSERT_EQ(3, ordering.size());
+        EXPECT_EQ(0, ordering[0]);
+        EXPECT_EQ(1, ordering[1]);
+        EXPECT_EQ(2, ordering[2]);
+    }
+}
@@ -29,12 +29,15 @@
 
 // appleseed.foundation headers.
 #include "foundation/math/fp.h"
+#include "foundation/math/hash.h"
 #include "foundation/math/qmc.h"
 #include "foundation/math/rng/mersennetwister.h"
 #include "foundation/math/sampling/mappings.h"
 #include "foundation/math/sampling/qmcsamplingcontext.h"
 #include "foundation/math/scalar.h"
 #include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/gnuplotfile.h"
 #include "foundation/utility/iostreamop.h"
 #include "foundation/utility/string.h"
 #include "foundation/utility/test.h"
@@ -42,6 +45,7 @@
 #include "foundation/utility/vpythonfile.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
@@ -131,6 +135,134 @@ TEST_SUITE(Foundation_Math_Sampling_QMCSamplingContext)
         EXPECT_EQ(4, child_child_context.m_dimension);
         EXPECT_EQ(0, child_child_context.m_instance);
     }
+
+    TEST_CASE(SobolMode_SplitWithKnownSampleCount_IsStratified)
+    {
+        RNG rng;
+        SamplingContext context(rng, SamplingContext::SobolMode, 2, 16, 0);
+
+        for (size_t i = 0; i < 16; ++i)
+        {
+            context.next2<Vector2d>();
+
+            SamplingContext child_context = context.split(2, 64);
+
+            vector<size_t> cells_x(64, 0);
+            vector<size_t> cells_y(64, 0);
+
+            for (size_t j = 0; j < 64; ++j)
+            {
+                const Vector2d s = child_context.next2<Vector2d>();
+                ++cells_x[truncate<size_t>(s.x * 64)];
+                ++cells_y[truncate<size_t>(s.y * 64)];
+            }
+
+            for (size_t j = 0; j < 64; ++j)
+            {
+                EXPECT_EQ(1, cells_x[j]);
+                EXPECT_EQ(1, cells_y[j]);
+            }
+        }
+    }
+}
+
+TEST_SUITE(Foundation_Math_Sampling_QMCSamplingContext_Convergence)
+{
+    typedef MersenneTwister RNG;
+    typedef QMCSamplingContext<RNG> SamplingContext;
+
+    const size_t PixelCount = 64;
+    const size_t MaxSampleCount = 256;
+
+    // A 6D integrand made of three smooth 2D terms, one per split, whose integral over [0,1)^6 is 1.
+    double integrand(SamplingContext& sampling_context)
+    {
+        double value = 0.0;
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            sampling_context.split_in_place(2, 1);
+            const Vector2d s = sampling_context.next2<Vector2d>();
+            value += 2.0 * s.x * s.x * s.y;
+        }
+
+        return value;
+    }
+
+    // Return the RMS error of the estimates of a set of pixels, for 1, 2, 4... samples per pixel.
+    vector<Vector2d> compute_rms_errors(const SamplingContext::Mode mode)
+    {
+        vector<double> squared_errors;
+
+        for (size_t p = 0; p < PixelCount; ++p)
+        {
+            // Render pixels like the uniform pixel renderer does.
+            const size_t instance =
+                mode == SamplingContext::SobolMode
+                    ? p * MaxSampleCount
+                    : hash_uint32(static_cast<uint32>(p));
+
+            RNG rng(static_cast<uint32>(p));
+            SamplingContext sampling_context(rng, mode, 2, 0, instance);
+
+            double sum = 0.0;
+
+            for (size_t i = 0, n = 1; i < MaxSampleCount; ++i)
+            {
+                sampling_context.next2<Vector2d>();
+
+                SamplingContext child_sampling_context(sampling_context);
+                sum += integrand(child_sampling_context);
+
+                if (i + 1 == n)
+                {
+                    const size_t k = log2_int(n);
+                    squared_errors.resize(max(squared_errors.size(), k + 1), 0.0);
+                    squared_errors[k] += square(sum / n - 1.0);
+                    n *= 2;
+                }
+            }
+        }
+
+        vector<Vector2d> rms_errors;
+
+        for (size_t k = 0; k < squared_errors.size(); ++k)
+            rms_errors.emplace_back(static_cast<double>(size_t(1) << k), sqrt(squared_errors[k] / PixelCount));
+
+        return rms_errors;
+    }
+
+    TEST_CASE(Integrate6DFunction)
+    {
+        const vector<Vector2d> rng_errors = compute_rms_errors(SamplingContext::RNGMode);
+        const vector<Vector2d> qmc_errors = compute_rms_errors(SamplingContext::QMCMode);
+        const vector<Vector2d> sobol_errors = compute_rms_errors(SamplingContext::SobolMode);
+
+        GnuplotFile plotfile;
+        plotfile.set_title("RMS Error");
+        plotfile.set_xlabel("Samples");
+        plotfile.set_logscale_x();
+        plotfile.set_logscale_y();
+        plotfile
+            .new_plot()
+            .set_points(rng_errors)
+            .set_title("RNG")
+            .set_color("blue");
+        plotfile
+            .new_plot()
+            .set_points(qmc_errors)
+            .set_title("QMC")
+            .set_color("red");
+        plotfile
+            .new_plot()
+            .set_points(sobol_errors)
+            .set_title("Sobol")
+            .set_color("green");
+        plotfile.write("unit tests/outputs/test_sampling_convergence.gnuplot");
+
+        EXPECT_LT(rng_errors.back().y, sobol_errors.back().y);
+        EXPECT_LT(qmc_errors.back().y, sobol_errors.back().y);
+    }
 }
 
 TEST_SUITE(Foundation_Math_Sampling_QMCSamplingContext_DirectIlluminationSimulation)
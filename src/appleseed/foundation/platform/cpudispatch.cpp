@@ -0,0 +1,83 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "cpudispatch.h"
+
+// appleseed.foundation headers.
+#include "foundation/platform/system.h"
+#include "foundation/utility/otherwise.h"
+
+namespace foundation
+{
+
+namespace
+{
+    InstructionSet detect_host_instruction_set()
+    {
+#ifdef APPLESEED_X86
+        System::X86CPUFeatures features;
+        System::detect_x86_cpu_features(features);
+
+        if (features.m_os_avx && features.m_hw_avx && features.m_hw_avx2)
+            return InstructionSet::AVX2;
+#endif
+
+        return InstructionSet::Generic;
+    }
+}
+
+InstructionSet get_compiled_instruction_set()
+{
+#ifdef APPLESEED_USE_AVX2
+    return InstructionSet::AVX2;
+#else
+    return InstructionSet::Generic;
+#endif
+}
+
+InstructionSet get_host_instruction_set()
+{
+    static const InstructionSet isa = detect_host_instruction_set();
+    return isa;
+}
+
+const char* get_instruction_set_name(const InstructionSet isa)
+{
+    switch (isa)
+    {
+      case InstructionSet::Generic: return "generic";
+      case InstructionSet::AVX2:    return "AVX2";
+      assert_otherwise;
+    }
+
+    // Keep the compiler happy.
+    return "";
+}
+
+}   // namespace foundation
@@ -0,0 +1,67 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.main headers.
+#include "main/dllsymbol.h"
+
+namespace foundation
+{
+
+//
+// Runtime selection of SIMD kernels.
+//
+// Most SIMD code paths are selected at compile time (see the USE_SSE42, USE_AVX and
+// USE_AVX2 CMake options). A small number of batch kernels are additionally compiled
+// for several instruction sets and the best variant supported by the host CPU is
+// picked at run time, so that a single binary runs on older CPUs while still taking
+// advantage of newer ones.
+//
+// Only the FilteredTile splat kernels are dispatched at run time so far. BVH traversal,
+// ray/triangle intersection, DynamicSpectrum31f arithmetic and color conversions still
+// use the instruction set the whole library was compiled for.
+//
+
+enum class InstructionSet
+{
+    Generic,                // whatever the rest of the library is compiled for
+    AVX2                    // AVX2, with operating system support for AVX
+};
+
+// Return the instruction set the library as a whole was compiled for.
+APPLESEED_DLLSYMBOL InstructionSet get_compiled_instruction_set();
+
+// Return the most capable instruction set supported by the host CPU.
+// The CPU is only queried the first time this function is called.
+APPLESEED_DLLSYMBOL InstructionSet get_host_instruction_set();
+
+// Return a human-readable name for a given instruction set.
+APPLESEED_DLLSYMBOL const char* get_instruction_set_name(const InstructionSet isa);
+
+}   // namespace foundation
@@ -32,6 +32,7 @@
 
 // appleseed.foundation headers.
 #include "foundation/platform/arch.h"
+#include "foundation/platform/cpudispatch.h"
 #include "foundation/platform/defaulttimers.h"
 #include "foundation/platform/thread.h"
 #include "foundation/utility/log.h"
@@ -930,6 +931,7 @@ void System::print_information(Logger& logger)
         "  L2 cache                      size %s, line size %s\n"
         "  L3 cache                      size %s, line size %s\n"
         "  instruction sets              %s\n"
+        "  runtime kernels               %s\n"
         "  physical memory               size %s\n"
         "  virtual memory                size %s\n"
         "  default wallclock timer       %s Hz\n"
@@ -948,10 +950,23 @@ void System::print_information(Logger& logger)
         pretty_size(get_l3_cache_size()).c_str(),
         pretty_size(get_l3_cache_line_size()).c_str(),
         isa.c_str(),
+        get_instruction_set_name(get_host_instruction_set()),
         pretty_size(get_total_physical_memory_size()).c_str(),
         pretty_size(get_total_virtual_memory_size()).c_str(),
         pretty_uint(DefaultWallclockTimer().frequency()).c_str(),
         pretty_uint(DefaultProcessorTimer().frequency()).c_str());
+
+    // Code paths that are not dispatched at run time will fault on CPUs lacking the compiled instruction set.
+    if (get_compiled_instruction_set() == InstructionSet::AVX2 &&
+        get_host_instruction_set() != InstructionSet::AVX2)
+    {
+        logger.write(
+            LogMessage::Warning,
+            __FILE__,
+            __LINE__,
+            "this build of appleseed requires %s but the host CPU does not support it.",
+            get_instruction_set_name(get_compiled_instruction_set()));
+    }
 }
 
 const char* System::get_cpu_architecture()
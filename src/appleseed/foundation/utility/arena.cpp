@@ -0,0 +1,136 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "arena.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+namespace foundation
+{
+
+//
+// Arena class implementation.
+//
+
+Arena::~Arena()
+{
+    for (size_t i = 0, e = m_blocks.size(); i < e; ++i)
+        aligned_free(m_blocks[i].m_storage);
+}
+
+size_t Arena::get_overflow_block_size() const
+{
+    size_t size = 0;
+
+    for (size_t i = 0, e = m_blocks.size(); i < e; ++i)
+        size += m_blocks[i].m_size;
+
+    return size;
+}
+
+void* Arena::allocate_overflow(const size_t size)
+{
+    ++m_overflow_count;
+
+    // Leave the current block.
+    m_previous_blocks_size += static_cast<size_t>(m_current - m_begin);
+
+    // Reuse the next overflow block that is large enough, or allocate a new one.
+    while (m_next_block < m_blocks.size() && m_blocks[m_next_block].m_size < size)
+        ++m_next_block;
+
+    if (m_next_block == m_blocks.size())
+    {
+        Block block;
+        block.m_size = max<size_t>(OverflowBlockSize, align(size, 16));
+        block.m_storage = static_cast<uint8*>(aligned_malloc(block.m_size, 16));
+        if (block.m_storage == nullptr)
+            throw bad_alloc();
+        m_blocks.push_back(block);
+    }
+
+    const Block& block = m_blocks[m_next_block++];
+    m_begin = block.m_storage;
+    m_end = block.m_storage + block.m_size;
+    m_current = block.m_storage;
+
+    void* ptr = m_current;
+    m_current += align(size, 16);
+
+    assert(m_current <= m_end);
+    assert(is_aligned(ptr, 16));
+
+    return ptr;
+}
+
+namespace
+{
+    // Return the number of allocations of a given size that allocate() makes in a block
+    // before moving to the next one. allocate_overflow() skips blocks that are too small.
+    size_t get_block_capacity(
+        const size_t    block_size,
+        const size_t    allocation_size,
+        const size_t    stride)
+    {
+        return
+            block_size < allocation_size
+                ? 0
+                : (block_size - allocation_size) / stride + 1;
+    }
+}
+
+const void* Arena::get_allocation(const size_t i, const size_t size) const
+{
+    const size_t stride = align(size, 16);
+    size_t index = i;
+
+    const size_t inline_capacity = get_block_capacity(ArenaSize, size, stride);
+    if (index < inline_capacity)
+        return m_storage + index * stride;
+    index -= inline_capacity;
+
+    for (size_t b = 0; b < m_next_block; ++b)
+    {
+        const Block& block = m_blocks[b];
+
+        const size_t block_capacity = get_block_capacity(block.m_size, size, stride);
+        if (index < block_capacity)
+            return block.m_storage + index * stride;
+        index -= block_capacity;
+    }
+
+    assert(!"Invalid arena allocation index.");
+    return nullptr;
+}
+
+}   // namespace foundation
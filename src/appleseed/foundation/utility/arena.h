@@ -30,7 +30,7 @@
 #pragma once
 
 // appleseed.foundation headers.
-#include "foundation/core/exceptions/exception.h"
+#include "foundation/core/concepts/noncopyable.h"
 #include "foundation/platform/compiler.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/memory.h"
@@ -38,6 +38,8 @@
 // Standard headers.
 #include <cassert>
 #include <cstddef>
+#include <new>
+#include <vector>
 
 namespace foundation
 {
@@ -45,12 +47,20 @@ namespace foundation
 //
 // An arena is a temporary heap providing extremely cheap memory allocation.
 //
+// Allocations are first served from an inline block. When it is exhausted,
+// the arena spills into additional heap blocks which are kept by the arena
+// after clear() and reused by subsequent allocations, so that a thread only
+// hits the heap until its arena has grown to the size of its largest workload.
+//
 
 class Arena
+  : public NonCopyable
 {
   public:
     Arena();
+    ~Arena();
 
+    // Release all allocations. Overflow blocks are retained for reuse.
     void clear();
 
     void* allocate(const size_t size);
@@ -58,14 +68,50 @@ class Arena
     template <typename T> T* allocate();
     template <typename T> T* allocate_noinit();
 
+    // Return the inline block, where the first allocations since clear() are made.
     const uint8* get_storage() const;
 
+    // Return the i'th object allocated since clear(), assuming that all allocations
+    // since clear() were made with allocate<T>() or allocate_noinit<T>(). Objects are
+    // looked up through the inline block and the overflow blocks in use.
+    template <typename T> const T& get_object(const size_t i) const;
+
+    // Return the largest number of bytes in use at any time, since construction.
+    size_t get_high_water_mark() const;
+
+    // Return the number of times allocations spilled into an overflow block.
+    uint64 get_overflow_count() const;
+
+    // Return the number of overflow blocks and their total size in bytes.
+    size_t get_overflow_block_count() const;
+    size_t get_overflow_block_size() const;
+
   private:
-    enum { ArenaSize = 384 * 1024 };    // bytes
+    enum { ArenaSize = 384 * 1024 };            // bytes
+    enum { OverflowBlockSize = 256 * 1024 };    // bytes
+
+    struct Block
+    {
+        uint8*                  m_storage;
+        size_t                  m_size;
+    };
 
     APPLESEED_SIMD4_ALIGN uint8 m_storage[ArenaSize];
+    uint8*                      m_begin;
     const uint8*                m_end;
     uint8*                      m_current;
+
+    std::vector<Block>          m_blocks;               // overflow blocks, reused across clear()
+    size_t                      m_next_block;           // index of the next overflow block to use
+    size_t                      m_previous_blocks_size; // bytes used in blocks before the current one
+    size_t                      m_high_water_mark;
+    uint64                      m_overflow_count;
+
+    size_t get_current_size() const;
+
+    void* allocate_overflow(const size_t size);
+
+    const void* get_allocation(const size_t i, const size_t size) const;
 };
 
 
@@ -74,20 +120,33 @@ class Arena
 //
 
 inline Arena::Arena()
-  : m_end(m_storage + ArenaSize)
+  : m_begin(m_storage)
+  , m_end(m_storage + ArenaSize)
   , m_current(m_storage)
+  , m_next_block(0)
+  , m_previous_blocks_size(0)
+  , m_high_water_mark(0)
+  , m_overflow_count(0)
 {
 }
 
 inline void Arena::clear()
 {
+    const size_t size = get_current_size();
+    if (m_high_water_mark < size)
+        m_high_water_mark = size;
+
+    m_begin = m_storage;
+    m_end = m_storage + ArenaSize;
     m_current = m_storage;
+    m_next_block = 0;
+    m_previous_blocks_size = 0;
 }
 
 inline void* Arena::allocate(const size_t size)
 {
     if (m_current + size > m_end)
-        throw Exception("out of arena memory");
+        return allocate_overflow(size);
 
     void* ptr = m_current;
     m_current += align(size, 16);
@@ -118,4 +177,31 @@ inline const uint8* Arena::get_storage() const
     return m_storage;
 }
 
+template <typename T>
+inline const T& Arena::get_object(const size_t i) const
+{
+    return *static_cast<const T*>(get_allocation(i, sizeof(T)));
+}
+
+inline size_t Arena::get_high_water_mark() const
+{
+    const size_t size = get_current_size();
+    return m_high_water_mark < size ? size : m_high_water_mark;
+}
+
+inline uint64 Arena::get_overflow_count() const
+{
+    return m_overflow_count;
+}
+
+inline size_t Arena::get_overflow_block_count() const
+{
+    return m_blocks.size();
+}
+
+inline size_t Arena::get_current_size() const
+{
+    return m_previous_blocks_size + static_cast<size_t>(m_current - m_begin);
+}
+
 }   // namespace foundation
@@ -427,7 +427,10 @@ bool BufferedFile::seek(
             target_index = max<int64>(current_index + offset, 0);
         }
 
-        if (target_index >= m_file_index &&
+        // In write mode, the buffer must be flushed since only the bytes before
+        // the current buffer index would be written out on the next flush.
+        if (m_file_mode == ReadMode &&
+            target_index >= m_file_index &&
             target_index <  m_file_index + static_cast<int64>(m_buffer_end))
         {
             // Seek within the I/O buffer.
@@ -103,6 +103,9 @@ void JobManager::start()
     // Create worker threads if they don't already exist.
     if (impl->m_worker_threads.empty())
     {
+        if (impl->m_flags & WorkStealing)
+            impl->m_job_queue.enable_work_stealing(impl->m_thread_count);
+
         for (size_t i = 0; i < impl->m_thread_count; ++i)
         {
             impl->m_worker_threads.push_back(
@@ -121,10 +124,16 @@ void JobManager::start()
 
 void JobManager::stop()
 {
+    if (impl->m_worker_threads.empty())
+        return;
+
     // Stop and delete worker threads.
     for (each<Impl::WorkerThreads> i = impl->m_worker_threads; i; ++i)
         delete *i;
     impl->m_worker_threads.clear();
+
+    if (impl->m_flags & WorkStealing)
+        impl->m_job_queue.disable_work_stealing();
 }
 
 void JobManager::pause()
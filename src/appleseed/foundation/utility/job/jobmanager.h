@@ -58,7 +58,8 @@ class APPLESEED_DLLSYMBOL JobManager
     enum Flags
     {
         KeepRunningOnEmptyQueue = 1UL << 0,     // the worker thread keeps running even if the job queue is empty
-        KeepRunningOnJobFailure = 1UL << 1      // the worker thread keeps executing jobs from the work queue even if one or more jobs failed
+        KeepRunningOnJobFailure = 1UL << 1,     // the worker thread keeps executing jobs from the work queue even if one or more jobs failed
+        WorkStealing            = 1UL << 2      // each worker thread has its own deque of jobs and steals jobs from other workers when idle
     };
 
     // Constructor.
@@ -38,10 +38,13 @@
 #include "foundation/utility/job/ijob.h"
 
 // Boost headers.
+#include "boost/atomic/atomic.hpp"
 #include "boost/thread/condition_variable.hpp"
 
 // Standard headers.
 #include <cassert>
+#include <deque>
+#include <vector>
 
 using namespace std;
 
@@ -54,11 +57,38 @@ namespace foundation
 
 struct JobQueue::Impl
 {
+    // A deque of scheduled jobs owned by one worker thread. The owner takes
+    // jobs from the back, thieves take them from the front.
+    struct WorkerDeque
+    {
+        boost::mutex                m_mutex;
+        deque<JobInfo>              m_jobs;
+    };
+
+    typedef vector<WorkerDeque*> WorkerDequeVector;
+
     mutable boost::mutex            m_mutex;
     boost::condition_variable_any   m_event;
     JobList                         m_scheduled_jobs;
     JobList                         m_running_jobs;
 
+    // Work stealing mode.
+    WorkerDequeVector               m_worker_deques;
+    boost::atomic<size_t>           m_worker_scheduled_count;   // scheduled jobs in worker deques
+    boost::atomic<size_t>           m_worker_running_count;     // running jobs taken from worker deques
+    boost::atomic<size_t>           m_worker_pending_count;     // worker deque jobs not yet retired, scheduled or running
+    boost::atomic<size_t>           m_idle_worker_count;        // workers waiting for a job
+    boost::atomic<size_t>           m_next_worker_deque;
+
+    Impl()
+      : m_worker_scheduled_count(0)
+      , m_worker_running_count(0)
+      , m_worker_pending_count(0)
+      , m_idle_worker_count(0)
+      , m_next_worker_deque(0)
+    {
+    }
+
     static void delete_jobs(JobList& list)
     {
         for (each<JobList> i = list; i; ++i)
@@ -69,6 +99,61 @@ struct JobQueue::Impl
 
         list.clear();
     }
+
+    static size_t delete_jobs(WorkerDeque& worker_deque)
+    {
+        boost::mutex::scoped_lock lock(worker_deque.m_mutex);
+
+        const size_t count = worker_deque.m_jobs.size();
+
+        for (each<deque<JobInfo>> i = worker_deque.m_jobs; i; ++i)
+        {
+            if (i->m_owned)
+                delete i->m_job;
+        }
+
+        worker_deque.m_jobs.clear();
+
+        return count;
+    }
+
+    // Push a job onto a worker deque. External jobs are pushed at the front so
+    // that each worker executes them in scheduling order; child jobs are pushed
+    // at the back so that they are executed depth-first.
+    void push_worker_job(
+        const size_t    index,
+        const JobInfo&  job_info,
+        const bool      child)
+    {
+        WorkerDeque& worker_deque = *m_worker_deques[index];
+
+        // Count the job before it becomes visible so that the counts never underflow.
+        ++m_worker_pending_count;
+        ++m_worker_scheduled_count;
+
+        {
+            boost::mutex::scoped_lock lock(worker_deque.m_mutex);
+
+            if (child)
+                worker_deque.m_jobs.push_back(job_info);
+            else worker_deque.m_jobs.push_front(job_info);
+        }
+
+        // Wake up idle workers. Idle workers check the job count while holding
+        // the main mutex, so taking it here guarantees they don't miss the job.
+        if (m_idle_worker_count > 0)
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            m_event.notify_all();
+        }
+    }
+
+    // A single counter is used so that a child job spawned by a job about to be retired
+    // is never missed, as could happen when reading separate scheduled and running counts.
+    bool has_worker_jobs() const
+    {
+        return m_worker_pending_count > 0;
+    }
 };
 
 JobQueue::JobQueue()
@@ -82,15 +167,28 @@ JobQueue::~JobQueue()
 
     // At this point, no job must be running.
     assert(impl->m_running_jobs.empty());
+    assert(impl->m_worker_running_count == 0);
 
     // Delete all scheduled jobs that the queue owns.
     Impl::delete_jobs(impl->m_scheduled_jobs);
+    for (each<Impl::WorkerDequeVector> i = impl->m_worker_deques; i; ++i)
+    {
+        Impl::delete_jobs(**i);
+        delete *i;
+    }
 
     delete impl;
 }
 
 void JobQueue::clear_scheduled_jobs()
 {
+    for (each<Impl::WorkerDequeVector> i = impl->m_worker_deques; i; ++i)
+    {
+        const size_t deleted_job_count = Impl::delete_jobs(**i);
+        impl->m_worker_scheduled_count -= deleted_job_count;
+        impl->m_worker_pending_count -= deleted_job_count;
+    }
+
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
     impl->delete_jobs(impl->m_scheduled_jobs);
@@ -103,48 +201,63 @@ bool JobQueue::has_scheduled_jobs() const
 {
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
-    return !impl->m_scheduled_jobs.empty();
+    return !impl->m_scheduled_jobs.empty() || impl->m_worker_scheduled_count > 0;
 }
 
 bool JobQueue::has_running_jobs() const
 {
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
-    return !impl->m_running_jobs.empty();
+    return !impl->m_running_jobs.empty() || impl->m_worker_running_count > 0;
 }
 
 bool JobQueue::has_scheduled_or_running_jobs() const
 {
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
-    return !impl->m_scheduled_jobs.empty() || !impl->m_running_jobs.empty();
+    return
+        !impl->m_scheduled_jobs.empty() ||
+        !impl->m_running_jobs.empty() ||
+        impl->has_worker_jobs();
 }
 
 size_t JobQueue::get_scheduled_job_count() const
 {
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
-    return impl->m_scheduled_jobs.size();
+    return impl->m_scheduled_jobs.size() + impl->m_worker_scheduled_count;
 }
 
 size_t JobQueue::get_running_job_count() const
 {
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
-    return impl->m_running_jobs.size();
+    return impl->m_running_jobs.size() + impl->m_worker_running_count;
 }
 
 size_t JobQueue::get_total_job_count() const
 {
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
-    return impl->m_scheduled_jobs.size() + impl->m_running_jobs.size();
+    return
+        impl->m_scheduled_jobs.size() +
+        impl->m_running_jobs.size() +
+        impl->m_worker_scheduled_count +
+        impl->m_worker_running_count;
 }
 
 void JobQueue::schedule(IJob* job, const bool transfer_ownership)
 {
     assert(job);
 
+    if (!impl->m_worker_deques.empty())
+    {
+        // Distribute jobs among worker deques in round-robin order.
+        const size_t index = impl->m_next_worker_deque++ % impl->m_worker_deques.size();
+        impl->push_worker_job(index, JobInfo(job, transfer_ownership), false);
+        return;
+    }
+
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
     impl->m_scheduled_jobs.push_back(JobInfo(job, transfer_ownership));
@@ -153,12 +266,24 @@ void JobQueue::schedule(IJob* job, const bool transfer_ownership)
     impl->m_event.notify_all();
 }
 
+void JobQueue::spawn(
+    IJob*           job,
+    const size_t    thread_index,
+    const bool      transfer_ownership)
+{
+    assert(job);
+
+    if (thread_index < impl->m_worker_deques.size())
+        impl->push_worker_job(thread_index, JobInfo(job, transfer_ownership), true);
+    else schedule(job, transfer_ownership);
+}
+
 void JobQueue::wait_until_completion()
 {
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
     // Wait until there is no more scheduled or running jobs.
-    while (!impl->m_scheduled_jobs.empty() || !impl->m_running_jobs.empty())
+    while (!impl->m_scheduled_jobs.empty() || !impl->m_running_jobs.empty() || impl->has_worker_jobs())
         impl->m_event.wait(lock);
 }
 
@@ -197,8 +322,92 @@ JobQueue::RunningJobInfo JobQueue::wait_for_scheduled_job(AbortSwitch& abort_swi
     return acquire_scheduled_job_no_lock();
 }
 
+JobQueue::RunningJobInfo JobQueue::wait_for_scheduled_job(
+    AbortSwitch&    abort_switch,
+    const size_t    thread_index)
+{
+    if (impl->m_worker_deques.empty())
+        return wait_for_scheduled_job(abort_switch);
+
+    while (true)
+    {
+        const RunningJobInfo running_job_info = acquire_worker_job(thread_index);
+        if (running_job_info.first.m_job)
+            return running_job_info;
+
+        boost::mutex::scoped_lock lock(impl->m_mutex);
+
+        // Jobs scheduled before work stealing was enabled are kept in the shared list.
+        if (!impl->m_scheduled_jobs.empty() || abort_switch.is_aborted())
+            return acquire_scheduled_job_no_lock();
+
+        // Wait for a job to be pushed onto one of the worker deques.
+        ++impl->m_idle_worker_count;
+        if (impl->m_worker_scheduled_count == 0)
+            impl->m_event.wait(lock);
+        --impl->m_idle_worker_count;
+    }
+}
+
+JobQueue::RunningJobInfo JobQueue::acquire_worker_job(const size_t thread_index)
+{
+    const size_t deque_count = impl->m_worker_deques.size();
+    assert(thread_index < deque_count);
+
+    if (impl->m_worker_scheduled_count > 0)
+    {
+        // Visit the worker's own deque first, then the deques of the other workers
+        // by increasing distance. Workers with neighboring indices are most likely
+        // to run on neighboring cores, and on the same NUMA node.
+        for (size_t d = 0; d < deque_count; ++d)
+        {
+            Impl::WorkerDeque& worker_deque = *impl->m_worker_deques[(thread_index + d) % deque_count];
+            boost::mutex::scoped_lock lock(worker_deque.m_mutex);
+
+            if (!worker_deque.m_jobs.empty())
+            {
+                // The owner takes jobs from the back: its most recent child job, or
+                // else its earliest scheduled external job. Thieves take from the front
+                // the job the owner would run last: its latest scheduled external job,
+                // or else its oldest child job.
+                const JobInfo job_info = d == 0 ? worker_deque.m_jobs.back() : worker_deque.m_jobs.front();
+                if (d == 0)
+                    worker_deque.m_jobs.pop_back();
+                else worker_deque.m_jobs.pop_front();
+
+                // Count the job as running before it stops being counted as scheduled
+                // so that wait_until_completion() cannot observe an empty queue.
+                ++impl->m_worker_running_count;
+                --impl->m_worker_scheduled_count;
+
+                // Running jobs taken from worker deques are not stored in the running list.
+                return RunningJobInfo(job_info, impl->m_running_jobs.end());
+            }
+        }
+    }
+
+    return RunningJobInfo(JobInfo(nullptr, false), impl->m_running_jobs.end());
+}
+
 void JobQueue::retire_running_job(const RunningJobInfo& running_job_info)
 {
+    if (running_job_info.second == impl->m_running_jobs.end())
+    {
+        // The job was taken from a worker deque.
+        if (running_job_info.first.m_owned)
+            delete running_job_info.first.m_job;
+
+        // Notify threads waiting for completion when the last job is retired.
+        --impl->m_worker_running_count;
+        if (--impl->m_worker_pending_count == 0)
+        {
+            boost::mutex::scoped_lock lock(impl->m_mutex);
+            impl->m_event.notify_all();
+        }
+
+        return;
+    }
+
     boost::mutex::scoped_lock lock(impl->m_mutex);
 
     // Remove the job from the running list.
@@ -212,6 +421,39 @@ void JobQueue::retire_running_job(const RunningJobInfo& running_job_info)
     impl->m_event.notify_all();
 }
 
+void JobQueue::enable_work_stealing(const size_t thread_count)
+{
+    assert(impl->m_worker_deques.empty());
+
+    for (size_t i = 0; i < thread_count; ++i)
+        impl->m_worker_deques.push_back(new Impl::WorkerDeque());
+}
+
+void JobQueue::disable_work_stealing()
+{
+    assert(impl->m_worker_running_count == 0);
+
+    boost::mutex::scoped_lock lock(impl->m_mutex);
+
+    // Move the jobs left in the worker deques back to the shared list, in execution order.
+    for (each<Impl::WorkerDequeVector> i = impl->m_worker_deques; i; ++i)
+    {
+        deque<JobInfo>& jobs = (*i)->m_jobs;
+
+        while (!jobs.empty())
+        {
+            impl->m_scheduled_jobs.push_back(jobs.back());
+            jobs.pop_back();
+        }
+
+        delete *i;
+    }
+
+    impl->m_worker_deques.clear();
+    impl->m_worker_scheduled_count = 0;
+    impl->m_worker_pending_count = 0;
+}
+
 void JobQueue::signal_event()
 {
     boost::mutex::scoped_lock lock(impl->m_mutex);
@@ -66,6 +66,12 @@ namespace foundation
 //   - scheduled: the job was inserted into the job queue, but hasn't yet been executed
 //   - running: the job is currently being executed
 //
+// When the queue is serviced by a job manager in work stealing mode (see
+// foundation::JobManager::WorkStealing), scheduled jobs are distributed among
+// per-worker deques instead of a single shared list. Each worker executes jobs
+// from its own deque and, when it runs out of work, steals from other workers
+// the jobs they would run last, so that workers only contend when they are idle.
+//
 
 class APPLESEED_DLLSYMBOL JobQueue
   : public NonCopyable
@@ -102,10 +108,20 @@ class APPLESEED_DLLSYMBOL JobQueue
     // to the job queue if and only if transfer_ownership is true.
     void schedule(IJob* job, const bool transfer_ownership = true);
 
+    // Schedule a child job from a job running on a given worker thread.
+    // In work stealing mode, the child job is pushed onto the deque of this
+    // worker and executed before the jobs scheduled earlier, unless another
+    // worker steals it. Otherwise this is equivalent to schedule().
+    void spawn(
+        IJob*           job,
+        const size_t    thread_index,
+        const bool      transfer_ownership = true);
+
     // Wait until all scheduled and running jobs are completed.
     void wait_until_completion();
 
   private:
+    friend class JobManager;
     friend class WorkerThread;
 
     struct Impl;
@@ -142,6 +158,22 @@ class APPLESEED_DLLSYMBOL JobQueue
     // Wait for a scheduled job to be available.
     RunningJobInfo wait_for_scheduled_job(AbortSwitch& abort_switch);
 
+    // Wait for a scheduled job to be available to a given worker thread.
+    // In work stealing mode, the worker's own deque is searched first, then
+    // the shared list, then the deques of the other workers.
+    RunningJobInfo wait_for_scheduled_job(
+        AbortSwitch&    abort_switch,
+        const size_t    thread_index);
+
+    // Acquire a job from the worker deques without blocking.
+    RunningJobInfo acquire_worker_job(const size_t thread_index);
+
+    // Create or destroy one deque per worker thread. Jobs left in the deques
+    // are moved back to the shared list when work stealing is disabled.
+    // These methods must not be called while worker threads are running.
+    void enable_work_stealing(const size_t thread_count);
+    void disable_work_stealing();
+
     // Retire a running job. The job is deleted if it is owned by the queue.
     void retire_running_job(const RunningJobInfo& running_job_info);
 
@@ -0,0 +1,253 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+
+// Boost headers.
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/mutex.hpp"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace foundation
+{
+
+//
+// A thread-safe pool of expensive-to-create objects, such as open file readers.
+//
+// Objects are created on demand, but no more than a given number of them ever exist
+// at the same time: when all of them are in use, acquire() blocks until another
+// thread releases one.
+//
+
+template <typename T>
+class ObjectPool
+  : public NonCopyable
+{
+  public:
+    typedef std::unique_ptr<T> ObjectPtr;
+
+    // An object acquired from the pool. Unless it is explicitly returned to the pool
+    // with release(), the object is discarded when the guard goes out of scope, for
+    // instance when an exception is thrown while the object is in use.
+    class ScopedObject
+      : public NonCopyable
+    {
+      public:
+        template <typename Create>
+        ScopedObject(ObjectPool& pool, Create create);
+
+        ~ScopedObject();
+
+        T* operator->() const;
+
+        // Return the object to the pool.
+        void release();
+
+      private:
+        ObjectPool&     m_pool;
+        ObjectPtr       m_object;
+    };
+
+    // Constructor.
+    explicit ObjectPool(const size_t max_object_count);
+
+    // Return an idle object, or one created by create() if none is idle and the maximum
+    // number of objects is not reached yet, or wait for an object to be released.
+    template <typename Create>
+    ObjectPtr acquire(Create create);
+
+    // Return an object obtained with acquire() to the pool.
+    void release(ObjectPtr object);
+
+    // Destroy an object obtained with acquire(), making room for a new one.
+    void discard(ObjectPtr object);
+
+    // Destroy all idle objects.
+    void clear();
+
+    // Return the number of existing objects, idle or in use.
+    size_t get_object_count() const;
+
+    // Return the maximum number of objects that may exist at the same time.
+    size_t get_max_object_count() const;
+
+  private:
+    const size_t                m_max_object_count;
+    mutable boost::mutex        m_mutex;
+    boost::condition_variable   m_object_released;
+    std::vector<ObjectPtr>      m_idle_objects;
+    size_t                      m_object_count;
+};
+
+
+//
+// ObjectPool class implementation.
+//
+
+template <typename T>
+ObjectPool<T>::ObjectPool(const size_t max_object_count)
+  : m_max_object_count(max_object_count)
+  , m_object_count(0)
+{
+    assert(max_object_count > 0);
+}
+
+template <typename T>
+template <typename Create>
+typename ObjectPool<T>::ObjectPtr ObjectPool<T>::acquire(Create create)
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+
+        while (m_idle_objects.empty() && m_object_count == m_max_object_count)
+            m_object_released.wait(lock);
+
+        if (!m_idle_objects.empty())
+        {
+            ObjectPtr object(std::move(m_idle_objects.back()));
+            m_idle_objects.pop_back();
+            return object;
+        }
+
+        // Reserve a slot for the new object.
+        ++m_object_count;
+    }
+
+    // Create the object without holding the lock.
+    try
+    {
+        return ObjectPtr(create());
+    }
+    catch (...)
+    {
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            --m_object_count;
+        }
+
+        m_object_released.notify_one();
+        throw;
+    }
+}
+
+template <typename T>
+void ObjectPool<T>::release(ObjectPtr object)
+{
+    assert(object);
+
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_idle_objects.push_back(std::move(object));
+    }
+
+    m_object_released.notify_one();
+}
+
+template <typename T>
+void ObjectPool<T>::discard(ObjectPtr object)
+{
+    assert(object);
+
+    object.reset();
+
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        assert(m_object_count > 0);
+        --m_object_count;
+    }
+
+    m_object_released.notify_one();
+}
+
+template <typename T>
+void ObjectPool<T>::clear()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    assert(m_object_count >= m_idle_objects.size());
+    m_object_count -= m_idle_objects.size();
+    m_idle_objects.clear();
+}
+
+template <typename T>
+size_t ObjectPool<T>::get_object_count() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_object_count;
+}
+
+template <typename T>
+size_t ObjectPool<T>::get_max_object_count() const
+{
+    return m_max_object_count;
+}
+
+
+
+//
+// ObjectPool::ScopedObject class implementation.
+//
+
+template <typename T>
+template <typename Create>
+ObjectPool<T>::ScopedObject::ScopedObject(ObjectPool& pool, Create create)
+  : m_pool(pool)
+  , m_object(pool.acquire(create))
+{
+}
+
+template <typename T>
+ObjectPool<T>::ScopedObject::~ScopedObject()
+{
+    if (m_object)
+        m_pool.discard(std::move(m_object));
+}
+
+template <typename T>
+T* ObjectPool<T>::ScopedObject::operator->() const
+{
+    assert(m_object);
+    return m_object.get();
+}
+
+template <typename T>
+void ObjectPool<T>::ScopedObject::release()
+{
+    assert(m_object);
+    m_pool.release(std::move(m_object));
+}
+
+}   // namespace foundation
@@ -56,6 +56,7 @@
 #include "foundation/platform/types.h"
 #include "foundation/utility/alignedallocator.h"
 #include "foundation/utility/foreach.h"
+#include "foundation/utility/job.h"
 #include "foundation/utility/lazy.h"
 #include "foundation/utility/siphash.h"
 #include "foundation/utility/statistics.h"
@@ -78,9 +79,23 @@ namespace renderer
 // AssemblyTree class implementation.
 //
 
+AssemblyTree::Item::Item(
+    const Assembly*                     assembly,
+    const AssemblyInstance*             assembly_instance,
+    const TransformSequence&            transform_sequence)
+  : m_assembly(assembly)
+  , m_assembly_uid(assembly->get_uid())
+  , m_assembly_instance(assembly_instance)
+  , m_assembly_instance_uid(assembly_instance->get_uid())
+  , m_transform_sequence(transform_sequence)
+{
+}
+
 AssemblyTree::AssemblyTree(const Scene& scene)
   : TreeType(AlignedAllocator<void>(System::get_l1_data_cache_line_size()))
   , m_scene(scene)
+  , m_thread_count(System::get_logical_cpu_core_count())
+  , m_built_sah_cost(0.0)
 #ifdef APPLESEED_WITH_EMBREE
   , m_use_embree(false)
   , m_dirty(false)
@@ -95,10 +110,17 @@ AssemblyTree::~AssemblyTree()
 
 void AssemblyTree::update()
 {
-    rebuild_assembly_tree();
+    if (!refit_assembly_tree())
+        rebuild_assembly_tree();
+
     update_tree_hierarchy();
 }
 
+void AssemblyTree::set_thread_count(const size_t thread_count)
+{
+    m_thread_count = max<size_t>(thread_count, 1);
+}
+
 size_t AssemblyTree::get_memory_size() const
 {
     return
@@ -106,13 +128,15 @@ size_t AssemblyTree::get_memory_size() const
         - sizeof(*static_cast<const TreeType*>(this))
         + sizeof(*this)
         + m_items.capacity() * sizeof(AssemblyInstance*)
+        + m_item_ordering.capacity() * sizeof(size_t)
         + m_assembly_versions.size() * sizeof(pair<UniqueID, VersionID>);
 }
 
 void AssemblyTree::collect_assembly_instances(
     const AssemblyInstanceContainer&    assembly_instances,
     const TransformSequence&            parent_transform_seq,
-    AABBVector&                         assembly_instance_bboxes)
+    ItemVector&                         items,
+    AABBVector&                         assembly_instance_bboxes) const
 {
     for (const_each<AssemblyInstanceContainer> i = assembly_instances; i; ++i)
     {
@@ -131,6 +155,7 @@ void AssemblyTree::collect_assembly_instances(
         collect_assembly_instances(
             assembly.assembly_instances(),
             cumulated_transform_seq,
+            items,
             assembly_instance_bboxes);
 
         // Skip empty assemblies.
@@ -138,7 +163,7 @@ void AssemblyTree::collect_assembly_instances(
             continue;
 
         // Create and store an item for this assembly instance.
-        m_items.emplace_back(
+        items.emplace_back(
             &assembly,
             &assembly_instance,
             cumulated_transform_seq);
@@ -166,6 +191,7 @@ void AssemblyTree::rebuild_assembly_tree()
     collect_assembly_instances(
         m_scene.assembly_instances(),
         TransformSequence(),
+        m_items,
         assembly_instance_bboxes);
 
     RENDERER_LOG_INFO(
@@ -188,28 +214,127 @@ void AssemblyTree::rebuild_assembly_tree()
     statistics.insert_time("build time", builder.get_build_time());
     statistics.merge(bvh::TreeStatistics<AssemblyTree>(*this, AABB3d(m_scene.compute_bbox())));
 
+    m_item_ordering = partitioner.get_item_ordering();
+    assert(m_items.size() == m_item_ordering.size());
+
     if (!m_items.empty())
     {
-        const vector<size_t>& ordering = partitioner.get_item_ordering();
-        assert(m_items.size() == ordering.size());
-
         // Reorder the items according to the tree ordering.
-        ItemVector temp_assembly_instances(ordering.size());
+        ItemVector temp_assembly_instances(m_item_ordering.size());
         small_item_reorder(
             &m_items[0],
             &temp_assembly_instances[0],
-            &ordering[0],
-            ordering.size());
+            &m_item_ordering[0],
+            m_item_ordering.size());
+
+        // Compute the SAH cost of the tree, the reference for future refits.
+        AABBVector ordered_bboxes(m_item_ordering.size());
+        for (size_t i = 0, e = m_item_ordering.size(); i < e; ++i)
+            ordered_bboxes[i] = assembly_instance_bboxes[m_item_ordering[i]];
+        bvh::Refitter<AssemblyTree> refitter;
+        m_built_sah_cost =
+            refitter.refit<DefaultWallclockTimer>(
+                *this,
+                ordered_bboxes,
+                AssemblyTreeInteriorNodeTraversalCost,
+                AssemblyTreeTriangleIntersectionCost);
+        statistics.insert("sah cost", m_built_sah_cost);
+    }
 
-        // Store the items in the tree leaves whenever possible.
-        store_items_in_leaves(statistics);
+    finalize_assembly_tree(statistics);
+
+    // Print assembly tree statistics.
+    RENDERER_LOG_DEBUG("%s",
+        StatisticsVector::make(
+            "assembly tree statistics",
+            statistics).to_string().c_str());
+}
+
+bool AssemblyTree::refit_assembly_tree()
+{
+    // There is nothing to refit if the tree is empty.
+    if (m_items.empty())
+        return false;
+
+    // Collect assembly instances and their bounding boxes.
+    ItemVector items;
+    AABBVector assembly_instance_bboxes;
+    collect_assembly_instances(
+        m_scene.assembly_instances(),
+        TransformSequence(),
+        items,
+        assembly_instance_bboxes);
+
+    // The tree can only be refitted if the set of assembly instances is unchanged.
+    if (items.size() != m_items.size())
+        return false;
+    for (size_t i = 0, e = m_items.size(); i < e; ++i)
+    {
+        const Item& item = items[m_item_ordering[i]];
+        if (item.m_assembly_uid != m_items[i].m_assembly_uid ||
+            item.m_assembly_instance_uid != m_items[i].m_assembly_instance_uid)
+            return false;
+    }
+
+    RENDERER_LOG_INFO(
+        "refitting assembly tree (%s %s)...",
+        pretty_int(m_items.size()).c_str(),
+        plural(m_items.size(), "assembly instance").c_str());
+
+    Statistics statistics;
+
+    // Update the items and bring their bounding boxes in tree order.
+    AABBVector ordered_bboxes(m_items.size());
+    for (size_t i = 0, e = m_items.size(); i < e; ++i)
+    {
+        m_items[i] = items[m_item_ordering[i]];
+        ordered_bboxes[i] = assembly_instance_bboxes[m_item_ordering[i]];
+    }
+
+    // Refit the tree.
+    bvh::Refitter<AssemblyTree> refitter;
+    const double sah_cost =
+        refitter.refit<DefaultWallclockTimer>(
+            *this,
+            ordered_bboxes,
+            AssemblyTreeInteriorNodeTraversalCost,
+            AssemblyTreeTriangleIntersectionCost);
+
+    // Rebuild the tree if its quality degraded too much.
+    if (sah_cost > m_built_sah_cost * AssemblyTreeMaxRefitCostRatio)
+    {
+        RENDERER_LOG_DEBUG(
+            "assembly tree sah cost went from %f to %f, rebuilding tree...",
+            m_built_sah_cost,
+            sah_cost);
+        return false;
     }
 
+    statistics.insert_time("refit time", refitter.get_refit_time());
+    statistics.insert("sah cost", sah_cost);
+
+    finalize_assembly_tree(statistics);
+
     // Print assembly tree statistics.
     RENDERER_LOG_DEBUG("%s",
         StatisticsVector::make(
             "assembly tree statistics",
             statistics).to_string().c_str());
+
+    return true;
+}
+
+void AssemblyTree::finalize_assembly_tree(Statistics& statistics)
+{
+    // Store the items in the tree leaves whenever possible.
+    if (!m_items.empty())
+        store_items_in_leaves(statistics);
+
+    // Collapse the tree into a wide BVH.
+    bvh::Collapser<AssemblyTree> collapser;
+    collapser.collapse<DefaultWallclockTimer>(*this);
+    statistics.insert_time("collapse time", collapser.get_collapse_time());
+    statistics.insert("wide nodes", m_wide_nodes.size());
 }
 
 void AssemblyTree::store_items_in_leaves(Statistics& statistics)
@@ -254,6 +379,10 @@ void AssemblyTree::update_tree_hierarchy()
     // Delete child trees of assemblies that no longer exist.
     delete_unused_child_trees(assemblies);
 
+    // Triangle trees are built concurrently: share the available threads among them.
+    const size_t thread_count =
+        max<size_t>(m_thread_count / max<size_t>(assemblies.size(), 1), 1);
+
     // Create or rebuild the child trees of each assembly.
     for (const_each<AssemblyVector> i = assemblies; i; ++i)
     {
@@ -279,12 +408,19 @@ void AssemblyTree::update_tree_hierarchy()
                 continue;
             }
 
+            // The geometry of this assembly may only have moved or deformed: try to refit its child trees.
+            if (refit_child_trees(assembly))
+            {
+                m_assembly_versions[assembly.get_uid()] = current_version_id;
+                continue;
+            }
+
             // The child trees of this assembly are out-of-date: delete them.
             delete_child_trees(assembly.get_uid());
         }
 
         // Lazily build new child trees.
-        create_child_trees(assembly);
+        create_child_trees(assembly, thread_count);
 
         // Store the current version ID of the assembly.
         m_assembly_versions[assembly.get_uid()] = current_version_id;
@@ -348,6 +484,32 @@ namespace
         return false;
     }
 
+    size_t count_object_instances_of_type(const Assembly& assembly, const char* model)
+    {
+        size_t count = 0;
+
+        for (const_each<ObjectInstanceContainer> i = assembly.object_instances(); i; ++i)
+        {
+            if (strcmp(i->get_object().get_model(), model) == 0)
+                ++count;
+        }
+
+        return count;
+    }
+
+    size_t count_instanced_object_instances(const Assembly& assembly)
+    {
+        ObjectInstanceGroupVector groups;
+        collect_instanced_object_instances(assembly, groups);
+
+        size_t count = 0;
+
+        for (const_each<ObjectInstanceGroupVector> i = groups; i; ++i)
+            count += i->size();
+
+        return count;
+    }
+
     uint64 hash_assembly_geometry(const Assembly& assembly, const char* model)
     {
         uint64 hash = 0;
@@ -368,9 +530,32 @@ namespace
 
         return hash;
     }
+
+    // Like hash_assembly_geometry() for mesh objects, but also account for how mesh object
+    // instances are split between the triangle tree and the object instance tree, which
+    // depends on assembly parameters and material mappings.
+    uint64 hash_mesh_geometry(const Assembly& assembly)
+    {
+        uint64 hash = hash_assembly_geometry(assembly, MeshObjectFactory().get_model());
+
+        ObjectInstanceGroupVector groups;
+        collect_instanced_object_instances(assembly, groups);
+
+        for (const_each<ObjectInstanceGroupVector> i = groups; i; ++i)
+        {
+            hash = siphash24(hash, static_cast<uint64>(i->size()));
+
+            for (const_each<vector<size_t>> j = *i; j; ++j)
+                hash = siphash24(hash, static_cast<uint64>(*j));
+        }
+
+        return hash;
+    }
 }
 
-void AssemblyTree::create_child_trees(const Assembly& assembly)
+void AssemblyTree::create_child_trees(
+    const Assembly&             assembly,
+    const size_t                thread_count)
 {
 #ifdef APPLESEED_WITH_EMBREE
 
@@ -382,9 +567,20 @@ void AssemblyTree::create_child_trees(const Assembly& assembly)
 
 #endif
     {
-        // Create a triangle tree if there are mesh objects.
-        if (has_object_instances_of_type(assembly, MeshObjectFactory().get_model()))
-            create_triangle_tree(assembly);
+        // Create a triangle tree if there are mesh object instances to flatten,
+        // and an object instance tree if there are mesh object instances to instance.
+        const size_t mesh_instance_count =
+            count_object_instances_of_type(assembly, MeshObjectFactory().get_model());
+        if (mesh_instance_count > 0)
+        {
+            const size_t instanced_mesh_instance_count = count_instanced_object_instances(assembly);
+
+            if (instanced_mesh_instance_count < mesh_instance_count)
+                create_triangle_tree(assembly, thread_count);
+
+            if (instanced_mesh_instance_count > 0)
+                create_object_instance_tree(assembly, thread_count);
+        }
 
         // Create a curve tree if there are curve objects.
         if (has_object_instances_of_type(assembly, CurveObjectFactory().get_model()))
@@ -392,9 +588,11 @@ void AssemblyTree::create_child_trees(const Assembly& assembly)
     }
 }
 
-void AssemblyTree::create_triangle_tree(const Assembly& assembly)
+void AssemblyTree::create_triangle_tree(
+    const Assembly&             assembly,
+    const size_t                thread_count)
 {
-    const uint64 hash = hash_assembly_geometry(assembly, MeshObjectFactory().get_model());
+    const uint64 hash = hash_mesh_geometry(assembly);
     Lazy<TriangleTree>* tree = m_triangle_tree_repository.acquire(hash);
 
     if (tree == nullptr)
@@ -411,7 +609,8 @@ void AssemblyTree::create_triangle_tree(const Assembly& assembly)
                     m_scene,
                     assembly.get_uid(),
                     assembly_bbox,
-                    assembly)));
+                    assembly,
+                    thread_count)));
 
         tree = new Lazy<TriangleTree>(move(triangle_tree_factory));
         m_triangle_tree_repository.insert(hash, tree);
@@ -420,6 +619,68 @@ void AssemblyTree::create_triangle_tree(const Assembly& assembly)
     m_triangle_trees.insert(make_pair(assembly.get_uid(), tree));
 }
 
+bool AssemblyTree::refit_child_trees(const Assembly& assembly)
+{
+#ifdef APPLESEED_WITH_EMBREE
+
+    if (use_embree() || m_dirty)
+        return false;
+
+#endif
+
+    // Only assemblies whose mesh object instances are all flattened into a triangle tree are refitted.
+    const UniqueID assembly_uid = assembly.get_uid();
+    const TriangleTreeContainer::iterator tree_it = m_triangle_trees.find(assembly_uid);
+    if (tree_it == m_triangle_trees.end() ||
+        m_object_instance_trees.find(assembly_uid) != m_object_instance_trees.end() ||
+        m_curve_trees.find(assembly_uid) != m_curve_trees.end())
+        return false;
+
+    // The assembly must still call for a single triangle tree.
+    if (count_instanced_object_instances(assembly) > 0 ||
+        has_object_instances_of_type(assembly, CurveObjectFactory().get_model()))
+        return false;
+
+    // Trees shared with other assemblies are not refitted.
+    const uint64 hash = hash_mesh_geometry(assembly);
+    if (!m_triangle_tree_repository.rekey(tree_it->second, hash))
+        return false;
+
+    // Compute the assembly space bounding box of the assembly.
+    const GAABB3 assembly_bbox =
+        compute_parent_bbox<GAABB3>(
+            assembly.object_instances().begin(),
+            assembly.object_instances().end());
+
+    // Triangle trees are built at the end of each update, so this doesn't trigger a build.
+    Access<TriangleTree> triangle_tree(tree_it->second);
+    return triangle_tree->refit(assembly_bbox);
+}
+
+void AssemblyTree::create_object_instance_tree(
+    const Assembly&             assembly,
+    const size_t                thread_count)
+{
+    const uint64 hash = hash_mesh_geometry(assembly);
+    Lazy<ObjectInstanceTree>* tree = m_object_instance_tree_repository.acquire(hash);
+
+    if (tree == nullptr)
+    {
+        unique_ptr<ILazyFactory<ObjectInstanceTree>> object_instance_tree_factory(
+            new ObjectInstanceTreeFactory(
+                ObjectInstanceTree::Arguments(
+                    m_scene,
+                    assembly.get_uid(),
+                    assembly,
+                    thread_count)));
+
+        tree = new Lazy<ObjectInstanceTree>(move(object_instance_tree_factory));
+        m_object_instance_tree_repository.insert(hash, tree);
+    }
+
+    m_object_instance_trees.insert(make_pair(assembly.get_uid(), tree));
+}
+
 void AssemblyTree::create_curve_tree(const Assembly& assembly)
 {
     const uint64 hash = hash_assembly_geometry(assembly, CurveObjectFactory().get_model());
@@ -500,6 +761,7 @@ void AssemblyTree::delete_embree_scene(const UniqueID assembly_id)
 void AssemblyTree::delete_child_trees(const UniqueID assembly_id)
 {
     delete_triangle_tree(assembly_id);
+    delete_object_instance_tree(assembly_id);
     delete_curve_tree(assembly_id);
 #ifdef APPLESEED_WITH_EMBREE
     delete_embree_scene(assembly_id);
@@ -516,6 +778,16 @@ void AssemblyTree::delete_triangle_tree(const UniqueID assembly_id)
     }
 }
 
+void AssemblyTree::delete_object_instance_tree(const UniqueID assembly_id)
+{
+    const ObjectInstanceTreeContainer::iterator it = m_object_instance_trees.find(assembly_id);
+    if (it != m_object_instance_trees.end())
+    {
+        m_object_instance_tree_repository.release(it->second);
+        m_object_instance_trees.erase(it);
+    }
+}
+
 void AssemblyTree::delete_curve_tree(const UniqueID assembly_id)
 {
     const CurveTreeContainer::iterator it = m_curve_trees.find(assembly_id);
@@ -528,6 +800,45 @@ void AssemblyTree::delete_curve_tree(const UniqueID assembly_id)
 
 namespace
 {
+    template <typename TreeType>
+    class BuildTreeJob
+      : public IJob
+    {
+      public:
+        explicit BuildTreeJob(Lazy<TreeType>& tree)
+          : m_tree(tree)
+        {
+        }
+
+        void execute(const size_t thread_index) override
+        {
+            // Accessing the tree forces its construction.
+            Access<TreeType> access(&m_tree);
+        }
+
+      private:
+        Lazy<TreeType>& m_tree;
+    };
+
+    template <typename TreeType>
+    struct ScheduleTreeBuilds
+    {
+        JobQueue&   m_job_queue;
+        size_t      m_job_count;
+
+        explicit ScheduleTreeBuilds(JobQueue& job_queue)
+          : m_job_queue(job_queue)
+          , m_job_count(0)
+        {
+        }
+
+        void operator()(Lazy<TreeType>& tree, const size_t ref_count)
+        {
+            m_job_queue.schedule(new BuildTreeJob<TreeType>(tree));
+            ++m_job_count;
+        }
+    };
+
     template <typename TreeType>
     struct UpdateTrees
     {
@@ -543,8 +854,30 @@ namespace
 
 void AssemblyTree::update_triangle_trees()
 {
-    UpdateTrees<TriangleTree> update_trees;
-    m_triangle_tree_repository.for_each(update_trees);
+    // Build the triangle trees and object instance trees of all assemblies in parallel.
+    JobQueue job_queue;
+    ScheduleTreeBuilds<TriangleTree> schedule_triangle_tree_builds(job_queue);
+    m_triangle_tree_repository.for_each(schedule_triangle_tree_builds);
+    ScheduleTreeBuilds<ObjectInstanceTree> schedule_object_instance_tree_builds(job_queue);
+    m_object_instance_tree_repository.for_each(schedule_object_instance_tree_builds);
+    const size_t job_count =
+        schedule_triangle_tree_builds.m_job_count +
+        schedule_object_instance_tree_builds.m_job_count;
+    if (job_count > 0)
+    {
+        JobManager job_manager(
+            global_logger(),
+            job_queue,
+            min(job_count, m_thread_count));
+        job_manager.start();
+        job_queue.wait_until_completion();
+    }
+
+    // Update the non-geometry aspects of the triangle trees.
+    UpdateTrees<TriangleTree> update_triangle_trees;
+    m_triangle_tree_repository.for_each(update_triangle_trees);
+    UpdateTrees<ObjectInstanceTree> update_object_instance_trees;
+    m_object_instance_tree_repository.for_each(update_object_instance_trees);
 }
 
 
@@ -702,6 +1035,35 @@ bool AssemblyLeafVisitor::visit(
                 }
                 visitor.read_hit_triangle_data();
             }
+
+            // Retrieve the object instance tree of this assembly.
+            const ObjectInstanceTree* object_instance_tree =
+                m_object_instance_tree_cache.access(
+                    item.m_assembly_uid,
+                    m_tree.m_object_instance_trees);
+
+            if (object_instance_tree)
+            {
+                // Check the intersection between the ray and the object instance tree.
+                ObjectInstanceTreeIntersector intersector;
+                ObjectInstanceLeafVisitor visitor(
+                    *object_instance_tree,
+                    *item.m_assembly,
+                    local_shading_point
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , m_triangle_tree_stats
+#endif
+                    );
+                intersector.intersect_no_motion(
+                    *object_instance_tree,
+                    local_shading_point.m_ray,
+                    local_ray_info,
+                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , m_triangle_tree_stats
+#endif
+                    );
+            }
         }
 
         // Retrieve the curve tree of this assembly.
@@ -916,6 +1278,43 @@ bool AssemblyLeafProbeVisitor::visit(
                     return false;
                 }
             }
+
+            // Retrieve the object instance tree of this assembly.
+            const ObjectInstanceTree* object_instance_tree =
+                m_object_instance_tree_cache.access(
+                    item.m_assembly_uid,
+                    m_tree.m_object_instance_trees);
+
+            if (object_instance_tree)
+            {
+                // Check the intersection between the ray and the object instance tree.
+                ObjectInstanceTreeProbeIntersector intersector;
+                ObjectInstanceLeafProbeVisitor visitor(
+                    *object_instance_tree,
+                    *item.m_assembly,
+                    local_ray.m_time.m_normalized,
+                    local_ray.m_flags
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , m_triangle_tree_stats
+#endif
+                    );
+                intersector.intersect_no_motion(
+                    *object_instance_tree,
+                    local_ray,
+                    local_ray_info,
+                    visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                    , m_triangle_tree_stats
+#endif
+                    );
+
+                // Terminate traversal if there was a hit.
+                if (visitor.hit())
+                {
+                    m_hit = true;
+                    return false;
+                }
+            }
         }
 
         // Retrieve the curve tree of this assembly.
@@ -34,6 +34,8 @@
 #ifdef APPLESEED_WITH_EMBREE
 #include "renderer/kernel/intersection/embreescene.h"
 #endif
+#include "renderer/kernel/intersection/intersectionsettings.h"
+#include "renderer/kernel/intersection/objectinstancetree.h"
 #include "renderer/kernel/intersection/probevisitorbase.h"
 #include "renderer/kernel/intersection/treerepository.h"
 #include "renderer/kernel/intersection/triangletree.h"
@@ -69,10 +71,11 @@ namespace renderer
 //
 
 class AssemblyTree
-  : public foundation::bvh::Tree<
+  : public foundation::bvh::WideTree<
                foundation::AlignedVector<
                    foundation::bvh::Node<foundation::AABB3d>
-               >
+               >,
+               AssemblyTreeBranchingFactor
            >
 {
   public:
@@ -85,6 +88,10 @@ class AssemblyTree
     // Update the assembly tree and all the child trees.
     void update();
 
+    // Set the number of threads used to build the child trees.
+    // By default, as many threads as there are logical CPU cores are used.
+    void set_thread_count(const size_t thread_count);
+
     // Return the size (in bytes) of this object in memory.
     size_t get_memory_size() const;
 
@@ -105,6 +112,7 @@ class AssemblyTree
         const renderer::Assembly*               m_assembly;
         foundation::UniqueID                    m_assembly_uid;
         const renderer::AssemblyInstance*       m_assembly_instance;
+        foundation::UniqueID                    m_assembly_instance_uid;
         renderer::TransformSequence             m_transform_sequence;
 
         Item() {}
@@ -112,13 +120,7 @@ class AssemblyTree
         Item(
             const renderer::Assembly*           assembly,
             const renderer::AssemblyInstance*   assembly_instance,
-            const renderer::TransformSequence&  transform_sequence)
-          : m_assembly(assembly)
-          , m_assembly_uid(assembly->get_uid())
-          , m_assembly_instance(assembly_instance)
-          , m_transform_sequence(transform_sequence)
-        {
-        }
+            const renderer::TransformSequence&  transform_sequence);
     };
 
     typedef std::vector<Item> ItemVector;
@@ -127,12 +129,18 @@ class AssemblyTree
     typedef std::map<foundation::UniqueID, foundation::VersionID> AssemblyVersionMap;
 
     const Scene&                    m_scene;
+    size_t                          m_thread_count;
     ItemVector                      m_items;
+    std::vector<size_t>             m_item_ordering;
+    double                          m_built_sah_cost;
     AssemblyVersionMap              m_assembly_versions;
 
     TreeRepository<TriangleTree>    m_triangle_tree_repository;
     TriangleTreeContainer           m_triangle_trees;
 
+    TreeRepository<ObjectInstanceTree> m_object_instance_tree_repository;
+    ObjectInstanceTreeContainer     m_object_instance_trees;
+
     TreeRepository<CurveTree>       m_curve_tree_repository;
     CurveTreeContainer              m_curve_trees;
 
@@ -148,19 +156,31 @@ class AssemblyTree
     void collect_assembly_instances(
         const AssemblyInstanceContainer&        assembly_instances,
         const TransformSequence&                parent_transform_seq,
-        AABBVector&                             assembly_instance_bboxes);
+        ItemVector&                             items,
+        AABBVector&                             assembly_instance_bboxes) const;
 
     void rebuild_assembly_tree();
+    bool refit_assembly_tree();
+    void finalize_assembly_tree(foundation::Statistics& statistics);
     void store_items_in_leaves(foundation::Statistics& statistics);
 
     void update_tree_hierarchy();
     void collect_unique_assemblies(AssemblyVector& assemblies) const;
     void delete_unused_child_trees(const AssemblyVector& assemblies);
 
-    void create_child_trees(const Assembly& assembly);
-    void create_triangle_tree(const Assembly& assembly);
+    void create_child_trees(
+        const Assembly&                         assembly,
+        const size_t                            thread_count);
+    void create_triangle_tree(
+        const Assembly&                         assembly,
+        const size_t                            thread_count);
+    void create_object_instance_tree(
+        const Assembly&                         assembly,
+        const size_t                            thread_count);
     void create_curve_tree(const Assembly& assembly);
 
+    bool refit_child_trees(const Assembly& assembly);
+
 #ifdef APPLESEED_WITH_EMBREE
 
     void create_embree_scene(const Assembly& assembly);
@@ -170,6 +190,7 @@ class AssemblyTree
 
     void delete_child_trees(const foundation::UniqueID assembly_id);
     void delete_triangle_tree(const foundation::UniqueID assembly_id);
+    void delete_object_instance_tree(const foundation::UniqueID assembly_id);
     void delete_curve_tree(const foundation::UniqueID assembly_id);
 
     void update_triangle_trees();
@@ -189,6 +210,7 @@ class AssemblyLeafVisitor
         ShadingPoint&                               shading_point,
         const AssemblyTree&                         tree,
         TriangleTreeAccessCache&                    triangle_tree_cache,
+        ObjectInstanceTreeAccessCache&              object_instance_tree_cache,
         CurveTreeAccessCache&                       curve_tree_cache,
 #ifdef APPLESEED_WITH_EMBREE
         EmbreeSceneAccessCache&                     embree_scene_cache,
@@ -215,6 +237,7 @@ class AssemblyLeafVisitor
     ShadingPoint&                                   m_shading_point;
     const AssemblyTree&                             m_tree;
     TriangleTreeAccessCache&                        m_triangle_tree_cache;
+    ObjectInstanceTreeAccessCache&                  m_object_instance_tree_cache;
     CurveTreeAccessCache&                           m_curve_tree_cache;
 #ifdef APPLESEED_WITH_EMBREE
     EmbreeSceneAccessCache&                         m_embree_scene_cache;
@@ -240,6 +263,7 @@ class AssemblyLeafProbeVisitor
     AssemblyLeafProbeVisitor(
         const AssemblyTree&                         tree,
         TriangleTreeAccessCache&                    triangle_tree_cache,
+        ObjectInstanceTreeAccessCache&              object_instance_tree_cache,
         CurveTreeAccessCache&                       curve_tree_cache,
 #ifdef APPLESEED_WITH_EMBREE
         EmbreeSceneAccessCache&                     embree_scene_cache,
@@ -265,6 +289,7 @@ class AssemblyLeafProbeVisitor
   private:
     const AssemblyTree&                             m_tree;
     TriangleTreeAccessCache&                        m_triangle_tree_cache;
+    ObjectInstanceTreeAccessCache&                  m_object_instance_tree_cache;
     CurveTreeAccessCache&                           m_curve_tree_cache;
 #ifdef APPLESEED_WITH_EMBREE
     EmbreeSceneAccessCache&                         m_embree_scene_cache;
@@ -281,13 +306,13 @@ class AssemblyLeafProbeVisitor
 // Assembly tree intersectors.
 //
 
-typedef foundation::bvh::Intersector<
+typedef foundation::bvh::WideIntersector<
     AssemblyTree,
     AssemblyLeafVisitor,
     ShadingRay
 > AssemblyTreeIntersector;
 
-typedef foundation::bvh::Intersector<
+typedef foundation::bvh::WideIntersector<
     AssemblyTree,
     AssemblyLeafProbeVisitor,
     ShadingRay
@@ -302,6 +327,7 @@ inline AssemblyLeafVisitor::AssemblyLeafVisitor(
     ShadingPoint&                                   shading_point,
     const AssemblyTree&                             tree,
     TriangleTreeAccessCache&                        triangle_tree_cache,
+    ObjectInstanceTreeAccessCache&                  object_instance_tree_cache,
     CurveTreeAccessCache&                           curve_tree_cache,
 #ifdef APPLESEED_WITH_EMBREE
     EmbreeSceneAccessCache&                         embree_scene_cache,
@@ -315,6 +341,7 @@ inline AssemblyLeafVisitor::AssemblyLeafVisitor(
   : m_shading_point(shading_point)
   , m_tree(tree)
   , m_triangle_tree_cache(triangle_tree_cache)
+  , m_object_instance_tree_cache(object_instance_tree_cache)
   , m_curve_tree_cache(curve_tree_cache)
 #ifdef APPLESEED_WITH_EMBREE
   , m_embree_scene_cache(embree_scene_cache)
@@ -335,6 +362,7 @@ inline AssemblyLeafVisitor::AssemblyLeafVisitor(
 inline AssemblyLeafProbeVisitor::AssemblyLeafProbeVisitor(
     const AssemblyTree&                             tree,
     TriangleTreeAccessCache&                        triangle_tree_cache,
+    ObjectInstanceTreeAccessCache&                  object_instance_tree_cache,
     CurveTreeAccessCache&                           curve_tree_cache,
 #ifdef APPLESEED_WITH_EMBREE
     EmbreeSceneAccessCache&                         embree_scene_cache,
@@ -347,6 +375,7 @@ inline AssemblyLeafProbeVisitor::AssemblyLeafProbeVisitor(
     )
   : m_tree(tree)
   , m_triangle_tree_cache(triangle_tree_cache)
+  , m_object_instance_tree_cache(object_instance_tree_cache)
   , m_curve_tree_cache(curve_tree_cache)
 #ifdef APPLESEED_WITH_EMBREE
   , m_embree_scene_cache(embree_scene_cache)
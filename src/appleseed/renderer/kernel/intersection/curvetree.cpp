@@ -223,6 +223,12 @@ void CurveTree::build_bvh(
         reorder_curves(ordering);
         reorder_curve_keys_in_leaf_nodes();
     }
+
+    // Collapse the tree into a wide BVH.
+    bvh::Collapser<CurveTree> collapser;
+    collapser.collapse<DefaultWallclockTimer>(*this);
+    statistics.insert_time("collapse time", collapser.get_collapse_time());
+    statistics.insert("wide nodes", m_wide_nodes.size());
 }
 
 void CurveTree::reorder_curve_keys(const vector<size_t>& ordering)
@@ -65,10 +65,11 @@ namespace renderer
 //
 
 class CurveTree
-  : public foundation::bvh::Tree<
+  : public foundation::bvh::WideTree<
                foundation::AlignedVector<
                    foundation::bvh::Node<GAABB3>
-               >
+               >,
+               CurveTreeBranchingFactor
            >
 {
   public:
@@ -234,14 +235,14 @@ class CurveLeafProbeVisitor
 // Curve tree intersectors.
 //
 
-typedef foundation::bvh::Intersector<
+typedef foundation::bvh::WideIntersector<
     CurveTree,
     CurveLeafVisitor,
     GRay3,
     CurveTreeStackSize
 > CurveTreeIntersector;
 
-typedef foundation::bvh::Intersector<
+typedef foundation::bvh::WideIntersector<
     CurveTree,
     CurveLeafProbeVisitor,
     GRay3,
@@ -56,6 +56,14 @@ const double AssemblyTreeInteriorNodeTraversalCost = 1.0;
 // Relative cost of intersecting an assembly.
 const double AssemblyTreeTriangleIntersectionCost = 10.0;
 
+// Branching factor of the wide BVH traversed by the assembly tree intersectors (4 or 8).
+const size_t AssemblyTreeBranchingFactor = 4;
+
+// When assembly instances move but the set of assembly instances is unchanged, the assembly
+// tree is refitted instead of being rebuilt, unless its SAH cost grows beyond this factor of
+// the SAH cost of the tree when it was last built.
+const double AssemblyTreeMaxRefitCostRatio = 1.5;
+
 
 //
 // Triangle tree settings.
@@ -80,6 +88,14 @@ const GScalar TriangleTreeDefaultTriangleIntersectionCost(1.0);
 // Number of bins used during SBVH construction.
 const size_t TriangleTreeDefaultBinCount = 256;
 
+// Number of subtrees built by each thread during multithreaded BVH construction.
+const size_t TriangleTreeSubtreesPerBuildThread = 4;
+
+// When the triangles of a triangle tree move but the set of triangles is unchanged, the
+// tree is refitted instead of being rebuilt, unless its SAH cost grows beyond this factor
+// of the SAH cost of the tree when it was built.
+const double TriangleTreeMaxRefitCostRatio = 1.5;
+
 // Define this symbol to enable reordering the nodes of triangle trees for better
 // locality of reference. Requires a lot of temporary memory for minimal results.
 #undef RENDERER_TRIANGLE_TREE_REORDER_NODES
@@ -94,6 +110,35 @@ const size_t TriangleTreeAccessCacheWays = 2;
 // Size of the stack (in number of nodes) used during traversal.
 const size_t TriangleTreeStackSize = 64;
 
+// Branching factor of the wide BVH traversed by the triangle tree intersectors (4 or 8).
+const size_t TriangleTreeBranchingFactor = 4;
+
+
+//
+// Object instance tree settings.
+//
+
+// By default, instances of mesh objects made of at least this many triangles share a single
+// triangle tree built in object space instead of being flattened into the triangle tree of
+// their assembly, provided that the assembly contains at least two such instances.
+const size_t ObjectInstanceTreeDefaultMinTriangleCount = 1000;
+
+// Maximum number of object instances per leaf.
+const size_t ObjectInstanceTreeMaxLeafSize = 1;
+
+// Relative cost of traversing an interior node.
+const double ObjectInstanceTreeInteriorNodeTraversalCost = 1.0;
+
+// Relative cost of intersecting an object instance.
+const double ObjectInstanceTreeObjectInstanceIntersectionCost = 10.0;
+
+// Size of the object instance tree access cache.
+const size_t ObjectInstanceTreeAccessCacheLines = 128;
+const size_t ObjectInstanceTreeAccessCacheWays = 2;
+
+// Branching factor of the wide BVH traversed by the object instance tree intersectors (4 or 8).
+const size_t ObjectInstanceTreeBranchingFactor = 4;
+
 
 //
 // Curve tree settings.
@@ -126,6 +171,9 @@ const size_t CurveTreeAccessCacheWays = 2;
 // Size of the stack (in number of nodes) used during traversal.
 const size_t CurveTreeStackSize = 64;
 
+// Branching factor of the wide BVH traversed by the curve tree intersectors (4 or 8).
+const size_t CurveTreeBranchingFactor = 4;
+
 
 //
 // Embree settings.
@@ -139,6 +187,14 @@ const size_t EmbreeSceneAccessCacheWays = 2;
 
 #endif
 
+//
+// Ray stream settings.
+//
+
+// Minimum number of rays in a stream for the rays to be reordered before being traced.
+const size_t RayStreamMinReorderSize = 8;
+
+
 //
 // Miscellaneous settings.
 //
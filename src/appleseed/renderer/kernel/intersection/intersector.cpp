@@ -38,6 +38,7 @@
 #include "renderer/modeling/scene/assemblyinstance.h"
 
 // appleseed.foundation headers.
+#include "foundation/math/rayordering.h"
 #include "foundation/platform/compiler.h"
 #include "foundation/utility/cache.h"
 #include "foundation/utility/casts.h"
@@ -66,7 +67,9 @@ Intersector::Intersector(
   , m_texture_cache(texture_cache)
   , m_report_self_intersections(report_self_intersections)
   , m_shading_ray_count(0)
+  , m_osl_ray_count(0)
   , m_probe_ray_count(0)
+  , m_ray_stream_count(0)
 {
 }
 
@@ -239,6 +242,17 @@ bool Intersector::trace(
     const ShadingRay&                   ray,
     ShadingPoint&                       shading_point,
     const ShadingPoint*                 parent_shading_point) const
+{
+    // Update ray casting statistics.
+    ++m_shading_ray_count;
+
+    return do_trace(ray, shading_point, parent_shading_point);
+}
+
+bool Intersector::do_trace(
+    const ShadingRay&                   ray,
+    ShadingPoint&                       shading_point,
+    const ShadingPoint*                 parent_shading_point) const
 {
     assert(is_normalized(ray.m_dir));
     assert(shading_point.m_scene == nullptr);
@@ -246,11 +260,9 @@ bool Intersector::trace(
     assert(parent_shading_point == nullptr || parent_shading_point != &shading_point);
     assert(parent_shading_point == nullptr || parent_shading_point->is_valid());
 
-    // Update ray casting statistics.
-    ++m_shading_ray_count;
-
     // Initialize the shading point.
     shading_point.m_texture_cache = &m_texture_cache;
+    shading_point.m_intersector = this;
     shading_point.m_scene = &m_trace_context.get_scene();
     shading_point.m_ray = ray;
 
@@ -272,6 +284,7 @@ bool Intersector::trace(
         shading_point,
         assembly_tree,
         m_triangle_tree_cache,
+        m_object_instance_tree_cache,
         m_curve_tree_cache,
 #ifdef APPLESEED_WITH_EMBREE
         m_embree_scene_cache,
@@ -302,6 +315,17 @@ bool Intersector::trace(
     return shading_point.hit_surface();
 }
 
+bool Intersector::trace_osl(
+    const ShadingRay&                   ray,
+    ShadingPoint&                       shading_point,
+    const ShadingPoint*                 parent_shading_point) const
+{
+    // Update ray casting statistics.
+    ++m_osl_ray_count;
+
+    return do_trace(ray, shading_point, parent_shading_point);
+}
+
 bool Intersector::trace_probe(
     const ShadingRay&                   ray,
     const ShadingPoint*                 parent_shading_point) const
@@ -329,6 +353,7 @@ bool Intersector::trace_probe(
     AssemblyLeafProbeVisitor visitor(
         assembly_tree,
         m_triangle_tree_cache,
+        m_object_instance_tree_cache,
         m_curve_tree_cache,
 #ifdef APPLESEED_WITH_EMBREE
         m_embree_scene_cache,
@@ -351,6 +376,70 @@ bool Intersector::trace_probe(
     return visitor.hit();
 }
 
+void Intersector::trace(
+    const ShadingRay*                   rays,
+    const size_t                        ray_count,
+    ShadingPoint*                       shading_points,
+    const ShadingPoint*                 parent_shading_point) const
+{
+    // Update ray casting statistics.
+    ++m_ray_stream_count;
+
+    // Small streams are traced as is.
+    if (ray_count < RayStreamMinReorderSize)
+    {
+        for (size_t i = 0; i < ray_count; ++i)
+            trace(rays[i], shading_points[i], parent_shading_point);
+        return;
+    }
+
+    // Reorder the rays such that consecutive rays traverse the same tree nodes.
+    m_ray_ordering.clear();
+    coherent_ray_ordering(m_ray_ordering, m_ray_ordering_keys, rays, ray_count);
+
+    for (size_t i = 0; i < ray_count; ++i)
+    {
+        const size_t ray_index = m_ray_ordering[i];
+        trace(rays[ray_index], shading_points[ray_index], parent_shading_point);
+    }
+}
+
+size_t Intersector::trace_probe(
+    const ShadingRay*                   rays,
+    const size_t                        ray_count,
+    bool*                               hits,
+    const ShadingPoint*                 parent_shading_point) const
+{
+    // Update ray casting statistics.
+    ++m_ray_stream_count;
+
+    size_t hit_count = 0;
+
+    // Small streams are traced as is.
+    if (ray_count < RayStreamMinReorderSize)
+    {
+        for (size_t i = 0; i < ray_count; ++i)
+        {
+            hits[i] = trace_probe(rays[i], parent_shading_point);
+            hit_count += hits[i] ? 1 : 0;
+        }
+        return hit_count;
+    }
+
+    // Reorder the rays such that consecutive rays traverse the same tree nodes.
+    m_ray_ordering.clear();
+    coherent_ray_ordering(m_ray_ordering, m_ray_ordering_keys, rays, ray_count);
+
+    for (size_t i = 0; i < ray_count; ++i)
+    {
+        const size_t ray_index = m_ray_ordering[i];
+        hits[ray_index] = trace_probe(rays[ray_index], parent_shading_point);
+        hit_count += hits[ray_index] ? 1 : 0;
+    }
+
+    return hit_count;
+}
+
 void Intersector::make_surface_shading_point(
     ShadingPoint&                       shading_point,
     const ShadingRay&                   shading_ray,
@@ -368,6 +457,7 @@ void Intersector::make_surface_shading_point(
 
     // Context.
     shading_point.m_texture_cache = &m_texture_cache;
+    shading_point.m_intersector = this;
     shading_point.m_scene = &m_trace_context.get_scene();
     shading_point.m_ray = shading_ray;
 
@@ -399,6 +489,7 @@ void Intersector::make_volume_shading_point(
 
     // Context.
     shading_point.m_texture_cache = &m_texture_cache;
+    shading_point.m_intersector = this;
     shading_point.m_scene = &m_trace_context.get_scene();
 
     // Primary data.
@@ -451,7 +542,7 @@ namespace
 
 StatisticsVector Intersector::get_statistics() const
 {
-    const uint64 total_ray_count = m_shading_ray_count + m_probe_ray_count;
+    const uint64 total_ray_count = m_shading_ray_count + m_osl_ray_count + m_probe_ray_count;
 
     Statistics intersection_stats;
     intersection_stats.insert("total rays", total_ray_count);
@@ -467,6 +558,13 @@ StatisticsVector Intersector::get_statistics() const
                 "probe rays",
                 m_probe_ray_count,
                 total_ray_count)));
+    intersection_stats.insert(
+        unique_ptr<RayCountStatisticsEntry>(
+            new RayCountStatisticsEntry(
+                "osl trace() rays",
+                m_osl_ray_count,
+                total_ray_count)));
+    intersection_stats.insert("ray streams", m_ray_stream_count);
 
     StatisticsVector vec;
 
@@ -486,6 +584,10 @@ StatisticsVector Intersector::get_statistics() const
         "triangle tree access cache statistics",
         make_dual_stage_cache_stats(m_triangle_tree_cache));
 
+    vec.insert(
+        "object instance tree access cache statistics",
+        make_dual_stage_cache_stats(m_object_instance_tree_cache));
+
     return vec;
 }
 
@@ -35,6 +35,7 @@
 #include "renderer/kernel/intersection/embreescene.h"
 #endif
 #include "renderer/kernel/intersection/intersectionsettings.h"
+#include "renderer/kernel/intersection/objectinstancetree.h"
 #include "renderer/kernel/intersection/triangletree.h"
 #include "renderer/kernel/shading/shadingpoint.h"
 #include "renderer/kernel/tessellation/statictessellation.h"
@@ -48,6 +49,7 @@
 
 // Standard headers.
 #include <cstddef>
+#include <vector>
 
 // Forward declarations.
 namespace foundation    { class StatisticsVector; }
@@ -98,11 +100,38 @@ class Intersector
         ShadingPoint&                       shading_point,
         const ShadingPoint*                 parent_shading_point = nullptr) const;
 
+    // Trace a world space ray through the scene on behalf of an OSL trace() call.
+    // Identical to trace() except that the ray is counted as an OSL ray, not as a shading ray.
+    bool trace_osl(
+        const ShadingRay&                   ray,
+        ShadingPoint&                       shading_point,
+        const ShadingPoint*                 parent_shading_point = nullptr) const;
+
     // Trace a world space probe ray through the scene.
     bool trace_probe(
         const ShadingRay&                   ray,
         const ShadingPoint*                 parent_shading_point = nullptr) const;
 
+    // Trace a stream of world space rays through the scene. Rays are reordered to improve
+    // the coherence of consecutive traversals; results are returned in the input order.
+    // If provided, parent_shading_point is the origin of all the rays of the stream.
+    // Rays are still traversed one at a time, so the reordering only pays off for large,
+    // incoherent streams; it costs more than it saves on small batches of rays sharing
+    // an origin, which should be traced individually.
+    void trace(
+        const ShadingRay*                   rays,
+        const size_t                        ray_count,
+        ShadingPoint*                       shading_points,
+        const ShadingPoint*                 parent_shading_point = nullptr) const;
+
+    // Trace a stream of world space probe rays through the scene. hits[i] is set to true
+    // if rays[i] hits the scene. Return the number of rays that hit the scene.
+    size_t trace_probe(
+        const ShadingRay*                   rays,
+        const size_t                        ray_count,
+        bool*                               hits,
+        const ShadingPoint*                 parent_shading_point = nullptr) const;
+
     // Manufacture a hit "by hand".
     // There is no restriction placed on the shading point passed to this method.
     // For instance it may have been previously initialized and used.
@@ -133,20 +162,33 @@ class Intersector
     TextureCache&                                   m_texture_cache;
     const bool                                      m_report_self_intersections;
 
+    // Scratch storage for ray streams.
+    mutable std::vector<size_t>                     m_ray_ordering;
+    mutable std::vector<foundation::uint64>         m_ray_ordering_keys;
+
     // Access caches.
     mutable TriangleTreeAccessCache                 m_triangle_tree_cache;
+    mutable ObjectInstanceTreeAccessCache           m_object_instance_tree_cache;
     mutable CurveTreeAccessCache                    m_curve_tree_cache;
 #ifdef APPLESEED_WITH_EMBREE
     mutable EmbreeSceneAccessCache                  m_embree_scene_cache;
 #endif
     // Intersection statistics.
     mutable foundation::uint64                      m_shading_ray_count;
+    mutable foundation::uint64                      m_osl_ray_count;
     mutable foundation::uint64                      m_probe_ray_count;
+    mutable foundation::uint64                      m_ray_stream_count;
 #ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
     mutable foundation::bvh::TraversalStatistics    m_assembly_tree_traversal_stats;
     mutable foundation::bvh::TraversalStatistics    m_triangle_tree_traversal_stats;
     mutable foundation::bvh::TraversalStatistics    m_curve_tree_traversal_stats;
 #endif
+
+    // Trace a world space ray through the scene without updating ray casting statistics.
+    bool do_trace(
+        const ShadingRay&                   ray,
+        ShadingPoint&                       shading_point,
+        const ShadingPoint*                 parent_shading_point) const;
 };
 
 }   // namespace renderer
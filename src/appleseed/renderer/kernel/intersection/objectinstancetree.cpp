@@ -0,0 +1,481 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "objectinstancetree.h"
+
+// appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+#include "renderer/kernel/shading/shadingpoint.h"
+#include "renderer/modeling/object/meshobject.h"
+#include "renderer/modeling/object/object.h"
+#include "renderer/modeling/scene/assembly.h"
+#include "renderer/modeling/scene/containers.h"
+#include "renderer/modeling/scene/objectinstance.h"
+#include "renderer/utility/bbox.h"
+#include "renderer/utility/paramarray.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/permutation.h"
+#include "foundation/math/transform.h"
+#include "foundation/platform/system.h"
+#include "foundation/platform/timers.h"
+#include "foundation/utility/alignedallocator.h"
+#include "foundation/utility/containers/dictionary.h"
+#include "foundation/utility/foreach.h"
+#include "foundation/utility/statistics.h"
+#include "foundation/utility/stopwatch.h"
+#include "foundation/utility/string.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <utility>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+//
+// collect_instanced_object_instances() function implementation.
+//
+
+namespace
+{
+    // Return a string uniquely identifying the front material mappings of an object instance.
+    string get_front_material_mappings_key(const ObjectInstance& object_instance)
+    {
+        string key;
+
+        for (const_each<StringDictionary> i = object_instance.get_front_material_mappings(); i; ++i)
+        {
+            key += i->key();
+            key += '\0';
+            key += i->value();
+            key += '\0';
+        }
+
+        return key;
+    }
+}
+
+void collect_instanced_object_instances(
+    const Assembly&                 assembly,
+    ObjectInstanceGroupVector&      groups)
+{
+    assert(groups.empty());
+
+    const ParamArray& params = assembly.get_parameters().child("acceleration_structure");
+    if (!params.get_optional<bool>("object_instancing", true))
+        return;
+
+    const size_t min_triangle_count =
+        params.get_optional<size_t>(
+            "object_instancing_min_triangles",
+            ObjectInstanceTreeDefaultMinTriangleCount);
+
+    // Group mesh object instances by object and front materials.
+    typedef pair<const Object*, string> GroupKey;
+    map<GroupKey, size_t> group_indices;
+    ObjectInstanceGroupVector candidate_groups;
+
+    const ObjectInstanceContainer& object_instances = assembly.object_instances();
+
+    for (size_t i = 0, e = object_instances.size(); i < e; ++i)
+    {
+        // Retrieve the object instance.
+        const ObjectInstance* object_instance = object_instances.get_by_index(i);
+        assert(object_instance);
+
+        // Retrieve the object.
+        const Object& object = object_instance->get_object();
+
+        // Process only mesh objects.
+        if (strcmp(object.get_model(), MeshObjectFactory().get_model()) != 0)
+            continue;
+
+        // Small objects are always flattened.
+        const MeshObject& mesh = static_cast<const MeshObject&>(object);
+        if (mesh.get_static_triangle_tess().m_primitives.size() < min_triangle_count)
+            continue;
+
+        const GroupKey key(&object, get_front_material_mappings_key(*object_instance));
+        const auto result = group_indices.insert(make_pair(key, candidate_groups.size()));
+        if (result.second)
+            candidate_groups.emplace_back();
+        candidate_groups[result.first->second].push_back(i);
+    }
+
+    // Only object instances that actually share their triangle tree are worth instancing.
+    for (each<ObjectInstanceGroupVector> i = candidate_groups; i; ++i)
+    {
+        if (i->size() > 1)
+        {
+            groups.emplace_back();
+            groups.back().swap(*i);
+        }
+    }
+}
+
+
+//
+// ObjectInstanceTree class implementation.
+//
+
+ObjectInstanceTree::Arguments::Arguments(
+    const Scene&            scene,
+    const UniqueID          object_instance_tree_uid,
+    const Assembly&         assembly,
+    const size_t            thread_count)
+  : m_scene(scene)
+  , m_object_instance_tree_uid(object_instance_tree_uid)
+  , m_assembly(assembly)
+  , m_thread_count(thread_count)
+{
+}
+
+ObjectInstanceTree::ObjectInstanceTree(const Arguments& arguments)
+  : TreeType(AlignedAllocator<void>(System::get_l1_data_cache_line_size()))
+  , m_arguments(arguments)
+{
+    // Start stopwatch.
+    Stopwatch<DefaultWallclockTimer> stopwatch;
+    stopwatch.start();
+
+    Statistics statistics;
+
+    // Collect the groups of object instances sharing a triangle tree.
+    ObjectInstanceGroupVector groups;
+    collect_instanced_object_instances(m_arguments.m_assembly, groups);
+
+    const ObjectInstanceContainer& object_instances = m_arguments.m_assembly.object_instances();
+
+    typedef vector<AABB3d> AABBVector;
+    AABBVector object_instance_bboxes;
+
+    for (const_each<ObjectInstanceGroupVector> i = groups; i; ++i)
+    {
+        const vector<size_t>& group = *i;
+        assert(!group.empty());
+
+        // Build the triangle tree of the group in object space, using the first object instance.
+        const Object& object = object_instances.get_by_index(group[0])->get_object();
+        m_triangle_trees.emplace_back(
+            new TriangleTree(
+                TriangleTree::Arguments(
+                    m_arguments.m_scene,
+                    object.get_uid(),
+                    object.compute_local_bbox(),
+                    m_arguments.m_assembly,
+                    m_arguments.m_thread_count,
+                    group[0])));
+
+        // Create one item per object instance of the group.
+        for (const_each<vector<size_t>> j = group; j; ++j)
+        {
+            const ObjectInstance* object_instance = object_instances.get_by_index(*j);
+
+            Item item;
+            item.m_object_instance_index = *j;
+            item.m_triangle_tree = m_triangle_trees.back().get();
+            m_items.push_back(item);
+
+            AABB3d object_instance_bbox(object_instance->compute_parent_bbox());
+            object_instance_bbox.robust_grow(1.0e-15);
+            object_instance_bboxes.push_back(object_instance_bbox);
+        }
+    }
+
+    RENDERER_LOG_INFO(
+        "building object instance tree #" FMT_UNIQUE_ID " (%s %s, %s %s)...",
+        m_arguments.m_object_instance_tree_uid,
+        pretty_uint(m_items.size()).c_str(),
+        plural(m_items.size(), "object instance").c_str(),
+        pretty_uint(m_triangle_trees.size()).c_str(),
+        plural(m_triangle_trees.size(), "shared triangle tree").c_str());
+
+    // Create the partitioner.
+    typedef bvh::SAHPartitioner<AABBVector> Partitioner;
+    Partitioner partitioner(
+        object_instance_bboxes,
+        ObjectInstanceTreeMaxLeafSize,
+        ObjectInstanceTreeInteriorNodeTraversalCost,
+        ObjectInstanceTreeObjectInstanceIntersectionCost);
+
+    // Build the tree.
+    typedef bvh::Builder<ObjectInstanceTree, Partitioner> Builder;
+    Builder builder;
+    builder.build<DefaultWallclockTimer>(*this, partitioner, m_items.size(), ObjectInstanceTreeMaxLeafSize);
+    statistics.insert_time("build time", builder.get_build_time());
+    statistics.merge(
+        bvh::TreeStatistics<ObjectInstanceTree>(
+            *this,
+            compute_union<AABB3d>(object_instance_bboxes.begin(), object_instance_bboxes.end())));
+
+    // Reorder the items according to the tree ordering.
+    if (!m_items.empty())
+    {
+        const vector<size_t>& ordering = partitioner.get_item_ordering();
+        assert(m_items.size() == ordering.size());
+
+        ItemVector temp_items(ordering.size());
+        small_item_reorder(
+            &m_items[0],
+            &temp_items[0],
+            &ordering[0],
+            ordering.size());
+    }
+
+    // Collapse the tree into a wide BVH.
+    bvh::Collapser<ObjectInstanceTree> collapser;
+    collapser.collapse<DefaultWallclockTimer>(*this);
+    statistics.insert_time("collapse time", collapser.get_collapse_time());
+    statistics.insert("wide nodes", m_wide_nodes.size());
+    statistics.insert_time("total build time", stopwatch.measure().get_seconds());
+
+    // Print object instance tree statistics.
+    RENDERER_LOG_DEBUG("%s",
+        StatisticsVector::make(
+            "object instance tree #" + to_string(m_arguments.m_object_instance_tree_uid) + " statistics",
+            statistics).to_string().c_str());
+}
+
+ObjectInstanceTree::~ObjectInstanceTree()
+{
+    RENDERER_LOG_INFO(
+        "deleting object instance tree #" FMT_UNIQUE_ID "...",
+        m_arguments.m_object_instance_tree_uid);
+}
+
+void ObjectInstanceTree::update_non_geometry(const bool enable_intersection_filters)
+{
+    for (each<TriangleTreeVector> i = m_triangle_trees; i; ++i)
+        (*i)->update_non_geometry(enable_intersection_filters);
+}
+
+size_t ObjectInstanceTree::get_memory_size() const
+{
+    size_t size =
+          TreeType::get_memory_size()
+        - sizeof(*static_cast<const TreeType*>(this))
+        + sizeof(*this)
+        + m_items.capacity() * sizeof(Item)
+        + m_triangle_trees.capacity() * sizeof(TriangleTreeVector::value_type);
+
+    for (const_each<TriangleTreeVector> i = m_triangle_trees; i; ++i)
+        size += (*i)->get_memory_size();
+
+    return size;
+}
+
+
+//
+// ObjectInstanceTreeFactory class implementation.
+//
+
+ObjectInstanceTreeFactory::ObjectInstanceTreeFactory(const ObjectInstanceTree::Arguments& arguments)
+  : m_arguments(arguments)
+{
+}
+
+unique_ptr<ObjectInstanceTree> ObjectInstanceTreeFactory::create()
+{
+    return unique_ptr<ObjectInstanceTree>(new ObjectInstanceTree(m_arguments));
+}
+
+
+//
+// Utility function to transform a ray to the space of an object instance.
+//
+
+namespace
+{
+    Ray3d compute_object_instance_ray(
+        const ObjectInstance&       object_instance,
+        const Ray3d&                ray)
+    {
+        // The transform being affine, distances along the ray are unchanged.
+        const Transformd& transform = object_instance.get_transform();
+        return
+            Ray3d(
+                transform.point_to_local(ray.m_org),
+                transform.vector_to_local(ray.m_dir),
+                ray.m_tmin,
+                ray.m_tmax);
+    }
+}
+
+
+//
+// ObjectInstanceLeafVisitor class implementation.
+//
+
+bool ObjectInstanceLeafVisitor::visit(
+    const ObjectInstanceTree::NodeType&     node,
+    const Ray3d&                            ray,
+    const RayInfo3d&                        ray_info,
+    double&                                 distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , bvh::TraversalStatistics&             stats
+#endif
+    )
+{
+    for (size_t i = node.get_item_index(), e = i + node.get_item_count(); i < e; ++i)
+    {
+        const ObjectInstanceTree::Item& item = m_tree.m_items[i];
+        const ObjectInstance& object_instance = *m_assembly.object_instances().get_by_index(item.m_object_instance_index);
+
+        // Skip this object instance if it isn't visible for this ray.
+        if (!(object_instance.get_vis_flags() & m_shading_point.m_ray.m_flags))
+            continue;
+
+        FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+
+        // Transform the ray to object instance space. The closest hit found so far
+        // is recorded in the shading point, whose ray is in assembly space.
+        Ray3d object_ray = compute_object_instance_ray(object_instance, ray);
+        object_ray.m_tmax = m_shading_point.m_ray.m_tmax;
+        const RayInfo3d object_ray_info(object_ray);
+
+        // Check the intersection between the ray and the triangle tree of this object instance.
+        const TriangleTree& triangle_tree = *item.m_triangle_tree;
+        TriangleTreeIntersector intersector;
+        TriangleLeafVisitor visitor(triangle_tree, m_shading_point);
+        if (triangle_tree.get_moving_triangle_count() > 0)
+        {
+            intersector.intersect_motion(
+                triangle_tree,
+                object_ray,
+                object_ray_info,
+                m_shading_point.m_ray.m_time.m_normalized,
+                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , m_triangle_tree_stats
+#endif
+                );
+        }
+        else
+        {
+            intersector.intersect_no_motion(
+                triangle_tree,
+                object_ray,
+                object_ray_info,
+                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , m_triangle_tree_stats
+#endif
+                );
+        }
+
+        visitor.read_hit_triangle_data(
+            item.m_object_instance_index,
+            object_instance.get_transform());
+    }
+
+    // Continue traversal.
+    distance = m_shading_point.m_ray.m_tmax;
+    return true;
+}
+
+
+//
+// ObjectInstanceLeafProbeVisitor class implementation.
+//
+
+bool ObjectInstanceLeafProbeVisitor::visit(
+    const ObjectInstanceTree::NodeType&     node,
+    const Ray3d&                            ray,
+    const RayInfo3d&                        ray_info,
+    double&                                 distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , bvh::TraversalStatistics&             stats
+#endif
+    )
+{
+    for (size_t i = node.get_item_index(), e = i + node.get_item_count(); i < e; ++i)
+    {
+        const ObjectInstanceTree::Item& item = m_tree.m_items[i];
+        const ObjectInstance& object_instance = *m_assembly.object_instances().get_by_index(item.m_object_instance_index);
+
+        // Skip this object instance if it isn't visible for this ray.
+        if (!(object_instance.get_vis_flags() & m_ray_flags))
+            continue;
+
+        FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+
+        // Transform the ray to object instance space.
+        const Ray3d object_ray = compute_object_instance_ray(object_instance, ray);
+        const RayInfo3d object_ray_info(object_ray);
+
+        // Check the intersection between the ray and the triangle tree of this object instance.
+        const TriangleTree& triangle_tree = *item.m_triangle_tree;
+        TriangleTreeProbeIntersector intersector;
+        TriangleLeafProbeVisitor visitor(triangle_tree, m_ray_time, m_ray_flags);
+        if (triangle_tree.get_moving_triangle_count() > 0)
+        {
+            intersector.intersect_motion(
+                triangle_tree,
+                object_ray,
+                object_ray_info,
+                m_ray_time,
+                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , m_triangle_tree_stats
+#endif
+                );
+        }
+        else
+        {
+            intersector.intersect_no_motion(
+                triangle_tree,
+                object_ray,
+                object_ray_info,
+                visitor
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , m_triangle_tree_stats
+#endif
+                );
+        }
+
+        // Terminate traversal if there was a hit.
+        if (visitor.hit())
+        {
+            m_hit = true;
+            return false;
+        }
+    }
+
+    // Continue traversal.
+    distance = ray.m_tmax;
+    return true;
+}
+
+}   // namespace renderer
@@ -0,0 +1,357 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/intersection/intersectionsettings.h"
+#include "renderer/kernel/intersection/probevisitorbase.h"
+#include "renderer/kernel/intersection/triangletree.h"
+#include "renderer/modeling/scene/visibilityflags.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/bvh.h"
+#include "foundation/math/ray.h"
+#include "foundation/utility/alignedvector.h"
+#include "foundation/utility/lazy.h"
+#include "foundation/utility/poolallocator.h"
+#include "foundation/utility/uid.h"
+
+// Standard headers.
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Forward declarations.
+namespace renderer      { class Assembly; }
+namespace renderer      { class Scene; }
+namespace renderer      { class ShadingPoint; }
+
+namespace renderer
+{
+
+//
+// Mesh object instances of an assembly are normally flattened into the triangle tree of
+// the assembly, i.e. their triangles are transformed to assembly space and stored there.
+// Object instances that share a large enough mesh object are instead grouped, and each
+// group shares a single triangle tree built in object space. An object instance tree is
+// a BVH over the instanced object instances of an assembly: rays are transformed to the
+// space of each object instance they reach, then traced against the shared triangle tree.
+//
+// Object instances of a group share the same object and the same front materials, such
+// that they can also share the intersection filters of their triangle tree.
+//
+
+// Groups of object instance indices.
+typedef std::vector<std::vector<size_t>> ObjectInstanceGroupVector;
+
+// Collect the groups of object instances of an assembly that share a triangle tree.
+// The assembly parameters "acceleration_structure.object_instancing" (boolean) and
+// "acceleration_structure.object_instancing_min_triangles" control which instances are
+// grouped rather than flattened.
+void collect_instanced_object_instances(
+    const Assembly&                             assembly,
+    ObjectInstanceGroupVector&                  groups);
+
+
+//
+// Object instance tree.
+//
+
+class ObjectInstanceTree
+  : public foundation::bvh::WideTree<
+               foundation::AlignedVector<
+                   foundation::bvh::Node<foundation::AABB3d>
+               >,
+               ObjectInstanceTreeBranchingFactor
+           >
+{
+  public:
+    // Construction arguments.
+    struct Arguments
+    {
+        const Scene&                            m_scene;
+        const foundation::UniqueID              m_object_instance_tree_uid;
+        const Assembly&                         m_assembly;
+        const size_t                            m_thread_count;     // number of threads used to build each triangle tree
+
+        // Constructor.
+        Arguments(
+            const Scene&                        scene,
+            const foundation::UniqueID          object_instance_tree_uid,
+            const Assembly&                     assembly,
+            const size_t                        thread_count = 1);
+    };
+
+    // Constructor, builds the tree and the shared triangle trees for a given assembly.
+    explicit ObjectInstanceTree(const Arguments& arguments);
+
+    // Destructor.
+    ~ObjectInstanceTree();
+
+    // Update the non-geometry aspects of the shared triangle trees.
+    void update_non_geometry(const bool enable_intersection_filters);
+
+    // Return the number of object instances in the tree.
+    size_t get_object_instance_count() const;
+
+    // Return the number of shared triangle trees.
+    size_t get_triangle_tree_count() const;
+
+    // Return the size (in bytes) of this object in memory.
+    size_t get_memory_size() const;
+
+  private:
+    friend class ObjectInstanceLeafVisitor;
+    friend class ObjectInstanceLeafProbeVisitor;
+
+    // Object instances are referred to by index, and resolved against the assembly being
+    // traversed: the tree may be shared with other assemblies that have identical geometry.
+    struct Item
+    {
+        size_t                                  m_object_instance_index;
+        const TriangleTree*                     m_triangle_tree;
+    };
+
+    typedef std::vector<Item> ItemVector;
+    typedef std::vector<std::unique_ptr<TriangleTree>> TriangleTreeVector;
+
+    const Arguments                             m_arguments;
+    ItemVector                                  m_items;
+    TriangleTreeVector                          m_triangle_trees;
+};
+
+
+//
+// Object instance tree factory.
+//
+
+class ObjectInstanceTreeFactory
+  : public foundation::ILazyFactory<ObjectInstanceTree>
+{
+  public:
+    // Constructor.
+    explicit ObjectInstanceTreeFactory(
+        const ObjectInstanceTree::Arguments& arguments);
+
+    // Create the object instance tree.
+    std::unique_ptr<ObjectInstanceTree> create() override;
+
+  private:
+    ObjectInstanceTree::Arguments m_arguments;
+};
+
+
+//
+// Some additional types.
+//
+
+// Object instance tree container and iterator types.
+typedef std::map<
+    foundation::UniqueID,
+    foundation::Lazy<ObjectInstanceTree>*
+> ObjectInstanceTreeContainer;
+typedef ObjectInstanceTreeContainer::iterator ObjectInstanceTreeIterator;
+typedef ObjectInstanceTreeContainer::const_iterator ObjectInstanceTreeConstIterator;
+
+// Object instance tree access cache type.
+typedef foundation::AccessCacheMap<
+    ObjectInstanceTreeContainer,
+    ObjectInstanceTreeAccessCacheLines,
+    ObjectInstanceTreeAccessCacheWays,
+    foundation::PoolAllocator<void, ObjectInstanceTreeAccessCacheLines * ObjectInstanceTreeAccessCacheWays>
+> ObjectInstanceTreeAccessCache;
+
+
+//
+// Object instance leaf visitor, used during tree intersection.
+//
+// The ray of the shading point is expressed in assembly space; the closest hit
+// is recorded into the shading point as if it was found in assembly space.
+// The object instances of the tree are those of the given assembly.
+//
+
+class ObjectInstanceLeafVisitor
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor.
+    ObjectInstanceLeafVisitor(
+        const ObjectInstanceTree&               tree,
+        const Assembly&                         assembly,
+        ShadingPoint&                           shading_point
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics& triangle_tree_stats
+#endif
+        );
+
+    // Visit a leaf.
+    bool visit(
+        const ObjectInstanceTree::NodeType&     node,
+        const foundation::Ray3d&                ray,
+        const foundation::RayInfo3d&            ray_info,
+        double&                                 distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics& stats
+#endif
+        );
+
+  private:
+    const ObjectInstanceTree&                   m_tree;
+    const Assembly&                             m_assembly;
+    ShadingPoint&                               m_shading_point;
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    foundation::bvh::TraversalStatistics&       m_triangle_tree_stats;
+#endif
+};
+
+
+//
+// Object instance leaf visitor for probe rays, only return boolean answers
+// (whether an intersection was found or not).
+//
+
+class ObjectInstanceLeafProbeVisitor
+  : public ProbeVisitorBase
+{
+  public:
+    // Constructor.
+    ObjectInstanceLeafProbeVisitor(
+        const ObjectInstanceTree&               tree,
+        const Assembly&                         assembly,
+        const double                            ray_time,
+        const VisibilityFlags::Type             ray_flags
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics& triangle_tree_stats
+#endif
+        );
+
+    // Visit a leaf.
+    bool visit(
+        const ObjectInstanceTree::NodeType&     node,
+        const foundation::Ray3d&                ray,
+        const foundation::RayInfo3d&            ray_info,
+        double&                                 distance
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics& stats
+#endif
+        );
+
+  private:
+    const ObjectInstanceTree&                   m_tree;
+    const Assembly&                             m_assembly;
+    const double                                m_ray_time;
+    const VisibilityFlags::Type                 m_ray_flags;
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    foundation::bvh::TraversalStatistics&       m_triangle_tree_stats;
+#endif
+};
+
+
+//
+// Object instance tree intersectors.
+//
+
+typedef foundation::bvh::WideIntersector<
+    ObjectInstanceTree,
+    ObjectInstanceLeafVisitor,
+    foundation::Ray3d
+> ObjectInstanceTreeIntersector;
+
+typedef foundation::bvh::WideIntersector<
+    ObjectInstanceTree,
+    ObjectInstanceLeafProbeVisitor,
+    foundation::Ray3d
+> ObjectInstanceTreeProbeIntersector;
+
+
+//
+// ObjectInstanceTree class implementation.
+//
+
+inline size_t ObjectInstanceTree::get_object_instance_count() const
+{
+    return m_items.size();
+}
+
+inline size_t ObjectInstanceTree::get_triangle_tree_count() const
+{
+    return m_triangle_trees.size();
+}
+
+
+//
+// ObjectInstanceLeafVisitor class implementation.
+//
+
+inline ObjectInstanceLeafVisitor::ObjectInstanceLeafVisitor(
+    const ObjectInstanceTree&                   tree,
+    const Assembly&                             assembly,
+    ShadingPoint&                               shading_point
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , foundation::bvh::TraversalStatistics&     triangle_tree_stats
+#endif
+    )
+  : m_tree(tree)
+  , m_assembly(assembly)
+  , m_shading_point(shading_point)
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+  , m_triangle_tree_stats(triangle_tree_stats)
+#endif
+{
+}
+
+
+//
+// ObjectInstanceLeafProbeVisitor class implementation.
+//
+
+inline ObjectInstanceLeafProbeVisitor::ObjectInstanceLeafProbeVisitor(
+    const ObjectInstanceTree&                   tree,
+    const Assembly&                             assembly,
+    const double                                ray_time,
+    const VisibilityFlags::Type                 ray_flags
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , foundation::bvh::TraversalStatistics&     triangle_tree_stats
+#endif
+    )
+  : m_tree(tree)
+  , m_assembly(assembly)
+  , m_ray_time(ray_time)
+  , m_ray_flags(ray_flags)
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+  , m_triangle_tree_stats(triangle_tree_stats)
+#endif
+{
+}
+
+}   // namespace renderer
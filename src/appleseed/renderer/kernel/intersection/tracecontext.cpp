@@ -86,6 +86,11 @@ void TraceContext::update()
     m_assembly_tree->update();
 }
 
+void TraceContext::set_thread_count(const size_t thread_count)
+{
+    m_assembly_tree->set_thread_count(thread_count);
+}
+
 #ifdef APPLESEED_WITH_EMBREE
 
 void TraceContext::set_use_embree(const bool value)
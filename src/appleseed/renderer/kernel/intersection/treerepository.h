@@ -61,6 +61,9 @@ class TreeRepository
     LazyTreeType* acquire(const foundation::uint64 key);
     void release(LazyTreeType* tree);
 
+    // Change the key of a tree. Return false if the tree is shared or if the new key is already in use.
+    bool rekey(LazyTreeType* tree, const foundation::uint64 key);
+
     template <typename Func>
     void for_each(Func& func);
 
@@ -135,6 +138,29 @@ void TreeRepository<TreeType>::release(LazyTreeType* tree)
     }
 }
 
+template <typename TreeType>
+bool TreeRepository<TreeType>::rekey(LazyTreeType* tree, const foundation::uint64 key)
+{
+    const typename TreeIndex::iterator i = m_index.find(tree);
+    assert(i != m_index.end());
+
+    if (i->second == key)
+        return true;
+
+    const typename TreeContainer::iterator t = m_trees.find(i->second);
+    assert(t != m_trees.end());
+
+    if (t->second.m_ref > 1 || m_trees.find(key) != m_trees.end())
+        return false;
+
+    const TreeInfo info = t->second;
+    m_trees.erase(t);
+    m_trees.insert(std::make_pair(key, info));
+    i->second = key;
+
+    return true;
+}
+
 template <typename TreeType>
 template <typename Func>
 void TreeRepository<TreeType>::for_each(Func& func)
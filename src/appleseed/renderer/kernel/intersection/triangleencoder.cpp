@@ -38,6 +38,9 @@
 #include "foundation/platform/types.h"
 #include "foundation/utility/memory.h"
 
+// Standard headers.
+#include <cassert>
+
 using namespace foundation;
 using namespace std;
 
@@ -101,4 +104,56 @@ void TriangleEncoder::encode(
     }
 }
 
+size_t TriangleEncoder::compute_compact_size(
+    const vector<TriangleVertexInfo>&   triangle_vertex_infos,
+    const vector<size_t>&               triangle_indices,
+    const size_t                        item_begin,
+    const size_t                        item_count)
+{
+    size_t size = 0;
+
+    for (size_t i = 0; i < item_count; ++i)
+    {
+        const size_t triangle_index = triangle_indices[item_begin + i];
+        const TriangleVertexInfo& vertex_info = triangle_vertex_infos[triangle_index];
+
+        size += sizeof(uint16);         // visibility flags
+        size += sizeof(uint16);         // motion segment count
+
+        if (vertex_info.m_motion_segment_count == 0)
+            size += 3 * sizeof(uint32);
+        else size += sizeof(uint32);
+    }
+
+    return size;
+}
+
+void TriangleEncoder::encode_compact(
+    const vector<TriangleVertexInfo>&   triangle_vertex_infos,
+    const vector<uint32>&               vertex_pool_indices,
+    const vector<size_t>&               triangle_indices,
+    const size_t                        item_begin,
+    const size_t                        item_count,
+    MemoryWriter&                       writer)
+{
+    for (size_t i = 0; i < item_count; ++i)
+    {
+        const size_t triangle_index = triangle_indices[item_begin + i];
+        const TriangleVertexInfo& vertex_info = triangle_vertex_infos[triangle_index];
+
+        // All visibility flags fit in the lower 16 bits.
+        assert(vertex_info.m_motion_segment_count <= 0xFFFFu);
+        writer.write(static_cast<uint16>(vertex_info.m_vis_flags));
+        writer.write(static_cast<uint16>(vertex_info.m_motion_segment_count));
+
+        if (vertex_info.m_motion_segment_count == 0)
+        {
+            writer.write(vertex_pool_indices[vertex_info.m_vertex_index + 0]);
+            writer.write(vertex_pool_indices[vertex_info.m_vertex_index + 1]);
+            writer.write(vertex_pool_indices[vertex_info.m_vertex_index + 2]);
+        }
+        else writer.write(vertex_pool_indices[vertex_info.m_vertex_index]);
+    }
+}
+
 }   // namespace renderer
@@ -32,6 +32,9 @@
 // appleseed.renderer headers.
 #include "renderer/global/globaltypes.h"
 
+// appleseed.foundation headers.
+#include "foundation/platform/types.h"
+
 // Standard headers.
 #include <cstddef>
 #include <vector>
@@ -59,6 +62,25 @@ class TriangleEncoder
         const size_t                            item_begin,
         const size_t                            item_count,
         foundation::MemoryWriter&               writer);
+
+    // Compact encoding: visibility flags and motion segment count are stored as 16-bit
+    // integers, and vertices are referenced by their index in a shared vertex pool.
+    // Static triangles store the pool indices of their three vertices; moving triangles
+    // store the pool index of their first vertex, motion steps being contiguous in the pool.
+
+    static size_t compute_compact_size(
+        const std::vector<TriangleVertexInfo>&  triangle_vertex_infos,
+        const std::vector<size_t>&              triangle_indices,
+        const size_t                            item_begin,
+        const size_t                            item_count);
+
+    static void encode_compact(
+        const std::vector<TriangleVertexInfo>&  triangle_vertex_infos,
+        const std::vector<foundation::uint32>&  vertex_pool_indices,
+        const std::vector<size_t>&              triangle_indices,
+        const size_t                            item_begin,
+        const size_t                            item_count,
+        foundation::MemoryWriter&               writer);
 };
 
 }   // namespace renderer
@@ -30,9 +30,12 @@
 #pragma once
 
 // appleseed.foundation headers.
+#include "foundation/math/scalar.h"
 #include "foundation/platform/types.h"
 
 // Standard headers.
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
 
 namespace renderer
@@ -68,6 +71,39 @@ class TriangleKey
 };
 
 
+//
+// The TriangleKeyPacker class packs triangle keys into 64-bit integers,
+// using only as many bits for each field as required by a given set of keys.
+//
+
+class TriangleKeyPacker
+{
+  public:
+    // Constructor, prepares for keys whose fields are all zero.
+    TriangleKeyPacker();
+
+    // Extend the packing layout to accommodate a given key.
+    void insert(const TriangleKey& key);
+
+    // Return true if keys fit in 64 bits with the current layout.
+    bool fits() const;
+
+    // Pack a key. The key must have been inserted beforehand.
+    foundation::uint64 pack(const TriangleKey& key) const;
+
+    // Unpack a key.
+    TriangleKey unpack(const foundation::uint64 packed_key) const;
+
+  private:
+    size_t  m_object_instance_index_bits;
+    size_t  m_triangle_index_bits;
+    size_t  m_triangle_pa_bits;
+
+    static size_t bit_count(const size_t x);
+    static foundation::uint64 bit_mask(const size_t bits);
+};
+
+
 //
 // TriangleKey class implementation.
 //
@@ -101,4 +137,71 @@ inline size_t TriangleKey::get_triangle_pa() const
     return static_cast<size_t>(m_triangle_pa);
 }
 
+
+
+//
+// TriangleKeyPacker class implementation.
+//
+
+inline TriangleKeyPacker::TriangleKeyPacker()
+  : m_object_instance_index_bits(0)
+  , m_triangle_index_bits(0)
+  , m_triangle_pa_bits(0)
+{
+}
+
+inline void TriangleKeyPacker::insert(const TriangleKey& key)
+{
+    m_object_instance_index_bits =
+        std::max(m_object_instance_index_bits, bit_count(key.get_object_instance_index()));
+    m_triangle_index_bits =
+        std::max(m_triangle_index_bits, bit_count(key.get_triangle_index()));
+    m_triangle_pa_bits =
+        std::max(m_triangle_pa_bits, bit_count(key.get_triangle_pa()));
+}
+
+inline bool TriangleKeyPacker::fits() const
+{
+    return m_object_instance_index_bits + m_triangle_index_bits + m_triangle_pa_bits <= 64;
+}
+
+inline foundation::uint64 TriangleKeyPacker::pack(const TriangleKey& key) const
+{
+    assert(fits());
+    assert(bit_count(key.get_object_instance_index()) <= m_object_instance_index_bits);
+    assert(bit_count(key.get_triangle_index()) <= m_triangle_index_bits);
+    assert(bit_count(key.get_triangle_pa()) <= m_triangle_pa_bits);
+
+    // Individual fields are at most 32 bits wide, shifts never overflow.
+    foundation::uint64 packed_key = key.get_object_instance_index();
+    packed_key = (packed_key << m_triangle_index_bits) | key.get_triangle_index();
+    packed_key = (packed_key << m_triangle_pa_bits) | key.get_triangle_pa();
+
+    return packed_key;
+}
+
+inline TriangleKey TriangleKeyPacker::unpack(foundation::uint64 packed_key) const
+{
+    const size_t triangle_pa = static_cast<size_t>(packed_key & bit_mask(m_triangle_pa_bits));
+    packed_key >>= m_triangle_pa_bits;
+
+    const size_t triangle_index = static_cast<size_t>(packed_key & bit_mask(m_triangle_index_bits));
+    packed_key >>= m_triangle_index_bits;
+
+    const size_t object_instance_index = static_cast<size_t>(packed_key);
+
+    return TriangleKey(object_instance_index, triangle_index, triangle_pa);
+}
+
+inline size_t TriangleKeyPacker::bit_count(const size_t x)
+{
+    return x == 0 ? 0 : static_cast<size_t>(foundation::log2_int(static_cast<foundation::uint64>(x))) + 1;
+}
+
+inline foundation::uint64 TriangleKeyPacker::bit_mask(const size_t bits)
+{
+    assert(bits < 64);
+    return (foundation::uint64(1) << bits) - 1;
+}
+
 }   // namespace renderer
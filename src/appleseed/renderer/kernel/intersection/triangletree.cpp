@@ -33,6 +33,7 @@
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
 #include "renderer/kernel/intersection/intersectionfilter.h"
+#include "renderer/kernel/intersection/objectinstancetree.h"
 #include "renderer/kernel/intersection/triangleencoder.h"
 #include "renderer/kernel/intersection/triangleitemhandler.h"
 #include "renderer/kernel/intersection/trianglevertexinfo.h"
@@ -65,6 +66,7 @@
 #include "foundation/utility/alignedallocator.h"
 #include "foundation/utility/api/apistring.h"
 #include "foundation/utility/foreach.h"
+#include "foundation/utility/job.h"
 #include "foundation/utility/makevector.h"
 #include "foundation/utility/memory.h"
 #include "foundation/utility/statistics.h"
@@ -105,7 +107,8 @@ namespace
     template <typename AABBType>
     void collect_static_triangles(
         const GAABB3&                   tree_bbox,
-        const ObjectInstance&           object_instance,
+        const Transformd&               transform,
+        const uint32                    vis_flags,
         const size_t                    object_instance_index,
         const StaticTriangleTess&       tess,
         const bool                      save_memory,
@@ -115,7 +118,6 @@ namespace
         vector<AABBType>*               triangle_bboxes,
         size_t&                         triangle_vertex_count)
     {
-        const Transformd& transform = object_instance.get_transform();
         const size_t triangle_count = tess.m_primitives.size();
 
         if (save_memory)
@@ -178,7 +180,7 @@ namespace
                     TriangleVertexInfo(
                         triangle_vertex_count,
                         0,
-                        object_instance.get_vis_flags()));
+                        vis_flags));
             }
 
             // Store the triangle vertices.
@@ -199,7 +201,8 @@ namespace
     template <typename AABBType>
     void collect_moving_triangles(
         const GAABB3&                   tree_bbox,
-        const ObjectInstance&           object_instance,
+        const Transformd&               transform,
+        const uint32                    vis_flags,
         const size_t                    object_instance_index,
         const StaticTriangleTess&       tess,
         const double                    time,
@@ -210,7 +213,6 @@ namespace
         vector<AABBType>*               triangle_bboxes,
         size_t&                         triangle_vertex_count)
     {
-        const Transformd& transform = object_instance.get_transform();
         const size_t motion_segment_count = tess.get_motion_segment_count();
         const size_t triangle_count = tess.m_primitives.size();
 
@@ -290,7 +292,7 @@ namespace
                     TriangleVertexInfo(
                         triangle_vertex_count,
                         motion_segment_count,
-                        object_instance.get_vis_flags()));
+                        vis_flags));
             }
 
             // Store the triangle vertices.
@@ -314,9 +316,47 @@ namespace
         }
     }
 
+    // Collect the indices of the mesh object instances stored in a triangle tree.
+    void collect_stored_object_instances(
+        const TriangleTree::Arguments&  arguments,
+        vector<size_t>&                 object_instance_indices)
+    {
+        const ObjectInstanceContainer& object_instances = arguments.m_assembly.object_instances();
+
+        // Object instances shared with other object instances are stored in their own tree.
+        vector<bool> instanced(object_instances.size(), false);
+        const bool object_space = arguments.m_object_instance_index != ~size_t(0);
+        if (!object_space)
+        {
+            ObjectInstanceGroupVector groups;
+            collect_instanced_object_instances(arguments.m_assembly, groups);
+
+            for (const_each<ObjectInstanceGroupVector> i = groups; i; ++i)
+            {
+                for (const_each<vector<size_t>> j = *i; j; ++j)
+                    instanced[*j] = true;
+            }
+        }
+
+        for (size_t i = 0, e = object_instances.size(); i < e; ++i)
+        {
+            // Retrieve the object instance.
+            const ObjectInstance* object_instance = object_instances.get_by_index(i);
+            assert(object_instance);
+
+            // Process only mesh objects.
+            if (strcmp(object_instance->get_object().get_model(), MeshObjectFactory().get_model()) != 0)
+                continue;
+
+            if (object_space ? i == arguments.m_object_instance_index : !instanced[i])
+                object_instance_indices.push_back(i);
+        }
+    }
+
     template <typename AABBType>
     void collect_triangles(
         const TriangleTree::Arguments&  arguments,
+        const vector<size_t>&           object_instance_indices,
         const double                    time,
         const bool                      save_memory,
         vector<TriangleKey>*            triangle_keys,
@@ -329,23 +369,25 @@ namespace
         assert_empty(triangle_vertices);
         assert_empty(triangle_bboxes);
 
+        // A tree storing a single object instance in object space is shared by all instances of
+        // the object: the visibility of each instance is checked when traversing its own tree.
+        const bool object_space = arguments.m_object_instance_index != ~size_t(0);
+
         size_t triangle_vertex_count = 0;
 
-        for (size_t i = 0, e = arguments.m_assembly.object_instances().size(); i < e; ++i)
+        for (const_each<vector<size_t>> i = object_instance_indices; i; ++i)
         {
             // Retrieve the object instance and its transformation.
             const ObjectInstance* object_instance =
-                arguments.m_assembly.object_instances().get_by_index(i);
+                arguments.m_assembly.object_instances().get_by_index(*i);
             assert(object_instance);
+            const Transformd& transform =
+                object_space ? Transformd::identity() : object_instance->get_transform();
+            const uint32 vis_flags =
+                object_space ? VisibilityFlags::AllRays : object_instance->get_vis_flags();
 
             // Retrieve the object.
-            Object& object = object_instance->get_object();
-
-            // Process only mesh objects.
-            if (strcmp(object.get_model(), MeshObjectFactory().get_model()) != 0)
-                continue;
-
-            const MeshObject& mesh = static_cast<const MeshObject&>(object);
+            const MeshObject& mesh = static_cast<const MeshObject&>(object_instance->get_object());
             const StaticTriangleTess& tess = mesh.get_static_triangle_tess();
 
             // Collect the triangles from this tessellation.
@@ -353,8 +395,9 @@ namespace
             {
                 collect_moving_triangles(
                     arguments.m_bbox,
-                    *object_instance,
-                    i,
+                    transform,
+                    vis_flags,
+                    *i,
                     tess,
                     time,
                     save_memory,
@@ -368,8 +411,9 @@ namespace
             {
                 collect_static_triangles(
                     arguments.m_bbox,
-                    *object_instance,
-                    i,
+                    transform,
+                    vis_flags,
+                    *i,
                     tess,
                     save_memory,
                     triangle_keys,
@@ -386,17 +430,23 @@ TriangleTree::Arguments::Arguments(
     const Scene&            scene,
     const UniqueID          triangle_tree_uid,
     const GAABB3&           bbox,
-    const Assembly&         assembly)
+    const Assembly&         assembly,
+    const size_t            thread_count,
+    const size_t            object_instance_index)
   : m_scene(scene)
   , m_triangle_tree_uid(triangle_tree_uid)
   , m_bbox(bbox)
   , m_assembly(assembly)
+  , m_thread_count(thread_count)
+  , m_object_instance_index(object_instance_index)
 {
 }
 
 TriangleTree::TriangleTree(const Arguments& arguments)
   : TreeType(AlignedAllocator<void>(System::get_l1_data_cache_line_size()))
   , m_arguments(arguments)
+  , m_refittable(false)
+  , m_built_sah_cost(0.0)
 {
     // Retrieve construction parameters.
     const MessageContext message_context(
@@ -405,6 +455,11 @@ TriangleTree::TriangleTree(const Arguments& arguments)
     const string algorithm = params.get_optional<string>("algorithm", "bvh", make_vector("bvh", "sbvh"), message_context);
     const double time = params.get_optional<double>("time", 0.5);
     const bool save_memory = params.get_optional<bool>("save_temporary_memory", false);
+    const string leaf_format = params.get_optional<string>("leaf_format", "full", make_vector("full", "compact"), message_context);
+    m_compact_leaves = leaf_format == "compact";
+
+    // Collect the object instances stored in this tree.
+    collect_stored_object_instances(m_arguments, m_object_instance_indices);
 
     // Start stopwatch.
     Stopwatch<DefaultWallclockTimer> stopwatch;
@@ -425,6 +480,16 @@ TriangleTree::TriangleTree(const Arguments& arguments)
     assert(m_nodes.size() == m_nodes.capacity());
 #endif
 
+    // Collapse the tree into a wide BVH. Trees with moving triangles are always
+    // traversed with the binary intersector and are left as is.
+    if (m_moving_triangle_count == 0)
+    {
+        bvh::Collapser<TriangleTree> collapser;
+        collapser.collapse<DefaultWallclockTimer>(*this);
+        statistics.insert_time("collapse time", collapser.get_collapse_time());
+        statistics.insert("wide nodes", m_wide_nodes.size());
+    }
+
     // Print triangle tree statistics.
     RENDERER_LOG_DEBUG("%s",
         StatisticsVector::make(
@@ -456,7 +521,9 @@ size_t TriangleTree::get_memory_size() const
         - sizeof(*static_cast<const TreeType*>(this))
         + sizeof(*this)
         + m_triangle_keys.capacity() * sizeof(TriangleKey)
-        + m_leaf_data.capacity() * sizeof(uint8);
+        + m_packed_triangle_keys.capacity() * sizeof(uint64)
+        + m_leaf_data.capacity() * sizeof(uint8)
+        + m_vertex_pool.capacity() * sizeof(GVector3);
 }
 
 namespace
@@ -492,6 +559,38 @@ namespace
 
         return count;
     }
+
+    // Present the bounding boxes of a set of triangles in the order given by a tree.
+    struct OrderedTriangleBBoxes
+    {
+        const vector<GAABB3>&   m_triangle_bboxes;
+        const vector<size_t>&   m_triangle_indices;
+
+        OrderedTriangleBBoxes(
+            const vector<GAABB3>&   triangle_bboxes,
+            const vector<size_t>&   triangle_indices)
+          : m_triangle_bboxes(triangle_bboxes)
+          , m_triangle_indices(triangle_indices)
+        {
+        }
+
+        const GAABB3& operator[](const size_t i) const
+        {
+            return m_triangle_bboxes[m_triangle_indices[i]];
+        }
+    };
+
+    // Order triangle keys by object instance index, then by triangle index.
+    struct TriangleKeyLess
+    {
+        bool operator()(const TriangleKey& lhs, const TriangleKey& rhs) const
+        {
+            return
+                lhs.get_object_instance_index() < rhs.get_object_instance_index() ? true :
+                rhs.get_object_instance_index() < lhs.get_object_instance_index() ? false :
+                lhs.get_triangle_index() < rhs.get_triangle_index();
+        }
+    };
 }
 
 void TriangleTree::build_bvh(
@@ -513,6 +612,7 @@ void TriangleTree::build_bvh(
     vector<GAABB3> triangle_bboxes;
     collect_triangles(
         m_arguments,
+        m_object_instance_indices,
         time,
         save_memory,
         &triangle_keys,
@@ -548,16 +648,53 @@ void TriangleTree::build_bvh(
         triangle_intersection_cost);
 
     // Build the tree.
-    typedef bvh::Builder<TriangleTree, Partitioner> Builder;
-    Builder builder;
-    builder.build<DefaultWallclockTimer>(
-        *this,
-        partitioner,
-        triangle_keys.size(),
-        max_leaf_size);
+    double build_time;
+    if (m_arguments.m_thread_count > 1)
+    {
+        JobQueue job_queue;
+        JobManager job_manager(global_logger(), job_queue, m_arguments.m_thread_count);
+        job_manager.start();
+
+        typedef bvh::ParallelBuilder<TriangleTree, Partitioner> Builder;
+        Builder builder;
+        builder.build<DefaultWallclockTimer>(
+            *this,
+            partitioner,
+            triangle_keys.size(),
+            max_leaf_size,
+            job_queue,
+            TriangleTreeSubtreesPerBuildThread * m_arguments.m_thread_count);
+        build_time = builder.get_build_time();
+    }
+    else
+    {
+        typedef bvh::Builder<TriangleTree, Partitioner> Builder;
+        Builder builder;
+        builder.build<DefaultWallclockTimer>(
+            *this,
+            partitioner,
+            triangle_keys.size(),
+            max_leaf_size);
+        build_time = builder.get_build_time();
+    }
     statistics.merge(
         bvh::TreeStatistics<TriangleTree>(*this, AABB3d(m_arguments.m_bbox)));
 
+    // Compute the SAH cost of the tree, the reference for future refits.
+    // Trees with moving triangles are always rebuilt.
+    if (m_moving_triangle_count == 0)
+    {
+        bvh::Refitter<TriangleTree> refitter;
+        m_built_sah_cost =
+            refitter.refit<DefaultWallclockTimer>(
+                *this,
+                OrderedTriangleBBoxes(triangle_bboxes, partitioner.get_item_ordering()),
+                interior_node_traversal_cost,
+                triangle_intersection_cost);
+        m_refittable = true;
+        statistics.insert("sah cost", m_built_sah_cost);
+    }
+
     stopwatch.start();
 
     // Bounding boxes are no longer needed.
@@ -567,6 +704,7 @@ void TriangleTree::build_bvh(
     vector<GVector3> triangle_vertices;
     collect_triangles<GAABB3>(
         m_arguments,
+        m_object_instance_indices,
         time,
         save_memory,
         nullptr,
@@ -592,7 +730,7 @@ void TriangleTree::build_bvh(
     const double store_time = stopwatch.measure().get_seconds();
 
     statistics.insert_time("collection time", collection_time);
-    statistics.insert_time("partition time", builder.get_build_time());
+    statistics.insert_time("partition time", build_time);
     statistics.insert_time("store time", store_time);
 }
 
@@ -616,6 +754,7 @@ void TriangleTree::build_sbvh(
     stopwatch.start();
     collect_triangles(
         m_arguments,
+        m_object_instance_indices,
         time,
         save_memory,
         &triangle_keys,
@@ -707,6 +846,128 @@ void TriangleTree::build_sbvh(
     statistics.insert_time("store time", store_time);
 }
 
+bool TriangleTree::refit(const GAABB3& bbox)
+{
+    // Trees with moving triangles or built with spatial splits are always rebuilt.
+    if (!m_refittable)
+        return false;
+
+    // The tree can only be refitted if the set of object instances is unchanged.
+    vector<size_t> object_instance_indices;
+    collect_stored_object_instances(m_arguments, object_instance_indices);
+    if (object_instance_indices != m_object_instance_indices)
+        return false;
+
+    // Retrieve refitting parameters.
+    const ParamArray& params = m_arguments.m_assembly.get_parameters().child("acceleration_structure");
+    const double time = params.get_optional<double>("time", 0.5);
+    const GScalar interior_node_traversal_cost = params.get_optional<GScalar>("interior_node_traversal_cost", TriangleTreeDefaultInteriorNodeTraversalCost);
+    const GScalar triangle_intersection_cost = params.get_optional<GScalar>("triangle_intersection_cost", TriangleTreeDefaultTriangleIntersectionCost);
+
+    Stopwatch<DefaultWallclockTimer> stopwatch;
+    stopwatch.start();
+
+    // Collect the triangles in their current state.
+    const Arguments arguments(
+        m_arguments.m_scene,
+        m_arguments.m_triangle_tree_uid,
+        bbox,
+        m_arguments.m_assembly,
+        m_arguments.m_thread_count,
+        m_arguments.m_object_instance_index);
+    vector<TriangleKey> triangle_keys;
+    vector<TriangleVertexInfo> triangle_vertex_infos;
+    vector<GVector3> triangle_vertices;
+    vector<GAABB3> triangle_bboxes;
+    collect_triangles(
+        arguments,
+        m_object_instance_indices,
+        time,
+        false,
+        &triangle_keys,
+        &triangle_vertex_infos,
+        &triangle_vertices,
+        &triangle_bboxes);
+
+    // The number of triangles must be unchanged, and none of them may have started moving.
+    const size_t triangle_count = m_static_triangle_count;
+    if (triangle_keys.size() != triangle_count ||
+        count_static_triangles(triangle_vertex_infos) != triangle_count)
+        return false;
+
+    // Find the triangles referenced by the leaves among the collected ones. Triangles are
+    // collected in key order, and since the tree references as many distinct triangles as
+    // were collected, finding all of them proves that the set of triangles is unchanged.
+    vector<size_t> triangle_indices(triangle_count);
+    for (size_t i = 0; i < triangle_count; ++i)
+    {
+        const TriangleKey key = get_triangle_key(i);
+        const vector<TriangleKey>::const_iterator it =
+            lower_bound(triangle_keys.begin(), triangle_keys.end(), key, TriangleKeyLess());
+        if (it == triangle_keys.end() || TriangleKeyLess()(key, *it))
+            return false;
+        triangle_indices[i] = it - triangle_keys.begin();
+    }
+
+    RENDERER_LOG_INFO(
+        "refitting triangle tree #" FMT_UNIQUE_ID " (%s %s)...",
+        m_arguments.m_triangle_tree_uid,
+        pretty_uint(triangle_count).c_str(),
+        plural(triangle_count, "triangle").c_str());
+
+    Statistics statistics;
+
+    // Refit the tree.
+    bvh::Refitter<TriangleTree> refitter;
+    const double sah_cost =
+        refitter.refit<DefaultWallclockTimer>(
+            *this,
+            OrderedTriangleBBoxes(triangle_bboxes, triangle_indices),
+            interior_node_traversal_cost,
+            triangle_intersection_cost);
+
+    // Rebuild the tree if its quality degraded too much.
+    if (sah_cost > m_built_sah_cost * TriangleTreeMaxRefitCostRatio)
+    {
+        RENDERER_LOG_DEBUG(
+            "triangle tree #" FMT_UNIQUE_ID " sah cost went from %f to %f, rebuilding tree...",
+            m_arguments.m_triangle_tree_uid,
+            m_built_sah_cost,
+            sah_cost);
+        return false;
+    }
+
+    statistics.insert_time("refit time", refitter.get_refit_time());
+    statistics.insert("sah cost", sah_cost);
+
+    // Store the triangles again, in the same leaves.
+    m_triangle_keys.clear();
+    m_packed_triangle_keys.clear();
+    m_leaf_data.clear();
+    m_vertex_pool.clear();
+    m_triangle_key_packer = TriangleKeyPacker();
+    store_triangles(
+        triangle_indices,
+        triangle_vertex_infos,
+        triangle_vertices,
+        triangle_keys,
+        statistics);
+
+    // Collapse the refitted tree into a wide BVH again.
+    bvh::Collapser<TriangleTree> collapser;
+    collapser.collapse<DefaultWallclockTimer>(*this);
+    statistics.insert_time("collapse time", collapser.get_collapse_time());
+    statistics.insert_time("total refit time", stopwatch.measure().get_seconds());
+
+    // Print triangle tree statistics.
+    RENDERER_LOG_DEBUG("%s",
+        StatisticsVector::make(
+            "triangle tree #" + to_string(m_arguments.m_triangle_tree_uid) + " statistics",
+            statistics).to_string().c_str());
+
+    return true;
+}
+
 namespace
 {
 #ifdef APPLESEED_USE_SSE
@@ -875,6 +1136,85 @@ vector<GAABB3> TriangleTree::compute_motion_bboxes(
     }
 }
 
+namespace
+{
+    // Order vertices lexicographically, given their index in a vertex array.
+    struct VertexIndexLess
+    {
+        const vector<GVector3>& m_vertices;
+
+        explicit VertexIndexLess(const vector<GVector3>& vertices)
+          : m_vertices(vertices)
+        {
+        }
+
+        bool operator()(const size_t lhs, const size_t rhs) const
+        {
+            const GVector3& a = m_vertices[lhs];
+            const GVector3& b = m_vertices[rhs];
+            return
+                a[0] < b[0] ? true : b[0] < a[0] ? false :
+                a[1] < b[1] ? true : b[1] < a[1] ? false :
+                a[2] < b[2];
+        }
+    };
+
+    // Build a pool of vertices for compact leaves. Vertices shared by several static
+    // triangles are stored once; the motion steps of moving triangles are stored
+    // contiguously. For each vertex of the input array, vertex_pool_indices receives
+    // the index of the corresponding vertex in the pool.
+    void build_vertex_pool(
+        const vector<TriangleVertexInfo>&   triangle_vertex_infos,
+        const vector<GVector3>&             triangle_vertices,
+        vector<GVector3>&                   vertex_pool,
+        vector<uint32>&                     vertex_pool_indices)
+    {
+        vertex_pool.clear();
+        vertex_pool_indices.resize(triangle_vertices.size());
+
+        // Sort the vertices of static triangles to find duplicates.
+        vector<size_t> static_vertices;
+        for (const_each<vector<TriangleVertexInfo>> i = triangle_vertex_infos; i; ++i)
+        {
+            if (i->m_motion_segment_count == 0)
+            {
+                static_vertices.push_back(i->m_vertex_index + 0);
+                static_vertices.push_back(i->m_vertex_index + 1);
+                static_vertices.push_back(i->m_vertex_index + 2);
+            }
+        }
+
+        sort(static_vertices.begin(), static_vertices.end(), VertexIndexLess(triangle_vertices));
+
+        for (size_t i = 0, e = static_vertices.size(); i < e; ++i)
+        {
+            const GVector3& vertex = triangle_vertices[static_vertices[i]];
+
+            if (vertex_pool.empty() || vertex != vertex_pool.back())
+                vertex_pool.push_back(vertex);
+
+            vertex_pool_indices[static_vertices[i]] = static_cast<uint32>(vertex_pool.size() - 1);
+        }
+
+        // Append the vertices of moving triangles.
+        for (const_each<vector<TriangleVertexInfo>> i = triangle_vertex_infos; i; ++i)
+        {
+            if (i->m_motion_segment_count > 0)
+            {
+                const size_t vertex_count = (i->m_motion_segment_count + 1) * 3;
+
+                for (size_t j = 0; j < vertex_count; ++j)
+                {
+                    vertex_pool_indices[i->m_vertex_index + j] = static_cast<uint32>(vertex_pool.size());
+                    vertex_pool.push_back(triangle_vertices[i->m_vertex_index + j]);
+                }
+            }
+        }
+
+        assert(vertex_pool.size() <= ~uint32(0));
+    }
+}
+
 void TriangleTree::store_triangles(
     const vector<size_t>&               triangle_indices,
     const vector<TriangleVertexInfo>&   triangle_vertex_infos,
@@ -884,6 +1224,18 @@ void TriangleTree::store_triangles(
 {
     const size_t node_count = m_nodes.size();
 
+    // Build the vertex pool referenced by compact leaves.
+
+    vector<uint32> vertex_pool_indices;
+    if (m_compact_leaves)
+    {
+        build_vertex_pool(
+            triangle_vertex_infos,
+            triangle_vertices,
+            m_vertex_pool,
+            vertex_pool_indices);
+    }
+
     // Gather statistics.
 
     size_t leaf_count = 0;
@@ -902,13 +1254,19 @@ void TriangleTree::store_triangles(
             const size_t item_count = node.get_item_count();
 
             const size_t leaf_size =
-                TriangleEncoder::compute_size(
-                    triangle_vertex_infos,
-                    triangle_indices,
-                    item_begin,
-                    item_count);
+                m_compact_leaves
+                    ? TriangleEncoder::compute_compact_size(
+                          triangle_vertex_infos,
+                          triangle_indices,
+                          item_begin,
+                          item_count)
+                    : TriangleEncoder::compute_size(
+                          triangle_vertex_infos,
+                          triangle_indices,
+                          item_begin,
+                          item_count);
 
-            if (leaf_size < NodeType::MaxUserDataSize)
+            if (leaf_size <= NodeType::MaxUserDataSize - sizeof(uint32))
                 ++fat_leaf_count;
             else leaf_data_size += leaf_size;
         }
@@ -939,42 +1297,84 @@ void TriangleTree::store_triangles(
             }
 
             const size_t leaf_size =
-                TriangleEncoder::compute_size(
-                    triangle_vertex_infos,
-                    triangle_indices,
-                    item_begin,
-                    item_count);
+                m_compact_leaves
+                    ? TriangleEncoder::compute_compact_size(
+                          triangle_vertex_infos,
+                          triangle_indices,
+                          item_begin,
+                          item_count)
+                    : TriangleEncoder::compute_size(
+                          triangle_vertex_infos,
+                          triangle_indices,
+                          item_begin,
+                          item_count);
 
             MemoryWriter user_data_writer(&node.get_user_data<uint8>());
 
+            MemoryWriter* writer;
             if (leaf_size <= NodeType::MaxUserDataSize - sizeof(uint32))
             {
                 user_data_writer.write<uint32>(~uint32(0));
+                writer = &user_data_writer;
+            }
+            else
+            {
+                user_data_writer.write(static_cast<uint32>(leaf_data_writer.offset()));
+                writer = &leaf_data_writer;
+            }
 
-                TriangleEncoder::encode(
+            if (m_compact_leaves)
+            {
+                TriangleEncoder::encode_compact(
                     triangle_vertex_infos,
-                    triangle_vertices,
+                    vertex_pool_indices,
                     triangle_indices,
                     item_begin,
                     item_count,
-                    user_data_writer);
+                    *writer);
             }
             else
             {
-                user_data_writer.write(static_cast<uint32>(leaf_data_writer.offset()));
-
                 TriangleEncoder::encode(
                     triangle_vertex_infos,
                     triangle_vertices,
                     triangle_indices,
                     item_begin,
                     item_count,
-                    leaf_data_writer);
+                    *writer);
             }
         }
     }
 
+    // Pack triangle keys when using compact leaves, unless they don't fit in 64 bits.
+    if (m_compact_leaves)
+    {
+        for (const_each<vector<TriangleKey>> i = m_triangle_keys; i; ++i)
+            m_triangle_key_packer.insert(*i);
+
+        if (m_triangle_key_packer.fits())
+        {
+            m_packed_triangle_keys.reserve(m_triangle_keys.size());
+
+            for (const_each<vector<TriangleKey>> i = m_triangle_keys; i; ++i)
+                m_packed_triangle_keys.push_back(m_triangle_key_packer.pack(*i));
+
+            clear_release_memory(m_triangle_keys);
+        }
+    }
+
+    statistics.insert("leaf format", string(m_compact_leaves ? "compact" : "full"));
     statistics.insert_percent("fat leaves", fat_leaf_count, leaf_count);
+    statistics.insert_size(
+        "triangle keys",
+          m_triangle_keys.capacity() * sizeof(TriangleKey)
+        + m_packed_triangle_keys.capacity() * sizeof(uint64));
+    statistics.insert_size("leaf data", m_leaf_data.capacity() * sizeof(uint8));
+    if (m_compact_leaves)
+    {
+        statistics.insert_size("vertex pool", m_vertex_pool.capacity() * sizeof(GVector3));
+        statistics.insert_percent("shared vertices", triangle_vertices.size() - m_vertex_pool.size(), triangle_vertices.size());
+    }
 }
 
 namespace
@@ -1082,27 +1482,6 @@ namespace
     typedef set<FilterKey> FilterKeySet;
     typedef map<size_t, const FilterKey*> IndexToFilterKeyMap;
 
-    // Collect the set of object instances contained in an assembly.
-    void collect_object_instances(
-        const Assembly&                     assembly,
-        IndexSet&                           object_instances)
-    {
-        for (size_t i = 0, e = assembly.object_instances().size(); i < e; ++i)
-        {
-            // Retrieve the object instance and its transformation.
-            const ObjectInstance* object_instance =
-                assembly.object_instances().get_by_index(i);
-            assert(object_instance);
-
-            // Retrieve the object.
-            Object& object = object_instance->get_object();
-
-            // Process only mesh objects.
-            if (strcmp(object.get_model(), MeshObjectFactory().get_model()) == 0)
-                object_instances.insert(i);
-        }
-    }
-
     // Create filter keys for a set of object instances, and establish an (object instance) -> (filter key) mapping.
     void create_filter_keys(
         const ObjectInstanceContainer&      object_instances,
@@ -1249,8 +1628,9 @@ namespace
 void TriangleTree::update_intersection_filters()
 {
     // Collect object instances.
-    IndexSet object_instances;
-    collect_object_instances(m_arguments.m_assembly, object_instances);
+    const IndexSet object_instances(
+        m_object_instance_indices.begin(),
+        m_object_instance_indices.end());
 
     // Create filter keys and map object instances to filter keys.
     FilterKeySet filter_keys;
@@ -1366,6 +1746,23 @@ bool TriangleLeafVisitor::visit(
         leaf_data_index == ~uint32(0)
             ? user_data + sizeof(uint32)                // triangles are stored in the leaf node
             : &m_tree.m_leaf_data[leaf_data_index];     // triangles are stored in the tree
+
+    if (m_tree.m_compact_leaves)
+    {
+        visit_compact_leaf(
+            node,
+            leaf_data,
+            ray
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+            , stats
+#endif
+            );
+
+        // Continue traversal.
+        distance = m_shading_point.m_ray.m_tmax;
+        return true;
+    }
+
     MemoryReader reader(leaf_data);
 
     // Sequentially intersect all triangles of the leaf.
@@ -1403,7 +1800,7 @@ bool TriangleLeafVisitor::visit(
                 // Optionally filter intersections.
                 if (m_has_intersection_filters)
                 {
-                    const TriangleKey& triangle_key = m_tree.m_triangle_keys[triangle_index];
+                    const TriangleKey triangle_key = m_tree.get_triangle_key(triangle_index);
                     const IntersectionFilter* filter =
                         m_tree.m_intersection_filters[triangle_key.get_object_instance_index()];
                     if (filter && !filter->accept(triangle_key, u, v))
@@ -1458,15 +1855,15 @@ bool TriangleLeafVisitor::visit(
                 // Optionally filter intersections.
                 if (m_has_intersection_filters)
                 {
-                    const TriangleKey& triangle_key = m_tree.m_triangle_keys[triangle_index];
+                    const TriangleKey triangle_key = m_tree.get_triangle_key(triangle_index);
                     const IntersectionFilter* filter =
                         m_tree.m_intersection_filters[triangle_key.get_object_instance_index()];
                     if (filter && !filter->accept(triangle_key, u, v))
                         continue;
                 }
 
-                m_interpolated_triangle = triangle;
-                m_hit_triangle = &m_interpolated_triangle;
+                m_decoded_triangle = triangle;
+                m_hit_triangle = &m_decoded_triangle;
                 m_hit_triangle_index = triangle_index;
                 m_shading_point.m_ray.m_tmax = t;
                 m_shading_point.m_bary[0] = static_cast<float>(u);
@@ -1480,6 +1877,98 @@ bool TriangleLeafVisitor::visit(
     return true;
 }
 
+void TriangleLeafVisitor::visit_compact_leaf(
+    const TriangleTree::NodeType&           node,
+    const uint8*                            leaf_data,
+    const Ray3d&                            ray
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , bvh::TraversalStatistics&             stats
+#endif
+    )
+{
+    const vector<GVector3>& vertices = m_tree.m_vertex_pool;
+    MemoryReader reader(leaf_data);
+
+    // Sequentially intersect all triangles of the leaf.
+    for (size_t triangle_index = node.get_item_index(),
+                triangle_count = node.get_item_count();
+                triangle_count--;
+                triangle_index++)
+    {
+        FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+
+        // Retrieve the triangle's visibility flags and number of motion segments.
+        const uint16 vis_flags = reader.read<uint16>();
+        const uint16 motion_segment_count = reader.read<uint16>();
+
+        GTriangleType triangle;
+
+        if (motion_segment_count == 0)
+        {
+            // Check visibility flags.
+            if (!(vis_flags & m_shading_point.m_ray.m_flags))
+            {
+                reader += 3 * sizeof(uint32);
+                continue;
+            }
+
+            // Fetch the triangle's vertices from the vertex pool.
+            const GVector3& v0 = vertices[reader.read<uint32>()];
+            const GVector3& v1 = vertices[reader.read<uint32>()];
+            const GVector3& v2 = vertices[reader.read<uint32>()];
+            triangle = GTriangleType(v0, v1, v2);
+        }
+        else
+        {
+            // Check visibility flags.
+            if (!(vis_flags & m_shading_point.m_ray.m_flags))
+            {
+                reader += sizeof(uint32);
+                continue;
+            }
+
+            // Find the motion step immediately before the ray time.
+            const double base_time = m_shading_point.m_ray.m_time.m_normalized * motion_segment_count;
+            const size_t base_index = truncate<size_t>(base_time);
+            const GVector3* steps = &vertices[reader.read<uint32>() + base_index * 3];
+
+            // Interpolate the triangle's vertices of the motion steps surrounding the ray time.
+            const GScalar frac = static_cast<GScalar>(base_time - base_index);
+            const GScalar one_minus_frac = GScalar(1.0) - frac;
+            triangle =
+                GTriangleType(
+                    steps[0] * one_minus_frac + steps[3] * frac,
+                    steps[1] * one_minus_frac + steps[4] * frac,
+                    steps[2] * one_minus_frac + steps[5] * frac);
+        }
+
+        // Convert the triangle to the right format if necessary.
+        const TriangleReader triangle_reader(triangle);
+
+        // Intersect the triangle.
+        double t, u, v;
+        if (triangle_reader.m_triangle.intersect(ray, t, u, v))
+        {
+            // Optionally filter intersections.
+            if (m_has_intersection_filters)
+            {
+                const TriangleKey triangle_key = m_tree.get_triangle_key(triangle_index);
+                const IntersectionFilter* filter =
+                    m_tree.m_intersection_filters[triangle_key.get_object_instance_index()];
+                if (filter && !filter->accept(triangle_key, u, v))
+                    continue;
+            }
+
+            m_decoded_triangle = triangle;
+            m_hit_triangle = &m_decoded_triangle;
+            m_hit_triangle_index = triangle_index;
+            m_shading_point.m_ray.m_tmax = t;
+            m_shading_point.m_bary[0] = static_cast<float>(u);
+            m_shading_point.m_bary[1] = static_cast<float>(v);
+        }
+    }
+}
+
 void TriangleLeafVisitor::read_hit_triangle_data() const
 {
     if (m_hit_triangle)
@@ -1488,7 +1977,7 @@ void TriangleLeafVisitor::read_hit_triangle_data() const
         m_shading_point.m_primitive_type = ShadingPoint::PrimitiveTriangle;
 
         // Copy the triangle key.
-        const TriangleKey& triangle_key = m_tree.m_triangle_keys[m_hit_triangle_index];
+        const TriangleKey triangle_key = m_tree.get_triangle_key(m_hit_triangle_index);
         m_shading_point.m_object_instance_index = triangle_key.get_object_instance_index();
         m_shading_point.m_primitive_index = triangle_key.get_triangle_index();
 
@@ -1498,6 +1987,25 @@ void TriangleLeafVisitor::read_hit_triangle_data() const
     }
 }
 
+void TriangleLeafVisitor::read_hit_triangle_data(
+    const size_t                            object_instance_index,
+    const Transformd&                       object_instance_transform) const
+{
+    if (m_hit_triangle)
+    {
+        read_hit_triangle_data();
+
+        // Attribute the hit to the object instance.
+        m_shading_point.m_object_instance_index = object_instance_index;
+
+        // Transform the support plane of the hit triangle to assembly space.
+        TriangleSupportPlaneType& support_plane = m_shading_point.m_triangle_support_plane;
+        support_plane.m_v0 = object_instance_transform.point_to_parent(support_plane.m_v0);
+        support_plane.m_e0 = object_instance_transform.vector_to_parent(support_plane.m_e0);
+        support_plane.m_e1 = object_instance_transform.vector_to_parent(support_plane.m_e1);
+    }
+}
+
 
 //
 // TriangleLeafProbeVisitor class implementation.
@@ -1520,6 +2028,27 @@ bool TriangleLeafProbeVisitor::visit(
         leaf_data_index == ~uint32(0)
             ? user_data + sizeof(uint32)                // triangles are stored in the leaf node
             : &m_tree.m_leaf_data[leaf_data_index];     // triangles are stored in the tree
+
+    if (m_tree.m_compact_leaves)
+    {
+        if (visit_compact_leaf(
+                node,
+                leaf_data,
+                ray
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+                , stats
+#endif
+                ))
+        {
+            m_hit = true;
+            return false;
+        }
+
+        // Continue traversal.
+        distance = ray.m_tmax;
+        return true;
+    }
+
     MemoryReader reader(leaf_data);
 
     // Sequentially intersect triangles until a hit is found.
@@ -1602,4 +2131,75 @@ bool TriangleLeafProbeVisitor::visit(
     return true;
 }
 
+bool TriangleLeafProbeVisitor::visit_compact_leaf(
+    const TriangleTree::NodeType&           node,
+    const uint8*                            leaf_data,
+    const Ray3d&                            ray
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+    , bvh::TraversalStatistics&             stats
+#endif
+    )
+{
+    const vector<GVector3>& vertices = m_tree.m_vertex_pool;
+    MemoryReader reader(leaf_data);
+
+    // Sequentially intersect triangles until a hit is found.
+    for (size_t triangle_count = node.get_item_count(); triangle_count--; )
+    {
+        FOUNDATION_BVH_TRAVERSAL_STATS(stats.m_intersected_items.insert(1));
+
+        // Retrieve the triangle's visibility flags and number of motion segments.
+        const uint16 vis_flags = reader.read<uint16>();
+        const uint16 motion_segment_count = reader.read<uint16>();
+
+        GTriangleType triangle;
+
+        if (motion_segment_count == 0)
+        {
+            // Check visibility flags.
+            if (!(vis_flags & m_ray_flags))
+            {
+                reader += 3 * sizeof(uint32);
+                continue;
+            }
+
+            // Fetch the triangle's vertices from the vertex pool.
+            const GVector3& v0 = vertices[reader.read<uint32>()];
+            const GVector3& v1 = vertices[reader.read<uint32>()];
+            const GVector3& v2 = vertices[reader.read<uint32>()];
+            triangle = GTriangleType(v0, v1, v2);
+        }
+        else
+        {
+            // Check visibility flags.
+            if (!(vis_flags & m_ray_flags))
+            {
+                reader += sizeof(uint32);
+                continue;
+            }
+
+            // Find the motion step immediately before the ray time.
+            const double base_time = m_ray_time * motion_segment_count;
+            const size_t base_index = truncate<size_t>(base_time);
+            const GVector3* steps = &vertices[reader.read<uint32>() + base_index * 3];
+
+            // Interpolate the triangle's vertices of the motion steps surrounding the ray time.
+            const GScalar frac = static_cast<GScalar>(base_time - base_index);
+            const GScalar one_minus_frac = GScalar(1.0) - frac;
+            triangle =
+                GTriangleType(
+                    steps[0] * one_minus_frac + steps[3] * frac,
+                    steps[1] * one_minus_frac + steps[4] * frac,
+                    steps[2] * one_minus_frac + steps[5] * frac);
+        }
+
+        // Convert the triangle to the right format if necessary, and intersect it.
+        const TriangleReader triangle_reader(triangle);
+        if (triangle_reader.m_triangle.intersect(ray))
+            return true;
+    }
+
+    return false;
+}
+
 }   // namespace renderer
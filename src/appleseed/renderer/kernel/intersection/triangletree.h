@@ -42,6 +42,7 @@
 #include "foundation/math/aabb.h"
 #include "foundation/math/bvh.h"
 #include "foundation/math/ray.h"
+#include "foundation/math/transform.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/alignedvector.h"
 #include "foundation/utility/lazy.h"
@@ -73,10 +74,11 @@ typedef std::map<foundation::uint64, IntersectionFilter*> IntersectionFilterRepo
 //
 
 class TriangleTree
-  : public foundation::bvh::Tree<
+  : public foundation::bvh::WideTree<
                foundation::AlignedVector<
                    foundation::bvh::Node<foundation::AABB3d>
-               >
+               >,
+               TriangleTreeBranchingFactor
            >
 {
   public:
@@ -87,13 +89,17 @@ class TriangleTree
         const foundation::UniqueID              m_triangle_tree_uid;
         const GAABB3                            m_bbox;
         const Assembly&                         m_assembly;
+        const size_t                            m_thread_count;     // number of threads used to build the tree
+        const size_t                            m_object_instance_index;    // if not ~0, only this object instance is stored, in object space
 
         // Constructor.
         Arguments(
             const Scene&                        scene,
             const foundation::UniqueID          triangle_tree_uid,
             const GAABB3&                       bbox,
-            const Assembly&                     assembly);
+            const Assembly&                     assembly,
+            const size_t                        thread_count = 1,
+            const size_t                        object_instance_index = ~size_t(0));
     };
 
     // Constructor, builds the tree for a given assembly.
@@ -105,6 +111,13 @@ class TriangleTree
     // Update the non-geometry aspects of the tree.
     void update_non_geometry(const bool enable_intersection_filters);
 
+    // Refit the tree to the current geometry of its object instances, given the new bounding
+    // box of the tree. Return false if the tree must be rebuilt instead, which is the case if
+    // the set of triangles changed, if the tree has moving triangles or was built with spatial
+    // splits, or if refitting degraded the tree too much. The tree must not be used anymore
+    // after refit() returned false.
+    bool refit(const GAABB3& bbox);
+
     // Return the number of static and moving triangles.
     size_t get_static_triangle_count() const;
     size_t get_moving_triangle_count() const;
@@ -117,12 +130,20 @@ class TriangleTree
     friend class TriangleLeafProbeVisitor;
 
     const Arguments                             m_arguments;
+    std::vector<size_t>                         m_object_instance_indices;
 
     size_t                                      m_static_triangle_count;
     size_t                                      m_moving_triangle_count;
 
+    bool                                        m_refittable;
+    double                                      m_built_sah_cost;
+
+    bool                                        m_compact_leaves;
     std::vector<TriangleKey>                    m_triangle_keys;
+    TriangleKeyPacker                           m_triangle_key_packer;
+    std::vector<foundation::uint64>             m_packed_triangle_keys;    // used instead of m_triangle_keys when keys are packed
     std::vector<foundation::uint8>              m_leaf_data;
+    std::vector<GVector3>                       m_vertex_pool;              // vertices referenced by compact leaves
 
     IntersectionFilterRepository                m_intersection_filters_repository;
     std::vector<const IntersectionFilter*>      m_intersection_filters;
@@ -152,6 +173,8 @@ class TriangleTree
         const std::vector<TriangleKey>&         triangle_keys,
         foundation::Statistics&                 statistics);
 
+    TriangleKey get_triangle_key(const size_t index) const;
+
     void update_intersection_filters();
     void delete_intersection_filters();
 };
@@ -225,13 +248,32 @@ class TriangleLeafVisitor
     // Read additional data about the triangle that was hit, if any.
     void read_hit_triangle_data() const;
 
+    // Same as above, for trees storing a single object instance in object space:
+    // the hit is attributed to a given instance of the object, in assembly space.
+    void read_hit_triangle_data(
+        const size_t                            object_instance_index,
+        const foundation::Transformd&           object_instance_transform) const;
+
+    // Return true if a triangle was hit.
+    bool hit() const;
+
   private:
     const TriangleTree&     m_tree;
     const bool              m_has_intersection_filters;
     ShadingPoint&           m_shading_point;
-    GTriangleType           m_interpolated_triangle;
+    GTriangleType           m_decoded_triangle;         // hit triangle, when not stored as is in the tree
     const GTriangleType*    m_hit_triangle;
     size_t                  m_hit_triangle_index;
+
+    // Intersect the triangles of a leaf using the compact leaf format.
+    void visit_compact_leaf(
+        const TriangleTree::NodeType&           node,
+        const foundation::uint8*                leaf_data,
+        const foundation::Ray3d&                ray
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics& stats
+#endif
+        );
 };
 
 
@@ -266,6 +308,16 @@ class TriangleLeafProbeVisitor
     const double                m_ray_time;
     const VisibilityFlags::Type m_ray_flags;
     const bool                  m_has_intersection_filters;
+
+    // Intersect the triangles of a leaf using the compact leaf format, return true on hit.
+    bool visit_compact_leaf(
+        const TriangleTree::NodeType&           node,
+        const foundation::uint8*                leaf_data,
+        const foundation::Ray3d&                ray
+#ifdef FOUNDATION_BVH_ENABLE_TRAVERSAL_STATS
+        , foundation::bvh::TraversalStatistics& stats
+#endif
+        );
 };
 
 
@@ -273,17 +325,17 @@ class TriangleLeafProbeVisitor
 // Triangle tree intersectors.
 //
 
-typedef foundation::bvh::Intersector<
+typedef foundation::bvh::WideIntersector<
     TriangleTree,
     TriangleLeafVisitor,
-    foundation::Ray3d,          // make sure we pick the SSE2-optimized version of foundation::bvh::Intersector
+    foundation::Ray3d,          // make sure we pick the SIMD node intersection kernels
     TriangleTreeStackSize
 > TriangleTreeIntersector;
 
-typedef foundation::bvh::Intersector<
+typedef foundation::bvh::WideIntersector<
     TriangleTree,
     TriangleLeafProbeVisitor,
-    foundation::Ray3d,          // make sure we pick the SSE2-optimized version of foundation::bvh::Intersector
+    foundation::Ray3d,          // make sure we pick the SIMD node intersection kernels
     TriangleTreeStackSize
 > TriangleTreeProbeIntersector;
 
@@ -302,6 +354,14 @@ inline size_t TriangleTree::get_moving_triangle_count() const
     return m_moving_triangle_count;
 }
 
+inline TriangleKey TriangleTree::get_triangle_key(const size_t index) const
+{
+    return
+        m_packed_triangle_keys.empty()
+            ? m_triangle_keys[index]
+            : m_triangle_key_packer.unpack(m_packed_triangle_keys[index]);
+}
+
 
 //
 // TriangleLeafVisitor class implementation.
@@ -317,6 +377,11 @@ inline TriangleLeafVisitor::TriangleLeafVisitor(
 {
 }
 
+inline bool TriangleLeafVisitor::hit() const
+{
+    return m_hit_triangle != nullptr;
+}
+
 
 //
 // TriangleLeafProbeVisitor class implementation.
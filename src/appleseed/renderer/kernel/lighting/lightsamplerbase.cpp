@@ -445,14 +445,17 @@ void LightSamplerBase::sample_emitting_triangles(
 {
     assert(m_emitting_triangles_cdf.valid());
 
-    const EmitterCDF::ItemWeightPair result = m_emitting_triangles_cdf.sample(s[0]);
+    // s[1] decides between the items of the selected bin and is remapped
+    // before being used to sample the surface of the triangle.
+    float s1 = s[1];
+    const EmitterCDF::ItemWeightPair result = m_emitting_triangles_cdf.sample(s[0], s1);
     const size_t emitter_index = result.first;
     const float emitter_prob = result.second;
 
     light_sample.m_light = nullptr;
     sample_emitting_triangle(
         time,
-        Vector2f(s[1], s[2]),
+        Vector2f(s1, s[2]),
         emitter_index,
         emitter_prob,
         light_sample);
@@ -36,7 +36,7 @@
 
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
-#include "foundation/math/cdf.h"
+#include "foundation/math/aliastable.h"
 
 // Standard headers.
 #include <functional>
@@ -85,7 +85,7 @@ class LightSamplerBase
 
     typedef std::vector<NonPhysicalLightInfo> NonPhysicalLightVector;
     typedef std::vector<EmittingTriangle> EmittingTriangleVector;
-    typedef foundation::CDF<size_t, float> EmitterCDF;
+    typedef foundation::AliasTable<size_t, float> EmitterCDF;
 
     typedef std::function<void (const NonPhysicalLightInfo&)> LightHandlingFunction;
     typedef std::function<bool (const Material*, const float, const size_t)> TriangleHandlingFunction;
@@ -254,7 +254,11 @@ namespace
             stats.insert("path count", m_path_count);
             stats.insert("path length", m_path_length);
 
-            return StatisticsVector::make("light tracing statistics", stats);
+            StatisticsVector vec;
+            vec.insert("light tracing statistics", stats);
+            vec.merge(m_shading_context.get_statistics());
+
+            return vec;
         }
 
       private:
@@ -560,6 +564,16 @@ namespace
                 m_params.m_sampling_mode,
                 instance);
 
+            // In hero mode, trace these light paths with a single set of hero wavelengths.
+            const bool hero_wavelengths = Spectrum::get_mode() == Spectrum::Hero;
+            if (hero_wavelengths)
+            {
+                sampling_context.split_in_place(1, 1);
+                const float s = sampling_context.next2<float>();
+                Spectrum::select_hero_wavelengths(
+                    truncate<size_t>(s * Spectrum::HeroSetCount));
+            }
+
             size_t stored_sample_count = 0;
 
             // Trace one path from one of the lights.
@@ -579,6 +593,9 @@ namespace
 
             ++m_light_sample_count;
 
+            if (hero_wavelengths)
+                Spectrum::select_all_wavelengths();
+
             return stored_sample_count;
         }
 
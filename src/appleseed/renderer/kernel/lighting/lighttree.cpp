@@ -32,6 +32,7 @@
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
 #include "renderer/global/globaltypes.h"
+#include "renderer/kernel/lighting/lighttree_partitioner.h"
 #include "renderer/kernel/shading/shadingpoint.h"
 #include "renderer/modeling/edf/edf.h"
 #include "renderer/modeling/input/source.h"
@@ -48,6 +49,7 @@
 #include "foundation/utility/vpythonfile.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <limits>
@@ -58,6 +60,53 @@ using namespace std;
 namespace renderer
 {
 
+namespace
+{
+    float non_physical_light_importance(const Light* light)
+    {
+        Spectrum spectrum;
+        light->get_inputs().find("intensity").source()->evaluate_uniform(spectrum);
+        return average_value(spectrum);
+    }
+
+    float emitting_triangle_importance(const EmittingTriangle& triangle)
+    {
+        const EDF* edf = triangle.m_material->get_uncached_edf();
+        assert(edf != nullptr);
+
+        const float max_contribution = edf->get_uncached_max_contribution();
+
+        // max_contribution is reported as std::numeric_limits<float>::max() when
+        // we can't compute the max_contribution easily (ex: textured lights)
+        // In such cases, we can use a default importance value of 1.0 to avoid
+        // infinite importance values in the light tree nodes.
+        const float radiance =
+            max_contribution == numeric_limits<float>::max()
+                ? 1.0f
+                : max_contribution * edf->get_uncached_importance_multiplier();
+
+        // Weight the radiance by the area of the triangle so that, like the intensity
+        // of non-physical lights, it is proportional to the power of the light.
+        return radiance * triangle.m_area;
+    }
+
+    LightCone emitting_triangle_cone(const EmittingTriangle& triangle)
+    {
+        // The shading normal may deviate from the geometric normal: bound the vertex normals.
+        const Vector3f axis(triangle.m_geometric_normal);
+        float theta_o = 0.0f;
+        const Vector3d* vertex_normals[3] = { &triangle.m_n0, &triangle.m_n1, &triangle.m_n2 };
+        for (size_t i = 0; i < 3; ++i)
+        {
+            const float cos_theta = clamp(dot(axis, normalize(Vector3f(*vertex_normals[i]))), -1.0f, 1.0f);
+            theta_o = max(theta_o, acos(cos_theta));
+        }
+
+        // Emitting triangles emit light in the hemisphere around their shading normal.
+        return LightCone(axis, theta_o, HalfPi<float>());
+    }
+}
+
 //
 // LightTree class implementation.
 //
@@ -75,6 +124,8 @@ LightTree::LightTree(
 vector<size_t> LightTree::build()
 {
     AABBVector light_bboxes;
+    LightTreePartitioner::LightConeVector light_cones;
+    vector<float> light_importances;
 
     // Collect non-physical light sources.
     for (size_t i = 0, e = m_non_physical_lights.size(); i < e; ++i)
@@ -95,9 +146,15 @@ vector<size_t> LightTree::build()
                                    Vector3d(position[0] + BboxSize,
                                             position[1] + BboxSize,
                                             position[2] + BboxSize));
+        // Non-physical lights emit light in all directions.
+        const float importance = non_physical_light_importance(light);
+        const LightCone cone(Vector3f(0.0f, 0.0f, 1.0f), Pi<float>(), HalfPi<float>());
+
         light_bboxes.push_back(bbox);
+        light_cones.push_back(cone);
+        light_importances.push_back(importance);
 
-        m_items.emplace_back(bbox, i, NonPhysicalLightType);
+        m_items.emplace_back(bbox, i, NonPhysicalLightType, importance, cone);
     }
 
     // Collect emitting triangles.
@@ -111,16 +168,21 @@ vector<size_t> LightTree::build()
         bbox.insert(triangle.m_v1);
         bbox.insert(triangle.m_v2);
 
+        const float importance = emitting_triangle_importance(triangle);
+        const LightCone cone = emitting_triangle_cone(triangle);
+
         light_bboxes.push_back(bbox);
-        m_items.emplace_back(bbox, i, EmittingTriangleType);
+        light_cones.push_back(cone);
+        light_importances.push_back(importance);
+
+        m_items.emplace_back(bbox, i, EmittingTriangleType, importance, cone);
     }
 
     // Create the partitioner.
-    typedef bvh::MiddlePartitioner<AABBVector> Partitioner;
-    Partitioner partitioner(light_bboxes);
+    LightTreePartitioner partitioner(light_bboxes, light_cones, light_importances);
 
     // Build the light tree.
-    typedef bvh::Builder<LightTree, Partitioner> Builder;
+    typedef bvh::Builder<LightTree, LightTreePartitioner> Builder;
     Builder builder;
     builder.build<DefaultWallclockTimer>(*this, partitioner, m_items.size(), 1);
 
@@ -174,6 +236,7 @@ float LightTree::recursive_node_update(
     IndexLUT&       tri_index_to_node_index)
 {
     float importance = 0.0f;
+    LightCone cone;
 
     if (!m_nodes[node_index].is_leaf())
     {
@@ -184,46 +247,20 @@ float LightTree::recursive_node_update(
         const float importance2 = recursive_node_update(node_index, child2, node_level + 1, tri_index_to_node_index);
 
         importance = importance1 + importance2;
+        cone = LightCone::merge(m_nodes[child1].get_cone(), m_nodes[child2].get_cone());
     }
     else
     {
         // Retrieve the light source associated to this leaf.
         const size_t item_index = m_nodes[node_index].get_item_index();
-        const size_t light_index = m_items[item_index].m_light_index;
-
-        if (m_items[item_index].m_light_type == NonPhysicalLightType)
-        {
-            const Light* light = m_non_physical_lights[light_index].m_light;
-            
-            // Retrieve the non-physical light importance.
-            Spectrum spectrum;
-            light->get_inputs().find("intensity").source()->evaluate_uniform(spectrum);
-            importance = average_value(spectrum);
-        }
-        else
-        {
-            assert(m_items[item_index].m_light_type == EmittingTriangleType);
-
-            const EmittingTriangle& triangle = m_emitting_triangles[light_index];
+        const Item& item = m_items[item_index];
 
-            // Retrieve the emitting triangle importance.
-            const EDF* edf = triangle.m_material->get_uncached_edf();
-            assert(edf != nullptr);
+        importance = item.m_importance;
+        cone = item.m_cone;
 
-            const float max_contribution = edf->get_uncached_max_contribution();
-
-            // max_contribution is reported as std::numeric_limits<float>::max() when
-            // we can't compute the max_contribution easily (ex: textured lights)
-            // In such cases, we can use a default importance value of 1.0 to avoid
-            // infinite importance values in the light tree nodes.
-            if (max_contribution == numeric_limits<float>::max()) 
-                importance = 1.0f;
-            else
-                importance = max_contribution * edf->get_uncached_importance_multiplier();
-    
-            // Save the index of the light tree node containing the EMT in the look up table.
-            tri_index_to_node_index[light_index] = node_index;
-        }
+        // Save the index of the light tree node containing the EMT in the look up table.
+        if (item.m_light_type == EmittingTriangleType)
+            tri_index_to_node_index[item.m_light_index] = node_index;
 
         // Keep track of the tree depth.
         if (m_tree_depth < node_level)
@@ -235,6 +272,7 @@ float LightTree::recursive_node_update(
     else m_nodes[node_index].set_parent(parent_index);
 
     m_nodes[node_index].set_importance(importance);
+    m_nodes[node_index].set_cone(cone);
     m_nodes[node_index].set_level(node_level);
 
     return importance;
@@ -412,7 +450,21 @@ float LightTree::compute_node_probability(
     const float approx_contribution = sub_hemispherical_light_source_contribution(cos_omega, cos_sigma);
     
     assert(approx_contribution > 0.0f);
-    return node.get_importance() * rcp_surface_area * approx_contribution;
+
+    //
+    // Account for the orientation of the lights using the cone bounding their emission directions.
+    // Reference:
+    //  [2] Importance Sampling of Many Lights with Adaptive Tree Splitting
+    //      http://www.aconty.com/pdf/many-lights-hpg2018.pdf
+    //
+    const float theta_u = asin(sqrt(sin_sigma2));
+    const float cos_emission =
+        node.get_cone().max_cos_emission(Vector3f(-outcoming_light_direction), theta_u);
+
+    // Avoid returning zero contribution.
+    return
+        node.get_importance() * rcp_surface_area * approx_contribution *
+        (cos_emission > 0.0f ? cos_emission : default_eps<float>());
 }
 
 void LightTree::child_node_probabilites(
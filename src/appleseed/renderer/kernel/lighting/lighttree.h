@@ -29,6 +29,7 @@
 #pragma once
 
 // appleseed.renderer headers.
+#include "renderer/kernel/lighting/lighttree_cone.h"
 #include "renderer/kernel/lighting/lighttree_node.h"
 #include "renderer/kernel/lighting/lighttypes.h"
 
@@ -88,6 +89,8 @@ class LightTree
         foundation::AABB3d      m_bbox;
         size_t                  m_light_index;
         LightType               m_light_type;
+        float                   m_importance;
+        LightCone               m_cone;
 
         Item() {}
 
@@ -95,13 +98,19 @@ class LightTree
         // source_index represents the light index in m_light_sources vector.
         // external_source_index represents the light index in light_tree_lights
         // and emitting_triangles vectors within the BackwardLightSampler.
+        // importance and cone are the power of the light and the bounds of its
+        // emission directions.
         Item(
             const foundation::AABB3d&       bbox,
             const size_t                    light_index,
-            const LightType                 light_type) 
+            const LightType                 light_type,
+            const float                     importance,
+            const LightCone&                cone)
             : m_bbox(bbox)
             , m_light_index(light_index)
             , m_light_type(light_type)
+            , m_importance(importance)
+            , m_cone(cone)
         {
         }
     };
@@ -119,7 +128,8 @@ class LightTree
 
     // Calculate the tree depth.
     // Assign total importance to each node of the tree, where total importance
-    // represents the sum of all its child nodes importances.
+    // represents the sum of all its child nodes importances, and the cone
+    // bounding the emission directions of all its child nodes.
     float recursive_node_update(
         const size_t                                parent_index,
         const size_t                                node_index, 
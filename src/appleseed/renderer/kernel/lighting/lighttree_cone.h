@@ -0,0 +1,190 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace renderer
+{
+
+//
+// A cone bounding the emission directions of a set of lights.
+//
+// m_theta_o bounds the angle between the axis and the normals of the emitters,
+// m_theta_e bounds the angle between the normal of each emitter and the directions
+// in which it emits light. A point light emits in all directions: it is represented
+// by theta_o = Pi and theta_e = Pi / 2.
+//
+// Reference:
+//
+//   Importance Sampling of Many Lights with Adaptive Tree Splitting
+//   Alejandro Conty Estevez, Christopher Kulla
+//   Proceedings of the ACM on Computer Graphics and Interactive Techniques, 2018
+//
+
+class LightCone
+{
+  public:
+    foundation::Vector3f    m_axis;         // unit-length
+    float                   m_theta_o;      // in [0, Pi], negative for an empty cone
+    float                   m_theta_e;      // in [0, Pi / 2]
+
+    // Constructors.
+    LightCone();                            // leave all fields uninitialized
+    LightCone(
+        const foundation::Vector3f&         axis,
+        const float                         theta_o,
+        const float                         theta_e);
+
+    // Return a cone that contains no direction.
+    static LightCone invalid();
+
+    // Return true if the cone contains at least one direction.
+    bool is_valid() const;
+
+    // Return the smallest cone (as computed by the union algorithm of the reference)
+    // containing two given cones.
+    static LightCone merge(const LightCone& a, const LightCone& b);
+
+    // Return the orientation measure of the cone, i.e. the solid angle of its emission
+    // directions weighted by the cosine of the angle to the emitter normals.
+    float measure() const;
+
+    // Return the cosine of the smallest angle between the emission directions of the
+    // cone and a given direction, or 0 if light cannot be emitted in this direction.
+    // theta_u is the half-angle of a cone bounding the emitters as seen from the receiver.
+    float max_cos_emission(
+        const foundation::Vector3f&         direction,
+        const float                         theta_u) const;
+};
+
+
+//
+// LightCone class implementation.
+//
+
+inline LightCone::LightCone()
+{
+}
+
+inline LightCone::LightCone(
+    const foundation::Vector3f&             axis,
+    const float                             theta_o,
+    const float                             theta_e)
+  : m_axis(axis)
+  , m_theta_o(theta_o)
+  , m_theta_e(theta_e)
+{
+}
+
+inline LightCone LightCone::invalid()
+{
+    return LightCone(foundation::Vector3f(0.0f, 0.0f, 1.0f), -1.0f, 0.0f);
+}
+
+inline bool LightCone::is_valid() const
+{
+    return m_theta_o >= 0.0f;
+}
+
+inline LightCone LightCone::merge(const LightCone& a, const LightCone& b)
+{
+    if (!a.is_valid())
+        return b;
+
+    if (!b.is_valid())
+        return a;
+
+    // Make sure that cone a is the widest one.
+    if (b.m_theta_o > a.m_theta_o)
+        return merge(b, a);
+
+    const float theta_e = std::max(a.m_theta_e, b.m_theta_e);
+    const float cos_theta_d = foundation::clamp(foundation::dot(a.m_axis, b.m_axis), -1.0f, 1.0f);
+    const float theta_d = std::acos(cos_theta_d);
+
+    // Cone b is contained in cone a.
+    if (std::min(theta_d + b.m_theta_o, foundation::Pi<float>()) <= a.m_theta_o)
+        return LightCone(a.m_axis, a.m_theta_o, theta_e);
+
+    // The merged cone contains all directions.
+    const float theta_o = 0.5f * (a.m_theta_o + theta_d + b.m_theta_o);
+    if (theta_o >= foundation::Pi<float>())
+        return LightCone(a.m_axis, foundation::Pi<float>(), theta_e);
+
+    // Rotate the axis of cone a toward the axis of cone b.
+    const foundation::Vector3f ortho = b.m_axis - cos_theta_d * a.m_axis;
+    const float ortho_norm = foundation::norm(ortho);
+    if (ortho_norm < 1.0e-6f)
+        return LightCone(a.m_axis, foundation::Pi<float>(), theta_e);
+
+    const float theta_r = theta_o - a.m_theta_o;
+    const foundation::Vector3f axis =
+        std::cos(theta_r) * a.m_axis + (std::sin(theta_r) / ortho_norm) * ortho;
+
+    return LightCone(foundation::normalize(axis), theta_o, theta_e);
+}
+
+inline float LightCone::measure() const
+{
+    assert(is_valid());
+
+    const float theta_w = std::min(m_theta_o + m_theta_e, foundation::Pi<float>());
+    const float sin_theta_o = std::sin(m_theta_o);
+    const float cos_theta_o = std::cos(m_theta_o);
+
+    return
+          foundation::TwoPi<float>() * (1.0f - cos_theta_o)
+        + foundation::HalfPi<float>() *
+              (   2.0f * theta_w * sin_theta_o
+                - std::cos(m_theta_o - 2.0f * theta_w)
+                - 2.0f * m_theta_o * sin_theta_o
+                + cos_theta_o);
+}
+
+inline float LightCone::max_cos_emission(
+    const foundation::Vector3f&             direction,
+    const float                             theta_u) const
+{
+    assert(is_valid());
+
+    const float cos_theta = foundation::clamp(foundation::dot(m_axis, direction), -1.0f, 1.0f);
+    const float theta = std::max(std::acos(cos_theta) - m_theta_o - theta_u, 0.0f);
+
+    return theta < m_theta_e ? std::cos(theta) : 0.0f;
+}
+
+}   // namespace renderer
@@ -28,6 +28,9 @@
 
 #pragma once
 
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/lighttree_cone.h"
+
 // appleseed.foundation headers.
 #include "foundation/math/aabb.h"
 #include "foundation/math/bvh.h"
@@ -49,6 +52,7 @@ class LightTreeNode
   public:
     LightTreeNode()
       : m_importance(0.0f)
+      , m_cone(LightCone::invalid())
       , m_root(false)
       , m_parent(0)
     {
@@ -59,6 +63,11 @@ class LightTreeNode
         return m_importance;
     }
 
+    const LightCone& get_cone() const
+    {
+        return m_cone;
+    }
+
     size_t get_level() const
     {
         return m_tree_level;
@@ -79,6 +88,11 @@ class LightTreeNode
         m_importance = importance;
     }
 
+    void set_cone(const LightCone& cone)
+    {
+        m_cone = cone;
+    }
+
     // todo: set this during the construction
     void set_level(const size_t node_level)
     {
@@ -98,10 +112,11 @@ class LightTreeNode
     }
 
   private:
-    float   m_importance;
-    size_t  m_tree_level;
-    size_t  m_parent;
-    bool    m_root;
+    float       m_importance;
+    LightCone   m_cone;
+    size_t      m_tree_level;
+    size_t      m_parent;
+    bool        m_root;
 };
 
 }   // namespace renderer
@@ -0,0 +1,208 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/lighttree_cone.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/bvh.h"
+#include "foundation/math/scalar.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace renderer
+{
+
+//
+// A light tree partitioner based on the Surface Area Orientation Heuristic (SAOH).
+//
+// The cost of a split is the sum, over both children, of their power times the surface
+// area of their bounding box times the orientation measure of their emission cone. It is
+// regularized by the ratio of the longest extent of the node to its extent along the split
+// axis to avoid thin nodes. Unlike SAH-based partitioners, nodes are always split: each
+// leaf of the light tree must contain exactly one light.
+//
+// Reference:
+//
+//   Importance Sampling of Many Lights with Adaptive Tree Splitting
+//   Alejandro Conty Estevez, Christopher Kulla
+//   Proceedings of the ACM on Computer Graphics and Interactive Techniques, 2018
+//
+
+class LightTreePartitioner
+  : public foundation::bvh::PartitionerBase<std::vector<foundation::AABB3d>>
+{
+  public:
+    typedef foundation::bvh::PartitionerBase<std::vector<foundation::AABB3d>> Base;
+    typedef foundation::AABB3d AABBType;
+    typedef std::vector<AABBType> AABBVectorType;
+    typedef std::vector<LightCone> LightConeVector;
+
+    // Constructor.
+    LightTreePartitioner(
+        const AABBVectorType&               bboxes,
+        const LightConeVector&              cones,
+        const std::vector<float>&           powers);
+
+    // Partition a set of items into two distinct sets.
+    size_t partition(
+        const size_t                        begin,
+        const size_t                        end,
+        const AABBType&                     bbox);
+
+  private:
+    const LightConeVector&                  m_cones;
+    const std::vector<float>&               m_powers;
+    std::vector<double>                     m_left_costs;
+
+    // Return the cost of a set of lights, up to a constant factor.
+    static double cost(
+        const AABBType&                     bbox,
+        const LightCone&                    cone,
+        const double                        power);
+};
+
+
+//
+// LightTreePartitioner class implementation.
+//
+
+inline LightTreePartitioner::LightTreePartitioner(
+    const AABBVectorType&                   bboxes,
+    const LightConeVector&                  cones,
+    const std::vector<float>&               powers)
+  : Base(bboxes)
+  , m_cones(cones)
+  , m_powers(powers)
+  , m_left_costs(bboxes.size() > 1 ? bboxes.size() - 1 : 0)
+{
+    assert(cones.size() == bboxes.size());
+    assert(powers.size() == bboxes.size());
+}
+
+inline size_t LightTreePartitioner::partition(
+    const size_t                            begin,
+    const size_t                            end,
+    const AABBType&                         bbox)
+{
+    const size_t count = end - begin;
+    assert(count > 1);
+
+    const foundation::Vector3d extent = bbox.extent();
+    const double max_extent = foundation::max_value(extent);
+
+    double best_split_cost = std::numeric_limits<double>::max();
+    size_t best_split_dim = foundation::max_index(extent);
+    size_t best_split_pivot = count / 2;
+
+    for (size_t d = 0; d < Dimension; ++d)
+    {
+        // Splitting along a flat dimension is pointless.
+        if (extent[d] <= 0.0)
+            continue;
+
+        const std::vector<size_t>& indices = m_indices[d];
+
+        // Penalize splits along the short dimensions of the node.
+        const double regularization = max_extent / extent[d];
+
+        AABBType bbox_accumulator;
+        LightCone cone_accumulator;
+        double power_accumulator;
+
+        // Left-to-right sweep to accumulate bounding boxes, cones and powers, and compute
+        // the cost of the left sets. Costs are stored at the position of the items so that
+        // disjoint sets of items can be partitioned concurrently.
+        double* left_costs = &m_left_costs[begin];
+        bbox_accumulator.invalidate();
+        cone_accumulator = LightCone::invalid();
+        power_accumulator = 0.0;
+        for (size_t i = 0; i < count - 1; ++i)
+        {
+            const size_t item_index = indices[begin + i];
+            bbox_accumulator.insert(m_bboxes[item_index]);
+            cone_accumulator = LightCone::merge(cone_accumulator, m_cones[item_index]);
+            power_accumulator += m_powers[item_index];
+            left_costs[i] = cost(bbox_accumulator, cone_accumulator, power_accumulator);
+        }
+
+        // Right-to-left sweep to accumulate bounding boxes, cones and powers, and find the best partition.
+        bbox_accumulator.invalidate();
+        cone_accumulator = LightCone::invalid();
+        power_accumulator = 0.0;
+        for (size_t i = count - 1; i > 0; --i)
+        {
+            const size_t item_index = indices[begin + i];
+            bbox_accumulator.insert(m_bboxes[item_index]);
+            cone_accumulator = LightCone::merge(cone_accumulator, m_cones[item_index]);
+            power_accumulator += m_powers[item_index];
+
+            // Compute the cost of this partition.
+            const double split_cost =
+                regularization *
+                (left_costs[i - 1] + cost(bbox_accumulator, cone_accumulator, power_accumulator));
+
+            // Keep track of the partition with the lowest cost.
+            if (best_split_cost > split_cost)
+            {
+                best_split_cost = split_cost;
+                best_split_dim = d;
+                best_split_pivot = i;
+            }
+        }
+    }
+
+    const size_t pivot = begin + best_split_pivot;
+    assert(pivot > begin && pivot < end);
+
+    sort_indices(best_split_dim, begin, end, pivot);
+
+    return pivot;
+}
+
+inline double LightTreePartitioner::cost(
+    const AABBType&                         bbox,
+    const LightCone&                        cone,
+    const double                            power)
+{
+    // Use the diagonal of the bounding box as a lower bound of its size so that
+    // sets of lights with flat or degenerate bounding boxes are not free.
+    const double area = std::max(half_surface_area(bbox), bbox.square_diameter());
+
+    return power * area * static_cast<double>(cone.measure());
+}
+
+}   // namespace renderer
@@ -0,0 +1,86 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "pathguide.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/fp.h"
+#include "foundation/math/scalar.h"
+
+using namespace foundation;
+
+namespace renderer
+{
+
+//
+// PathGuide class implementation.
+//
+
+PathGuide::PathGuide(
+    SDTree&             sd_tree,
+    const float         bsdf_sampling_fraction)
+  : m_sd_tree(sd_tree)
+  , m_bsdf_sampling_fraction(clamp(bsdf_sampling_fraction, PathGuideMinBSDFSamplingFraction, 1.0f))
+  , m_path_radiance(nullptr)
+{
+}
+
+void PathGuide::begin_path(const Spectrum& path_radiance)
+{
+    m_path_radiance = &path_radiance;
+    m_vertices.clear();
+}
+
+void PathGuide::end_path()
+{
+    assert(m_path_radiance != nullptr);
+
+    for (const Vertex& vertex : m_vertices)
+    {
+        // Estimate the incident radiance, averaged over the spectrum.
+        float radiance = 0.0f;
+        for (size_t i = 0, e = Spectrum::size(); i < e; ++i)
+        {
+            if (vertex.m_throughput[i] > 0.0f)
+                radiance += ((*m_path_radiance)[i] - vertex.m_path_radiance[i]) / vertex.m_throughput[i];
+        }
+        radiance /= Spectrum::size();
+
+        // Discard invalid estimates but still count them as samples.
+        if (!FP<float>::is_finite(radiance) || radiance < 0.0f)
+            radiance = 0.0f;
+
+        m_sd_tree.record(vertex.m_point, vertex.m_direction, radiance);
+    }
+
+    m_path_radiance = nullptr;
+    m_vertices.clear();
+}
+
+}   // namespace renderer
@@ -0,0 +1,161 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/lighting/sdtree.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/vector.h"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace renderer
+{
+
+// Lowest probability of sampling the BSDF rather than the learned distribution. It must be
+// positive so that directions sampled from the BSDF never get a zero combined density where
+// the learned distribution vanishes.
+const float PathGuideMinBSDFSamplingFraction = 0.05f;
+
+//
+// The per-thread interface between a path tracer and an SD-tree: it provides the learned
+// distributions of incident radiance used to guide paths, and records the radiance
+// incident at the scattering events of paths to train the SD-tree.
+//
+// The radiance incident at a scattering event is estimated as the radiance accumulated
+// by the path after this event divided by the path throughput right after this event.
+//
+
+class PathGuide
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor. bsdf_sampling_fraction is clamped to [PathGuideMinBSDFSamplingFraction, 1].
+    PathGuide(
+        SDTree&                         sd_tree,
+        const float                     bsdf_sampling_fraction);
+
+    // Return true if directions can be sampled from the learned distributions.
+    bool is_guiding() const;
+
+    // Return true if incident radiance must be recorded.
+    bool is_recording() const;
+
+    // Return the probability of sampling the BSDF rather than the learned distribution.
+    float get_bsdf_sampling_fraction() const;
+
+    // Return the probability density of a direction sampled from the mixture of the BSDF
+    // and the learned distribution, given the densities of both techniques.
+    float combine_pdfs(const float bsdf_prob, const float guide_prob) const;
+
+    // Return the learned distribution of incident radiance at a given point.
+    const DTree& get_dtree(const foundation::Vector3d& point) const;
+
+    // Begin recording a path whose radiance is accumulated into a given spectrum.
+    void begin_path(const Spectrum& path_radiance);
+
+    // Record a non-specular scattering event of the current path.
+    void add_vertex(
+        const foundation::Vector3d&     point,
+        const foundation::Vector3d&     direction,          // unit-length
+        const Spectrum&                 throughput);        // path throughput right after the scattering event
+
+    // End the current path and record the radiance incident at its scattering events.
+    void end_path();
+
+  private:
+    struct Vertex
+    {
+        foundation::Vector3f    m_point;
+        foundation::Vector3f    m_direction;
+        Spectrum                m_throughput;
+        Spectrum                m_path_radiance;            // path radiance right after the scattering event
+    };
+
+    SDTree&                     m_sd_tree;
+    const float                 m_bsdf_sampling_fraction;
+    const Spectrum*             m_path_radiance;
+    std::vector<Vertex>         m_vertices;
+};
+
+
+//
+// PathGuide class implementation.
+//
+
+inline bool PathGuide::is_guiding() const
+{
+    return m_sd_tree.is_built();
+}
+
+inline bool PathGuide::is_recording() const
+{
+    return m_sd_tree.is_recording();
+}
+
+inline float PathGuide::get_bsdf_sampling_fraction() const
+{
+    return m_bsdf_sampling_fraction;
+}
+
+inline float PathGuide::combine_pdfs(const float bsdf_prob, const float guide_prob) const
+{
+    return
+          m_bsdf_sampling_fraction * bsdf_prob
+        + (1.0f - m_bsdf_sampling_fraction) * guide_prob;
+}
+
+inline const DTree& PathGuide::get_dtree(const foundation::Vector3d& point) const
+{
+    return m_sd_tree.get_sampling_dtree(foundation::Vector3f(point));
+}
+
+inline void PathGuide::add_vertex(
+    const foundation::Vector3d&         point,
+    const foundation::Vector3d&         direction,
+    const Spectrum&                     throughput)
+{
+    assert(m_path_radiance != nullptr);
+
+    m_vertices.push_back(Vertex());
+
+    Vertex& vertex = m_vertices.back();
+    vertex.m_point = foundation::Vector3f(point);
+    vertex.m_direction = foundation::Vector3f(direction);
+    vertex.m_throughput = throughput;
+    vertex.m_path_radiance = *m_path_radiance;
+}
+
+}   // namespace renderer
@@ -34,8 +34,10 @@
 #include "renderer/global/globaltypes.h"
 #include "renderer/kernel/aov/aovcomponents.h"
 #include "renderer/kernel/intersection/intersector.h"
+#include "renderer/kernel/lighting/pathguide.h"
 #include "renderer/kernel/lighting/pathvertex.h"
 #include "renderer/kernel/lighting/scatteringmode.h"
+#include "renderer/kernel/lighting/sdtree.h"
 #include "renderer/kernel/shading/shadingcontext.h"
 #include "renderer/kernel/shading/shadingpoint.h"
 #include "renderer/kernel/shading/shadingray.h"
@@ -88,7 +90,8 @@ class PathTracer
         const size_t            max_volume_bounces,
         const bool              clamp_roughness,
         const size_t            max_iterations = 1000,
-        const double            near_start = 0.0);          // abort tracing if the first ray is shorter than this
+        const double            near_start = 0.0,           // abort tracing if the first ray is shorter than this
+        PathGuide*              path_guide = nullptr);      // guide and record paths if not null
 
     size_t trace(
         SamplingContext&        sampling_context,
@@ -117,6 +120,7 @@ class PathTracer
     const bool                  m_clamp_roughness;
     const size_t                m_max_iterations;
     const double                m_near_start;
+    PathGuide*                  m_path_guide;
     size_t                      m_diffuse_bounces;
     size_t                      m_glossy_bounces;
     size_t                      m_specular_bounces;
@@ -134,6 +138,15 @@ class PathTracer
         SamplingContext&        sampling_context,
         PathVertex&             vertex);
 
+    // Sample the BSDF in a given path vertex, or the learned distribution of incident radiance
+    // if the path is guided. Return true if the BSDF was sampled. 'bsdf_prob' receives the
+    // probability density of the sampled direction with respect to BSDF sampling alone.
+    bool sample_bsdf(
+        SamplingContext&        sampling_context,
+        PathVertex&             vertex,
+        BSDFSample&             sample,
+        float&                  bsdf_prob);
+
     // Apply path visitor and sample BSDF in a given path vertex.
     // If all checks are passed, build a bounced ray that continues in the sampled direction
     // and return true, otherwise return false.
@@ -170,7 +183,8 @@ inline PathTracer<PathVisitor, VolumeVisitor, Adjoint>::PathTracer(
     const size_t                max_volume_bounces,
     const bool                  clamp_roughness,
     const size_t                max_iterations,
-    const double                near_start)
+    const double                near_start,
+    PathGuide*                  path_guide)
   : m_path_visitor(path_visitor)
   , m_volume_visitor(volume_visitor)
   , m_rr_min_path_length(rr_min_path_length)
@@ -182,6 +196,7 @@ inline PathTracer<PathVisitor, VolumeVisitor, Adjoint>::PathTracer(
   , m_clamp_roughness(clamp_roughness)
   , m_max_iterations(max_iterations)
   , m_near_start(near_start)
+  , m_path_guide(path_guide)
 {
 }
 
@@ -674,19 +689,19 @@ bool PathTracer<PathVisitor, VolumeVisitor, Adjoint>::process_bounce(
         return false;
 
     // Above-surface scattering.
+    float bsdf_prob;
     if (vertex.m_bssrdf == nullptr)
     {
-        vertex.m_bsdf->sample(
-            sampling_context,
-            vertex.m_bsdf_data,
-            Adjoint,
-            true,       // multiply by |cos(incoming, normal)|
-            vertex.m_scattering_modes,
-            sample);
+        const bool bsdf_sampled =
+            sample_bsdf(
+                sampling_context,
+                vertex,
+                sample,
+                bsdf_prob);
 
         next_ray.m_min_roughness = m_clamp_roughness ? sample.m_min_roughness : 0.0f;
 
-        if (sample.get_mode() == ScatteringMode::Diffuse && !vertex.m_albedo_saved)
+        if (bsdf_sampled && sample.get_mode() == ScatteringMode::Diffuse && !vertex.m_albedo_saved)
         {
             vertex.m_albedo = sample.m_aov_components.m_albedo;
             vertex.m_albedo_saved = true;
@@ -699,6 +714,8 @@ bool PathTracer<PathVisitor, VolumeVisitor, Adjoint>::process_bounce(
         // However, we need to check if the corresponding mode is still enabled.
         if ((sample.get_mode() & vertex.m_scattering_modes) == 0)
             sample.set_to_absorption();
+
+        bsdf_prob = sample.get_probability();
     }
 
     // Terminate the path if it gets absorbed.
@@ -710,8 +727,10 @@ bool PathTracer<PathVisitor, VolumeVisitor, Adjoint>::process_bounce(
         return false;
 
     // Save the scattering properties for MIS at light-emitting vertices.
+    // Next event estimation weighs light samples against BSDF sampling alone,
+    // so the density of guided samples must not be used here.
     vertex.m_prev_mode = sample.get_mode();
-    vertex.m_prev_prob = sample.get_probability();
+    vertex.m_prev_prob = bsdf_prob;
 
     // Update the AOV scattering mode only for the first bounce.
     if (vertex.m_path_length == 1)
@@ -747,9 +766,116 @@ bool PathTracer<PathVisitor, VolumeVisitor, Adjoint>::process_bounce(
         next_ray.m_has_differentials = true;
     }
 
+    // Record the scattering event to learn the incident radiance.
+    if (m_path_guide != nullptr &&
+        m_path_guide->is_recording() &&
+        sample.get_probability() != BSDF::DiracDelta)
+        m_path_guide->add_vertex(vertex.get_point(), next_ray.m_dir, vertex.m_throughput);
+
     return true;
 }
 
+template <typename PathVisitor, typename VolumeVisitor, bool Adjoint>
+bool PathTracer<PathVisitor, VolumeVisitor, Adjoint>::sample_bsdf(
+    SamplingContext&            sampling_context,
+    PathVertex&                 vertex,
+    BSDFSample&                 sample,
+    float&                      bsdf_prob)
+{
+    if (m_path_guide == nullptr ||
+        !m_path_guide->is_guiding() ||
+        vertex.m_bsdf->is_purely_specular())
+    {
+        vertex.m_bsdf->sample(
+            sampling_context,
+            vertex.m_bsdf_data,
+            Adjoint,
+            true,       // multiply by |cos(incoming, normal)|
+            vertex.m_scattering_modes,
+            sample);
+
+        bsdf_prob = sample.get_probability();
+        return true;
+    }
+
+    // Choose between BSDF sampling and sampling of the learned distribution,
+    // and combine both techniques with the one-sample balance heuristic.
+    const float bsdf_fraction = m_path_guide->get_bsdf_sampling_fraction();
+    const DTree& dtree = m_path_guide->get_dtree(vertex.get_point());
+
+    sampling_context.split_in_place(1, 1);
+    const float s = sampling_context.next2<float>();
+
+    if (s < bsdf_fraction)
+    {
+        vertex.m_bsdf->sample(
+            sampling_context,
+            vertex.m_bsdf_data,
+            Adjoint,
+            true,       // multiply by |cos(incoming, normal)|
+            vertex.m_scattering_modes,
+            sample);
+
+        bsdf_prob = sample.get_probability();
+
+        if (sample.get_mode() == ScatteringMode::None)
+            return true;
+
+        // Dirac deltas can only be sampled from the BSDF.
+        if (bsdf_prob == BSDF::DiracDelta)
+        {
+            sample.m_value /= bsdf_fraction;
+            return true;
+        }
+
+        const float guide_prob = dtree.evaluate_pdf(sample.m_incoming.get_value());
+        sample.set_to_scattering(
+            sample.get_mode(),
+            m_path_guide->combine_pdfs(bsdf_prob, guide_prob));
+
+        return true;
+    }
+    else
+    {
+        sampling_context.split_in_place(2, 1);
+        const foundation::Vector2f s = sampling_context.next2<foundation::Vector2f>();
+
+        float guide_prob;
+        const foundation::Vector3f incoming = dtree.sample(s, guide_prob);
+
+        bsdf_prob =
+            vertex.m_bsdf->evaluate(
+                vertex.m_bsdf_data,
+                Adjoint,
+                true,   // multiply by |cos(incoming, normal)|
+                sample.m_geometric_normal,
+                sample.m_shading_basis,
+                sample.m_outgoing.get_value(),
+                incoming,
+                vertex.m_scattering_modes,
+                sample.m_value);
+
+        if (bsdf_prob == 0.0f)
+        {
+            sample.set_to_absorption();
+            return false;
+        }
+
+        // Classify the scattering event according to the dominant component of the BSDF.
+        const ScatteringMode::Mode mode =
+            foundation::max_value(sample.m_value.m_glossy) > foundation::max_value(sample.m_value.m_diffuse)
+                ? ScatteringMode::Glossy
+                : ScatteringMode::Diffuse;
+
+        sample.m_incoming = foundation::Dual3f(incoming);
+        sample.set_to_scattering(
+            mode,
+            m_path_guide->combine_pdfs(bsdf_prob, guide_prob));
+
+        return false;
+    }
+}
+
 template <typename PathVisitor, typename VolumeVisitor, bool Adjoint>
 bool PathTracer<PathVisitor, VolumeVisitor, Adjoint>::march(
     SamplingContext&            sampling_context,
@@ -817,50 +943,26 @@ bool PathTracer<PathVisitor, VolumeVisitor, Adjoint>::march(
             break;
         }
 
-        // Retrieve extinction spectrum.
-        const Spectrum& extinction_coef =
-            volume->extinction_coefficient(vertex.m_volume_data, volume_ray);
-
-        // Sample channel uniformly at random.
-        sampling_context.split_in_place(1, 1);
-        const float s = sampling_context.next2<float>();
-        const size_t channel = foundation::truncate<size_t>(s * Spectrum::size());
-        const bool extinction_is_null = extinction_coef[channel] < 1.0e-6f;
-
-        // Sample distance.
-        float distance_sample, distance_pdf;
-        if (extinction_is_null)
-        {
-            distance_sample = 0.0f;
-            distance_pdf = 0.0f;
-        }
-        else
-        {
-            sampling_context.split_in_place(1, 1);
-            distance_sample =
-                foundation::sample_exponential_distribution(
-                    sampling_context.next2<float>(),
-                    extinction_coef[channel]);
-            distance_pdf =
-                foundation::exponential_distribution_pdf(
-                    distance_sample,
-                    extinction_coef[channel]);
-        }
-
-        // Continue path tracing if sampled distance exceeds total length of the ray,
-        // otherwise process the scattering event.
-        if (extinction_is_null || volume_ray.m_tmax < distance_sample)
-        {
-            Spectrum transmission;
-            volume->evaluate_transmission(
+        // Sample the distance to the next scattering event.
+        float distance_sample;
+        Spectrum weight;
+        const bool scattered =
+            volume->sample_distance(
+                sampling_context,
                 vertex.m_volume_data,
                 volume_ray,
-                transmission);
-            vertex.m_throughput *= transmission;
-            vertex.m_throughput /=                       // equivalent to multiplying by MIS weight
-                foundation::average_value(transmission); // and then dividing by transmission[channel]
+                distance_sample,
+                weight);
+        vertex.m_throughput *= weight;
+
+        // Continue path tracing if the ray leaves the volume,
+        // otherwise process the scattering event.
+        if (!scattered)
             break;
-        }
+
+        // Terminate the path if no scattering happens.
+        if (foundation::is_zero(weight))
+            return false;
 
         //
         // Bounce.
@@ -879,47 +981,6 @@ bool PathTracer<PathVisitor, VolumeVisitor, Adjoint>::march(
         // Let the volume visitor handle the scattering event.
         m_volume_visitor.on_scatter(vertex);
 
-        // Retrieve scattering spectrum.
-        const Spectrum& scattering_coef =
-            volume->scattering_coefficient(vertex.m_volume_data, volume_ray);
-
-        // Evaluate transmission between the origin and the sampled distance.
-        Spectrum transmission;
-        volume->evaluate_transmission(
-            vertex.m_volume_data,
-            volume_ray,
-            distance_sample,
-            transmission);
-        
-        // Compute MIS weight.
-        // MIS terms are:
-        //  - scattering albedo,
-        //  - throughput of the entire path up to the sampled point.
-        // Reference: "Practical and Controllable Subsurface Scattering
-        // for Production Path Tracing", p. 1 [ACM 2016 Article].
-        float mis_weights_sum = 0.0f;
-        for (size_t i = 0, e = Spectrum::size(); i < e; ++i)
-        {
-            if (extinction_coef[i] > 1.0e-6f)
-            {
-                const float probability =
-                    foundation::exponential_distribution_pdf(
-                        distance_sample,
-                        extinction_coef[i]);
-                mis_weights_sum += foundation::square(probability);
-            }
-        }
-        if (mis_weights_sum < 1.0e-6f)
-            return false;  // no scattering
-        const float current_mis_weight =
-            Spectrum::size() *
-            foundation::square(distance_pdf) /
-            mis_weights_sum;
-
-        vertex.m_throughput *= scattering_coef;
-        vertex.m_throughput *= transmission;
-        vertex.m_throughput *= current_mis_weight / distance_pdf;
-
         // Sample phase function.
         foundation::Vector3f incoming;
         const float pdf = volume->sample(
@@ -963,7 +1024,7 @@ bool PathTracer<PathVisitor, VolumeVisitor, Adjoint>::march(
 template<typename PathVisitor, typename VolumeVisitor, bool Adjoint>
 inline const ShadingPoint& PathTracer<PathVisitor, VolumeVisitor, Adjoint>::get_path_vertex(const size_t i) const
 {
-    return reinterpret_cast<const ShadingPoint*>(m_shading_point_arena.get_storage())[i];
+    return m_shading_point_arena.get_object<ShadingPoint>(i);
 }
 
 }   // namespace renderer
@@ -38,8 +38,10 @@
 #include "renderer/kernel/lighting/imagebasedlighting.h"
 #include "renderer/kernel/lighting/lightpathrecorder.h"
 #include "renderer/kernel/lighting/lightpathstream.h"
+#include "renderer/kernel/lighting/pathguide.h"
 #include "renderer/kernel/lighting/pathtracer.h"
 #include "renderer/kernel/lighting/pathvertex.h"
+#include "renderer/kernel/lighting/pt/ptpasscallback.h"
 #include "renderer/kernel/lighting/scatteringmode.h"
 #include "renderer/kernel/lighting/volumelightingintegrator.h"
 #include "renderer/kernel/shading/shadingcomponents.h"
@@ -67,6 +69,7 @@
 #include <cassert>
 #include <cstddef>
 #include <limits>
+#include <memory>
 #include <string>
 
 // Forward declarations.
@@ -99,6 +102,7 @@ namespace
         PTLightingEngine(
             const BackwardLightSampler&     light_sampler,
             LightPathRecorder&              light_path_recorder,
+            PTPassCallback*                 pass_callback,
             const ParamArray&               params)
           : m_params(params)
           , m_light_sampler(light_sampler)
@@ -109,6 +113,13 @@ namespace
           , m_path_count(0)
           , m_inf_volume_ray_warnings(0)
         {
+            if (pass_callback != nullptr)
+            {
+                m_path_guide.reset(
+                    new PathGuide(
+                        pass_callback->get_sd_tree(),
+                        pass_callback->get_bsdf_sampling_fraction()));
+            }
         }
 
         void release() override
@@ -136,7 +147,8 @@ namespace
                 "  max ray intensity             %s\n"
                 "  volume distance samples       %s\n"
                 "  equiangular sampling          %s\n"
-                "  clamp roughness               %s",
+                "  clamp roughness               %s\n"
+                "  path guiding                  %s",
                 m_params.m_enable_dl ? "on" : "off",
                 m_params.m_enable_ibl ? "on" : "off",
                 m_params.m_enable_caustics ? "on" : "off",
@@ -153,7 +165,8 @@ namespace
                 m_params.m_has_max_ray_intensity ? pretty_scalar(m_params.m_max_ray_intensity).c_str() : "unlimited",
                 pretty_int(m_params.m_distance_sample_count).c_str(),
                 m_params.m_enable_equiangular_sampling ? "on" : "off",
-                m_params.m_clamp_roughness ? "on" : "off");
+                m_params.m_clamp_roughness ? "on" : "off",
+                m_path_guide ? "on" : "off");
         }
 
         void compute_lighting(
@@ -232,7 +245,12 @@ namespace
                 m_params.m_max_specular_bounces,
                 m_params.m_max_volume_bounces,
                 m_params.m_clamp_roughness,
-                shading_context.get_max_iterations());
+                shading_context.get_max_iterations(),
+                0.0,
+                m_path_guide.get());
+
+            if (m_path_guide)
+                m_path_guide->begin_path(radiance.m_beauty);
 
             const size_t path_length =
                 path_tracer.trace(
@@ -240,6 +258,9 @@ namespace
                     shading_context,
                     shading_point);
 
+            if (m_path_guide)
+                m_path_guide->end_path();
+
             // Update statistics.
             ++m_path_count;
             m_path_length.insert(path_length);
@@ -334,6 +355,7 @@ namespace
         const Parameters                m_params;
         const BackwardLightSampler&     m_light_sampler;
         LightPathStream*                m_light_path_stream;
+        std::unique_ptr<PathGuide>      m_path_guide;
 
         uint64                          m_path_count;
         Population<uint64>              m_path_length;
@@ -1218,15 +1240,63 @@ Dictionary PTLightingEngineFactory::get_params_metadata()
             .insert("label", "Record Light Paths")
             .insert("help", "Record light paths in memory to later allow visualizing them or saving them to disk"));
 
+    metadata.dictionaries().insert(
+        "enable_path_guiding",
+        Dictionary()
+            .insert("type", "bool")
+            .insert("default", "false")
+            .insert("label", "Enable Path Guiding")
+            .insert("help", "Learn the incident radiance during the first passes and use it to guide paths (final renders only)"));
+
+    metadata.dictionaries().insert(
+        "path_guiding_training_passes",
+        Dictionary()
+            .insert("type", "int")
+            .insert("default", "4")
+            .insert("min", "1")
+            .insert("label", "Path Guiding Training Passes")
+            .insert("help", "Number of passes during which the incident radiance is learned"));
+
+    metadata.dictionaries().insert(
+        "path_guiding_bsdf_sampling_fraction",
+        Dictionary()
+            .insert("type", "float")
+            .insert("default", "0.5")
+            .insert("min", "0.05")
+            .insert("max", "1.0")
+            .insert("label", "Path Guiding BSDF Sampling Fraction")
+            .insert("help", "Probability of sampling the BSDF rather than the learned incident radiance"));
+
+    metadata.dictionaries().insert(
+        "path_guiding_spatial_threshold",
+        Dictionary()
+            .insert("type", "int")
+            .insert("default", "12000")
+            .insert("min", "1")
+            .insert("label", "Path Guiding Spatial Threshold")
+            .insert("help", "Number of samples above which a region of the scene is subdivided"));
+
+    metadata.dictionaries().insert(
+        "path_guiding_directional_threshold",
+        Dictionary()
+            .insert("type", "float")
+            .insert("default", "0.01")
+            .insert("min", "0.0")
+            .insert("max", "1.0")
+            .insert("label", "Path Guiding Directional Threshold")
+            .insert("help", "Fraction of the incident radiance above which a set of directions is subdivided"));
+
     return metadata;
 }
 
 PTLightingEngineFactory::PTLightingEngineFactory(
     const BackwardLightSampler&     light_sampler,
     LightPathRecorder&              light_path_recorder,
+    PTPassCallback*                 pass_callback,
     const ParamArray&               params)
   : m_light_sampler(light_sampler)
   , m_light_path_recorder(light_path_recorder)
+  , m_pass_callback(pass_callback)
   , m_params(params)
 {
 }
@@ -1242,6 +1312,7 @@ ILightingEngine* PTLightingEngineFactory::create()
         new PTLightingEngine(
             m_light_sampler,
             m_light_path_recorder,
+            m_pass_callback,
             m_params);
 }
 
@@ -40,6 +40,7 @@
 namespace foundation    { class Dictionary; }
 namespace renderer      { class BackwardLightSampler; }
 namespace renderer      { class LightPathRecorder; }
+namespace renderer      { class PTPassCallback; }
 
 namespace renderer
 {
@@ -59,6 +60,7 @@ class PTLightingEngineFactory
     PTLightingEngineFactory(
         const BackwardLightSampler&     light_sampler,
         LightPathRecorder&              light_path_recorder,
+        PTPassCallback*                 pass_callback,              // may be nullptr
         const ParamArray&               params);
 
     // Delete this instance.
@@ -70,6 +72,7 @@ class PTLightingEngineFactory
   private:
     const BackwardLightSampler&         m_light_sampler;
     LightPathRecorder&                  m_light_path_recorder;
+    PTPassCallback*                     m_pass_callback;
     ParamArray                          m_params;
 };
 
@@ -0,0 +1,135 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "ptpasscallback.h"
+
+// appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/lighting/pathguide.h"
+#include "renderer/modeling/scene/scene.h"
+#include "renderer/utility/paramarray.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/job/iabortswitch.h"
+#include "foundation/utility/string.h"
+
+// Standard headers.
+#include <algorithm>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+namespace
+{
+    AABB3f compute_sd_tree_bbox(const Scene& scene)
+    {
+        AABB3f bbox(scene.compute_bbox());
+
+        if (!bbox.is_valid())
+            return AABB3f(Vector3f(-1.0f), Vector3f(1.0f));
+
+        // Make sure points on the boundary of the scene fall inside the SD-tree.
+        bbox.robust_grow(1.0e-4f);
+
+        return bbox;
+    }
+}
+
+
+//
+// PTPassCallback class implementation.
+//
+
+PTPassCallback::PTPassCallback(
+    const Scene&            scene,
+    const ParamArray&       params)
+  : m_training_pass_count(params.get_optional<size_t>("path_guiding_training_passes", 4))
+  , m_spatial_threshold(max<size_t>(params.get_optional<size_t>("path_guiding_spatial_threshold", 12000), 1))
+  , m_directional_threshold(params.get_optional<float>("path_guiding_directional_threshold", 0.01f))
+  , m_max_directional_depth(params.get_optional<size_t>("path_guiding_max_directional_depth", 20))
+  , m_bsdf_sampling_fraction(
+        clamp(
+            params.get_optional<float>("path_guiding_bsdf_sampling_fraction", 0.5f),
+            PathGuideMinBSDFSamplingFraction,
+            1.0f))
+  , m_sd_tree(compute_sd_tree_bbox(scene))
+  , m_pass_number(0)
+{
+}
+
+void PTPassCallback::release()
+{
+    delete this;
+}
+
+void PTPassCallback::on_pass_begin(
+    const Frame&            frame,
+    JobQueue&               job_queue,
+    IAbortSwitch&           abort_switch)
+{
+    // Record incident radiance during the training passes only.
+    m_sd_tree.set_recording(m_pass_number < m_training_pass_count);
+
+    m_stopwatch.start();
+}
+
+void PTPassCallback::on_pass_end(
+    const Frame&            frame,
+    JobQueue&               job_queue,
+    IAbortSwitch&           abort_switch)
+{
+    if (m_sd_tree.is_recording() && !abort_switch.is_aborted())
+    {
+        m_sd_tree.set_recording(false);
+        m_sd_tree.build(
+            m_spatial_threshold,
+            m_directional_threshold,
+            m_max_directional_depth);
+
+        m_stopwatch.measure();
+
+        RENDERER_LOG_INFO(
+            "path guiding training pass %s completed in %s, sd-tree has %s %s.",
+            pretty_uint(m_pass_number + 1).c_str(),
+            pretty_time(m_stopwatch.get_seconds()).c_str(),
+            pretty_uint(m_sd_tree.get_leaf_count()).c_str(),
+            plural(m_sd_tree.get_leaf_count(), "leaf", "leaves").c_str());
+    }
+
+    ++m_pass_number;
+}
+
+}   // namespace renderer
@@ -0,0 +1,443 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "sdtree.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/scalar.h"
+#include "foundation/platform/atomic.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+namespace
+{
+    // Largest float value strictly smaller than 1.
+    const float OneMinusEpsilon = 0.99999994f;
+
+    // Return the quadrant of the unit square containing a given point,
+    // and remap the point to the unit square of this quadrant.
+    inline size_t select_quadrant(Vector2f& p)
+    {
+        const size_t qx = p[0] >= 0.5f ? 1 : 0;
+        const size_t qy = p[1] >= 0.5f ? 1 : 0;
+
+        p[0] = 2.0f * p[0] - static_cast<float>(qx);
+        p[1] = 2.0f * p[1] - static_cast<float>(qy);
+
+        return qx + 2 * qy;
+    }
+}
+
+
+//
+// DTree class implementation.
+//
+
+DTree::Node::Node()
+{
+    for (size_t i = 0; i < 4; ++i)
+    {
+        m_sums[i] = 0.0f;
+        m_children[i] = 0;
+    }
+}
+
+DTree::DTree()
+  : m_nodes(1)
+  , m_sample_count(0)
+{
+}
+
+void DTree::record(
+    const Vector3f&     direction,
+    const float         radiance)
+{
+    Vector2f p = direction_to_square(direction);
+    size_t index = 0;
+
+    while (true)
+    {
+        Node& node = m_nodes[index];
+        const size_t q = select_quadrant(p);
+
+        atomic_add(&node.m_sums[q], radiance);
+
+        if (node.m_children[q] == 0)
+            break;
+
+        index = node.m_children[q];
+    }
+
+    atomic_inc(&m_sample_count);
+}
+
+size_t DTree::get_depth() const
+{
+    vector<pair<uint32, size_t>> stack;
+    stack.emplace_back(0, 1);
+
+    size_t depth = 0;
+
+    while (!stack.empty())
+    {
+        const pair<uint32, size_t> entry = stack.back();
+        stack.pop_back();
+
+        depth = max(depth, entry.second);
+
+        const Node& node = m_nodes[entry.first];
+        for (size_t q = 0; q < 4; ++q)
+        {
+            if (node.m_children[q] != 0)
+                stack.emplace_back(node.m_children[q], entry.second + 1);
+        }
+    }
+
+    return depth;
+}
+
+Vector3f DTree::sample(
+    Vector2f            s,
+    float&              pdf) const
+{
+    if (!(get_sum() > 0.0f))
+    {
+        pdf = RcpFourPi<float>();
+        return square_to_direction(s);
+    }
+
+    Vector2f origin(0.0f);
+    float size = 1.0f;
+    size_t index = 0;
+
+    pdf = 1.0f;
+
+    while (true)
+    {
+        const Node& node = m_nodes[index];
+        const float total = node.get_sum();
+        assert(total > 0.0f);
+
+        // Choose the left or the right half of the node.
+        const float px = (node.m_sums[0] + node.m_sums[2]) / total;
+        size_t qx;
+        if (s[0] < px)
+        {
+            qx = 0;
+            s[0] /= px;
+        }
+        else
+        {
+            qx = 1;
+            s[0] = (s[0] - px) / (1.0f - px);
+        }
+
+        // Choose the bottom or the top quadrant of this half.
+        const float bottom = node.m_sums[qx];
+        const float py = bottom / (bottom + node.m_sums[qx + 2]);
+        size_t qy;
+        if (s[1] < py)
+        {
+            qy = 0;
+            s[1] /= py;
+        }
+        else
+        {
+            qy = 1;
+            s[1] = (s[1] - py) / (1.0f - py);
+        }
+
+        s[0] = min(s[0], OneMinusEpsilon);
+        s[1] = min(s[1], OneMinusEpsilon);
+
+        const size_t q = qx + 2 * qy;
+        pdf *= 4.0f * node.m_sums[q] / total;
+
+        size *= 0.5f;
+        origin[0] += size * static_cast<float>(qx);
+        origin[1] += size * static_cast<float>(qy);
+
+        if (node.m_children[q] == 0)
+            break;
+
+        index = node.m_children[q];
+    }
+
+    pdf *= RcpFourPi<float>();
+
+    return square_to_direction(origin + size * s);
+}
+
+float DTree::evaluate_pdf(const Vector3f& direction) const
+{
+    if (!(get_sum() > 0.0f))
+        return RcpFourPi<float>();
+
+    Vector2f p = direction_to_square(direction);
+    size_t index = 0;
+    float pdf = 1.0f;
+
+    while (true)
+    {
+        const Node& node = m_nodes[index];
+        const size_t q = select_quadrant(p);
+
+        if (!(node.m_sums[q] > 0.0f))
+            return 0.0f;
+
+        pdf *= 4.0f * node.m_sums[q] / node.get_sum();
+
+        if (node.m_children[q] == 0)
+            break;
+
+        index = node.m_children[q];
+    }
+
+    return pdf * RcpFourPi<float>();
+}
+
+void DTree::refine(
+    const DTree&        source,
+    const float         threshold,
+    const size_t        max_depth)
+{
+    m_nodes.assign(1, Node());
+    m_sample_count = 0;
+
+    const float total = source.get_sum();
+    if (!(total > 0.0f))
+        return;
+
+    // Nodes of the source tree that are leaves are assumed to hold uniform radiance.
+    const uint32 NoSource = ~uint32(0);
+
+    struct Entry
+    {
+        uint32  m_node;
+        uint32  m_source;
+        float   m_fraction;
+        size_t  m_depth;
+    };
+
+    vector<Entry> stack;
+    const Entry root = { 0, 0, 1.0f, 1 };
+    stack.push_back(root);
+
+    while (!stack.empty())
+    {
+        const Entry entry = stack.back();
+        stack.pop_back();
+
+        if (entry.m_depth >= max_depth)
+            continue;
+
+        for (size_t q = 0; q < 4; ++q)
+        {
+            float fraction;
+            uint32 source_child;
+
+            if (entry.m_source != NoSource)
+            {
+                const Node& source_node = source.m_nodes[entry.m_source];
+                fraction = source_node.m_sums[q] / total;
+                source_child = source_node.m_children[q] != 0 ? source_node.m_children[q] : NoSource;
+            }
+            else
+            {
+                fraction = 0.25f * entry.m_fraction;
+                source_child = NoSource;
+            }
+
+            if (fraction > threshold)
+            {
+                const uint32 child = static_cast<uint32>(m_nodes.size());
+                m_nodes.push_back(Node());
+                m_nodes[entry.m_node].m_children[q] = child;
+
+                const Entry child_entry = { child, source_child, fraction, entry.m_depth + 1 };
+                stack.push_back(child_entry);
+            }
+        }
+    }
+}
+
+void DTree::scale_sample_count(const float factor)
+{
+    m_sample_count = static_cast<uint32>(m_sample_count * factor);
+}
+
+Vector2f DTree::direction_to_square(const Vector3f& direction)
+{
+    const float cos_theta = clamp(direction[2], -1.0f, 1.0f);
+
+    float phi = atan2(direction[1], direction[0]);
+    if (phi < 0.0f)
+        phi += TwoPi<float>();
+
+    return
+        Vector2f(
+            min(0.5f * (cos_theta + 1.0f), OneMinusEpsilon),
+            min(phi * RcpTwoPi<float>(), OneMinusEpsilon));
+}
+
+Vector3f DTree::square_to_direction(const Vector2f& point)
+{
+    const float cos_theta = 2.0f * point[0] - 1.0f;
+    const float sin_theta = sqrt(max(1.0f - cos_theta * cos_theta, 0.0f));
+    const float phi = TwoPi<float>() * point[1];
+
+    return
+        Vector3f(
+            sin_theta * cos(phi),
+            sin_theta * sin(phi),
+            cos_theta);
+}
+
+
+//
+// SDTree class implementation.
+//
+
+namespace
+{
+    Vector3f compute_rcp_extent(const AABB3f& bbox)
+    {
+        const Vector3f extent = bbox.extent();
+
+        return
+            Vector3f(
+                extent[0] > 0.0f ? 1.0f / extent[0] : 0.0f,
+                extent[1] > 0.0f ? 1.0f / extent[1] : 0.0f,
+                extent[2] > 0.0f ? 1.0f / extent[2] : 0.0f);
+    }
+}
+
+SDTree::SDTree(const AABB3f& bbox)
+  : m_bbox(bbox)
+  , m_rcp_extent(compute_rcp_extent(bbox))
+  , m_dtrees(1)
+  , m_iteration_count(0)
+  , m_recording(false)
+{
+    const Node root = { 0, 0, 0 };
+    m_nodes.push_back(root);
+}
+
+size_t SDTree::find_leaf(const Vector3f& point) const
+{
+    Vector3f p = (point - m_bbox.min) * m_rcp_extent;
+    size_t index = 0;
+
+    while (true)
+    {
+        const Node& node = m_nodes[index];
+
+        if (node.m_child == 0)
+            return index;
+
+        const size_t axis = node.m_axis;
+
+        if (p[axis] < 0.5f)
+        {
+            p[axis] = 2.0f * p[axis];
+            index = node.m_child;
+        }
+        else
+        {
+            p[axis] = 2.0f * p[axis] - 1.0f;
+            index = node.m_child + 1;
+        }
+    }
+}
+
+void SDTree::build(
+    const size_t        spatial_threshold,
+    const float         directional_threshold,
+    const size_t        max_directional_depth)
+{
+    assert(spatial_threshold > 0);
+
+    // Split the leaves that received too many samples. Children are visited
+    // as they are created since they may need to be split again.
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        if (m_nodes[i].m_child != 0)
+            continue;
+
+        const uint32 dtrees = m_nodes[i].m_dtrees;
+        DTree& building = m_dtrees[dtrees].m_building;
+
+        if (building.get_sample_count() <= spatial_threshold)
+            continue;
+
+        // Both children inherit the radiance recorded in the parent and half of its samples.
+        building.scale_sample_count(0.5f);
+        const DTreePair copy = m_dtrees[dtrees];
+        m_dtrees.push_back(copy);
+
+        const uint32 child_axis = (m_nodes[i].m_axis + 1) % 3;
+        const Node child0 = { 0, child_axis, dtrees };
+        const Node child1 = { 0, child_axis, static_cast<uint32>(m_dtrees.size() - 1) };
+
+        m_nodes[i].m_child = static_cast<uint32>(m_nodes.size());
+        m_nodes.push_back(child0);
+        m_nodes.push_back(child1);
+    }
+
+    // The recorded radiance becomes the sampling distribution, and a new distribution
+    // is recorded in a tree adapted to it. Leaves that received no sample in this
+    // iteration keep the distribution learned previously.
+    for (size_t i = 0, e = m_dtrees.size(); i < e; ++i)
+    {
+        DTreePair& dtrees = m_dtrees[i];
+
+        if (dtrees.m_building.get_sample_count() == 0)
+            continue;
+
+        swap(dtrees.m_sampling, dtrees.m_building);
+        dtrees.m_building.refine(
+            dtrees.m_sampling,
+            directional_threshold,
+            max_directional_depth);
+    }
+
+    ++m_iteration_count;
+}
+
+}   // namespace renderer
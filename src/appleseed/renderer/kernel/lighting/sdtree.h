@@ -0,0 +1,258 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+namespace renderer
+{
+
+//
+// A quadtree over the unit square storing the radiance incident at a point of the scene.
+//
+// Directions are mapped to the unit square with the area-preserving cylindrical mapping
+// (cos(theta), phi). Each node stores the radiance recorded in each of its four quadrants.
+// Sampling and evaluating the probability density of a direction are proportional to the
+// radiance recorded in the leaf containing this direction, divided by the area of the leaf.
+// A tree that recorded no radiance represents the uniform distribution over the sphere.
+//
+
+class DTree
+{
+  public:
+    // Constructor, creates a tree made of a single leaf.
+    DTree();
+
+    // Record radiance incident from a given direction. Thread-safe.
+    void record(
+        const foundation::Vector3f& direction,              // unit-length
+        const float                 radiance);
+
+    // Return the number of recorded samples.
+    size_t get_sample_count() const;
+
+    // Return the total recorded radiance.
+    float get_sum() const;
+
+    // Return the number of nodes in the tree.
+    size_t get_node_count() const;
+
+    // Return the depth of the tree (a tree made of a single leaf has depth 1).
+    size_t get_depth() const;
+
+    // Sample a direction proportionally to the recorded radiance.
+    foundation::Vector3f sample(
+        foundation::Vector2f        s,                      // sample in [0,1)^2
+        float&                      pdf) const;             // probability density with respect to solid angle
+
+    // Evaluate the probability density of a given direction, with respect to solid angle.
+    float evaluate_pdf(const foundation::Vector3f& direction) const;
+
+    // Replace this tree by an empty tree whose structure adapts to the radiance recorded in
+    // another tree: quadrants holding more than a given fraction of the total radiance are
+    // subdivided, up to a maximum depth.
+    void refine(
+        const DTree&                source,
+        const float                 threshold,
+        const size_t                max_depth);
+
+    // Scale the number of recorded samples.
+    void scale_sample_count(const float factor);
+
+    // Map a direction to the unit square and back.
+    static foundation::Vector2f direction_to_square(const foundation::Vector3f& direction);
+    static foundation::Vector3f square_to_direction(const foundation::Vector2f& point);
+
+  private:
+    struct Node
+    {
+        float               m_sums[4];                      // recorded radiance in each quadrant
+        foundation::uint32  m_children[4];                  // index of the child node of each quadrant, 0 for leaves
+
+        Node();
+
+        float get_sum() const;
+    };
+
+    std::vector<Node>       m_nodes;
+    foundation::uint32      m_sample_count;
+};
+
+
+//
+// A spatial binary tree (SD-tree) whose leaves hold the distribution of incident radiance
+// in the corresponding region of the scene. It is trained iteratively: during an iteration,
+// radiance is recorded into the leaves while directions are sampled from the distributions
+// learned during the previous iteration, which are read-only. At the end of an iteration,
+// leaves that received many samples are split and the recorded radiance becomes the new
+// sampling distribution.
+//
+// Reference:
+//
+//   Practical Path Guiding for Efficient Light-Transport Simulation
+//   Thomas Mueller, Markus Gross, Jan Novak
+//   Computer Graphics Forum 36 (4), EGSR 2017
+//
+
+class SDTree
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor.
+    explicit SDTree(const foundation::AABB3f& bbox);
+
+    // Return the number of completed training iterations.
+    size_t get_iteration_count() const;
+
+    // Return true if at least one training iteration was completed.
+    bool is_built() const;
+
+    // Enable or disable the recording of radiance.
+    void set_recording(const bool recording);
+    bool is_recording() const;
+
+    // Return the number of leaves in the spatial tree.
+    size_t get_leaf_count() const;
+
+    // Return the distribution learned during the last training iteration at a given point.
+    const DTree& get_sampling_dtree(const foundation::Vector3f& point) const;
+
+    // Record radiance incident at a given point from a given direction. Thread-safe.
+    void record(
+        const foundation::Vector3f& point,
+        const foundation::Vector3f& direction,
+        const float                 radiance);
+
+    // Complete a training iteration. Not thread-safe.
+    void build(
+        const size_t                spatial_threshold,      // number of samples above which a leaf is split
+        const float                 directional_threshold,  // fraction of radiance above which a quadrant is subdivided
+        const size_t                max_directional_depth);
+
+  private:
+    struct Node
+    {
+        foundation::uint32  m_child;                        // index of the first child, 0 for leaves
+        foundation::uint32  m_axis;                         // splitting axis
+        foundation::uint32  m_dtrees;                       // index of the directional trees of leaves
+    };
+
+    struct DTreePair
+    {
+        DTree               m_sampling;                     // distribution learned during the last iteration
+        DTree               m_building;                     // distribution being recorded
+    };
+
+    const foundation::AABB3f    m_bbox;
+    const foundation::Vector3f  m_rcp_extent;
+    std::vector<Node>           m_nodes;
+    std::vector<DTreePair>      m_dtrees;
+    size_t                      m_iteration_count;
+    bool                        m_recording;
+
+    size_t find_leaf(const foundation::Vector3f& point) const;
+};
+
+
+//
+// DTree class implementation.
+//
+
+inline size_t DTree::get_sample_count() const
+{
+    return m_sample_count;
+}
+
+inline float DTree::get_sum() const
+{
+    return m_nodes[0].get_sum();
+}
+
+inline size_t DTree::get_node_count() const
+{
+    return m_nodes.size();
+}
+
+inline float DTree::Node::get_sum() const
+{
+    return m_sums[0] + m_sums[1] + m_sums[2] + m_sums[3];
+}
+
+
+//
+// SDTree class implementation.
+//
+
+inline size_t SDTree::get_iteration_count() const
+{
+    return m_iteration_count;
+}
+
+inline bool SDTree::is_built() const
+{
+    return m_iteration_count > 0;
+}
+
+inline void SDTree::set_recording(const bool recording)
+{
+    m_recording = recording;
+}
+
+inline bool SDTree::is_recording() const
+{
+    return m_recording;
+}
+
+inline size_t SDTree::get_leaf_count() const
+{
+    return m_dtrees.size();
+}
+
+inline const DTree& SDTree::get_sampling_dtree(const foundation::Vector3f& point) const
+{
+    return m_dtrees[m_nodes[find_leaf(point)].m_dtrees].m_sampling;
+}
+
+inline void SDTree::record(
+    const foundation::Vector3f&     point,
+    const foundation::Vector3f&     direction,
+    const float                     radiance)
+{
+    m_dtrees[m_nodes[find_leaf(point)].m_dtrees].m_building.record(direction, radiance);
+}
+
+}   // namespace renderer
@@ -58,6 +58,7 @@ struct SPPMParameters
     const size_t                m_light_photon_count;                   // number of photons emitted from the lights
     const size_t                m_env_photon_count;                     // number of photons emitted from the environment
     const size_t                m_photon_packet_size;                   // number of photons per tracing job
+    const size_t                m_thread_count;                         // number of threads building the photon map
 
     const size_t                m_photon_tracing_max_bounces;           // maximum number of photon bounces, ~0 for unlimited
     const size_t                m_photon_tracing_rr_min_path_length;    // minimum photon tracing path length before Russian Roulette kicks in, ~0 for unlimited
@@ -122,7 +122,7 @@ void SPPMPassCallback::on_pass_begin(
         return;
 
     // Build a new photon map.
-    m_photon_map.reset(new SPPMPhotonMap(m_photons));
+    m_photon_map.reset(new SPPMPhotonMap(m_photons, job_queue, m_params.m_thread_count));
 }
 
 void SPPMPassCallback::on_pass_end(
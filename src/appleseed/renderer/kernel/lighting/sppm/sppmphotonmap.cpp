@@ -36,6 +36,7 @@
 
 // appleseed.foundation headers.
 #include "foundation/platform/defaulttimers.h"
+#include "foundation/utility/job/jobqueue.h"
 #include "foundation/utility/statistics.h"
 #include "foundation/utility/string.h"
 
@@ -48,7 +49,16 @@ using namespace foundation;
 namespace renderer
 {
 
-SPPMPhotonMap::SPPMPhotonMap(SPPMPhotonVector& photons)
+namespace
+{
+    // Number of subtrees and partitioning jobs per photon map build thread.
+    const size_t JobsPerBuildThread = 4;
+}
+
+SPPMPhotonMap::SPPMPhotonMap(
+    SPPMPhotonVector&   photons,
+    JobQueue&           job_queue,
+    const size_t        thread_count)
 {
     const size_t photon_count = photons.size();
 
@@ -59,8 +69,11 @@ SPPMPhotonMap::SPPMPhotonMap(SPPMPhotonVector& photons)
             pretty_uint(photon_count).c_str(),
             photon_count > 1 ? "photons" : "photon");
 
-        knn::Builder3f builder(*this);
-        builder.build_move_points<DefaultWallclockTimer>(photons.m_positions);
+        knn::ParallelBuilder3f builder(*this);
+        builder.build_move_points<DefaultWallclockTimer>(
+            photons.m_positions,
+            job_queue,
+            JobsPerBuildThread * thread_count);
 
         Statistics statistics;
         statistics.insert_time("build time", builder.get_build_time());
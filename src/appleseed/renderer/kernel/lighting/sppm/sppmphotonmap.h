@@ -32,8 +32,12 @@
 // appleseed.foundation headers.
 #include "foundation/math/knn.h"
 
+// Standard headers.
+#include <cstddef>
+
 // Forward declarations.
-namespace renderer  { class SPPMPhotonVector; }
+namespace foundation    { class JobQueue; }
+namespace renderer      { class SPPMPhotonVector; }
 
 namespace renderer
 {
@@ -43,7 +47,11 @@ class SPPMPhotonMap
 {
   public:
     // Constructor, *moves* the photon positions into the map.
-    explicit SPPMPhotonMap(SPPMPhotonVector& photons);
+    // The map is built in parallel by jobs scheduled into the job queue.
+    SPPMPhotonMap(
+        SPPMPhotonVector&       photons,
+        foundation::JobQueue&   job_queue,
+        const size_t            thread_count);
 };
 
 }   // namespace renderer
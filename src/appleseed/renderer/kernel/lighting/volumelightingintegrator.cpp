@@ -263,7 +263,8 @@ void VolumeLightingIntegrator::add_single_distance_sample_contribution(
             inscattered);
 
         Spectrum transmission;
-        m_volume.evaluate_transmission(
+        m_volume.estimate_transmission(
+            sampling_context,
             m_volume_data,
             m_volume_ray,
             exponential_sample,
@@ -303,8 +304,8 @@ void VolumeLightingIntegrator::add_single_distance_sample_contribution(
             mis_heuristic, equiangular_prob, exponential_prob);
 
         Spectrum transmission;
-        m_volume.evaluate_transmission(
-            m_volume_data, m_volume_ray, equiangular_sample, transmission);
+        m_volume.estimate_transmission(
+            sampling_context, m_volume_data, m_volume_ray, equiangular_sample, transmission);
         inscattered *= transmission;
         inscattered *=
             m_rcp_distance_sample_count *
@@ -359,7 +360,8 @@ void VolumeLightingIntegrator::add_single_distance_sample_contribution_exponenti
         inscattered);
 
     Spectrum transmission;
-    m_volume.evaluate_transmission(
+    m_volume.estimate_transmission(
+        sampling_context,
         m_volume_data,
         m_volume_ray,
         exponential_sample,
@@ -57,6 +57,10 @@ namespace renderer
 // Combines exponential importance sampling (based on Beer's law) and
 // equiangular sampling (based on proximity to light sources).
 //
+// In heterogeneous media, exponential sampling relies on a representative extinction
+// coefficient along the ray, and the transmission to each distance sample is estimated
+// by the volume itself, for instance using ratio tracking.
+//
 // For more information:
 //
 //   Importance Sampling Techniques for Path Tracing in Participating Media
@@ -0,0 +1,206 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "convergencemap.h"
+
+// appleseed.renderer headers.
+#include "renderer/kernel/rendering/sample.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/color.h"
+#include "foundation/math/scalar.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+//
+// ConvergenceMap class implementation.
+//
+
+ConvergenceMap::ConvergenceMap(
+    const size_t        canvas_width,
+    const size_t        canvas_height,
+    const AABB2u&       crop_window,
+    const float         noise_threshold,
+    const size_t        min_samples_per_pixel,
+    const size_t        block_size)
+  : m_canvas_width(static_cast<float>(canvas_width))
+  , m_canvas_height(static_cast<float>(canvas_height))
+  , m_crop_window(crop_window)
+  , m_width(crop_window.extent(0))
+  , m_height(crop_window.extent(1))
+  , m_block_size(block_size)
+  , m_block_count_x((m_width + block_size - 1) / block_size)
+  , m_block_count_y((m_height + block_size - 1) / block_size)
+  , m_noise_threshold(noise_threshold)
+  , m_min_samples_per_pixel(static_cast<uint32>(max<size_t>(min_samples_per_pixel, 2)))
+  , m_pixels(m_width * m_height)
+  , m_converged_blocks(m_block_count_x * m_block_count_y)
+{
+    assert(block_size > 0);
+
+    clear();
+}
+
+void ConvergenceMap::clear()
+{
+    const Pixel EmptyPixel = { 0.0f, 0.0f, 0, 0 };
+    fill(m_pixels.begin(), m_pixels.end(), EmptyPixel);
+    fill(m_converged_blocks.begin(), m_converged_blocks.end(), 0);
+
+    m_sample_count = 0;
+    m_next_update_sample_count = 0;
+    m_converged_block_count = 0;
+}
+
+void ConvergenceMap::store_samples(
+    const size_t        sample_count,
+    const Sample        samples[])
+{
+    for (size_t i = 0; i < sample_count; ++i)
+    {
+        const Sample& sample = samples[i];
+
+        const size_t x = truncate<size_t>(sample.m_position.x * m_canvas_width);
+        const size_t y = truncate<size_t>(sample.m_position.y * m_canvas_height);
+
+        if (x < m_crop_window.min.x || x > m_crop_window.max.x ||
+            y < m_crop_window.min.y || y > m_crop_window.max.y)
+            continue;
+
+        Pixel& pixel = m_pixels[(y - m_crop_window.min.y) * m_width + (x - m_crop_window.min.x)];
+        const float value = sample.m_color.r + sample.m_color.g + sample.m_color.b;
+
+        atomic_add(&pixel.m_sum, value);
+
+        if (atomic_inc(&pixel.m_count) & 1)
+        {
+            atomic_add(&pixel.m_half_sum, value);
+            atomic_inc(&pixel.m_half_count);
+        }
+    }
+
+    m_sample_count += sample_count;
+}
+
+bool ConvergenceMap::update()
+{
+    if (is_converged())
+        return false;
+
+    // Only update once a fraction of a sample per pixel was recorded since the last update.
+    const uint64 sample_count = m_sample_count;
+    if (sample_count < m_next_update_sample_count)
+        return false;
+    m_next_update_sample_count = sample_count + max<size_t>(m_pixels.size() / 4, 1);
+
+    size_t converged_block_count = 0;
+
+    for (size_t by = 0; by < m_block_count_y; ++by)
+    {
+        for (size_t bx = 0; bx < m_block_count_x; ++bx)
+        {
+            uint32& converged = m_converged_blocks[by * m_block_count_x + bx];
+
+            if (atomic_read(&converged) == 0)
+            {
+                if (!has_block_converged(bx, by))
+                    continue;
+
+                atomic_write(&converged, 1);
+            }
+
+            ++converged_block_count;
+        }
+    }
+
+    m_converged_block_count = converged_block_count;
+
+    return is_converged();
+}
+
+bool ConvergenceMap::is_converged(const Vector2f& position) const
+{
+    const size_t x = truncate<size_t>(position.x * m_canvas_width);
+    const size_t y = truncate<size_t>(position.y * m_canvas_height);
+
+    if (x < m_crop_window.min.x || x > m_crop_window.max.x ||
+        y < m_crop_window.min.y || y > m_crop_window.max.y)
+        return true;
+
+    const size_t bx = (x - m_crop_window.min.x) / m_block_size;
+    const size_t by = (y - m_crop_window.min.y) / m_block_size;
+
+    return atomic_read(const_cast<uint32*>(&m_converged_blocks[by * m_block_count_x + bx])) != 0;
+}
+
+bool ConvergenceMap::has_block_converged(
+    const size_t        bx,
+    const size_t        by) const
+{
+    const size_t x0 = bx * m_block_size;
+    const size_t y0 = by * m_block_size;
+    const size_t x1 = min(x0 + m_block_size, m_width);
+    const size_t y1 = min(y0 + m_block_size, m_height);
+
+    for (size_t y = y0; y < y1; ++y)
+    {
+        for (size_t x = x0; x < x1; ++x)
+        {
+            const Pixel& pixel = m_pixels[y * m_width + x];
+
+            if (pixel.m_count < m_min_samples_per_pixel || pixel.m_half_count == 0)
+                return false;
+
+            const float main = pixel.m_sum / pixel.m_count;
+            const float second = pixel.m_half_sum / pixel.m_half_count;
+
+            if (main <= 0.0f)
+                continue;
+
+            // Same noise estimate as in the adaptive tile renderer.
+            const float error = abs(main - second) / sqrt(main);
+
+            if (error > m_noise_threshold)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+}   // namespace renderer
@@ -0,0 +1,148 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/atomic.h"
+#include "foundation/platform/types.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+// Forward declarations.
+namespace renderer  { class Sample; }
+
+namespace renderer
+{
+
+//
+// A map of the convergence of a progressively rendered frame, used for adaptive sampling.
+//
+// The crop window is divided into square blocks of pixels. For every pixel, the map keeps
+// the average of all the samples that fell into it and the average of every other sample.
+// The noise of a pixel is estimated from the difference between these two averages, like
+// the adaptive tile renderer does, and a block has converged when all its pixels received
+// a minimum number of samples and have a noise below a given threshold. Converged blocks
+// no longer need samples; once all blocks have converged, the frame has converged.
+//
+
+class ConvergenceMap
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor.
+    ConvergenceMap(
+        const size_t                canvas_width,
+        const size_t                canvas_height,
+        const foundation::AABB2u&   crop_window,
+        const float                 noise_threshold,
+        const size_t                min_samples_per_pixel,
+        const size_t                block_size = 16);
+
+    // Reset the map to its initial state. Not thread-safe.
+    void clear();
+
+    // Record a set of samples. Thread-safe and lock-free.
+    void store_samples(
+        const size_t                sample_count,
+        const Sample                samples[]);
+
+    // Update the convergence of the blocks if enough samples were recorded since the last
+    // update. Thread-safe with respect to all other methods but not to itself. Return true
+    // if the frame converged during this update.
+    bool update();
+
+    // Return true if the block containing a given position in NDC has converged. Thread-safe.
+    bool is_converged(const foundation::Vector2f& position) const;
+
+    // Return true if all blocks have converged. Thread-safe.
+    bool is_converged() const;
+
+    // Return the number of blocks, and the number of blocks that have converged.
+    size_t get_block_count() const;
+    size_t get_converged_block_count() const;
+
+  private:
+    struct Pixel
+    {
+        float                       m_sum;                      // sum of the samples, as the sum of their color components
+        float                       m_half_sum;                 // sum of every other sample
+        foundation::uint32          m_count;
+        foundation::uint32          m_half_count;
+    };
+
+    const float                     m_canvas_width;
+    const float                     m_canvas_height;
+    const foundation::AABB2u        m_crop_window;
+    const size_t                    m_width;                    // width of the crop window in pixels
+    const size_t                    m_height;                   // height of the crop window in pixels
+    const size_t                    m_block_size;
+    const size_t                    m_block_count_x;
+    const size_t                    m_block_count_y;
+    const float                     m_noise_threshold;
+    const foundation::uint32        m_min_samples_per_pixel;
+
+    std::vector<Pixel>              m_pixels;
+    std::vector<foundation::uint32> m_converged_blocks;         // nonzero for blocks that have converged
+    boost::atomic<foundation::uint64>
+                                    m_sample_count;
+    foundation::uint64              m_next_update_sample_count;
+    boost::atomic<size_t>           m_converged_block_count;
+
+    // Return true if a block, which hasn't converged yet, has now converged.
+    bool has_block_converged(
+        const size_t                bx,
+        const size_t                by) const;
+};
+
+
+//
+// ConvergenceMap class implementation.
+//
+
+inline bool ConvergenceMap::is_converged() const
+{
+    return m_converged_block_count == get_block_count();
+}
+
+inline size_t ConvergenceMap::get_block_count() const
+{
+    return m_block_count_x * m_block_count_y;
+}
+
+inline size_t ConvergenceMap::get_converged_block_count() const
+{
+    return m_converged_block_count;
+}
+
+}   // namespace renderer
@@ -52,6 +52,7 @@
 #include "foundation/math/aabb.h"
 #include "foundation/math/hash.h"
 #include "foundation/math/population.h"
+#include "foundation/math/qmc.h"
 #include "foundation/math/scalar.h"
 #include "foundation/math/vector.h"
 #include "foundation/platform/types.h"
@@ -156,7 +157,10 @@ namespace
                 // Create a sampling context.
                 const size_t frame_width = frame.image().properties().m_canvas_width;
                 const size_t pixel_index = pi.y * frame_width + pi.x;
-                const size_t instance = hash_uint32(static_cast<uint32>(pass_hash + pixel_index));
+                const size_t instance =
+                    m_params.m_sampling_mode == SamplingContext::SobolMode
+                        ? get_blue_noise_instance(pi, pass_hash)
+                        : hash_uint32(static_cast<uint32>(pass_hash + pixel_index));
                 SamplingContext::RNGType rng(pass_hash, instance);
                 SamplingContext sampling_context(
                     rng,
@@ -306,6 +310,34 @@ namespace
         const int                           m_sqrt_sample_count;
         PixelSampler                        m_pixel_sampler;
         Population<uint64>                  m_total_sampling_dim;
+
+        // In Sobol mode, all pixels of a given pass draw from the same sequence: each pixel
+        // renders an aligned block of samples whose position is given by the rank of the pixel
+        // in a blue noise mask. Pixels of consecutive ranks are well separated in screen space
+        // and their samples are stratified together, which distributes the error as blue noise.
+        size_t get_blue_noise_instance(
+            const Vector2i&             pi,
+            const uint32                pass_hash) const
+        {
+            const size_t x = static_cast<size_t>(pi.x);
+            const size_t y = static_cast<size_t>(pi.y);
+
+            // Each tile of the mask draws from a different part of the sequence.
+            const uint64 tile_seed =
+                mix_uint32(
+                    pass_hash,
+                    static_cast<uint32>(x / BlueNoiseMaskSize),
+                    static_cast<uint32>(y / BlueNoiseMaskSize));
+
+            const uint64 rank =
+                BlueNoiseMask[(y % BlueNoiseMaskSize) * BlueNoiseMaskSize + x % BlueNoiseMaskSize];
+
+            const uint64 block_size = next_pow2<uint64>(m_sample_count);
+
+            return
+                static_cast<size_t>(
+                    (tile_seed * (BlueNoiseMaskSize * BlueNoiseMaskSize) + rank) * block_size);
+        }
     };
 }
 
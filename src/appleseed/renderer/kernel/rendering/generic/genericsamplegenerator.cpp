@@ -168,6 +168,10 @@ namespace
                 (m_window_origin_x + t[0]) / m_canvas_width,
                 (m_window_origin_y + t[1]) / m_canvas_height);
 
+            // Don't render samples in regions of the frame that have converged.
+            if (has_converged(sample_position))
+                return 0;
+
             // Create a pixel context that identifies the pixel and sample currently being rendered.
             const PixelContext pixel_context(
                 Vector2i(m_window_origin_x + x, m_window_origin_y + y),
@@ -55,6 +55,7 @@
 #include "foundation/image/color.h"
 #include "foundation/image/image.h"
 #include "foundation/image/regularspectrum.h"
+#include "foundation/math/scalar.h"
 #include "foundation/math/vector.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/arena.h"
@@ -176,6 +177,16 @@ namespace
 
 #endif
 
+            // In hero mode, trace this camera path with a single set of hero wavelengths.
+            const bool hero_wavelengths = Spectrum::get_mode() == Spectrum::Hero;
+            if (hero_wavelengths)
+            {
+                sampling_context.split_in_place(1, 1);
+                const float s = sampling_context.next2<float>();
+                Spectrum::select_hero_wavelengths(
+                    truncate<size_t>(s * Spectrum::HeroSetCount));
+            }
+
             // Construct a primary ray.
             ShadingRay primary_ray;
             m_scene.get_active_camera()->spawn_ray(
@@ -269,6 +280,9 @@ namespace
             // Inform the AOV accumulators that we are done rendering a sample.
             aov_accumulators.on_sample_end(pixel_context);
 
+            if (hero_wavelengths)
+                Spectrum::select_all_wavelengths();
+
 #ifdef DEBUG_DISPLAY_TEXTURE_CACHE_PERFORMANCE
 
             const uint64 delta_hit_count = m_texture_cache.get_hit_count() - last_texture_cache_hit_count;
@@ -299,6 +313,7 @@ namespace
             stats.merge(m_texture_cache.get_statistics());
             stats.merge(m_intersector.get_statistics());
             stats.merge(m_lighting_engine->get_statistics());
+            stats.merge(m_shading_context.get_statistics());
             return stats;
         }
 
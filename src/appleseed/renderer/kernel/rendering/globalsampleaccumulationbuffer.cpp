@@ -40,11 +40,9 @@
 #include "foundation/image/image.h"
 #include "foundation/image/pixel.h"
 #include "foundation/image/tile.h"
+#include "foundation/platform/thread.h"
 #include "foundation/utility/job/iabortswitch.h"
 
-// Boost headers.
-#include "boost/chrono/duration.hpp"
-
 using namespace foundation;
 using namespace std;
 
@@ -63,7 +61,7 @@ GlobalSampleAccumulationBuffer::GlobalSampleAccumulationBuffer(
 void GlobalSampleAccumulationBuffer::clear()
 {
     // Request exclusive access.
-    boost::unique_lock<boost::shared_mutex> lock(m_mutex);
+    boost::mutex::scoped_lock lock(m_mutex);
 
     m_sample_count = 0;
 
@@ -75,16 +73,7 @@ void GlobalSampleAccumulationBuffer::store_samples(
     const Sample    samples[],
     IAbortSwitch&   abort_switch)
 {
-    // Request non-exclusive access.
-    boost::shared_lock<boost::shared_mutex> lock(m_mutex, boost::defer_lock);
-    while (true)
-    {
-        if (abort_switch.is_aborted())
-            return;
-        if (lock.try_lock_for(boost::chrono::milliseconds(5)))
-            break;
-    }
-
+    // Samples are splatted with atomic additions, without locking.
     const float fw = static_cast<float>(m_fb.get_width());
     const float fh = static_cast<float>(m_fb.get_height());
     size_t counter = 0;
@@ -109,14 +98,13 @@ void GlobalSampleAccumulationBuffer::develop_to_frame(
     Frame&          frame,
     IAbortSwitch&   abort_switch)
 {
-    // Request exclusive access.
-    boost::unique_lock<boost::shared_mutex> lock(m_mutex, boost::defer_lock);
-    while (true)
+    // Request exclusive access. This only excludes clear(), not sample storage.
+    boost::mutex::scoped_lock lock(m_mutex, boost::defer_lock);
+    while (!lock.try_lock())
     {
+        foundation::sleep(5);
         if (abort_switch.is_aborted())
             return;
-        if (lock.try_lock_for(boost::chrono::milliseconds(5)))
-            break;
     }
 
     Image& image = frame.image();
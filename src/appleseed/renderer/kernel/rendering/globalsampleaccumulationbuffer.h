@@ -39,6 +39,9 @@
 #include "foundation/platform/thread.h"
 #include "foundation/platform/types.h"
 
+// Boost headers.
+#include "boost/thread/mutex.hpp"
+
 // Standard headers.
 #include <cstddef>
 
@@ -61,16 +64,18 @@ class GlobalSampleAccumulationBuffer
         const size_t                height,
         const foundation::Filter2f& filter);
 
-    // Reset the buffer to its initial state. Thread-safe.
+    // Reset the buffer to its initial state. Thread-safe with respect
+    // to develop_to_frame() but not to store_samples().
     void clear() override;
 
-    // Store a set of samples into the buffer. Thread-safe.
+    // Store a set of samples into the buffer. Thread-safe and lock-free.
     void store_samples(
         const size_t                sample_count,
         const Sample                samples[],
         foundation::IAbortSwitch&   abort_switch) override;
 
-    // Develop the buffer to a frame. Thread-safe.
+    // Develop the buffer to a frame. Thread-safe. Samples stored concurrently
+    // may be partially visible in the frame until the next development.
     void develop_to_frame(
         Frame&                      frame,
         foundation::IAbortSwitch&   abort_switch) override;
@@ -79,7 +84,7 @@ class GlobalSampleAccumulationBuffer
     void increment_sample_count(const foundation::uint64 delta_sample_count);
 
   private:
-    boost::shared_mutex             m_mutex;
+    boost::mutex                    m_mutex;
     foundation::FilteredTile        m_fb;
     const float                     m_filter_rcp_norm_factor;
 
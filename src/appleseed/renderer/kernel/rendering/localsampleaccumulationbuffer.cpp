@@ -33,6 +33,7 @@
 // appleseed.renderer headers.
 #include "renderer/kernel/aov/imagestack.h"
 #include "renderer/kernel/aov/tilestack.h"
+#include "renderer/kernel/rendering/convergencemap.h"
 #include "renderer/kernel/rendering/sample.h"
 #include "renderer/modeling/frame/frame.h"
 
@@ -77,6 +78,12 @@ namespace renderer
 //   pushing samples to and the level that is displayed. As soon as a level contains enough
 //   samples, it becomes the new active level.
 //
+//   store_samples() never takes a lock: samples are splatted with atomic additions, and the
+//   active level only ever moves toward finer levels which already contain all the samples.
+//   develop_to_frame() reads the active level while samples are being added to it; a pixel
+//   may then be developed with a partially added sample, which only affects the displayed
+//   image until the next development. Only clear() and develop_to_frame() are serialized.
+//
 
 //#define PRINT_DETAILED_PERF_REPORTS
 
@@ -122,7 +129,7 @@ void LocalSampleAccumulationBuffer::clear()
 #endif
 
     // Request exclusive access.
-    LockType::ScopedWriteLock lock(m_lock);
+    boost::mutex::scoped_lock lock(m_mutex);
 
 #ifdef PRINT_DETAILED_PERF_REPORTS
     sw.measure();
@@ -152,48 +159,32 @@ void LocalSampleAccumulationBuffer::store_samples(
     sw.start();
 #endif
 
+    // Store samples at every level, starting with the highest resolution level up to the active level.
+    size_t counter = 0;
+    for (uint32 i = 0, e = m_active_level; i <= e; ++i)
     {
-        // Request non-exclusive access.
-        while (!m_lock.try_lock_read())
-        {
-            foundation::sleep(1);
-            if (abort_switch.is_aborted())
-                return;
-        }
+        FilteredTile* level = m_levels[i];
+        const float level_width = static_cast<float>(level->get_width());
+        const float level_height = static_cast<float>(level->get_height());
 
-#ifdef PRINT_DETAILED_PERF_REPORTS
-        sw.measure();
-        RENDERER_LOG_DEBUG("store_samples: acquiring lock: %f", sw.get_seconds() * 1000.0);
-#endif
-
-        // Store samples at every level, starting with the highest resolution level up to the active level.
-        size_t counter = 0;
-        for (uint32 i = 0, e = m_active_level; i <= e; ++i)
+        const Sample* sample_end = samples + sample_count;
+        for (const Sample* s = samples; s < sample_end; ++s)
         {
-            FilteredTile* level = m_levels[i];
-            const float level_width = static_cast<float>(level->get_width());
-            const float level_height = static_cast<float>(level->get_height());
+            if ((counter++ & 4096) == 0 && abort_switch.is_aborted())
+                return;
 
-            const Sample* sample_end = samples + sample_count;
-            for (const Sample* s = samples; s < sample_end; ++s)
-            {
-                if ((counter++ & 4096) == 0 && abort_switch.is_aborted())
-                {
-                    m_lock.unlock_read();
-                    return;
-                }
-
-                const float fx = s->m_position.x * level_width;
-                const float fy = s->m_position.y * level_height;
-                level->atomic_add(fx, fy, &s->m_color[0]);
-            }
+            const float fx = s->m_position.x * level_width;
+            const float fy = s->m_position.y * level_height;
+            level->atomic_add(fx, fy, &s->m_color[0]);
         }
-
-        m_lock.unlock_read();
     }
 
     m_sample_count += sample_count;
 
+    // Update the convergence map, if any.
+    if (m_convergence_map)
+        m_convergence_map->store_samples(sample_count, samples);
+
 #ifdef PRINT_DETAILED_PERF_REPORTS
     sw.measure();
     RENDERER_LOG_DEBUG("store_samples: " FMT_SIZE_T " -> %f", sample_count, sw.get_seconds() * 1000.0);
@@ -225,6 +216,11 @@ void LocalSampleAccumulationBuffer::store_samples(
     }
 }
 
+bool LocalSampleAccumulationBuffer::supports_convergence_map() const
+{
+    return true;
+}
+
 void LocalSampleAccumulationBuffer::develop_to_frame(
     Frame&              frame,
     IAbortSwitch&       abort_switch)
@@ -234,8 +230,9 @@ void LocalSampleAccumulationBuffer::develop_to_frame(
     sw.start();
 #endif
 
-    // Request exclusive access.
-    while (!m_lock.try_lock_write())
+    // Request exclusive access. This only excludes clear(), not sample storage.
+    boost::mutex::scoped_lock lock(m_mutex, boost::defer_lock);
+    while (!lock.try_lock())
     {
         foundation::sleep(5);
         if (abort_switch.is_aborted())
@@ -264,10 +261,7 @@ void LocalSampleAccumulationBuffer::develop_to_frame(
         for (size_t tx = 0; tx < frame_props.m_tile_count_x; ++tx)
         {
             if (abort_switch.is_aborted())
-            {
-                m_lock.unlock_write();
                 return;
-            }
 
             const size_t origin_x = tx * frame_props.m_tile_width;
             const size_t origin_y = ty * frame_props.m_tile_height;
@@ -290,8 +284,6 @@ void LocalSampleAccumulationBuffer::develop_to_frame(
         }
     }
 
-    m_lock.unlock_write();
-
 #ifdef PRINT_DETAILED_PERF_REPORTS
     sw.measure();
     const double t2 = sw.get_seconds();
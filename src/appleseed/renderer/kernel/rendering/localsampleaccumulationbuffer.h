@@ -40,6 +40,9 @@
 #include "foundation/platform/thread.h"
 #include "foundation/platform/types.h"
 
+// Boost headers.
+#include "boost/thread/mutex.hpp"
+
 // Standard headers.
 #include <cstddef>
 #include <vector>
@@ -67,10 +70,11 @@ class LocalSampleAccumulationBuffer
     // Destructor.
     ~LocalSampleAccumulationBuffer() override;
 
-    // Reset the buffer to its initial state. Thread-safe.
+    // Reset the buffer to its initial state. Thread-safe with respect
+    // to develop_to_frame() but not to store_samples().
     void clear() override;
 
-    // Store a set of samples into the buffer. Thread-safe.
+    // Store a set of samples into the buffer. Thread-safe and lock-free.
     void store_samples(
         const size_t                        sample_count,
         const Sample                        samples[],
@@ -81,6 +85,9 @@ class LocalSampleAccumulationBuffer
         Frame&                              frame,
         foundation::IAbortSwitch&           abort_switch) override;
 
+    // This buffer is only fed by camera sample generators.
+    bool supports_convergence_map() const override;
+
     // Exposed for tests and benchmarks.
     static void develop_to_tile(
         foundation::Tile&                   color_tile,
@@ -92,11 +99,7 @@ class LocalSampleAccumulationBuffer
         const foundation::AABB2u&           rect);
 
   private:
-    typedef foundation::ReadWriteLock<
-        foundation::SleepWaitPolicy<5>
-    > LockType;
-
-    LockType                                m_lock;
+    boost::mutex                            m_mutex;
     std::vector<foundation::FilteredTile*>  m_levels;
     boost::atomic<foundation::int32>*       m_remaining_pixels;
     boost::atomic<foundation::uint32>       m_active_level;
@@ -41,6 +41,7 @@
 #include "renderer/kernel/rendering/serialrenderercontroller.h"
 #include "renderer/kernel/rendering/serialtilecallback.h"
 #include "renderer/kernel/shading/closures.h"
+#include "renderer/kernel/shading/oslshadergroupcache.h"
 #include "renderer/kernel/shading/oslshadingsystem.h"
 #include "renderer/kernel/texturing/oiiotexturesystem.h"
 #include "renderer/kernel/texturing/texturestore.h"
@@ -71,6 +72,7 @@
 #include <algorithm>
 #include <cassert>
 #include <exception>
+#include <memory>
 #include <new>
 #include <string>
 #include <vector>
@@ -274,12 +276,29 @@ struct MasterRenderer::Impl
         else
             RENDERER_LOG_INFO("OSL headers not found.");
 
+        // Load the persistent cache of shader groups, if enabled.
+        const string cache_filepath =
+            m_params.child("shading_engine").get_optional<string>("osl_shader_group_cache", "");
+        unique_ptr<OSLShaderGroupCache> shader_group_cache;
+        if (!cache_filepath.empty())
+        {
+            shader_group_cache.reset(
+                new OSLShaderGroupCache(cache_filepath.c_str(), m_project.search_paths()));
+        }
+
         // Re-optimize shader groups that need updating.
-        return
+        const bool success =
             m_project.get_scene()->create_optimized_osl_shader_groups(
                 *m_shading_system,
                 m_osl_compiler.get(),
-                &abort_switch);
+                &abort_switch,
+                shader_group_cache.get(),
+                get_rendering_thread_count(m_params));
+
+        if (success && shader_group_cache)
+            shader_group_cache->save();
+
+        return success;
     }
 
     // Render the project.
@@ -466,6 +485,7 @@ struct MasterRenderer::Impl
         else RENDERER_LOG_INFO("using built-in ray tracing kernel.");
 
         // Updating the trace context causes ray tracing acceleration structures to be updated or rebuilt.
+        m_project.set_trace_context_thread_count(get_rendering_thread_count(m_params));
         m_project.update_trace_context();
 
         // Load the checkpoint if any.
@@ -32,6 +32,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
+#include "renderer/kernel/rendering/convergencemap.h"
 #include "renderer/kernel/rendering/iframerenderer.h"
 #include "renderer/kernel/rendering/isamplegenerator.h"
 #include "renderer/kernel/rendering/itilecallback.h"
@@ -113,6 +114,24 @@ namespace
             // Create an accumulation buffer.
             m_buffer.reset(generator_factory->create_sample_accumulation_buffer());
 
+            // Create a convergence map if adaptive sampling is enabled. The map relies on per-pixel
+            // noise estimates which are only available when the buffer receives camera samples.
+            if (m_params.m_adaptive_sampling && !m_buffer->supports_convergence_map())
+                RENDERER_LOG_WARNING("adaptive sampling is only supported with camera sample generators, disabling it.");
+            else if (m_params.m_adaptive_sampling)
+            {
+                const Frame& frame = *m_project.get_frame();
+                const CanvasProperties& props = frame.image().properties();
+                m_convergence_map.reset(
+                    new ConvergenceMap(
+                        props.m_canvas_width,
+                        props.m_canvas_height,
+                        frame.get_crop_window(),
+                        m_params.m_noise_threshold,
+                        m_params.m_adaptive_min_samples));
+                m_buffer->set_convergence_map(m_convergence_map.get());
+            }
+
             // Create and initialize the job manager.
             m_job_manager.reset(
                 new JobManager(
@@ -216,6 +235,7 @@ namespace
                 "  rendering threads             %s\n"
                 "  max samples                   %s\n"
                 "  max fps                       %f\n"
+                "  adaptive sampling             %s\n"
                 "  collect performance stats     %s\n"
                 "  collect luminance stats       %s\n"
                 "  reference image path          %s",
@@ -226,6 +246,10 @@ namespace
                     ? "unlimited"
                     : pretty_uint(m_params.m_max_sample_count).c_str(),
                 m_params.m_max_fps,
+                m_convergence_map.get()
+                    ? ("on, noise threshold " + pretty_scalar(m_params.m_noise_threshold, 4) +
+                       ", min samples " + pretty_uint(m_params.m_adaptive_min_samples)).c_str()
+                    : "off",
                 m_params.m_perf_stats ? "on" : "off",
                 m_params.m_luminance_stats ? "on" : "off",
                 m_params.m_ref_image_path.empty() ? "n/a" : m_params.m_ref_image_path.c_str());
@@ -254,6 +278,9 @@ namespace
             m_buffer->clear();
             m_sample_counter.clear();
 
+            if (m_convergence_map.get())
+                m_convergence_map->clear();
+
             // Reset sample generators.
             for (auto sample_generator : m_sample_generators)
                 sample_generator->reset();
@@ -274,6 +301,7 @@ namespace
                 new StatisticsFunc(
                     m_project,
                     *m_buffer.get(),
+                    m_convergence_map.get(),
                     m_params.m_perf_stats,
                     m_params.m_luminance_stats,
                     m_ref_image.get(),
@@ -388,6 +416,9 @@ namespace
             const size_t                m_thread_count;         // number of rendering threads
             const uint64                m_max_sample_count;     // maximum total number of samples to compute
             const double                m_max_fps;              // maximum display frequency in frames/second
+            const bool                  m_adaptive_sampling;    // stop sampling regions of the frame that have converged?
+            const float                 m_noise_threshold;      // noise level below which a region has converged
+            const size_t                m_adaptive_min_samples; // number of samples per pixel before a region may converge
             const bool                  m_perf_stats;           // collect and print performance statistics?
             const bool                  m_luminance_stats;      // collect and print luminance statistics?
             const string                m_ref_image_path;       // path to the reference image
@@ -398,6 +429,9 @@ namespace
               , m_thread_count(get_rendering_thread_count(params))
               , m_max_sample_count(params.get_optional<uint64>("max_samples", numeric_limits<uint64>::max()))
               , m_max_fps(params.get_optional<double>("max_fps", 30.0))
+              , m_adaptive_sampling(params.get_optional<bool>("adaptive_sampling", false))
+              , m_noise_threshold(params.get_optional<float>("noise_threshold", 0.1f))
+              , m_adaptive_min_samples(params.get_optional<size_t>("adaptive_min_samples", 16))
               , m_perf_stats(params.get_optional<bool>("performance_statistics", false))
               , m_luminance_stats(params.get_optional<bool>("luminance_statistics", false))
               , m_ref_image_path(params.get_optional<string>("reference_image", ""))
@@ -540,6 +574,7 @@ namespace
             StatisticsFunc(
                 const Project&              project,
                 SampleAccumulationBuffer&   buffer,
+                const ConvergenceMap*       convergence_map,
                 const bool                  perf_stats,
                 const bool                  luminance_stats,
                 const Image*                ref_image,
@@ -547,6 +582,7 @@ namespace
                 IAbortSwitch&               abort_switch)
               : m_project(project)
               , m_buffer(buffer)
+              , m_convergence_map(convergence_map)
               , m_perf_stats(perf_stats)
               , m_luminance_stats(luminance_stats)
               , m_ref_image(ref_image)
@@ -627,6 +663,7 @@ namespace
           private:
             const Project&                  m_project;
             SampleAccumulationBuffer&       m_buffer;
+            const ConvergenceMap*           m_convergence_map;
             const bool                      m_perf_stats;
             const bool                      m_luminance_stats;
             const Image*                    m_ref_image;
@@ -651,11 +688,20 @@ namespace
                 const double samples_per_pixel = samples * m_rcp_pixel_count;
                 const uint64 samples_per_second = truncate<uint64>(m_sample_count_history.get_samples_per_second());
 
+                string converged;
+                if (m_convergence_map)
+                {
+                    converged = ", " + pretty_percent(
+                        m_convergence_map->get_converged_block_count(),
+                        m_convergence_map->get_block_count()) + " converged";
+                }
+
                 RENDERER_LOG_INFO(
-                    "%s samples, %s samples/pixel, %s samples/second",
+                    "%s samples, %s samples/pixel, %s samples/second%s",
                     pretty_uint(samples).c_str(),
                     pretty_scalar(samples_per_pixel).c_str(),
-                    pretty_uint(samples_per_second).c_str());
+                    pretty_uint(samples_per_second).c_str(),
+                    converged.c_str());
 
                 if (m_perf_stats)
                     m_sample_count_records.emplace_back(time, static_cast<double>(samples));
@@ -705,6 +751,7 @@ namespace
         SampleCounter                           m_sample_counter;
 
         unique_ptr<SampleAccumulationBuffer>    m_buffer;
+        unique_ptr<ConvergenceMap>              m_convergence_map;
 
         JobQueue                                m_job_queue;
         unique_ptr<JobManager>                  m_job_manager;
@@ -766,6 +813,34 @@ Dictionary ProgressiveFrameRendererFactory::get_params_metadata()
             .insert("label", "Max Samples")
             .insert("help", "Maximum number of samples per pixel"));
 
+    metadata.dictionaries().insert(
+        "adaptive_sampling",
+        Dictionary()
+            .insert("type", "bool")
+            .insert("default", "false")
+            .insert("label", "Adaptive Sampling")
+            .insert("help", "Stop sampling regions of the frame once they have converged, and stop rendering once the whole frame has converged"));
+
+    metadata.dictionaries().insert(
+        "noise_threshold",
+        Dictionary()
+            .insert("type", "float")
+            .insert("min", "0.0001")
+            .insert("max", "10000.0")
+            .insert("default", "0.1")
+            .insert("label", "Noise Threshold")
+            .insert("help", "Maximum amount of noise allowed in the image"));
+
+    metadata.dictionaries().insert(
+        "adaptive_min_samples",
+        Dictionary()
+            .insert("type", "int")
+            .insert("min", "2")
+            .insert("max", "1000000")
+            .insert("default", "16")
+            .insert("label", "Min Samples")
+            .insert("help", "Number of samples per pixel to render before a region of the frame may be considered converged"));
+
     return metadata;
 }
 
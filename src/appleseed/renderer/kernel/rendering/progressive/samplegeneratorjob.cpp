@@ -32,6 +32,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
+#include "renderer/kernel/rendering/convergencemap.h"
 #include "renderer/kernel/rendering/isamplegenerator.h"
 #include "renderer/kernel/rendering/progressive/samplecounter.h"
 #include "renderer/kernel/rendering/sampleaccumulationbuffer.h"
@@ -42,6 +43,7 @@
 #include "foundation/math/scalar.h"
 #include "foundation/platform/defaulttimers.h"
 #include "foundation/utility/stopwatch.h"
+#include "foundation/utility/string.h"
 
 // Standard headers.
 #include <algorithm>
@@ -118,6 +120,11 @@ void SampleGeneratorJob::execute(const size_t thread_index)
     const double t1 = stopwatch.get_seconds();
 #endif
 
+    // Terminate this job if the whole frame has converged.
+    ConvergenceMap* convergence_map = m_buffer.get_convergence_map();
+    if (convergence_map && convergence_map->is_converged())
+        return;
+
     // We will base the number of samples to be rendered by this job on
     // the number of samples already reserved (not necessarily rendered).
     const uint64 current_sample_count = m_sample_counter.read();
@@ -165,6 +172,14 @@ void SampleGeneratorJob::execute(const size_t thread_index)
         pretty_time(t2 - t1).c_str());
 #endif
 
+    // Update the convergence map. Only the first job does it since updates are not thread-safe.
+    if (convergence_map && m_job_index == 0 && convergence_map->update())
+    {
+        RENDERER_LOG_INFO(
+            "noise threshold reached everywhere in the frame after %s samples, stopping progressive rendering.",
+            pretty_uint(m_buffer.get_sample_count()).c_str());
+    }
+
     // Reschedule this job.
     if (!abortable || !m_abort_switch.is_aborted())
         m_job_queue.schedule(this, false);
@@ -481,15 +481,27 @@ bool RendererServices::trace(
         VisibilityFlags::ProbeRay,
         parent->get_ray().m_depth + 1);
 
-    // todo: move this out of the hot code path (but it must remain thread-local).
-    TextureCache texture_cache(*m_texture_store);
-    Intersector intersector(m_project.get_trace_context(), texture_cache);
-
     ShadingPoint shading_point;
-    intersector.trace(
-        ray,
-        shading_point,
-        origin_shading_point);
+
+    if (parent->m_intersector)
+    {
+        // Reuse the intersector of the rendering thread that created the parent shading
+        // point, together with its texture cache and its access caches.
+        parent->m_intersector->trace_osl(
+            ray,
+            shading_point,
+            origin_shading_point);
+    }
+    else
+    {
+        // The parent shading point was not created by an intersector.
+        TextureCache texture_cache(*m_texture_store);
+        Intersector intersector(m_project.get_trace_context(), texture_cache);
+        intersector.trace_osl(
+            ray,
+            shading_point,
+            origin_shading_point);
+    }
 
     ShadingPoint::OSLTraceData* trace_data =
         reinterpret_cast<ShadingPoint::OSLTraceData*>(sg->tracedata);
@@ -35,10 +35,12 @@
 #include "foundation/platform/types.h"
 
 // Standard headers.
+#include <cassert>
 #include <cstddef>
 
 // Forward declarations.
 namespace foundation    { class IAbortSwitch; }
+namespace renderer      { class ConvergenceMap; }
 namespace renderer      { class Frame; }
 namespace renderer      { class Sample; }
 
@@ -49,6 +51,9 @@ class SampleAccumulationBuffer
   : public foundation::NonCopyable
 {
   public:
+    // Constructor.
+    SampleAccumulationBuffer();
+
     // Destructor.
     virtual ~SampleAccumulationBuffer() {}
 
@@ -69,8 +74,18 @@ class SampleAccumulationBuffer
         Frame&                      frame,
         foundation::IAbortSwitch&   abort_switch) = 0;
 
+    // Return true if this buffer only receives camera samples, one per camera path, and can
+    // therefore feed a convergence map. Splats from light paths can't be used for that purpose.
+    virtual bool supports_convergence_map() const;
+
+    // Set or get the convergence map updated with the samples stored into this buffer.
+    // A map may only be set if supports_convergence_map() returns true.
+    void set_convergence_map(ConvergenceMap* convergence_map);
+    ConvergenceMap* get_convergence_map() const;
+
   protected:
     boost::atomic<foundation::uint64> m_sample_count;
+    ConvergenceMap*                   m_convergence_map;
 };
 
 
@@ -78,9 +93,30 @@ class SampleAccumulationBuffer
 // SampleAccumulationBuffer class implementation.
 //
 
+inline SampleAccumulationBuffer::SampleAccumulationBuffer()
+  : m_convergence_map(nullptr)
+{
+}
+
 inline foundation::uint64 SampleAccumulationBuffer::get_sample_count() const
 {
     return m_sample_count;
 }
 
+inline bool SampleAccumulationBuffer::supports_convergence_map() const
+{
+    return false;
+}
+
+inline void SampleAccumulationBuffer::set_convergence_map(ConvergenceMap* convergence_map)
+{
+    assert(convergence_map == nullptr || supports_convergence_map());
+    m_convergence_map = convergence_map;
+}
+
+inline ConvergenceMap* SampleAccumulationBuffer::get_convergence_map() const
+{
+    return m_convergence_map;
+}
+
 }   // namespace renderer
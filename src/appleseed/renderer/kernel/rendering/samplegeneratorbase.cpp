@@ -32,6 +32,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
+#include "renderer/kernel/rendering/convergencemap.h"
 #include "renderer/kernel/rendering/sampleaccumulationbuffer.h"
 
 // appleseed.foundation headers.
@@ -40,6 +41,7 @@
 
 // Standard headers.
 #include <cassert>
+#include <limits>
 
 using namespace foundation;
 
@@ -57,7 +59,8 @@ namespace
 SampleGeneratorBase::SampleGeneratorBase(
     const size_t                generator_index,
     const size_t                generator_count)
-  : m_generator_index(generator_index)
+  : m_convergence_map(nullptr)
+  , m_generator_index(generator_index)
   , m_stride((generator_count - 1) * SampleBatchSize)
 {
     reset();
@@ -80,9 +83,18 @@ void SampleGeneratorBase::generate_samples(
     clear_keep_memory(m_samples);
     m_samples.reserve(sample_count);
 
+    m_convergence_map = buffer.get_convergence_map();
+
+    // With adaptive sampling, samples falling into converged regions are discarded: bound the
+    // number of attempts rather than the number of stored samples so that the amount of work
+    // remains the same as the frame converges.
+    const size_t max_attempts =
+        m_convergence_map ? sample_count : std::numeric_limits<size_t>::max();
+
     size_t stored = 0;
+    size_t attempts = 0;
 
-    while (stored < sample_count)
+    while (stored < sample_count && attempts++ < max_attempts)
     {
         stored += generate_samples(m_sequence_index, m_samples);
         ++m_sequence_index;
@@ -94,6 +106,10 @@ void SampleGeneratorBase::generate_samples(
 
             if (abort_switch.is_aborted())
                 break;
+
+            // Stop if there is nowhere left to render samples.
+            if (m_convergence_map && m_convergence_map->is_converged())
+                break;
         }
     }
 
@@ -101,6 +117,11 @@ void SampleGeneratorBase::generate_samples(
         buffer.store_samples(stored, &m_samples[0], abort_switch);
 }
 
+bool SampleGeneratorBase::has_converged(const Vector2d& position) const
+{
+    return m_convergence_map && m_convergence_map->is_converged(Vector2f(position));
+}
+
 void SampleGeneratorBase::signal_invalid_sample()
 {
     // todo: mark pixel as faulty in the diagnostic map.
@@ -34,6 +34,7 @@
 #include "renderer/kernel/rendering/sample.h"
 
 // appleseed.foundation headers.
+#include "foundation/math/vector.h"
 #include "foundation/platform/types.h"
 
 // Standard headers.
@@ -42,6 +43,7 @@
 
 // Forward declarations.
 namespace foundation    { class IAbortSwitch; }
+namespace renderer      { class ConvergenceMap; }
 namespace renderer      { class SampleAccumulationBuffer; }
 
 namespace renderer
@@ -79,7 +81,12 @@ class SampleGeneratorBase
 
     void signal_invalid_sample();
 
+    // Return true if the region of the frame containing a given position in NDC has
+    // converged, in which case no sample needs to be rendered there (adaptive sampling).
+    bool has_converged(const foundation::Vector2d& position) const;
+
   private:
+    const ConvergenceMap*           m_convergence_map;
     const size_t                    m_generator_index;
     const size_t                    m_stride;
     size_t                          m_sequence_index;
@@ -0,0 +1,277 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "oslshadergroupcache.h"
+
+// appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+#include "renderer/modeling/shadergroup/shader.h"
+#include "renderer/modeling/shadergroup/shaderconnection.h"
+#include "renderer/modeling/shadergroup/shadergroup.h"
+#include "renderer/modeling/shadergroup/shaderparam.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/appleseed.h"
+#include "foundation/utility/api/apistring.h"
+#include "foundation/utility/murmurhash.h"
+#include "foundation/utility/searchpaths.h"
+#include "foundation/utility/string.h"
+
+// OSL headers.
+#include "foundation/platform/_beginoslheaders.h"
+#include "OSL/oslversion.h"
+#include "foundation/platform/_endoslheaders.h"
+
+// Standard headers.
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+//
+// OSLShaderGroupCache class implementation.
+//
+
+namespace
+{
+    // The cache is invalidated when appleseed or OSL are updated since the closures
+    // reported by OSL for a given shader group may change.
+    string get_cache_header()
+    {
+        stringstream sstr;
+        sstr << "appleseed osl shader group cache "
+             << Appleseed::get_lib_version() << " "
+             << OSL_LIBRARY_VERSION_CODE;
+        return sstr.str();
+    }
+
+    bool read_file(const string& filepath, string& contents)
+    {
+        ifstream file(filepath.c_str(), ios::in | ios::binary);
+
+        if (!file.is_open())
+            return false;
+
+        contents.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+
+        return !file.bad();
+    }
+
+    // Prefix strings with their length so that consecutive strings can't be confused.
+    void append_string(MurmurHash& hash, const string& str)
+    {
+        hash.append(str.size());
+        hash.append(str);
+    }
+}
+
+OSLShaderGroupCache::OSLShaderGroupCache(
+    const char*                 filepath,
+    const SearchPaths&          search_paths)
+  : m_filepath(filepath)
+  , m_search_paths(search_paths)
+  , m_modified(false)
+{
+    if (load())
+    {
+        RENDERER_LOG_INFO(
+            "loaded %s %s from osl shader group cache %s.",
+            pretty_uint(m_entries.size()).c_str(),
+            plural(m_entries.size(), "entry", "entries").c_str(),
+            m_filepath.c_str());
+    }
+}
+
+bool OSLShaderGroupCache::load()
+{
+    ifstream file(m_filepath.c_str());
+
+    if (!file.is_open())
+        return false;
+
+    string header;
+    getline(file, header);
+
+    if (header != get_cache_header())
+    {
+        RENDERER_LOG_INFO(
+            "osl shader group cache %s was created by another version of appleseed or OSL; ignoring it.",
+            m_filepath.c_str());
+        return false;
+    }
+
+    string key;
+    uint32 flags;
+
+    while (file >> key >> flags)
+        m_entries[key] = flags;
+
+    return true;
+}
+
+bool OSLShaderGroupCache::save() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    if (!m_modified)
+        return true;
+
+    ofstream file(m_filepath.c_str(), ios::out | ios::trunc);
+
+    if (!file.is_open())
+    {
+        RENDERER_LOG_ERROR("failed to write osl shader group cache %s.", m_filepath.c_str());
+        return false;
+    }
+
+    file << get_cache_header() << endl;
+
+    for (const auto& entry : m_entries)
+        file << entry.first << " " << entry.second << endl;
+
+    return true;
+}
+
+bool OSLShaderGroupCache::compute_key(
+    const ShaderGroup&          shader_group,
+    string&                     key) const
+{
+    MurmurHash hash;
+
+    for (const Shader& shader : shader_group.shaders())
+    {
+        append_string(hash, shader.get_type());
+        append_string(hash, shader.get_shader());
+        append_string(hash, shader.get_layer());
+
+        if (const char* source_code = shader.get_source_code())
+            append_string(hash, source_code);
+        else
+        {
+            // Hash the compiled shader since it may have changed on disk.
+            string file_hash;
+            if (!get_shader_file_hash(string(shader.get_shader()) + ".oso", file_hash))
+                return false;
+
+            append_string(hash, file_hash);
+        }
+
+        for (const ShaderParam& param : shader.shader_params())
+        {
+            append_string(hash, param.get_name());
+            append_string(hash, param.get_value_as_string());
+        }
+    }
+
+    for (const ShaderConnection& connection : shader_group.shader_connections())
+    {
+        append_string(hash, connection.get_src_layer());
+        append_string(hash, connection.get_src_param());
+        append_string(hash, connection.get_dst_layer());
+        append_string(hash, connection.get_dst_param());
+    }
+
+    key = hash.to_string();
+
+    return true;
+}
+
+bool OSLShaderGroupCache::get_shader_file_hash(
+    const string&               filename,
+    string&                     hash) const
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+
+        const FileHashMap::const_iterator i = m_shader_file_hashes.find(filename);
+
+        if (i != m_shader_file_hashes.end())
+        {
+            hash = i->second;
+            return !hash.empty();
+        }
+    }
+
+    // Read and hash the file without holding the lock.
+    hash.clear();
+    if (m_search_paths.exist(filename))
+    {
+        string byte_code;
+        if (read_file(m_search_paths.qualify(filename).c_str(), byte_code))
+        {
+            MurmurHash file_hash;
+            append_string(file_hash, byte_code);
+            hash = file_hash.to_string();
+        }
+    }
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_shader_file_hashes[filename] = hash;
+
+    return !hash.empty();
+}
+
+bool OSLShaderGroupCache::lookup(
+    const string&               key,
+    uint32&                     flags) const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    const EntryMap::const_iterator i = m_entries.find(key);
+
+    if (i == m_entries.end())
+        return false;
+
+    flags = i->second;
+    return true;
+}
+
+void OSLShaderGroupCache::insert(
+    const string&               key,
+    const uint32                flags)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    m_entries[key] = flags;
+    m_modified = true;
+}
+
+size_t OSLShaderGroupCache::size() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    return m_entries.size();
+}
+
+}   // namespace renderer
@@ -0,0 +1,111 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/platform/types.h"
+
+// Boost headers.
+#include "boost/thread/mutex.hpp"
+
+// Standard headers.
+#include <cstddef>
+#include <map>
+#include <string>
+
+// Forward declarations.
+namespace foundation    { class SearchPaths; }
+namespace renderer      { class ShaderGroup; }
+
+namespace renderer
+{
+
+//
+// A persistent cache of the properties of optimized OSL shader groups.
+//
+// Finding out which closures and globals a shader group uses requires OSL to optimize
+// and JIT the shader group. This cache stores these properties on disk, keyed by a hash
+// of the shaders, the shader parameters and the connections of the shader group, so that
+// unchanged shader groups don't need to be optimized before rendering starts.
+//
+
+class OSLShaderGroupCache
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor. Load the cache from a given file, if it exists.
+    // Search paths are used to find the compiled shaders referenced by shader groups.
+    OSLShaderGroupCache(
+        const char*                         filepath,
+        const foundation::SearchPaths&      search_paths);
+
+    // Write the cache to disk if it was modified. Return true on success.
+    bool save() const;
+
+    // Compute the key of a shader group. Return false if the shader group cannot be
+    // cached, for instance because some of its compiled shaders cannot be found.
+    // Each compiled shader file is read and hashed only once per cache instance. Thread-safe.
+    bool compute_key(
+        const ShaderGroup&                  shader_group,
+        std::string&                        key) const;
+
+    // Retrieve the properties of a shader group. Return true if they were found. Thread-safe.
+    bool lookup(
+        const std::string&                  key,
+        foundation::uint32&                 flags) const;
+
+    // Store the properties of a shader group. Thread-safe.
+    void insert(
+        const std::string&                  key,
+        const foundation::uint32            flags);
+
+    // Return the number of shader groups in the cache.
+    size_t size() const;
+
+  private:
+    typedef std::map<std::string, foundation::uint32> EntryMap;
+    typedef std::map<std::string, std::string> FileHashMap;
+
+    const std::string                       m_filepath;
+    const foundation::SearchPaths&          m_search_paths;
+    mutable boost::mutex                    m_mutex;
+    EntryMap                                m_entries;
+    bool                                    m_modified;
+    mutable FileHashMap                     m_shader_file_hashes;   // empty hash if the file cannot be read
+
+    bool load();
+
+    // Retrieve the hash of a compiled shader file. Return false if the file cannot be read.
+    bool get_shader_file_hash(
+        const std::string&                  filename,
+        std::string&                        hash) const;
+};
+
+}   // namespace renderer
@@ -37,6 +37,11 @@
 #include "renderer/modeling/color/colorspace.h"
 #include "renderer/modeling/shadergroup/shadergroup.h"
 
+// appleseed.foundation headers.
+#include "foundation/math/population.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/arena.h"
+
 using namespace foundation;
 
 namespace renderer
@@ -172,4 +177,20 @@ void ShadingContext::choose_bsdf_closure_shading_basis(
     m_shadergroup_exec.choose_bsdf_closure_shading_basis(shading_point, s);
 }
 
+StatisticsVector ShadingContext::get_statistics() const
+{
+    // Keep high-water marks as a population so that merging the statistics
+    // of all rendering threads reports the average and the worst thread.
+    Population<uint64> high_water_mark;
+    high_water_mark.insert(m_arena.get_high_water_mark());
+
+    Statistics stats;
+    stats.insert("arena high-water mark", high_water_mark, "bytes");
+    stats.insert("arena overflows", m_arena.get_overflow_count());
+    stats.insert("arena overflow blocks", static_cast<uint64>(m_arena.get_overflow_block_count()));
+    stats.insert_size("arena overflow memory", m_arena.get_overflow_block_size());
+
+    return StatisticsVector::make("shading context statistics", stats);
+}
+
 }   // namespace renderer
@@ -35,6 +35,7 @@
 // appleseed.foundation headers.
 #include "foundation/core/concepts/noncopyable.h"
 #include "foundation/math/vector.h"
+#include "foundation/utility/statistics.h"
 
 // Standard headers.
 #include <cstddef>
@@ -139,6 +140,9 @@ class ShadingContext
         const ShadingPoint&         shading_point,
         const foundation::Vector2f& s) const;
 
+    // Retrieve performance statistics, including the memory usage of the arena.
+    foundation::StatisticsVector get_statistics() const;
+
   private:
     const Intersector&              m_intersector;
     Tracer&                         m_tracer;
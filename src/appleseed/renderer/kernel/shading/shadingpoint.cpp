@@ -1189,6 +1189,7 @@ class PoisonImpl<OSL::Vec3>
 void PoisonImpl<renderer::ShadingPoint>::do_poison(renderer::ShadingPoint& point)
 {
     poison(point.m_texture_cache);
+    poison(point.m_intersector);
     poison(point.m_scene);
     poison(point.m_ray);
 
@@ -64,6 +64,7 @@
 #include <cstddef>
 
 // Forward declarations.
+namespace renderer  { class Intersector; }
 namespace renderer  { class Object; }
 namespace renderer  { class OSLShaderGroupExec; }
 namespace renderer  { class ShaderGroup; }
@@ -278,6 +279,7 @@ class ShadingPoint
     friend class EmbreeScene;
     friend class Intersector;
     friend class NPRSurfaceShaderHelper;
+    friend class ObjectInstanceLeafVisitor;
     friend class OSLShaderGroupExec;
     friend class RendererServices;
     friend class ShadingPointBuilder;
@@ -290,6 +292,7 @@ class ShadingPoint
 
     // Context.
     TextureCache*                       m_texture_cache;
+    const Intersector*                  m_intersector;                      // intersector that created this shading point
     const Scene*                        m_scene;
     mutable ShadingRay                  m_ray;                              // world space ray (m_tmax = distance to intersection)
 
@@ -423,6 +426,7 @@ APPLESEED_FORCE_INLINE ShadingPoint::ShadingPoint()
 
 inline ShadingPoint::ShadingPoint(const ShadingPoint& rhs)
   : m_texture_cache(rhs.m_texture_cache)
+  , m_intersector(rhs.m_intersector)
   , m_scene(rhs.m_scene)
   , m_ray(rhs.m_ray)
   , m_primitive_type(rhs.m_primitive_type)
@@ -440,6 +444,7 @@ inline ShadingPoint::ShadingPoint(const ShadingPoint& rhs)
 inline ShadingPoint& ShadingPoint::operator=(const ShadingPoint& rhs)
 {
     m_texture_cache = rhs.m_texture_cache;
+    m_intersector = rhs.m_intersector;
     m_scene = rhs.m_scene;
     m_ray = rhs.m_ray;
     m_primitive_type = rhs.m_primitive_type;
@@ -457,6 +462,7 @@ inline ShadingPoint& ShadingPoint::operator=(const ShadingPoint& rhs)
 APPLESEED_FORCE_INLINE void ShadingPoint::clear()
 {
     m_texture_cache = nullptr;
+    m_intersector = nullptr;
     m_scene = nullptr;
     m_primitive_type = PrimitiveNone;
     m_members = 0;
@@ -38,8 +38,11 @@
 #include "renderer/utility/paramarray.h"
 
 // appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/image/canvasproperties.h"
 #include "foundation/image/color.h"
 #include "foundation/image/colorspace.h"
+#include "foundation/image/mipmap.h"
 #include "foundation/image/tile.h"
 #include "foundation/utility/api/apistring.h"
 #include "foundation/utility/containers/dictionary.h"
@@ -50,6 +53,7 @@
 
 // Standard headers.
 #include <algorithm>
+#include <exception>
 #include <string>
 
 using namespace foundation;
@@ -58,50 +62,6 @@ using namespace std;
 namespace renderer
 {
 
-//
-// TextureStore class implementation.
-//
-
-Dictionary TextureStore::get_params_metadata()
-{
-    Dictionary metadata;
-    metadata.dictionaries().insert(
-        "max_size",
-        Dictionary()
-            .insert("type", "int")
-            .insert("default", get_default_size())
-            .insert("label", "Texture Cache Size")
-            .insert("help", "Texture cache size in bytes"));
-
-    return metadata;
-}
-
-size_t TextureStore::get_default_size()
-{
-    return 1024 * 1024 * 1024;
-}
-
-TextureStore::TextureStore(
-    const Scene&        scene,
-    const ParamArray&   params)
-  : m_tile_swapper(scene, params)
-  , m_tile_cache(m_tile_key_hasher, m_tile_swapper)
-{
-}
-
-StatisticsVector TextureStore::get_statistics() const
-{
-    Statistics stats = make_single_stage_cache_stats(m_tile_cache);
-    stats.insert_size("peak size", m_tile_swapper.get_peak_memory_size());
-
-    return StatisticsVector::make("texture store statistics", stats);
-}
-
-
-//
-// TextureStore::TileSwapper class implementation.
-//
-
 namespace
 {
     // Convert a tile from the sRGB color space to the linear RGB color space.
@@ -163,80 +123,422 @@ namespace
     }
 }
 
-TextureStore::TileSwapper::TileSwapper(
+
+//
+// TextureStore::PrefetchThread class implementation.
+//
+
+class TextureStore::PrefetchThread
+  : public NonCopyable
+{
+  public:
+    explicit PrefetchThread(TextureStore& store)
+      : m_store(store)
+    {
+    }
+
+    void operator()()
+    {
+        set_current_thread_name("texture_prefetch");
+
+        while (true)
+        {
+            TileKey key;
+
+            {
+                boost::mutex::scoped_lock lock(m_store.m_prefetch_mutex);
+
+                while (m_store.m_prefetch_queue.empty() && !m_store.m_prefetch_abort)
+                    m_store.m_prefetch_event.wait(lock);
+
+                if (m_store.m_prefetch_abort)
+                    break;
+
+                key = m_store.m_prefetch_queue.front();
+                m_store.m_prefetch_queue.pop_front();
+                ++m_store.m_prefetched_tile_count;
+            }
+
+            // Bring the tile into the store. Its own neighbors are not prefetched.
+            try
+            {
+                m_store.release(m_store.acquire(key, false));
+            }
+            catch (const exception& e)
+            {
+                // The tile will be loaded again, and the error reported, if a rendering thread needs it.
+                RENDERER_LOG_WARNING("failed to prefetch texture tile: %s", e.what());
+            }
+        }
+    }
+
+  private:
+    TextureStore& m_store;
+};
+
+
+//
+// TextureStore class implementation.
+//
+
+Dictionary TextureStore::get_params_metadata()
+{
+    Dictionary metadata;
+    metadata.dictionaries().insert(
+        "max_size",
+        Dictionary()
+            .insert("type", "int")
+            .insert("default", get_default_size())
+            .insert("label", "Texture Cache Size")
+            .insert("help", "Texture cache size in bytes"));
+    metadata.dictionaries().insert(
+        "prefetch_tiles",
+        Dictionary()
+            .insert("type", "bool")
+            .insert("default", "false")
+            .insert("label", "Prefetch Tiles")
+            .insert("help", "Load the neighbors of texture tiles in the background"));
+
+    return metadata;
+}
+
+size_t TextureStore::get_default_size()
+{
+    return 1024 * 1024 * 1024;
+}
+
+TextureStore::TextureStore(
     const Scene&        scene,
     const ParamArray&   params)
   : m_scene(scene)
   , m_params(params)
-  , m_memory_size(0)
-  , m_peak_memory_size(0)
+  , m_prefetch_abort(false)
+  , m_prefetched_tile_count(0)
 {
     gather_assemblies(scene.assemblies());
+
+    // Split the memory budget evenly among the shards.
+    const size_t shard_memory_limit = max<size_t>(m_params.m_memory_limit / ShardCount, 1);
+    for (size_t i = 0; i < ShardCount; ++i)
+        m_shards[i].reset(new Shard(*this, m_tile_key_hasher, shard_memory_limit));
+
+    if (m_params.m_prefetch_tiles)
+    {
+        m_prefetch_func.reset(new PrefetchThread(*this));
+        m_prefetch_thread.reset(
+            new boost::thread(
+                ThreadFunctionWrapper<PrefetchThread>(m_prefetch_func.get())));
+    }
 }
 
-void TextureStore::TileSwapper::load(const TileKey& key, TileRecord& record)
+TextureStore::~TextureStore()
+{
+    if (m_prefetch_thread.get())
+    {
+        {
+            boost::mutex::scoped_lock lock(m_prefetch_mutex);
+            m_prefetch_abort = true;
+        }
+
+        m_prefetch_event.notify_all();
+        m_prefetch_thread->join();
+    }
+}
+
+StatisticsVector TextureStore::get_statistics() const
+{
+    Statistics stats;
+    size_t peak_memory_size = 0;
+    uint64 coalesced_miss_count = 0;
+
+    for (size_t i = 0; i < ShardCount; ++i)
+    {
+        const Shard& shard = *m_shards[i];
+        stats.merge(make_single_stage_cache_stats(shard.m_tile_cache));
+        peak_memory_size += shard.m_tile_swapper.get_peak_memory_size();
+        coalesced_miss_count += shard.m_coalesced_miss_count;
+    }
+
+    stats.insert_size("peak size", peak_memory_size);
+    stats.insert("coalesced misses", coalesced_miss_count);
+
+    if (m_params.m_prefetch_tiles)
+        stats.insert("prefetched tiles", m_prefetched_tile_count);
+
+    return StatisticsVector::make("texture store statistics", stats);
+}
+
+void TextureStore::gather_assemblies(const AssemblyContainer& assemblies)
+{
+    for (const_each<AssemblyContainer> i = assemblies; i; ++i)
+    {
+        m_assemblies[i->get_uid()] = &*i;
+        gather_assemblies(i->assemblies());
+    }
+}
+
+TextureStore::Shard& TextureStore::get_shard(const TileKey& key)
+{
+    return *m_shards[m_tile_key_hasher(key) & (ShardCount - 1)];
+}
+
+TextureStore::TileRecord& TextureStore::acquire(
+    const TileKey&      key,
+    const bool          prefetch)
+{
+    Shard& shard = get_shard(key);
+    boost::mutex::scoped_lock lock(shard.m_mutex);
+
+    TileRecord& record = shard.m_tile_cache.get(key);
+    atomic_inc(&record.m_owners);
+
+    // If another thread is already loading this tile, wait for it instead of loading it again.
+    if (record.m_state == TileRecord::Loading)
+    {
+        ++shard.m_coalesced_miss_count;
+
+        do
+        {
+            shard.m_tile_loaded.wait(lock);
+        } while (record.m_state == TileRecord::Loading);
+    }
+
+    if (record.m_state == TileRecord::Unloaded)
+    {
+        // Read and decode the tile without holding the lock. The cache line cannot
+        // be evicted in the meantime since we are one of its owners.
+        record.m_state = TileRecord::Loading;
+        lock.unlock();
+
+        Texture* texture = get_texture(key);
+        Tile* tile;
+
+        try
+        {
+            tile = load_tile(key, *texture);
+        }
+        catch (const exception&)
+        {
+            // Let waiting threads try again.
+            lock.lock();
+            record.m_state = TileRecord::Unloaded;
+            atomic_dec(&record.m_owners);
+            shard.m_tile_loaded.notify_all();
+            throw;
+        }
+
+        lock.lock();
+        record.m_tile = tile;
+        record.m_state = TileRecord::Loaded;
+        shard.m_tile_swapper.track_loaded_tile(*tile);
+        lock.unlock();
+
+        shard.m_tile_loaded.notify_all();
+
+        if (prefetch)
+            prefetch_neighbors(key, *texture);
+    }
+
+    assert(record.m_tile);
+
+    return record;
+}
+
+Texture* TextureStore::get_texture(const TileKey& key) const
 {
     // Fetch the texture container.
     const TextureContainer& textures =
         key.m_assembly_uid == ~UniqueID(0)
             ? m_scene.textures()
-            : m_assemblies[key.m_assembly_uid]->textures();
+            : m_assemblies.find(key.m_assembly_uid)->second->textures();
 
     // Fetch the texture.
-    Texture* texture = textures.get_by_uid(key.m_texture_uid);
+    return textures.get_by_uid(key.m_texture_uid);
+}
 
+Tile* TextureStore::load_tile(const TileKey& key, Texture& texture)
+{
     if (m_params.m_track_tile_loading)
     {
         RENDERER_LOG_DEBUG(
-            "loading tile (" FMT_SIZE_T ", " FMT_SIZE_T ") "
+            "loading tile (" FMT_SIZE_T ", " FMT_SIZE_T ") of level " FMT_SIZE_T " "
             "from texture \"%s\"...",
             key.get_tile_x(),
             key.get_tile_y(),
-            texture->get_path().c_str());
+            key.get_level(),
+            texture.get_path().c_str());
+    }
+
+    if (key.m_level > 0)
+    {
+        // Release the tiles of the finer level when leaving this scope, including
+        // when acquiring one of them or generating the tile throws.
+        struct ParentTileRecords
+          : public NonCopyable
+        {
+            const TextureStore&     m_store;
+            TileRecord*             m_records[4];
+
+            explicit ParentTileRecords(const TextureStore& store)
+              : m_store(store)
+            {
+                for (size_t i = 0; i < 4; ++i)
+                    m_records[i] = nullptr;
+            }
+
+            ~ParentTileRecords()
+            {
+                for (size_t i = 0; i < 4; ++i)
+                {
+                    if (m_records[i])
+                        m_store.release(*m_records[i]);
+                }
+            }
+        };
+
+        // Fetch the tiles of the finer level covered by this tile.
+        const CanvasProperties parent_props =
+            get_mipmap_level_properties(texture.properties(), key.get_level() - 1);
+        ParentTileRecords parent_records(*this);
+        const Tile* parent_tiles[4] = { nullptr, nullptr, nullptr, nullptr };
+        for (size_t i = 0; i < 4; ++i)
+        {
+            const size_t parent_tile_x = 2 * key.get_tile_x() + (i & 1);
+            const size_t parent_tile_y = 2 * key.get_tile_y() + (i >> 1);
+
+            if (parent_tile_x < parent_props.m_tile_count_x &&
+                parent_tile_y < parent_props.m_tile_count_y)
+            {
+                parent_records.m_records[i] =
+                    &acquire(
+                        TileKey(
+                            key.m_assembly_uid,
+                            key.m_texture_uid,
+                            parent_tile_x,
+                            parent_tile_y,
+                            key.get_level() - 1),
+                        false);
+                parent_tiles[i] = parent_records.m_records[i]->m_tile;
+            }
+        }
+
+        // Tiles of the finer level are already in the linear RGB color space.
+        return create_mipmap_tile(parent_props, key.get_tile_x(), key.get_tile_y(), parent_tiles);
     }
 
     // Load the tile.
-    record.m_tile = texture->load_tile(key.get_tile_x(), key.get_tile_y());
-    record.m_owners = 0;
+    Tile* tile = texture.load_tile(key.get_tile_x(), key.get_tile_y());
 
     // Convert the tile to the linear RGB color space.
-    switch (texture->get_color_space())
+    switch (texture.get_color_space())
     {
       case ColorSpaceLinearRGB:
         break;
 
       case ColorSpaceSRGB:
-        convert_tile_srgb_to_linear_rgb(*record.m_tile);
+        convert_tile_srgb_to_linear_rgb(*tile);
         break;
 
       case ColorSpaceCIEXYZ:
-        convert_tile_ciexyz_to_linear_rgb(*record.m_tile);
+        convert_tile_ciexyz_to_linear_rgb(*tile);
         break;
 
       assert_otherwise;
     }
 
+    return tile;
+}
+
+void TextureStore::prefetch_neighbors(const TileKey& key, Texture& texture)
+{
+    const CanvasProperties& texture_props = texture.properties();
+    const CanvasProperties props = get_mipmap_level_properties(texture_props, key.get_level());
+    const size_t tile_x = key.get_tile_x();
+    const size_t tile_y = key.get_tile_y();
+    const size_t level = key.get_level();
+
+    boost::mutex::scoped_lock lock(m_prefetch_mutex);
+
+    // Drop prefetch requests rather than letting the queue grow unbounded.
+    if (m_prefetch_queue.size() + 5 > MaxPrefetchQueueSize)
+        return;
+
+    if (tile_x > 0)
+        m_prefetch_queue.emplace_back(key.m_assembly_uid, key.m_texture_uid, tile_x - 1, tile_y, level);
+    if (tile_x + 1 < props.m_tile_count_x)
+        m_prefetch_queue.emplace_back(key.m_assembly_uid, key.m_texture_uid, tile_x + 1, tile_y, level);
+    if (tile_y > 0)
+        m_prefetch_queue.emplace_back(key.m_assembly_uid, key.m_texture_uid, tile_x, tile_y - 1, level);
+    if (tile_y + 1 < props.m_tile_count_y)
+        m_prefetch_queue.emplace_back(key.m_assembly_uid, key.m_texture_uid, tile_x, tile_y + 1, level);
+    if (level + 1 < get_mipmap_level_count(texture_props))
+        m_prefetch_queue.emplace_back(key.m_assembly_uid, key.m_texture_uid, tile_x / 2, tile_y / 2, level + 1);
+
+    lock.unlock();
+
+    m_prefetch_event.notify_one();
+}
+
+
+//
+// TextureStore::Shard class implementation.
+//
+
+TextureStore::Shard::Shard(
+    const TextureStore&     store,
+    TileKeyHasher&          tile_key_hasher,
+    const size_t            memory_limit)
+  : m_tile_swapper(store, memory_limit)
+  , m_tile_cache(tile_key_hasher, m_tile_swapper)
+  , m_coalesced_miss_count(0)
+{
+}
+
+
+//
+// TextureStore::TileSwapper class implementation.
+//
+
+TextureStore::TileSwapper::TileSwapper(
+    const TextureStore& store,
+    const size_t        memory_limit)
+  : m_store(store)
+  , m_memory_limit(memory_limit)
+  , m_memory_size(0)
+  , m_peak_memory_size(0)
+{
+}
+
+void TextureStore::TileSwapper::load(const TileKey& key, TileRecord& record)
+{
+    record.m_tile = nullptr;
+    record.m_owners = 0;
+    record.m_state = TileRecord::Unloaded;
+}
+
+void TextureStore::TileSwapper::track_loaded_tile(const Tile& tile)
+{
     // Track the amount of memory used by the tile cache.
-    m_memory_size += record.m_tile->get_memory_size();
+    m_memory_size += tile.get_memory_size();
     m_peak_memory_size = max(m_peak_memory_size, m_memory_size);
 
-    if (m_params.m_track_store_size)
+    if (m_store.m_params.m_track_store_size)
     {
-        if (m_memory_size > m_params.m_memory_limit)
+        if (m_memory_size > m_memory_limit)
         {
             RENDERER_LOG_DEBUG(
-                "texture store size is %s, exceeding capacity %s by %s",
+                "texture store shard size is %s, exceeding capacity %s by %s",
                 pretty_size(m_memory_size).c_str(),
-                pretty_size(m_params.m_memory_limit).c_str(),
-                pretty_size(m_memory_size - m_params.m_memory_limit).c_str());
+                pretty_size(m_memory_limit).c_str(),
+                pretty_size(m_memory_size - m_memory_limit).c_str());
         }
         else
         {
             RENDERER_LOG_DEBUG(
-                "texture store size is %s, below capacity %s by %s",
+                "texture store shard size is %s, below capacity %s by %s",
                 pretty_size(m_memory_size).c_str(),
-                pretty_size(m_params.m_memory_limit).c_str(),
-                pretty_size(m_params.m_memory_limit - m_memory_size).c_str());
+                pretty_size(m_memory_limit).c_str(),
+                pretty_size(m_memory_limit - m_memory_size).c_str());
         }
     }
 }
@@ -247,53 +549,46 @@ bool TextureStore::TileSwapper::unload(const TileKey& key, TileRecord& record)
     if (atomic_read(&record.m_owners) > 0)
         return false;
 
+    // Cache lines whose tile failed to load hold no tile.
+    if (record.m_state != TileRecord::Loaded)
+        return true;
+
     // Track the amount of memory used by the tile cache.
     const size_t tile_memory_size = record.m_tile->get_memory_size();
     assert(m_memory_size >= tile_memory_size);
     m_memory_size -= tile_memory_size;
 
-    // Fetch the texture container.
-    const TextureContainer& textures =
-        key.m_assembly_uid == ~UniqueID(0)
-            ? m_scene.textures()
-            : m_assemblies[key.m_assembly_uid]->textures();
-
     // Fetch the texture.
-    Texture* texture = textures.get_by_uid(key.m_texture_uid);
+    Texture* texture = m_store.get_texture(key);
 
-    if (m_params.m_track_tile_unloading)
+    if (m_store.m_params.m_track_tile_unloading)
     {
         RENDERER_LOG_DEBUG(
-            "unloading tile (" FMT_SIZE_T ", " FMT_SIZE_T ") "
+            "unloading tile (" FMT_SIZE_T ", " FMT_SIZE_T ") of level " FMT_SIZE_T " "
             "from texture \"%s\"...",
             key.get_tile_x(),
             key.get_tile_y(),
+            key.get_level(),
             texture->get_path().c_str());
     }
 
-    // Unload the tile.
-    texture->unload_tile(key.get_tile_x(), key.get_tile_y(), record.m_tile);
+    // Unload the tile. Tiles of mipmap levels other than 0 are owned by the store.
+    if (key.m_level > 0)
+        delete record.m_tile;
+    else texture->unload_tile(key.get_tile_x(), key.get_tile_y(), record.m_tile);
 
     // Successfully unloaded the tile.
     return true;
 }
 
-void TextureStore::TileSwapper::gather_assemblies(const AssemblyContainer& assemblies)
-{
-    for (const_each<AssemblyContainer> i = assemblies; i; ++i)
-    {
-        m_assemblies[i->get_uid()] = &*i;
-        gather_assemblies(i->assemblies());
-    }
-}
-
 
 //
-// TextureStore::TileSwapper::Parameters class implementation.
+// TextureStore::Parameters class implementation.
 //
 
-TextureStore::TileSwapper::Parameters::Parameters(const ParamArray& params)
+TextureStore::Parameters::Parameters(const ParamArray& params)
   : m_memory_limit(params.get_optional<size_t>("max_size", 256 * 1024 * 1024))
+  , m_prefetch_tiles(params.get_optional<bool>("prefetch_tiles", false))
   , m_track_tile_loading(params.get_optional<bool>("track_tile_loading", false))
   , m_track_tile_unloading(params.get_optional<bool>("track_tile_unloading", false))
   , m_track_store_size(params.get_optional<bool>("track_store_size", false))
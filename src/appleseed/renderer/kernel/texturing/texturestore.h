@@ -41,10 +41,15 @@
 #include "foundation/utility/cache.h"
 #include "foundation/utility/uid.h"
 
+// Boost headers.
+#include "boost/thread/condition_variable.hpp"
+
 // Standard headers.
 #include <cassert>
 #include <cstddef>
+#include <deque>
 #include <map>
+#include <memory>
 
 // Forward declarations.
 namespace foundation    { class Dictionary; }
@@ -52,6 +57,7 @@ namespace foundation    { class StatisticsVector; }
 namespace foundation    { class Tile; }
 namespace renderer      { class ParamArray; }
 namespace renderer      { class Scene; }
+namespace renderer      { class Texture; }
 
 namespace renderer
 {
@@ -59,6 +65,15 @@ namespace renderer
 //
 // A shared store for texture tiles (the backend of the thread-local texture cache).
 //
+// The store is split into a number of shards, each protected by its own lock, so
+// that threads missing in their texture cache rarely contend with each other.
+// Tiles are read and decoded outside of the locks, and concurrent misses on the
+// same tile are coalesced: only one thread loads the tile while the others wait.
+// Optionally, the neighbors of loaded tiles are prefetched by a background thread.
+//
+// Tiles of mipmap levels other than 0 are generated on demand by box-filtering
+// the tiles of the finer level, which are themselves fetched from the store.
+//
 
 class TextureStore
   : public foundation::NonCopyable
@@ -70,6 +85,7 @@ class TextureStore
         foundation::UniqueID    m_assembly_uid;
         foundation::UniqueID    m_texture_uid;
         foundation::uint32      m_tile_xy;
+        foundation::uint32      m_level;            // mipmap level, 0 is the texture itself
 
         TileKey();
 
@@ -77,17 +93,14 @@ class TextureStore
             const foundation::UniqueID  assembly_uid,
             const foundation::UniqueID  texture_uid,
             const size_t                tile_x,
-            const size_t                tile_y);
-
-        TileKey(
-            const foundation::UniqueID  assembly_uid,
-            const foundation::UniqueID  texture_uid,
-            const foundation::uint32    tile_xy);
+            const size_t                tile_y,
+            const size_t                level = 0);
 
         TileKey(const TileKey& rhs);
 
         size_t get_tile_x() const;
         size_t get_tile_y() const;
+        size_t get_level() const;
 
         // Return an invalid key.
         static TileKey invalid();
@@ -105,8 +118,16 @@ class TextureStore
 
     struct TileRecord
     {
+        enum State
+        {
+            Unloaded,
+            Loading,
+            Loaded
+        };
+
         foundation::Tile*           m_tile;
         volatile foundation::uint32 m_owners;
+        State                       m_state;        // protected by the lock of the shard
     };
 
     // Return parameters metadata.
@@ -120,6 +141,9 @@ class TextureStore
         const Scene&        scene,
         const ParamArray&   params = ParamArray());
 
+    // Destructor.
+    ~TextureStore();
+
     // Acquire an element from the store. Thread-safe.
     TileRecord& acquire(const TileKey& key);
 
@@ -130,16 +154,28 @@ class TextureStore
     foundation::StatisticsVector get_statistics() const;
 
   private:
+    struct Parameters
+    {
+        const size_t    m_memory_limit;
+        const bool      m_prefetch_tiles;
+        const bool      m_track_tile_loading;
+        const bool      m_track_tile_unloading;
+        const bool      m_track_store_size;
+
+        explicit Parameters(const ParamArray& params);
+    };
+
     class TileSwapper
       : public foundation::NonCopyable
     {
       public:
         // Constructor.
         TileSwapper(
-            const Scene&        scene,
-            const ParamArray&   params);
+            const TextureStore& store,
+            const size_t        memory_limit);
 
-        // Load a cache line.
+        // Load a cache line. Only reserves the cache line, the tile itself
+        // is loaded by TextureStore::acquire() outside of the shard's lock.
         void load(const TileKey& key, TileRecord& record);
 
         // Unload a cache line.
@@ -148,29 +184,17 @@ class TextureStore
         // Return true if the cache is full, false otherwise.
         bool is_full(const size_t element_count) const;
 
+        // Account for a tile that was just loaded into a cache line.
+        void track_loaded_tile(const foundation::Tile& tile);
+
         // Return the peak memory size in bytes of the tile cache.
         size_t get_peak_memory_size() const;
 
       private:
-        struct Parameters
-        {
-            const size_t    m_memory_limit;
-            const bool      m_track_tile_loading;
-            const bool      m_track_tile_unloading;
-            const bool      m_track_store_size;
-
-            explicit Parameters(const ParamArray& params);
-        };
-
-        typedef std::map<foundation::UniqueID, const Assembly*> AssemblyMap;
-
-        const Scene&        m_scene;
-        const Parameters    m_params;
+        const TextureStore& m_store;
+        const size_t        m_memory_limit;
         size_t              m_memory_size;
         size_t              m_peak_memory_size;
-        AssemblyMap         m_assemblies;
-
-        void gather_assemblies(const AssemblyContainer& assemblies);
     };
 
     typedef foundation::LRUCache<
@@ -180,10 +204,58 @@ class TextureStore
         TileSwapper
     > TileCache;
 
-    boost::mutex            m_mutex;
-    TileKeyHasher           m_tile_key_hasher;
-    TileSwapper             m_tile_swapper;
-    TileCache               m_tile_cache;
+    struct Shard
+      : public foundation::NonCopyable
+    {
+        boost::mutex                m_mutex;
+        boost::condition_variable   m_tile_loaded;
+        TileSwapper                 m_tile_swapper;
+        TileCache                   m_tile_cache;
+        foundation::uint64          m_coalesced_miss_count;
+
+        Shard(
+            const TextureStore&     store,
+            TileKeyHasher&          tile_key_hasher,
+            const size_t            memory_limit);
+    };
+
+    class PrefetchThread;
+
+    enum { ShardCount = 16 };       // must be a power of two
+    enum { MaxPrefetchQueueSize = 1024 };
+
+    typedef std::map<foundation::UniqueID, const Assembly*> AssemblyMap;
+
+    const Scene&                    m_scene;
+    const Parameters                m_params;
+    AssemblyMap                     m_assemblies;
+    TileKeyHasher                   m_tile_key_hasher;
+    std::unique_ptr<Shard>          m_shards[ShardCount];
+
+    boost::mutex                    m_prefetch_mutex;
+    boost::condition_variable       m_prefetch_event;
+    std::deque<TileKey>             m_prefetch_queue;
+    bool                            m_prefetch_abort;
+    foundation::uint64              m_prefetched_tile_count;
+    std::unique_ptr<PrefetchThread> m_prefetch_func;
+    std::unique_ptr<boost::thread>  m_prefetch_thread;
+
+    void gather_assemblies(const AssemblyContainer& assemblies);
+
+    Shard& get_shard(const TileKey& key);
+
+    TileRecord& acquire(const TileKey& key, const bool prefetch);
+
+    // Fetch the texture of a tile.
+    Texture* get_texture(const TileKey& key) const;
+
+    // Read, decode and convert a tile to the linear RGB color space,
+    // or generate it from the finer mipmap level. Thread-safe.
+    foundation::Tile* load_tile(const TileKey& key, Texture& texture);
+
+    // Schedule the loading of the neighbors of a tile, and of the tile covering it
+    // in the next mipmap level, by the prefetch thread.
+    void prefetch_neighbors(const TileKey& key, Texture& texture);
 };
 
 
@@ -193,12 +265,7 @@ class TextureStore
 
 inline TextureStore::TileRecord& TextureStore::acquire(const TileKey& key)
 {
-    boost::mutex::scoped_lock lock(m_mutex);
-
-    TileRecord& record = m_tile_cache.get(key);
-    foundation::atomic_inc(&record.m_owners);
-
-    return record;
+    return acquire(key, m_params.m_prefetch_tiles);
 }
 
 inline void TextureStore::release(TileRecord& record) const
@@ -220,29 +287,22 @@ inline TextureStore::TileKey::TileKey(
     const foundation::UniqueID  assembly_uid,
     const foundation::UniqueID  texture_uid,
     const size_t                tile_x,
-    const size_t                tile_y)
+    const size_t                tile_y,
+    const size_t                level)
   : m_assembly_uid(assembly_uid)
   , m_texture_uid(texture_uid)
   , m_tile_xy(static_cast<foundation::uint32>((tile_y << 16) | tile_x))
+  , m_level(static_cast<foundation::uint32>(level))
 {
     assert(tile_x < (1UL << 16));
     assert(tile_y < (1UL << 16));
 }
 
-inline TextureStore::TileKey::TileKey(
-    const foundation::UniqueID  assembly_uid,
-    const foundation::UniqueID  texture_uid,
-    const foundation::uint32    tile_xy)
-  : m_assembly_uid(assembly_uid)
-  , m_texture_uid(texture_uid)
-  , m_tile_xy(tile_xy)
-{
-}
-
 inline TextureStore::TileKey::TileKey(const TileKey& rhs)
   : m_assembly_uid(rhs.m_assembly_uid)
   , m_texture_uid(rhs.m_texture_uid)
   , m_tile_xy(rhs.m_tile_xy)
+  , m_level(rhs.m_level)
 {
 }
 
@@ -256,19 +316,26 @@ inline size_t TextureStore::TileKey::get_tile_y() const
     return static_cast<size_t>(m_tile_xy >> 16);
 }
 
+inline size_t TextureStore::TileKey::get_level() const
+{
+    return static_cast<size_t>(m_level);
+}
+
 inline TextureStore::TileKey TextureStore::TileKey::invalid()
 {
-    return
-        TileKey(
-            ~foundation::UniqueID(0),   // assembly unique ID
-            ~foundation::UniqueID(0),   // texture unique ID
-            ~foundation::uint32(0));    // tile X and Y coordinates
+    TileKey key;
+    key.m_assembly_uid = ~foundation::UniqueID(0);
+    key.m_texture_uid = ~foundation::UniqueID(0);
+    key.m_tile_xy = ~foundation::uint32(0);
+    key.m_level = ~foundation::uint32(0);
+    return key;
 }
 
 inline bool TextureStore::TileKey::operator==(const TileKey& rhs) const
 {
     return
         m_tile_xy == rhs.m_tile_xy &&
+        m_level == rhs.m_level &&
         m_texture_uid == rhs.m_texture_uid &&
         m_assembly_uid == rhs.m_assembly_uid;
 }
@@ -283,7 +350,9 @@ inline bool TextureStore::TileKey::operator<(const TileKey& rhs) const
     return
         m_assembly_uid == rhs.m_assembly_uid ?
             m_texture_uid == rhs.m_texture_uid ?
-                m_tile_xy < rhs.m_tile_xy :
+                m_level == rhs.m_level ?
+                    m_tile_xy < rhs.m_tile_xy :
+                m_level < rhs.m_level :
             m_texture_uid < rhs.m_texture_uid :
         m_assembly_uid < rhs.m_assembly_uid;
 }
@@ -299,7 +368,8 @@ inline size_t TextureStore::TileKeyHasher::operator()(const TileKey& key) const
         foundation::mix_uint32(
             static_cast<foundation::uint32>(key.m_assembly_uid),
             static_cast<foundation::uint32>(key.m_texture_uid),
-            static_cast<foundation::uint32>(key.m_tile_xy));
+            static_cast<foundation::uint32>(key.m_tile_xy),
+            static_cast<foundation::uint32>(key.m_level));
 }
 
 
@@ -309,7 +379,7 @@ inline size_t TextureStore::TileKeyHasher::operator()(const TileKey& key) const
 
 inline bool TextureStore::TileSwapper::is_full(const size_t element_count) const
 {
-    return m_memory_size >= m_params.m_memory_limit;
+    return m_memory_size >= m_memory_limit;
 }
 
 inline size_t TextureStore::TileSwapper::get_peak_memory_size() const
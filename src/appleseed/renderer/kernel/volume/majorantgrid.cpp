@@ -0,0 +1,95 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "majorantgrid.h"
+
+// appleseed.renderer headers.
+#include "renderer/kernel/volume/sparsevoxelgrid.h"
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+//
+// MajorantGrid class implementation.
+//
+
+MajorantGrid::MajorantGrid(const SparseVoxelGrid& grid)
+  : m_max_majorant(0.0f)
+{
+    const size_t B = SparseVoxelGrid::BlockSize;
+    const size_t voxel_res[3] = { grid.get_xres(), grid.get_yres(), grid.get_zres() };
+    const size_t block_res[3] = { grid.get_block_xres(), grid.get_block_yres(), grid.get_block_zres() };
+
+    // Cells span BlockSize voxel intervals, i.e. BlockSize / (res - 1) in the unit cube.
+    for (size_t i = 0; i < 3; ++i)
+    {
+        if (voxel_res[i] > 1)
+        {
+            m_res[i] = (voxel_res[i] - 1 + B - 1) / B;
+            m_cell_size[i] = static_cast<float>(B) / (voxel_res[i] - 1);
+        }
+        else
+        {
+            m_res[i] = 1;
+            m_cell_size[i] = 1.0f;
+        }
+    }
+
+    m_majorants.resize(m_res[0] * m_res[1] * m_res[2]);
+
+    // Values interpolated inside a cell depend on the voxels of the block of the cell,
+    // and on the first voxels of the next blocks along each axis.
+    for (size_t z = 0; z < m_res[2]; ++z)
+    {
+        for (size_t y = 0; y < m_res[1]; ++y)
+        {
+            for (size_t x = 0; x < m_res[0]; ++x)
+            {
+                float majorant = 0.0f;
+
+                for (size_t bz = z, bz_end = min(z + 2, block_res[2]); bz < bz_end; ++bz)
+                {
+                    for (size_t by = y, by_end = min(y + 2, block_res[1]); by < by_end; ++by)
+                    {
+                        for (size_t bx = x, bx_end = min(x + 2, block_res[0]); bx < bx_end; ++bx)
+                            majorant = max(majorant, grid.get_block_max(bx, by, bz));
+                    }
+                }
+
+                m_majorants[(z * m_res[1] + y) * m_res[0] + x] = majorant;
+                m_max_majorant = max(m_max_majorant, majorant);
+            }
+        }
+    }
+}
+
+}   // namespace renderer
@@ -0,0 +1,225 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Forward declarations.
+namespace renderer  { class SparseVoxelGrid; }
+
+namespace renderer
+{
+
+//
+// A coarse grid of upper bounds (majorants) of the interpolated values of a sparse
+// voxel grid, with one cell per block of voxels.
+//
+// Majorants are computed from the maxima of the blocks, so building this grid
+// doesn't require any voxel to be loaded. Cells sit on top of the unit cube [0,1]^3.
+//
+
+class MajorantGrid
+  : public foundation::NonCopyable
+{
+  public:
+    // Constructor.
+    explicit MajorantGrid(const SparseVoxelGrid& grid);
+
+    // Return the resolution of the grid.
+    size_t get_xres() const;
+    size_t get_yres() const;
+    size_t get_zres() const;
+
+    // Return the majorant of a given cell.
+    float get_majorant(
+        const size_t                    x,
+        const size_t                    y,
+        const size_t                    z) const;
+
+    // Return the largest majorant of the grid.
+    float get_max_majorant() const;
+
+    // Walk the cells pierced by the segment [tmin, tmax] of a ray, in front-to-back order,
+    // and call visitor(t0, t1, majorant) for each of them until the visitor returns false.
+    // The ray must be expressed in the unit cube [0,1]^3; its direction needs not be unit-length.
+    template <typename Visitor>
+    void traverse(
+        const foundation::Vector3f&     org,
+        const foundation::Vector3f&     dir,
+        float                           tmin,
+        float                           tmax,
+        Visitor&                        visitor) const;
+
+  private:
+    size_t                              m_res[3];
+    foundation::Vector3f                m_cell_size;
+    std::vector<float>                  m_majorants;
+    float                               m_max_majorant;
+};
+
+
+//
+// MajorantGrid class implementation.
+//
+
+inline size_t MajorantGrid::get_xres() const
+{
+    return m_res[0];
+}
+
+inline size_t MajorantGrid::get_yres() const
+{
+    return m_res[1];
+}
+
+inline size_t MajorantGrid::get_zres() const
+{
+    return m_res[2];
+}
+
+inline float MajorantGrid::get_majorant(
+    const size_t                        x,
+    const size_t                        y,
+    const size_t                        z) const
+{
+    assert(x < m_res[0]);
+    assert(y < m_res[1]);
+    assert(z < m_res[2]);
+
+    return m_majorants[(z * m_res[1] + y) * m_res[0] + x];
+}
+
+inline float MajorantGrid::get_max_majorant() const
+{
+    return m_max_majorant;
+}
+
+template <typename Visitor>
+void MajorantGrid::traverse(
+    const foundation::Vector3f&         org,
+    const foundation::Vector3f&         dir,
+    float                               tmin,
+    float                               tmax,
+    Visitor&                            visitor) const
+{
+    // Clip the segment against the unit cube.
+    for (size_t i = 0; i < 3; ++i)
+    {
+        if (dir[i] == 0.0f)
+        {
+            if (org[i] < 0.0f || org[i] > 1.0f)
+                return;
+        }
+        else
+        {
+            const float rcp_dir = 1.0f / dir[i];
+            const float t0 = (0.0f - org[i]) * rcp_dir;
+            const float t1 = (1.0f - org[i]) * rcp_dir;
+            tmin = std::max(tmin, std::min(t0, t1));
+            tmax = std::min(tmax, std::max(t0, t1));
+        }
+    }
+
+    if (!(tmin < tmax))
+        return;
+
+    // Find the cell containing the entry point and prepare stepping along each axis.
+    const foundation::Vector3f entry = org + tmin * dir;
+    size_t cell[3];
+    int step[3];
+    float t_next[3], t_delta[3];
+    for (size_t i = 0; i < 3; ++i)
+    {
+        cell[i] =
+            std::min(
+                foundation::truncate<size_t>(std::max(entry[i], 0.0f) / m_cell_size[i]),
+                m_res[i] - 1);
+
+        if (dir[i] > 0.0f)
+        {
+            step[i] = 1;
+            t_next[i] = ((cell[i] + 1) * m_cell_size[i] - org[i]) / dir[i];
+            t_delta[i] = m_cell_size[i] / dir[i];
+        }
+        else if (dir[i] < 0.0f)
+        {
+            step[i] = -1;
+            t_next[i] = (cell[i] * m_cell_size[i] - org[i]) / dir[i];
+            t_delta[i] = -m_cell_size[i] / dir[i];
+        }
+        else
+        {
+            step[i] = 0;
+            t_next[i] = std::numeric_limits<float>::max();
+            t_delta[i] = 0.0f;
+        }
+    }
+
+    float t = tmin;
+
+    while (true)
+    {
+        // Find the axis along which the next cell boundary is crossed.
+        const size_t axis =
+            t_next[0] < t_next[1]
+                ? (t_next[0] < t_next[2] ? 0 : 2)
+                : (t_next[1] < t_next[2] ? 1 : 2);
+
+        const float t_exit = std::min(t_next[axis], tmax);
+
+        if (t < t_exit)
+        {
+            if (!visitor(t, t_exit, get_majorant(cell[0], cell[1], cell[2])))
+                return;
+        }
+
+        if (t_exit >= tmax)
+            return;
+
+        // Move to the next cell.
+        if (step[axis] > 0 ? cell[axis] + 1 == m_res[axis] : cell[axis] == 0)
+            return;
+
+        cell[axis] = step[axis] > 0 ? cell[axis] + 1 : cell[axis] - 1;
+        t = t_exit;
+        t_next[axis] += t_delta[axis];
+    }
+}
+
+}   // namespace renderer
@@ -0,0 +1,372 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "sparsevoxelgrid.h"
+
+// appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/scalar.h"
+#include "foundation/utility/cc.h"
+
+// Standard headers.
+#include <algorithm>
+#include <utility>
+
+using namespace foundation;
+using namespace std;
+
+namespace renderer
+{
+
+//
+// SparseVoxelGrid class implementation.
+//
+
+namespace
+{
+    size_t block_count(const size_t res)
+    {
+        return (res + SparseVoxelGrid::BlockSize - 1) / SparseVoxelGrid::BlockSize;
+    }
+}
+
+SparseVoxelGrid::SparseVoxelGrid(
+    const size_t        xres,
+    const size_t        yres,
+    const size_t        zres,
+    const AABB3f&       bbox)
+  : m_xres(xres)
+  , m_yres(yres)
+  , m_zres(zres)
+  , m_block_xres(block_count(xres))
+  , m_block_yres(block_count(yres))
+  , m_block_zres(block_count(zres))
+  , m_bbox(bbox)
+  , m_loaded_block_count(0)
+{
+    assert(xres > 0);
+    assert(yres > 0);
+    assert(zres > 0);
+
+    const size_t count = m_block_xres * m_block_yres * m_block_zres;
+
+    m_block_max.assign(count, 0.0f);
+    m_block_offsets.assign(count, 0);
+    m_blocks.reset(new BlockPointer[count]);
+    m_block_storage.resize(count);
+
+    for (size_t i = 0; i < count; ++i)
+        m_blocks[i].store(nullptr, boost::memory_order_relaxed);
+}
+
+void SparseVoxelGrid::set_voxel(
+    const size_t        x,
+    const size_t        y,
+    const size_t        z,
+    const float         value)
+{
+    assert(x < m_xres);
+    assert(y < m_yres);
+    assert(z < m_zres);
+
+    const size_t index = block_index(x, y, z);
+    float* block = const_cast<float*>(get_block(index));
+
+    if (block == nullptr)
+    {
+        // Don't allocate blocks to store zeros.
+        if (value == 0.0f)
+            return;
+
+        m_block_storage[index].reset(new float[BlockVoxelCount]);
+        block = m_block_storage[index].get();
+        fill(block, block + BlockVoxelCount, 0.0f);
+        m_blocks[index].store(block, boost::memory_order_release);
+        ++m_loaded_block_count;
+    }
+
+    block[voxel_index(x, y, z)] = value;
+
+    // Block maxima are upper bounds until the grid is written to disk.
+    m_block_max[index] = max(m_block_max[index], value);
+}
+
+size_t SparseVoxelGrid::get_stored_block_count() const
+{
+    size_t count = 0;
+
+    for (size_t i = 0, e = m_block_offsets.size(); i < e; ++i)
+    {
+        if (m_block_offsets[i] != 0 || m_blocks[i].load(boost::memory_order_acquire) != nullptr)
+            ++count;
+    }
+
+    return count;
+}
+
+size_t SparseVoxelGrid::get_loaded_block_count() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_loaded_block_count;
+}
+
+float SparseVoxelGrid::linear_lookup(const Vector3f& point) const
+{
+    // Compute the coordinates of the voxel containing the lookup point.
+    const float x = saturate(point.x) * (m_xres - 1);
+    const float y = saturate(point.y) * (m_yres - 1);
+    const float z = saturate(point.z) * (m_zres - 1);
+    const size_t ix0 = min(truncate<size_t>(x), m_xres - 1);
+    const size_t iy0 = min(truncate<size_t>(y), m_yres - 1);
+    const size_t iz0 = min(truncate<size_t>(z), m_zres - 1);
+    const size_t ix1 = min(ix0 + 1, m_xres - 1);
+    const size_t iy1 = min(iy0 + 1, m_yres - 1);
+    const size_t iz1 = min(iz0 + 1, m_zres - 1);
+
+    // Fetch the values of the eight surrounding voxels.
+    float v000, v100, v010, v110, v001, v101, v011, v111;
+    if (ix0 / BlockSize == ix1 / BlockSize &&
+        iy0 / BlockSize == iy1 / BlockSize &&
+        iz0 / BlockSize == iz1 / BlockSize)
+    {
+        // Fast path: all voxels belong to the same block.
+        const float* block = get_block(block_index(ix0, iy0, iz0));
+        if (block == nullptr)
+            return 0.0f;
+
+        v000 = block[voxel_index(ix0, iy0, iz0)];
+        v100 = block[voxel_index(ix1, iy0, iz0)];
+        v010 = block[voxel_index(ix0, iy1, iz0)];
+        v110 = block[voxel_index(ix1, iy1, iz0)];
+        v001 = block[voxel_index(ix0, iy0, iz1)];
+        v101 = block[voxel_index(ix1, iy0, iz1)];
+        v011 = block[voxel_index(ix0, iy1, iz1)];
+        v111 = block[voxel_index(ix1, iy1, iz1)];
+    }
+    else
+    {
+        v000 = get_voxel(ix0, iy0, iz0);
+        v100 = get_voxel(ix1, iy0, iz0);
+        v010 = get_voxel(ix0, iy1, iz0);
+        v110 = get_voxel(ix1, iy1, iz0);
+        v001 = get_voxel(ix0, iy0, iz1);
+        v101 = get_voxel(ix1, iy0, iz1);
+        v011 = get_voxel(ix0, iy1, iz1);
+        v111 = get_voxel(ix1, iy1, iz1);
+    }
+
+    // Blend.
+    const float wx = x - ix0;
+    const float wy = y - iy0;
+    const float wz = z - iz0;
+    const float v00 = lerp(v000, v100, wx);
+    const float v10 = lerp(v010, v110, wx);
+    const float v01 = lerp(v001, v101, wx);
+    const float v11 = lerp(v011, v111, wx);
+    return lerp(lerp(v00, v10, wy), lerp(v01, v11, wy), wz);
+}
+
+const float* SparseVoxelGrid::load_block(const size_t index) const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    // Another thread may have loaded the block while we were waiting.
+    const float* block = m_blocks[index].load(boost::memory_order_acquire);
+    if (block != nullptr)
+        return block;
+
+    unique_ptr<float[]> storage(new float[BlockVoxelCount]);
+
+    m_file.clear();
+    m_file.seekg(static_cast<streamoff>(m_block_offsets[index]));
+    m_file.read(reinterpret_cast<char*>(storage.get()), BlockVoxelCount * sizeof(float));
+
+    if (!m_file)
+    {
+        RENDERER_LOG_ERROR(
+            "failed to read voxels from sparse voxel grid file %s.",
+            m_filename.c_str());
+
+        // Don't try again.
+        fill(storage.get(), storage.get() + BlockVoxelCount, 0.0f);
+    }
+
+    block = storage.get();
+    m_block_storage[index] = move(storage);
+    m_blocks[index].store(block, boost::memory_order_release);
+    ++m_loaded_block_count;
+
+    return block;
+}
+
+
+//
+// Sparse voxel grid I/O.
+//
+
+namespace
+{
+    const uint32 SparseVoxelGridMagic = CC32('S', 'P', 'V', 'G');
+    const uint32 SparseVoxelGridVersion = 1;
+
+    const size_t HeaderSize = 6 * sizeof(uint32) + 6 * sizeof(float);
+    const size_t BlockEntrySize = sizeof(uint64) + sizeof(float);
+
+    template <typename T>
+    bool read_value(istream& file, T& value)
+    {
+        file.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return !file.fail();
+    }
+
+    template <typename T>
+    void write_value(ostream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+}
+
+unique_ptr<SparseVoxelGrid> read_sparse_voxel_grid(const char* filename)
+{
+    assert(filename);
+
+    ifstream file(filename, ios::in | ios::binary);
+
+    if (!file.is_open())
+        return unique_ptr<SparseVoxelGrid>(nullptr);
+
+    // Read and check the header.
+    uint32 magic, version, xres, yres, zres, block_size;
+    Vector3f bbox_min, bbox_max;
+    if (!read_value(file, magic) ||
+        !read_value(file, version) ||
+        !read_value(file, xres) ||
+        !read_value(file, yres) ||
+        !read_value(file, zres) ||
+        !read_value(file, block_size) ||
+        !read_value(file, bbox_min) ||
+        !read_value(file, bbox_max))
+        return unique_ptr<SparseVoxelGrid>(nullptr);
+
+    if (magic != SparseVoxelGridMagic ||
+        version != SparseVoxelGridVersion ||
+        block_size != SparseVoxelGrid::BlockSize ||
+        xres == 0 || yres == 0 || zres == 0)
+        return unique_ptr<SparseVoxelGrid>(nullptr);
+
+    unique_ptr<SparseVoxelGrid> grid(
+        new SparseVoxelGrid(xres, yres, zres, AABB3f(bbox_min, bbox_max)));
+
+    // Read the table of blocks.
+    for (size_t i = 0, e = grid->m_block_offsets.size(); i < e; ++i)
+    {
+        if (!read_value(file, grid->m_block_offsets[i]) ||
+            !read_value(file, grid->m_block_max[i]))
+            return unique_ptr<SparseVoxelGrid>(nullptr);
+    }
+
+    // Keep the file open to stream voxels in.
+    file.close();
+    grid->m_file.open(filename, ios::in | ios::binary);
+    grid->m_filename = filename;
+
+    if (!grid->m_file.is_open())
+        return unique_ptr<SparseVoxelGrid>(nullptr);
+
+    return grid;
+}
+
+bool write_sparse_voxel_grid(
+    const char*                 filename,
+    const SparseVoxelGrid&      grid)
+{
+    assert(filename);
+
+    ofstream file(filename, ios::out | ios::binary);
+
+    if (!file.is_open())
+        return false;
+
+    const size_t block_count = grid.m_block_offsets.size();
+
+    // Collect the blocks to store and compute their exact maxima.
+    vector<const float*> blocks(block_count, nullptr);
+    vector<float> block_max(block_count, 0.0f);
+    for (size_t i = 0; i < block_count; ++i)
+    {
+        const float* block = grid.get_block(i);
+        if (block == nullptr)
+            continue;
+
+        const float* block_end = block + SparseVoxelGrid::BlockVoxelCount;
+        if (find_if(block, block_end, [](const float v) { return v != 0.0f; }) == block_end)
+            continue;
+
+        blocks[i] = block;
+        block_max[i] = max(*max_element(block, block_end), 0.0f);
+    }
+
+    // Write the header.
+    write_value(file, SparseVoxelGridMagic);
+    write_value(file, SparseVoxelGridVersion);
+    write_value(file, static_cast<uint32>(grid.get_xres()));
+    write_value(file, static_cast<uint32>(grid.get_yres()));
+    write_value(file, static_cast<uint32>(grid.get_zres()));
+    write_value(file, static_cast<uint32>(SparseVoxelGrid::BlockSize));
+    write_value(file, grid.get_bbox().min);
+    write_value(file, grid.get_bbox().max);
+
+    // Write the table of blocks.
+    uint64 offset = HeaderSize + block_count * BlockEntrySize;
+    for (size_t i = 0; i < block_count; ++i)
+    {
+        write_value(file, blocks[i] != nullptr ? offset : uint64(0));
+        write_value(file, block_max[i]);
+
+        if (blocks[i] != nullptr)
+            offset += SparseVoxelGrid::BlockVoxelCount * sizeof(float);
+    }
+
+    // Write the voxels.
+    for (size_t i = 0; i < block_count; ++i)
+    {
+        if (blocks[i] != nullptr)
+        {
+            file.write(
+                reinterpret_cast<const char*>(blocks[i]),
+                SparseVoxelGrid::BlockVoxelCount * sizeof(float));
+        }
+    }
+
+    return !file.fail();
+}
+
+}   // namespace renderer
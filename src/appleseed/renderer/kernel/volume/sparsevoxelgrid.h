@@ -0,0 +1,277 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/vector.h"
+#include "foundation/platform/atomic.h"
+#include "foundation/platform/types.h"
+
+// Boost headers.
+#include "boost/thread/mutex.hpp"
+
+// Standard headers.
+#include <cassert>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace renderer
+{
+
+//
+// A sparse grid of scalar voxels, typically densities.
+//
+// Voxels are allocated in cubic blocks of BlockSize^3 voxels. Blocks in which all
+// voxels are zero are not stored. Like in foundation::VoxelGrid3, voxels sit at the
+// corners of the cells that subdivide the unit cube [0,1]^3, which is mapped to the
+// bounding box of the grid.
+//
+// Grids read from disk are streamed: only the table of blocks is read upfront, and
+// the voxels of a block are read the first time one of them is accessed. Accessing
+// voxels is thread-safe; modifying them is not.
+//
+
+class SparseVoxelGrid
+  : public foundation::NonCopyable
+{
+  public:
+    static const size_t BlockSize = 8;
+    static const size_t BlockVoxelCount = BlockSize * BlockSize * BlockSize;
+
+    // Constructor, creates a grid where all voxels are zero.
+    SparseVoxelGrid(
+        const size_t                    xres,
+        const size_t                    yres,
+        const size_t                    zres,
+        const foundation::AABB3f&       bbox);
+
+    // Return the resolution of the grid, in voxels.
+    size_t get_xres() const;
+    size_t get_yres() const;
+    size_t get_zres() const;
+
+    // Return the resolution of the grid, in blocks.
+    size_t get_block_xres() const;
+    size_t get_block_yres() const;
+    size_t get_block_zres() const;
+
+    // Return the bounding box of the grid.
+    const foundation::AABB3f& get_bbox() const;
+
+    // Set the value of a given voxel.
+    void set_voxel(
+        const size_t                    x,
+        const size_t                    y,
+        const size_t                    z,
+        const float                     value);
+
+    // Return the value of a given voxel.
+    float get_voxel(
+        const size_t                    x,
+        const size_t                    y,
+        const size_t                    z) const;
+
+    // Return the largest voxel value in a given block. Zero for blocks that are not stored.
+    // This doesn't require the voxels of the block to be loaded.
+    float get_block_max(
+        const size_t                    bx,
+        const size_t                    by,
+        const size_t                    bz) const;
+
+    // Return the number of blocks that are stored, and the number of those that are loaded.
+    size_t get_stored_block_count() const;
+    size_t get_loaded_block_count() const;
+
+    // Perform a trilinearly interpolated lookup of the grid.
+    // 'point' must be expressed in the unit cube [0,1]^3.
+    float linear_lookup(const foundation::Vector3f& point) const;
+
+  private:
+    friend std::unique_ptr<SparseVoxelGrid> read_sparse_voxel_grid(const char* filename);
+    friend bool write_sparse_voxel_grid(const char* filename, const SparseVoxelGrid& grid);
+
+    typedef boost::atomic<const float*> BlockPointer;
+
+    const size_t                        m_xres;
+    const size_t                        m_yres;
+    const size_t                        m_zres;
+    const size_t                        m_block_xres;
+    const size_t                        m_block_yres;
+    const size_t                        m_block_zres;
+    const foundation::AABB3f            m_bbox;
+
+    std::vector<float>                  m_block_max;
+    std::vector<foundation::uint64>     m_block_offsets;    // position of each block in the file, 0 if not stored
+    std::unique_ptr<BlockPointer[]>     m_blocks;           // voxels of each block, nullptr if not loaded
+
+    mutable boost::mutex                m_mutex;
+    mutable std::vector<std::unique_ptr<float[]>> m_block_storage;
+    mutable size_t                      m_loaded_block_count;
+    mutable std::ifstream               m_file;
+    std::string                         m_filename;
+
+    size_t block_index(
+        const size_t                    x,
+        const size_t                    y,
+        const size_t                    z) const;
+
+    static size_t voxel_index(
+        const size_t                    x,
+        const size_t                    y,
+        const size_t                    z);
+
+    // Return the voxels of a given block, or nullptr if all of them are zero.
+    const float* get_block(const size_t index) const;
+    const float* load_block(const size_t index) const;
+};
+
+
+//
+// Sparse voxel grid I/O.
+//
+// A sparse voxel grid file made of the following parts, in native byte order:
+//
+//   - a header: the 'SPVG' magic number, the format version, the resolution of the
+//     grid, the size of the blocks and the bounding box of the grid (uint32 values
+//     followed by six float values)
+//
+//   - the table of blocks, in x, then y, then z order: for each block, its position
+//     in the file or 0 if it isn't stored (uint64), and the largest of its values (float)
+//
+//   - the voxels of the stored blocks, BlockSize^3 float values per block in x, then
+//     y, then z order
+//
+
+// Open a sparse voxel grid file. Returns nullptr if the file can't be read.
+std::unique_ptr<SparseVoxelGrid> read_sparse_voxel_grid(const char* filename);
+
+// Write a sparse voxel grid file. Returns true on success.
+bool write_sparse_voxel_grid(
+    const char*                         filename,
+    const SparseVoxelGrid&              grid);
+
+
+//
+// SparseVoxelGrid class implementation.
+//
+
+inline size_t SparseVoxelGrid::get_xres() const
+{
+    return m_xres;
+}
+
+inline size_t SparseVoxelGrid::get_yres() const
+{
+    return m_yres;
+}
+
+inline size_t SparseVoxelGrid::get_zres() const
+{
+    return m_zres;
+}
+
+inline size_t SparseVoxelGrid::get_block_xres() const
+{
+    return m_block_xres;
+}
+
+inline size_t SparseVoxelGrid::get_block_yres() const
+{
+    return m_block_yres;
+}
+
+inline size_t SparseVoxelGrid::get_block_zres() const
+{
+    return m_block_zres;
+}
+
+inline const foundation::AABB3f& SparseVoxelGrid::get_bbox() const
+{
+    return m_bbox;
+}
+
+inline float SparseVoxelGrid::get_voxel(
+    const size_t                        x,
+    const size_t                        y,
+    const size_t                        z) const
+{
+    assert(x < m_xres);
+    assert(y < m_yres);
+    assert(z < m_zres);
+
+    const float* block = get_block(block_index(x, y, z));
+    return block != nullptr ? block[voxel_index(x, y, z)] : 0.0f;
+}
+
+inline float SparseVoxelGrid::get_block_max(
+    const size_t                        bx,
+    const size_t                        by,
+    const size_t                        bz) const
+{
+    assert(bx < m_block_xres);
+    assert(by < m_block_yres);
+    assert(bz < m_block_zres);
+
+    return m_block_max[(bz * m_block_yres + by) * m_block_xres + bx];
+}
+
+inline size_t SparseVoxelGrid::block_index(
+    const size_t                        x,
+    const size_t                        y,
+    const size_t                        z) const
+{
+    return
+        ((z / BlockSize) * m_block_yres + y / BlockSize) * m_block_xres + x / BlockSize;
+}
+
+inline size_t SparseVoxelGrid::voxel_index(
+    const size_t                        x,
+    const size_t                        y,
+    const size_t                        z)
+{
+    return
+        ((z % BlockSize) * BlockSize + y % BlockSize) * BlockSize + x % BlockSize;
+}
+
+inline const float* SparseVoxelGrid::get_block(const size_t index) const
+{
+    const float* block = m_blocks[index].load(boost::memory_order_acquire);
+
+    if (block == nullptr && m_block_offsets[index] != 0)
+        block = load_block(index);
+
+    return block;
+}
+
+}   // namespace renderer
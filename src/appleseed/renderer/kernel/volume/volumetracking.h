@@ -0,0 +1,283 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/volume/majorantgrid.h"
+#include "renderer/kernel/volume/sparsevoxelgrid.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/vector.h"
+
+// Standard headers.
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
+namespace renderer
+{
+
+//
+// Free-flight tracking in heterogeneous media whose coefficients are the product of
+// a density, looked up in a sparse voxel grid, and of spectra that are constant over
+// the medium.
+//
+// Tentative collisions are sampled cell by cell according to the majorant grid. The
+// majorant of each cell is scaled by the largest extinction over all wavelengths so
+// that a single stream of tentative collisions serves all wavelengths at once.
+//
+// Rays are expressed in the unit cube [0,1]^3 covered by the grids; since this space
+// is obtained by scaling world space along each axis, distances along rays are kept.
+//
+// References:
+//
+//   Residual Ratio Tracking for Estimating Attenuation in Participating Media
+//   Jan Novak, Andrew Selle, Wojciech Jarosz
+//   ACM Transactions on Graphics 33 (6), SIGGRAPH Asia 2014
+//
+//   Spectral and Decomposition Tracking for Rendering Heterogeneous Volumes
+//   Peter Kutz, Ralf Habel, Yining Karl Li, Jan Novak
+//   ACM Transactions on Graphics 36 (4), SIGGRAPH 2017
+//
+
+// Estimate the transmission along the segment [0, distance] of a ray using ratio tracking.
+// The estimate is unbiased.
+template <typename RNG>
+void ratio_tracking(
+    const SparseVoxelGrid&          grid,
+    const MajorantGrid&             majorants,
+    const foundation::Vector3f&     org,
+    const foundation::Vector3f&     dir,
+    const float                     distance,
+    const Spectrum&                 extinction,         // extinction coefficient at unit density
+    RNG&                            rng,
+    Spectrum&                       transmission);
+
+// Sample a scattering event along the segment [0, distance] of a ray using spectral
+// tracking. Return true if a scattering event happens, false if the ray leaves the
+// segment. In both cases, weight is multiplied by the corresponding throughput factor,
+// which includes the scattering coefficient at the scattering event.
+template <typename RNG>
+bool spectral_tracking(
+    const SparseVoxelGrid&          grid,
+    const MajorantGrid&             majorants,
+    const foundation::Vector3f&     org,
+    const foundation::Vector3f&     dir,
+    const float                     distance,
+    const Spectrum&                 extinction,         // extinction coefficient at unit density
+    const Spectrum&                 scattering,         // scattering coefficient at unit density
+    RNG&                            rng,
+    float&                          scattering_distance,
+    Spectrum&                       weight);
+
+
+//
+// Implementation.
+//
+
+namespace volume_tracking_impl
+{
+    // Transmission below which ratio tracking plays Russian Roulette.
+    const float RouletteThreshold = 0.1f;
+
+    template <typename RNG>
+    struct RatioTrackingVisitor
+    {
+        const SparseVoxelGrid&          m_grid;
+        const foundation::Vector3f&     m_org;
+        const foundation::Vector3f&     m_dir;
+        const Spectrum&                 m_extinction;
+        const float                     m_max_extinction;
+        RNG&                            m_rng;
+        Spectrum&                       m_transmission;
+
+        bool operator()(const float t0, const float t1, const float majorant)
+        {
+            const float mu = majorant * m_max_extinction;
+            if (mu <= 0.0f)
+                return true;
+
+            float t = t0;
+
+            while (true)
+            {
+                t -= std::log(1.0f - foundation::rand_float2(m_rng)) / mu;
+                if (t >= t1)
+                    return true;
+
+                const float density = m_grid.linear_lookup(m_org + t * m_dir);
+
+                for (size_t i = 0, e = Spectrum::size(); i < e; ++i)
+                    m_transmission[i] *= 1.0f - density * m_extinction[i] / mu;
+
+                // Russian Roulette on low transmission.
+                if (foundation::max_value(m_transmission) < RouletteThreshold)
+                {
+                    if (foundation::rand_float2(m_rng) >= 0.5f)
+                    {
+                        m_transmission.set(0.0f);
+                        return false;
+                    }
+
+                    m_transmission *= 2.0f;
+                }
+            }
+        }
+    };
+
+    template <typename RNG>
+    struct SpectralTrackingVisitor
+    {
+        const SparseVoxelGrid&          m_grid;
+        const foundation::Vector3f&     m_org;
+        const foundation::Vector3f&     m_dir;
+        const Spectrum&                 m_extinction;
+        const Spectrum&                 m_scattering;
+        const float                     m_max_extinction;
+        RNG&                            m_rng;
+        Spectrum&                       m_weight;
+        bool                            m_scattered;
+        float                           m_scattering_distance;
+
+        bool operator()(const float t0, const float t1, const float majorant)
+        {
+            const float mu = majorant * m_max_extinction;
+            if (mu <= 0.0f)
+                return true;
+
+            float t = t0;
+
+            while (true)
+            {
+                t -= std::log(1.0f - foundation::rand_float2(m_rng)) / mu;
+                if (t >= t1)
+                    return true;
+
+                const float density = m_grid.linear_lookup(m_org + t * m_dir);
+
+                // Choose between a real and a null collision, with probabilities
+                // proportional to the largest weighted coefficients.
+                float real_prob = 0.0f, null_prob = 0.0f;
+                for (size_t i = 0, e = Spectrum::size(); i < e; ++i)
+                {
+                    const float sigma_t = density * m_extinction[i];
+                    real_prob = std::max(real_prob, m_weight[i] * sigma_t);
+                    null_prob = std::max(null_prob, m_weight[i] * (mu - sigma_t));
+                }
+
+                const float sum = real_prob + null_prob;
+                if (sum <= 0.0f)
+                {
+                    m_weight.set(0.0f);
+                    return false;
+                }
+
+                real_prob /= sum;
+
+                if (foundation::rand_float2(m_rng) < real_prob)
+                {
+                    // Real collision: scatter.
+                    m_weight *= m_scattering * (density / (mu * real_prob));
+                    m_scattered = true;
+                    m_scattering_distance = t;
+                    return false;
+                }
+
+                // Null collision: keep going.
+                const float rcp_null_prob = 1.0f / (mu * (1.0f - real_prob));
+                for (size_t i = 0, e = Spectrum::size(); i < e; ++i)
+                    m_weight[i] *= (mu - density * m_extinction[i]) * rcp_null_prob;
+            }
+        }
+    };
+}
+
+template <typename RNG>
+void ratio_tracking(
+    const SparseVoxelGrid&          grid,
+    const MajorantGrid&             majorants,
+    const foundation::Vector3f&     org,
+    const foundation::Vector3f&     dir,
+    const float                     distance,
+    const Spectrum&                 extinction,
+    RNG&                            rng,
+    Spectrum&                       transmission)
+{
+    transmission.set(1.0f);
+
+    volume_tracking_impl::RatioTrackingVisitor<RNG> visitor =
+    {
+        grid,
+        org,
+        dir,
+        extinction,
+        foundation::max_value(extinction),
+        rng,
+        transmission
+    };
+
+    majorants.traverse(org, dir, 0.0f, distance, visitor);
+}
+
+template <typename RNG>
+bool spectral_tracking(
+    const SparseVoxelGrid&          grid,
+    const MajorantGrid&             majorants,
+    const foundation::Vector3f&     org,
+    const foundation::Vector3f&     dir,
+    const float                     distance,
+    const Spectrum&                 extinction,
+    const Spectrum&                 scattering,
+    RNG&                            rng,
+    float&                          scattering_distance,
+    Spectrum&                       weight)
+{
+    volume_tracking_impl::SpectralTrackingVisitor<RNG> visitor =
+    {
+        grid,
+        org,
+        dir,
+        extinction,
+        scattering,
+        foundation::max_value(extinction),
+        rng,
+        weight,
+        false,
+        0.0f
+    };
+
+    majorants.traverse(org, dir, 0.0f, distance, visitor);
+
+    scattering_distance = visitor.m_scattering_distance;
+    return visitor.m_scattered;
+}
+
+}   // namespace renderer
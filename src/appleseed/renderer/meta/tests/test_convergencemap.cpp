@@ -0,0 +1,163 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/kernel/rendering/convergencemap.h"
+#include "renderer/kernel/rendering/sample.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/color.h"
+#include "foundation/math/aabb.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Rendering_ConvergenceMap)
+{
+    const size_t Width = 32;
+    const size_t Height = 32;
+
+    // Store a given number of samples in every pixel of the frame, for pixels in [x0, x1).
+    template <typename ValueFunc>
+    void store_samples(
+        ConvergenceMap&     map,
+        const size_t        x0,
+        const size_t        x1,
+        const size_t        samples_per_pixel,
+        ValueFunc&          value)
+    {
+        vector<Sample> samples;
+
+        for (size_t s = 0; s < samples_per_pixel; ++s)
+        {
+            samples.clear();
+
+            for (size_t y = 0; y < Height; ++y)
+            {
+                for (size_t x = x0; x < x1; ++x)
+                {
+                    Sample sample;
+                    sample.m_position = Vector2f((x + 0.5f) / Width, (y + 0.5f) / Height);
+                    sample.m_color = Color4f(value(), 0.0f, 0.0f, 1.0f);
+                    samples.push_back(sample);
+                }
+            }
+
+            map.store_samples(samples.size(), &samples[0]);
+            map.update();
+        }
+    }
+
+    struct ConstantValue
+    {
+        float operator()() const
+        {
+            return 0.5f;
+        }
+    };
+
+    struct NoisyValue
+    {
+        MersenneTwister m_rng;
+
+        float operator()()
+        {
+            return rand1<float>(m_rng) < 0.1f ? 10.0f : 0.0f;
+        }
+    };
+
+    TEST_CASE(Update_ConstantSamples_ConvergesAfterMinSamples)
+    {
+        ConvergenceMap map(Width, Height, AABB2u(Vector2u(0, 0), Vector2u(Width - 1, Height - 1)), 0.1f, 8, 16);
+        ConstantValue value;
+
+        store_samples(map, 0, Width, 7, value);
+        EXPECT_FALSE(map.is_converged());
+
+        store_samples(map, 0, Width, 2, value);
+        EXPECT_TRUE(map.is_converged());
+        EXPECT_EQ(4, map.get_converged_block_count());
+    }
+
+    TEST_CASE(Update_NoisySamples_DoesNotConverge)
+    {
+        ConvergenceMap map(Width, Height, AABB2u(Vector2u(0, 0), Vector2u(Width - 1, Height - 1)), 0.01f, 8, 16);
+        NoisyValue value;
+
+        store_samples(map, 0, Width, 64, value);
+
+        EXPECT_FALSE(map.is_converged());
+        EXPECT_EQ(0, map.get_converged_block_count());
+    }
+
+    TEST_CASE(IsConverged_GivenPosition_ReflectsConvergenceOfBlock)
+    {
+        ConvergenceMap map(Width, Height, AABB2u(Vector2u(0, 0), Vector2u(Width - 1, Height - 1)), 0.1f, 8, 16);
+        ConstantValue value;
+
+        // Only sample the left half of the frame.
+        store_samples(map, 0, Width / 2, 16, value);
+
+        EXPECT_FALSE(map.is_converged());
+        EXPECT_EQ(2, map.get_converged_block_count());
+        EXPECT_TRUE(map.is_converged(Vector2f(0.25f, 0.25f)));
+        EXPECT_TRUE(map.is_converged(Vector2f(0.25f, 0.75f)));
+        EXPECT_FALSE(map.is_converged(Vector2f(0.75f, 0.25f)));
+        EXPECT_FALSE(map.is_converged(Vector2f(0.75f, 0.75f)));
+    }
+
+    TEST_CASE(IsConverged_GivenPositionOutsideCropWindow_ReturnsTrue)
+    {
+        ConvergenceMap map(Width, Height, AABB2u(Vector2u(8, 8), Vector2u(15, 15)), 0.1f, 8, 16);
+
+        EXPECT_FALSE(map.is_converged(Vector2f(0.375f, 0.375f)));
+        EXPECT_TRUE(map.is_converged(Vector2f(0.1f, 0.1f)));
+        EXPECT_TRUE(map.is_converged(Vector2f(0.75f, 0.375f)));
+    }
+
+    TEST_CASE(Clear_AfterConvergence_ResetsConvergence)
+    {
+        ConvergenceMap map(Width, Height, AABB2u(Vector2u(0, 0), Vector2u(Width - 1, Height - 1)), 0.1f, 8, 16);
+        ConstantValue value;
+
+        store_samples(map, 0, Width, 16, value);
+        map.clear();
+
+        EXPECT_FALSE(map.is_converged());
+        EXPECT_EQ(0, map.get_converged_block_count());
+    }
+}
@@ -27,16 +27,21 @@
 //
 
 // appleseed.renderer headers.
+#include "renderer/modeling/color/colorspace.h"
 #include "renderer/utility/dynamicspectrum.h"
 #include "renderer/utility/iostreamop.h"
 
 // appleseed.foundation headers.
 #include "foundation/image/color.h"
+#include "foundation/image/colorspace.h"
+#include "foundation/image/regularspectrum.h"
+#include "foundation/utility/iostreamop.h"
 #include "foundation/utility/test.h"
 
 // Standard headers.
 #include <cmath>
 #include <cstddef>
+#include <vector>
 
 using namespace foundation;
 using namespace renderer;
@@ -73,6 +78,36 @@ TEST_SUITE(Renderer_Utility_DynamicSpectrum31f)
         }
     };
 
+    struct HeroFixture
+    {
+        const DynamicSpectrum31f::Mode m_old_mode;
+
+        HeroFixture()
+          : m_old_mode(DynamicSpectrum31f::set_mode(DynamicSpectrum31f::Hero))
+        {
+        }
+
+        ~HeroFixture()
+        {
+            DynamicSpectrum31f::set_mode(m_old_mode);
+        }
+    };
+
+    const float SpectrumValues[31] =
+    {
+        0.443686705734f, 0.403421349896f, 0.33453223163f,
+        0.0831074685536f, 0.0694405423347f, 0.0564898798988f,
+        0.438460619098f, 0.0640074755165f, 0.0033867778534f,
+        0.000715336120232f, 0.0212863156003f, 0.345451712652f,
+        0.215243428209f, 0.039138078502f, 0.211764794452f,
+        0.222335340883f, 0.306847305494f, 0.483241077594f,
+        0.453785266829f, 0.225251255181f, 0.248279963757f,
+        0.380971410264f, 0.307149063876f, 0.108512568244f,
+        0.121817780577f, 0.157592770342f, 0.199367690804f,
+        0.394424421483f, 0.116243008551f, 0.322975710956f,
+        0.181880153577f
+    };
+
     TEST_CASE_F(Lerp_Spectral, SpectralFixture)
     {
         static const float AValues[31] =
@@ -208,4 +243,88 @@ TEST_SUITE(Renderer_Utility_DynamicSpectrum31f)
         for (size_t i = 0, e = x.size(); i < e; ++i)
             EXPECT_FEQ(sqrt(Values[i]), result[i]);
     }
+
+    TEST_CASE_F(GetWavelengthIndex_Hero_EachWavelengthBelongsToExactlyOneSet, HeroFixture)
+    {
+        std::vector<size_t> counts(31, 0);
+
+        for (size_t set = 0; set < DynamicSpectrum31f::HeroSetCount; ++set)
+        {
+            DynamicSpectrum31f::select_hero_wavelengths(set);
+
+            for (size_t i = 0, e = DynamicSpectrum31f::size(); i < e; ++i)
+                ++counts[DynamicSpectrum31f::get_wavelength_index(i)];
+        }
+
+        DynamicSpectrum31f::select_all_wavelengths();
+
+        for (size_t w = 0; w < 31; ++w)
+            EXPECT_EQ(1, counts[w]);
+    }
+
+    TEST_CASE_F(Set_Hero_GivenSpectrumComputedWithAllWavelengths_SelectsHeroWavelengths, HeroFixture)
+    {
+        const LightingConditions lighting_conditions(IlluminantCIED65, XYZCMFCIE19312Deg);
+
+        const DynamicSpectrum31f s(
+            RegularSpectrum31f::from_array(SpectrumValues),
+            lighting_conditions,
+            DynamicSpectrum31f::Reflectance);
+
+        DynamicSpectrum31f::select_hero_wavelengths(3);
+
+        const DynamicSpectrum31f t = s * s;
+
+        ASSERT_EQ(4, DynamicSpectrum31f::size());
+
+        for (size_t i = 0; i < 4; ++i)
+        {
+            const float value = SpectrumValues[DynamicSpectrum31f::get_wavelength_index(i)];
+            EXPECT_EQ(value, s[i]);
+            EXPECT_FEQ(value * value, t[i]);
+        }
+
+        DynamicSpectrum31f::select_all_wavelengths();
+    }
+
+    TEST_CASE_F(ToCIEXYZ_Hero_AverageOverSetsMatchesSpectralResult, HeroFixture)
+    {
+        const LightingConditions lighting_conditions(IlluminantCIED65, XYZCMFCIE19312Deg);
+        const RegularSpectrum31f spectrum = RegularSpectrum31f::from_array(SpectrumValues);
+
+        const DynamicSpectrum31f s(
+            spectrum,
+            lighting_conditions,
+            DynamicSpectrum31f::Reflectance);
+
+        Color3f average(0.0f);
+
+        for (size_t set = 0; set < DynamicSpectrum31f::HeroSetCount; ++set)
+        {
+            DynamicSpectrum31f::select_hero_wavelengths(set);
+            average += s.to_ciexyz(lighting_conditions);
+        }
+
+        DynamicSpectrum31f::select_all_wavelengths();
+
+        average /= static_cast<float>(DynamicSpectrum31f::HeroSetCount);
+
+        const Color3f expected = spectrum_to_ciexyz<float>(lighting_conditions, spectrum);
+        EXPECT_FEQ_EPS(expected, average, 1.0e-4f);
+        EXPECT_FEQ_EPS(expected, s.to_ciexyz(lighting_conditions), 1.0e-4f);
+    }
+
+    TEST_CASE_F(MaxValue_Hero_GivenLastSetOfHeroWavelengths_IgnoresPadding, HeroFixture)
+    {
+        DynamicSpectrum31f::select_hero_wavelengths(DynamicSpectrum31f::HeroSetCount - 1);
+
+        DynamicSpectrum31f s(1.0f);
+        s[1] = 2.0f;
+
+        EXPECT_EQ(3, DynamicSpectrum31f::size());
+        EXPECT_EQ(2.0f, max_value(s));
+        EXPECT_EQ(1.0f, min_value(s));
+
+        DynamicSpectrum31f::select_all_wavelengths();
+    }
 }
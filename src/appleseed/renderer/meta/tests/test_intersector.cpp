@@ -31,27 +31,38 @@
 #include "renderer/global/globaltypes.h"
 #include "renderer/kernel/intersection/intersector.h"
 #include "renderer/kernel/intersection/tracecontext.h"
+#include "renderer/kernel/intersection/triangletree.h"
 #include "renderer/kernel/shading/shadingpoint.h"
 #include "renderer/kernel/shading/shadingray.h"
 #include "renderer/kernel/texturing/texturecache.h"
 #include "renderer/kernel/texturing/texturestore.h"
+#include "renderer/modeling/object/meshobject.h"
 #include "renderer/modeling/object/object.h"
+#include "renderer/modeling/object/triangle.h"
 #include "renderer/modeling/scene/assembly.h"
 #include "renderer/modeling/scene/assemblyinstance.h"
 #include "renderer/modeling/scene/containers.h"
 #include "renderer/modeling/scene/objectinstance.h"
 #include "renderer/modeling/scene/scene.h"
 #include "renderer/modeling/scene/visibilityflags.h"
+#include "renderer/utility/bbox.h"
 #include "renderer/utility/paramarray.h"
 #include "renderer/utility/testutils.h"
 
 // appleseed.foundation headers.
 #include "foundation/math/matrix.h"
+#include "foundation/math/scalar.h"
 #include "foundation/math/transform.h"
 #include "foundation/math/vector.h"
 #include "foundation/utility/autoreleaseptr.h"
 #include "foundation/utility/containers/dictionary.h"
+#include "foundation/utility/iostreamop.h"
 #include "foundation/utility/test.h"
+#include "foundation/utility/uid.h"
+
+// Standard headers.
+#include <cmath>
+#include <cstddef>
 
 using namespace foundation;
 using namespace renderer;
@@ -146,6 +157,436 @@ TEST_SUITE(Renderer_Kernel_Intersection_Intersector)
         EXPECT_FALSE(hit);
     }
 
+    TEST_CASE_F(TraceProbe_GivenRayStreamMissingScene_ReturnsNoHits, Fixture<false>)
+    {
+        ShadingRay rays[16];
+        for (size_t i = 0; i < 16; ++i)
+        {
+            rays[i] =
+                ShadingRay(
+                    Vector3d(static_cast<double>(i), 0.0, 2.0),
+                    Vector3d(0.0, 0.0, i & 1 ? -1.0 : 1.0),
+                    0.0,                        // tmin
+                    2.0,                        // tmax
+                    ShadingRay::Time(),
+                    VisibilityFlags::ProbeRay,
+                    0);                         // depth
+        }
+
+        bool hits[16];
+        const size_t hit_count = m_intersector.trace_probe(rays, 16, hits);
+
+        EXPECT_EQ(0, hit_count);
+        for (size_t i = 0; i < 16; ++i)
+            EXPECT_FALSE(hits[i]);
+    }
+
+    struct PlaneInstancesTestScene
+      : public TestSceneBase
+    {
+        explicit PlaneInstancesTestScene(const ParamArray& assembly_params)
+        {
+            auto_release_ptr<Assembly> assembly(
+                AssemblyFactory().create("assembly", assembly_params));
+
+            auto_release_ptr<MeshObject> mesh_object(
+                MeshObjectFactory().create("plane", ParamArray()));
+            mesh_object->push_vertex(GVector3(0.0f, -0.5f, -0.5f));
+            mesh_object->push_vertex(GVector3(0.0f, +0.5f, -0.5f));
+            mesh_object->push_vertex(GVector3(0.0f, +0.5f, +0.5f));
+            mesh_object->push_vertex(GVector3(0.0f, -0.5f, +0.5f));
+            mesh_object->push_triangle(Triangle(0, 1, 2, 0));
+            mesh_object->push_triangle(Triangle(2, 3, 0, 0));
+            assembly->objects().insert(auto_release_ptr<Object>(mesh_object.release()));
+
+            create_plane_instance(assembly.ref(), "plane_inst_0", Vector3d(0.0, 0.0, -2.0));
+            create_plane_instance(assembly.ref(), "plane_inst_1", Vector3d(0.0, 0.0, +2.0));
+            create_plane_instance(assembly.ref(), "plane_inst_2", Vector3d(1.0, 0.0, +2.0));
+
+            m_scene.assembly_instances().insert(
+                auto_release_ptr<AssemblyInstance>(
+                    AssemblyInstanceFactory::create(
+                        "assembly_instance",
+                        ParamArray(),
+                        "assembly")));
+
+            m_scene.assemblies().insert(assembly);
+        }
+
+        static void create_plane_instance(
+            Assembly&           assembly,
+            const char*         name,
+            const Vector3d&     position)
+        {
+            assembly.object_instances().insert(
+                ObjectInstanceFactory::create(
+                    name,
+                    ParamArray(),
+                    "plane",
+                    Transformd::from_local_to_parent(
+                        Matrix4d::make_translation(position)),
+                    StringDictionary()));
+        }
+    };
+
+    struct InstancedMeshTestScene
+      : public PlaneInstancesTestScene
+    {
+        // Instance the plane rather than flattening it, despite its low triangle count.
+        InstancedMeshTestScene()
+          : PlaneInstancesTestScene(
+                ParamArray()
+                    .insert_path("acceleration_structure.object_instancing_min_triangles", 1))
+        {
+        }
+    };
+
+    struct CompactLeavesTestScene
+      : public PlaneInstancesTestScene
+    {
+        // Flatten the plane instances into a triangle tree with compact leaves.
+        CompactLeavesTestScene()
+          : PlaneInstancesTestScene(
+                ParamArray()
+                    .insert_path("acceleration_structure.object_instancing", false)
+                    .insert_path("acceleration_structure.leaf_format", "compact"))
+        {
+        }
+    };
+
+    template <typename TestScene>
+    struct PlaneInstancesFixture
+      : public StaticTestSceneContext<TestScene>
+    {
+        TraceContext    m_trace_context;
+        TextureStore    m_texture_store;
+        TextureCache    m_texture_cache;
+        Intersector     m_intersector;
+
+        PlaneInstancesFixture()
+          : m_trace_context(StaticTestSceneContext<TestScene>::m_scene)
+          , m_texture_store(StaticTestSceneContext<TestScene>::m_scene)
+          , m_texture_cache(m_texture_store)
+          , m_intersector(m_trace_context, m_texture_cache)
+        {
+            m_trace_context.update();
+        }
+
+        static ShadingRay make_ray(const double z)
+        {
+            return
+                ShadingRay(
+                    Vector3d(-2.0, 0.0, z),
+                    Vector3d(1.0, 0.0, 0.0),
+                    0.0,                        // tmin
+                    10.0,                       // tmax
+                    ShadingRay::Time(),
+                    VisibilityFlags::CameraRay,
+                    0);                         // depth
+        }
+    };
+
+    typedef PlaneInstancesFixture<InstancedMeshTestScene> InstancedMeshFixture;
+    typedef PlaneInstancesFixture<CompactLeavesTestScene> CompactLeavesFixture;
+
+    TEST_CASE_F(Trace_GivenRayHittingInstancedMesh_ReturnsClosestObjectInstance, InstancedMeshFixture)
+    {
+        ShadingPoint shading_point;
+        const bool hit = m_intersector.trace(make_ray(2.0), shading_point);
+
+        ASSERT_TRUE(hit);
+        EXPECT_EQ(1, shading_point.get_object_instance_index());
+        EXPECT_FEQ(2.0, shading_point.get_distance());
+        EXPECT_FEQ(Vector3d(0.0, 0.0, 2.0), shading_point.get_point());
+    }
+
+    TEST_CASE_F(Trace_GivenRayMissingInstancedMeshes_ReturnsFalse, InstancedMeshFixture)
+    {
+        ShadingPoint shading_point;
+        const bool hit = m_intersector.trace(make_ray(0.0), shading_point);
+
+        EXPECT_FALSE(hit);
+    }
+
+    TEST_CASE_F(TraceProbe_GivenRayHittingInstancedMesh_ReturnsTrue, InstancedMeshFixture)
+    {
+        EXPECT_TRUE(m_intersector.trace_probe(make_ray(-2.0)));
+        EXPECT_FALSE(m_intersector.trace_probe(make_ray(0.0)));
+    }
+
+    TEST_CASE_F(Trace_GivenRayHittingTriangleTreeWithCompactLeaves_ReturnsClosestObjectInstance, CompactLeavesFixture)
+    {
+        ShadingPoint shading_point;
+        const bool hit = m_intersector.trace(make_ray(2.0), shading_point);
+
+        ASSERT_TRUE(hit);
+        EXPECT_EQ(1, shading_point.get_object_instance_index());
+        EXPECT_FEQ(2.0, shading_point.get_distance());
+        EXPECT_FEQ(Vector3d(0.0, 0.0, 2.0), shading_point.get_point());
+    }
+
+    TEST_CASE_F(TraceProbe_GivenRayHittingTriangleTreeWithCompactLeaves_ReturnsTrue, CompactLeavesFixture)
+    {
+        EXPECT_TRUE(m_intersector.trace_probe(make_ray(-2.0)));
+        EXPECT_FALSE(m_intersector.trace_probe(make_ray(0.0)));
+    }
+
+    //
+    // A bumpy grid flattened into a triangle tree, used to check that refitted
+    // triangle trees of deforming meshes intersect like rebuilt ones.
+    //
+
+    const size_t GridResolution = 8;
+
+    template <int BumpHeightPercent>
+    struct BumpyGridTestScene
+      : public TestSceneBase
+    {
+        BumpyGridTestScene()
+        {
+            auto_release_ptr<Assembly> assembly(
+                AssemblyFactory().create(
+                    "assembly",
+                    ParamArray()
+                        .insert_path("acceleration_structure.object_instancing", false)));
+
+            auto_release_ptr<MeshObject> mesh_object(
+                MeshObjectFactory().create("grid", ParamArray()));
+
+            for (size_t y = 0; y <= GridResolution; ++y)
+            {
+                for (size_t x = 0; x <= GridResolution; ++x)
+                    mesh_object->push_vertex(make_vertex(x, y, BumpHeightPercent));
+            }
+
+            for (size_t y = 0; y < GridResolution; ++y)
+            {
+                for (size_t x = 0; x < GridResolution; ++x)
+                {
+                    const size_t v0 = y * (GridResolution + 1) + x;
+                    const size_t v1 = v0 + 1;
+                    const size_t v2 = v1 + GridResolution + 1;
+                    const size_t v3 = v0 + GridResolution + 1;
+                    mesh_object->push_triangle(Triangle(v0, v1, v2, 0));
+                    mesh_object->push_triangle(Triangle(v2, v3, v0, 0));
+                }
+            }
+
+            assembly->objects().insert(auto_release_ptr<Object>(mesh_object.release()));
+
+            assembly->object_instances().insert(
+                ObjectInstanceFactory::create(
+                    "grid_inst",
+                    ParamArray(),
+                    "grid",
+                    Transformd::identity(),
+                    StringDictionary()));
+
+            m_scene.assembly_instances().insert(
+                auto_release_ptr<AssemblyInstance>(
+                    AssemblyInstanceFactory::create(
+                        "assembly_instance",
+                        ParamArray(),
+                        "assembly")));
+
+            m_scene.assemblies().insert(assembly);
+        }
+
+        // Vertices span [-1, 1] x [-1, 1] in the XY plane and are displaced along Z.
+        static GVector3 make_vertex(
+            const size_t    x,
+            const size_t    y,
+            const int       bump_height_percent)
+        {
+            const GScalar fx = static_cast<GScalar>(2 * x) / GridResolution - GScalar(1.0);
+            const GScalar fy = static_cast<GScalar>(2 * y) / GridResolution - GScalar(1.0);
+            const GScalar fz =
+                static_cast<GScalar>(bump_height_percent) / 100 *
+                std::sin(GScalar(2.0) * fx) * std::cos(GScalar(3.0) * fy);
+            return GVector3(fx, fy, fz);
+        }
+
+        Assembly& get_assembly() const
+        {
+            return *m_scene.assemblies().get_by_name("assembly");
+        }
+
+        MeshObject& get_mesh_object() const
+        {
+            return static_cast<MeshObject&>(*get_assembly().objects().get_by_name("grid"));
+        }
+
+        // Displace the grid vertices to the heights of another bumpy grid.
+        void deform(const int bump_height_percent) const
+        {
+            MeshObject& mesh_object = get_mesh_object();
+
+            for (size_t y = 0; y <= GridResolution; ++y)
+            {
+                for (size_t x = 0; x <= GridResolution; ++x)
+                {
+                    mesh_object.set_vertex(
+                        y * (GridResolution + 1) + x,
+                        make_vertex(x, y, bump_height_percent));
+                }
+            }
+
+            get_assembly().bump_version_id();
+        }
+    };
+
+    template <int BumpHeightPercent>
+    struct BumpyGridFixture
+      : public StaticTestSceneContext<BumpyGridTestScene<BumpHeightPercent>>
+    {
+        typedef StaticTestSceneContext<BumpyGridTestScene<BumpHeightPercent>> Base;
+
+        TraceContext    m_trace_context;
+        TextureStore    m_texture_store;
+        TextureCache    m_texture_cache;
+        Intersector     m_intersector;
+
+        BumpyGridFixture()
+          : m_trace_context(Base::m_scene)
+          , m_texture_store(Base::m_scene)
+          , m_texture_cache(m_texture_store)
+          , m_intersector(m_trace_context, m_texture_cache)
+        {
+            m_trace_context.update();
+        }
+
+        TriangleTree::Arguments make_triangle_tree_arguments() const
+        {
+            const Assembly& assembly = Base::get_assembly();
+
+            return
+                TriangleTree::Arguments(
+                    Base::m_scene,
+                    new_guid(),
+                    compute_parent_bbox<GAABB3>(
+                        assembly.object_instances().begin(),
+                        assembly.object_instances().end()),
+                    assembly);
+        }
+
+        // Trace a vertical ray through the interior of a grid cell.
+        bool trace(
+            const size_t    x,
+            const size_t    y,
+            ShadingPoint&   shading_point)
+        {
+            const ShadingRay ray(
+                Vector3d(
+                    (2.0 * x + 0.7) / GridResolution - 1.0,
+                    (2.0 * y + 0.4) / GridResolution - 1.0,
+                    2.0),
+                Vector3d(0.0, 0.0, -1.0),
+                0.0,                            // tmin
+                10.0,                           // tmax
+                ShadingRay::Time(),
+                VisibilityFlags::CameraRay,
+                0);                             // depth
+
+            return m_intersector.trace(ray, shading_point);
+        }
+    };
+
+    TEST_CASE_F(TriangleTreeRefit_GivenDeformedMesh_ReturnsTrue, BumpyGridFixture<20>)
+    {
+        TriangleTree tree(make_triangle_tree_arguments());
+
+        deform(30);
+
+        EXPECT_TRUE(tree.refit(make_triangle_tree_arguments().m_bbox));
+        EXPECT_EQ(2 * GridResolution * GridResolution, tree.get_static_triangle_count());
+    }
+
+    TEST_CASE_F(TriangleTreeRefit_GivenMeshWithAddedTriangle_ReturnsFalse, BumpyGridFixture<20>)
+    {
+        TriangleTree tree(make_triangle_tree_arguments());
+
+        get_mesh_object().push_triangle(Triangle(0, 1, GridResolution + 1, 0));
+        get_assembly().bump_version_id();
+
+        EXPECT_FALSE(tree.refit(make_triangle_tree_arguments().m_bbox));
+    }
+
+    TEST_CASE_F(Trace_GivenDeformedMeshAfterUpdate_MatchesRebuiltTree, BumpyGridFixture<20>)
+    {
+        deform(30);
+        m_trace_context.update();
+
+        BumpyGridFixture<30> rebuilt;
+
+        for (size_t y = 0; y < GridResolution; ++y)
+        {
+            for (size_t x = 0; x < GridResolution; ++x)
+            {
+                ShadingPoint refitted_shading_point;
+                const bool refitted_hit = trace(x, y, refitted_shading_point);
+
+                ShadingPoint rebuilt_shading_point;
+                const bool rebuilt_hit = rebuilt.trace(x, y, rebuilt_shading_point);
+
+                ASSERT_TRUE(refitted_hit);
+                ASSERT_TRUE(rebuilt_hit);
+                EXPECT_EQ(rebuilt_shading_point.get_primitive_index(), refitted_shading_point.get_primitive_index());
+                EXPECT_FEQ(rebuilt_shading_point.get_distance(), refitted_shading_point.get_distance());
+            }
+        }
+    }
+
+    TEST_CASE_F(Trace_GivenIncoherentRayStream_ReturnsSameHitsAsIndividualRays, BumpyGridFixture<20>)
+    {
+        // Rays start from a few points above and below the grid in no particular order.
+        const size_t RayCount = 64;
+        ShadingRay rays[RayCount];
+        for (size_t i = 0; i < RayCount; ++i)
+        {
+            const double x = static_cast<double>((i * 7) % 5) * 0.4 - 0.8;
+            const double y = static_cast<double>((i * 3) % 4) * 0.5 - 0.75;
+            const double z = i & 1 ? 2.0 : -2.0;
+            const double dx = static_cast<double>((i * 5) % 9) * 0.05 - 0.2;
+            const double dy = static_cast<double>((i * 11) % 7) * 0.05 - 0.15;
+
+            rays[i] =
+                ShadingRay(
+                    Vector3d(x, y, z),
+                    normalize(Vector3d(dx, dy, -z)),
+                    0.0,                        // tmin
+                    10.0,                       // tmax
+                    ShadingRay::Time(),
+                    VisibilityFlags::CameraRay,
+                    0);                         // depth
+        }
+
+        ShadingPoint stream_shading_points[RayCount];
+        m_intersector.trace(rays, RayCount, stream_shading_points);
+
+        bool stream_hits[RayCount];
+        const size_t stream_hit_count = m_intersector.trace_probe(rays, RayCount, stream_hits);
+
+        size_t hit_count = 0;
+        for (size_t i = 0; i < RayCount; ++i)
+        {
+            ShadingPoint shading_point;
+            const bool hit = m_intersector.trace(rays[i], shading_point);
+            hit_count += hit ? 1 : 0;
+
+            EXPECT_EQ(hit, stream_shading_points[i].hit_surface());
+            EXPECT_EQ(hit, stream_hits[i]);
+
+            if (hit)
+            {
+                EXPECT_EQ(shading_point.get_primitive_index(), stream_shading_points[i].get_primitive_index());
+                EXPECT_FEQ(shading_point.get_distance(), stream_shading_points[i].get_distance());
+            }
+        }
+
+        EXPECT_EQ(hit_count, stream_hit_count);
+        EXPECT_NEQ(0, hit_count);
+    }
+
 #ifdef APPLESEED_WITH_EMBREE
 
     TEST_CASE_F(Trace_Embree_GivenAssemblyContainingEmptyBoundingBoxAndRayWithTMaxInsideAssembly_ReturnsFalse, Fixture<true>)
@@ -0,0 +1,166 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/lighttree_cone.h"
+#include "renderer/kernel/lighting/lighttree_partitioner.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/iostreamop.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Lighting_LightCone)
+{
+    TEST_CASE(Merge_GivenInvalidCone_ReturnsOtherCone)
+    {
+        const LightCone cone(Vector3f(0.0f, 1.0f, 0.0f), 0.5f, HalfPi<float>());
+
+        const LightCone result = LightCone::merge(LightCone::invalid(), cone);
+
+        EXPECT_FEQ(cone.m_axis, result.m_axis);
+        EXPECT_FEQ(cone.m_theta_o, result.m_theta_o);
+    }
+
+    TEST_CASE(Merge_GivenContainedCone_ReturnsWiderCone)
+    {
+        const LightCone a(Vector3f(0.0f, 1.0f, 0.0f), 1.0f, 0.5f);
+        const LightCone b(normalize(Vector3f(0.1f, 1.0f, 0.0f)), 0.2f, HalfPi<float>());
+
+        const LightCone result = LightCone::merge(b, a);
+
+        EXPECT_FEQ(a.m_axis, result.m_axis);
+        EXPECT_FEQ(a.m_theta_o, result.m_theta_o);
+        EXPECT_FEQ(HalfPi<float>(), result.m_theta_e);
+    }
+
+    TEST_CASE(Merge_GivenOrthogonalNormals_ReturnsConeBisectingNormals)
+    {
+        const LightCone a(Vector3f(1.0f, 0.0f, 0.0f), 0.0f, HalfPi<float>());
+        const LightCone b(Vector3f(0.0f, 1.0f, 0.0f), 0.0f, HalfPi<float>());
+
+        const LightCone result = LightCone::merge(a, b);
+
+        EXPECT_FEQ(normalize(Vector3f(1.0f, 1.0f, 0.0f)), result.m_axis);
+        EXPECT_FEQ(Pi<float>() / 4.0f, result.m_theta_o);
+    }
+
+    TEST_CASE(Merge_GivenOppositeNormals_ReturnsConeContainingAllDirections)
+    {
+        const LightCone a(Vector3f(0.0f, 0.0f, 1.0f), 0.0f, HalfPi<float>());
+        const LightCone b(Vector3f(0.0f, 0.0f, -1.0f), 0.0f, HalfPi<float>());
+
+        const LightCone result = LightCone::merge(a, b);
+
+        EXPECT_FEQ(Pi<float>(), result.m_theta_o);
+    }
+
+    TEST_CASE(Measure_GivenSingleDiffuseEmitter_ReturnsPi)
+    {
+        const LightCone cone(Vector3f(0.0f, 0.0f, 1.0f), 0.0f, HalfPi<float>());
+
+        EXPECT_FEQ_EPS(Pi<float>(), cone.measure(), 1.0e-5f);
+    }
+
+    TEST_CASE(Measure_GivenPointLight_ReturnsFourPi)
+    {
+        const LightCone cone(Vector3f(0.0f, 0.0f, 1.0f), Pi<float>(), HalfPi<float>());
+
+        EXPECT_FEQ_EPS(4.0f * Pi<float>(), cone.measure(), 1.0e-5f);
+    }
+
+    TEST_CASE(MaxCosEmission_GivenDirectionBehindEmitter_ReturnsZero)
+    {
+        const LightCone cone(Vector3f(0.0f, 0.0f, 1.0f), 0.0f, HalfPi<float>());
+
+        EXPECT_EQ(0.0f, cone.max_cos_emission(Vector3f(0.0f, 0.0f, -1.0f), 0.1f));
+    }
+
+    TEST_CASE(MaxCosEmission_GivenDirectionInsideCone_ReturnsOne)
+    {
+        const LightCone cone(Vector3f(0.0f, 0.0f, 1.0f), 0.5f, HalfPi<float>());
+
+        EXPECT_FEQ(1.0f, cone.max_cos_emission(normalize(Vector3f(0.2f, 0.0f, 1.0f)), 0.0f));
+    }
+}
+
+TEST_SUITE(Renderer_Kernel_Lighting_LightTreePartitioner)
+{
+    TEST_CASE(Partition_GivenTwoGroupsOfOppositeEmitters_SeparatesGroups)
+    {
+        // Four emitters at the corners of a square, the two at the bottom facing up, the two
+        // at the top facing down. Splitting along x or y is equally good spatially; only the
+        // orientation of the emitters favors splitting along y.
+        vector<AABB3d> bboxes;
+        LightTreePartitioner::LightConeVector cones;
+        vector<float> powers;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            const Vector3d position(static_cast<double>(i % 2), static_cast<double>(i / 2), 0.0);
+            bboxes.push_back(AABB3d(position - Vector3d(0.01), position + Vector3d(0.01)));
+            cones.push_back(
+                LightCone(
+                    Vector3f(0.0f, 0.0f, i < 2 ? 1.0f : -1.0f),
+                    0.0f,
+                    HalfPi<float>()));
+            powers.push_back(1.0f);
+        }
+
+        LightTreePartitioner partitioner(bboxes, cones, powers);
+        const size_t pivot = partitioner.partition(0, 4, partitioner.compute_bbox(0, 4));
+
+        ASSERT_EQ(2, pivot);
+
+        const vector<size_t>& ordering = partitioner.get_item_ordering();
+        EXPECT_LT(2, ordering[0]);
+        EXPECT_LT(2, ordering[1]);
+    }
+
+    TEST_CASE(Partition_GivenOverlappingLights_SplitsAnyway)
+    {
+        vector<AABB3d> bboxes(3, AABB3d(Vector3d(0.0), Vector3d(0.0)));
+        LightTreePartitioner::LightConeVector cones(3, LightCone(Vector3f(0.0f, 0.0f, 1.0f), Pi<float>(), HalfPi<float>()));
+        vector<float> powers(3, 1.0f);
+
+        LightTreePartitioner partitioner(bboxes, cones, powers);
+        const size_t pivot = partitioner.partition(0, 3, partitioner.compute_bbox(0, 3));
+
+        EXPECT_GT(0, pivot);
+        EXPECT_LT(3, pivot);
+    }
+}
@@ -0,0 +1,124 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/kernel/shading/oslshadergroupcache.h"
+#include "renderer/modeling/shadergroup/shadergroup.h"
+#include "renderer/utility/paramarray.h"
+
+// appleseed.foundation headers.
+#include "foundation/platform/types.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/searchpaths.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Shading_OSLShaderGroupCache)
+{
+    const char* Filepath = "unit tests/outputs/test_oslshadergroupcache.txt";
+
+    TEST_CASE(Lookup_GivenKeyStoredInPreviousSession_ReturnsStoredFlags)
+    {
+        remove(Filepath);
+
+        const SearchPaths search_paths;
+
+        {
+            OSLShaderGroupCache cache(Filepath, search_paths);
+            cache.insert("0123456789abcdef0123456789abcdef", 42);
+            EXPECT_TRUE(cache.save());
+        }
+
+        OSLShaderGroupCache cache(Filepath, search_paths);
+
+        uint32 flags = 0;
+        ASSERT_TRUE(cache.lookup("0123456789abcdef0123456789abcdef", flags));
+        EXPECT_EQ(42, flags);
+        EXPECT_FALSE(cache.lookup("fedcba9876543210fedcba9876543210", flags));
+    }
+
+    TEST_CASE(Constructor_GivenFileWithUnknownHeader_IgnoresFileContents)
+    {
+        {
+            ofstream file(Filepath);
+            file << "some other cache" << endl;
+            file << "0123456789abcdef0123456789abcdef 42" << endl;
+        }
+
+        OSLShaderGroupCache cache(Filepath, SearchPaths());
+
+        EXPECT_EQ(0, cache.size());
+    }
+
+    TEST_CASE(ComputeKey_GivenCompiledShaderModifiedAfterFirstKey_HashesShaderFileOncePerCache)
+    {
+        const char* ShaderFilepath = "unit tests/outputs/test_oslshadergroupcache_shader.oso";
+
+        {
+            ofstream file(ShaderFilepath);
+            file << "version 1" << endl;
+        }
+
+        auto_release_ptr<ShaderGroup> shader_group(ShaderGroupFactory::create("shader_group"));
+        shader_group->add_shader(
+            "surface",
+            "unit tests/outputs/test_oslshadergroupcache_shader",
+            "layer",
+            ParamArray());
+
+        const SearchPaths search_paths;
+        OSLShaderGroupCache cache(Filepath, search_paths);
+
+        string key1;
+        ASSERT_TRUE(cache.compute_key(shader_group.ref(), key1));
+
+        {
+            ofstream file(ShaderFilepath);
+            file << "version 2" << endl;
+        }
+
+        // The same cache doesn't read the shader file again.
+        string key2;
+        ASSERT_TRUE(cache.compute_key(shader_group.ref(), key2));
+        EXPECT_EQ(key1, key2);
+
+        // A new cache sees the modified shader file.
+        OSLShaderGroupCache new_cache(Filepath, search_paths);
+        string key3;
+        ASSERT_TRUE(new_cache.compute_key(shader_group.ref(), key3));
+        EXPECT_NEQ(key1, key3);
+    }
+}
@@ -0,0 +1,95 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/pathguide.h"
+#include "renderer/kernel/lighting/sdtree.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/sampling/mappings.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+
+using namespace foundation;
+using namespace renderer;
+
+TEST_SUITE(Renderer_Kernel_Lighting_PathGuide)
+{
+    TEST_CASE(Constructor_GivenZeroBSDFSamplingFraction_ClampsToMinimumFraction)
+    {
+        SDTree tree(AABB3f(Vector3f(-1.0f), Vector3f(1.0f)));
+        const PathGuide path_guide(tree, 0.0f);
+
+        EXPECT_EQ(PathGuideMinBSDFSamplingFraction, path_guide.get_bsdf_sampling_fraction());
+    }
+
+    TEST_CASE(CombinePdfs_GivenPositiveBSDFPdf_ReturnsPositivePdfEvenWhereLearnedPdfIsZero)
+    {
+        // Learn a distribution in which all incident radiance comes from a single direction.
+        SDTree tree(AABB3f(Vector3f(-1.0f), Vector3f(1.0f)));
+        tree.set_recording(true);
+        for (size_t i = 0; i < 1000; ++i)
+            tree.record(Vector3f(0.0f), Vector3f(0.0f, 0.0f, 1.0f), 1.0f);
+        tree.build(100, 0.01f, 20);
+        const DTree& dtree = tree.get_sampling_dtree(Vector3f(0.0f));
+
+        const float Fractions[] = { 0.0f, PathGuideMinBSDFSamplingFraction, 0.5f, 1.0f };
+        const float BSDFPdfs[] = { 1.0e-6f, 1.0e-2f, 1.0f, 100.0f };
+
+        MersenneTwister rng;
+        bool found_zero_guide_pdf = false;
+        bool all_combined_pdfs_positive = true;
+
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            const Vector3f direction = sample_sphere_uniform(rand_vector2<Vector2f>(rng));
+            const float guide_pdf = dtree.evaluate_pdf(direction);
+            found_zero_guide_pdf = found_zero_guide_pdf || guide_pdf == 0.0f;
+
+            for (const float fraction : Fractions)
+            {
+                const PathGuide path_guide(tree, fraction);
+
+                for (const float bsdf_pdf : BSDFPdfs)
+                {
+                    if (!(path_guide.combine_pdfs(bsdf_pdf, guide_pdf) > 0.0f))
+                        all_combined_pdfs_positive = false;
+                }
+            }
+        }
+
+        EXPECT_TRUE(found_zero_guide_pdf);
+        EXPECT_TRUE(all_combined_pdfs_positive);
+    }
+}
@@ -28,12 +28,17 @@
 //
 
 // appleseed.renderer headers.
+#include "renderer/modeling/object/object.h"
 #include "renderer/modeling/project/project.h"
 #include "renderer/modeling/project/projectfilereader.h"
 #include "renderer/modeling/project/projectfilewriter.h"
+#include "renderer/modeling/scene/assembly.h"
+#include "renderer/modeling/scene/containers.h"
+#include "renderer/modeling/scene/scene.h"
 
 // appleseed.foundation headers.
 #include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/string.h"
 #include "foundation/utility/test.h"
 #include "foundation/utility/testutils.h"
 
@@ -76,6 +81,47 @@ TEST_SUITE(Renderer_Modeling_Project_ProjectFileReader)
         EXPECT_TRUE(identical);
     }
 
+    TEST_CASE(ReadMeshObjects_InsertsObjectsInDeclarationOrder)
+    {
+        ProjectFileReader reader;
+        auto_release_ptr<Project> project =
+            reader.read(
+                "unit tests/inputs/test_projectfilereader_meshobjects.appleseed",
+                "../../../schemas/project.xsd");            // path relative to input file
+
+        ASSERT_NEQ(0, project.get());
+
+        const Assembly* assembly = project->get_scene()->assemblies().get_by_name("assembly");
+        ASSERT_NEQ(0, assembly);
+
+        const ObjectContainer& objects = assembly->objects();
+        ASSERT_TRUE(objects.size() >= 2);
+        EXPECT_TRUE(starts_with(objects.get_by_index(0)->get_name(), "cube."));
+        EXPECT_TRUE(starts_with(objects.get_by_index(objects.size() - 1)->get_name(), "quad."));
+    }
+
+    TEST_CASE(ReadMeshObjects_GivenDuplicateAssemblies_ReturnsNull)
+    {
+        ProjectFileReader reader;
+        auto_release_ptr<Project> project =
+            reader.read(
+                "unit tests/inputs/test_projectfilereader_duplicateassemblies.appleseed",
+                "../../../schemas/project.xsd");            // path relative to input file
+
+        EXPECT_EQ(0, project.get());
+    }
+
+    TEST_CASE(ReadMeshObjects_GivenDuplicateObjects_ReturnsNull)
+    {
+        ProjectFileReader reader;
+        auto_release_ptr<Project> project =
+            reader.read(
+                "unit tests/inputs/test_projectfilereader_duplicateobjects.appleseed",
+                "../../../schemas/project.xsd");            // path relative to input file
+
+        EXPECT_EQ(0, project.get());
+    }
+
     TEST_CASE(ReadValidPackedProject)
     {
         const char* UnpackDirectory = "unit tests/inputs/test_projectfilereader_validpackedproject.unpacked/";
@@ -0,0 +1,179 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/kernel/lighting/sdtree.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/qmc.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/mersennetwister.h"
+#include "foundation/math/scalar.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/iostreamop.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cstddef>
+
+using namespace foundation;
+using namespace renderer;
+
+TEST_SUITE(Renderer_Kernel_Lighting_DTree)
+{
+    TEST_CASE(SquareToDirection_RoundTrip)
+    {
+        const Vector2f p(0.3f, 0.7f);
+
+        const Vector2f q = DTree::direction_to_square(DTree::square_to_direction(p));
+
+        EXPECT_FEQ_EPS(p, q, 1.0e-5f);
+    }
+
+    TEST_CASE(EvaluatePdf_GivenEmptyTree_ReturnsUniformDensity)
+    {
+        const DTree tree;
+
+        EXPECT_FEQ(RcpFourPi<float>(), tree.evaluate_pdf(Vector3f(0.0f, 1.0f, 0.0f)));
+        EXPECT_FEQ(RcpFourPi<float>(), tree.evaluate_pdf(normalize(Vector3f(1.0f, -1.0f, 0.5f))));
+    }
+
+    struct Fixture
+    {
+        DTree m_tree;
+
+        Fixture()
+        {
+            // Record radiance mostly coming from the +Z hemisphere.
+            DTree source;
+            MersenneTwister rng;
+            for (size_t i = 0; i < 10000; ++i)
+            {
+                const Vector2f s(rand_float2(rng), rand_float2(rng));
+                const Vector3f d = DTree::square_to_direction(s);
+                source.record(d, d.z > 0.0f ? 10.0f : 1.0f);
+            }
+
+            // Build a refined tree and record the same distribution into it.
+            m_tree.refine(source, 0.01f, 20);
+            for (size_t i = 0; i < 10000; ++i)
+            {
+                const Vector2f s(rand_float2(rng), rand_float2(rng));
+                const Vector3f d = DTree::square_to_direction(s);
+                m_tree.record(d, d.z > 0.0f ? 10.0f : 1.0f);
+            }
+        }
+    };
+
+    TEST_CASE_F(Refine_SubdividesTree, Fixture)
+    {
+        EXPECT_GT(1, m_tree.get_depth());
+        EXPECT_EQ(10000, m_tree.get_sample_count());
+    }
+
+    TEST_CASE_F(EvaluatePdf_IntegratesToOne, Fixture)
+    {
+        const size_t SampleCount = 4096;
+
+        float integral = 0.0f;
+        for (size_t i = 0; i < SampleCount; ++i)
+        {
+            const Vector2f s(
+                radical_inverse_base2<float>(i),
+                static_cast<float>(i + 0.5f) / SampleCount);
+            integral += m_tree.evaluate_pdf(DTree::square_to_direction(s));
+        }
+        integral *= 4.0f * Pi<float>() / SampleCount;
+
+        EXPECT_FEQ_EPS(1.0f, integral, 1.0e-2f);
+    }
+
+    TEST_CASE_F(Sample_FavorsDirectionsCarryingMoreRadiance, Fixture)
+    {
+        const float pdf_up = m_tree.evaluate_pdf(Vector3f(0.0f, 0.0f, 1.0f));
+        const float pdf_down = m_tree.evaluate_pdf(Vector3f(0.0f, 0.0f, -1.0f));
+
+        EXPECT_FEQ_EPS(10.0f, pdf_up / pdf_down, 1.0f);
+    }
+
+    TEST_CASE_F(Sample_ReturnsProbabilityDensityMatchingEvaluatePdf, Fixture)
+    {
+        MersenneTwister rng;
+
+        for (size_t i = 0; i < 100; ++i)
+        {
+            const Vector2f s(rand_float2(rng), rand_float2(rng));
+
+            float pdf;
+            const Vector3f d = m_tree.sample(s, pdf);
+
+            EXPECT_FEQ_EPS(1.0f, norm(d), 1.0e-4f);
+            EXPECT_FEQ_EPS(m_tree.evaluate_pdf(d), pdf, 1.0e-3f * pdf);
+        }
+    }
+}
+
+TEST_SUITE(Renderer_Kernel_Lighting_SDTree)
+{
+    TEST_CASE(Constructor_CreatesSingleLeafWithoutSamplingDistribution)
+    {
+        const SDTree tree(AABB3f(Vector3f(-1.0f), Vector3f(1.0f)));
+
+        EXPECT_FALSE(tree.is_built());
+        EXPECT_EQ(1, tree.get_leaf_count());
+    }
+
+    TEST_CASE(Build_GivenLeafAboveSpatialThreshold_SplitsLeaf)
+    {
+        SDTree tree(AABB3f(Vector3f(-1.0f), Vector3f(1.0f)));
+        tree.set_recording(true);
+
+        MersenneTwister rng;
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            const Vector3f p(
+                rand_float1(rng, -1.0f, 1.0f),
+                rand_float1(rng, -1.0f, 1.0f),
+                rand_float1(rng, -1.0f, 1.0f));
+            tree.record(p, Vector3f(0.0f, 0.0f, 1.0f), 1.0f);
+        }
+
+        tree.build(100, 0.01f, 20);
+
+        EXPECT_TRUE(tree.is_built());
+        EXPECT_EQ(1, tree.get_iteration_count());
+        EXPECT_GT(1, tree.get_leaf_count());
+
+        // The learned distribution favors the recorded direction.
+        const DTree& dtree = tree.get_sampling_dtree(Vector3f(0.5f, 0.5f, 0.5f));
+        EXPECT_GT(
+            dtree.evaluate_pdf(Vector3f(0.0f, 0.0f, -1.0f)),
+            dtree.evaluate_pdf(Vector3f(0.0f, 0.0f, 1.0f)));
+    }
+}
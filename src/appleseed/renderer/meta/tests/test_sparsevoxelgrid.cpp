@@ -0,0 +1,318 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// appleseed.renderer headers.
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/volume/majorantgrid.h"
+#include "renderer/kernel/volume/sparsevoxelgrid.h"
+#include "renderer/kernel/volume/volumetracking.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/rng/distribution.h"
+#include "foundation/math/rng/pcg.h"
+#include "foundation/math/vector.h"
+#include "foundation/utility/test.h"
+
+// Standard headers.
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+using namespace foundation;
+using namespace renderer;
+using namespace std;
+
+TEST_SUITE(Renderer_Kernel_Volume_SparseVoxelGrid)
+{
+    const AABB3f UnitBox(Vector3f(0.0f), Vector3f(1.0f));
+
+    TEST_CASE(GetVoxel_GivenNewGrid_ReturnsZero)
+    {
+        const SparseVoxelGrid grid(20, 20, 20, UnitBox);
+
+        EXPECT_EQ(0.0f, grid.get_voxel(13, 7, 19));
+        EXPECT_EQ(0, grid.get_stored_block_count());
+    }
+
+    TEST_CASE(SetVoxel_GivenZeroValue_DoesNotAllocateBlock)
+    {
+        SparseVoxelGrid grid(20, 20, 20, UnitBox);
+
+        grid.set_voxel(13, 7, 19, 0.0f);
+
+        EXPECT_EQ(0, grid.get_stored_block_count());
+    }
+
+    TEST_CASE(SetVoxel_GivenNonZeroValue_AllocatesSingleBlock)
+    {
+        SparseVoxelGrid grid(20, 20, 20, UnitBox);
+
+        grid.set_voxel(13, 7, 19, 2.0f);
+        grid.set_voxel(12, 6, 17, 3.0f);
+
+        EXPECT_EQ(1, grid.get_stored_block_count());
+        EXPECT_EQ(2.0f, grid.get_voxel(13, 7, 19));
+        EXPECT_EQ(3.0f, grid.get_voxel(12, 6, 17));
+        EXPECT_EQ(3.0f, grid.get_block_max(1, 0, 2));
+        EXPECT_EQ(0.0f, grid.get_block_max(0, 0, 0));
+    }
+
+    TEST_CASE(LinearLookup_ReturnsTrilinearInterpolationOfVoxels)
+    {
+        SparseVoxelGrid grid(17, 17, 17, UnitBox);
+
+        for (size_t z = 0; z < 17; ++z)
+        {
+            for (size_t y = 0; y < 17; ++y)
+            {
+                for (size_t x = 0; x < 17; ++x)
+                    grid.set_voxel(x, y, z, static_cast<float>(x + 2 * y + 4 * z));
+            }
+        }
+
+        // The lookup straddles a block boundary along each axis.
+        const Vector3f point(7.5f / 16, 7.25f / 16, 8.0f / 16);
+        EXPECT_FEQ(7.5f + 2.0f * 7.25f + 4.0f * 8.0f, grid.linear_lookup(point));
+    }
+
+    TEST_CASE(ReadSparseVoxelGrid_GivenWrittenGrid_LoadsBlocksOnDemand)
+    {
+        const AABB3f bbox(Vector3f(-1.0f, 2.0f, 0.0f), Vector3f(3.0f, 4.0f, 1.0f));
+        SparseVoxelGrid grid(30, 20, 10, bbox);
+        grid.set_voxel(1, 2, 3, 1.0f);
+        grid.set_voxel(25, 18, 9, 4.0f);
+
+        const char* Filename = "unit tests/outputs/test_sparsevoxelgrid.spvg";
+        ASSERT_TRUE(write_sparse_voxel_grid(Filename, grid));
+
+        const unique_ptr<SparseVoxelGrid> result = read_sparse_voxel_grid(Filename);
+        ASSERT_NEQ(0, result.get());
+
+        EXPECT_EQ(30, result->get_xres());
+        EXPECT_EQ(20, result->get_yres());
+        EXPECT_EQ(10, result->get_zres());
+        EXPECT_TRUE(result->get_bbox() == bbox);
+        EXPECT_EQ(2, result->get_stored_block_count());
+        EXPECT_EQ(0, result->get_loaded_block_count());
+        EXPECT_EQ(4.0f, result->get_block_max(3, 2, 1));
+
+        EXPECT_EQ(1.0f, result->get_voxel(1, 2, 3));
+        EXPECT_EQ(1, result->get_loaded_block_count());
+
+        EXPECT_EQ(4.0f, result->get_voxel(25, 18, 9));
+        EXPECT_EQ(0.0f, result->get_voxel(15, 10, 5));
+        EXPECT_EQ(2, result->get_loaded_block_count());
+    }
+
+    TEST_CASE(ReadSparseVoxelGrid_GivenMissingFile_ReturnsNull)
+    {
+        const unique_ptr<SparseVoxelGrid> result =
+            read_sparse_voxel_grid("unit tests/inputs/test_sparsevoxelgrid_missing.spvg");
+
+        EXPECT_EQ(0, result.get());
+    }
+}
+
+TEST_SUITE(Renderer_Kernel_Volume_MajorantGrid)
+{
+    const AABB3f UnitBox(Vector3f(0.0f), Vector3f(1.0f));
+
+    struct Fixture
+    {
+        SparseVoxelGrid m_grid;
+
+        Fixture()
+          : m_grid(33, 33, 33, UnitBox)
+        {
+            PCG rng(42, 0);
+
+            for (size_t z = 0; z < 33; ++z)
+            {
+                for (size_t y = 0; y < 33; ++y)
+                {
+                    for (size_t x = 0; x < 33; ++x)
+                    {
+                        if (x > 10 && y < 20)
+                            m_grid.set_voxel(x, y, z, rand_float2(rng));
+                    }
+                }
+            }
+        }
+    };
+
+    struct CollectingVisitor
+    {
+        vector<float> m_t0;
+        vector<float> m_t1;
+        vector<float> m_majorants;
+
+        bool operator()(const float t0, const float t1, const float majorant)
+        {
+            m_t0.push_back(t0);
+            m_t1.push_back(t1);
+            m_majorants.push_back(majorant);
+            return true;
+        }
+    };
+
+    TEST_CASE_F(Constructor_ComputesOneCellPerBlock, Fixture)
+    {
+        const MajorantGrid majorants(m_grid);
+
+        EXPECT_EQ(4, majorants.get_xres());
+        EXPECT_EQ(4, majorants.get_yres());
+        EXPECT_EQ(4, majorants.get_zres());
+        EXPECT_EQ(0.0f, majorants.get_majorant(0, 3, 0));
+    }
+
+    TEST_CASE_F(Traverse_VisitsContiguousCellsBoundingLookups, Fixture)
+    {
+        const MajorantGrid majorants(m_grid);
+
+        PCG rng(7, 0);
+
+        for (size_t i = 0; i < 100; ++i)
+        {
+            const Vector3f org(
+                rand_float2(rng) * 3.0f - 1.0f,
+                rand_float2(rng) * 3.0f - 1.0f,
+                rand_float2(rng) * 3.0f - 1.0f);
+            const Vector3f target(rand_float2(rng), rand_float2(rng), rand_float2(rng));
+            const Vector3f dir = target - org;
+
+            CollectingVisitor visitor;
+            majorants.traverse(org, dir, 0.0f, 10.0f, visitor);
+
+            ASSERT_FALSE(visitor.m_t0.empty());
+
+            for (size_t j = 0; j < visitor.m_t0.size(); ++j)
+            {
+                const float t0 = visitor.m_t0[j];
+                const float t1 = visitor.m_t1[j];
+
+                EXPECT_TRUE(t0 <= t1);
+
+                if (j > 0)
+                    EXPECT_FEQ(visitor.m_t1[j - 1], t0);
+
+                for (size_t k = 0; k <= 4; ++k)
+                {
+                    const float t = t0 + (t1 - t0) * k / 4.0f;
+                    const float density = m_grid.linear_lookup(org + t * dir);
+                    EXPECT_TRUE(density <= visitor.m_majorants[j] + 1.0e-6f);
+                }
+            }
+        }
+    }
+
+    TEST_CASE_F(Traverse_GivenRayMissingGrid_VisitsNothing, Fixture)
+    {
+        const MajorantGrid majorants(m_grid);
+
+        CollectingVisitor visitor;
+        majorants.traverse(Vector3f(2.0f, 0.5f, 0.5f), Vector3f(0.0f, 1.0f, 0.0f), 0.0f, 10.0f, visitor);
+
+        EXPECT_TRUE(visitor.m_t0.empty());
+    }
+}
+
+TEST_SUITE(Renderer_Kernel_Volume_VolumeTracking)
+{
+    const AABB3f UnitBox(Vector3f(0.0f), Vector3f(1.0f));
+
+    TEST_CASE(RatioTracking_GivenConstantDensity_ConvergesToBeerLambert)
+    {
+        SparseVoxelGrid grid(9, 9, 9, UnitBox);
+
+        for (size_t z = 0; z < 9; ++z)
+        {
+            for (size_t y = 0; y < 9; ++y)
+            {
+                for (size_t x = 0; x < 9; ++x)
+                    grid.set_voxel(x, y, z, 0.5f);
+            }
+        }
+
+        const MajorantGrid majorants(grid);
+
+        Spectrum extinction;
+        for (size_t i = 0, e = Spectrum::size(); i < e; ++i)
+            extinction[i] = 1.0f + static_cast<float>(i) / e;
+
+        const Vector3f org(0.0f, 0.5f, 0.5f);
+        const Vector3f dir(1.0f, 0.0f, 0.0f);
+        const float Distance = 0.8f;
+        const size_t SampleCount = 100000;
+
+        PCG rng(1, 0);
+        Spectrum average(0.0f);
+
+        for (size_t i = 0; i < SampleCount; ++i)
+        {
+            Spectrum transmission;
+            ratio_tracking(grid, majorants, org, dir, Distance, extinction, rng, transmission);
+            average += transmission;
+        }
+
+        average /= static_cast<float>(SampleCount);
+
+        for (size_t i = 0, e = Spectrum::size(); i < e; ++i)
+            EXPECT_FEQ_EPS(exp(-0.5f * extinction[i] * Distance), average[i], 0.01f);
+    }
+
+    TEST_CASE(SpectralTracking_GivenEmptyGrid_DoesNotScatter)
+    {
+        const SparseVoxelGrid grid(9, 9, 9, UnitBox);
+        const MajorantGrid majorants(grid);
+
+        const Spectrum extinction(1.0f);
+        const Spectrum scattering(0.5f);
+
+        PCG rng(1, 0);
+        float distance;
+        Spectrum weight(1.0f);
+
+        const bool scattered =
+            spectral_tracking(
+                grid,
+                majorants,
+                Vector3f(0.0f, 0.5f, 0.5f),
+                Vector3f(1.0f, 0.0f, 0.0f),
+                1.0f,
+                extinction,
+                scattering,
+                rng,
+                distance,
+                weight);
+
+        EXPECT_FALSE(scattered);
+        EXPECT_TRUE(weight == Spectrum(1.0f));
+    }
+}
@@ -29,10 +29,23 @@
 
 // appleseed.renderer headers.
 #include "renderer/kernel/texturing/texturestore.h"
+#include "renderer/modeling/scene/containers.h"
+#include "renderer/modeling/scene/scene.h"
+#include "renderer/modeling/texture/memorytexture2d.h"
+#include "renderer/modeling/texture/texture.h"
+#include "renderer/utility/paramarray.h"
 
 // appleseed.foundation headers.
+#include "foundation/image/color.h"
+#include "foundation/image/image.h"
+#include "foundation/image/pixel.h"
+#include "foundation/image/tile.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/iostreamop.h"
 #include "foundation/utility/test.h"
+#include "foundation/utility/uid.h"
 
+using namespace foundation;
 using namespace renderer;
 
 TEST_SUITE(Renderer_Kernel_Texturing_TextureStore_TileKey)
@@ -47,3 +60,76 @@ TEST_SUITE(Renderer_Kernel_Texturing_TextureStore_TileKey)
         EXPECT_EQ(56565, key.get_tile_y());
     }
 }
+
+TEST_SUITE(Renderer_Kernel_Texturing_TextureStore)
+{
+    struct Fixture
+    {
+        auto_release_ptr<Scene>     m_scene;
+        Image*                      m_image;
+        UniqueID                    m_texture_uid;
+
+        Fixture()
+          : m_scene(SceneFactory::create())
+        {
+            auto_release_ptr<Image> image(new Image(64, 64, 16, 16, 3, PixelFormatFloat));
+            m_image = image.get();
+
+            auto_release_ptr<Texture> texture(
+                MemoryTexture2dFactory().create(
+                    "texture",
+                    ParamArray().insert("color_space", "linear_rgb"),
+                    image));
+            m_texture_uid = texture->get_uid();
+
+            m_scene->textures().insert(texture);
+        }
+    };
+
+    TEST_CASE_F(Acquire_SameTileTwice_ReturnsSameRecord, Fixture)
+    {
+        TextureStore store(m_scene.ref());
+        const TextureStore::TileKey key(~UniqueID(0), m_texture_uid, 1, 2);
+
+        TextureStore::TileRecord& record1 = store.acquire(key);
+        TextureStore::TileRecord& record2 = store.acquire(key);
+
+        EXPECT_EQ(&record1, &record2);
+        EXPECT_EQ(&m_image->tile(1, 2), record1.m_tile);
+        EXPECT_EQ(2, record1.m_owners);
+
+        store.release(record2);
+        store.release(record1);
+    }
+
+    TEST_CASE_F(Acquire_GivenMipmapLevel_ReturnsDownsampledTile, Fixture)
+    {
+        m_image->clear(Color3f(0.5f));
+
+        TextureStore store(m_scene.ref());
+        const TextureStore::TileKey key(~UniqueID(0), m_texture_uid, 1, 0, 1);
+
+        TextureStore::TileRecord& record = store.acquire(key);
+
+        EXPECT_EQ(16, record.m_tile->get_width());
+        EXPECT_EQ(16, record.m_tile->get_height());
+
+        Color3f color;
+        record.m_tile->get_pixel(3, 5, color);
+        EXPECT_FEQ(Color3f(0.5f), color);
+
+        store.release(record);
+    }
+
+    TEST_CASE_F(Acquire_GivenTilePrefetchingEnabled_ReturnsLoadedTile, Fixture)
+    {
+        TextureStore store(m_scene.ref(), ParamArray().insert("prefetch_tiles", true));
+        const TextureStore::TileKey key(~UniqueID(0), m_texture_uid, 0, 0);
+
+        TextureStore::TileRecord& record = store.acquire(key);
+
+        EXPECT_EQ(&m_image->tile(0, 0), record.m_tile);
+
+        store.release(record);
+    }
+}
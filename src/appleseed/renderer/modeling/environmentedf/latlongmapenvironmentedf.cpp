@@ -240,14 +240,13 @@ namespace
             size_t x, y;
             Color3f payload;
             float prob_xy;
-            m_importance_sampler->sample(s, x, y, payload, prob_xy);
+            Vector2f jitter;
+            m_importance_sampler->sample(s, x, y, payload, prob_xy, jitter);
             assert(prob_xy >= 0.0f);
 
             // Compute the coordinates in [0,1)^2 of the sample.
-            const float jitter_x = frac(s[0] * m_importance_map_width);
-            const float jitter_y = frac(s[1] * m_importance_map_height);
-            const float u = (x + jitter_x) * m_rcp_importance_map_width;
-            const float v = (y + jitter_y) * m_rcp_importance_map_height;
+            const float u = (x + jitter[0]) * m_rcp_importance_map_width;
+            const float v = (y + jitter[1]) * m_rcp_importance_map_height;
             assert(u >= 0.0f && u < 1.0f);
             assert(v >= 0.0f && v < 1.0f);
 
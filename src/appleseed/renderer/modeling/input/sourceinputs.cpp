@@ -35,6 +35,26 @@ namespace renderer
 SourceInputs::SourceInputs(const foundation::Vector2f& uv)
     : m_uv_x(uv.x)
     , m_uv_y(uv.y)
+    , m_dudx(0.0f)
+    , m_dvdx(0.0f)
+    , m_dudy(0.0f)
+    , m_dvdy(0.0f)
+    , m_point_x(0.0)
+    , m_point_y(0.0)
+    , m_point_z(0.0)
+{
+}
+
+SourceInputs::SourceInputs(
+    const foundation::Vector2f& uv,
+    const foundation::Vector2f& duvdx,
+    const foundation::Vector2f& duvdy)
+    : m_uv_x(uv.x)
+    , m_uv_y(uv.y)
+    , m_dudx(duvdx.x)
+    , m_dvdx(duvdx.y)
+    , m_dudy(duvdy.x)
+    , m_dvdy(duvdy.y)
     , m_point_x(0.0)
     , m_point_y(0.0)
     , m_point_z(0.0)
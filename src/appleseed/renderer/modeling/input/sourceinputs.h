@@ -44,13 +44,23 @@ class APPLESEED_DLLSYMBOL SourceInputs
     float   m_uv_x;
     float   m_uv_y;
 
+    // Screen space partial derivatives of the texture coordinates from UV set #0.
+    float   m_dudx;
+    float   m_dvdx;
+    float   m_dudy;
+    float   m_dvdy;
+
     // World space intersection point.
     double  m_point_x;
     double  m_point_y;
     double  m_point_z;
 
-    // Constructor.
+    // Constructors.
     explicit SourceInputs(const foundation::Vector2f& uv);
+    SourceInputs(
+        const foundation::Vector2f& uv,
+        const foundation::Vector2f& duvdx,
+        const foundation::Vector2f& duvdy);
 };
 
 }   // namespace renderer
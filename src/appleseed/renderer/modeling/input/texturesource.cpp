@@ -36,13 +36,17 @@
 #include "renderer/modeling/texture/texture.h"
 
 // appleseed.foundation headers.
+#include "foundation/image/mipmap.h"
 #include "foundation/image/tile.h"
 #include "foundation/math/hash.h"
 #include "foundation/math/scalar.h"
 #include "foundation/platform/types.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <utility>
 
 using namespace foundation;
 using namespace std;
@@ -59,6 +63,12 @@ namespace renderer
 
 namespace
 {
+    // Maximum ratio between the major and minor axes of the EWA filter footprint.
+    const float EWAMaxAnisotropy = 8.0f;
+
+    // Falloff of the Gaussian EWA filter.
+    const float EWAFilterAlpha = 2.0f;
+
     // Apply an addressing mode to texture coordinates.
     inline void apply_addressing_mode(
         const TextureAddressingMode addressing_mode,
@@ -123,6 +133,7 @@ namespace
         TextureCache&               texture_cache,
         const UniqueID              assembly_uid,
         const UniqueID              texture_uid,
+        const size_t                level,
         const size_t                tile_x,
         const size_t                tile_y,
         const size_t                pixel_x,
@@ -135,7 +146,8 @@ namespace
                 assembly_uid,
                 texture_uid,
                 tile_x,
-                tile_y);
+                tile_y,
+                level);
 
         // Sample the tile.
         if (tile.get_channel_count() == 3)
@@ -165,6 +177,11 @@ TextureSource::TextureSource(
   , m_max_x(static_cast<float>(m_texture_props.m_canvas_width - 1))
   , m_max_y(static_cast<float>(m_texture_props.m_canvas_height - 1))
 {
+    const size_t level_count = get_mipmap_level_count(m_texture_props);
+    m_level_props.reserve(level_count);
+
+    for (size_t i = 0; i < level_count; ++i)
+        m_level_props.push_back(get_mipmap_level_properties(m_texture_props, i));
 }
 
 uint64 TextureSource::compute_signature() const
@@ -192,19 +209,34 @@ Vector2f TextureSource::apply_transform(const Vector2f& uv) const
     return Vector2f(p.x, p.y);
 }
 
+Vector2f TextureSource::apply_transform_to_derivative(const Vector2f& duv) const
+{
+    // Convert to 3D vector.
+    Vector3f d(duv.x, duv.y, 0.0f);
+
+    // Apply transform.
+    d = m_texture_transform.vector_to_local(d);
+
+    // Convert back to 2D vector.
+    return Vector2f(d.x, d.y);
+}
+
 Color4f TextureSource::get_texel(
     TextureCache&               texture_cache,
+    const size_t                level,
     const size_t                ix,
     const size_t                iy) const
 {
-    assert(ix < m_texture_props.m_canvas_width);
-    assert(iy < m_texture_props.m_canvas_height);
+    const CanvasProperties& props = m_level_props[level];
+
+    assert(ix < props.m_canvas_width);
+    assert(iy < props.m_canvas_height);
 
     // Compute the coordinates of the tile containing the texel (x, y).
-    const size_t tile_x = truncate<size_t>(ix * m_texture_props.m_rcp_tile_width);
-    const size_t tile_y = truncate<size_t>(iy * m_texture_props.m_rcp_tile_height);
-    assert(tile_x < m_texture_props.m_tile_count_x);
-    assert(tile_y < m_texture_props.m_tile_count_y);
+    const size_t tile_x = truncate<size_t>(ix * props.m_rcp_tile_width);
+    const size_t tile_y = truncate<size_t>(iy * props.m_rcp_tile_height);
+    assert(tile_x < props.m_tile_count_x);
+    assert(tile_y < props.m_tile_count_y);
 
 #ifdef DEBUG_DISPLAY_TEXTURE_TILES
 
@@ -221,10 +253,10 @@ Color4f TextureSource::get_texel(
 #endif
 
     // Compute the tile space coordinates of the texel (x, y).
-    const size_t pixel_x = ix - tile_x * m_texture_props.m_tile_width;
-    const size_t pixel_y = iy - tile_y * m_texture_props.m_tile_height;
-    assert(pixel_x < m_texture_props.m_tile_width);
-    assert(pixel_y < m_texture_props.m_tile_height);
+    const size_t pixel_x = ix - tile_x * props.m_tile_width;
+    const size_t pixel_y = iy - tile_y * props.m_tile_height;
+    assert(pixel_x < props.m_tile_width);
+    assert(pixel_y < props.m_tile_height);
 
     // Sample the tile.
     Color4f sample;
@@ -232,6 +264,7 @@ Color4f TextureSource::get_texel(
         texture_cache,
         m_assembly_uid,
         m_texture_uid,
+        level,
         tile_x,
         tile_y,
         pixel_x,
@@ -241,8 +274,45 @@ Color4f TextureSource::get_texel(
     return sample;
 }
 
+Color4f TextureSource::get_texel_addressed(
+    TextureCache&               texture_cache,
+    const size_t                level,
+    int                         ix,
+    int                         iy) const
+{
+    const CanvasProperties& props = m_level_props[level];
+    const int width = static_cast<int>(props.m_canvas_width);
+    const int height = static_cast<int>(props.m_canvas_height);
+
+    switch (m_texture_instance.get_addressing_mode())
+    {
+      case TextureAddressingClamp:
+        ix = clamp(ix, 0, width - 1);
+        iy = clamp(iy, 0, height - 1);
+        break;
+
+      case TextureAddressingWrap:
+        ix %= width;
+        iy %= height;
+        if (ix < 0) ix += width;
+        if (iy < 0) iy += height;
+        break;
+
+      default:
+        assert(!"Wrong texture addressing mode.");
+    }
+
+    return
+        get_texel(
+            texture_cache,
+            level,
+            static_cast<size_t>(ix),
+            static_cast<size_t>(iy));
+}
+
 void TextureSource::get_texels_2x2(
     TextureCache&               texture_cache,
+    const size_t                level,
     const int                   ix,
     const int                   iy,
     Color4f&                    t00,
@@ -250,19 +320,21 @@ void TextureSource::get_texels_2x2(
     Color4f&                    t01,
     Color4f&                    t11) const
 {
+    const CanvasProperties& props = m_level_props[level];
+
     const Vector<size_t, 2> p00 =
         constrain_to_canvas(
             m_texture_instance.get_addressing_mode(),
-            m_texture_props.m_canvas_width,
-            m_texture_props.m_canvas_height,
+            props.m_canvas_width,
+            props.m_canvas_height,
             ix + 0,
             iy + 0);
 
     const Vector<size_t, 2> p11 =
         constrain_to_canvas(
             m_texture_instance.get_addressing_mode(),
-            m_texture_props.m_canvas_width,
-            m_texture_props.m_canvas_height,
+            props.m_canvas_width,
+            props.m_canvas_height,
             ix + 1,
             iy + 1);
 
@@ -270,10 +342,10 @@ void TextureSource::get_texels_2x2(
     const Vector<size_t, 2> p01(p00.x, p11.y);
 
     // Compute the coordinates of the tile containing each texel.
-    const size_t tile_x_00 = truncate<size_t>(p00.x * m_texture_props.m_rcp_tile_width);
-    const size_t tile_y_00 = truncate<size_t>(p00.y * m_texture_props.m_rcp_tile_height);
-    const size_t tile_x_11 = truncate<size_t>(p11.x * m_texture_props.m_rcp_tile_width);
-    const size_t tile_y_11 = truncate<size_t>(p11.y * m_texture_props.m_rcp_tile_height);
+    const size_t tile_x_00 = truncate<size_t>(p00.x * props.m_rcp_tile_width);
+    const size_t tile_y_00 = truncate<size_t>(p00.y * props.m_rcp_tile_height);
+    const size_t tile_x_11 = truncate<size_t>(p11.x * props.m_rcp_tile_width);
+    const size_t tile_y_11 = truncate<size_t>(p11.y * props.m_rcp_tile_height);
 
     // Check whether all four texels are part of the same tile.
     const size_t tile_x_mask = tile_x_00 ^ tile_x_11;
@@ -284,24 +356,24 @@ void TextureSource::get_texels_2x2(
         // Not all four texels are part of the same tile.
 
         // Compute the tile space coordinates of each texel.
-        const size_t pixel_x_00 = p00.x - tile_x_00 * m_texture_props.m_tile_width;
-        const size_t pixel_y_00 = p00.y - tile_y_00 * m_texture_props.m_tile_height;
-        const size_t pixel_x_11 = p11.x - tile_x_11 * m_texture_props.m_tile_width;
-        const size_t pixel_y_11 = p11.y - tile_y_11 * m_texture_props.m_tile_height;
+        const size_t pixel_x_00 = p00.x - tile_x_00 * props.m_tile_width;
+        const size_t pixel_y_00 = p00.y - tile_y_00 * props.m_tile_height;
+        const size_t pixel_x_11 = p11.x - tile_x_11 * props.m_tile_width;
+        const size_t pixel_y_11 = p11.y - tile_y_11 * props.m_tile_height;
 
         // Sample the tile.
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_00, tile_y_00, pixel_x_00, pixel_y_00, t00);
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_11, tile_y_00, pixel_x_11, pixel_y_00, t10);
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_00, tile_y_11, pixel_x_00, pixel_y_11, t01);
-        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, tile_x_11, tile_y_11, pixel_x_11, pixel_y_11, t11);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, level, tile_x_00, tile_y_00, pixel_x_00, pixel_y_00, t00);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, level, tile_x_11, tile_y_00, pixel_x_11, pixel_y_00, t10);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, level, tile_x_00, tile_y_11, pixel_x_00, pixel_y_11, t01);
+        sample_tile(texture_cache, m_assembly_uid, m_texture_uid, level, tile_x_11, tile_y_11, pixel_x_11, pixel_y_11, t11);
     }
     else
     {
         // All four texels are part of the same tile.
 
         // Compute the tile space coordinates of each texel.
-        const size_t org_x = tile_x_00 * m_texture_props.m_tile_width;
-        const size_t org_y = tile_y_00 * m_texture_props.m_tile_height;
+        const size_t org_x = tile_x_00 * props.m_tile_width;
+        const size_t org_y = tile_y_00 * props.m_tile_height;
         const size_t pixel_x_00 = p00.x - org_x;
         const size_t pixel_y_00 = p00.y - org_y;
         const size_t pixel_x_11 = p11.x - org_x;
@@ -313,7 +385,8 @@ void TextureSource::get_texels_2x2(
                 m_assembly_uid,
                 m_texture_uid,
                 tile_x_00,
-                tile_y_00);
+                tile_y_00,
+                level);
 
         // Sample the tile.
         if (tile.get_channel_count() == 3)
@@ -354,12 +427,189 @@ void TextureSource::get_texels_2x2(
     }
 }
 
+Color4f TextureSource::sample_bilinear(
+    TextureCache&               texture_cache,
+    const size_t                level,
+    const Vector2f&             p) const
+{
+    const CanvasProperties& props = m_level_props[level];
+
+    const float x = p.x * static_cast<float>(props.m_canvas_width - 1);
+    const float y = p.y * static_cast<float>(props.m_canvas_height - 1);
+
+    const int ix = truncate<int>(x);
+    const int iy = truncate<int>(y);
+
+    // Retrieve the four surrounding texels.
+    Color4f t00, t10, t01, t11;
+    get_texels_2x2(
+        texture_cache,
+        level,
+        ix, iy,
+        t00, t10, t01, t11);
+
+    // Compute weights.
+    const float wx1 = x - ix;
+    const float wy1 = y - iy;
+    const float wx0 = 1.0f - wx1;
+    const float wy0 = 1.0f - wy1;
+
+    // Apply weights.
+    t00 *= wx0 * wy0;
+    t10 *= wx1 * wy0;
+    t01 *= wx0 * wy1;
+    t11 *= wx1 * wy1;
+
+    // Accumulate.
+    t00 += t10;
+    t00 += t01;
+    t00 += t11;
+
+    return t00;
+}
+
+Color4f TextureSource::sample_trilinear(
+    TextureCache&               texture_cache,
+    const Vector2f&             p,
+    const Vector2f&             dpdx,
+    const Vector2f&             dpdy) const
+{
+    // Choose the level in which the footprint is about one texel wide.
+    const float width = max(norm(dpdx), norm(dpdy));
+    if (width <= 1.0f)
+        return sample_bilinear(texture_cache, 0, p);
+
+    const size_t max_level = m_level_props.size() - 1;
+    const float lod = min(log2(width), static_cast<float>(max_level));
+    const size_t level = truncate<size_t>(lod);
+    if (level >= max_level)
+        return sample_bilinear(texture_cache, max_level, p);
+
+    // Blend the two closest levels.
+    const float t = lod - level;
+    return
+          (1.0f - t) * sample_bilinear(texture_cache, level, p)
+        + t * sample_bilinear(texture_cache, level + 1, p);
+}
+
+Color4f TextureSource::sample_ewa(
+    TextureCache&               texture_cache,
+    const Vector2f&             p,
+    const Vector2f&             dpdx,
+    const Vector2f&             dpdy) const
+{
+    //
+    // Reference:
+    //
+    //   Physically Based Rendering, third edition, pp. 623-628
+    //
+
+    Vector2f major_axis = dpdx;
+    Vector2f minor_axis = dpdy;
+    if (square_norm(major_axis) < square_norm(minor_axis))
+        std::swap(major_axis, minor_axis);
+
+    const float major_length = norm(major_axis);
+    float minor_length = norm(minor_axis);
+    if (minor_length == 0.0f)
+        return sample_bilinear(texture_cache, 0, p);
+
+    // Clamp the eccentricity of the footprint to bound the number of texels to filter.
+    if (minor_length * EWAMaxAnisotropy < major_length)
+    {
+        const float scale = major_length / (minor_length * EWAMaxAnisotropy);
+        minor_axis *= scale;
+        minor_length *= scale;
+    }
+
+    // Choose the level in which the minor axis is about one texel long.
+    const size_t max_level = m_level_props.size() - 1;
+    const float lod = clamp(log2(minor_length), 0.0f, static_cast<float>(max_level));
+    const size_t level = truncate<size_t>(lod);
+    if (level >= max_level)
+        return sample_ewa(texture_cache, max_level, p, major_axis, minor_axis);
+
+    // Blend the two closest levels.
+    const float t = lod - level;
+    return
+          (1.0f - t) * sample_ewa(texture_cache, level, p, major_axis, minor_axis)
+        + t * sample_ewa(texture_cache, level + 1, p, major_axis, minor_axis);
+}
+
+Color4f TextureSource::sample_ewa(
+    TextureCache&               texture_cache,
+    const size_t                level,
+    const Vector2f&             p,
+    const Vector2f&             major_axis,
+    const Vector2f&             minor_axis) const
+{
+    const CanvasProperties& props = m_level_props[level];
+    const float width = static_cast<float>(props.m_canvas_width);
+    const float height = static_cast<float>(props.m_canvas_height);
+
+    // Express the footprint in texels of this level.
+    const float sx = width / m_scalar_canvas_width;
+    const float sy = height / m_scalar_canvas_height;
+    const Vector2f d0(major_axis.x * sx, major_axis.y * sy);
+    const Vector2f d1(minor_axis.x * sx, minor_axis.y * sy);
+    const float cx = p.x * width - 0.5f;
+    const float cy = p.y * height - 0.5f;
+
+    // Compute the coefficients of the implicit equation of the ellipse,
+    // enlarged such that it covers at least one texel.
+    float a = d0.y * d0.y + d1.y * d1.y + 1.0f;
+    float b = -2.0f * (d0.x * d0.y + d1.x * d1.y);
+    float c = d0.x * d0.x + d1.x * d1.x + 1.0f;
+    const float rcp_f = 1.0f / (a * c - b * b * 0.25f);
+    a *= rcp_f;
+    b *= rcp_f;
+    c *= rcp_f;
+
+    // Compute the bounding box of the ellipse.
+    const float d = -b * b + 4.0f * a * c;
+    const float rcp_d = 1.0f / d;
+    const float extent_x = 2.0f * rcp_d * sqrt(d * c);
+    const float extent_y = 2.0f * rcp_d * sqrt(d * a);
+    const int x0 = static_cast<int>(ceil(cx - extent_x));
+    const int x1 = static_cast<int>(floor(cx + extent_x));
+    const int y0 = static_cast<int>(ceil(cy - extent_y));
+    const int y1 = static_cast<int>(floor(cy + extent_y));
+
+    // Accumulate the texels inside the ellipse, weighted by a Gaussian.
+    const float min_weight = exp(-EWAFilterAlpha);
+    Color4f sum(0.0f);
+    float weight_sum = 0.0f;
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        const float dy = y - cy;
+
+        for (int x = x0; x <= x1; ++x)
+        {
+            const float dx = x - cx;
+            const float r2 = a * dx * dx + b * dx * dy + c * dy * dy;
+
+            if (r2 < 1.0f)
+            {
+                const float weight = exp(-EWAFilterAlpha * r2) - min_weight;
+                sum += weight * get_texel_addressed(texture_cache, level, x, y);
+                weight_sum += weight;
+            }
+        }
+    }
+
+    return
+        weight_sum > 0.0f
+            ? sum / weight_sum
+            : sample_bilinear(texture_cache, level, p);
+}
+
 Color4f TextureSource::sample_texture(
     TextureCache&               texture_cache,
-    const Vector2f&             uv) const
+    const SourceInputs&         source_inputs) const
 {
     // Start with the transformed input texture coordinates.
-    Vector2f p = apply_transform(uv);
+    Vector2f p = apply_transform(Vector2f(source_inputs.m_uv_x, source_inputs.m_uv_y));
     p.y = 1.0f - p.y;
 
     // Apply the texture addressing mode.
@@ -375,42 +625,27 @@ Color4f TextureSource::sample_texture(
             const size_t ix = truncate<size_t>(p.x);
             const size_t iy = truncate<size_t>(p.y);
 
-            return get_texel(texture_cache, ix, iy);
+            return get_texel(texture_cache, 0, ix, iy);
         }
 
       case TextureFilteringBilinear:
+        return sample_bilinear(texture_cache, 0, p);
+
+      case TextureFilteringTrilinear:
+      case TextureFilteringEWA:
         {
-            p.x *= m_max_x;
-            p.y *= m_max_y;
-
-            const int ix = truncate<int>(p.x);
-            const int iy = truncate<int>(p.y);
-
-            // Retrieve the four surrounding texels.
-            Color4f t00, t10, t01, t11;
-            get_texels_2x2(
-                texture_cache,
-                ix, iy,
-                t00, t10, t01, t11);
-
-            // Compute weights.
-            const float wx1 = p.x - ix;
-            const float wy1 = p.y - iy;
-            const float wx0 = 1.0f - wx1;
-            const float wy0 = 1.0f - wy1;
-
-            // Apply weights.
-            t00 *= wx0 * wy0;
-            t10 *= wx1 * wy0;
-            t01 *= wx0 * wy1;
-            t11 *= wx1 * wy1;
-
-            // Accumulate.
-            t00 += t10;
-            t00 += t01;
-            t00 += t11;
-
-            return t00;
+            // Express the footprint of the shading point in texels of the finest level.
+            Vector2f dpdx = apply_transform_to_derivative(Vector2f(source_inputs.m_dudx, source_inputs.m_dvdx));
+            Vector2f dpdy = apply_transform_to_derivative(Vector2f(source_inputs.m_dudy, source_inputs.m_dvdy));
+            dpdx.x *= m_scalar_canvas_width;
+            dpdx.y *= -m_scalar_canvas_height;
+            dpdy.x *= m_scalar_canvas_width;
+            dpdy.y *= -m_scalar_canvas_height;
+
+            return
+                m_texture_instance.get_filtering_mode() == TextureFilteringTrilinear
+                    ? sample_trilinear(texture_cache, p, dpdx, dpdy)
+                    : sample_ewa(texture_cache, p, dpdx, dpdy);
         }
 
       default:
@@ -176,6 +176,12 @@ const GVector3& MeshObject::get_vertex(const size_t index) const
     return impl->m_tess.m_vertices[index];
 }
 
+void MeshObject::set_vertex(const size_t index, const GVector3& vertex)
+{
+    assert(index < impl->m_tess.m_vertices.size());
+    impl->m_tess.m_vertices[index] = vertex;
+}
+
 void MeshObject::reserve_vertex_normals(const size_t count)
 {
     impl->m_tess.m_vertex_normals.reserve(count);
@@ -92,6 +92,7 @@ class APPLESEED_DLLSYMBOL MeshObject
     size_t push_vertex(const GVector3& vertex);
     size_t get_vertex_count() const;
     const GVector3& get_vertex(const size_t index) const;
+    void set_vertex(const size_t index, const GVector3& vertex);
 
     // Insert and access vertex normals.
     void reserve_vertex_normals(const size_t count);
@@ -43,6 +43,7 @@
 #include "foundation/math/scalar.h"
 #include "foundation/math/triangulator.h"
 #include "foundation/math/vector.h"
+#include "foundation/mesh/binarymeshfilereader.h"
 #include "foundation/mesh/genericmeshfilereader.h"
 #include "foundation/mesh/imeshbuilder.h"
 #include "foundation/mesh/imeshfilereader.h"
@@ -196,6 +197,33 @@ namespace
             return m_objects.back()->push_tex_coords(GVector2(v));
         }
 
+        void push_vertex_array(const float* coords, const size_t count) override
+        {
+            MeshObject* object = m_objects.back();
+            object->reserve_vertices(object->get_vertex_count() + count);
+
+            for (size_t i = 0; i < count; ++i, coords += 3)
+                object->push_vertex(GVector3(coords[0], coords[1], coords[2]));
+        }
+
+        void push_vertex_normal_array(const float* coords, const size_t count) override
+        {
+            MeshObject* object = m_objects.back();
+            object->reserve_vertex_normals(object->get_vertex_normal_count() + count);
+
+            for (size_t i = 0; i < count; ++i, coords += 3)
+                push_vertex_normal(Vector3d(coords[0], coords[1], coords[2]));
+        }
+
+        void push_tex_coords_array(const float* coords, const size_t count) override
+        {
+            MeshObject* object = m_objects.back();
+            object->reserve_tex_coords(object->get_tex_coords_count() + count);
+
+            for (size_t i = 0; i < count; ++i, coords += 2)
+                object->push_tex_coords(GVector2(coords[0], coords[1]));
+        }
+
         size_t push_material_slot(const char* name) override
         {
             return m_objects.back()->push_material_slot(name);
@@ -427,6 +455,20 @@ namespace
                 reader.get_obj_options() | OBJMeshFileReader::FavorSpeedOverPrecision);
         }
 
+        // Optionally only load a single mesh of the file, looked up by name.
+        const string mesh_name = params.get_optional<string>("mesh", "");
+
+        if (!mesh_name.empty() && !ends_with(lower_case(filename), ".binarymesh"))
+        {
+            RENDERER_LOG_ERROR(
+                "while reading geometry for object \"%s\" from mesh file %s: "
+                "meshes can only be selected by name in binarymesh files.",
+                base_object_name,
+                filename);
+
+            return false;
+        }
+
         MeshObjectBuilder builder(params, base_object_name);
 
         Stopwatch<DefaultWallclockTimer> stopwatch;
@@ -434,7 +476,13 @@ namespace
 
         try
         {
-            reader.read(builder);
+            if (mesh_name.empty())
+                reader.read(builder);
+            else
+            {
+                BinaryMeshFileReader binary_reader(filename);
+                binary_reader.read_mesh(mesh_name.c_str(), builder);
+            }
         }
         catch (const OBJMeshFileReader::ExceptionInvalidFaceDef& e)
         {
@@ -76,7 +76,7 @@ Dictionary Configuration::get_metadata()
         "spectrum_mode",
         Dictionary()
         .insert("type", "enum")
-        .insert("values", "rgb|spectral")
+        .insert("values", "rgb|spectral|hero")
         .insert("default", "rgb")
         .insert("label", "Color Pipeline")
         .insert("help", "Color pipeline used throughout the renderer")
@@ -92,13 +92,18 @@ Dictionary Configuration::get_metadata()
                 "spectral",
                 Dictionary()
                 .insert("label", "Spectral")
-                .insert("help", "Spectral pipeline using 31 equidistant components in the 400-700 nm range"))));
+                .insert("help", "Spectral pipeline using 31 equidistant components in the 400-700 nm range"))
+            .insert(
+                "hero",
+                Dictionary()
+                .insert("label", "Spectral (Hero Wavelengths)")
+                .insert("help", "Spectral pipeline tracing each camera path with a set of 4 equidistant hero wavelengths"))));
 
     metadata.insert(
         "sampling_mode",
         Dictionary()
             .insert("type", "enum")
-            .insert("values", "rng|qmc")
+            .insert("values", "rng|qmc|sobol")
             .insert("default", "qmc")
             .insert("label", "Sampler")
             .insert("help", "Sampling algorithm used in Monte Carlo integration")
@@ -114,7 +119,12 @@ Dictionary Configuration::get_metadata()
                         "qmc",
                         Dictionary()
                             .insert("label", "QMC")
-                            .insert("help", "Quasi Monte Carlo sampler"))));
+                            .insert("help", "Quasi Monte Carlo sampler"))
+                    .insert(
+                        "sobol",
+                        Dictionary()
+                            .insert("label", "Sobol")
+                            .insert("help", "Owen-scrambled Sobol sampler distributing the error as blue noise in screen space"))));
 
     metadata.dictionaries().insert(
         "passes",
@@ -168,6 +178,17 @@ Dictionary Configuration::get_metadata()
         "light_sampler",
         BackwardLightSampler::get_params_metadata());
 
+    metadata.dictionaries().insert(
+        "shading_engine",
+        Dictionary()
+            .insert(
+                "osl_shader_group_cache",
+                Dictionary()
+                    .insert("type", "string")
+                    .insert("default", "")
+                    .insert("label", "OSL Shader Group Cache")
+                    .insert("help", "File in which to cache the closures used by OSL shader groups, to avoid optimizing unchanged shader groups before rendering")));
+
     metadata.dictionaries().insert(
         "texture_store",
         TextureStore::get_params_metadata());
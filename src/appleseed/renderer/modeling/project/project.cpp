@@ -407,6 +407,12 @@ void Project::update_trace_context()
         impl->m_trace_context->update();
 }
 
+void Project::set_trace_context_thread_count(const size_t thread_count)
+{
+    if (impl->m_trace_context.get() != nullptr)
+        impl->m_trace_context->set_thread_count(thread_count);
+}
+
 #ifdef APPLESEED_WITH_EMBREE
 
 void Project::set_use_embree(const bool value)
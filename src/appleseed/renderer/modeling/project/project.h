@@ -180,6 +180,9 @@ class APPLESEED_DLLSYMBOL Project
     // Synchronize the trace context with the scene.
     void update_trace_context();
 
+    // Set the number of threads used to build the acceleration structures of the trace context.
+    void set_trace_context_thread_count(const size_t thread_count);
+
 #ifdef APPLESEED_WITH_EMBREE
     // Set use Embree flag for trace context
     void set_use_embree(const bool value);
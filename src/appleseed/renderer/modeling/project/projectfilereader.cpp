@@ -64,7 +64,9 @@
 #include "renderer/modeling/material/imaterialfactory.h"
 #include "renderer/modeling/material/material.h"
 #include "renderer/modeling/material/materialfactoryregistrar.h"
+#include "renderer/modeling/object/curveobject.h"
 #include "renderer/modeling/object/iobjectfactory.h"
+#include "renderer/modeling/object/meshobject.h"
 #include "renderer/modeling/object/object.h"
 #include "renderer/modeling/object/objectfactoryregistrar.h"
 #include "renderer/modeling/postprocessingstage/ipostprocessingstagefactory.h"
@@ -109,12 +111,16 @@
 #include "foundation/math/vector.h"
 #include "foundation/platform/compiler.h"
 #include "foundation/platform/defaulttimers.h"
+#include "foundation/platform/system.h"
 #include "foundation/platform/types.h"
 #include "foundation/utility/api/apiarray.h"
 #include "foundation/utility/api/apistring.h"
 #include "foundation/utility/containers/dictionary.h"
 #include "foundation/utility/foreach.h"
 #include "foundation/utility/iterators.h"
+#include "foundation/utility/job/ijob.h"
+#include "foundation/utility/job/jobmanager.h"
+#include "foundation/utility/job/jobqueue.h"
 #include "foundation/utility/log.h"
 #include "foundation/utility/memory.h"
 #include "foundation/utility/otherwise.h"
@@ -207,6 +213,238 @@ namespace
     };
 
 
+    //
+    // Create objects using a given object factory. Errors are logged.
+    //
+
+    bool create_objects(
+        const IObjectFactory&   factory,
+        const string&           name,
+        const ParamArray&       params,
+        const SearchPaths&      search_paths,
+        const bool              omit_loading_assets,
+        ObjectArray&            objects)
+    {
+        try
+        {
+            return
+                factory.create(
+                    name.c_str(),
+                    params,
+                    search_paths,
+                    omit_loading_assets,
+                    objects);
+        }
+        catch (const ExceptionDictionaryKeyNotFound& e)
+        {
+            RENDERER_LOG_ERROR(
+                "while defining object \"%s\": required parameter \"%s\" missing.",
+                name.c_str(),
+                e.string());
+        }
+        catch (const ExceptionUnknownEntity& e)
+        {
+            RENDERER_LOG_ERROR(
+                "while defining object \"%s\": unknown entity \"%s\".",
+                name.c_str(),
+                e.string());
+        }
+        catch (const Exception& e)
+        {
+            RENDERER_LOG_ERROR(
+                "while defining object \"%s\": %s",
+                name.c_str(),
+                e.what());
+        }
+
+        return false;
+    }
+
+
+    //
+    // Reads mesh and curve files on worker threads while the project file is being parsed.
+    //
+    // Objects read in the background are inserted into their assembly once the whole
+    // project file has been parsed, in the order in which they were declared. Requests
+    // refer to their assembly by unique ID, and are only honored if the assembly made
+    // it into the scene.
+    //
+
+    class ObjectLoader
+      : public NonCopyable
+    {
+      public:
+        struct Request
+        {
+            const IObjectFactory*   m_factory;
+            string                  m_name;
+            ParamArray              m_params;
+            SearchPaths             m_search_paths;
+            ObjectArray             m_objects;
+            bool                    m_success;
+            UniqueID                m_assembly_uid; // assembly receiving the objects, if any
+        };
+
+        ~ObjectLoader()
+        {
+            if (m_job_manager)
+                m_job_queue.wait_until_completion();
+
+            // Delete objects that were never handed over to an assembly.
+            for (const unique_ptr<Request>& request : m_requests)
+            {
+                for (size_t i = 0, e = request->m_objects.size(); i < e; ++i)
+                    request->m_objects[i]->release();
+            }
+        }
+
+        // Return true if objects of a given model can be loaded in the background.
+        static bool is_supported_model(const string& model)
+        {
+            return
+                model == MeshObjectFactory().get_model() ||
+                model == CurveObjectFactory().get_model();
+        }
+
+        // Schedule the creation of objects. Returns immediately.
+        Request* schedule(
+            const IObjectFactory&   factory,
+            const string&           name,
+            const ParamArray&       params,
+            const SearchPaths&      search_paths)
+        {
+            if (!m_job_manager)
+            {
+                m_job_manager.reset(
+                    new JobManager(
+                        global_logger(),
+                        m_job_queue,
+                        System::get_logical_cpu_core_count(),
+                        JobManager::KeepRunningOnEmptyQueue));
+                m_job_manager->start();
+            }
+
+            unique_ptr<Request> request(new Request());
+            request->m_factory = &factory;
+            request->m_name = name;
+            request->m_params = params;
+            request->m_search_paths = search_paths;
+            request->m_success = false;
+            request->m_assembly_uid = ~UniqueID(0);
+
+            m_job_queue.schedule(new LoadObjectsJob(*request));
+            m_requests.push_back(move(request));
+
+            return m_requests.back().get();
+        }
+
+        // Record objects that were already created, so that they are inserted
+        // in declaration order with respect to objects read in the background.
+        Request* add(const vector<Object*>& objects)
+        {
+            unique_ptr<Request> request(new Request());
+            request->m_factory = nullptr;
+            request->m_success = true;
+            request->m_assembly_uid = ~UniqueID(0);
+
+            for (Object* object : objects)
+                request->m_objects.push_back(object);
+
+            m_requests.push_back(move(request));
+
+            return m_requests.back().get();
+        }
+
+        // Wait until all scheduled objects are loaded and insert them into their assembly.
+        void complete(Project& project, EventCounters& event_counters)
+        {
+            if (!m_job_manager)
+                return;
+
+            m_job_queue.wait_until_completion();
+            m_job_manager.reset();
+
+            // Find the assemblies that were accepted into the scene.
+            AssemblyMap assemblies;
+            if (project.get_scene())
+                collect_assemblies(project.get_scene()->assemblies(), assemblies);
+
+            for (const unique_ptr<Request>& request : m_requests)
+            {
+                if (!request->m_success)
+                    event_counters.signal_error();
+
+                const AssemblyMap::const_iterator assembly = assemblies.find(request->m_assembly_uid);
+
+                for (size_t i = 0, e = request->m_objects.size(); i < e; ++i)
+                {
+                    auto_release_ptr<Object> object(request->m_objects[i]);
+
+                    if (assembly == assemblies.end())
+                        continue;
+
+                    ObjectContainer& objects = assembly->second->objects();
+                    if (objects.get_by_name(object->get_name()) != nullptr)
+                    {
+                        RENDERER_LOG_ERROR(
+                            "an entity with the path \"%s\" already exists.",
+                            object->get_path().c_str());
+                        event_counters.signal_error();
+                        continue;
+                    }
+
+                    objects.insert(object);
+                }
+
+                request->m_objects.clear();
+            }
+
+            m_requests.clear();
+        }
+
+      private:
+        class LoadObjectsJob
+          : public IJob
+        {
+          public:
+            explicit LoadObjectsJob(Request& request)
+              : m_request(request)
+            {
+            }
+
+            void execute(const size_t thread_index) override
+            {
+                m_request.m_success =
+                    create_objects(
+                        *m_request.m_factory,
+                        m_request.m_name,
+                        m_request.m_params,
+                        m_request.m_search_paths,
+                        false,
+                        m_request.m_objects);
+            }
+
+          private:
+            Request& m_request;
+        };
+
+        typedef map<UniqueID, Assembly*> AssemblyMap;
+
+        JobQueue                            m_job_queue;
+        unique_ptr<JobManager>              m_job_manager;
+        vector<unique_ptr<Request>>         m_requests;
+
+        static void collect_assemblies(AssemblyContainer& container, AssemblyMap& assemblies)
+        {
+            for (Assembly& assembly : container)
+            {
+                assemblies[assembly.get_uid()] = &assembly;
+                collect_assemblies(assembly.assemblies(), assemblies);
+            }
+        }
+    };
+
+
     //
     // A set of objects that is passed to all element handlers.
     //
@@ -239,10 +477,16 @@ namespace
             return m_event_counters;
         }
 
+        ObjectLoader& get_object_loader()
+        {
+            return m_object_loader;
+        }
+
       private:
         Project&            m_project;
         const int           m_options;
         EventCounters&      m_event_counters;
+        ObjectLoader        m_object_loader;
     };
 
 
@@ -1531,6 +1775,7 @@ namespace
 
         explicit ObjectElementHandler(ParseContext& context)
           : m_context(context)
+          , m_request(nullptr)
         {
         }
 
@@ -1539,6 +1784,7 @@ namespace
             ParametrizedElementHandler::start_element(attrs);
 
             clear_keep_memory(m_objects);
+            m_request = nullptr;
 
             m_name = get_value(attrs, "name");
             m_model = get_value(attrs, "model");
@@ -1548,57 +1794,45 @@ namespace
         {
             ParametrizedElementHandler::end_element();
 
-            try
-            {
-                const IObjectFactory* factory =
-                    m_context.get_project().get_factory_registrar<Object>().lookup(m_model.c_str());
+            const IObjectFactory* factory =
+                m_context.get_project().get_factory_registrar<Object>().lookup(m_model.c_str());
 
-                if (factory)
-                {
-                    ObjectArray objects;
-                    if (!factory->create(
-                            m_name.c_str(),
-                            m_params,
-                            m_context.get_project().search_paths(),
-                            m_context.get_options() & ProjectFileReader::OmitReadingMeshFiles,
-                            objects))
-                        m_context.get_event_counters().signal_error();
-
-                    m_objects = array_vector<ObjectVector>(objects);
-                }
-                else
-                {
-                    RENDERER_LOG_ERROR(
-                        "while defining object \"%s\": invalid model \"%s\".",
-                        m_name.c_str(),
-                        m_model.c_str());
-                    m_context.get_event_counters().signal_error();
-                }
-            }
-            catch (const ExceptionDictionaryKeyNotFound& e)
+            if (factory == nullptr)
             {
                 RENDERER_LOG_ERROR(
-                    "while defining object \"%s\": required parameter \"%s\" missing.",
+                    "while defining object \"%s\": invalid model \"%s\".",
                     m_name.c_str(),
-                    e.string());
+                    m_model.c_str());
                 m_context.get_event_counters().signal_error();
+                return;
             }
-            catch (const ExceptionUnknownEntity& e)
+
+            const bool omit_loading_assets =
+                (m_context.get_options() & ProjectFileReader::OmitReadingMeshFiles) != 0;
+
+            if (!omit_loading_assets && ObjectLoader::is_supported_model(m_model))
             {
-                RENDERER_LOG_ERROR(
-                    "while defining object \"%s\": unknown entity \"%s\".",
-                    m_name.c_str(),
-                    e.string());
-                m_context.get_event_counters().signal_error();
+                // Read the object's files in the background while parsing continues.
+                m_request =
+                    m_context.get_object_loader().schedule(
+                        *factory,
+                        m_name,
+                        m_params,
+                        m_context.get_project().search_paths());
+                return;
             }
-            catch (const Exception& e)
-            {
-                RENDERER_LOG_ERROR(
-                    "while defining object \"%s\": %s",
-                    m_name.c_str(),
-                    e.what());
+
+            ObjectArray objects;
+            if (!create_objects(
+                    *factory,
+                    m_name,
+                    m_params,
+                    m_context.get_project().search_paths(),
+                    omit_loading_assets,
+                    objects))
                 m_context.get_event_counters().signal_error();
-            }
+
+            m_objects = array_vector<ObjectVector>(objects);
         }
 
         const ObjectVector& get_objects() const
@@ -1606,11 +1840,18 @@ namespace
             return m_objects;
         }
 
+        // Return the pending request if the objects are being read in the background.
+        ObjectLoader::Request* get_request() const
+        {
+            return m_request;
+        }
+
       private:
-        ParseContext&   m_context;
-        ObjectVector    m_objects;
-        string          m_name;
-        string          m_model;
+        ParseContext&           m_context;
+        ObjectVector            m_objects;
+        ObjectLoader::Request*  m_request;
+        string                  m_name;
+        string                  m_model;
     };
 
 
@@ -2090,6 +2331,7 @@ namespace
             m_lights.clear();
             m_materials.clear();
             m_objects.clear();
+            m_object_requests.clear();
             m_object_instances.clear();
             m_volumes.clear();
             m_shader_groups.clear();
@@ -2127,6 +2369,10 @@ namespace
                 m_assembly->surface_shaders().swap(m_surface_shaders);
                 m_assembly->textures().swap(m_textures);
                 m_assembly->texture_instances().swap(m_texture_instances);
+
+                // Objects still being read will be inserted once parsing is complete.
+                for (ObjectLoader::Request* request : m_object_requests)
+                    request->m_assembly_uid = m_assembly->get_uid();
             }
             else
             {
@@ -2193,8 +2439,22 @@ namespace
                 break;
 
               case ElementObject:
-                for (Object* object : static_cast<ObjectElementHandler*>(handler)->get_objects())
-                    insert(m_objects, auto_release_ptr<Object>(object));
+                {
+                    ObjectElementHandler* object_handler = static_cast<ObjectElementHandler*>(handler);
+                    if (object_handler->get_request())
+                        m_object_requests.push_back(object_handler->get_request());
+                    else if (!m_object_requests.empty())
+                    {
+                        // Objects declared after one being read in the background are inserted after it.
+                        m_object_requests.push_back(
+                            m_context.get_object_loader().add(object_handler->get_objects()));
+                    }
+                    else
+                    {
+                        for (Object* object : object_handler->get_objects())
+                            insert(m_objects, auto_release_ptr<Object>(object));
+                    }
+                }
                 break;
 
               case ElementObjectInstance:
@@ -2257,6 +2517,7 @@ namespace
         LightContainer              m_lights;
         MaterialContainer           m_materials;
         ObjectContainer             m_objects;
+        vector<ObjectLoader::Request*> m_object_requests;
         ObjectInstanceContainer     m_object_instances;
         VolumeContainer             m_volumes;
         ShaderGroupContainer        m_shader_groups;
@@ -3528,6 +3789,9 @@ auto_release_ptr<Project> ProjectFileReader::load_project_file(
         return auto_release_ptr<Project>(nullptr);
     }
 
+    // Wait for objects being read in the background.
+    context.get_object_loader().complete(*project, event_counters);
+
     // Report a failure in case of warnings or errors.
     if (error_handler->get_warning_count() > 0 ||
         error_handler->get_error_count() > 0 ||
@@ -31,6 +31,8 @@
 #include "basegroup.h"
 
 // appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+#include "renderer/kernel/shading/oslshadergroupcache.h"
 #include "renderer/kernel/shading/oslshadingsystem.h"
 #include "renderer/modeling/color/colorentity.h"
 #include "renderer/modeling/scene/assembly.h"
@@ -40,13 +42,62 @@
 #include "renderer/modeling/texture/texture.h"
 
 // appleseed.foundation headers.
-#include "foundation/utility/job/abortswitch.h"
+#include "foundation/platform/defaulttimers.h"
+#include "foundation/utility/job.h"
+#include "foundation/utility/stopwatch.h"
+#include "foundation/utility/string.h"
+
+// Boost headers.
+#include "boost/atomic/atomic.hpp"
 
 using namespace foundation;
+using namespace std;
 
 namespace renderer
 {
 
+namespace
+{
+    //
+    // A job that optimizes an OSL shader group.
+    //
+
+    class OptimizeShaderGroupJob
+      : public IJob
+    {
+      public:
+        OptimizeShaderGroupJob(
+            OSLShadingSystem&       shading_system,
+            OSLShaderGroupCache*    cache,
+            ShaderGroup&            shader_group,
+            boost::atomic<bool>&    success,
+            IAbortSwitch*           abort_switch)
+          : m_shading_system(shading_system)
+          , m_cache(cache)
+          , m_shader_group(shader_group)
+          , m_success(success)
+          , m_abort_switch(abort_switch)
+        {
+        }
+
+        void execute(const size_t thread_index) override
+        {
+            if (is_aborted(m_abort_switch))
+                return;
+
+            if (!m_shader_group.optimize_osl_shader_group(m_shading_system, m_cache))
+                m_success = false;
+        }
+
+      private:
+        OSLShadingSystem&           m_shading_system;
+        OSLShaderGroupCache*        m_cache;
+        ShaderGroup&                m_shader_group;
+        boost::atomic<bool>&        m_success;
+        IAbortSwitch*               m_abort_switch;
+    };
+}
+
 struct BaseGroup::Impl
 {
     ColorContainer              m_colors;
@@ -110,6 +161,84 @@ void BaseGroup::clear()
 bool BaseGroup::create_optimized_osl_shader_groups(
     OSLShadingSystem&           shading_system,
     const ShaderCompiler*       shader_compiler,
+    IAbortSwitch*               abort_switch,
+    OSLShaderGroupCache*        cache,
+    const size_t                thread_count)
+{
+    // Creating shader groups relies on the global state of the shading system:
+    // this must be done sequentially.
+    vector<ShaderGroup*> shader_groups_to_optimize;
+    if (!create_osl_shader_groups(
+            shading_system,
+            shader_compiler,
+            cache,
+            shader_groups_to_optimize,
+            abort_switch))
+        return false;
+
+    if (shader_groups_to_optimize.empty())
+        return true;
+
+    RENDERER_LOG_INFO(
+        "optimizing %s osl shader %s using %s %s...",
+        pretty_uint(shader_groups_to_optimize.size()).c_str(),
+        plural(shader_groups_to_optimize.size(), "group").c_str(),
+        pretty_uint(thread_count).c_str(),
+        plural(thread_count, "thread").c_str());
+
+    Stopwatch<DefaultWallclockTimer> stopwatch;
+    stopwatch.start();
+
+    // Optimizing shader groups is independent from one shader group to the next.
+    boost::atomic<bool> success(true);
+    if (thread_count > 1 && shader_groups_to_optimize.size() > 1)
+    {
+        JobQueue job_queue;
+        JobManager job_manager(global_logger(), job_queue, thread_count);
+        job_manager.start();
+
+        for (ShaderGroup* shader_group : shader_groups_to_optimize)
+        {
+            job_queue.schedule(
+                new OptimizeShaderGroupJob(
+                    shading_system,
+                    cache,
+                    *shader_group,
+                    success,
+                    abort_switch));
+        }
+
+        job_queue.wait_until_completion();
+    }
+    else
+    {
+        for (ShaderGroup* shader_group : shader_groups_to_optimize)
+        {
+            if (is_aborted(abort_switch))
+                break;
+
+            if (!shader_group->optimize_osl_shader_group(shading_system, cache))
+                success = false;
+        }
+    }
+
+    stopwatch.measure();
+
+    if (!success || is_aborted(abort_switch))
+        return false;
+
+    RENDERER_LOG_INFO(
+        "optimized osl shader groups in %s.",
+        pretty_time(stopwatch.get_seconds()).c_str());
+
+    return true;
+}
+
+bool BaseGroup::create_osl_shader_groups(
+    OSLShadingSystem&           shading_system,
+    const ShaderCompiler*       shader_compiler,
+    OSLShaderGroupCache*        cache,
+    vector<ShaderGroup*>&       shader_groups_to_optimize,
     IAbortSwitch*               abort_switch)
 {
     for (Assembly& assembly : assemblies())
@@ -117,9 +246,11 @@ bool BaseGroup::create_optimized_osl_shader_groups(
         if (is_aborted(abort_switch))
             return false;
 
-        if (!assembly.create_optimized_osl_shader_groups(
+        if (!assembly.create_osl_shader_groups(
                 shading_system,
                 shader_compiler,
+                cache,
+                shader_groups_to_optimize,
                 abort_switch))
             return false;
     }
@@ -129,11 +260,15 @@ bool BaseGroup::create_optimized_osl_shader_groups(
         if (is_aborted(abort_switch))
             return false;
 
-        if (!shader_group.create_optimized_osl_shader_group(
+        if (!shader_group.create_osl_shader_group(
                 shading_system,
                 shader_compiler,
+                cache,
                 abort_switch))
             return false;
+
+        if (shader_group.needs_optimization())
+            shader_groups_to_optimize.push_back(&shader_group);
     }
 
     return true;
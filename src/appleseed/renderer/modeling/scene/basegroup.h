@@ -35,6 +35,10 @@
 // appleseed.main headers.
 #include "main/dllsymbol.h"
 
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
 // Forward declarations.
 namespace foundation    { class IAbortSwitch; }
 namespace foundation    { class StringArray; }
@@ -42,9 +46,11 @@ namespace foundation    { class StringDictionary; }
 namespace renderer      { class Entity; }
 namespace renderer      { class OnFrameBeginRecorder; }
 namespace renderer      { class OnRenderBeginRecorder; }
+namespace renderer      { class OSLShaderGroupCache; }
 namespace renderer      { class OSLShadingSystem; }
 namespace renderer      { class Project; }
 namespace renderer      { class ShaderCompiler; }
+namespace renderer      { class ShaderGroup; }
 
 namespace renderer
 {
@@ -71,11 +77,15 @@ class APPLESEED_DLLSYMBOL BaseGroup
     // Clear the base group contents.
     void clear();
 
-    // Create OSL shader groups and optimize them.
+    // Create OSL shader groups and optimize them. Shader groups found in the cache, if any,
+    // are left to be optimized by OSL on first execution; the others are optimized using
+    // a given number of threads.
     bool create_optimized_osl_shader_groups(
         OSLShadingSystem&           shading_system,
         const ShaderCompiler*       shader_compiler,
-        foundation::IAbortSwitch*   abort_switch = nullptr);
+        foundation::IAbortSwitch*   abort_switch = nullptr,
+        OSLShaderGroupCache*        cache = nullptr,
+        const size_t                thread_count = 1);
 
     // Release internal OSL shader groups.
     void release_optimized_osl_shader_groups();
@@ -116,6 +126,14 @@ class APPLESEED_DLLSYMBOL BaseGroup
   private:
     struct Impl;
     Impl* impl;
+
+    // Recursively create OSL shader groups and collect the ones that need to be optimized.
+    bool create_osl_shader_groups(
+        OSLShadingSystem&           shading_system,
+        const ShaderCompiler*       shader_compiler,
+        OSLShaderGroupCache*        cache,
+        std::vector<ShaderGroup*>&  shader_groups_to_optimize,
+        foundation::IAbortSwitch*   abort_switch);
 };
 
 }   // namespace renderer
@@ -70,7 +70,8 @@ enum TextureFilteringMode
     TextureFilteringBilinear,
     TextureFilteringBicubic,
     TextureFilteringFeline,             // Reference: http://www.hpl.hp.com/techreports/Compaq-DEC/WRL-99-1.pdf
-    TextureFilteringEWA
+    TextureFilteringEWA,
+    TextureFilteringTrilinear
 };
 
 enum TextureAlphaMode
@@ -31,6 +31,7 @@
 
 // appleseed.renderer headers.
 #include "renderer/global/globallogger.h"
+#include "renderer/kernel/shading/oslshadergroupcache.h"
 #include "renderer/kernel/shading/oslshadingsystem.h"
 #include "renderer/modeling/project/project.h"
 #include "renderer/modeling/shadergroup/shader.h"
@@ -48,6 +49,7 @@
 
 // Standard headers.
 #include <exception>
+#include <string>
 #include <utility>
 
 using namespace foundation;
@@ -94,6 +96,8 @@ struct ShaderGroup::Impl
     ShaderConnectionContainer   m_connections;
     mutable OSL::ShaderGroupRef m_shader_group_ref;
     mutable SurfaceAreaMap      m_surface_areas;
+    bool                        m_needs_optimization;
+    string                      m_cache_key;            // empty if the shader group cannot be cached
 };
 
 ShaderGroup::ShaderGroup(const char* name)
@@ -124,6 +128,7 @@ void ShaderGroup::clear()
     impl->m_shaders.clear();
     impl->m_connections.clear();
     impl->m_shader_group_ref.reset();
+    impl->m_needs_optimization = false;
     m_flags = 0;
 }
 
@@ -192,6 +197,18 @@ bool ShaderGroup::create_optimized_osl_shader_group(
     OSLShadingSystem&       shading_system,
     const ShaderCompiler*   shader_compiler,
     IAbortSwitch*           abort_switch)
+{
+    if (!create_osl_shader_group(shading_system, shader_compiler, nullptr, abort_switch))
+        return false;
+
+    return needs_optimization() ? optimize_osl_shader_group(shading_system) : true;
+}
+
+bool ShaderGroup::create_osl_shader_group(
+    OSLShadingSystem&       shading_system,
+    const ShaderCompiler*   shader_compiler,
+    OSLShaderGroupCache*    cache,
+    IAbortSwitch*           abort_switch)
 {
     if (is_valid())
         return true;
@@ -242,7 +259,43 @@ bool ShaderGroup::create_optimized_osl_shader_group(
         }
 
         impl->m_shader_group_ref = shader_group_ref;
+        impl->m_needs_optimization = true;
+        impl->m_cache_key.clear();
 
+        // Retrieve the closures and globals used by the shader group from the cache.
+        if (cache && cache->compute_key(*this, impl->m_cache_key))
+        {
+            uint32 flags;
+            if (cache->lookup(impl->m_cache_key, flags))
+            {
+                m_flags = flags;
+                impl->m_needs_optimization = false;
+            }
+        }
+
+        return true;
+    }
+    catch (const exception& e)
+    {
+        RENDERER_LOG_ERROR("failed to setup shader group \"%s\": %s.", get_path().c_str(), e.what());
+        return false;
+    }
+}
+
+bool ShaderGroup::needs_optimization() const
+{
+    return impl->m_needs_optimization;
+}
+
+bool ShaderGroup::optimize_osl_shader_group(
+    OSLShadingSystem&       shading_system,
+    OSLShaderGroupCache*    cache)
+{
+    assert(is_valid());
+
+    try
+    {
+        // Querying the closures used by the shader group causes OSL to optimize it.
         get_shadergroup_closures_info(shading_system);
         report_has_closure("bsdf", HasBSDFs);
         report_has_closure(g_emission_str.c_str(), HasEmission);
@@ -256,11 +309,16 @@ bool ShaderGroup::create_optimized_osl_shader_group(
         get_shadergroup_globals_info(shading_system);
         report_uses_global("dPdtime", UsesdPdTime);
 
+        impl->m_needs_optimization = false;
+
+        if (cache && !impl->m_cache_key.empty())
+            cache->insert(impl->m_cache_key, m_flags);
+
         return true;
     }
     catch (const exception& e)
     {
-        RENDERER_LOG_ERROR("failed to setup shader group \"%s\": %s.", get_path().c_str(), e.what());
+        RENDERER_LOG_ERROR("failed to optimize shader group \"%s\": %s.", get_path().c_str(), e.what());
         return false;
     }
 }
@@ -268,6 +326,7 @@ bool ShaderGroup::create_optimized_osl_shader_group(
 void ShaderGroup::release_optimized_osl_shader_group()
 {
     impl->m_shader_group_ref.reset();
+    impl->m_needs_optimization = false;
 }
 
 const ShaderContainer& ShaderGroup::shaders() const
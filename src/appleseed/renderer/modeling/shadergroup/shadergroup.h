@@ -45,6 +45,7 @@
 namespace foundation    { class IAbortSwitch; }
 namespace foundation    { class DictionaryArray; }
 namespace renderer      { class AssemblyInstance; }
+namespace renderer      { class OSLShaderGroupCache; }
 namespace renderer      { class OSLShadingSystem; }
 namespace renderer      { class ObjectInstance; }
 namespace renderer      { class ParamArray; }
@@ -92,12 +93,30 @@ class APPLESEED_DLLSYMBOL ShaderGroup
         const char*                 dst_layer,
         const char*                 dst_param);
 
-    // Create internal OSL shader group.
+    // Create internal OSL shader group and optimize it.
     bool create_optimized_osl_shader_group(
         OSLShadingSystem&           shading_system,
         const ShaderCompiler*       shader_compiler,
         foundation::IAbortSwitch*   abort_switch = nullptr);
 
+    // Create internal OSL shader group without optimizing it. If the cache knows which
+    // closures and globals the shader group uses, the shader group will be optimized by
+    // OSL on first execution; otherwise optimize_osl_shader_group() must be called.
+    bool create_osl_shader_group(
+        OSLShadingSystem&           shading_system,
+        const ShaderCompiler*       shader_compiler,
+        OSLShaderGroupCache*        cache = nullptr,
+        foundation::IAbortSwitch*   abort_switch = nullptr);
+
+    // Return true if the internal OSL shader group must be optimized before rendering.
+    bool needs_optimization() const;
+
+    // Optimize internal OSL shader group and find which closures and globals it uses.
+    // Different shader groups can be optimized concurrently.
+    bool optimize_osl_shader_group(
+        OSLShadingSystem&           shading_system,
+        OSLShaderGroupCache*        cache = nullptr);
+
     // Release internal OSL shader group.
     void release_optimized_osl_shader_group();
 
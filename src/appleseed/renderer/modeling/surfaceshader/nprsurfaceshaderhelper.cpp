@@ -65,7 +65,7 @@ void NPRSurfaceShaderHelper::evaluate(
     const ShaderGroup* sg = material->get_render_data().m_shader_group;
 
     // For now, we only work in RGB mode.
-    if (shading_components.m_beauty.get_mode() == Spectrum::Spectral)
+    if (shading_components.m_beauty.get_mode() != Spectrum::RGB)
         return;
 
     // Make the shading results available to OSL.
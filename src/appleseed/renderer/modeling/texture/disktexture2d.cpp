@@ -43,17 +43,21 @@
 #include "foundation/image/colorspace.h"
 #include "foundation/image/genericprogressiveimagefilereader.h"
 #include "foundation/image/tile.h"
+#include "foundation/platform/system.h"
 #include "foundation/platform/thread.h"
 #include "foundation/utility/api/apistring.h"
 #include "foundation/utility/api/specializedapiarrays.h"
 #include "foundation/utility/containers/dictionary.h"
 #include "foundation/utility/makevector.h"
+#include "foundation/utility/objectpool.h"
 #include "foundation/utility/searchpaths.h"
 #include "foundation/utility/string.h"
 #include "foundation/utility/uid.h"
 
 // Standard headers.
+#include <algorithm>
 #include <cstddef>
+#include <memory>
 #include <string>
 
 using namespace foundation;
@@ -79,7 +83,11 @@ namespace
             const ParamArray&       params,
             const SearchPaths&      search_paths)
           : Texture(name, params)
-          , m_reader(&global_logger())
+          , m_readers(
+                max<size_t>(
+                    m_params.get_optional<size_t>("max_open_readers", System::get_logical_cpu_core_count()),
+                    1))
+          , m_props_valid(false)
         {
             const EntityDefMessageContext context("texture", this);
 
@@ -114,8 +122,12 @@ namespace
             const Project&          project,
             const BaseGroup*        parent) override
         {
-            if (m_reader.is_open())
-                m_reader.close();
+            {
+                // Close all readers of the texture file.
+                boost::mutex::scoped_lock lock(m_mutex);
+                m_readers.clear();
+                m_props_valid = false;
+            }
 
             Texture::on_frame_end(project, parent);
         }
@@ -143,7 +155,19 @@ namespace
         const CanvasProperties& properties() override
         {
             boost::mutex::scoped_lock lock(m_mutex);
-            open_image_file();
+
+            if (!m_props_valid)
+            {
+                RENDERER_LOG_INFO(
+                    "opening texture file %s and reading metadata...",
+                    m_filepath.c_str());
+
+                ScopedReader reader(m_readers, [this]() { return open_reader(); });
+                reader->read_canvas_properties(m_props);
+                reader.release();
+                m_props_valid = true;
+            }
+
             return m_props;
         }
 
@@ -158,9 +182,14 @@ namespace
             const size_t            tile_x,
             const size_t            tile_y) override
         {
-            boost::mutex::scoped_lock lock(m_mutex);
-            open_image_file();
-            return m_reader.read_tile(tile_x, tile_y);
+            // Tiles are read without holding the lock: each reading thread uses its own reader.
+            // Once max_open_readers readers are open, threads wait for one to become idle.
+            // A reader that failed to read a tile is closed rather than returned to the pool.
+            ScopedReader reader(m_readers, [this]() { return open_reader(); });
+            Tile* tile = reader->read_tile(tile_x, tile_y);
+            reader.release();
+
+            return tile;
         }
 
         void unload_tile(
@@ -175,21 +204,20 @@ namespace
         string                              m_filepath;
         ColorSpace                          m_color_space;
 
+        typedef ObjectPool<GenericProgressiveImageFileReader> ReaderPool;
+        typedef ReaderPool::ScopedObject ScopedReader;
+
         mutable boost::mutex                m_mutex;
-        GenericProgressiveImageFileReader   m_reader;
+        ReaderPool                          m_readers;
         CanvasProperties                    m_props;
+        bool                                m_props_valid;
 
-        void open_image_file()
+        GenericProgressiveImageFileReader* open_reader() const
         {
-            if (!m_reader.is_open())
-            {
-                RENDERER_LOG_INFO(
-                    "opening texture file %s and reading metadata...",
-                    m_filepath.c_str());
-
-                m_reader.open(m_filepath.c_str());
-                m_reader.read_canvas_properties(m_props);
-            }
+            unique_ptr<GenericProgressiveImageFileReader> reader(
+                new GenericProgressiveImageFileReader(&global_logger()));
+            reader->open(m_filepath.c_str());
+            return reader.release();
         }
     };
 }
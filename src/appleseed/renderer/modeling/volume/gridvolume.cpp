@@ -0,0 +1,609 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "gridvolume.h"
+
+// appleseed.renderer headers.
+#include "renderer/global/globallogger.h"
+#include "renderer/global/globaltypes.h"
+#include "renderer/kernel/shading/shadingray.h"
+#include "renderer/kernel/volume/majorantgrid.h"
+#include "renderer/kernel/volume/sparsevoxelgrid.h"
+#include "renderer/kernel/volume/volumetracking.h"
+#include "renderer/modeling/input/inputarray.h"
+#include "renderer/modeling/project/project.h"
+#include "renderer/modeling/volume/volume.h"
+#include "renderer/utility/messagecontext.h"
+#include "renderer/utility/paramarray.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/aabb.h"
+#include "foundation/math/hash.h"
+#include "foundation/math/phasefunction.h"
+#include "foundation/math/rng/pcg.h"
+#include "foundation/math/scalar.h"
+#include "foundation/platform/types.h"
+#include "foundation/utility/api/apistring.h"
+#include "foundation/utility/api/specializedapiarrays.h"
+#include "foundation/utility/casts.h"
+#include "foundation/utility/containers/dictionary.h"
+#include "foundation/utility/makevector.h"
+#include "foundation/utility/searchpaths.h"
+#include "foundation/utility/string.h"
+
+// Standard headers.
+#include <cstddef>
+#include <memory>
+#include <string>
+
+using namespace foundation;
+
+namespace renderer
+{
+
+namespace
+{
+    const char* Model = "grid_volume";
+
+    // Accumulate the integral of the majorant along a ray.
+    struct MajorantIntegrator
+    {
+        float   m_integral;
+        float   m_length;
+
+        bool operator()(const float t0, const float t1, const float majorant)
+        {
+            m_integral += majorant * (t1 - t0);
+            m_length += t1 - t0;
+            return true;
+        }
+    };
+
+    // Hash a ray segment into a 64-bit seed.
+    uint64 hash_ray(const ShadingRay& ray, const float distance)
+    {
+        return
+            mix_uint64(
+                mix_uint64(
+                    binary_cast<uint64>(ray.m_org[0]),
+                    binary_cast<uint64>(ray.m_org[1]),
+                    binary_cast<uint64>(ray.m_org[2])),
+                mix_uint64(
+                    binary_cast<uint64>(ray.m_dir[0]),
+                    binary_cast<uint64>(ray.m_dir[1]),
+                    binary_cast<uint64>(ray.m_dir[2])),
+                static_cast<uint64>(binary_cast<uint32>(distance)));
+    }
+}
+
+
+//
+// Grid volume.
+//
+
+class GridVolume
+  : public Volume
+{
+  public:
+    GridVolume(
+        const char*         name,
+        const ParamArray&   params)
+      : Volume(name, params)
+    {
+        m_inputs.declare("absorption", InputFormatSpectralReflectance);
+        m_inputs.declare("absorption_multiplier", InputFormatFloat, "1.0");
+        m_inputs.declare("scattering", InputFormatSpectralReflectance);
+        m_inputs.declare("scattering_multiplier", InputFormatFloat, "1.0");
+        m_inputs.declare("density_multiplier", InputFormatFloat, "1.0");
+        m_inputs.declare("average_cosine", InputFormatFloat, "0.0");
+    }
+
+    void release() override
+    {
+        delete this;
+    }
+
+    const char* get_model() const override
+    {
+        return Model;
+    }
+
+    void collect_asset_paths(StringArray& paths) const override
+    {
+        if (m_params.strings().exist("filename"))
+        {
+            const char* filename = m_params.get("filename");
+            if (!is_empty_string(filename))
+                paths.push_back(filename);
+        }
+    }
+
+    void update_asset_paths(const StringDictionary& mappings) override
+    {
+        m_params.set("filename", mappings.get(m_params.get("filename")));
+    }
+
+    bool on_frame_begin(
+        const Project&          project,
+        const BaseGroup*        parent,
+        OnFrameBeginRecorder&   recorder,
+        IAbortSwitch*           abort_switch) override
+    {
+        if (!Volume::on_frame_begin(project, parent, recorder, abort_switch))
+            return false;
+
+        const OnFrameBeginMessageContext context("volume", this);
+
+        const std::string phase_function =
+            m_params.get_required<std::string>(
+                "phase_function_model",
+                "isotropic",
+                make_vector("isotropic", "henyey"),
+                context);
+
+        if (phase_function == "isotropic")
+            m_phase_function.reset(new IsotropicPhaseFunction());
+        else if (phase_function == "henyey")
+        {
+            const float g =
+                clamp(
+                    m_params.get_optional<float>("average_cosine", 0.0f),
+                    -0.99f, +0.99f);
+            m_phase_function.reset(new HenyeyPhaseFunction(g));
+        }
+        else return false;
+
+        // Load the density grid, unless it was already loaded for a previous frame.
+        const std::string filename =
+            to_string(project.search_paths().qualify(m_params.get_required<std::string>("filename", "")));
+        if (m_grid.get() == nullptr || m_grid_filename != filename)
+        {
+            m_majorants.reset();
+            m_grid = read_sparse_voxel_grid(filename.c_str());
+
+            if (m_grid.get() == nullptr)
+            {
+                RENDERER_LOG_ERROR(
+                    "%s: failed to read sparse voxel grid file %s.",
+                    context.get(),
+                    filename.c_str());
+                m_grid_filename.clear();
+                return false;
+            }
+
+            m_majorants.reset(new MajorantGrid(*m_grid));
+            m_grid_filename = filename;
+
+            RENDERER_LOG_INFO(
+                "%s: loaded sparse voxel grid %s (" FMT_SIZE_T "x" FMT_SIZE_T "x" FMT_SIZE_T " voxels, "
+                FMT_SIZE_T " non-empty blocks, largest majorant %f).",
+                context.get(),
+                filename.c_str(),
+                m_grid->get_xres(),
+                m_grid->get_yres(),
+                m_grid->get_zres(),
+                m_grid->get_stored_block_count(),
+                m_majorants->get_max_majorant());
+        }
+
+        const AABB3f& bbox = m_grid->get_bbox();
+        m_grid_origin = bbox.min;
+        m_rcp_grid_extent = Vector3f(1.0f) / bbox.extent();
+
+        return true;
+    }
+
+    bool is_homogeneous() const override
+    {
+        return false;
+    }
+
+    size_t compute_input_data_size() const override
+    {
+        return sizeof(InputValues);
+    }
+
+    void prepare_inputs(
+        Arena&              arena,
+        const ShadingRay&   volume_ray,
+        void*               data) const override
+    {
+        InputValues* values = static_cast<InputValues*>(data);
+
+        values->m_absorption *= values->m_absorption_multiplier * values->m_density_multiplier;
+        values->m_scattering *= values->m_scattering_multiplier * values->m_density_multiplier;
+
+        // Precompute extinction at unit density.
+        values->m_precomputed.m_extinction = values->m_absorption + values->m_scattering;
+
+        // Express the ray in the unit cube of the grid.
+        values->m_precomputed.m_grid_org =
+            (Vector3f(volume_ray.m_org) - m_grid_origin) * m_rcp_grid_extent;
+        values->m_precomputed.m_grid_dir =
+            Vector3f(volume_ray.m_dir) * m_rcp_grid_extent;
+
+        // Use the average majorant along the ray as representative density.
+        MajorantIntegrator integrator = { 0.0f, 0.0f };
+        m_majorants->traverse(
+            values->m_precomputed.m_grid_org,
+            values->m_precomputed.m_grid_dir,
+            static_cast<float>(volume_ray.m_tmin),
+            static_cast<float>(volume_ray.m_tmax),
+            integrator);
+        values->m_precomputed.m_ray_density =
+            integrator.m_length > 0.0f ? integrator.m_integral / integrator.m_length : 0.0f;
+
+        values->m_precomputed.m_ray_absorption = values->m_absorption;
+        values->m_precomputed.m_ray_absorption *= values->m_precomputed.m_ray_density;
+        values->m_precomputed.m_ray_scattering = values->m_scattering;
+        values->m_precomputed.m_ray_scattering *= values->m_precomputed.m_ray_density;
+        values->m_precomputed.m_ray_extinction = values->m_precomputed.m_extinction;
+        values->m_precomputed.m_ray_extinction *= values->m_precomputed.m_ray_density;
+    }
+
+    float sample(
+        SamplingContext&    sampling_context,
+        const void*         data,
+        const ShadingRay&   volume_ray,
+        const float         distance,
+        Vector3f&           incoming) const override
+    {
+        sampling_context.split_in_place(2, 1);
+        const Vector2f s = sampling_context.next2<Vector2f>();
+
+        const Vector3f outgoing(normalize(volume_ray.m_dir));
+        return m_phase_function->sample(outgoing, s, incoming);
+    }
+
+    float evaluate(
+        const void*         data,
+        const ShadingRay&   volume_ray,
+        const float         distance,
+        const Vector3f&     incoming) const override
+    {
+        const Vector3f outgoing = Vector3f(normalize(volume_ray.m_dir));
+        return m_phase_function->evaluate(outgoing, incoming);
+    }
+
+    void evaluate_transmission(
+        const void*         data,
+        const ShadingRay&   volume_ray,
+        const float         distance,
+        Spectrum&           spectrum) const override
+    {
+        // No sampling context is available: derive the random numbers from the ray
+        // so that the estimate is the same every time the same segment is evaluated.
+        PCG rng(hash_ray(volume_ray, distance), 0);
+        track_transmission(data, distance, rng, spectrum);
+    }
+
+    void evaluate_transmission(
+        const void*         data,
+        const ShadingRay&   volume_ray,
+        Spectrum&           spectrum) const override
+    {
+        // Grid traversal is clipped to the bounding box of the grid,
+        // so infinite rays are fine.
+        const float distance = static_cast<float>(volume_ray.m_tmax);
+        evaluate_transmission(data, volume_ray, distance, spectrum);
+    }
+
+    void estimate_transmission(
+        SamplingContext&    sampling_context,
+        const void*         data,
+        const ShadingRay&   volume_ray,
+        const float         distance,
+        Spectrum&           spectrum) const override
+    {
+        PCG rng(make_seed(sampling_context, volume_ray, distance), 0);
+        track_transmission(data, distance, rng, spectrum);
+    }
+
+    bool sample_distance(
+        SamplingContext&    sampling_context,
+        const void*         data,
+        const ShadingRay&   volume_ray,
+        float&              distance,
+        Spectrum&           weight) const override
+    {
+        const InputValues* values = static_cast<const InputValues*>(data);
+        const float length = static_cast<float>(volume_ray.m_tmax);
+
+        PCG rng(make_seed(sampling_context, volume_ray, length), 0);
+
+        weight.set(1.0f);
+
+        return
+            spectral_tracking(
+                *m_grid,
+                *m_majorants,
+                values->m_precomputed.m_grid_org,
+                values->m_precomputed.m_grid_dir,
+                length,
+                values->m_precomputed.m_extinction,
+                values->m_scattering,
+                rng,
+                distance,
+                weight);
+    }
+
+    void scattering_coefficient(
+        const void*         data,
+        const ShadingRay&   volume_ray,
+        const float         distance,
+        Spectrum&           spectrum) const override
+    {
+        const InputValues* values = static_cast<const InputValues*>(data);
+        spectrum = values->m_scattering;
+        spectrum *= lookup_density(values, distance);
+    }
+
+    const Spectrum& scattering_coefficient(
+        const void*         data,
+        const ShadingRay&   volume_ray) const override
+    {
+        const InputValues* values = static_cast<const InputValues*>(data);
+        return values->m_precomputed.m_ray_scattering;
+    }
+
+    void absorption_coefficient(
+        const void*         data,
+        const ShadingRay&   volume_ray,
+        const float         distance,
+        Spectrum&           spectrum) const override
+    {
+        const InputValues* values = static_cast<const InputValues*>(data);
+        spectrum = values->m_absorption;
+        spectrum *= lookup_density(values, distance);
+    }
+
+    const Spectrum& absorption_coefficient(
+        const void*         data,
+        const ShadingRay&   volume_ray) const override
+    {
+        const InputValues* values = static_cast<const InputValues*>(data);
+        return values->m_precomputed.m_ray_absorption;
+    }
+
+    void extinction_coefficient(
+        const void*         data,
+        const ShadingRay&   volume_ray,
+        const float         distance,
+        Spectrum&           spectrum) const override
+    {
+        const InputValues* values = static_cast<const InputValues*>(data);
+        spectrum = values->m_precomputed.m_extinction;
+        spectrum *= lookup_density(values, distance);
+    }
+
+    const Spectrum& extinction_coefficient(
+        const void*         data,
+        const ShadingRay&   volume_ray) const override
+    {
+        const InputValues* values = static_cast<const InputValues*>(data);
+        return values->m_precomputed.m_ray_extinction;
+    }
+
+  private:
+    typedef GridVolumeInputValues InputValues;
+
+    std::unique_ptr<PhaseFunction>      m_phase_function;
+    std::unique_ptr<SparseVoxelGrid>    m_grid;
+    std::unique_ptr<MajorantGrid>       m_majorants;
+    std::string                         m_grid_filename;
+    Vector3f                            m_grid_origin;
+    Vector3f                            m_rcp_grid_extent;
+
+    float lookup_density(
+        const InputValues*  values,
+        const float         distance) const
+    {
+        return
+            m_grid->linear_lookup(
+                values->m_precomputed.m_grid_org +
+                distance * values->m_precomputed.m_grid_dir);
+    }
+
+    void track_transmission(
+        const void*         data,
+        const float         distance,
+        PCG&                rng,
+        Spectrum&           spectrum) const
+    {
+        const InputValues* values = static_cast<const InputValues*>(data);
+
+        ratio_tracking(
+            *m_grid,
+            *m_majorants,
+            values->m_precomputed.m_grid_org,
+            values->m_precomputed.m_grid_dir,
+            distance,
+            values->m_precomputed.m_extinction,
+            rng,
+            spectrum);
+    }
+
+    static uint64 make_seed(
+        SamplingContext&    sampling_context,
+        const ShadingRay&   volume_ray,
+        const float         distance)
+    {
+        sampling_context.split_in_place(1, 1);
+        const float s = sampling_context.next2<float>();
+
+        return mix_uint64(hash_ray(volume_ray, distance), static_cast<uint64>(binary_cast<uint32>(s)));
+    }
+};
+
+
+//
+// GridVolumeFactory class implementation.
+//
+
+void GridVolumeFactory::release()
+{
+    delete this;
+}
+
+const char* GridVolumeFactory::get_model() const
+{
+    return Model;
+}
+
+Dictionary GridVolumeFactory::get_model_metadata() const
+{
+    return
+        Dictionary()
+            .insert("name", Model)
+            .insert("label", "Grid Volume");
+}
+
+DictionaryArray GridVolumeFactory::get_input_metadata() const
+{
+    DictionaryArray metadata;
+
+    metadata.push_back(
+        Dictionary()
+            .insert("name", "filename")
+            .insert("label", "File Path")
+            .insert("type", "file")
+            .insert("file_picker_mode", "open")
+            .insert("file_picker_type", "volume")
+            .insert("use", "required"));
+
+    metadata.push_back(
+        Dictionary()
+            .insert("name", "density_multiplier")
+            .insert("label", "Density Multiplier")
+            .insert("type", "numeric")
+            .insert("min",
+                Dictionary()
+                    .insert("value", "0.0")
+                    .insert("type", "hard"))
+            .insert("max",
+                Dictionary()
+                    .insert("value", "10.0")
+                    .insert("type", "soft"))
+            .insert("use", "optional")
+            .insert("default", "1.0"));
+
+    metadata.push_back(
+        Dictionary()
+            .insert("name", "absorption")
+            .insert("label", "Absorption Coefficient")
+            .insert("type", "colormap")
+            .insert("entity_types",
+                Dictionary().insert("color", "Colors"))
+            .insert("use", "required")
+            .insert("default", "0.5"));
+
+    metadata.push_back(
+        Dictionary()
+            .insert("name", "absorption_multiplier")
+            .insert("label", "Absorption Coefficient Multiplier")
+            .insert("type", "numeric")
+            .insert("min",
+                Dictionary()
+                    .insert("value", "0.0")
+                    .insert("type", "hard"))
+            .insert("max",
+                Dictionary()
+                    .insert("value", "200.0")
+                    .insert("type", "soft"))
+            .insert("use", "optional")
+            .insert("default", "1.0"));
+
+    metadata.push_back(
+        Dictionary()
+            .insert("name", "scattering")
+            .insert("label", "Scattering Coefficient")
+            .insert("type", "colormap")
+            .insert("entity_types",
+                Dictionary().insert("color", "Colors"))
+            .insert("use", "required")
+            .insert("default", "0.5"));
+
+    metadata.push_back(
+        Dictionary()
+            .insert("name", "scattering_multiplier")
+            .insert("label", "Scattering Coefficient Multiplier")
+            .insert("type", "numeric")
+            .insert("min",
+                Dictionary()
+                    .insert("value", "0.0")
+                    .insert("type", "hard"))
+            .insert("max",
+                Dictionary()
+                    .insert("value", "200.0")
+                    .insert("type", "soft"))
+            .insert("use", "optional")
+            .insert("default", "1.0"));
+
+    metadata.push_back(
+        Dictionary()
+            .insert("name", "phase_function_model")
+            .insert("label", "Phase Function Model")
+            .insert("type", "enumeration")
+            .insert("items",
+                Dictionary()
+                    .insert("Isotropic", "isotropic")
+                    .insert("Henyey-Greenstein", "henyey"))
+            .insert("use", "required")
+            .insert("default", "isotropic")
+            .insert("on_change", "rebuild_form"));
+
+    metadata.push_back(
+        Dictionary()
+            .insert("name", "average_cosine")
+            .insert("label", "Average Cosine (g)")
+            .insert("type", "numeric")
+            .insert("min",
+                Dictionary()
+                    .insert("value", "-1.0")
+                    .insert("type", "soft"))
+            .insert("max",
+                Dictionary()
+                    .insert("value", "1.0")
+                    .insert("type", "soft"))
+            .insert("use", "optional")
+            .insert("default", "0.0")
+            .insert("visible_if",
+                Dictionary().insert("phase_function_model", "henyey")));
+
+    return metadata;
+}
+
+auto_release_ptr<Volume> GridVolumeFactory::create(
+    const char*         name,
+    const ParamArray&   params) const
+{
+    return auto_release_ptr<Volume>(new GridVolume(name, params));
+}
+
+}   // namespace renderer
@@ -35,8 +35,13 @@
 #include "renderer/modeling/input/inputarray.h"
 
 // appleseed.foundation headers.
+#include "foundation/math/sampling/mappings.h"
+#include "foundation/math/scalar.h"
 #include "foundation/utility/arena.h"
 
+// Standard headers.
+#include <cstddef>
+
 using namespace foundation;
 
 namespace renderer
@@ -87,4 +92,101 @@ void Volume::prepare_inputs(
 {
 }
 
+void Volume::estimate_transmission(
+    SamplingContext&        sampling_context,
+    const void*             data,
+    const ShadingRay&       volume_ray,
+    const float             distance,
+    Spectrum&               spectrum) const
+{
+    evaluate_transmission(data, volume_ray, distance, spectrum);
+}
+
+bool Volume::sample_distance(
+    SamplingContext&        sampling_context,
+    const void*             data,
+    const ShadingRay&       volume_ray,
+    float&                  distance,
+    Spectrum&               weight) const
+{
+    // Retrieve extinction spectrum.
+    const Spectrum& extinction_coef = extinction_coefficient(data, volume_ray);
+
+    // Sample channel uniformly at random.
+    sampling_context.split_in_place(1, 1);
+    const float s = sampling_context.next2<float>();
+    const size_t channel = truncate<size_t>(s * Spectrum::size());
+    const bool extinction_is_null = extinction_coef[channel] < 1.0e-6f;
+
+    // Sample distance.
+    float distance_pdf;
+    if (extinction_is_null)
+    {
+        distance = 0.0f;
+        distance_pdf = 0.0f;
+    }
+    else
+    {
+        sampling_context.split_in_place(1, 1);
+        distance =
+            sample_exponential_distribution(
+                sampling_context.next2<float>(),
+                extinction_coef[channel]);
+        distance_pdf =
+            exponential_distribution_pdf(
+                distance,
+                extinction_coef[channel]);
+    }
+
+    // The ray leaves the volume if the sampled distance exceeds its total length.
+    if (extinction_is_null || volume_ray.m_tmax < distance)
+    {
+        evaluate_transmission(data, volume_ray, weight);
+        weight /= average_value(weight);    // equivalent to multiplying by MIS weight
+                                            // and then dividing by transmission[channel]
+        return false;
+    }
+
+    // Evaluate transmission between the origin and the sampled distance.
+    Spectrum transmission;
+    evaluate_transmission(data, volume_ray, distance, transmission);
+
+    // Compute MIS weight.
+    // MIS terms are:
+    //  - scattering albedo,
+    //  - throughput of the entire path up to the sampled point.
+    // Reference: "Practical and Controllable Subsurface Scattering
+    // for Production Path Tracing", p. 1 [ACM 2016 Article].
+    float mis_weights_sum = 0.0f;
+    for (size_t i = 0, e = Spectrum::size(); i < e; ++i)
+    {
+        if (extinction_coef[i] > 1.0e-6f)
+        {
+            const float probability =
+                exponential_distribution_pdf(
+                    distance,
+                    extinction_coef[i]);
+            mis_weights_sum += square(probability);
+        }
+    }
+
+    if (mis_weights_sum < 1.0e-6f)
+    {
+        // No scattering.
+        weight.set(0.0f);
+        return true;
+    }
+
+    const float current_mis_weight =
+        Spectrum::size() *
+        square(distance_pdf) /
+        mis_weights_sum;
+
+    weight = scattering_coefficient(data, volume_ray);
+    weight *= transmission;
+    weight *= current_mis_weight / distance_pdf;
+
+    return true;
+}
+
 }   // namespace renderer
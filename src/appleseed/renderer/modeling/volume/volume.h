@@ -117,6 +117,29 @@ class APPLESEED_DLLSYMBOL Volume
         const ShadingRay&           volume_ray,                 // ray used for marching inside the volume
         Spectrum&                   spectrum) const = 0;        // resulting spectrum
 
+    // Estimate the transmission (spectrum) between the front end of the ray and a given point.
+    // Heterogeneous volumes may return an unbiased stochastic estimate. By default, this returns
+    // the transmission computed by evaluate_transmission().
+    virtual void estimate_transmission(
+        SamplingContext&            sampling_context,
+        const void*                 data,                       // input values
+        const ShadingRay&           volume_ray,                 // ray used for marching inside the volume
+        const float                 distance,                   // distance to the point on this volume segment
+        Spectrum&                   spectrum) const;            // resulting spectrum
+
+    // Sample the distance to the next scattering event along the ray. Return true if a scattering
+    // event happens on the ray, false if the ray leaves the volume first. In both cases, return
+    // the factor by which the path throughput must be multiplied: it includes the transmission,
+    // the scattering coefficient at the scattering event and the probability of the sample.
+    // The default implementation performs exponential sampling based on the extinction coefficient
+    // at the ray origin, combining spectral channels with multiple importance sampling.
+    virtual bool sample_distance(
+        SamplingContext&            sampling_context,
+        const void*                 data,                       // input values
+        const ShadingRay&           volume_ray,                 // ray used for marching inside the volume
+        float&                      distance,                   // distance to the scattering event
+        Spectrum&                   weight) const;              // throughput factor
+
     // Get the scattering coefficient (spectrum) at a given point.
     virtual void scattering_coefficient(
         const void*                 data,                       // input values
@@ -149,6 +172,7 @@ class APPLESEED_DLLSYMBOL Volume
         Spectrum&                   spectrum) const = 0;        // resulting spectrum
 
     // Get the extinction coefficient (spectrum) at the ray origin.
+    // Heterogeneous volumes return a representative value along the ray, used to sample distances.
     virtual const Spectrum& extinction_coefficient(
         const void*                 data,                       // input values
         const ShadingRay&           volume_ray) const = 0;      // ray used for marching inside the volume
@@ -53,6 +53,13 @@ namespace renderer
 //
 // Internal working spectrum type, either RGB or spectral depending on the thread-local spectrum mode.
 //
+// In hero mode, spectra are stored like in spectral mode but with their wavelengths interleaved:
+// stored sample 4*j+k holds wavelength j+k*HeroSetCount. Each group of four consecutive stored
+// samples thus forms a set of hero wavelengths equally spaced over the whole spectrum. While a set
+// is selected (typically for the duration of a camera path), spectra only store and operate on the
+// wavelengths of this set, at the cost of RGB arithmetic. Spectra computed while all wavelengths are
+// selected (for instance, when preparing the scene for rendering) can be used with any set.
+//
 
 template <typename T, size_t N>
 class DynamicSpectrum
@@ -68,9 +75,13 @@ class DynamicSpectrum
     enum Mode
     {
         RGB = 0,            // DynamicSpectrum stores and operates on RGB triplets
-        Spectral = 1        // DynamicSpectrum stores and operates on spectra
+        Spectral = 1,       // DynamicSpectrum stores and operates on spectra
+        Hero = 2            // DynamicSpectrum stores and operates on sets of hero wavelengths
     };
 
+    // Number of sets of hero wavelengths.
+    static const size_t HeroSetCount = StoredSamples / 4;
+
     enum Intent
     {
         Reflectance = 0,    // this spectrum represents a reflectance in [0, 1]^N
@@ -86,6 +97,16 @@ class DynamicSpectrum
     // Return the number of active color channels for the current spectrum mode.
     static size_t size();
 
+    // Hero mode: restrict spectra to a given set of hero wavelengths, in [0, HeroSetCount).
+    static void select_hero_wavelengths(const size_t set_index);
+
+    // Hero mode: operate on all wavelengths again.
+    static void select_all_wavelengths();
+
+    // Return the index in [0, N) of the wavelength held by a given active channel
+    // in spectral and hero modes.
+    static size_t get_wavelength_index(const size_t i);
+
     // Constructors.
 #ifdef APPLESEED_USE_SSE
     DynamicSpectrum();                                      // leave all components uninitialized
@@ -143,6 +164,7 @@ class DynamicSpectrum
   private:
     static APPLESEED_TLS Mode       s_mode;
     static APPLESEED_TLS size_t     s_size;
+    static APPLESEED_TLS size_t     s_offset;      // index of the first active stored sample
 
     APPLESEED_SIMD4_ALIGN ValueType m_samples[StoredSamples];
 };
@@ -281,13 +303,20 @@ APPLESEED_TLS typename DynamicSpectrum<T, N>::Mode DynamicSpectrum<T, N>::s_mode
 template <typename T, size_t N>
 APPLESEED_TLS size_t DynamicSpectrum<T, N>::s_size = 3;
 
+template <typename T, size_t N>
+APPLESEED_TLS size_t DynamicSpectrum<T, N>::s_offset = 0;
+
 template <typename T, size_t N>
 typename DynamicSpectrum<T, N>::Mode DynamicSpectrum<T, N>::set_mode(const Mode mode)
 {
+    // In hero mode, all stored samples but the last one must hold a wavelength.
+    assert(mode != Hero || StoredSamples - N <= 1);
+
     const Mode old_mode = s_mode;
 
     s_mode = mode;
     s_size = mode == RGB ? 3 : N;
+    s_offset = 0;
 
     return old_mode;
 }
@@ -304,12 +333,45 @@ inline size_t DynamicSpectrum<T, N>::size()
     return s_size;
 }
 
+template <typename T, size_t N>
+inline void DynamicSpectrum<T, N>::select_hero_wavelengths(const size_t set_index)
+{
+    assert(s_mode == Hero);
+    assert(set_index < HeroSetCount);
+
+    // The last set may contain less than four wavelengths.
+    s_offset = 4 * set_index;
+    s_size = std::min<size_t>((N - set_index + HeroSetCount - 1) / HeroSetCount, 4);
+}
+
+template <typename T, size_t N>
+inline void DynamicSpectrum<T, N>::select_all_wavelengths()
+{
+    assert(s_mode == Hero);
+
+    s_offset = 0;
+    s_size = N;
+}
+
+template <typename T, size_t N>
+inline size_t DynamicSpectrum<T, N>::get_wavelength_index(const size_t i)
+{
+    assert(s_mode != RGB);
+    assert(i < s_size);
+
+    if (s_mode == Spectral)
+        return i;
+
+    const size_t stored_index = s_offset + i;
+    return stored_index / 4 + (stored_index % 4) * HeroSetCount;
+}
+
 #ifdef APPLESEED_USE_SSE
 
 template <typename T, size_t N>
 inline DynamicSpectrum<T, N>::DynamicSpectrum()
 {
-    m_samples[s_size] = T(0.0);
+    m_samples[s_offset + s_size] = T(0.0);
 }
 
 #endif
@@ -320,7 +382,7 @@ inline DynamicSpectrum<T, N>::DynamicSpectrum(const ValueType val)
     set(val);
 
 #ifdef APPLESEED_USE_SSE
-    m_samples[s_size] = T(0.0);
+    m_samples[s_offset + s_size] = T(0.0);
 #endif
 }
 
@@ -333,7 +395,7 @@ inline DynamicSpectrum<T, N>::DynamicSpectrum(
     set(rgb, lighting_conditions, intent);
 
 #ifdef APPLESEED_USE_SSE
-    m_samples[s_size] = T(0.0);
+    m_samples[s_offset + s_size] = T(0.0);
 #endif
 }
 
@@ -346,7 +408,7 @@ inline DynamicSpectrum<T, N>::DynamicSpectrum(
     set(spectrum, lighting_conditions, intent);
 
 #ifdef APPLESEED_USE_SSE
-    m_samples[s_size] = T(0.0);
+    m_samples[s_offset + s_size] = T(0.0);
 #endif
 }
 
@@ -355,10 +417,10 @@ template <typename U>
 inline DynamicSpectrum<T, N>::DynamicSpectrum(const DynamicSpectrum<U, N>& rhs)
 {
     for (size_t i = 0; i < s_size; ++i)
-        m_samples[i] = static_cast<ValueType>(rhs[i]);
+        m_samples[s_offset + i] = static_cast<ValueType>(rhs[i]);
 
 #ifdef APPLESEED_USE_SSE
-    m_samples[s_size] = T(0.0);
+    m_samples[s_offset + s_size] = T(0.0);
 #endif
 }
 
@@ -370,7 +432,7 @@ inline DynamicSpectrum<T, N> DynamicSpectrum<T, N>::from_array(const ValueType*
     DynamicSpectrum result;
 
     for (size_t i = 0; i < s_size; ++i)
-        result.m_samples[i] = rhs[i];
+        result.m_samples[s_offset + i] = rhs[i];
 
     return result;
 }
@@ -379,7 +441,7 @@ template <typename T, size_t N>
 inline void DynamicSpectrum<T, N>::set(const ValueType val)
 {
     for (size_t i = 0; i < s_size; ++i)
-        m_samples[i] = val;
+        m_samples[s_offset + i] = val;
 }
 
 #ifdef APPLESEED_USE_SSE
@@ -389,9 +451,9 @@ APPLESEED_FORCE_INLINE void DynamicSpectrum<float, 31>::set(const float val)
 {
     const __m128 mval = _mm_set1_ps(val);
 
-    _mm_store_ps(&m_samples[ 0], mval);
+    _mm_store_ps(&m_samples[s_offset], mval);
 
-    if (s_size > 3)
+    if (s_size > 4)
     {
         _mm_store_ps(&m_samples[ 4], mval);
         _mm_store_ps(&m_samples[ 8], mval);
@@ -417,7 +479,7 @@ void DynamicSpectrum<T, N>::set(
         m_samples[1] = rgb[1];
         m_samples[2] = rgb[2];
     }
-    else
+    else if (s_mode == Spectral)
     {
         if (intent == Reflectance)
         {
@@ -432,6 +494,17 @@ void DynamicSpectrum<T, N>::set(
                 reinterpret_cast<foundation::RegularSpectrum<T, N>&>(m_samples[0]));
         }
     }
+    else
+    {
+        foundation::RegularSpectrum<T, N> spectrum;
+
+        if (intent == Reflectance)
+            foundation::linear_rgb_reflectance_to_spectrum(rgb, spectrum);
+        else foundation::linear_rgb_illuminance_to_spectrum(rgb, spectrum);
+
+        for (size_t i = 0; i < s_size; ++i)
+            m_samples[s_offset + i] = spectrum[get_wavelength_index(i)];
+    }
 }
 
 template <typename T, size_t N>
@@ -445,6 +518,11 @@ void DynamicSpectrum<T, N>::set(
         for (size_t i = 0; i < N; ++i)
             m_samples[i] = spectrum[i];
     }
+    else if (s_mode == Hero)
+    {
+        for (size_t i = 0; i < s_size; ++i)
+            m_samples[s_offset + i] = spectrum[get_wavelength_index(i)];
+    }
     else
     {
         reinterpret_cast<foundation::Color<T, 3>&>(m_samples[0]) =
@@ -457,14 +535,14 @@ template <typename T, size_t N>
 inline T& DynamicSpectrum<T, N>::operator[](const size_t i)
 {
     assert(i < s_size);
-    return m_samples[i];
+    return m_samples[s_offset + i];
 }
 
 template <typename T, size_t N>
 inline const T& DynamicSpectrum<T, N>::operator[](const size_t i) const
 {
     assert(i < s_size);
-    return m_samples[i];
+    return m_samples[s_offset + i];
 }
 
 template <typename T, size_t N>
@@ -474,19 +552,40 @@ inline foundation::Color<T, 3> DynamicSpectrum<T, N>::to_rgb(
     return
         s_mode == RGB
             ? foundation::Color<T, 3>(m_samples[0], m_samples[1], m_samples[2])
-            : foundation::ciexyz_to_linear_rgb(
-                  foundation::spectrum_to_ciexyz<T>(lighting_conditions, *this));
+            : foundation::ciexyz_to_linear_rgb(to_ciexyz(lighting_conditions));
 }
 
 template <typename T, size_t N>
 inline foundation::Color<T, 3> DynamicSpectrum<T, N>::to_ciexyz(
     const foundation::LightingConditions& lighting_conditions) const
 {
-    return
-        s_mode == RGB
-            ? linear_rgb_to_ciexyz(
-                  foundation::Color<T, 3>(m_samples[0], m_samples[1], m_samples[2]))
-            : foundation::spectrum_to_ciexyz<T>(lighting_conditions, *this);
+    if (s_mode == RGB)
+    {
+        return
+            linear_rgb_to_ciexyz(
+                foundation::Color<T, 3>(m_samples[0], m_samples[1], m_samples[2]));
+    }
+
+    if (s_mode == Spectral)
+        return foundation::spectrum_to_ciexyz<T>(lighting_conditions, *this);
+
+    // In hero mode, estimate the integral over the whole spectrum from the selected wavelengths.
+    // Each wavelength belongs to exactly one set, and sets are selected with equal probability.
+    T x = T(0.0);
+    T y = T(0.0);
+    T z = T(0.0);
+
+    for (size_t i = 0; i < s_size; ++i)
+    {
+        const size_t w = get_wavelength_index(i);
+        const T val = m_samples[s_offset + i];
+        x += lighting_conditions.m_cmf[w][0] * val;
+        y += lighting_conditions.m_cmf[w][1] * val;
+        z += lighting_conditions.m_cmf[w][2] * val;
+    }
+
+    const T weight = s_size == N ? T(1.0) : static_cast<T>(HeroSetCount);
+    return foundation::Color<T, 3>(x * weight, y * weight, z * weight);
 }
 
 template <typename T, size_t N>
@@ -624,7 +723,7 @@ APPLESEED_FORCE_INLINE DynamicSpectrum<float, 31>& operator+=(DynamicSpectrum<fl
 {
     _mm_store_ps(&lhs[ 0], _mm_add_ps(_mm_load_ps(&lhs[ 0]), _mm_load_ps(&rhs[ 0])));
 
-    if (DynamicSpectrum<float, 31>::size() > 3)
+    if (DynamicSpectrum<float, 31>::size() > 4)
     {
         _mm_store_ps(&lhs[ 4], _mm_add_ps(_mm_load_ps(&lhs[ 4]), _mm_load_ps(&rhs[ 4])));
         _mm_store_ps(&lhs[ 8], _mm_add_ps(_mm_load_ps(&lhs[ 8]), _mm_load_ps(&rhs[ 8])));
@@ -667,7 +766,7 @@ APPLESEED_FORCE_INLINE DynamicSpectrum<float, 31>& operator*=(DynamicSpectrum<fl
 
     _mm_store_ps(&lhs[ 0], _mm_mul_ps(_mm_load_ps(&lhs[ 0]), mrhs));
 
-    if (DynamicSpectrum<float, 31>::size() > 3)
+    if (DynamicSpectrum<float, 31>::size() > 4)
     {
         _mm_store_ps(&lhs[ 4], _mm_mul_ps(_mm_load_ps(&lhs[ 4]), mrhs));
         _mm_store_ps(&lhs[ 8], _mm_mul_ps(_mm_load_ps(&lhs[ 8]), mrhs));
@@ -699,7 +798,7 @@ APPLESEED_FORCE_INLINE DynamicSpectrum<float, 31>& operator*=(DynamicSpectrum<fl
 {
     _mm_store_ps(&lhs[ 0], _mm_mul_ps(_mm_load_ps(&lhs[ 0]), _mm_load_ps(&rhs[ 0])));
 
-    if (DynamicSpectrum<float, 31>::size() > 3)
+    if (DynamicSpectrum<float, 31>::size() > 4)
     {
         _mm_store_ps(&lhs[ 4], _mm_mul_ps(_mm_load_ps(&lhs[ 4]), _mm_load_ps(&rhs[ 4])));
         _mm_store_ps(&lhs[ 8], _mm_mul_ps(_mm_load_ps(&lhs[ 8]), _mm_load_ps(&rhs[ 8])));
@@ -781,7 +880,7 @@ APPLESEED_FORCE_INLINE void madd(
 {
     _mm_store_ps(&a[0], _mm_add_ps(_mm_load_ps(&a[0]), _mm_mul_ps(_mm_load_ps(&b[0]), _mm_load_ps(&c[0]))));
 
-    if (DynamicSpectrum<float, 31>::size() > 3)
+    if (DynamicSpectrum<float, 31>::size() > 4)
     {
         _mm_store_ps(&a[ 4], _mm_add_ps(_mm_load_ps(&a[ 4]), _mm_mul_ps(_mm_load_ps(&b[ 4]), _mm_load_ps(&c[ 4]))));
         _mm_store_ps(&a[ 8], _mm_add_ps(_mm_load_ps(&a[ 8]), _mm_mul_ps(_mm_load_ps(&b[ 8]), _mm_load_ps(&c[ 8]))));
@@ -803,7 +902,7 @@ APPLESEED_FORCE_INLINE void madd(
 
     _mm_store_ps(&a[0], _mm_add_ps(_mm_load_ps(&a[0]), _mm_mul_ps(_mm_load_ps(&b[0]), k)));
 
-    if (DynamicSpectrum<float, 31>::size() > 3)
+    if (DynamicSpectrum<float, 31>::size() > 4)
     {
         _mm_store_ps(&a[ 4], _mm_add_ps(_mm_load_ps(&a[ 4]), _mm_mul_ps(_mm_load_ps(&b[ 4]), k)));
         _mm_store_ps(&a[ 8], _mm_add_ps(_mm_load_ps(&a[ 8]), _mm_mul_ps(_mm_load_ps(&b[ 8]), k)));
@@ -1019,7 +1118,7 @@ APPLESEED_FORCE_INLINE renderer::DynamicSpectrum<float, 31> lerp(
     __m128 y = _mm_mul_ps(_mm_load_ps(&b[0]), t4);
     _mm_store_ps(&result[0], _mm_add_ps(x, y));
 
-    if (renderer::DynamicSpectrum<float, 31>::size() > 3)
+    if (renderer::DynamicSpectrum<float, 31>::size() > 4)
     {
         for (size_t i = 4; i < a.StoredSamples; i += 4)
         {
@@ -1055,8 +1154,15 @@ inline T min_value(const renderer::DynamicSpectrum<T, N>& s)
 template <>
 inline float min_value(const renderer::DynamicSpectrum<float, 31>& s)
 {
-    if (renderer::DynamicSpectrum<float, 31>::size() == 3)
-        return std::min(std::min(s[0], s[1]), s[2]);
+    if (renderer::DynamicSpectrum<float, 31>::size() <= 4)
+    {
+        float value = s[0];
+
+        for (size_t i = 1, e = renderer::DynamicSpectrum<float, 31>::size(); i < e; ++i)
+            value = std::min(value, s[i]);
+
+        return value;
+    }
 
     const __m128 m1 = _mm_min_ps(_mm_load_ps(&s[ 0]), _mm_load_ps(&s[ 4]));
     const __m128 m2 = _mm_min_ps(_mm_load_ps(&s[ 8]), _mm_load_ps(&s[12]));
@@ -1094,8 +1200,15 @@ inline T max_value(const renderer::DynamicSpectrum<T, N>& s)
 template <>
 inline float max_value(const renderer::DynamicSpectrum<float, 31>& s)
 {
-    if (renderer::DynamicSpectrum<float, 31>::size() == 3)
-        return std::max(std::max(s[0], s[1]), s[2]);
+    if (renderer::DynamicSpectrum<float, 31>::size() <= 4)
+    {
+        float value = s[0];
+
+        for (size_t i = 1, e = renderer::DynamicSpectrum<float, 31>::size(); i < e; ++i)
+            value = std::max(value, s[i]);
+
+        return value;
+    }
 
     const __m128 m1 = _mm_max_ps(_mm_load_ps(&s[ 0]), _mm_load_ps(&s[ 4]));
     const __m128 m2 = _mm_max_ps(_mm_load_ps(&s[ 8]), _mm_load_ps(&s[12]));
@@ -1255,7 +1368,7 @@ APPLESEED_FORCE_INLINE renderer::DynamicSpectrum<float, 31> sqrt(const renderer:
 
     _mm_store_ps(&result[ 0], _mm_sqrt_ps(_mm_load_ps(&s[ 0])));
 
-    if (renderer::DynamicSpectrum<float, 31>::size() > 3)
+    if (renderer::DynamicSpectrum<float, 31>::size() > 4)
     {
         _mm_store_ps(&result[ 4], _mm_sqrt_ps(_mm_load_ps(&s[ 4])));
         _mm_store_ps(&result[ 8], _mm_sqrt_ps(_mm_load_ps(&s[ 8])));
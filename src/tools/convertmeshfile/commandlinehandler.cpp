@@ -57,6 +57,12 @@ CommandLineHandler::CommandLineHandler()
             .add_name("--print-bounding-boxes")
             .add_name("-b")
             .set_description("print mesh bounding boxes"));
+
+    parser().add_option_handler(
+        &m_uncompressed
+            .add_name("--uncompressed")
+            .add_name("-u")
+            .set_description("store binarymesh chunks uncompressed so that they can be used directly from memory-mapped files"));
 }
 
 void CommandLineHandler::print_program_usage(
@@ -54,6 +54,7 @@ class CommandLineHandler
   public:
     foundation::ValueOptionHandler<std::string> m_filenames;
     foundation::FlagOptionHandler               m_print_bboxes;
+    foundation::FlagOptionHandler               m_uncompressed;
 
     // Constructor.
     CommandLineHandler();
@@ -37,6 +37,7 @@
 // appleseed.foundation headers.
 #include "foundation/math/aabb.h"
 #include "foundation/math/vector.h"
+#include "foundation/mesh/binarymeshfilewriter.h"
 #include "foundation/mesh/genericmeshfilereader.h"
 #include "foundation/mesh/genericmeshfilewriter.h"
 #include "foundation/mesh/imeshbuilder.h"
@@ -334,7 +335,9 @@ int main(int argc, char* argv[])
     }
 
     // Write the output mesh file.
-    GenericMeshFileWriter writer(output_filepath.c_str());
+    GenericMeshFileWriter writer(
+        output_filepath.c_str(),
+        cl.m_uncompressed.is_set() ? BinaryMeshFileWriter::Uncompressed : BinaryMeshFileWriter::Default);
     try
     {
         for (const_each<list<Mesh>> i = builder.get_meshes(); i; ++i)